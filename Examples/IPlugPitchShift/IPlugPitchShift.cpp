@@ -0,0 +1,61 @@
+#define WDL_SIMPLEPITCHSHIFT_IMPLEMENT
+#include "IPlugPitchShift.h"
+#include "IPlug_include_in_plug_src.h"
+
+// a few of WDL_SimplePitchShifter's quality settings, from long windows (smooth, more delay) to short ones
+static const int kQualities[] = { 13, 0, 27, 36, 40 };
+static const int kNumQualities = sizeof(kQualities) / sizeof(kQualities[0]);
+
+IPlugPitchShift::IPlugPitchShift(const InstanceInfo& info)
+: Plugin(info, MakeConfig(static_cast<int>(Parameters::Count), presetCount))
+{
+  GetParam(static_cast<int>(Parameters::Pitch))->InitDouble("Pitch", 0., -12., 12., 0.01, "st");
+  GetParam(static_cast<int>(Parameters::Quality))->InitEnum("Quality", 1, kNumQualities);
+  for (int i = 0; i < kNumQualities; i++)
+    GetParam(static_cast<int>(Parameters::Quality))->SetDisplayText(i, WDL_SimplePitchShifter::enumQual(kQualities[i]));
+
+  UpdateLatency();
+}
+
+void IPlugPitchShift::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
+{
+  const int nChans = std::min(NInChansConnected(), NOutChansConnected());
+  const int quality = GetParam(static_cast<int>(Parameters::Quality))->Int();
+
+  // a new quality changes the window size, so the shifter rebuilds its grain buffer. The host hears about the new latency from OnIdle()
+  if (quality != mQuality)
+  {
+    mShifter.SetQualityParameter(kQualities[quality]);
+    mQuality = quality;
+  }
+
+  mShifter.set_shift(std::pow(2.0, GetParam(static_cast<int>(Parameters::Pitch))->Value() / 12.0));
+  // no intermediate buffers: the shifter reads and writes the channel buffers, and the output is always nFrames long
+  mShifter.ProcessBlock(inputs, outputs, nChans, nFrames);
+
+  for (int c = nChans; c < NOutChansConnected(); c++)
+    memset(outputs[c], 0, nFrames * sizeof(sample));
+}
+
+void IPlugPitchShift::OnReset()
+{
+  mShifter.set_srate(GetSampleRate());
+  mShifter.Reset();
+}
+
+void IPlugPitchShift::OnIdle()
+{
+  // not from OnParamChange() or OnReset(), which may run on the audio thread, where SetLatency() must not be called (VST3 restarts the component)
+  UpdateLatency();
+}
+
+void IPlugPitchShift::UpdateLatency()
+{
+  mLatencyShifter.set_srate(GetSampleRate());
+  mLatencyShifter.SetQualityParameter(kQualities[GetParam(static_cast<int>(Parameters::Quality))->Int()]);
+
+  const int latency = mLatencyShifter.GetLatency();
+
+  if (latency != GetLatency())
+    SetLatency(latency);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "IPlug_include_in_plug_hdr.h"
+
+#define WDL_SIMPLEPITCHSHIFT_SAMPLETYPE iplug::sample
+#include "simple_pitchshift.h"
+
+const int presetCount = 1;
+
+enum class Parameters: int
+{
+  Pitch = 0,
+  Quality,
+  Count
+};
+
+using namespace iplug;
+
+class IPlugPitchShift final: public Plugin
+{
+public:
+  IPlugPitchShift(const InstanceInfo& info);
+  
+  void ProcessBlock(sample** inputs, sample** outputs, int nFrames) override;
+  void OnReset() override;
+  void OnIdle() override;
+
+private:
+  /** Reports the delay of the current quality setting and sample rate to the host, if it has changed. Called on the main thread */
+  void UpdateLatency();
+
+  WDL_SimplePitchShifter mShifter;
+  int mQuality = -1; // the quality index the shifter is set to, audio thread only
+  WDL_SimplePitchShifter mLatencyShifter; // never processes, only holds the settings to work out the latency on the main thread
+};
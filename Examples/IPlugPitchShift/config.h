@@ -0,0 +1,47 @@
+#define PLUG_NAME "IPlugPitchShift"
+#define PLUG_MFR "AcmeInc"
+#define PLUG_VERSION_HEX 0x00010000
+#define PLUG_VERSION_STR "1.0.0"
+#define PLUG_UNIQUE_ID 'Ipps'
+#define PLUG_MFR_ID 'Acme'
+#define PLUG_URL_STR "https://iplug2.github.io"
+#define PLUG_EMAIL_STR "spam@me.com"
+#define PLUG_COPYRIGHT_STR "Copyright 2020 Acme Inc"
+#define PLUG_CLASS_NAME IPlugPitchShift
+#define NO_IGRAPHICS
+
+#define BUNDLE_NAME "IPlugPitchShift"
+#define BUNDLE_MFR "AcmeInc"
+#define BUNDLE_DOMAIN "com"
+
+#define SHARED_RESOURCES_SUBPATH "IPlugPitchShift"
+
+#define PLUG_CHANNEL_IO "1-1 2-2"
+
+#define PLUG_LATENCY 0
+#define PLUG_TYPE 0
+#define PLUG_DOES_MIDI_IN 0
+#define PLUG_DOES_MIDI_OUT 0
+#define PLUG_DOES_MPE 0
+#define PLUG_DOES_STATE_CHUNKS 0
+#define PLUG_HAS_UI 0
+#define PLUG_WIDTH 600
+#define PLUG_HEIGHT 600
+#define PLUG_FPS 60
+#define PLUG_SHARED_RESOURCES 0
+#define PLUG_HOST_RESIZE 0
+
+#define AUV2_ENTRY IPlugPitchShift_Entry
+#define AUV2_ENTRY_STR "IPlugPitchShift_Entry"
+#define AUV2_FACTORY IPlugPitchShift_Factory
+#define AUV2_VIEW_CLASS IPlugPitchShift_View
+#define AUV2_VIEW_CLASS_STR "IPlugPitchShift_View"
+
+#define VST3_SUBCATEGORY "Fx"
+
+#define APP_NUM_CHANNELS 2
+#define APP_N_VECTOR_WAIT 0
+#define APP_MULT 1
+#define APP_COPY_AUV3 0
+#define APP_SIGNAL_VECTOR_SIZE 64
+
@@ -93,6 +93,12 @@ bool IPlugAPP::EditorResize(int viewWidth, int viewHeight)
 
 bool IPlugAPP::SendMidiMsg(const IMidiMsg& msg)
 {
+#ifdef APP_NATIVE_JACK
+  // when called during JACK processing, the message goes to the JACK MIDI output at its offset
+  if (mAppHost->mJackClient && mAppHost->mJackClient->SendMidiMsg(msg))
+    return true;
+#endif
+
   if (DoesMIDIOut() && mAppHost->mMidiOut)
   {
     //TODO: midi out channel
@@ -139,35 +145,48 @@ void IPlugAPP::SendSysexMsgFromUI(const ISysEx& msg)
   SendSysEx(msg);
 }
 
-void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
+void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames, double startTime)
+{
+  ProcessAppBlock(inputs, outputs, nFrames, startTime);
+}
+
+void IPlugAPP::AppProcess(float** inputs, float** outputs, int nFrames, double startTime)
+{
+  ProcessAppBlock(inputs, outputs, nFrames, startTime);
+}
+
+void IPlugAPP::ProcessDriverMidiMsg(const IMidiMsg& msg)
+{
+  ProcessMidiMsg(msg);
+  mMidiMsgsFromProcessor.Push(msg); // queue incoming MIDI for UI
+}
+
+void IPlugAPP::ProcessDriverSysEx(const ISysEx& msg)
+{
+  ISysEx msgCopy = msg;
+  ProcessSysEx(msgCopy);
+  mSysExDataFromProcessor.Push(msg); // queue incoming Sysex for UI
+}
+
+template <typename T>
+void IPlugAPP::ProcessAppBlock(T** inputs, T** outputs, int nFrames, double startTime)
 {
+  IDenormalScope denormalScope(GetDenormalMode(), GetDenormalBlockCounter());
+
   SetChannelConnections(ERoute::kInput, 0, MaxNChannels(ERoute::kInput), !IsInstrument()); //TODO: go elsewhere - enable inputs
   SetChannelConnections(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), true); //TODO: go elsewhere
-  AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), inputs, GetBlockSize());
-  AttachBuffers(ERoute::kOutput, 0, NChannelsConnected(ERoute::kOutput), outputs, GetBlockSize());
+  AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), inputs, nFrames);
+  AttachBuffers(ERoute::kOutput, 0, NChannelsConnected(ERoute::kOutput), outputs, nFrames);
   
-  if(mMidiMsgsFromCallback.ElementsAvailable())
-  {
-    IMidiMsg msg;
-    
-    while (mMidiMsgsFromCallback.Pop(msg))
-    {
+  mMidiInput.Deliver(nFrames, startTime, GetSampleRate(),
+    [this](IMidiMsg& msg) {
       ProcessMidiMsg(msg);
       mMidiMsgsFromProcessor.Push(msg); // queue incoming MIDI for UI
-    }
-  }
-  
-  if(mSysExMsgsFromCallback.ElementsAvailable())
-  {
-    SysExData data;
-    
-    while (mSysExMsgsFromCallback.Pop(data))
-    {
-      ISysEx msg { data.mOffset, data.mData, data.mSize };
+    },
+    [this](ISysEx& msg) {
       ProcessSysEx(msg);
-      mSysExDataFromProcessor.Push(data); // queue incoming Sysex for UI
-    }
-  }
+      mSysExDataFromProcessor.Push(msg); // queue incoming Sysex for UI
+    });
   
   if(mMidiMsgsFromEditor.ElementsAvailable())
   {
@@ -182,6 +201,6 @@ void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
   //Do not handle Sysex messages here - SendSysexMsgFromUI overridden
 
   ENTER_PARAMS_MUTEX
-  ProcessBuffers(0.0, GetBlockSize());
+  ProcessBuffers((T) 0, nFrames);
   LEAVE_PARAMS_MUTEX
 }
@@ -20,6 +20,7 @@
 #include "IPlugPlatform.h"
 #include "IPlugAPIBase.h"
 #include "IPlugProcessor.h"
+#include "IPlugAPP_midiin.h"
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -53,18 +54,36 @@ public:
   bool SendSysEx(const ISysEx& msg) override;
   
   //IPlugAPP
-  void AppProcess(double** inputs, double** outputs, int nFrames);
+  /** Process a block of audio, delivering queued MIDI input at sample offsets derived from the messages' arrival times
+   * @param inputs The input buffers
+   * @param outputs The output buffers
+   * @param nFrames The number of frames to process
+   * @param startTime The time in seconds on the MIDI clock that the first frame of this block represents. MIDI that arrived before this is processed at offset 0, MIDI that arrived after the end of the block is left in the queue */
+  void AppProcess(double** inputs, double** outputs, int nFrames, double startTime);
+  
+  /** Single precision version of AppProcess(), used by driver backends that provide float buffers (JACK).
+   * If the plug-in is compiled with SAMPLE_TYPE_FLOAT the buffers are processed in place, otherwise they are converted by IPlugProcessor */
+  void AppProcess(float** inputs, float** outputs, int nFrames, double startTime);
 
 private:
+  template <typename T>
+  void ProcessAppBlock(T** inputs, T** outputs, int nFrames, double startTime);
+  
+  /** Called by driver backends that deliver sample accurate MIDI (JACK), before AppProcess() for the same block. The message is also queued for the UI */
+  void ProcessDriverMidiMsg(const IMidiMsg& msg);
+  
+  /** Called by driver backends that deliver sample accurate SysEx (JACK), before AppProcess() for the same block. The message is also queued for the UI */
+  void ProcessDriverSysEx(const ISysEx& msg);
+  
   IPlugAPPHost* mAppHost = nullptr;
-  IPlugQueue<IMidiMsg> mMidiMsgsFromCallback {MIDI_TRANSFER_SIZE};
-  IPlugQueue<SysExData> mSysExMsgsFromCallback {SYSEX_TRANSFER_SIZE};
+  IPlugAPPMidiInput mMidiInput; // from the RtMidi callback
 #ifdef OS_LINUX
   std::unique_ptr<Timer> mResizeTimer;
   bool mNeedResize = false;
 #endif
 
   friend class IPlugAPPHost;
+  friend class IPlugAPPJackClient;
 };
 
 IPlugAPP* MakePlug(const InstanceInfo& info);
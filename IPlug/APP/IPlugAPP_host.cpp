@@ -8,6 +8,8 @@
  ==============================================================================
 */
 
+#include <chrono>
+
 #include "IPlugAPP_host.h"
 
 #ifdef OS_WIN
@@ -407,6 +409,11 @@ bool IPlugAPPHost::TryToChangeAudio()
   int inputID = -1;
   int outputID = -1;
 
+#ifdef APP_NATIVE_JACK
+  if(mState.mAudioDriverType == kDeviceJack)
+    return InitJack();
+#endif
+
 #if defined OS_WIN
   if(mState.mAudioDriverType == kDeviceASIO)
     inputID = GetAudioDeviceIdx(mState.mAudioOutDev.Get());
@@ -561,6 +568,14 @@ bool IPlugAPPHost::SelectMIDIDevice(ERoute direction, const char* pPortName)
 
 void IPlugAPPHost::CloseAudio()
 {
+#ifdef APP_NATIVE_JACK
+  if (mJackClient)
+  {
+    mJackClient->Close();
+    mJackClient = nullptr;
+  }
+#endif
+
   if (mDAC && mDAC->isStreamOpen())
   {
     if (mDAC->isStreamRunning())
@@ -606,8 +621,10 @@ bool IPlugAPPHost::InitAudio(uint32_t inId, uint32_t outId, uint32_t sr, uint32_
   options.flags = RTAUDIO_NONINTERLEAVED;
   // options.streamName = BUNDLE_NAME; // JACK stream name, not used on other streams
 
-  mBufIndex = 0;
+  mFIFOIndex = 0;
+  mUseFIFO = false;
   mSamplesElapsed = 0;
+  mStreamClock.Reset();
   mSampleRate = (double) sr;
   mVecWait = 0;
   mAudioEnding = false;
@@ -621,6 +638,9 @@ bool IPlugAPPHost::InitAudio(uint32_t inId, uint32_t outId, uint32_t sr, uint32_
   {
     mDAC->openStream(&oParams, iParams.nChannels > 0 ? &iParams : nullptr, RTAUDIO_FLOAT64, sr, &mBufferSize, &AudioCallback, this, &options /*, &ErrorCallback */);
     
+    mInputBufPtrs.Empty();
+    mOutputBufPtrs.Empty();
+    
     for (int i = 0; i < iParams.nChannels; i++)
     {
       mInputBufPtrs.Add(nullptr); //will be set in callback
@@ -631,6 +651,12 @@ bool IPlugAPPHost::InitAudio(uint32_t inId, uint32_t outId, uint32_t sr, uint32_
       mOutputBufPtrs.Add(nullptr); //will be set in callback
     }
     
+    // only used if the buffer size is not a multiple of APP_SIGNAL_VECTOR_SIZE
+    mInputFIFO.Resize(iParams.nChannels * APP_SIGNAL_VECTOR_SIZE);
+    mOutputFIFO.Resize(oParams.nChannels * APP_SIGNAL_VECTOR_SIZE);
+    memset(mInputFIFO.Get(), 0, mInputFIFO.GetSize() * sizeof(double));
+    memset(mOutputFIFO.Get(), 0, mOutputFIFO.GetSize() * sizeof(double));
+    
     mDAC->startStream();
 
     mActiveState = mState;
@@ -644,6 +670,26 @@ bool IPlugAPPHost::InitAudio(uint32_t inId, uint32_t outId, uint32_t sr, uint32_
   return true;
 }
 
+#ifdef APP_NATIVE_JACK
+bool IPlugAPPHost::InitJack()
+{
+  CloseAudio();
+  
+  mJackClient = std::make_unique<IPlugAPPJackClient>(*mIPlug);
+  
+  if (!mJackClient->Open(BUNDLE_NAME))
+  {
+    mJackClient = nullptr;
+    return false;
+  }
+  
+  mSampleRate = mJackClient->GetSampleRate();
+  mActiveState = mState;
+  
+  return true;
+}
+#endif
+
 bool IPlugAPPHost::InitMidi()
 {
   try
@@ -680,6 +726,8 @@ bool IPlugAPPHost::InitMidi()
 
 void ApplyFades(double *pBuffer, int nChans, int nFrames, bool down)
 {
+  const double step = 1. / (double) nFrames;
+  
   for (int i = 0; i < nChans; i++)
   {
     double *pIO = pBuffer + (i * nFrames);
@@ -687,16 +735,87 @@ void ApplyFades(double *pBuffer, int nChans, int nFrames, bool down)
     if (down)
     {
       for (int j = 0; j < nFrames; j++)
-        pIO[j] *= ((double) (nFrames - (j + 1)) / (double) nFrames);
+        pIO[j] *= (double) (nFrames - (j + 1)) * step;
     }
     else
     {
       for (int j = 0; j < nFrames; j++)
-        pIO[j] *= ((double) j / (double) nFrames);
+        pIO[j] *= (double) j * step;
     }
   }
 }
 
+void ApplyGain(double *pBuffer, int nSamples, double gain)
+{
+  for (int i = 0; i < nSamples; i++)
+    pBuffer[i] *= gain;
+}
+
+void IPlugAPPHost::ProcessInPlace(double* pInputBuffer, double* pOutputBuffer, uint32_t nFrames, double startTime)
+{
+  const int nins = mInputBufPtrs.GetSize();
+  const int nouts = mOutputBufPtrs.GetSize();
+  
+  for (uint32_t i = 0; i < nFrames; i += APP_SIGNAL_VECTOR_SIZE)
+  {
+    for (int c = 0; c < nins; c++)
+      mInputBufPtrs.Set(c, pInputBuffer + (c * nFrames) + i);
+    
+    for (int c = 0; c < nouts; c++)
+      mOutputBufPtrs.Set(c, pOutputBuffer + (c * nFrames) + i);
+    
+    mIPlug->AppProcess(mInputBufPtrs.GetList(), mOutputBufPtrs.GetList(), APP_SIGNAL_VECTOR_SIZE, startTime + (i / mSampleRate));
+    
+    mSamplesElapsed += APP_SIGNAL_VECTOR_SIZE;
+  }
+}
+
+void IPlugAPPHost::ProcessThroughFIFO(double* pInputBuffer, double* pOutputBuffer, uint32_t nFrames, double startTime)
+{
+  const uint32_t vs = APP_SIGNAL_VECTOR_SIZE;
+  const int nins = mInputBufPtrs.GetSize();
+  const int nouts = mOutputBufPtrs.GetSize();
+  double* pInputFIFO = mInputFIFO.Get();
+  double* pOutputFIFO = mOutputFIFO.Get();
+  uint32_t pos = 0;
+  
+  while (pos < nFrames)
+  {
+    // copy as many frames as fit in the FIFO: input goes in, output processed during an earlier chunk comes out
+    const uint32_t n = std::min(nFrames - pos, vs - mFIFOIndex);
+    
+    for (int c = 0; c < nins; c++)
+      memcpy(pInputFIFO + (c * vs) + mFIFOIndex, pInputBuffer + (c * nFrames) + pos, n * sizeof(double));
+    
+    for (int c = 0; c < nouts; c++)
+      memcpy(pOutputBuffer + (c * nFrames) + pos, pOutputFIFO + (c * vs) + mFIFOIndex, n * sizeof(double));
+    
+    pos += n;
+    mFIFOIndex += n;
+    
+    if (mFIFOIndex == vs)
+    {
+      for (int c = 0; c < nins; c++)
+        mInputBufPtrs.Set(c, pInputFIFO + (c * vs));
+      
+      for (int c = 0; c < nouts; c++)
+        mOutputBufPtrs.Set(c, pOutputFIFO + (c * vs));
+      
+      // the chunk's input started vs frames before the current position, which may be in the previous buffer
+      mIPlug->AppProcess(mInputBufPtrs.GetList(), mOutputBufPtrs.GetList(), vs, startTime + (((double) pos - vs) / mSampleRate));
+      
+      mSamplesElapsed += vs;
+      mFIFOIndex = 0;
+    }
+  }
+}
+
+// static
+double IPlugAPPHost::GetMIDIClockTime()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 // static
 int IPlugAPPHost::AudioCallback(void* pOutputBuffer, void* pInputBuffer, uint32_t nFrames, double streamTime, RtAudioStreamStatus status, void* pUserData)
 {
@@ -711,39 +830,26 @@ int IPlugAPPHost::AudioCallback(void* pOutputBuffer, void* pInputBuffer, uint32_
   bool startWait = _this->mVecWait >= APP_N_VECTOR_WAIT; // wait APP_N_VECTOR_WAIT * iovs before processing audio, to avoid clicks
   bool doFade = _this->mVecWait == APP_N_VECTOR_WAIT || _this->mAudioEnding;
   
+  // Map this buffer onto the MIDI clock, so that MIDI input is played back with a constant latency of one buffer
+  const double blockStartTime = _this->mStreamClock.BlockStartTime(GetMIDIClockTime(), streamTime, nFrames, _this->mSampleRate, (status & RTAUDIO_OUTPUT_UNDERFLOW) != 0);
+  
   if (startWait && !_this->mAudioDone)
   {
     if (doFade)
       ApplyFades(pInputBufferD, nins, nFrames, _this->mAudioEnding);
     
-    for (int i = 0; i < nFrames; i++)
-    {
-      _this->mBufIndex %= APP_SIGNAL_VECTOR_SIZE;
-
-      if (_this->mBufIndex == 0)
-      {
-        for (int c = 0; c < nins; c++)
-        {
-          _this->mInputBufPtrs.Set(c, (pInputBufferD + (c * nFrames)) + i);
-        }
-        
-        for (int c = 0; c < nouts; c++)
-        {
-          _this->mOutputBufPtrs.Set(c, (pOutputBufferD + (c * nFrames)) + i);
-        }
-        
-        _this->mIPlug->AppProcess(_this->mInputBufPtrs.GetList(), _this->mOutputBufPtrs.GetList(), APP_SIGNAL_VECTOR_SIZE);
-
-        _this->mSamplesElapsed += APP_SIGNAL_VECTOR_SIZE;
-      }
-      
-      for (int c = 0; c < nouts; c++)
-      {
-        pOutputBufferD[c * nFrames + i] *= APP_MULT;
-      }
-
-      _this->mBufIndex++;
-    }
+    // Whole signal vectors are processed directly on RtAudio's buffers. If the buffer size is not a multiple of the signal vector size,
+    // we switch to going through a FIFO for the rest of the stream, which adds one signal vector of latency
+    if (!_this->mUseFIFO && (nFrames % APP_SIGNAL_VECTOR_SIZE) != 0)
+      _this->mUseFIFO = true;
+    
+    if (_this->mUseFIFO)
+      _this->ProcessThroughFIFO(pInputBufferD, pOutputBufferD, nFrames, blockStartTime);
+    else
+      _this->ProcessInPlace(pInputBufferD, pOutputBufferD, nFrames, blockStartTime);
+    
+    if (APP_MULT != 1.)
+      ApplyGain(pOutputBufferD, nouts * nFrames, APP_MULT); // non-interleaved channels are contiguous, so this is a single span
     
     if (doFade)
       ApplyFades(pOutputBufferD, nouts, nFrames, _this->mAudioEnding);
@@ -769,28 +875,7 @@ void IPlugAPPHost::MIDICallback(double deltatime, std::vector<uint8_t>* pMsg, vo
   if (pMsg->size() == 0 || _this->mExiting)
     return;
   
-  if (pMsg->size() > 3)
-  {
-    if(pMsg->size() > MAX_SYSEX_SIZE)
-    {
-      DBGMSG("SysEx message exceeds MAX_SYSEX_SIZE\n");
-      return;
-    }
-    
-    SysExData data { 0, static_cast<int>(pMsg->size()), pMsg->data() };
-    
-    _this->mIPlug->mSysExMsgsFromCallback.Push(data);
-    return;
-  }
-  else if (pMsg->size())
-  {
-    IMidiMsg msg;
-    msg.mStatus = pMsg->at(0);
-    pMsg->size() > 1 ? msg.mData1 = pMsg->at(1) : msg.mData1 = 0;
-    pMsg->size() > 2 ? msg.mData2 = pMsg->at(2) : msg.mData2 = 0;
-
-    _this->mIPlug->mMidiMsgsFromCallback.Push(msg);
-  }
+  _this->mIPlug->mMidiInput.Add(pMsg->data(), static_cast<int>(pMsg->size()), GetMIDIClockTime());
 }
 
 // static
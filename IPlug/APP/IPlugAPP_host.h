@@ -64,6 +64,10 @@
 #include "RtAudio.h"
 #include "RtMidi.h"
 
+#ifdef APP_NATIVE_JACK
+#include "IPlugAPP_jack.h"
+#endif
+
 #define OFF_TEXT "off"
 
 extern HWND gHWND;
@@ -204,6 +208,10 @@ public:
   bool InitMidi();
   void CloseAudio();
   bool InitAudio(uint32_t inId, uint32_t outId, uint32_t sr, uint32_t iovs);
+#ifdef APP_NATIVE_JACK
+  /** Start processing with a native JACK client rather than through RtAudio. The JACK server determines the sample rate and buffer size */
+  bool InitJack();
+#endif
   bool AudioSettingsInStateAreEqual(AppState& os, AppState& ns);
   bool MIDISettingsInStateAreEqual(AppState& os, AppState& ns);
 
@@ -211,6 +219,15 @@ public:
   bool TryToChangeAudio();
   bool SelectMIDIDevice(ERoute direction, const char* portName);
   
+  /** Process a host buffer whose size is a multiple of APP_SIGNAL_VECTOR_SIZE, in whole signal vectors directly on the RtAudio buffers */
+  void ProcessInPlace(double* pInputBuffer, double* pOutputBuffer, uint32_t nFrames, double startTime);
+  
+  /** Process a host buffer of any size via a signal vector sized FIFO, which adds APP_SIGNAL_VECTOR_SIZE frames of latency */
+  void ProcessThroughFIFO(double* pInputBuffer, double* pOutputBuffer, uint32_t nFrames, double startTime);
+  
+  /** @return The current time in seconds on the monotonic clock used to timestamp MIDI input */
+  static double GetMIDIClockTime();
+  
   static int AudioCallback(void* pOutputBuffer, void* pInputBuffer, uint32_t nFrames, double streamTime, RtAudioStreamStatus status, void* pUserData);
   static void MIDICallback(double deltatime, std::vector<uint8_t>* pMsg, void* pUserData);
   static void ErrorCallback(RtAudioError::Type type, const std::string& errorText);
@@ -224,6 +241,9 @@ private:
   std::unique_ptr<RtAudio> mDAC = nullptr;
   std::unique_ptr<RtMidiIn> mMidiIn = nullptr;
   std::unique_ptr<RtMidiOut> mMidiOut = nullptr;
+#ifdef APP_NATIVE_JACK
+  std::unique_ptr<IPlugAPPJackClient> mJackClient = nullptr;
+#endif
   int mMidiOutChannel = -1;
   int mMidiInChannel = -1;
   
@@ -238,7 +258,9 @@ private:
   uint32_t mSamplesElapsed = 0;
   uint32_t mVecWait = 0;
   uint32_t mBufferSize = 512;
-  uint32_t mBufIndex = 0; // index for signal vector, loops from 0 to mSigVS
+  uint32_t mFIFOIndex = 0; // write/read position in the FIFOs, loops from 0 to APP_SIGNAL_VECTOR_SIZE
+  bool mUseFIFO = false; // set if the host buffer size is not a multiple of APP_SIGNAL_VECTOR_SIZE
+  IPlugAPPStreamClock mStreamClock; // maps RtAudio's stream time onto the MIDI clock
   bool mExiting = false;
   bool mAudioEnding = false;
   bool mAudioDone = false;
@@ -258,6 +280,8 @@ private:
   
   WDL_PtrList<double> mInputBufPtrs;
   WDL_PtrList<double> mOutputBufPtrs;
+  WDL_TypedBuf<double> mInputFIFO; // non-interleaved, APP_SIGNAL_VECTOR_SIZE frames per channel
+  WDL_TypedBuf<double> mOutputFIFO;
 
 #ifdef OS_LINUX
   /** Site for embedding plug-in */
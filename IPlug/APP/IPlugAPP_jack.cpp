@@ -0,0 +1,286 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#include "IPlugAPP_jack.h"
+#include "IPlugAPP_host.h"
+
+using namespace iplug;
+
+// Set while a client is running the plug-in on the JACK process thread, so that SendMidiMsg() can tell if it is being called from there
+static thread_local IPlugAPPJackClient* sProcessingClient = nullptr;
+
+IPlugAPPJackClient::IPlugAPPJackClient(IPlugAPP& plug)
+: mPlug(plug)
+{
+}
+
+IPlugAPPJackClient::~IPlugAPPJackClient()
+{
+  Close();
+}
+
+bool IPlugAPPJackClient::Open(const char* clientName, bool autoConnect)
+{
+  Close();
+
+  jack_status_t status;
+  mClient = jack_client_open(clientName, JackNoStartServer, &status);
+
+  if (!mClient)
+  {
+    DBGMSG("jack_client_open() failed, status = 0x%2.0x\n", status);
+    return false;
+  }
+
+  mServerShutdown = false;
+
+  const int nIns = mPlug.MaxNChannels(ERoute::kInput);
+  const int nOuts = mPlug.MaxNChannels(ERoute::kOutput);
+  char portName[32];
+
+  for (int i = 0; i < nIns; i++)
+  {
+    snprintf(portName, sizeof(portName), "in_%i", i + 1);
+    mInputPorts.Add(jack_port_register(mClient, portName, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0));
+  }
+
+  for (int i = 0; i < nOuts; i++)
+  {
+    snprintf(portName, sizeof(portName), "out_%i", i + 1);
+    mOutputPorts.Add(jack_port_register(mClient, portName, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0));
+  }
+
+  if (mPlug.DoesMIDIIn())
+    mMidiInPort = jack_port_register(mClient, "midi_in", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput, 0);
+
+  if (mPlug.DoesMIDIOut())
+    mMidiOutPort = jack_port_register(mClient, "midi_out", JACK_DEFAULT_MIDI_TYPE, JackPortIsOutput, 0);
+
+  mInputPtrs.Resize(nIns);
+  mOutputPtrs.Resize(nOuts);
+
+  mSampleRate = (double) jack_get_sample_rate(mClient);
+  const int blockSize = (int) jack_get_buffer_size(mClient);
+
+  mMidiOutputQueue.Resize(blockSize);
+  mPlug.SetSampleRate(mSampleRate);
+  mPlug.SetBlockSize(blockSize);
+  mPlug.OnReset();
+
+  jack_set_process_callback(mClient, ProcessCallback, this);
+  jack_set_buffer_size_callback(mClient, BufferSizeCallback, this);
+  jack_set_sample_rate_callback(mClient, SampleRateCallback, this);
+  jack_on_shutdown(mClient, ShutdownCallback, this);
+
+  if (jack_activate(mClient))
+  {
+    DBGMSG("jack_activate() failed\n");
+    Close();
+    return false;
+  }
+
+  if (autoConnect)
+    ConnectToPhysicalPorts();
+
+  return true;
+}
+
+void IPlugAPPJackClient::Close()
+{
+  if (mClient)
+  {
+    if (!mServerShutdown)
+      jack_deactivate(mClient);
+
+    jack_client_close(mClient);
+    mClient = nullptr;
+  }
+
+  mInputPorts.Empty();
+  mOutputPorts.Empty();
+  mMidiInPort = nullptr;
+  mMidiOutPort = nullptr;
+}
+
+bool IPlugAPPJackClient::SendMidiMsg(const IMidiMsg& msg)
+{
+  if (sProcessingClient != this || !mMidiOutPort)
+    return false;
+
+  mMidiOutputQueue.Add(msg);
+  return true;
+}
+
+void IPlugAPPJackClient::ConnectToPhysicalPorts()
+{
+  // our inputs are fed from physical capture ports, which are JACK outputs
+  const char** pCapturePorts = jack_get_ports(mClient, nullptr, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsOutput);
+
+  if (pCapturePorts)
+  {
+    for (int i = 0; i < mInputPorts.GetSize() && pCapturePorts[i]; i++)
+      jack_connect(mClient, pCapturePorts[i], jack_port_name(mInputPorts.Get(i)));
+
+    jack_free(pCapturePorts);
+  }
+
+  const char** pPlaybackPorts = jack_get_ports(mClient, nullptr, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsInput);
+
+  if (pPlaybackPorts)
+  {
+    for (int i = 0; i < mOutputPorts.GetSize() && pPlaybackPorts[i]; i++)
+      jack_connect(mClient, jack_port_name(mOutputPorts.Get(i)), pPlaybackPorts[i]);
+
+    jack_free(pPlaybackPorts);
+  }
+}
+
+void IPlugAPPJackClient::UpdateTimeInfo()
+{
+  jack_position_t pos;
+  const jack_transport_state_t state = jack_transport_query(mClient, &pos);
+
+  mTimeInfo.mSamplePos = (double) pos.frame;
+  mTimeInfo.mTransportIsRunning = (state == JackTransportRolling);
+
+  if (pos.valid & JackPositionBBT)
+  {
+    mTimeInfo.mTempo = pos.beats_per_minute;
+    mTimeInfo.mNumerator = (int) pos.beats_per_bar;
+    mTimeInfo.mDenominator = (int) pos.beat_type;
+
+    // JACK counts bars and beats from 1, and beats in units of beat_type, whereas PPQ positions are in quarter notes
+    const double quartersPerBeat = 4. / pos.beat_type;
+    const double barStartBeats = (pos.bar - 1) * pos.beats_per_bar;
+    const double beats = barStartBeats + (pos.beat - 1) + (pos.tick / pos.ticks_per_beat);
+
+    mTimeInfo.mLastBar = barStartBeats * quartersPerBeat;
+    mTimeInfo.mPPQPos = beats * quartersPerBeat;
+  }
+  else
+  {
+    // no timebase master, so derive a musical position from the frame count at the current tempo
+    mTimeInfo.mPPQPos = (pos.frame / mSampleRate) * (mTimeInfo.mTempo / 60.);
+    mTimeInfo.mLastBar = -1.;
+  }
+}
+
+void IPlugAPPJackClient::ProcessMidiIn(jack_nframes_t nFrames)
+{
+  void* pBuffer = jack_port_get_buffer(mMidiInPort, nFrames);
+  const uint32_t nEvents = jack_midi_get_event_count(pBuffer);
+
+  for (uint32_t i = 0; i < nEvents; i++)
+  {
+    jack_midi_event_t event;
+
+    if (jack_midi_event_get(&event, pBuffer, i))
+      continue;
+
+    if (event.size == 0)
+      continue;
+
+    if (event.buffer[0] == 0xF0)
+    {
+      // the data stays valid for the duration of the process callback, so no copy is needed
+      mPlug.ProcessDriverSysEx(ISysEx((int) event.time, event.buffer, (int) event.size));
+    }
+    else if (event.size <= 3)
+    {
+      IMidiMsg msg((int) event.time, event.buffer[0], event.size > 1 ? event.buffer[1] : 0, event.size > 2 ? event.buffer[2] : 0);
+      mPlug.ProcessDriverMidiMsg(msg);
+    }
+  }
+}
+
+void IPlugAPPJackClient::ProcessMidiOut(jack_nframes_t nFrames)
+{
+  void* pBuffer = jack_port_get_buffer(mMidiOutPort, nFrames);
+  jack_midi_clear_buffer(pBuffer);
+
+  // IMidiQueue keeps messages sorted by offset, which is the order JACK requires
+  while (!mMidiOutputQueue.Empty())
+  {
+    const IMidiMsg& msg = mMidiOutputQueue.Peek();
+
+    if (msg.mOffset >= (int) nFrames)
+      break;
+
+    const jack_midi_data_t data[3] = { msg.mStatus, msg.mData1, msg.mData2 };
+    const int size = msg.Size();
+    if (size)
+      jack_midi_event_write(pBuffer, (jack_nframes_t) std::max(msg.mOffset, 0), data, size);
+    mMidiOutputQueue.Remove();
+  }
+
+  mMidiOutputQueue.Flush(nFrames);
+}
+
+void IPlugAPPJackClient::Process(jack_nframes_t nFrames)
+{
+  for (int i = 0; i < mInputPorts.GetSize(); i++)
+    mInputPtrs.Get()[i] = static_cast<float*>(jack_port_get_buffer(mInputPorts.Get(i), nFrames));
+
+  for (int i = 0; i < mOutputPorts.GetSize(); i++)
+    mOutputPtrs.Get()[i] = static_cast<float*>(jack_port_get_buffer(mOutputPorts.Get(i), nFrames));
+
+  UpdateTimeInfo();
+  mPlug.SetTimeInfo(mTimeInfo);
+
+  if (mMidiInPort)
+    ProcessMidiIn(nFrames);
+
+  sProcessingClient = this;
+
+  // MIDI from RtMidi is mapped onto this block with one buffer of latency, as in the RtAudio callback
+  const double startTime = IPlugAPPHost::GetMIDIClockTime() - (nFrames / mSampleRate);
+  mPlug.AppProcess(mInputPtrs.Get(), mOutputPtrs.Get(), (int) nFrames, startTime);
+
+  sProcessingClient = nullptr;
+
+  if (mMidiOutPort)
+    ProcessMidiOut(nFrames);
+}
+
+// static
+int IPlugAPPJackClient::ProcessCallback(jack_nframes_t nFrames, void* pUserData)
+{
+  IPlugAPPJackClient* _this = static_cast<IPlugAPPJackClient*>(pUserData);
+  _this->Process(nFrames);
+  return 0;
+}
+
+// static
+int IPlugAPPJackClient::BufferSizeCallback(jack_nframes_t nFrames, void* pUserData)
+{
+  // JACK does not call the process callback concurrently with this
+  IPlugAPPJackClient* _this = static_cast<IPlugAPPJackClient*>(pUserData);
+  _this->mMidiOutputQueue.Resize((int) nFrames);
+  _this->mPlug.SetBlockSize((int) nFrames);
+  _this->mPlug.OnReset();
+  return 0;
+}
+
+// static
+int IPlugAPPJackClient::SampleRateCallback(jack_nframes_t sampleRate, void* pUserData)
+{
+  IPlugAPPJackClient* _this = static_cast<IPlugAPPJackClient*>(pUserData);
+  _this->mSampleRate = (double) sampleRate;
+  _this->mPlug.SetSampleRate(_this->mSampleRate);
+  _this->mPlug.OnReset();
+  return 0;
+}
+
+// static
+void IPlugAPPJackClient::ShutdownCallback(void* pUserData)
+{
+  IPlugAPPJackClient* _this = static_cast<IPlugAPPJackClient*>(pUserData);
+  _this->mServerShutdown = true;
+}
@@ -0,0 +1,94 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugAPPJackClient
+ */
+
+#include <atomic>
+
+#include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/transport.h>
+
+#include "ptrlist.h"
+
+#include "IPlugPlatform.h"
+#include "IPlugMidi.h"
+#include "IPlugStructs.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+class IPlugAPP;
+
+/** A JACK client that drives an IPlugAPP directly, as an alternative to going through RtAudio's JACK API.
+ * Audio is processed on JACK's float port buffers (in place if the plug-in is compiled with SAMPLE_TYPE_FLOAT), the JACK period is used as the block size,
+ * transport state is passed to the plug-in's ITimeInfo, and MIDI to/from JACK MIDI ports is sample accurate.
+ * The JACK server dictates the sample rate and buffer size, so the audio settings in the preferences dialog are ignored.
+ * Experimental: only compiled in (APP_NATIVE_JACK) when IPLUG_APP_JACK_NATIVE is switched on in CMake, which it isn't by default. */
+class IPlugAPPJackClient
+{
+public:
+  IPlugAPPJackClient(IPlugAPP& plug);
+  ~IPlugAPPJackClient();
+
+  IPlugAPPJackClient(const IPlugAPPJackClient&) = delete;
+  IPlugAPPJackClient& operator=(const IPlugAPPJackClient&) = delete;
+
+  /** Connect to a running JACK server, register ports and start processing
+   * @param clientName The JACK client name
+   * @param autoConnect If \c true connect the audio ports to the first physical capture/playback ports
+   * @return \c true on success */
+  bool Open(const char* clientName, bool autoConnect = true);
+
+  /** Stop processing and disconnect from the JACK server */
+  void Close();
+
+  /** @return \c true if the client is connected and the JACK server is still running */
+  bool IsRunning() const { return mClient != nullptr && !mServerShutdown; }
+
+  /** @return The JACK server's sample rate */
+  double GetSampleRate() const { return mSampleRate; }
+
+  /** Queue a MIDI message for the JACK MIDI output port. Only succeeds when called on the JACK process thread, while the plug-in is processing
+   * @param msg The message to send, with its offset in the current block
+   * @return \c true if the message was queued */
+  bool SendMidiMsg(const IMidiMsg& msg);
+
+private:
+  static int ProcessCallback(jack_nframes_t nFrames, void* pUserData);
+  static int BufferSizeCallback(jack_nframes_t nFrames, void* pUserData);
+  static int SampleRateCallback(jack_nframes_t sampleRate, void* pUserData);
+  static void ShutdownCallback(void* pUserData);
+
+  void Process(jack_nframes_t nFrames);
+  void ProcessMidiIn(jack_nframes_t nFrames);
+  void ProcessMidiOut(jack_nframes_t nFrames);
+  void UpdateTimeInfo();
+  void ConnectToPhysicalPorts();
+
+  IPlugAPP& mPlug;
+  jack_client_t* mClient = nullptr;
+  WDL_PtrList<jack_port_t> mInputPorts;
+  WDL_PtrList<jack_port_t> mOutputPorts;
+  jack_port_t* mMidiInPort = nullptr;
+  jack_port_t* mMidiOutPort = nullptr;
+  WDL_TypedBuf<float*> mInputPtrs;
+  WDL_TypedBuf<float*> mOutputPtrs;
+  IMidiQueue mMidiOutputQueue;
+  ITimeInfo mTimeInfo;
+  double mSampleRate = 0.;
+  std::atomic<bool> mServerShutdown {false};
+};
+
+END_IPLUG_NAMESPACE
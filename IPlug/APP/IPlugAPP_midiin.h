@@ -0,0 +1,207 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief The standalone app's MIDI input path: RtMidi's callback queues messages with their arrival times, and the audio callback
+ * maps each buffer onto the same clock to deliver them at sample offsets. It has no RtMidi or RtAudio dependencies, so that it can be tested on its own.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "IPlugPlatform.h"
+#include "IPlugConstants.h"
+#include "IPlugLogger.h"
+#include "IPlugMidi.h"
+#include "IPlugQueue.h"
+#include "IPlugSysExQueue.h"
+
+#ifndef APP_MIDI_INPUT_QUEUE_SIZE
+// Messages timed after the current block stay queued until the block they belong to, i.e. for up to one audio buffer, so the queue has to hold
+// a buffer's worth of input plus a burst (a chord, a controller sweep) arriving meanwhile. MIDI_TRANSFER_SIZE is too small for that
+#define APP_MIDI_INPUT_QUEUE_SIZE 1024
+#endif
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A MIDI message received by the standalone app's MIDI input callback, with its arrival time in seconds on a monotonic clock */
+struct TimestampedMidiMsg
+{
+  IMidiMsg mMsg;
+  double mTime;
+
+  TimestampedMidiMsg(const IMidiMsg& msg = IMidiMsg(), double time = 0.)
+  : mMsg(msg)
+  , mTime(time)
+  {}
+};
+
+/** Maps the audio callback's buffers onto the MIDI clock. The callback's wake-up time jitters, so rather than using the current time directly,
+ * it tracks the offset between the MIDI clock and the audio stream's time (which advances by exactly one buffer per callback) at the earliest wake-up.
+ * MIDI that arrived during the previous buffer period is then played back at proportional positions in the buffer, giving a constant latency of one buffer.
+ * The period has to end before the callback wakes up, or MIDI arriving in between would only be in the queue for the next buffer. The earliest wake-up
+ * is taken over the current and last windows of at least half a second, so that the offset follows any drift between the clocks. */
+class IPlugAPPStreamClock
+{
+public:
+  /** Start again with the next buffer, e.g. when the stream is restarted */
+  void Reset() { mOffsetValid = false; }
+
+  /** Called at the start of each audio callback
+   * @param clockTime The current time on the MIDI clock
+   * @param streamTime The stream time of the buffer's first frame
+   * @param nFrames The buffer size
+   * @param sampleRate The stream's sample rate
+   * @param underflow \c true if the stream has underflowed since the last buffer, which breaks the mapping
+   * @return The time on the MIDI clock that the buffer's first frame represents */
+  double BlockStartTime(double clockTime, double streamTime, uint32_t nFrames, double sampleRate, bool underflow)
+  {
+    const double bufferDuration = nFrames / sampleRate;
+    const double measuredOffset = clockTime - streamTime;
+
+    if (!mOffsetValid || std::fabs(measuredOffset - mOffset) > bufferDuration || underflow)
+    {
+      mOffsetMin = mOffsetLastMin = measuredOffset;
+      mOffsetCount = 0;
+      mOffsetValid = true;
+    }
+    else
+    {
+      mOffsetMin = std::min(mOffsetMin, measuredOffset);
+
+      if (++mOffsetCount >= std::max(32, static_cast<int>(0.5 / bufferDuration)))
+      {
+        mOffsetLastMin = mOffsetMin;
+        mOffsetMin = measuredOffset;
+        mOffsetCount = 0;
+      }
+    }
+
+    mOffset = std::min(mOffsetMin, mOffsetLastMin);
+
+    return streamTime + mOffset - bufferDuration;
+  }
+
+private:
+  double mOffset = 0.; // difference between the MIDI clock and the stream time at the earliest callback wake-up
+  double mOffsetMin = 0.; // the smallest difference in the current window of callbacks
+  double mOffsetLastMin = 0.; // and in the last one
+  int mOffsetCount = 0; // callbacks in the current window
+  bool mOffsetValid = false;
+};
+
+/** Queues the MIDI input the standalone app receives from RtMidi, from the MIDI callback thread to the audio thread */
+class IPlugAPPMidiInput
+{
+public:
+  /** Add a message as RtMidi delivers it: a short message, or a whole SysEx message or a piece of one, since large SysEx dumps may be
+   * delivered in several pieces. A SysEx message is passed on once its terminating 0xF7 has arrived. Called on the MIDI callback thread
+   * @param pData The message bytes
+   * @param size The number of bytes
+   * @param time The arrival time on the MIDI clock
+   * @return \c false if the message was dropped, because it is malformed or too large, or a queue is full */
+  bool Add(const uint8_t* pData, int size, double time)
+  {
+    if (size <= 0)
+      return false;
+
+    const uint8_t firstByte = pData[0];
+    const bool isSysExStart = firstByte == 0xF0;
+    const bool isSysExContinuation = mSysExMsgs.IsWriting() && (firstByte < 0x80 || firstByte == 0xF7);
+
+    if (isSysExStart || isSysExContinuation)
+    {
+      if (isSysExStart)
+        mSysExMsgs.Begin();
+
+      if (!mSysExMsgs.Append(pData, size))
+      {
+        DBGMSG("SysEx message exceeds SYSEX_TRANSFER_SIZE\n");
+        return false;
+      }
+
+      if (pData[size - 1] == 0xF7)
+        return mSysExMsgs.Commit();
+
+      return true;
+    }
+
+    mSysExMsgs.Abort(); // an unterminated SysEx message was interrupted
+
+    if (size > 3)
+      return false;
+
+    IMidiMsg msg;
+    msg.mStatus = pData[0];
+    msg.mData1 = size > 1 ? pData[1] : 0;
+    msg.mData2 = size > 2 ? pData[2] : 0;
+
+    if (!mMidiMsgs.Push(TimestampedMidiMsg(msg, time)))
+    {
+      DBGMSG("MIDI input queue full, increase APP_MIDI_INPUT_QUEUE_SIZE\n");
+      return false;
+    }
+
+    return true;
+  }
+
+  /** Deliver the queued messages that belong to a block, called on the audio thread before the block is processed.
+   * Short messages are delivered at the sample offsets of their arrival times, those that arrived before the block at offset 0,
+   * and those that arrived after the end of the block are left in the queue. SysEx messages are delivered straight away
+   * @param nFrames The number of frames in the block
+   * @param startTime The time on the MIDI clock that the block's first frame represents, see IPlugAPPStreamClock
+   * @param sampleRate The sample rate
+   * @param midiFunc Called with each IMidiMsg, its mOffset set
+   * @param sysExFunc Called with each ISysEx, which points into the queue and is only valid during the call */
+  template <typename MidiFunc, typename SysExFunc>
+  void Deliver(int nFrames, double startTime, double sampleRate, MidiFunc&& midiFunc, SysExFunc&& sysExFunc)
+  {
+    if (mMidiMsgs.ElementsAvailable())
+    {
+      TimestampedMidiMsg event;
+
+      while (mMidiMsgs.ElementsAvailable())
+      {
+        const int offset = static_cast<int>(std::floor((mMidiMsgs.Peek().mTime - startTime) * sampleRate));
+
+        if (offset >= nFrames)
+          break; // belongs to a later block
+
+        mMidiMsgs.Pop(event);
+        event.mMsg.mOffset = std::max(offset, 0);
+        midiFunc(event.mMsg);
+      }
+    }
+
+    if (!mSysExMsgs.WasEmpty())
+    {
+      ISysEx msg;
+
+      while (mSysExMsgs.Peek(msg))
+      {
+        sysExFunc(msg);
+        mSysExMsgs.Remove();
+      }
+    }
+  }
+
+  /** @return The number of short messages waiting to be delivered */
+  size_t NMidiMsgsQueued() const { return mMidiMsgs.ElementsAvailable(); }
+
+private:
+  IPlugQueue<TimestampedMidiMsg> mMidiMsgs {APP_MIDI_INPUT_QUEUE_SIZE};
+  IPlugSysExQueue mSysExMsgs {SYSEX_TRANSFER_SIZE};
+};
+
+END_IPLUG_NAMESPACE
@@ -1751,6 +1751,7 @@ OSStatus IPlugAU::RenderProc(void* pPlug, AudioUnitRenderActionFlags* pFlags, co
         }
       }
       
+      IDenormalScope denormalScope(_this->GetDenormalMode(), _this->GetDenormalBlockCounter());
       _this->PreProcess();
       ENTER_PARAMS_MUTEX_STATIC
       _this->ProcessBuffers((AudioSampleType) 0, nFrames);
@@ -2105,13 +2106,12 @@ bool IPlugAU::SendSysEx(const ISysEx& sysEx)
 void IPlugAU::OutputSysexFromEditor()
 {
   //Output SYSEX from the editor, which has bypassed ProcessSysEx()
-  if(mSysExDataFromEditor.ElementsAvailable())
+  ISysEx smsg;
+  
+  while (mSysExDataFromEditor.Peek(smsg))
   {
-    while (mSysExDataFromEditor.Pop(mSysexBuf))
-    {
-      ISysEx smsg {mSysexBuf.mOffset, mSysexBuf.mData, mSysexBuf.mSize};
-      SendSysEx(smsg);
-    }
+    SendSysEx(smsg);
+    mSysExDataFromEditor.Remove();
   }
 }
 
@@ -172,15 +172,18 @@ void IPlugAUv3::ProcessWithEvents(AudioTimeStamp const* pTimestamp, uint32_t fra
     }
   }
 
+  IDenormalScope denormalScope(GetDenormalMode(), GetDenormalBlockCounter());
   ENTER_PARAMS_MUTEX;
   ProcessBuffers(0.f, framesRemaining); // what about bufferOffset
   LEAVE_PARAMS_MUTEX;
     
   //Output SYSEX from the editor, which has bypassed ProcessSysEx()
-  while (mSysExDataFromEditor.Pop(mSysexBuf))
+  ISysEx smsg;
+  
+  while (mSysExDataFromEditor.Peek(smsg))
   {
-    ISysEx smsg {mSysexBuf.mOffset, mSysexBuf.mData, mSysexBuf.mSize};
     SendSysEx(smsg);
+    mSysExDataFromEditor.Remove();
   }
   
 
@@ -10,9 +10,17 @@
 
 #include "denormal.h"
 #include "IPlugConstants.h"
+#include "IPlugDenormals.h"
+
+// where IDenormalScope can't set flush-to-zero (e.g. WAM, since WebAssembly always keeps denormals), the smoothers flush them per sample
+#if !defined(IPLUG_DENORMALS_SSE) && !defined(IPLUG_DENORMALS_ARM)
+  #define IPLUG_SMOOTHERS_DENORMAL_FIX
+#endif
 
 BEGIN_IPLUG_NAMESPACE
 
+/** One pole smoother. When the target is zero the output decays through the denormal range; on SSE and ARM there is no per-sample
+ * denormal_fix() since the API classes flush denormals around ProcessBlock() (PLUG_DENORMAL_MODE kDenormalsFlush, the default) */
 template<typename T, int NC = 1>
 class LogParamSmooth
 {
@@ -35,7 +43,7 @@ public:
   inline T Process(T input)
   {
     mOutM1[0] = (input * mB) + (mOutM1[0] * mA);
-#ifndef OS_IOS
+#ifdef IPLUG_SMOOTHERS_DENORMAL_FIX
     denormal_fix(&mOutM1[0]);
 #endif
     return mOutM1[0];
@@ -75,7 +83,7 @@ public:
       for (auto c = 0; c < NC; c++)
       {
         T output = (inputs[channelOffset + c] * b) + (mOutM1[c] * a);
-#ifndef OS_IOS
+#ifdef IPLUG_SMOOTHERS_DENORMAL_FIX
         denormal_fix(&output);
 #endif
         mOutM1[c] = output;
@@ -34,6 +34,7 @@ public:
   void CloseWindow() override
   {
     CloseWebView();
+    IEditorDelegate::CloseWindow();
   }
 
   void SendControlValueFromDelegate(int ctrlTag, double normalizedValue) override
@@ -15,6 +15,7 @@
 
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <cassert>
 
@@ -42,6 +43,7 @@ IPlugAPIBase::IPlugAPIBase(Config c, EAPI plugAPI)
   Trace(TRACELOC, "%s:%s", c.pluginName, CurrentTime());
   
   mParamDisplayStr.Set("", MAX_PARAM_DISPLAY_LEN);
+  mParamChangeFromProcessor.Resize(NParams());
 }
 
 IPlugAPIBase::~IPlugAPIBase()
@@ -65,32 +67,85 @@ void IPlugAPIBase::OnHostRequestingImportantParameters(int count, WDL_TypedBuf<i
 
 void IPlugAPIBase::CreateTimer()
 {
+  // parameters may have been added after construction
+  if (mParamChangeFromProcessor.GetSize() != NParams())
+    mParamChangeFromProcessor.Resize(NParams());
+
 #if defined(OS_LINUX) && !defined(APP_API) && !defined(VST3_API)
   auto cb = [this](Timer& timer) { if (!HasUI()) { OnTimer(*mTimer); } };
-  mTimer = std::unique_ptr<Timer>(Timer::Create(cb, IDLE_TIMER_RATE));
+  auto isActive = [this]() { return IsIdleActive(); };
+  mTimer = std::unique_ptr<Timer>(Timer::CreateShared(cb, isActive, IDLE_TIMER_RATE, IDLE_TIMER_MAX_RATE));
 #elif defined(OS_LINUX) && defined(VST3_API)
   // Do nothing.
 #else
-  mTimer = std::unique_ptr<Timer>(Timer::Create(std::bind(&IPlugAPIBase::OnTimer, this, std::placeholders::_1), IDLE_TIMER_RATE));
+  // all instances in the process share one timer, and instances with nothing to do are only serviced every IDLE_TIMER_MAX_RATE ms
+  auto isActive = [this]() { return IsIdleActive(); };
+  mTimer = std::unique_ptr<Timer>(Timer::CreateShared(std::bind(&IPlugAPIBase::OnTimer, this, std::placeholders::_1), isActive, IDLE_TIMER_RATE, IDLE_TIMER_MAX_RATE));
 #endif
 }
 
+bool IPlugAPIBase::IsIdleActive() const
+{
+  if (!HasUI())
+    return false;
+
+  return IsUIOpen()
+      || mParamChangeFromProcessor.HasChanges()
+      || mMidiMsgsFromProcessor.ElementsAvailable()
+      || !mSysExDataFromProcessor.WasEmpty();
+}
+
 bool IPlugAPIBase::CompareState(const uint8_t* pIncomingState, int startPos) const
 {
-  bool isEqual = true;
-  
-  const double* data = (const double*) pIncomingState + startPos;
-  
+  const int nParams = NParams();
+  const uint32_t version = GetStateVersion();
+
+  // only re-read the parameters if something has changed since the last comparison
+  if (!mCompareStateValid || version != mCompareStateVersion || mCompareStateValues.GetSize() != nParams)
+  {
+    double* pValues = mCompareStateValues.Resize(nParams, false);
+
+    for (int i = 0; i < nParams; i++)
+      pValues[i] = GetParam(i)->Value();
+
+    mCompareStateVersion = version;
+    mCompareStateValid = true;
+  }
+
+  const uint8_t* pData = pIncomingState + startPos;
+  const double* pValues = mCompareStateValues.Get();
+
+  // skip the header of a packed state, the incoming data is at least as long as the values of an unpacked one
+  if (DoesPackedParamState() && nParams * (int) sizeof(double) >= 4 * (int) sizeof(int))
+  {
+    int header[4];
+    memcpy(header, pData, sizeof(header));
+    if (header[0] == IPLUG_PACKED_PARAMS_MAGIC && header[1] == IPLUG_PACKED_PARAMS_VERSION)
+    {
+      if (header[2] != nParams)
+        return false;
+      pData += sizeof(header);
+    }
+  }
+
+  // the common case is that the incoming state was serialized from the current one
+  if (memcmp(pData, pValues, nParams * sizeof(double)) == 0)
+    return true;
+
   // dirty hack here because protools treats param values as 32 bit int and in IPlug they are 64bit float
   // if we memcmp() the incoming state with the current they may have tiny differences due to the quantization
-  for (int i = 0; i < NParams(); i++)
+  bool isEqual = true;
+
+  for (int i = 0; i < nParams; i++)
   {
-    float v = (float) GetParam(i)->Value();
-    float vi = (float) *(data++);
-    
-    isEqual &= (std::fabs(v - vi) < 0.00001);
+    double incoming;
+    memcpy(&incoming, pData + i * sizeof(double), sizeof(double)); // the incoming data may not be aligned
+    const float v = (float) pValues[i];
+    const float vi = (float) incoming;
+
+    isEqual &= (std::fabs(v - vi) < 0.00001f);
   }
-  
+
   return isEqual;
 }
 
@@ -141,7 +196,7 @@ void IPlugAPIBase::SendParameterValueFromAPI(int paramIdx, double value, bool no
   if (normalized)
     value = GetParam(paramIdx)->FromNormalized(value);
   
-  mParamChangeFromProcessor.Push(ParamTuple { paramIdx, value } );
+  mParamChangeFromProcessor.Set(paramIdx, value);
 }
 
 void IPlugAPIBase::OnTimer(Timer& t)
@@ -161,24 +216,22 @@ void IPlugAPIBase::OnTimer(Timer& t)
 #endif
     }
 
-    while (mSysExDataFromProcessor.ElementsAvailable())
+    ISysEx msg;
+    
+    while (mSysExDataFromProcessor.Peek(msg))
     {
-      SysExData msg;
-      mSysExDataFromProcessor.Pop(msg);
 #ifdef VST3P_API // distributed
       TransmitSysExDataFromProcessor(msg);
 #else
-      SendSysexMsgFromDelegate({msg.mOffset, msg.mData, msg.mSize});
+      SendSysexMsgFromDelegate(msg);
 #endif
+      mSysExDataFromProcessor.Remove();
     }
 // !VST3 ******************************************************************************
 #else
-    while(mParamChangeFromProcessor.ElementsAvailable())
-    {
-      ParamTuple p;
-      mParamChangeFromProcessor.Pop(p);
-      SendParameterValueFromDelegate(p.idx, p.value, false);
-    }
+    mParamChangeFromProcessor.ForEachChanged([this](int paramIdx, double value) {
+      SendParameterValueFromDelegate(paramIdx, value, false);
+    });
     
     while (mMidiMsgsFromProcessor.ElementsAvailable())
     {
@@ -187,11 +240,12 @@ void IPlugAPIBase::OnTimer(Timer& t)
       SendMidiMsgFromDelegate(msg);
     }
     
-    while (mSysExDataFromProcessor.ElementsAvailable())
+    ISysEx msg;
+    
+    while (mSysExDataFromProcessor.Peek(msg))
     {
-      SysExData msg;
-      mSysExDataFromProcessor.Pop(msg);
-      SendSysexMsgFromDelegate({msg.mOffset, msg.mData, msg.mSize});
+      SendSysexMsgFromDelegate(msg);
+      mSysExDataFromProcessor.Remove();
     }
 #endif
   }
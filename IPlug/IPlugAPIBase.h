@@ -25,6 +25,8 @@
 #include "IPlugUtilities.h"
 #include "IPlugParameter.h"
 #include "IPlugQueue.h"
+#include "IPlugParamChangeSet.h"
+#include "IPlugSysExQueue.h"
 #include "IPlugTimer.h"
 
 /**
@@ -167,14 +169,17 @@ public:
   
   void DeferSysexMsg(const ISysEx& msg) override
   {
-    SysExData data(msg.mOffset, msg.mSize, msg.mData); // copies data
-    mSysExDataFromEditor.Push(data);
+    mSysExDataFromEditor.Push(msg); // copies data
   }
 
   /** Called by the API class to create the timer that pumps the parameter/message queues */
   void CreateTimer();
 
   void OnTimer(Timer& t);
+
+  /** @return \c true if the timer should call OnTimer() at the full IDLE_TIMER_RATE, because the UI is open or there is data waiting to be sent to it.
+   * A plug-in without a UI is never active, so its OnIdle() runs every IDLE_TIMER_MAX_RATE ms */
+  bool IsIdleActive() const;
   
 private:
   /** Implementations call into the APIs resize hooks
@@ -199,7 +204,7 @@ private:
   virtual void TransmitMidiMsgFromProcessor(const IMidiMsg& msg) {}
   
   /** \todo */
-  virtual void TransmitSysExDataFromProcessor(const SysExData& data) {}
+  virtual void TransmitSysExDataFromProcessor(const ISysEx& msg) {}
 
   friend class IPlugAPP;
   friend class IPlugAAX;
@@ -216,12 +221,16 @@ private:
   WDL_String mParamDisplayStr;
   std::unique_ptr<Timer> mTimer;
   
-  IPlugQueue<ParamTuple> mParamChangeFromProcessor {PARAM_TRANSFER_SIZE};
+  IPlugParamChangeSet mParamChangeFromProcessor; // the latest values of parameters changed by the host, to send to the editor
   IPlugQueue<IMidiMsg> mMidiMsgsFromEditor {MIDI_TRANSFER_SIZE}; // a queue of midi messages generated in the editor by clicking keyboard UI etc
   IPlugQueue<IMidiMsg> mMidiMsgsFromProcessor {MIDI_TRANSFER_SIZE}; // a queue of MIDI messages received (potentially on the high priority thread), by the processor to send to the editor
-  IPlugQueue<SysExData> mSysExDataFromEditor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the processor
-  IPlugQueue<SysExData> mSysExDataFromProcessor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the editor
-  SysExData mSysexBuf;
+  IPlugSysExQueue mSysExDataFromEditor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the processor
+  IPlugSysExQueue mSysExDataFromProcessor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the editor
+
+  // parameter values cached by CompareState(), refreshed when the state version changes
+  mutable WDL_TypedBuf<double> mCompareStateValues;
+  mutable uint32_t mCompareStateVersion = 0;
+  mutable bool mCompareStateValid = false;
 };
 
 END_IPLUG_NAMESPACE
@@ -112,18 +112,32 @@ static const int MAX_PARAM_DISPLAY_PRECISION = 6;
 #define IDLE_TIMER_RATE 20 // this controls the frequency of data going from processor to editor (and OnIdle calls)
 #endif
 
+#ifndef IDLE_TIMER_MAX_RATE
+// The longest interval between OnIdle calls when an instance is inactive: its editor is closed (or it has no UI) and there is no data to send to it.
+// When every instance is inactive, the shared idle timer backs off to this interval, which saves wakeups with many instances loaded.
+// OnIdle() of a plug-in without a UI always runs at this interval, define it as IDLE_TIMER_RATE to keep every instance at the full rate
+#define IDLE_TIMER_MAX_RATE 100
+#endif
+
 #ifndef MAX_SYSEX_SIZE
 #define MAX_SYSEX_SIZE 512
 #endif
 
+#ifndef SYSEX_TRANSFER_SIZE
+#define SYSEX_TRANSFER_SIZE 32768 // the size in bytes of the largest SysEx message that can be queued between threads. Several smaller messages share the same space
+#endif
+
 #define PARAM_TRANSFER_SIZE 512
 #define MIDI_TRANSFER_SIZE 32
-#define SYSEX_TRANSFER_SIZE 4
 
 // All version ints are stored as 0xVVVVRRMM: V = version, R = revision, M = minor revision.
 #define IPLUG_VERSION 0x010000
 #define IPLUG_VERSION_MAGIC 'pfft'
 
+// Marks a packed block of parameter values in a state chunk, see IPluginBase::SetPackedParamState()
+#define IPLUG_PACKED_PARAMS_MAGIC 'ppck'
+#define IPLUG_PACKED_PARAMS_VERSION 1
+
 static const int DEFAULT_BLOCK_SIZE = 1024;
 static const double DEFAULT_TEMPO = 120.0;
 static const int kNoParameter = -1;
@@ -188,6 +202,16 @@ enum EAPI
   kAPILV2 = 8
 };
 
+/** @enum EDenormalMode
+ * How the API classes set the floating point mode around each process callback, see IDenormalScope and PLUG_DENORMAL_MODE
+ */
+enum EDenormalMode
+{
+  kDenormalsHost = 0, // leave the mode the host is using
+  kDenormalsFlush, // flush denormals to zero (FTZ/DAZ), restoring the host's mode afterwards
+  kDenormalsCount // debug: leave the mode, but count the process calls in which denormals occur, see IPlugProcessor::GetDenormalBlockCount()
+};
+
 /** @enum EHost
  * Host identifier
  */
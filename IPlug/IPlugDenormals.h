@@ -0,0 +1,145 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IDenormalScope
+ */
+
+#include <atomic>
+
+#include "IPlugPlatform.h"
+#include "IPlugConstants.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <xmmintrin.h>
+  #define IPLUG_DENORMALS_SSE
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_FP))
+  #define IPLUG_DENORMALS_ARM
+#endif
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Sets the floating point mode of the calling thread for its lifetime, according to an EDenormalMode, and restores
+ * the previous mode (the host's) when it goes out of scope. The API classes put one around each process callback.
+ *
+ * kDenormalsFlush sets flush-to-zero and denormals-are-zero (SSE MXCSR FTZ|DAZ, ARM FPCR/FPSCR FZ), so code running in
+ * ProcessBlock() doesn't need per-sample fixes such as denormal_fix().
+ *
+ * kDenormalsCount leaves the mode as it is, clears the denormal status flags on entry and checks them on exit: each scope
+ * in which an operation used a denormal operand (SSE DE flag) adds one to the counter. ARM has no such flag without FZ,
+ * so there the underflow and input denormal flags (UFC, IDC) are used instead. The hardware flags are sticky, so this
+ * counts blocks that hit denormals rather than individual operations.
+ *
+ * On other targets (or with x87 floating point on 32 bit x86) all modes do nothing. */
+class IDenormalScope
+{
+public:
+  IDenormalScope(EDenormalMode mode, std::atomic<int>* pCount = nullptr)
+  : mMode(mode)
+  , mCount(pCount)
+  {
+#if defined(IPLUG_DENORMALS_SSE) || defined(IPLUG_DENORMALS_ARM)
+    if (mMode == kDenormalsHost)
+      return;
+
+    mOldState = GetState();
+    if (mMode == kDenormalsFlush)
+    {
+      if ((mOldState & kFlushBits) != kFlushBits)
+        SetState(mOldState | kFlushBits);
+    }
+    else
+    {
+      ClearFlags();
+    }
+#endif
+  }
+
+  ~IDenormalScope()
+  {
+#if defined(IPLUG_DENORMALS_SSE) || defined(IPLUG_DENORMALS_ARM)
+    if (mMode == kDenormalsHost)
+      return;
+
+    if (mMode == kDenormalsCount)
+    {
+      if (mCount && (GetFlags() & kDenormalFlags))
+        mCount->fetch_add(1, std::memory_order_relaxed);
+      RestoreFlags();
+    }
+    else if ((mOldState & kFlushBits) != kFlushBits)
+    {
+      SetState(mOldState);
+    }
+#endif
+  }
+
+  IDenormalScope(const IDenormalScope&) = delete;
+  IDenormalScope& operator=(const IDenormalScope&) = delete;
+
+private:
+#if defined(IPLUG_DENORMALS_SSE)
+  using State = unsigned int;
+  static constexpr State kFlushBits = (1 << 15) | (1 << 6); // FTZ, DAZ
+  static constexpr State kDenormalFlags = (1 << 1); // DE, denormal operand
+
+  static State GetState() { return _mm_getcsr(); }
+  static void SetState(State s) { _mm_setcsr(s); }
+  // MXCSR holds both the mode and the status flags
+  State GetFlags() const { return GetState(); }
+  void ClearFlags() { SetState(mOldState & ~kDenormalFlags); }
+  void RestoreFlags() { SetState(mOldState); }
+#elif defined(IPLUG_DENORMALS_ARM)
+  using State = unsigned long;
+  static constexpr State kFlushBits = (1 << 24); // FZ
+  static constexpr State kDenormalFlags = (1 << 3) | (1 << 7); // UFC, IDC
+
+  static State GetState()
+  {
+    State s;
+  #ifdef __aarch64__
+    asm volatile("mrs %0, fpcr" : "=r"(s));
+  #else
+    asm volatile("fmrx %0, fpscr" : "=r"(s));
+  #endif
+    return s;
+  }
+  static void SetState(State s)
+  {
+  #ifdef __aarch64__
+    asm volatile("msr fpcr, %0" :: "r"(s));
+  #else
+    asm volatile("fmxr fpscr, %0" :: "r"(s));
+  #endif
+  }
+  #ifdef __aarch64__
+  // on AArch64 the status flags are in FPSR rather than FPCR
+  static State GetFlags() { State s; asm volatile("mrs %0, fpsr" : "=r"(s)); return s; }
+  void ClearFlags() { mOldFlags = GetFlags(); asm volatile("msr fpsr, %0" :: "r"(mOldFlags & ~kDenormalFlags)); }
+  void RestoreFlags() { asm volatile("msr fpsr, %0" :: "r"(mOldFlags)); }
+  State mOldFlags = 0;
+  #else
+  State GetFlags() const { return GetState(); }
+  void ClearFlags() { SetState(mOldState & ~kDenormalFlags); }
+  void RestoreFlags() { SetState(mOldState); }
+  #endif
+#endif
+
+  EDenormalMode mMode;
+  std::atomic<int>* mCount;
+#if defined(IPLUG_DENORMALS_SSE) || defined(IPLUG_DENORMALS_ARM)
+  State mOldState = 0;
+#endif
+};
+
+END_IPLUG_NAMESPACE
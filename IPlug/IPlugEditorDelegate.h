@@ -22,6 +22,8 @@
 #include "wdltypes.h"
 #include <stdlib.h>
 #include "ptrlist.h"
+#include "mutex.h"
+#include "assocarray_hash.h"
 
 #include "IPlugParameter.h"
 #include "IPlugMidi.h"
@@ -66,12 +68,19 @@ public:
   /** Adds an IParam to the parameters ptr list
    * Note: This is only used in special circumstances, since most plug-in formats don't support dynamic parameters
    * @return Ptr to the newly created IParam object */
-  IParam* AddParam() { return mParams.Add(new IParam()); }
+  IParam* AddParam()
+  {
+    IParam* pParam = mParams.Add(new IParam());
+    pParam->SetChangeCounter(&mStateVersion);
+    pParam->SetInitCounter(&mParamInitVersion);
+    mParamInitVersion.fetch_add(1, std::memory_order_relaxed);
+    return pParam;
+  }
   
   /** Remove an IParam at a particular index
    * Note: This is only used in special circumstances, since most plug-in formats don't support dynamic parameters
    * @param idx The index of the parameter to remove */
-  void RemoveParam(int idx) { return mParams.Delete(idx); }
+  void RemoveParam(int idx) { mParams.Delete(idx); mParamInitVersion.fetch_add(1, std::memory_order_relaxed); MarkStateChanged(); }
   
   /** Get a pointer to one of the delegate's IParam objects
    * @param paramIdx The index of the parameter object to be got
@@ -85,6 +94,46 @@ public:
 
   /** @return Returns the number of parameters that belong to the plug-in. */
   int NParams() const { return mParams.GetSize(); }
+
+  /** Find a parameter by name. This uses a hashed index of the parameter names and groups, which is rebuilt (in one pass over
+   * the parameters) on the first lookup after parameters are added, removed or initialised
+   * @param name The parameter name, as passed to IParam::InitDouble() etc
+   * @return The index of the first parameter with this name, or -1 if there isn't one */
+  int GetParamIdx(const char* name) const
+  {
+    WDL_MutexLock lock(&mParamIndexMutex);
+    UpdateParamIndex();
+    const int* pIdx = mParamIndexNames.GetPtr(name);
+    return pIdx ? *pIdx : -1;
+  }
+
+  /** Get the indices of the parameters in a group, in order, from the same index as GetParamIdx()
+   * @param group The group name, "" for parameters without a group
+   * @param indices Filled with the parameter indices
+   * @return The number of parameters in the group */
+  int GetParamIdxsInGroup(const char* group, WDL_TypedBuf<int>& indices) const
+  {
+    WDL_MutexLock lock(&mParamIndexMutex);
+    int n;
+    const int* pGroupParams = GetParamIdxsInGroupLocked(group, n);
+    int* pIndices = indices.ResizeOK(n, false);
+    if (!pIndices)
+      return 0;
+    if (n)
+      memcpy(pIndices, pGroupParams, n * sizeof(int));
+    return n;
+  }
+
+  /** @return \c true if the UI has been opened (OnUIOpen() was called) and not closed since */
+  bool IsUIOpen() const { return mUIOpen.load(); }
+
+  /** @return A number that changes whenever a parameter value changes or MarkStateChanged() is called.
+   * Compare it with a previously stored version to find out cheaply whether the state may have changed */
+  uint32_t GetStateVersion() const { return mStateVersion.load(std::memory_order_relaxed); }
+
+  /** Call this when state that isn't stored in parameters (e.g. custom data serialized in SerializeState()) has changed,
+   * so that anything caching the state knows to refresh it */
+  void MarkStateChanged() { mStateVersion.fetch_add(1, std::memory_order_relaxed); }
   
   /** If you are not using IGraphics, you can implement this method to attach to the native parent view e.g. NSView, UIView, HWND.
    *  Defer calling OnUIOpen() if necessary. */
@@ -98,10 +147,10 @@ public:
   
 #pragma mark - Methods you may want to override...
   /** Override this method to do something before the UI is opened. You must call the base implementation to make sure controls linked to parameters get updated correctly. */
-  virtual void OnUIOpen() { SendCurrentParamValuesFromDelegate(); }
+  virtual void OnUIOpen() { mUIOpen.store(true); SendCurrentParamValuesFromDelegate(); }
   
-  /** Override this method to do something before the UI is closed. */
-  virtual void OnUIClose() {};
+  /** Override this method to do something before the UI is closed. You should call the base implementation. */
+  virtual void OnUIClose() { mUIOpen.store(false); };
   
   /** Override this method to do something to your DSP when a parameter changes.
    * WARNING: this method can in some cases be called on the realtime audio thread
@@ -370,6 +419,91 @@ private:
   /** A list of IParam objects. This list is populated in the delegate constructor depending on the number of parameters passed as an argument to MakeConfig() in the plug-in class implementation constructor */
   WDL_PtrList<IParam> mParams;
 
+  /** Incremented by the parameters when their values change, see GetStateVersion() */
+  std::atomic<uint32_t> mStateVersion {0};
+
+  /** Rebuilds the parameter name and group indices if parameters were added, removed or initialised since the last time.
+   * Call with mParamIndexMutex locked */
+  void UpdateParamIndex() const
+  {
+    const uint32_t version = mParamInitVersion.load(std::memory_order_relaxed);
+    if (mParamIndexValid && mParamIndexVersion == version)
+      return;
+
+    mParamIndexNames.DeleteAll();
+    mParamIndexGroups.DeleteAll();
+
+    const int nParams = NParams();
+    WDL_TypedBuf<int> groupOfParam;
+    int* pGroupOfParam = groupOfParam.Resize(nParams, false);
+    int nGroups = 0;
+
+    for (int i = 0; i < nParams; i++)
+    {
+      const IParam* pParam = mParams.Get(i);
+
+      if (!mParamIndexNames.Exists(pParam->GetName()))
+        mParamIndexNames.Insert(pParam->GetName(), i);
+
+      const int* pGroup = mParamIndexGroups.GetPtr(pParam->GetGroup());
+      if (pGroup)
+        pGroupOfParam[i] = *pGroup;
+      else
+      {
+        mParamIndexGroups.Insert(pParam->GetGroup(), nGroups);
+        pGroupOfParam[i] = nGroups++;
+      }
+    }
+
+    // the parameters of group g are mParamIndexGroupParams[mParamIndexGroupStarts[g] ... mParamIndexGroupStarts[g + 1] - 1]
+    int* pStarts = mParamIndexGroupStarts.Resize(nGroups + 1, false);
+    int* pGroupParams = mParamIndexGroupParams.Resize(nParams, false);
+    memset(pStarts, 0, (nGroups + 1) * sizeof(int));
+
+    for (int i = 0; i < nParams; i++)
+      pStarts[pGroupOfParam[i] + 1]++;
+
+    for (int g = 0; g < nGroups; g++)
+      pStarts[g + 1] += pStarts[g];
+
+    for (int i = 0; i < nParams; i++)
+      pGroupParams[pStarts[pGroupOfParam[i]]++] = i;
+
+    // the fill loop moved each start to the next group's start
+    for (int g = nGroups; g > 0; g--)
+      pStarts[g] = pStarts[g - 1];
+    pStarts[0] = 0;
+
+    mParamIndexVersion = version;
+    mParamIndexValid = true;
+  }
+
+  /** Get the indices of the parameters in a group from the index, without copying them.
+   * Call with mParamIndexMutex locked, the indices are only valid until it is unlocked
+   * @param group The group name
+   * @param n Set to the number of parameters in the group
+   * @return The group's parameter indices, in order */
+  const int* GetParamIdxsInGroupLocked(const char* group, int& n) const
+  {
+    UpdateParamIndex();
+    const int* pGroup = mParamIndexGroups.GetPtr(group);
+    n = pGroup ? mParamIndexGroupStarts.Get()[*pGroup + 1] - mParamIndexGroupStarts.Get()[*pGroup] : 0;
+    return pGroup ? mParamIndexGroupParams.Get() + mParamIndexGroupStarts.Get()[*pGroup] : nullptr;
+  }
+
+  /** Incremented by the parameters when they are initialised, and when parameters are added or removed */
+  std::atomic<uint32_t> mParamInitVersion {0};
+
+  mutable WDL_Mutex mParamIndexMutex;
+  mutable bool mParamIndexValid = false;
+  mutable uint32_t mParamIndexVersion = 0;
+  mutable WDL_StringKeyedHashArray<int> mParamIndexNames; // first parameter with each name
+  mutable WDL_StringKeyedHashArray<int> mParamIndexGroups; // group number of each group name
+  mutable WDL_TypedBuf<int> mParamIndexGroupStarts, mParamIndexGroupParams;
+
+  /** Set by OnUIOpen() and OnUIClose(), see IsUIOpen() */
+  std::atomic<bool> mUIOpen {false};
+
   /** The width of the plug-in editor in pixels. Can be updated by resizing, exists here for persistance, even if UI doesn't exist. */
   int mEditorWidth = 0;
   /** The height of the plug-in editor in pixels. Can be updated by resizing, exists here for persistance, even if UI doesn't exist */
@@ -0,0 +1,86 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugFixedIO
+ */
+
+#include <cassert>
+#include <utility>
+
+#include "IPlugPlatform.h"
+#include "IPlugConstants.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A view of a fixed number of channel buffers. Because the channel count is a compile time constant,
+ * loops over the channels can be unrolled by the compiler
+ * @tparam T The sample type
+ * @tparam N The number of channels */
+template <typename T, int N>
+class FixedChannels
+{
+public:
+  explicit FixedChannels(T** ppData) : mData(ppData) {}
+
+  /** @return The number of channels */
+  static constexpr int NChannels() { return N; }
+
+  /** @param chIdx The channel index, which must be less than N
+   * @return A pointer to the channel's buffer */
+  T* operator[](int chIdx) const { assert(chIdx >= 0 && chIdx < N); return mData[chIdx]; }
+
+  /** @return The array of channel pointers */
+  T** Get() const { return mData; }
+
+private:
+  T** mData;
+};
+
+/** Derive your plug-in class from IPlugFixedIO rather than from Plugin, to write its DSP against compile time channel counts.
+ * Instead of ProcessBlock(), implement:
+ * @code
+ * void ProcessFixedBlock(FixedChannels<sample, NInputs> inputs, FixedChannels<sample, NOutputs> outputs, int nFrames);
+ * @endcode
+ * e.g. class IPlugEffect final : public IPlugFixedIO<IPlugEffect, 2, 2, Plugin>
+ * The counts must match the largest channel I/O config in config.h (PLUG_CHANNEL_IO). IPlugProcessor always provides
+ * valid buffers for every channel, with unconnected channels pointing at valid scratch memory (not necessarily zeroed), so no checks are needed per block.
+ * @tparam TPlug Your plug-in class
+ * @tparam NInputs The number of input channels
+ * @tparam NOutputs The number of output channels
+ * @tparam TBase The API base class, normally Plugin */
+template <class TPlug, int NInputs, int NOutputs, class TBase>
+class IPlugFixedIO : public TBase
+{
+public:
+  static constexpr int kNInputs = NInputs;
+  static constexpr int kNOutputs = NOutputs;
+
+  using InputChannels = FixedChannels<sample, NInputs>;
+  using OutputChannels = FixedChannels<sample, NOutputs>;
+
+  template <typename... Args>
+  IPlugFixedIO(Args&&... args)
+  : TBase(std::forward<Args>(args)...)
+  {
+    assert(this->MaxNChannels(ERoute::kInput) == NInputs && "Input count doesn't match PLUG_CHANNEL_IO");
+    assert(this->MaxNChannels(ERoute::kOutput) == NOutputs && "Output count doesn't match PLUG_CHANNEL_IO");
+  }
+
+  void ProcessBlock(sample** inputs, sample** outputs, int nFrames) final
+  {
+    static_cast<TPlug*>(this)->ProcessFixedBlock(InputChannels(inputs), OutputChannels(outputs), nFrames);
+  }
+};
+
+END_IPLUG_NAMESPACE
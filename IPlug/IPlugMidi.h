@@ -250,6 +250,24 @@ struct IMidiMsg
     return (EStatusMsg) e;
   }
   
+  /** Gets the number of bytes the message takes when it is sent to a driver or host, from its status byte
+   * @return 3 for most channel messages, 2 for program change and channel aftertouch, 1 to 3 for system messages, 0 if mStatus isn't a status byte */
+  int Size() const
+  {
+    switch (mStatus >> 4)
+    {
+      case kProgramChange:
+      case kChannelAftertouch:
+        return 2;
+      case 0xF:
+        if (mStatus == 0xF1 || mStatus == 0xF3) return 2; // MTC quarter frame, song select
+        if (mStatus == 0xF2) return 3; // song position
+        return 1; // tune request and realtime messages
+      default:
+        return mStatus & 0x80 ? 3 : 0;
+    }
+  }
+  
   /** Gets the MIDI note number
    * @return [0, 127], -1 if NA. */
   int NoteNumber() const
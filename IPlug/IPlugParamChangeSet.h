@@ -0,0 +1,134 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugParamChangeSet
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Used to transfer parameter changes from a realtime or host thread to the main thread, without a fixed size queue.
+ * Each parameter has a slot holding its latest value, and a bit in an atomic bitset that marks it as changed.
+ * Setting a parameter many times between two reads only results in one update with the latest value, and changes are never dropped.
+ * Any number of threads can call Set(), ForEachChanged() should only be called from one thread. */
+class IPlugParamChangeSet final
+{
+public:
+  /** IPlugParamChangeSet constructor
+   * @param nParams The number of parameters */
+  IPlugParamChangeSet(int nParams = 0)
+  {
+    Resize(nParams);
+  }
+
+  IPlugParamChangeSet(const IPlugParamChangeSet&) = delete;
+  IPlugParamChangeSet& operator=(const IPlugParamChangeSet&) = delete;
+
+  /** Resize the set, discarding any pending changes. This is not thread safe, and must not be called while other threads are using the set
+   * @param nParams The number of parameters */
+  void Resize(int nParams)
+  {
+    mSize = nParams > 0 ? nParams : 0;
+    mNWords = (mSize + 63) / 64;
+    mValues.reset(new std::atomic<double>[mSize]);
+    mFlags.reset(new std::atomic<uint64_t>[mNWords]);
+
+    for (int i = 0; i < mSize; i++)
+      mValues[i].store(0.);
+
+    for (int i = 0; i < mNWords; i++)
+      mFlags[i].store(0);
+
+    mAnyChanged.store(false);
+  }
+
+  /** @return The number of parameters the set can hold */
+  int GetSize() const { return mSize; }
+
+  /** Mark a parameter as changed and store its latest value. Lock-free, can be called from the audio thread
+   * @param paramIdx The index of the parameter. Indexes outside the size of the set are ignored
+   * @param value The new (non-normalized) value of the parameter */
+  void Set(int paramIdx, double value)
+  {
+    if (paramIdx < 0 || paramIdx >= mSize)
+      return;
+
+    mValues[paramIdx].store(value, std::memory_order_relaxed);
+    mFlags[paramIdx >> 6].fetch_or(uint64_t(1) << (paramIdx & 63), std::memory_order_release);
+    mAnyChanged.store(true, std::memory_order_release);
+  }
+
+  /** @return \c true if any parameter may have changed since the last call to ForEachChanged() */
+  bool HasChanges() const { return mAnyChanged.load(std::memory_order_acquire); }
+
+  /** Call a function for every parameter that changed since the last call, with its latest value, and clear the changes.
+   * Only the words of the bitset that have bits set are visited per parameter
+   * @param func A callable with the signature void(int paramIdx, double value) */
+  template <typename F>
+  void ForEachChanged(F&& func)
+  {
+    if (!mAnyChanged.exchange(false, std::memory_order_acquire))
+      return;
+
+    for (int w = 0; w < mNWords; w++)
+    {
+      if (mFlags[w].load(std::memory_order_relaxed) == 0)
+        continue;
+
+      uint64_t bits = mFlags[w].exchange(0, std::memory_order_acquire);
+
+      while (bits)
+      {
+        const int paramIdx = (w << 6) + CountTrailingZeros(bits);
+        bits &= bits - 1;
+        func(paramIdx, mValues[paramIdx].load(std::memory_order_relaxed));
+      }
+    }
+  }
+
+private:
+  static inline int CountTrailingZeros(uint64_t x)
+  {
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long idx;
+    _BitScanForward64(&idx, x);
+    return static_cast<int>(idx);
+#elif defined(_MSC_VER)
+    unsigned long idx;
+    if (_BitScanForward(&idx, static_cast<unsigned long>(x)))
+      return static_cast<int>(idx);
+    _BitScanForward(&idx, static_cast<unsigned long>(x >> 32));
+    return static_cast<int>(idx) + 32;
+#else
+    return __builtin_ctzll(x);
+#endif
+  }
+
+  int mSize = 0;
+  int mNWords = 0;
+  std::unique_ptr<std::atomic<double>[]> mValues;
+  std::unique_ptr<std::atomic<uint64_t>[]> mFlags;
+  std::atomic<bool> mAnyChanged {false};
+};
+
+END_IPLUG_NAMESPACE
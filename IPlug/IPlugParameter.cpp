@@ -15,6 +15,7 @@
 
 #include <cstdio>
 #include <algorithm>
+#include <typeinfo>
 
 #include "IPlugParameter.h"
 #include "IPlugLogger.h"
@@ -168,6 +169,20 @@ void IParam::InitDouble(const char* name, double defaultVal, double minVal, doub
     
   mShape = std::unique_ptr<Shape>(shape.Clone());
   mShape->Init(*this);
+
+  const std::type_info& shapeType = typeid(*mShape);
+  if (shapeType == typeid(ShapeLinear)) mShapeType = kShapeLinear;
+  else if (shapeType == typeid(ShapePowCurve)) mShapeType = kShapePowCurve;
+  else if (shapeType == typeid(ShapeExp)) mShapeType = kShapeExp;
+  else mShapeType = kShapeCustom;
+
+  if (mLUTPoints)
+    InitLUT(mLUTPoints);
+
+  mDisplayCacheFormat = -1; // the range or shape may have changed
+
+  if (mInitCounter)
+    mInitCounter->fetch_add(1, std::memory_order_relaxed);
 }
 
 void IParam::InitFrequency(const char *name, double defaultVal, double minVal, double maxVal, double step, int flags, const char *group)
@@ -245,6 +260,157 @@ void IParam::Init(const IParam& p, const char* searchStr, const char* replaceStr
   }
 }
 
+#pragma mark - Block conversions
+
+void IParam::ConstrainBlock(double* values, int nValues) const
+{
+  const double min = mMin, max = mMax;
+
+  if (mFlags & kFlagStepped)
+  {
+    const double step = mStep;
+    for (auto i = 0; i < nValues; i++)
+      values[i] = Clip(std::round(values[i] / step) * step, min, max);
+  }
+  else
+  {
+    for (auto i = 0; i < nValues; i++)
+      values[i] = Clip(values[i], min, max);
+  }
+}
+
+void IParam::FromNormalized(const double* normalized, double* values, int nValues) const
+{
+  // the same expressions as the shapes, so that the results match FromNormalized() exactly
+  const double min = mMin, range = mMax - mMin;
+
+  switch (mShapeType)
+  {
+    case kShapeLinear:
+      for (auto i = 0; i < nValues; i++)
+        values[i] = min + normalized[i] * range;
+      break;
+    case kShapePowCurve:
+    {
+      const double shape = static_cast<const ShapePowCurve*>(mShape.get())->mShape;
+      for (auto i = 0; i < nValues; i++)
+        values[i] = min + std::pow(normalized[i], shape) * range;
+      break;
+    }
+    case kShapeExp:
+    {
+      const ShapeExp* pShape = static_cast<const ShapeExp*>(mShape.get());
+      const double add = pShape->mAdd, mul = pShape->mMul;
+      for (auto i = 0; i < nValues; i++)
+        values[i] = std::exp(add + normalized[i] * mul);
+      break;
+    }
+    default:
+      for (auto i = 0; i < nValues; i++)
+        values[i] = mShape->NormalizedToValue(normalized[i], *this);
+      break;
+  }
+
+  ConstrainBlock(values, nValues);
+}
+
+void IParam::ToNormalized(const double* values, double* normalized, int nValues) const
+{
+  if (normalized != values)
+    memcpy(normalized, values, nValues * sizeof(double));
+
+  ConstrainBlock(normalized, nValues);
+
+  const double min = mMin, range = mMax - mMin;
+
+  switch (mShapeType)
+  {
+    case kShapeLinear:
+      for (auto i = 0; i < nValues; i++)
+        normalized[i] = Clip((normalized[i] - min) / range, 0., 1.);
+      break;
+    case kShapePowCurve:
+    {
+      const double invShape = 1.0 / static_cast<const ShapePowCurve*>(mShape.get())->mShape;
+      for (auto i = 0; i < nValues; i++)
+        normalized[i] = Clip(std::pow((normalized[i] - min) / range, invShape), 0., 1.);
+      break;
+    }
+    case kShapeExp:
+    {
+      const ShapeExp* pShape = static_cast<const ShapeExp*>(mShape.get());
+      const double add = pShape->mAdd, mul = pShape->mMul;
+      for (auto i = 0; i < nValues; i++)
+        normalized[i] = Clip((std::log(normalized[i]) - add) / mul, 0., 1.);
+      break;
+    }
+    default:
+      for (auto i = 0; i < nValues; i++)
+        normalized[i] = Clip(mShape->ValueToNormalized(normalized[i], *this), 0., 1.);
+      break;
+  }
+}
+
+void IParam::InitLUT(int nPoints)
+{
+  mLUTPoints = std::max(nPoints, 0);
+  mLUTError = 0.0;
+
+  double* pLUT = (mLUTPoints && mShapeType != kShapeLinear) ? mLUT.ResizeOK(mLUTPoints + 2, false) : nullptr;
+
+  if (!pLUT)
+  {
+    mLUT.Resize(0);
+    return;
+  }
+
+  const double scale = 1.0 / mLUTPoints;
+
+  for (auto i = 0; i <= mLUTPoints; i++)
+    pLUT[i] = mShape->NormalizedToValue(i * scale, *this);
+
+  pLUT[mLUTPoints + 1] = pLUT[mLUTPoints]; // so that 1. can interpolate without a check
+
+  // linear interpolation errs most towards the middle of an interval
+  const double range = mMax - mMin;
+
+  for (auto i = 0; i < mLUTPoints; i++)
+  {
+    for (auto q = 1; q < 4; q++)
+    {
+      const double frac = q * 0.25;
+      const double exact = mShape->NormalizedToValue((i + frac) * scale, *this);
+      const double interp = pLUT[i] + frac * (pLUT[i + 1] - pLUT[i]);
+      mLUTError = std::max(mLUTError, std::fabs(interp - exact) / range);
+    }
+  }
+}
+
+void IParam::FromNormalizedLUT(const double* normalized, double* values, int nValues) const
+{
+  if (!mLUT.GetSize())
+  {
+    FromNormalized(normalized, values, nValues);
+    return;
+  }
+
+  const double* pLUT = mLUT.Get();
+  const double scale = mLUTPoints;
+
+  for (auto i = 0; i < nValues; i++)
+  {
+    const double x = normalized[i];
+    const double pos = (x > 0. ? (x < 1. ? x : 1.) : 0.) * scale; // NaN goes to 0.
+    const int idx = static_cast<int>(pos);
+    const double frac = pos - idx;
+    values[i] = pLUT[idx] + frac * (pLUT[idx + 1] - pLUT[idx]);
+  }
+
+  ConstrainBlock(values, nValues);
+}
+
+#pragma mark -
+
 void IParam::SetDisplayText(double value, const char* str)
 {
   int n = mDisplayTexts.GetSize();
@@ -252,6 +418,26 @@ void IParam::SetDisplayText(double value, const char* str)
   DisplayText* pDT = mDisplayTexts.Get() + n;
   pDT->mValue = value;
   strcpy(pDT->mText, str);
+
+  mDisplayTextsDense = mDisplayTextsDense && value == n;
+
+  // NaN never matches, so it isn't indexed
+  if (value == value)
+  {
+    // after any equal values, so that lookups find the first one added, as a linear search would
+    const int* pOrder = mDisplayTextsByValue.Get();
+    int lo = 0, hi = mDisplayTextsByValue.GetSize();
+    while (lo < hi)
+    {
+      const int mid = (lo + hi) / 2;
+      if (mDisplayTexts.Get()[pOrder[mid]].mValue <= value) lo = mid + 1;
+      else hi = mid;
+    }
+    mDisplayTextsByValue.Insert(n, lo);
+  }
+
+  if (!mDisplayTextsByText.Exists(pDT->mText))
+    mDisplayTextsByText.Insert(pDT->mText, n);
 }
 
 void IParam::SetDisplayPrecision(int precision)
@@ -259,16 +445,115 @@ void IParam::SetDisplayPrecision(int precision)
   mDisplayPrecision = precision;
 }
 
-void IParam::GetDisplay(double value, bool normalized, WDL_String& str, bool withDisplayText) const
+/** Writes "%d" of v to buf */
+static void FormatInt(int v, char* buf)
 {
-  if (normalized) value = FromNormalized(value);
+  char digits[16];
+  int nDigits = 0;
+  unsigned int u = v < 0 ? 0u - static_cast<unsigned int>(v) : static_cast<unsigned int>(v);
+
+  do
+  {
+    digits[nDigits++] = '0' + u % 10;
+    u /= 10;
+  } while (u);
+
+  if (v < 0) *buf++ = '-';
+  while (nDigits) *buf++ = digits[--nDigits];
+  *buf = 0;
+}
+
+/** Writes "%.*f" (or "%+.*f") of value to buf without snprintf. printf rounds the exact binary value, so this returns false,
+ * for snprintf to be used, if value * 10^precision is too large or so close to halfway between two results that the
+ * rounding of the multiplication could matter */
+static bool FormatFixed(double value, int precision, bool plusSign, char* buf)
+{
+  static const double kPow10[] = { 1., 10., 100., 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+  if (precision < 0 || precision > 9)
+    return false;
+
+  const double scaled = std::fabs(value) * kPow10[precision];
+
+  if (!(scaled < 1e9)) // also NaN and infinity
+    return false;
+
+  const double whole = std::floor(scaled);
+  const double frac = scaled - whole;
+
+  // the multiplication errs by less than 1e-7 below 1e9
+  if (std::fabs(frac - 0.5) < 1e-6)
+    return false;
+
+  unsigned int u = static_cast<unsigned int>(whole) + (frac > 0.5 ? 1 : 0);
+  char digits[24];
+  int nDigits = 0;
+
+  for (auto i = 0; i < precision; i++)
+  {
+    digits[nDigits++] = '0' + u % 10;
+    u /= 10;
+  }
+
+  if (precision) digits[nDigits++] = '.';
+
+  do
+  {
+    digits[nDigits++] = '0' + u % 10;
+    u /= 10;
+  } while (u);
+
+  if (std::signbit(value)) *buf++ = '-';
+  else if (plusSign) *buf++ = '+';
+  while (nDigits) *buf++ = digits[--nDigits];
+  *buf = 0;
+  return true;
+}
 
+void IParam::GetDisplay(double value, bool normalized, WDL_String& str, bool withDisplayText) const
+{
   if (mDisplayFunction != nullptr)
   {
-    mDisplayFunction(value, str);
+    mDisplayFunction(normalized ? FromNormalized(value) : value, str);
     return;
   }
 
+  // hosts ask for the same values over and over (e.g. the display of every parameter at UI rate)
+  const int format = (mDisplayPrecision & 0xffff) | ((mFlags & (kFlagNegateDisplay | kFlagSignDisplay)) << 16) |
+                     (normalized ? 1 << 24 : 0) | (withDisplayText ? 1 << 25 : 0);
+  const int nDisplayTexts = mDisplayTexts.GetSize();
+
+  if (!mDisplayCacheBusy.exchange(true, std::memory_order_acquire))
+  {
+    if (mDisplayCacheFormat == format && mDisplayCacheNTexts == nDisplayTexts && mDisplayCacheValue == value)
+    {
+      str.Set(mDisplayCacheText);
+    }
+    else
+    {
+      GetDisplayUncached(value, normalized, str, withDisplayText);
+
+      if (str.GetLength() < MAX_PARAM_DISPLAY_LEN)
+      {
+        memcpy(mDisplayCacheText, str.Get(), str.GetLength() + 1);
+        mDisplayCacheValue = value;
+        mDisplayCacheFormat = format;
+        mDisplayCacheNTexts = nDisplayTexts;
+      }
+      else
+        mDisplayCacheFormat = -1;
+    }
+
+    mDisplayCacheBusy.store(false, std::memory_order_release);
+  }
+  else
+    GetDisplayUncached(value, normalized, str, withDisplayText);
+}
+
+void IParam::GetDisplayUncached(double value, bool normalized, WDL_String& str, bool withDisplayText) const
+{
+  if (normalized) value = FromNormalized(value);
+
   if (withDisplayText)
   {
     const char* displayText = GetDisplayText(value);
@@ -288,19 +573,35 @@ void IParam::GetDisplay(double value, bool normalized, WDL_String& str, bool wit
   // Squash all zeros to positive
   if (!displayValue) displayValue = 0.0;
 
+  char buf[MAX_PARAM_DISPLAY_LEN];
+
   if (mDisplayPrecision == 0)
   {
-    str.SetFormatted(MAX_PARAM_DISPLAY_LEN, "%d", static_cast<int>(round(displayValue)));
+    if (std::fabs(displayValue) < 2147483647.0)
+    {
+      FormatInt(static_cast<int>(round(displayValue)), buf);
+      str.Set(buf);
+    }
+    else
+      str.SetFormatted(MAX_PARAM_DISPLAY_LEN, "%d", static_cast<int>(round(displayValue)));
   }
   else if ((mFlags & kFlagSignDisplay) && displayValue)
   {
-    char fmt[16];
-    sprintf(fmt, "%%+.%df", mDisplayPrecision);
-    str.SetFormatted(MAX_PARAM_DISPLAY_LEN, fmt, displayValue);
+    if (FormatFixed(displayValue, mDisplayPrecision, true, buf))
+      str.Set(buf);
+    else
+    {
+      char fmt[16];
+      sprintf(fmt, "%%+.%df", mDisplayPrecision);
+      str.SetFormatted(MAX_PARAM_DISPLAY_LEN, fmt, displayValue);
+    }
   }
   else
   {
-    str.SetFormatted(MAX_PARAM_DISPLAY_LEN, "%.*f", mDisplayPrecision, displayValue);
+    if (FormatFixed(displayValue, mDisplayPrecision, false, buf))
+      str.Set(buf);
+    else
+      str.SetFormatted(MAX_PARAM_DISPLAY_LEN, "%.*f", mDisplayPrecision, displayValue);
   }
 }
 
@@ -326,11 +627,29 @@ int IParam::NDisplayTexts() const
 
 const char* IParam::GetDisplayText(double value) const
 {
-  int n = mDisplayTexts.GetSize();
-  for (DisplayText* pDT = mDisplayTexts.Get(); n; --n, ++pDT)
+  const DisplayText* pDTs = mDisplayTexts.Get();
+
+  if (mDisplayTextsDense)
   {
-    if (value == pDT->mValue) return pDT->mText;
+    if (value >= 0. && value < mDisplayTexts.GetSize())
+    {
+      const DisplayText* pDT = pDTs + static_cast<int>(value);
+      if (pDT->mValue == value) return pDT->mText;
+    }
+    return "";
   }
+
+  const int* pOrder = mDisplayTextsByValue.Get();
+  const int n = mDisplayTextsByValue.GetSize();
+  int lo = 0, hi = n;
+  while (lo < hi)
+  {
+    const int mid = (lo + hi) / 2;
+    if (pDTs[pOrder[mid]].mValue < value) lo = mid + 1;
+    else hi = mid;
+  }
+
+  if (lo < n && pDTs[pOrder[lo]].mValue == value) return pDTs[pOrder[lo]].mText;
   return "";
 }
 
@@ -343,16 +662,11 @@ const char* IParam::GetDisplayTextAtIdx(int idx, double* pValue) const
 
 bool IParam::MapDisplayText(const char* str, double* pValue) const
 {
-  int n = mDisplayTexts.GetSize();
-  for (DisplayText* pDT = mDisplayTexts.Get(); n; --n, ++pDT)
-  {
-    if (!strcmp(str, pDT->mText))
-    {
-      *pValue = pDT->mValue;
-      return true;
-    }
-  }
-  return false;
+  const int* pIdx = mDisplayTextsByText.GetPtr(str);
+  if (!pIdx) return false;
+
+  *pValue = mDisplayTexts.Get()[*pIdx].mValue;
+  return true;
 }
 
 double IParam::StringToValue(const char* str) const
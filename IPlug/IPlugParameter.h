@@ -21,6 +21,7 @@
 #include <memory>
 
 #include "wdlstring.h"
+#include "assocarray_hash.h"
 
 #include "IPlugUtilities.h"
 
@@ -57,6 +58,9 @@ public:
     kFlagMeta             = 0x10,
   };
   
+  /** Identifies the built in shapes, so that the block conversions can switch on them rather than call the Shape for each value */
+  enum EShapeType { kShapeLinear, kShapePowCurve, kShapeExp, kShapeCustom };
+
   /** DisplayFunc allows custom parameter display functions, defined by a lambda matching this signature */
   using DisplayFunc = std::function<void(double, WDL_String&)>;
 
@@ -296,9 +300,44 @@ public:
     return Constrain(mShape->NormalizedToValue(normalizedValue, *this));
   }
 
+  /** Converts a block of normalized values to real values, with the same results as FromNormalized() for each value
+   * but without a virtual call per value (e.g. for sample accurate automation)
+   * @param normalized The normalized input values
+   * @param values Receives the real values, can be the same array as \c normalized
+   * @param nValues The number of values */
+  void FromNormalized(const double* normalized, double* values, int nValues) const;
+
+  /** Converts a block of real values to normalized values, with the same results as ToNormalized() for each value
+   * @param values The real input values
+   * @param normalized Receives the normalized values, can be the same array as \c values
+   * @param nValues The number of values */
+  void ToNormalized(const double* values, double* normalized, int nValues) const;
+
+  /** Converts a block of normalized values to real values by interpolating a table of the shape (see InitLUT()), which
+   * avoids the std::pow()/std::exp() of the curved shapes. Inputs are clamped to 0. to 1., and the results are constrained
+   * as FromNormalized() constrains them. Without a table, this is the same as the exact block FromNormalized()
+   * @param normalized The normalized input values
+   * @param values Receives the real values, can be the same array as \c normalized
+   * @param nValues The number of values */
+  void FromNormalizedLUT(const double* normalized, double* values, int nValues) const;
+
+  /** Builds the table used by FromNormalizedLUT(), for parameters with a curved shape. Call it once the parameter has been
+   * initialised (the table is rebuilt if it is initialised again), not while another thread is converting values. Check
+   * GetLUTError(): with 1024 points ShapeExp and ShapePowCurve(3.) are within 1e-5 of the range, but power curves below 1.
+   * are too steep near 0. to interpolate well
+   * @param nPoints The number of intervals in the table, 0 removes it. Linear shapes never get a table */
+  void InitLUT(int nPoints = 1024);
+
+  /** @return The largest difference between the table and the shape, as a fraction of the parameter's range, measured at
+   * the middle and quarter points of each interval when the table was built (0. if there is no table) */
+  double GetLUTError() const { return mLUTError; }
+
+  /** @return The kind of shape this parameter has, kShapeCustom for shapes other than (or derived from) the built in ones */
+  EShapeType GetShapeType() const { return mShapeType; }
+
   /** Sets the parameter value
    * @param value Value to be set. Will be stepped and clamped between \c mMin and \c mMax */
-  void Set(double value) { mValue.store(Constrain(value)); }
+  void Set(double value) { StoreValue(Constrain(value)); }
 
   /** Sets the parameter value from a normalized range (usually coming from the linked IControl)
    * @param normalizedValue The expected normalized value between 0. and 1. */
@@ -306,10 +345,20 @@ public:
 
   /** Set the parameter value using a textual representation
    * @param str The textual representations as a CString */
-  void SetString(const char* str) { mValue.store(StringToValue(str)); }
+  void SetString(const char* str) { StoreValue(StringToValue(str)); }
 
   /** Replaces the parameter's current value with the default one  */
-  void SetToDefault() { mValue.store(mDefault); }
+  void SetToDefault() { StoreValue(mDefault); }
+
+  /** Set a counter that is incremented every time the parameter's value actually changes. IEditorDelegate uses this to keep a
+   * version number for its state, so that the state can be checked for changes without looking at every parameter
+   * @param pCounter Ptr to the counter, or nullptr to stop counting */
+  void SetChangeCounter(std::atomic<uint32_t>* pCounter) { mChangeCounter = pCounter; }
+
+  /** Set a counter that is incremented every time the parameter is initialised, when its name, group, range etc may change.
+   * IEditorDelegate uses this to know when its parameter name and group indices need to be rebuilt
+   * @param pCounter Ptr to the counter, or nullptr to stop counting */
+  void SetInitCounter(std::atomic<uint32_t>* pCounter) { mInitCounter = pCounter; }
 
   /** Set the parameter's default value, and set the parameter to that default
    * @param value The new default value */
@@ -496,6 +545,18 @@ private:
     char mText[MAX_PARAM_DISPLAY_LEN];
   };
 
+  /** Steps and clamps a block of values in place, as Constrain() */
+  void ConstrainBlock(double* values, int nValues) const;
+
+  /** GetDisplay() without the cache, for values without a display function */
+  void GetDisplayUncached(double value, bool normalized, WDL_String& display, bool withDisplayText) const;
+
+  void StoreValue(double value)
+  {
+    if (mValue.exchange(value) != value && mChangeCounter)
+      mChangeCounter->fetch_add(1, std::memory_order_relaxed);
+  }
+
   EParamType mType = kTypeNone;
   EParamUnit mUnit = kUnitCustom;
   std::atomic<double> mValue{0.0};
@@ -511,9 +572,25 @@ private:
   char mParamGroup[MAX_PARAM_GROUP_LEN];
   
   std::unique_ptr<Shape> mShape;
+  EShapeType mShapeType = kShapeLinear;
+  int mLUTPoints = 0;
+  double mLUTError = 0.0;
+  WDL_TypedBuf<double> mLUT; // mLUTPoints + 2 values of the shape, before Constrain()
   DisplayFunc mDisplayFunction = nullptr;
+  std::atomic<uint32_t>* mChangeCounter = nullptr;
+  std::atomic<uint32_t>* mInitCounter = nullptr;
 
   WDL_TypedBuf<DisplayText> mDisplayTexts;
+  WDL_TypedBuf<int> mDisplayTextsByValue; // indices into mDisplayTexts, sorted by value (then index)
+  WDL_StringKeyedHashArray<int> mDisplayTextsByText; // index of the first display text with each string
+  bool mDisplayTextsDense = true; // mDisplayTexts[i].mValue == i, as for enums
+
+  // the last value GetDisplay() was asked for, skipped if another thread is using it
+  mutable std::atomic<bool> mDisplayCacheBusy{false};
+  mutable double mDisplayCacheValue = 0.0;
+  mutable int mDisplayCacheFormat = -1; // precision, flags and arguments it was formatted with, -1 if empty
+  mutable int mDisplayCacheNTexts = 0; // number of display texts at the time
+  mutable char mDisplayCacheText[MAX_PARAM_DISPLAY_LEN] = {};
 } WDL_FIXALIGN;
 
 END_IPLUG_NAMESPACE
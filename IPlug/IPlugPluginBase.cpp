@@ -101,33 +101,120 @@ void IPluginBase::GetBuildInfoStr(WDL_String& str, const char* date, const char*
 
 #pragma mark -
 
+// a packed state is a header of four ints (IPLUG_PACKED_PARAMS_MAGIC, IPLUG_PACKED_PARAMS_VERSION, the number of values and
+// the checksum of the values) followed by one double for each parameter
+static const int kPackedParamsHeaderSize = 4 * sizeof(int);
+
+// FNV-1a over 64 bit words, folded to 32 bits. The values are a multiple of 8 bytes
+static uint32_t PackedParamsChecksum(const uint8_t* pData, int nBytes)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (int i = 0; i < nBytes; i += sizeof(uint64_t))
+  {
+    uint64_t word;
+    memcpy(&word, pData + i, sizeof(uint64_t));
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  return (uint32_t) (hash ^ (hash >> 32));
+}
+
 bool IPluginBase::SerializeParams(IByteChunk& chunk) const
 {
   TRACE
-  bool savedOK = true;
-  int i, n = mParams.GetSize();
-  for (i = 0; i < n && savedOK; ++i)
+  const int n = mParams.GetSize();
+  const int headerSize = mPackedParamState ? kPackedParamsHeaderSize : 0;
+  const int startPos = chunk.Size();
+  const int endPos = startPos + headerSize + n * (int) sizeof(double);
+
+  // one resize for all the values, rather than growing the chunk for each one
+  chunk.Resize(endPos);
+  if (chunk.Size() != endPos)
+    return false;
+
+  uint8_t* pValues = chunk.GetData() + startPos + headerSize;
+  for (int i = 0; i < n; ++i)
   {
-    IParam* pParam = mParams.Get(i);
-    Trace(TRACELOC, "%d %s %f", i, pParam->GetName(), pParam->Value());
-    double v = pParam->Value();
-    savedOK &= (chunk.Put(&v) > 0);
+    const double v = mParams.Get(i)->Value();
+    memcpy(pValues + i * sizeof(double), &v, sizeof(double)); // the chunk may not be aligned
+#ifdef TRACER_BUILD
+    Trace(TRACELOC, "%d %s %f", i, mParams.Get(i)->GetName(), v);
+#endif
   }
-  return savedOK;
+
+  if (headerSize)
+  {
+    const int header[4] = { IPLUG_PACKED_PARAMS_MAGIC, IPLUG_PACKED_PARAMS_VERSION, n,
+                            (int) PackedParamsChecksum(pValues, n * (int) sizeof(double)) };
+    memcpy(chunk.GetData() + startPos, header, sizeof(header));
+  }
+
+  return true;
+}
+
+int IPluginBase::GetPackedParamsPos(const uint8_t* pData, int dataSize, int startPos, int& nStored)
+{
+  nStored = -1;
+  int header[4];
+
+  if (startPos < 0 || startPos + kPackedParamsHeaderSize > dataSize)
+    return startPos;
+
+  memcpy(header, pData + startPos, sizeof(header));
+
+  if (header[0] != IPLUG_PACKED_PARAMS_MAGIC || header[1] != IPLUG_PACKED_PARAMS_VERSION)
+    return startPos;
+
+  const int valuesPos = startPos + kPackedParamsHeaderSize;
+  if (header[2] < 0 || header[2] > (dataSize - valuesPos) / (int) sizeof(double) ||
+      (uint32_t) header[3] != PackedParamsChecksum(pData + valuesPos, header[2] * (int) sizeof(double)))
+    return -1;
+
+  nStored = header[2];
+  return valuesPos;
 }
 
 int IPluginBase::UnserializeParams(const IByteChunk& chunk, int startPos)
 {
   TRACE
-  int i, n = mParams.GetSize(), pos = startPos;
+  int i, n = mParams.GetSize(), nStored;
+  int pos = GetPackedParamsPos(chunk.GetData(), chunk.Size(), startPos, nStored);
+
+  if (pos < 0 && nStored < 0 && startPos >= 0) // a damaged packed state
+    return -1;
+
   ENTER_PARAMS_MUTEX
-  for (i = 0; i < n && pos >= 0; ++i)
+  if (nStored < 0) // one double for each parameter
   {
-    IParam* pParam = mParams.Get(i);
-    double v = 0.0;
-    pos = chunk.Get(&v, pos);
-    pParam->Set(v);
-    Trace(TRACELOC, "%d %s %f", i, pParam->GetName(), pParam->Value());
+    for (i = 0; i < n && pos >= 0; ++i)
+    {
+      IParam* pParam = mParams.Get(i);
+      double v = 0.0;
+      pos = chunk.Get(&v, pos);
+      pParam->Set(v);
+#ifdef TRACER_BUILD
+      Trace(TRACELOC, "%d %s %f", i, pParam->GetName(), pParam->Value());
+#endif
+    }
+  }
+  else
+  {
+    const uint8_t* pValues = chunk.GetData() + pos;
+    for (i = 0; i < n; ++i)
+    {
+      IParam* pParam = mParams.Get(i);
+      if (i < nStored)
+      {
+        double v;
+        memcpy(&v, pValues + i * sizeof(double), sizeof(double));
+        pParam->Set(v);
+      }
+      else // added since the state was saved
+        pParam->SetToDefault();
+#ifdef TRACER_BUILD
+      Trace(TRACELOC, "%d %s %f", i, pParam->GetName(), pParam->Value());
+#endif
+    }
+    pos += nStored * (int) sizeof(double);
   }
 
   OnParamReset(kPresetRecall);
@@ -171,26 +258,16 @@ void IPluginBase::CopyParamValues(int startIdx, int destIdx, int nParams)
 
 void IPluginBase::CopyParamValues(const char* inGroup, const char *outGroup)
 {
-  WDL_PtrList<IParam> inParams, outParams;
+  WDL_MutexLock lock(&mParamIndexMutex);
+  int nInParams, nOutParams;
+  const int* pInParams = GetParamIdxsInGroupLocked(inGroup, nInParams);
+  const int* pOutParams = GetParamIdxsInGroupLocked(outGroup, nOutParams);
   
-  for (auto p = 0; p < NParams(); p++)
-  {
-    IParam* pParam = GetParam(p);
-    if(strcmp(pParam->GetGroup(), inGroup) == 0)
-    {
-      inParams.Add(pParam);
-    }
-    else if(strcmp(pParam->GetGroup(), outGroup) == 0)
-    {
-      outParams.Add(pParam);
-    }
-  }
-  
-  assert(inParams.GetSize() == outParams.GetSize());
+  assert(nInParams == nOutParams);
   
-  for (auto p = 0; p < inParams.GetSize(); p++)
+  for (auto p = 0; p < nInParams && p < nOutParams; p++)
   {
-    outParams.Get(p)->Set(inParams.Get(p)->Value());
+    GetParam(pOutParams[p])->Set(GetParam(pInParams[p])->Value());
   }
 }
 
@@ -204,13 +281,14 @@ void IPluginBase::ForParamInRange(int startIdx, int endIdx, std::function<void(i
 
 void IPluginBase::ForParamInGroup(const char* paramGroup, std::function<void (int paramIdx, IParam&)> func)
 {
-  for (auto p = 0; p < NParams(); p++)
+  WDL_MutexLock lock(&mParamIndexMutex);
+  int nParams;
+  const int* pParams = GetParamIdxsInGroupLocked(paramGroup, nParams);
+
+  for (auto i = 0; i < nParams; i++)
   {
-    IParam* pParam = GetParam(p);
-    if(strcmp(pParam->GetGroup(), paramGroup) == 0)
-    {
-      func(p, *pParam);
-    }
+    const int p = pParams[i];
+    func(p, *GetParam(p));
   }
 }
 
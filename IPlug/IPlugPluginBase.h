@@ -108,12 +108,30 @@ public:
   /** Called to add a parameter group name, when a unique group name is discovered
    * @param name CString for the unique group name
    * @return Number of parameter groups */
-  int AddParamGroup(const char* name) { mParamGroups.Add(name); return NParamGroups(); }
+  int AddParamGroup(const char* name)
+  {
+    // the list points at the index's copy of the name, rather than at the IParam's group, which changes if it is initialised again
+    if (!mParamGroupIdxs.Exists(name))
+      mParamGroupIdxs.Insert(name, NParamGroups());
+    const char* pName = name;
+    mParamGroupIdxs.GetPtr(name, &pName);
+    mParamGroups.Add(pName);
+    return NParamGroups();
+  }
   
   /** Get the parameter group name as a particular index
    * @param idx The index to return
    * @return CString for the unique group name */
   const char* GetParamGroupName(int idx) const { return mParamGroups.Get(idx); }
+
+  /** Find a parameter group that was added with AddParamGroup() (hashed, rather than comparing with every group name)
+   * @param name CString for the group name
+   * @return The index of the group (as used by GetParamGroupName()), or -1 if it hasn't been added */
+  int GetParamGroupIdx(const char* name) const
+  {
+    const int* pIdx = mParamGroupIdxs.GetPtr(name);
+    return pIdx ? *pIdx : -1;
+  }
   
   /** Implemented by the API class, call this if you update parameter labels and hopefully the host should update it's displays (not applicable to all APIs) */
   virtual void InformHostOfParameterDetailsChange() {};
@@ -122,16 +140,36 @@ public:
   /** @return \c true if the plug-in has been set up to do state chunks, via config.h */
   bool DoesStateChunks() const { return mStateChunks; }
   
+  /** Choose how SerializeParams() stores the parameter values. By default they are stored as one double each, which every
+   * version of a plug-in can read. A packed state has a header with the number of parameters and a checksum before the values,
+   * so that a damaged state is rejected rather than loaded, and a state from a version with fewer or more parameters loads the
+   * parameters they share (and resets the rest to their defaults). UnserializeParams() reads either.
+   * Call this in your plug-in's constructor, and only once the versions that can't read packed states don't matter.
+   * @param packed \c true to write packed states */
+  void SetPackedParamState(bool packed) { mPackedParamState = packed; }
+  
+  /** @return \c true if SerializeParams() writes packed states, see SetPackedParamState() */
+  bool DoesPackedParamState() const { return mPackedParamState; }
+  
   /** Serializes the current double precision floating point, non-normalised values (IParam::mValue) of all parameters, into a binary byte chunk.
+   * The chunk is resized once and the values copied into it, see also SetPackedParamState()
    * @param chunk The output chunk to serialize to. Will append data if the chunk has already been started.
    * @return \c true if the serialization was successful */
   bool SerializeParams(IByteChunk& chunk) const;
   
-  /** Unserializes double precision floating point, non-normalised values from a byte chunk into mParams.
+  /** Unserializes double precision floating point, non-normalised values from a byte chunk into mParams, then calls OnParamReset() once for all of them.
    * @param chunk The incoming chunk where parameter values are stored to unserialize
    * @param startPos The start position in the chunk where parameter values are stored
-   * @return The new chunk position (endPos) */
+   * @return The new chunk position (endPos), or -1 if a packed state was damaged (in which case no parameters were changed) */
   int UnserializeParams(const IByteChunk& chunk, int startPos);
+  
+  /** Checks for the header of a packed state (see SetPackedParamState()) at startPos.
+   * @param pData The state data
+   * @param dataSize The size of the state data in bytes
+   * @param startPos The position in the data where the parameter values start
+   * @param nStored Set to the number of parameter values in a packed state, or -1 if there is no header
+   * @return The position of the values, or -1 if there is a header but the values are missing or don't match the checksum */
+  static int GetPackedParamsPos(const uint8_t* pData, int dataSize, int startPos, int& nStored);
     
   /** Override this method to serialize custom state data, if your plugin does state chunks.
    * @param chunk The output bytechunk where data can be serialized
@@ -334,7 +372,8 @@ public:
    * @param func A lambda function to modify the parameter. Ideas: you could randomise the parameter value or reset to default, modify certain params based on their group */
   void ForParamInRange(int startIdx, int endIdx, std::function<void(int paramIdx, IParam& param)> func);
   
-  /** Modify a parameter group simulataneously
+  /** Modify a parameter group simulataneously. This iterates over the parameter index with its mutex locked, so it doesn't allocate but may wait
+   * for another thread looking up parameters, and isn't meant for the audio thread. func must not add, remove or initialise parameters
    * @param paramGroup The name of the group to modify
    * @param func A lambda function to modify the parameter. Ideas: you could randomise the parameter value or reset to default*/
   void ForParamInGroup(const char* paramGroup, std::function<void(int paramIdx, IParam& param)> func);
@@ -345,7 +384,7 @@ public:
    * @param nParams The number of parameters to copy */
   void CopyParamValues(int startIdx, int destIdx, int nParams);
   
-  /** Copy a range of parameter values for a parameter group
+  /** Copy a range of parameter values for a parameter group. Like ForParamInGroup(), this locks the parameter index and isn't meant for the audio thread
    * @param inGroup The name of the group to copy from
    * @param outGroup The name of the group to copy to */
   void CopyParamValues(const char* inGroup, const char* outGroup);
@@ -393,6 +432,8 @@ private:
   int mCurrentPresetIdx = 0;
   /** \c true if the plug-in does opaque state chunks. If false the host will provide a default interface */
   bool mStateChunks = false;
+  /** \c true if SerializeParams() writes a header and checksum before the values, see SetPackedParamState() */
+  bool mPackedParamState = false;
   /** The name of this plug-in */
   WDL_String mPluginName;
   /** Product name: if the plug-in is part of collection of plug-ins it might be one product */
@@ -419,6 +460,8 @@ private:
   bool mHostResize = false;
   /** A list of unique cstrings found specified as "parameter groups" when defining IParams. These are used in various APIs to group parameters together in automation dialogues. */
   WDL_PtrList<const char> mParamGroups;
+  /** The index in mParamGroups of each group name */
+  WDL_StringKeyedHashArray<int> mParamGroupIdxs;
   /** "Baked in" Factory presets */
   WDL_PtrList<IPreset> mPresets;
 
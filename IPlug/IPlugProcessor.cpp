@@ -27,6 +27,7 @@ IPlugProcessor::IPlugProcessor(const Config& config, EAPI plugAPI)
 , mDoesMIDIOut(config.plugDoesMidiOut)
 , mDoesMPE(config.plugDoesMPE)
 , mLatency(config.latency)
+, mDenormalMode((EDenormalMode) config.denormalMode)
 {
   int totalNInBuses, totalNOutBuses;
   int totalNInChans, totalNOutChans;
@@ -35,26 +36,18 @@ IPlugProcessor::IPlugProcessor(const Config& config, EAPI plugAPI)
 
   mScratchData[ERoute::kInput].Resize(totalNInChans);
   mScratchData[ERoute::kOutput].Resize(totalNOutChans);
+  mChannelData[ERoute::kInput].resize(totalNInChans);
+  mChannelData[ERoute::kOutput].resize(totalNOutChans);
 
-  sample** ppInData = mScratchData[ERoute::kInput].Get();
-
-  for (auto i = 0; i < totalNInChans; ++i, ++ppInData)
+  for (int d = 0; d < 2; d++)
   {
-    IChannelData<>* pInChannel = new IChannelData<>;
-    pInChannel->mConnected = false;
-    pInChannel->mData = ppInData;
-    mChannelData[ERoute::kInput].Add(pInChannel);
-  }
+    sample** ppData = mScratchData[d].Get();
 
-  sample** ppOutData = mScratchData[ERoute::kOutput].Get();
-
-  for (auto i = 0; i < totalNOutChans; ++i, ++ppOutData)
-  {
-    IChannelData<>* pOutChannel = new IChannelData<>;
-    pOutChannel->mConnected = false;
-    pOutChannel->mData = ppOutData;
-    pOutChannel->mIncomingData = nullptr;
-    mChannelData[ERoute::kOutput].Add(pOutChannel);
+    for (auto& channel : mChannelData[d])
+    {
+      channel.mData = ppData++;
+      *channel.mData = nullptr;
+    }
   }
 }
 
@@ -62,15 +55,13 @@ IPlugProcessor::~IPlugProcessor()
 {
   TRACE
 
-  mChannelData[ERoute::kInput].Empty(true);
-  mChannelData[ERoute::kOutput].Empty(true);
   mIOConfigs.Empty(true);
 }
 
 void IPlugProcessor::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
 {
-  const int nIn = mChannelData[ERoute::kInput].GetSize();
-  const int nOut = mChannelData[ERoute::kOutput].GetSize();
+  const int nIn = MaxNChannels(ERoute::kInput);
+  const int nOut = MaxNChannels(ERoute::kOutput);
 
   int j = 0;
   for (int i = 0; i < nOut; ++i)
@@ -227,19 +218,6 @@ int IPlugProcessor::MaxNChannelsForBus(ERoute direction, int busIdx) const
   return maxChansOnBuses.size() > 0 ? maxChansOnBuses[busIdx] : 0;
 }
 
-int IPlugProcessor::NChannelsConnected(ERoute direction) const
-{
-  const WDL_PtrList<IChannelData<>>& channelData = mChannelData[direction];
-
-  int count = 0;
-  for (auto i = 0; i<channelData.GetSize(); i++)
-  {
-    count += (int) IsChannelConnected(direction, i);
-  }
-
-  return count;
-}
-
 bool IPlugProcessor::LegalIO(int NInputChans, int NOutputChans) const
 {
   bool legal = false;
@@ -266,7 +244,7 @@ void IPlugProcessor::LimitToStereoIO()
 void IPlugProcessor::SetChannelLabel(ERoute direction, int idx, const char* formatStr, bool zeroBased)
 {
   if (idx >= 0 && idx < MaxNChannels(direction))
-    mChannelData[direction].Get(idx)->mLabel.SetFormatted(MAX_CHAN_NAME_LEN, formatStr, idx+(!zeroBased));
+    mChannelData[direction][idx].mLabel.SetFormatted(MAX_CHAN_NAME_LEN, formatStr, idx+(!zeroBased));
 }
 
 void IPlugProcessor::SetLatency(int samples)
@@ -425,57 +403,65 @@ int IPlugProcessor::GetAUPluginType() const
 
 void IPlugProcessor::SetChannelConnections(ERoute direction, int idx, int n, bool connected)
 {
-  WDL_PtrList<IChannelData<>>& channelData = mChannelData[direction];
+  IChannelData<>* pChannels = mChannelData[direction].data();
 
-  const auto endIdx = std::min(idx + n, channelData.GetSize());
+  const auto endIdx = std::min(idx + n, MaxNChannels(direction));
 
   for (auto i = idx; i < endIdx; ++i)
   {
-    IChannelData<>* pChannel = channelData.Get(i);
-    pChannel->mConnected = connected;
+    IChannelData<>& channel = pChannels[i];
+    channel.mConnected = connected;
 
     if (!connected)
-      *(pChannel->mData) = pChannel->mScratchBuf.Get();
+      *(channel.mData) = channel.mScratchBuf;
   }
+
+  // the topology only changes here, so the count is kept up to date rather than scanned for every block
+  int count = 0;
+
+  for (const auto& channel : mChannelData[direction])
+    count += (int) channel.mConnected;
+
+  mNChannelsConnected[direction] = count;
 }
 
 void IPlugProcessor::AttachBuffers(ERoute direction, int idx, int n, PLUG_SAMPLE_DST** ppData, int)
 {
-  WDL_PtrList<IChannelData<>>& channelData = mChannelData[direction];
+  IChannelData<>* pChannels = mChannelData[direction].data();
 
-  const auto endIdx = std::min(idx + n, channelData.GetSize());
+  const auto endIdx = std::min(idx + n, MaxNChannels(direction));
 
   for (auto i = idx; i < endIdx; ++i)
   {
-    IChannelData<>* pChannel = channelData.Get(i);
+    IChannelData<>& channel = pChannels[i];
 
-    if (pChannel->mConnected)
-      *(pChannel->mData) = *(ppData++);
+    if (channel.mConnected)
+      *(channel.mData) = *(ppData++);
   }
 }
 
 void IPlugProcessor::AttachBuffers(ERoute direction, int idx, int n, PLUG_SAMPLE_SRC** ppData, int nFrames)
 {
-  WDL_PtrList<IChannelData<>>& channelData = mChannelData[direction];
+  IChannelData<>* pChannels = mChannelData[direction].data();
 
-  const auto endIdx = std::min(idx + n, channelData.GetSize());
+  const auto endIdx = std::min(idx + n, MaxNChannels(direction));
 
   for (auto i = idx; i < endIdx; ++i)
   {
-    IChannelData<>* pChannel = channelData.Get(i);
+    IChannelData<>& channel = pChannels[i];
 
-    if (pChannel->mConnected)
+    if (channel.mConnected)
     {
       if (direction == ERoute::kInput)
       {
-        PLUG_SAMPLE_DST* pScratch = pChannel->mScratchBuf.Get();
+        PLUG_SAMPLE_DST* pScratch = channel.mScratchBuf;
         CastCopy(pScratch, *(ppData++), nFrames);
-        *(pChannel->mData) = pScratch;
+        *(channel.mData) = pScratch;
       }
       else // output
       {
-        *(pChannel->mData) = pChannel->mScratchBuf.Get();
-        pChannel->mIncomingData = *(ppData++);
+        *(channel.mData) = channel.mScratchBuf;
+        channel.mIncomingData = *(ppData++);
       }
     }
   }
@@ -494,12 +480,9 @@ void IPlugProcessor::PassThroughBuffers(PLUG_SAMPLE_SRC type, int nFrames)
   // for PLUG_SAMPLE_SRC bit buffers, first run the delay (if mLatency) on the PLUG_SAMPLE_DST IPlug buffers
   PassThroughBuffers(PLUG_SAMPLE_DST(0.), nFrames);
 
-  int i, n = MaxNChannels(ERoute::kOutput);
-  IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
-
-  for (i = 0; i < n; ++i, ++ppOutChannel)
+  for (auto& outChannel : mChannelData[ERoute::kOutput])
   {
-    IChannelData<>* pOutChannel = *ppOutChannel;
+    IChannelData<>* pOutChannel = &outChannel;
     if (pOutChannel->mConnected)
     {
       CastCopy(pOutChannel->mIncomingData, *(pOutChannel->mData), nFrames);
@@ -515,12 +498,9 @@ void IPlugProcessor::ProcessBuffers(PLUG_SAMPLE_DST type, int nFrames)
 void IPlugProcessor::ProcessBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 {
   ProcessBuffers((PLUG_SAMPLE_DST) 0, nFrames);
-  int i, n = MaxNChannels(ERoute::kOutput);
-  IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
-
-  for (i = 0; i < n; ++i, ++ppOutChannel)
+  for (auto& outChannel : mChannelData[ERoute::kOutput])
   {
-    IChannelData<>* pOutChannel = *ppOutChannel;
+    IChannelData<>* pOutChannel = &outChannel;
 
     if (pOutChannel->mConnected)
     {
@@ -532,12 +512,9 @@ void IPlugProcessor::ProcessBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 void IPlugProcessor::ProcessBuffersAccumulating(int nFrames)
 {
   ProcessBuffers((PLUG_SAMPLE_DST) 0, nFrames);
-  int i, n = MaxNChannels(ERoute::kOutput);
-  IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
-
-  for (i = 0; i < n; ++i, ++ppOutChannel)
+  for (auto& outChannel : mChannelData[ERoute::kOutput])
   {
-    IChannelData<>* pOutChannel = *ppOutChannel;
+    IChannelData<>* pOutChannel = &outChannel;
     if (pOutChannel->mConnected)
     {
       PLUG_SAMPLE_SRC* pDest = pOutChannel->mIncomingData;
@@ -552,39 +529,35 @@ void IPlugProcessor::ProcessBuffersAccumulating(int nFrames)
 
 void IPlugProcessor::ZeroScratchBuffers()
 {
-  int i, nIn = MaxNChannels(ERoute::kInput), nOut = MaxNChannels(ERoute::kOutput);
-
-  for (i = 0; i < nIn; ++i)
-  {
-    IChannelData<>* pInChannel = mChannelData[ERoute::kInput].Get(i);
-    memset(pInChannel->mScratchBuf.Get(), 0, mBlockSize * sizeof(PLUG_SAMPLE_DST));
-  }
-
-  for (i = 0; i < nOut; ++i)
-  {
-    IChannelData<>* pOutChannel = mChannelData[ERoute::kOutput].Get(i);
-    memset(pOutChannel->mScratchBuf.Get(), 0, mBlockSize * sizeof(PLUG_SAMPLE_DST));
-  }
+  for (int d = 0; d < 2; d++)
+    memset(mScratchMemory[d].Get(), 0, mScratchMemory[d].GetSize() * sizeof(PLUG_SAMPLE_DST));
 }
 
 void IPlugProcessor::SetBlockSize(int blockSize)
 {
   if (blockSize != mBlockSize)
   {
-    int i, nIn = MaxNChannels(ERoute::kInput), nOut = MaxNChannels(ERoute::kOutput);
+    // one block of memory per direction, with every channel starting on a cache line
+    constexpr int kAlign = 64;
+    constexpr int kAlignSamples = kAlign / sizeof(PLUG_SAMPLE_DST);
+    const int stride = ((blockSize + kAlignSamples - 1) / kAlignSamples) * kAlignSamples;
 
-    for (i = 0; i < nIn; ++i)
+    for (int d = 0; d < 2; d++)
     {
-      IChannelData<>* pInChannel = mChannelData[ERoute::kInput].Get(i);
-      pInChannel->mScratchBuf.Resize(blockSize);
-      memset(pInChannel->mScratchBuf.Get(), 0, blockSize * sizeof(PLUG_SAMPLE_DST));
-    }
+      WDL_TypedBuf<PLUG_SAMPLE_DST>& memory = mScratchMemory[d];
+      memory.Resize(MaxNChannels((ERoute) d) * stride + kAlignSamples, false);
+      memset(memory.Get(), 0, memory.GetSize() * sizeof(PLUG_SAMPLE_DST));
+      PLUG_SAMPLE_DST* pScratch = memory.GetAligned(kAlign);
 
-    for (i = 0; i < nOut; ++i)
-    {
-      IChannelData<>* pOutChannel = mChannelData[ERoute::kOutput].Get(i);
-      pOutChannel->mScratchBuf.Resize(blockSize);
-      memset(pOutChannel->mScratchBuf.Get(), 0, blockSize * sizeof(PLUG_SAMPLE_DST));
+      for (auto& channel : mChannelData[d])
+      {
+        // channels that are using their scratch buffer need to follow it
+        if (*(channel.mData) == channel.mScratchBuf)
+          *(channel.mData) = pScratch;
+
+        channel.mScratchBuf = pScratch;
+        pScratch += stride;
+      }
     }
 
     mBlockSize = blockSize;
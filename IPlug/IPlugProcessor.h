@@ -25,6 +25,7 @@
 #include "IPlugConstants.h"
 #include "IPlugStructs.h"
 #include "IPlugUtilities.h"
+#include "IPlugDenormals.h"
 #include "NChanDelay.h"
 
 /**
@@ -109,6 +110,12 @@ public:
   /** @return The tail size in samples (useful for reverberation plug-ins, that may need to decay after the transport stops or an audio item ends) */
   int GetTailSize() { return mTailSize; }
 
+  /** @return How the floating point mode is set around ProcessBlock(), see EDenormalMode */
+  EDenormalMode GetDenormalMode() const { return mDenormalMode.load(std::memory_order_relaxed); }
+
+  /** @return With kDenormalsCount, the number of process calls so far in which denormals were produced or used */
+  int GetDenormalBlockCount() const { return mDenormalBlockCount.load(std::memory_order_relaxed); }
+
   /** @return \c true if the plugin is currently bypassed */
   bool GetBypassed() const { return mBypassed; }
 
@@ -172,16 +179,16 @@ public:
 
   /** @param direction Whether you want to test inputs or outputs
    * @return Total number of input or output channel buffers (not necessarily connected) */
-  int MaxNChannels(ERoute direction) const { return mChannelData[direction].GetSize(); }
+  int MaxNChannels(ERoute direction) const { return static_cast<int>(mChannelData[direction].size()); }
 
   /** @param direction Whether you want to test inputs or outputs
     * @param chIdx channel index
     * @return \c true if the host has connected this channel*/
-  bool IsChannelConnected(ERoute direction, int chIdx) const { return (chIdx < mChannelData[direction].GetSize() && mChannelData[direction].Get(chIdx)->mConnected); }
+  bool IsChannelConnected(ERoute direction, int chIdx) const { return (chIdx < MaxNChannels(direction) && mChannelData[direction][chIdx].mConnected); }
 
   /** @param direction Whether you want to test inputs or outputs
    * @return The number of channels connected for input/output. WARNING: this assumes consecutive channel connections */
-  int NChannelsConnected(ERoute direction) const;
+  int NChannelsConnected(ERoute direction) const { return mNChannelsConnected[direction]; }
 
   /** Convenience method to find out how many input channels are connected
    * @return The number of channels connected for input. WARNING: this assumes consecutive channel connections */
@@ -234,6 +241,11 @@ public:
    @param latency Latency in samples */
   virtual void SetLatency(int latency);
 
+  /** Changes how the floating point mode is set around ProcessBlock(), the default comes from PLUG_DENORMAL_MODE in config.h.
+   * With kDenormalsFlush, code in ProcessBlock() can leave out per-sample denormal fixes
+   * @param mode See EDenormalMode */
+  void SetDenormalMode(EDenormalMode mode) { mDenormalMode.store(mode, std::memory_order_relaxed); }
+
   /** Call this method if you need to update the tail size at runtime, for example if the decay time of your reverb effect changes
    * Some apis have special interpretations of certain numbers. For VST3 set to 0xffffffff for infinite tail, or 0 for none (default)
    * For VST2 setting to 1 means no tail
@@ -272,7 +284,9 @@ protected:
   void SetBypassed(bool bypassed) { mBypassed = bypassed; }
   void SetTimeInfo(const ITimeInfo& timeInfo) { mTimeInfo = timeInfo; }
   void SetRenderingOffline(bool renderingOffline) { mRenderingOffline = renderingOffline; }
-  const WDL_String& GetChannelLabel(ERoute direction, int idx) { return mChannelData[direction].Get(idx)->mLabel; }
+  /** For IDenormalScope in kDenormalsCount mode */
+  std::atomic<int>* GetDenormalBlockCounter() { return &mDenormalBlockCount; }
+  const WDL_String& GetChannelLabel(ERoute direction, int idx) { return mChannelData[direction][idx].mLabel; }
 
 private:
   /** See EIPlugPluginTypes */
@@ -291,6 +305,10 @@ private:
   int mBlockSize = 0;
   /** Current tail size (in samples) */
   int mTailSize = 0;
+  /** How the API class sets the floating point mode around processing */
+  std::atomic<EDenormalMode> mDenormalMode {kDenormalsFlush};
+  /** Process calls that hit denormals, in kDenormalsCount mode */
+  std::atomic<int> mDenormalBlockCount {0};
   /** \c true if the plug-in is bypassed */
   bool mBypassed = false;
   /** \c true if the plug-in is rendering off-line*/
@@ -299,8 +317,12 @@ private:
   WDL_PtrList<IOConfig> mIOConfigs;
   /* Manages pointers to the actual data for each channel */
   WDL_TypedBuf<sample*> mScratchData[2];
-  /* A list of IChannelData structures corresponding to every input/output channel */
-  WDL_PtrList<IChannelData<>> mChannelData[2];
+  /* A flat table of IChannelData structures corresponding to every input/output channel, built once in the constructor */
+  std::vector<IChannelData<>> mChannelData[2];
+  /* The scratch memory for all the channels of each direction, in one block. Each channel starts on a cache line */
+  WDL_TypedBuf<PLUG_SAMPLE_DST> mScratchMemory[2];
+  /* The number of connected channels for each direction, updated in SetChannelConnections() */
+  int mNChannelsConnected[2] = {0, 0};
 protected: // these members are protected because they need to be access by the API classes, and don't want a setter/getter
   /** A multi-channel delay line used to delay the bypassed signal when a plug-in with latency is bypassed. */
   std::unique_ptr<NChanDelayLine<sample>> mLatencyDelay = nullptr;
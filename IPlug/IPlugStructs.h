@@ -413,6 +413,7 @@ struct Config
   int plugMaxHeight;
   bool plugHostResize;
   const char* bundleID;
+  int denormalMode;
   
   Config(int nParams,
               int nPresets,
@@ -437,7 +438,8 @@ struct Config
               int plugMaxWidth,
               int plugMinHeight,
               int plugMaxHeight,
-              const char* bundleID)
+              const char* bundleID,
+              int denormalMode = kDenormalsFlush)
               
   : nParams(nParams)
   , nPresets(nPresets)
@@ -463,6 +465,7 @@ struct Config
   , plugMaxHeight(plugMaxHeight)
   , plugHostResize(plugHostResize)
   , bundleID(bundleID)
+  , denormalMode(denormalMode)
   {};
 };
 
@@ -473,7 +476,7 @@ struct IChannelData
   bool mConnected = false;
   TOUT** mData = nullptr; // If this is for an input channel, points into IPlugProcessor::mInData, if it's for an output channel points into IPlugProcessor::mOutData
   TIN* mIncomingData = nullptr;
-  WDL_TypedBuf<TOUT> mScratchBuf;
+  TOUT* mScratchBuf = nullptr; // points into IPlugProcessor's single block of scratch memory for the direction
   WDL_String mLabel;
 };
 
@@ -0,0 +1,290 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugSysExQueue
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "heapbuf.h"
+
+#include "IPlugPlatform.h"
+#include "IPlugMidi.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A lock-free SPSC queue used to transfer variable-length SysEx messages between threads.
+ * Messages are stored as length-prefixed records in a single contiguous byte buffer, so there is no fixed per-message slot size.
+ * A record never straddles the end of the buffer: if it doesn't fit before the end, a wrap marker is written and the record starts at the beginning.
+ * This means the consumer can read the message bytes in place via Peek(), without copying them.
+ * The producer can either Push() a complete message, or build one up over several calls with Begin()/Append()/Commit(),
+ * e.g. when a large SysEx dump arrives split across several MIDI driver callbacks. */
+class IPlugSysExQueue final
+{
+public:
+  /** IPlugSysExQueue constructor
+   * @param maxMessageSize The size in bytes of the largest message that the queue accepts. The queue can hold several smaller messages in the same space */
+  IPlugSysExQueue(int maxMessageSize)
+  {
+    Resize(maxMessageSize);
+  }
+
+  ~IPlugSysExQueue() {}
+
+  IPlugSysExQueue(const IPlugSysExQueue&) = delete;
+  IPlugSysExQueue& operator=(const IPlugSysExQueue&) = delete;
+
+  /** Resize the queue, discarding its contents. This is not thread safe, and must not be called while either thread is using the queue
+   * @param maxMessageSize The size in bytes of the largest message that the queue accepts */
+  void Resize(int maxMessageSize)
+  {
+    mMaxMessageSize = maxMessageSize;
+
+    // twice the record size, so that a maximum sized message always fits contiguously once the queue has drained
+    mData.Resize(static_cast<int>(2 * (kHeaderSize + Align(maxMessageSize)) + kAlign));
+    mWriteIndex.store(0);
+    mReadIndex.store(0);
+    mPendingStart = 0;
+    mPendingSize = 0;
+    mPendingOffset = 0;
+    mWriting = false;
+  }
+
+  /** Copy a complete message into the queue (producer thread only)
+   * @param msg The message to copy. Its data only needs to be valid for the duration of this call
+   * @return \c true on success, \c false if there was not enough space, in which case the message is dropped */
+  bool Push(const ISysEx& msg)
+  {
+    Begin(msg.mOffset);
+    return Append(msg.mData, msg.mSize) && Commit();
+  }
+
+  /** Start building a message that will be written with one or more calls to Append() (producer thread only).
+   * Any message that was started but not committed is discarded.
+   * @param offset The sample offset of the message */
+  void Begin(int offset = 0)
+  {
+    mPendingStart = mWriteIndex.load(std::memory_order_relaxed);
+    mPendingSize = 0;
+    mPendingOffset = offset;
+    mWriting = true;
+  }
+
+  /** Append bytes to the message started with Begin() (producer thread only). Nothing is visible to the consumer until Commit() is called.
+   * @param pData The bytes to append
+   * @param size The number of bytes to append
+   * @return \c true on success, \c false if no message was started, the message would be larger than MaxMessageSize(), or there was not enough space, in which case the whole message is discarded */
+  bool Append(const uint8_t* pData, int size)
+  {
+    if (!mWriting)
+      return false;
+
+    // the buffer has room for a larger record when it is empty, but consumers only need to handle up to MaxMessageSize()
+    if (size < 0 || mPendingSize + size > mMaxMessageSize || !Reserve(mPendingSize + size))
+    {
+      Abort();
+      return false;
+    }
+
+    if (size > 0)
+      memcpy(mData.Get() + mPendingStart + kHeaderSize + mPendingSize, pData, size);
+
+    mPendingSize += size;
+    return true;
+  }
+
+  /** Publish the message started with Begin() to the consumer (producer thread only)
+   * @return \c true on success, \c false if no message was started, or there was not enough space */
+  bool Commit()
+  {
+    if (!mWriting || !Reserve(mPendingSize))
+    {
+      Abort();
+      return false;
+    }
+
+    mWriting = false;
+
+    const size_t currentWriteIndex = mWriteIndex.load(std::memory_order_relaxed);
+
+    // if the record has been moved to the start of the buffer, leave a marker so that the consumer skips the tail
+    if (mPendingStart != currentWriteIndex)
+      WriteHeader(currentWriteIndex, kWrapMarker, 0);
+
+    WriteHeader(mPendingStart, mPendingSize, mPendingOffset);
+
+    mWriteIndex.store(Next(mPendingStart, mPendingSize), std::memory_order_release);
+    return true;
+  }
+
+  /** Discard a message that was started with Begin() but not committed (producer thread only) */
+  void Abort()
+  {
+    mWriting = false;
+    mPendingSize = 0;
+  }
+
+  /** @return \c true if the producer has started a message with Begin() that has not yet been committed or aborted */
+  bool IsWriting() const { return mWriting; }
+
+  /** Get the oldest message in the queue without copying it (consumer thread only)
+   * @param msg Will be set to point at the message bytes inside the queue. The data stays valid until Remove() is called
+   * @return \c true if there was a message, \c false if the queue was empty */
+  bool Peek(ISysEx& msg)
+  {
+    size_t currentReadIndex;
+    int size, offset;
+
+    if (!ReadFront(currentReadIndex, size, offset))
+      return false;
+
+    msg = ISysEx(offset, mData.Get() + currentReadIndex + kHeaderSize, size);
+    return true;
+  }
+
+  /** Remove the oldest message from the queue, releasing its space to the producer (consumer thread only)
+   * @return \c true if there was a message to remove */
+  bool Remove()
+  {
+    size_t currentReadIndex;
+    int size, offset;
+
+    if (!ReadFront(currentReadIndex, size, offset))
+      return false;
+
+    mReadIndex.store(Next(currentReadIndex, size), std::memory_order_release);
+    return true;
+  }
+
+  /** @return \c true if the queue was empty at the time of the call */
+  bool WasEmpty() const
+  {
+    return (mWriteIndex.load() == mReadIndex.load());
+  }
+
+  /** @return The size in bytes of the largest message that the queue accepts, which always fits once the queue has drained */
+  int MaxMessageSize() const
+  {
+    return mMaxMessageSize;
+  }
+
+private:
+  static constexpr size_t kAlign = 8;
+  static constexpr size_t kHeaderSize = 2 * sizeof(int32_t); // size, offset
+  static constexpr int32_t kWrapMarker = -1;
+
+  static size_t Align(size_t size)
+  {
+    return (size + (kAlign - 1)) & ~(kAlign - 1);
+  }
+
+  /** @return The index following a record of size bytes starting at idx */
+  size_t Next(size_t idx, int size) const
+  {
+    const size_t next = idx + kHeaderSize + Align(size);
+    return (next == static_cast<size_t>(mData.GetSize())) ? 0 : next;
+  }
+
+  /** @return The number of contiguous bytes that the producer may write, starting at idx.
+   * A record may not end exactly on the read index, otherwise a full queue would look empty */
+  size_t ContiguousSpace(size_t idx, size_t read) const
+  {
+    const size_t capacity = mData.GetSize();
+
+    if (idx >= read)
+      return capacity - idx - (read == 0 ? kAlign : 0);
+    else
+      return read - idx - kAlign;
+  }
+
+  /** Make sure there is contiguous space for a pending record with payloadSize bytes, moving it to the start of the buffer if required */
+  bool Reserve(int payloadSize)
+  {
+    const size_t needed = kHeaderSize + Align(payloadSize);
+    const size_t read = mReadIndex.load(std::memory_order_acquire);
+
+    if (needed <= ContiguousSpace(mPendingStart, read))
+      return true;
+
+    const size_t currentWriteIndex = mWriteIndex.load(std::memory_order_relaxed);
+
+    // try to wrap the record to the start of the buffer, as long as that doesn't run into the consumer
+    if (mPendingStart == currentWriteIndex && currentWriteIndex >= read && read > 0 && needed <= ContiguousSpace(0, read))
+    {
+      if (mPendingSize > 0)
+        memcpy(mData.Get() + kHeaderSize, mData.Get() + mPendingStart + kHeaderSize, mPendingSize);
+
+      mPendingStart = 0;
+      return true;
+    }
+
+    return false;
+  }
+
+  /** Find the oldest record, skipping a wrap marker if necessary */
+  bool ReadFront(size_t& currentReadIndex, int& size, int& offset)
+  {
+    currentReadIndex = mReadIndex.load(std::memory_order_relaxed);
+    const size_t currentWriteIndex = mWriteIndex.load(std::memory_order_acquire);
+
+    if (currentReadIndex == currentWriteIndex)
+      return false; // empty the queue
+
+    ReadHeader(currentReadIndex, size, offset);
+
+    if (size == kWrapMarker)
+    {
+      currentReadIndex = 0;
+      mReadIndex.store(currentReadIndex, std::memory_order_release);
+
+      if (currentReadIndex == currentWriteIndex)
+        return false;
+
+      ReadHeader(currentReadIndex, size, offset);
+    }
+
+    return true;
+  }
+
+  void WriteHeader(size_t idx, int32_t size, int32_t offset)
+  {
+    const int32_t header[2] = { size, offset };
+    memcpy(mData.Get() + idx, header, kHeaderSize);
+  }
+
+  void ReadHeader(size_t idx, int& size, int& offset) const
+  {
+    int32_t header[2];
+    memcpy(header, mData.Get() + idx, kHeaderSize);
+    size = header[0];
+    offset = header[1];
+  }
+
+  WDL_TypedBuf<uint8_t> mData;
+  std::atomic<size_t> mWriteIndex{0};
+  std::atomic<size_t> mReadIndex{0};
+
+  int mMaxMessageSize = 0;
+
+  // producer state for the message currently being written
+  size_t mPendingStart = 0;
+  int mPendingSize = 0;
+  int mPendingOffset = 0;
+  bool mWriting = false;
+};
+
+END_IPLUG_NAMESPACE
@@ -13,6 +13,12 @@
  * @brief Timer implementation
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
 #include "IPlugTimer.h"
 #include "IPlugTaskThread.h"
 
@@ -137,7 +143,14 @@ Timer_impl::Timer_impl(ITimerFunction func, uint32_t intervalMs)
 , mIntervalMs(intervalMs)
 , mID(0)
 {
-  auto cb = [&](uint64_t time) -> bool { mTimerFunc(*this); return true; };
+  mRunning = std::make_shared<std::atomic<bool>>(true);
+  auto running = mRunning;
+  auto cb = [this, running](uint64_t time) -> bool {
+    if (!running->load())
+      return false;
+    mTimerFunc(*this);
+    return true;
+  };
   Task task = Task::FromMs(intervalMs, intervalMs, cb);
   mID = sMainThread.Push(task);
 }
@@ -151,6 +164,7 @@ void Timer_impl::Stop()
 {
   if (mID)
   {
+    mRunning->store(false);
     sMainThread.Cancel(mID);
     mID = 0;
   }
@@ -248,3 +262,218 @@ void Timer_impl::TimerProc(void* userData)
   itimer->mTimerFunc(*itimer);
 }
 #endif
+
+#pragma mark - Shared timer
+
+/** One client of the process wide shared timer, see Timer::CreateShared() */
+class SharedTimer_impl final : public Timer
+{
+public:
+  SharedTimer_impl(ITimerFunction func, IActiveFunction isActive, uint32_t intervalMs, uint32_t maxIntervalMs);
+  ~SharedTimer_impl();
+
+  void Stop() override;
+
+  static uint64_t GetWakeups() { return sWakeups.load(); }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /** The part of a client that the platform timer's callback uses. The callback holds a reference to it while it calls the
+   * client's functions without sMutex locked, and mMutex keeps Stop() from returning while one of them is running */
+  struct Client
+  {
+    SharedTimer_impl* mTimer;
+    ITimerFunction mTimerFunc;
+    IActiveFunction mIsActive;
+    uint32_t mIntervalMs;
+    uint32_t mMaxIntervalMs;
+    Clock::time_point mLastCall; // accessed with mMutex locked
+    bool mAlive = true; // accessed with mMutex locked
+    WDL_Mutex mMutex; // recursive, so a client can stop itself from its own callback
+  };
+
+  /** How long all clients have to be inactive before the platform timer starts to back off */
+  static constexpr uint32_t kBackOffDelayMs = 500;
+
+  static void TimerProc(Timer& t);
+  static void GetIntervalRange(uint32_t& minIntervalMs, uint32_t& maxIntervalMs);
+  static void Reschedule(uint32_t intervalMs);
+
+  std::shared_ptr<Client> mClient;
+  bool mRunning = false;
+
+  // all accessed with sMutex locked. Clients' functions are never called with it locked, so one that blocks doesn't hold
+  // up creating or stopping timers in other instances
+  static WDL_Mutex sMutex;
+  static WDL_PtrList<SharedTimer_impl> sClients;
+  static std::unique_ptr<Timer> sTimer;
+  static std::unique_ptr<Timer> sRetiredTimer;
+  static uint32_t sIntervalMs;
+  static Clock::time_point sLastActive;
+
+  static std::atomic<uint64_t> sWakeups;
+};
+
+WDL_Mutex SharedTimer_impl::sMutex;
+WDL_PtrList<SharedTimer_impl> SharedTimer_impl::sClients;
+std::unique_ptr<Timer> SharedTimer_impl::sTimer;
+std::unique_ptr<Timer> SharedTimer_impl::sRetiredTimer;
+uint32_t SharedTimer_impl::sIntervalMs = 0;
+SharedTimer_impl::Clock::time_point SharedTimer_impl::sLastActive;
+std::atomic<uint64_t> SharedTimer_impl::sWakeups {0};
+
+Timer* Timer::CreateShared(ITimerFunction func, IActiveFunction isActive, uint32_t intervalMs, uint32_t maxIntervalMs)
+{
+  return new SharedTimer_impl(func, isActive, intervalMs, maxIntervalMs);
+}
+
+uint64_t Timer::GetSharedTimerWakeups()
+{
+  return SharedTimer_impl::GetWakeups();
+}
+
+SharedTimer_impl::SharedTimer_impl(ITimerFunction func, IActiveFunction isActive, uint32_t intervalMs, uint32_t maxIntervalMs)
+: mClient(std::make_shared<Client>())
+{
+  mClient->mTimer = this;
+  mClient->mTimerFunc = func;
+  mClient->mIsActive = isActive;
+  mClient->mIntervalMs = intervalMs > 0 ? intervalMs : 1;
+  mClient->mMaxIntervalMs = maxIntervalMs > mClient->mIntervalMs ? maxIntervalMs : mClient->mIntervalMs;
+  mClient->mLastCall = Clock::now();
+
+  WDL_MutexLock lock(&sMutex);
+  sClients.Add(this);
+  mRunning = true;
+
+  // start at the fast rate, a new client usually has something to do
+  sLastActive = Clock::now();
+  uint32_t minIntervalMs, longestIntervalMs;
+  GetIntervalRange(minIntervalMs, longestIntervalMs);
+
+  if (!sTimer || sIntervalMs != minIntervalMs)
+    Reschedule(minIntervalMs);
+}
+
+SharedTimer_impl::~SharedTimer_impl()
+{
+  Stop();
+}
+
+void SharedTimer_impl::Stop()
+{
+  {
+    // waits for a call to this client that is running on another thread, the callback sees mAlive and doesn't call it again
+    WDL_MutexLock clientLock(&mClient->mMutex);
+    mClient->mAlive = false;
+  }
+
+  WDL_MutexLock lock(&sMutex);
+
+  if (!mRunning)
+    return;
+
+  mRunning = false;
+  sClients.DeletePtr(this);
+
+  if (!sClients.GetSize())
+    Reschedule(0);
+}
+
+// static
+void SharedTimer_impl::GetIntervalRange(uint32_t& minIntervalMs, uint32_t& maxIntervalMs)
+{
+  minIntervalMs = maxIntervalMs = 0;
+
+  for (auto i = 0; i < sClients.GetSize(); i++)
+  {
+    const Client* pClient = sClients.Get(i)->mClient.get();
+
+    if (!i || pClient->mIntervalMs < minIntervalMs)
+      minIntervalMs = pClient->mIntervalMs;
+
+    if (!i || pClient->mMaxIntervalMs < maxIntervalMs)
+      maxIntervalMs = pClient->mMaxIntervalMs;
+  }
+}
+
+// static
+void SharedTimer_impl::Reschedule(uint32_t intervalMs)
+{
+  // This can be called from inside the platform timer's own callback, so the old timer is stopped
+  // straight away but only deleted on the next tick, or when the timer is next rescheduled
+  if (sTimer)
+  {
+    sTimer->Stop();
+    sRetiredTimer = std::move(sTimer);
+  }
+
+  sIntervalMs = intervalMs;
+
+  if (intervalMs)
+    sTimer = std::unique_ptr<Timer>(Timer::Create(&SharedTimer_impl::TimerProc, intervalMs));
+}
+
+// static
+void SharedTimer_impl::TimerProc(Timer& t)
+{
+  std::vector<std::shared_ptr<Client>> clients;
+  uint32_t intervalMs;
+
+  {
+    WDL_MutexLock lock(&sMutex);
+
+    if (&t != sTimer.get()) // a late callback from a timer that has been stopped
+      return;
+
+    sRetiredTimer = nullptr;
+    sWakeups++;
+    intervalMs = sIntervalMs;
+
+    clients.reserve(sClients.GetSize());
+    for (auto i = 0; i < sClients.GetSize(); i++)
+      clients.push_back(sClients.Get(i)->mClient);
+  }
+
+  const auto now = Clock::now();
+  const auto tolerance = std::chrono::milliseconds(intervalMs / 2); // so that timer jitter doesn't make inactive clients skip a whole tick
+  bool anyActive = false;
+
+  for (auto& pClient : clients)
+  {
+    WDL_MutexLock clientLock(&pClient->mMutex);
+
+    if (!pClient->mAlive) // stopped since the list was copied
+      continue;
+
+    const bool active = pClient->mIsActive ? pClient->mIsActive() : true;
+    anyActive |= active;
+
+    if (active || now - pClient->mLastCall + tolerance >= std::chrono::milliseconds(pClient->mMaxIntervalMs))
+    {
+      pClient->mLastCall = now;
+      pClient->mTimerFunc(*pClient->mTimer);
+    }
+  }
+
+  WDL_MutexLock lock(&sMutex);
+
+  // the clients may have stopped the timer, or created or stopped others, while they were called
+  if (!sClients.GetSize() || &t != sTimer.get())
+    return;
+
+  if (anyActive)
+    sLastActive = now;
+
+  uint32_t minIntervalMs, maxIntervalMs;
+  GetIntervalRange(minIntervalMs, maxIntervalMs);
+
+  uint32_t newIntervalMs = minIntervalMs;
+
+  if (now - sLastActive >= std::chrono::milliseconds(kBackOffDelayMs))
+    newIntervalMs = std::min(std::max(sIntervalMs * 2, minIntervalMs), maxIntervalMs);
+
+  if (newIntervalMs != sIntervalMs)
+    Reschedule(newIntervalMs);
+}
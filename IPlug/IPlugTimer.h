@@ -22,6 +22,8 @@
 #include <cstring>
 #include <cmath>
 #include <functional>
+#include <atomic>
+#include <memory>
 #include "ptrlist.h"
 #include "mutex.h"
 
@@ -50,9 +52,24 @@ struct Timer
   Timer& operator=(const Timer&) = delete;
   
   using ITimerFunction = std::function<void(Timer& t)>;
+  using IActiveFunction = std::function<bool()>;
 
   static Timer* Create(ITimerFunction func, uint32_t intervalMs);
 
+  /** Create a timer that shares a single platform timer with all the other shared timers in the process, rather than creating its own.
+   * Shared timers whose isActive function returns true are called every tick, the others only every maxIntervalMs.
+   * When no shared timer has been active for a while, the platform timer backs off towards the smallest maxIntervalMs of all the
+   * shared timers, so that none of them waits longer than it asked for, and it returns to the smallest intervalMs as soon as one becomes active again.
+   * @param func The function to call
+   * @param isActive Called on every tick to find out if the timer has work to do, or nullptr to always be active
+   * @param intervalMs The interval when active
+   * @param maxIntervalMs The longest interval between calls when inactive
+   * @return The new timer */
+  static Timer* CreateShared(ITimerFunction func, IActiveFunction isActive, uint32_t intervalMs, uint32_t maxIntervalMs);
+
+  /** @return The number of times the platform timer behind the shared timers has fired, for profiling */
+  static uint64_t GetSharedTimerWakeups();
+
   virtual ~Timer() {};
   virtual void Stop() = 0;
 };
@@ -108,6 +125,7 @@ private:
 
 #if IPLUG_EDITOR
   uint32_t mID;
+  std::shared_ptr<std::atomic<bool>> mRunning; // the task is cancelled asynchronously, so it checks this before calling back
 #else
   timer_t mID;
 #endif
@@ -182,6 +182,10 @@ END_IPLUG_NAMESPACE
 #define PLUG_LATENCY 0
 #endif
 
+#ifndef PLUG_DENORMAL_MODE
+#define PLUG_DENORMAL_MODE kDenormalsFlush
+#endif
+
 #ifndef PLUG_DOES_MIDI_IN
 #pragma message WARN("PLUG_DOES_MIDI_IN not defined, setting to 0")
 #define PLUG_DOES_MIDI_IN 0
@@ -435,7 +435,7 @@ BEGIN_IPLUG_NAMESPACE
 		              PLUG_UNIQUE_ID, PLUG_MFR_ID, PLUG_LATENCY, PLUG_DOES_MIDI_IN, PLUG_DOES_MIDI_OUT, PLUG_DOES_MPE,
 		              PLUG_DOES_STATE_CHUNKS, PLUG_TYPE, PLUG_HAS_UI, PLUG_WIDTH, PLUG_HEIGHT, PLUG_HOST_RESIZE,
 		              PLUG_MIN_WIDTH, PLUG_MAX_WIDTH, PLUG_MIN_HEIGHT, PLUG_MAX_HEIGHT,
-		              BUNDLE_ID); // TODO: Product Name?
+		              BUNDLE_ID, PLUG_DENORMAL_MODE); // TODO: Product Name?
 	}
 
 END_IPLUG_NAMESPACE
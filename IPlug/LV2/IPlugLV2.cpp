@@ -12,12 +12,18 @@
 
 #include <lv2/atom/atom.h>
 #include <lv2/atom/forge.h>
+#include <lv2/atom/util.h>
+#include <lv2/buf-size/buf-size.h>
 #include <lv2/midi/midi.h>
 #include <lv2/options/options.h>
 #include <lv2/patch/patch.h>
 #include <lv2/state/state.h>
+#include <lv2/time/time.h>
 #include <lv2/worker/worker.h>
-#include <lv2/patch/patch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 #define NOTIMP printf("%s: not implemented\n", __FUNCTION__);
 // Maximum number of DIGITS for IO configs (e.g. 9999 = 4 digits)
@@ -54,8 +60,24 @@ IPlugLV2DSP::IPlugLV2DSP(const InstanceInfo &info, const Config& config)
  
   Trace(TRACELOC, "%s", config.pluginName);
   
-  int nInputs = MaxNChannels(ERoute::kInput), nOutputs = MaxNChannels(ERoute::kOutput), nParams = NParams();
-  mPorts = new void *[nInputs + nOutputs + nParams + 2];
+  // each IO config is a separate plug-in, whose URI ends with #io_<index> (see descriptor()), with only that config's audio ports
+  int ioConfigIdx = 0;
+  const char* pIOSuffix = info.descriptor && info.descriptor->URI ? strrchr(info.descriptor->URI, '#') : nullptr;
+  if (pIOSuffix && !strncmp(pIOSuffix, "#io_", 4))
+    ioConfigIdx = atoi(pIOSuffix + 4);
+  const IOConfig* pIOConfig = GetIOConfig(ioConfigIdx) ? GetIOConfig(ioConfigIdx) : GetIOConfig(0);
+
+  int nInputs = pIOConfig ? pIOConfig->GetTotalNChannels(ERoute::kInput) : 0;
+  int nOutputs = pIOConfig ? pIOConfig->GetTotalNChannels(ERoute::kOutput) : 0;
+  int nParams = NParams();
+  mFirstControlPort = GetFirstControlPort(pIOConfig);
+  mPorts = new void *[mFirstControlPort + nParams](); // unconnected ports are nullptr
+  mInputPtrs.Resize(nInputs);
+  mOutputPtrs.Resize(nOutputs);
+  mLastControlValues.Resize(nParams);
+
+  for (int i = 0; i < nParams; i++)
+    mLastControlValues.Get()[i] = std::numeric_limits<float>::quiet_NaN();
   
   SetSampleRate(info.rate);
   
@@ -103,13 +125,25 @@ IPlugLV2DSP::IPlugLV2DSP(const InstanceInfo &info, const Config& config)
 #define GET_URID(name) urid_map->map(urid_map->handle, name)
     mCoreURIs.atom_Blank     = GET_URID(LV2_ATOM__Blank);
     mCoreURIs.atom_Object    = GET_URID(LV2_ATOM__Object);
-    mCoreURIs.atom_URID      = GET_URID(LV2_Atom__URID);
+    mCoreURIs.atom_URID      = GET_URID(LV2_ATOM__URID);
     mCoreURIs.atom_Float     = GET_URID(LV2_ATOM__Float);
     mCoreURIs.atom_Bool      = GET_URID(LV2_ATOM__Bool);
+    mCoreURIs.atom_Int       = GET_URID(LV2_ATOM__Int);
+    mCoreURIs.atom_Long      = GET_URID(LV2_ATOM__Long);
+    mCoreURIs.atom_Double    = GET_URID(LV2_ATOM__Double);
+    mCoreURIs.atom_Sequence  = GET_URID(LV2_ATOM__Sequence);
     mCoreURIs.midi_MidiEvent = GET_URID(LV2_MIDI__MidiEvent);
     mCoreURIs.patch_Set      = GET_URID(LV2_PATCH__Set);
     mCoreURIs.patch_property = GET_URID(LV2_PATCH__property);
     mCoreURIs.patch_value    = GET_URID(LV2_PATCH__value);
+    mCoreURIs.time_Position       = GET_URID(LV2_TIME__Position);
+    mCoreURIs.time_frame          = GET_URID(LV2_TIME__frame);
+    mCoreURIs.time_speed          = GET_URID(LV2_TIME__speed);
+    mCoreURIs.time_bar            = GET_URID(LV2_TIME__bar);
+    mCoreURIs.time_barBeat        = GET_URID(LV2_TIME__barBeat);
+    mCoreURIs.time_beatsPerBar    = GET_URID(LV2_TIME__beatsPerBar);
+    mCoreURIs.time_beatUnit       = GET_URID(LV2_TIME__beatUnit);
+    mCoreURIs.time_beatsPerMinute = GET_URID(LV2_TIME__beatsPerMinute);
 
     // Map all params to URIDs
     WDL_String uri;
@@ -123,6 +157,8 @@ IPlugLV2DSP::IPlugLV2DSP(const InstanceInfo &info, const Config& config)
   }
 
   SetBlockSize(block_size);
+  mMidiOutputQueue.Resize(block_size);
+  mMidiOutEventBuf.Resize(sizeof(LV2_Atom_Event) + mSysExOutputQueue.MaxMessageSize());
 
   // Default everything to connected, maybe: support less inputs/outpus then max (with separate descriptor, like Mono/Stereo/Surround 
   SetChannelConnections(ERoute::kInput, 0, nInputs, true);
@@ -136,32 +172,298 @@ IPlugLV2DSP::~IPlugLV2DSP()
   delete[] mPorts;
 }
 
+int IPlugLV2DSP::GetFirstControlPort(const IOConfig* pIOConfig)
+{
+  if (!pIOConfig)
+    return 2;
+
+  // control input and output, then the config's audio inputs and outputs, as written by write_also_io()
+  return 2 + pIOConfig->GetTotalNChannels(ERoute::kInput) + pIOConfig->GetTotalNChannels(ERoute::kOutput);
+}
+
 // Private methods
 
+/** Read a numeric atom of any of the types that hosts use for patch:value and time:Position properties
+ * @return \c true if the atom was numeric */
+static bool GetAtomNumber(const CoreURIDMap& uris, const LV2_Atom* pAtom, double& value)
+{
+  if (!pAtom)
+    return false;
+
+  if (pAtom->type == uris.atom_Float)
+    value = ((const LV2_Atom_Float*) pAtom)->body;
+  else if (pAtom->type == uris.atom_Double)
+    value = ((const LV2_Atom_Double*) pAtom)->body;
+  else if (pAtom->type == uris.atom_Int)
+    value = ((const LV2_Atom_Int*) pAtom)->body;
+  else if (pAtom->type == uris.atom_Long)
+    value = (double) ((const LV2_Atom_Long*) pAtom)->body;
+  else if (pAtom->type == uris.atom_Bool)
+    value = ((const LV2_Atom_Bool*) pAtom)->body ? 1. : 0.;
+  else
+    return false;
 
-//IPlugProcessor
-bool IPlugLV2DSP::SendMidiMsg(const IMidiMsg& msg)
+  return true;
+}
+
+void IPlugLV2DSP::ProcessControlPorts()
+{
+#if LV2_CONTROL_PORTS
+  const int nParams = NParams();
+  float* pLastValues = mLastControlValues.Get();
+
+  for (int i = 0; i < nParams; ++i)
+  {
+    const float* pPort = (const float*) mPorts[mFirstControlPort + i];
+
+    // only ports that the host has changed since the last run() are applied, so parameter changes from patch:Set are not overwritten
+    if (pPort && *pPort != pLastValues[i])
+    {
+      pLastValues[i] = *pPort;
+      ENTER_PARAMS_MUTEX;
+      GetParam(i)->Set(*pPort);
+      // SendParameterValueFromAPI make no big sense for LV2, GUI is always separate
+      OnParamChange(i, kHost, 0);
+      LEAVE_PARAMS_MUTEX;
+    }
+  }
+#endif
+}
+
+void IPlugLV2DSP::ProcessPatchSet(const LV2_Atom_Object* pObj)
 {
-  LV2_Atom_Sequence* out_port = ((LV2_Atom_Sequence*)mPorts[1]);
+  // Determine the Param index from property ID
+  const LV2_Atom* property = nullptr;
+  const LV2_Atom* val = nullptr;
+  lv2_atom_object_get(pObj, mCoreURIs.patch_property, &property, mCoreURIs.patch_value, &val, 0);
+
+  if (!property || property->type != mCoreURIs.atom_URID)
+    return;
 
-  struct MIDINoteEvent
+  // We should check to make sure bad hosts don't do this.
+  // If so, report to host.
+  auto it = mParamIDMap.find(((const LV2_Atom_URID*) property)->body);
+  double value;
+
+  if (it == mParamIDMap.end() || !GetAtomNumber(mCoreURIs, val, value))
+    return;
+
+  const int paramIdx = it->second;
+
+  ENTER_PARAMS_MUTEX;
+  GetParam(paramIdx)->Set(value);
+  // the block is split at the event, so the change applies from the start of the next sub-block
+  OnParamChange(paramIdx, kHost, 0);
+  LEAVE_PARAMS_MUTEX;
+}
+
+void IPlugLV2DSP::ProcessTimePosition(const LV2_Atom_Object* pObj)
+{
+  const LV2_Atom* pFrame = nullptr;
+  const LV2_Atom* pSpeed = nullptr;
+  const LV2_Atom* pBar = nullptr;
+  const LV2_Atom* pBarBeat = nullptr;
+  const LV2_Atom* pBeatsPerBar = nullptr;
+  const LV2_Atom* pBeatUnit = nullptr;
+  const LV2_Atom* pBPM = nullptr;
+
+  lv2_atom_object_get(pObj,
+                      mCoreURIs.time_frame, &pFrame,
+                      mCoreURIs.time_speed, &pSpeed,
+                      mCoreURIs.time_bar, &pBar,
+                      mCoreURIs.time_barBeat, &pBarBeat,
+                      mCoreURIs.time_beatsPerBar, &pBeatsPerBar,
+                      mCoreURIs.time_beatUnit, &pBeatUnit,
+                      mCoreURIs.time_beatsPerMinute, &pBPM,
+                      0);
+
+  // hosts only send the properties that they know about, so anything missing keeps its last value
+  double value;
+
+  if (GetAtomNumber(mCoreURIs, pFrame, value))
+    mHostTimeInfo.mSamplePos = value;
+
+  if (GetAtomNumber(mCoreURIs, pSpeed, value))
   {
-    LV2_Atom_Event event;
-    uint8_t        msg[3];
-  };
-
-  MIDINoteEvent ev;
-  ev.event.time.frames = msg.mOffset;
-  ev.event.body.type = mCoreURIs.midi_MidiEvent;
-  ev.event.body.size = 3;
-  ev.msg[0] = msg.mStatus;
-  ev.msg[1] = msg.mData1;
-  ev.msg[2] = msg.mData2;
-  lv2_atom_sequence_append_event(out_port, out_port->atom.size, &ev.event);
+    mHostSpeed = value;
+    mHostTimeInfo.mTransportIsRunning = (value != 0.);
+  }
+
+  if (GetAtomNumber(mCoreURIs, pBPM, value) && value > 0.)
+    mHostTimeInfo.mTempo = value;
+
+  if (GetAtomNumber(mCoreURIs, pBeatsPerBar, value) && value > 0.)
+    mHostTimeInfo.mNumerator = (int) value;
+
+  if (GetAtomNumber(mCoreURIs, pBeatUnit, value) && value > 0.)
+    mHostTimeInfo.mDenominator = (int) value;
+
+  double bar, barBeat;
+
+  if (GetAtomNumber(mCoreURIs, pBar, bar) && GetAtomNumber(mCoreURIs, pBarBeat, barBeat))
+  {
+    // LV2 counts bars and beats from 0, in units of beatUnit, whereas PPQ positions are in quarter notes
+    const double quartersPerBeat = 4. / mHostTimeInfo.mDenominator;
+    const double barStartBeats = bar * mHostTimeInfo.mNumerator;
+
+    mHostTimeInfo.mLastBar = barStartBeats * quartersPerBeat;
+    mHostTimeInfo.mPPQPos = (barStartBeats + barBeat) * quartersPerBeat;
+  }
+}
+
+void IPlugLV2DSP::ProcessMidiEvent(const LV2_Atom_Event* pEv, int offset)
+{
+  const uint8_t* const pData = (const uint8_t*)(pEv + 1);
+  const int size = (int) pEv->body.size;
+
+  if (size == 0)
+    return;
+
+  switch (lv2_midi_message_type(pData))
+  {
+    case LV2_MIDI_MSG_INVALID:
+      break;
+    case LV2_MIDI_MSG_SYSTEM_EXCLUSIVE:
+    {
+      // the data stays valid for the duration of run(), so no copy is needed
+      ISysEx sysex(offset, pData, size);
+      ProcessSysEx(sysex);
+      break;
+    }
+    default:
+    {
+      if (size <= 3)
+      {
+        IMidiMsg msg(offset, pData[0], size > 1 ? pData[1] : 0, size > 2 ? pData[2] : 0);
+        ProcessMidiMsg(msg);
+      }
+      break;
+    }
+  }
+}
+
+void IPlugLV2DSP::ProcessSubBlock(uint32_t startFrame, uint32_t endFrame)
+{
+  const int nFrames = (int) (endFrame - startFrame);
+
+  if (nFrames <= 0)
+    return;
+
+  const int nInputs = mInputPtrs.GetSize();
+  const int nOutputs = mOutputPtrs.GetSize();
+
+  // audio ports follow the control input and output ports, with this instance's IO config's channel counts
+  for (int i = 0; i < nInputs; i++)
+  {
+    float* pPort = (float*) mPorts[2 + i];
+    mInputPtrs.Get()[i] = pPort ? pPort + startFrame : nullptr;
+  }
+
+  for (int i = 0; i < nOutputs; i++)
+  {
+    float* pPort = (float*) mPorts[2 + nInputs + i];
+    mOutputPtrs.Get()[i] = pPort ? pPort + startFrame : nullptr;
+  }
 
+  AttachBuffers(ERoute::kInput, 0, nInputs, mInputPtrs.Get(), nFrames);
+  AttachBuffers(ERoute::kOutput, 0, nOutputs, mOutputPtrs.Get(), nFrames);
+
+  SetTimeInfo(mHostTimeInfo);
+  ProcessBuffers((float) 0.0f, nFrames);
+
+  // advance the transport, so the next sub-block (or run) sees the right position if the host doesn't send another time:Position
+  if (mHostTimeInfo.mTransportIsRunning)
+  {
+    const double frames = nFrames * mHostSpeed;
+
+    if (mHostTimeInfo.mSamplePos >= 0.)
+      mHostTimeInfo.mSamplePos += frames;
+
+    if (mHostTimeInfo.mPPQPos >= 0.)
+    {
+      const double quartersPerBeat = 4. / mHostTimeInfo.mDenominator;
+      const double quartersPerBar = mHostTimeInfo.mNumerator * quartersPerBeat;
+
+      mHostTimeInfo.mPPQPos += (frames / GetSampleRate()) * (mHostTimeInfo.mTempo / 60.) * quartersPerBeat;
+
+      if (mHostTimeInfo.mLastBar >= 0. && quartersPerBar > 0.)
+        mHostTimeInfo.mLastBar = std::floor(mHostTimeInfo.mPPQPos / quartersPerBar) * quartersPerBar;
+    }
+  }
+}
+
+void IPlugLV2DSP::WriteMidiOutput(uint32_t nFrames)
+{
+  LV2_Atom_Sequence* pOutPort = (LV2_Atom_Sequence*) mPorts[1];
+  LV2_Atom_Event* pEvent = (LV2_Atom_Event*) mMidiOutEventBuf.Get();
+  uint8_t* pEventData = (uint8_t*) (pEvent + 1);
+  const int64_t lastFrame = nFrames > 0 ? nFrames - 1 : 0;
+  int64_t frame = 0;
+  ISysEx sysex;
+
+  // IMidiQueue keeps messages sorted by offset, and SysEx messages are merged in by offset. An atom sequence needs the
+  // event times in order, so an event is never timed before the one ahead of it
+  while (true)
+  {
+    const bool hasMidi = !mMidiOutputQueue.Empty() && mMidiOutputQueue.Peek().mOffset < (int) nFrames;
+    const bool hasSysEx = mSysExOutputQueue.Peek(sysex); // all of them are written in this run() call
+
+    if (!hasMidi && !hasSysEx)
+      break;
+
+    const bool isSysEx = hasSysEx && (!hasMidi || sysex.mOffset < mMidiOutputQueue.Peek().mOffset);
+    int offset, size;
+
+    if (isSysEx)
+    {
+      offset = sysex.mOffset;
+      size = sysex.mSize;
+      memcpy(pEventData, sysex.mData, size);
+    }
+    else
+    {
+      const IMidiMsg& msg = mMidiOutputQueue.Peek();
+      offset = msg.mOffset;
+      size = msg.Size();
+      pEventData[0] = msg.mStatus;
+      pEventData[1] = msg.mData1;
+      pEventData[2] = msg.mData2;
+    }
+
+    if (pOutPort && size > 0)
+    {
+      frame = std::min(std::max((int64_t) offset, frame), lastFrame);
+      pEvent->time.frames = frame;
+      pEvent->body.type = mCoreURIs.midi_MidiEvent;
+      pEvent->body.size = size;
+      lv2_atom_sequence_append_event(pOutPort, mMidiOutCapacity, pEvent); // dropped if the sequence is full
+    }
+
+    if (isSysEx)
+      mSysExOutputQueue.Remove();
+    else
+      mMidiOutputQueue.Remove();
+  }
+
+  mMidiOutputQueue.Flush(nFrames);
+}
+
+//IPlugProcessor
+bool IPlugLV2DSP::SendMidiMsg(const IMidiMsg& msg)
+{
+  // offsets are relative to the sub-block passed to ProcessBlock(), but the output sequence is timed from the start of run()
+  IMidiMsg blockMsg = msg;
+  blockMsg.mOffset += mSubBlockStart;
+  mMidiOutputQueue.Add(blockMsg);
   return true;
 }
 
+bool IPlugLV2DSP::SendSysEx(const ISysEx& msg)
+{
+  // the data only has to be valid for this call, so it is copied until WriteMidiOutput()
+  return mSysExOutputQueue.Push(ISysEx(msg.mOffset + (int) mSubBlockStart, msg.mData, msg.mSize));
+}
+
 
 //LV2 methods
 
@@ -178,95 +480,71 @@ void IPlugLV2DSP::activate()
 
 void IPlugLV2DSP::run(uint32_t n_samples)
 {
-  int nInputs = MaxNChannels(ERoute::kInput);
-  int nOutputs = MaxNChannels(ERoute::kOutput);
-  int nParams = NParams();
+  IDenormalScope denormalScope(GetDenormalMode(), GetDenormalBlockCounter());
 
   if(GetBlockSize() < n_samples)
   {
     // if host has no maxBlockLength, we can get there. Strictly speaking we violate hardRT by allocation,
     // but what else can we do in such case? Make the feature "required" and so do not support this host at all? 
     SetBlockSize(n_samples);
+    mMidiOutputQueue.Resize(n_samples);
   }
 
-  AttachBuffers(ERoute::kInput, 0, nInputs, (float **)mPorts, n_samples);
-  AttachBuffers(ERoute::kOutput, 0, nOutputs, (float **)(mPorts + nInputs), n_samples);
-
-  LV2_ATOM_SEQUENCE_FOREACH(mPorts[0], ev)
+  // the host sets the output sequence's size to its capacity, we must clear it before appending events
+  LV2_Atom_Sequence* pOutPort = (LV2_Atom_Sequence*) mPorts[1];
+  if (pOutPort)
   {
-    uint32_t atom_type = ev->body.type;
+    mMidiOutCapacity = pOutPort->atom.size;
+    lv2_atom_sequence_clear(pOutPort);
+    pOutPort->atom.type = mCoreURIs.atom_Sequence;
+  }
+
+  ProcessControlPorts();
+
+  mSubBlockStart = 0;
+  const LV2_Atom_Sequence* pInPort = (const LV2_Atom_Sequence*) mPorts[0];
 
-    if (atom_type == mCoreURIs.atom_Object)
+  if (pInPort)
+  {
+    LV2_ATOM_SEQUENCE_FOREACH(pInPort, ev)
     {
-      const LV2_Atom_Object* obj = (LV2_Atom_Object*)&ev->body;
-      if (obj->body.otype == mCoreURIs.patch_Set)
-      {
-        uint32_t sampleAt = ev->time.frames;
-        // We should check to make sure bad hosts don't do this.
-        // If so, report to host.
-        if (sampleAt >= n_samples)
-        {
-          sampleAt = n_samples - 1;
-        }
+      // We should check to make sure bad hosts don't send events out of order or beyond the block.
+      uint32_t sampleAt = std::min((uint32_t) ev->time.frames, n_samples > 0 ? n_samples - 1 : 0);
+      sampleAt = std::max(sampleAt, mSubBlockStart);
 
-        // Determine the Param index from property ID
-        const LV2_Atom* property = nullptr;
-        lv2_atom_object_get(obj, mCoreURIs.patch_property, &property, 0);
-        if (!property || property->type != mCoreURIs.atom_URID)
-        {
-          continue;
-        }
+      const uint32_t atom_type = ev->body.type;
+
+      if (atom_type == mCoreURIs.atom_Object || atom_type == mCoreURIs.atom_Blank)
+      {
+        const LV2_Atom_Object* obj = (const LV2_Atom_Object*)&ev->body;
+        const bool isPatchSet = (obj->body.otype == mCoreURIs.patch_Set);
+        const bool isTimePosition = (obj->body.otype == mCoreURIs.time_Position);
 
-        const LV2_Atom* val = nullptr;
-        lv2_atom_object_get(obj, mCoreURIs.patch_value, &val, 0);
-        if (!val)
+        if (isPatchSet || isTimePosition)
         {
-          continue;
+          // render up to the event, so that the change is sample accurate
+          ProcessSubBlock(mSubBlockStart, sampleAt);
+          mSubBlockStart = sampleAt;
+
+          if (isPatchSet)
+            ProcessPatchSet(obj);
+          else
+            ProcessTimePosition(obj);
         }
-
-        LV2_URID urid = ((LV2_Atom_URID*)property)->body;
-        OnParamChange(mParamIDMap[urid], EParamSource::kHost, sampleAt);
       }
-    }
-    
-    if (atom_type == mCoreURIs.midi_MidiEvent)
-    {
-      const uint8_t* const msg = (const uint8_t*)(ev + 1);
-      switch (lv2_midi_message_type(msg))
+      else if (atom_type == mCoreURIs.midi_MidiEvent)
       {
-      case LV2_MIDI_MSG_NOTE_ON:
-        break;
-      case LV2_MIDI_MSG_NOTE_OFF:
-        break;
-      // TODO finish switch-case for processing MIDI messages
-      }
-    }
-  }
-  // END LV2_ATOM_SEQUENCE_FOREACH
-  
-#ifdef LV2_CONTROL_PORTS
-  ENTER_PARAMS_MUTEX;
-  for (int i = 0; i < nParams; ++i)
-  {
-    float *pParam = (float *)mPorts[nInputs + nOutputs + i];
-    if (pParam)
-    {
-      IParam *param = GetParam(i);
-      if(param->Value() != *pParam){
-        param->Set(*pParam);
-        // SendParameterValueFromAPI make no big sense for LV2, GUI is always separate
-        OnParamChange(i, kHost);
+        // MIDI doesn't split the block, its offset is relative to the sub-block that it will be processed with
+        ProcessMidiEvent(ev, (int) (sampleAt - mSubBlockStart));
       }
     }
+    // END LV2_ATOM_SEQUENCE_FOREACH
   }
-  LEAVE_PARAMS_MUTEX;
-#endif
 
-  // TODO: parameters
-  // TODO: time info
-  // TODO: midi
+  ProcessSubBlock(mSubBlockStart, n_samples);
+  mSubBlockStart = 0;
 
-  ProcessBuffers((float) 0.0f, n_samples);  
+  WriteMidiOutput(n_samples);
 }
 
 void IPlugLV2DSP::deactivate()
@@ -280,32 +558,32 @@ void IPlugLV2DSP::deactivate()
 // LV2 DSP Callbacks //
 ///////////////////////
 
-static void connect_port(LV2_Handle instance, uint32_t port, void *data)
+static void lv2_connect_port(LV2_Handle instance, uint32_t port, void *data)
 {
   (static_cast<IPlugLV2DSP*>(instance))->connect_port(port, data);
 }
 
-static void activate(LV2_Handle instance)
+static void lv2_activate(LV2_Handle instance)
 {
   (static_cast<IPlugLV2DSP*>(instance))->activate();
 }
 
-static void run(LV2_Handle instance, uint32_t n_samples)
+static void lv2_run(LV2_Handle instance, uint32_t n_samples)
 {
   (static_cast<IPlugLV2DSP*>(instance))->run(n_samples);
 }
 
-static void deactivate(LV2_Handle instance)
+static void lv2_deactivate(LV2_Handle instance)
 {
   (static_cast<IPlugLV2DSP*>(instance))->deactivate();
 }
 
-static void cleanup(LV2_Handle instance)
+static void lv2_cleanup(LV2_Handle instance)
 {
   delete (static_cast<IPlugLV2DSP*>(instance));
 }
 
-static const void *extension_data(const char *uri)
+static const void *lv2_extension_data(const char *uri)
 {
   return nullptr;
 }
@@ -337,19 +615,21 @@ IPlugLV2DSP::descriptor(uint32_t index, LV2_InstantiateFn instantiate)
       sDescriptors.Add(LV2_Descriptor {
         urip,
         instantiate,
-        connect_port,
-        activate,
-        run,
-        deactivate,
-        cleanup,
-        extension_data,
+        lv2_connect_port,
+        lv2_activate,
+        lv2_run,
+        lv2_deactivate,
+        lv2_cleanup,
+        lv2_extension_data,
       });
-      urip += uriLen;
+      urip += uriLen + 1; // past the terminator
     }
+
+    ioConfigs.Empty(true);
   }
 
   // Once everything is initialized returning descriptors is easy.
-  if (sDescriptors.GetSize() < index)
+  if (index < (uint32_t) sDescriptors.GetSize())
   {
     return sDescriptors.Get() + index;
   }
@@ -372,8 +652,19 @@ IPlugLV2Editor::IPlugLV2Editor(const InstanceInfo &info, const Config& config) :
   int totalNInChans, totalNOutChans;
   int totalNInBuses, totalNOutBuses;
   IPlugProcessor::ParseChannelIOStr(config.channelIOStr, IOConfigs, totalNInChans, totalNOutChans, totalNInBuses, totalNOutBuses);
-  
-  mParameterPortOffset = totalNInChans + totalNOutChans;
+
+  // the UI is shared by the plug-ins for all IO configs, the host passes the URI of the one it is for
+  int ioConfigIdx = 0;
+  const char* pIOSuffix = info.plugin_uri ? strrchr(info.plugin_uri, '#') : nullptr;
+  if (pIOSuffix && !strncmp(pIOSuffix, "#io_", 4))
+    ioConfigIdx = atoi(pIOSuffix + 4);
+  const IOConfig* pIOConfig = IOConfigs.Get(ioConfigIdx) ? IOConfigs.Get(ioConfigIdx) : IOConfigs.Get(0);
+
+  // the DSP's control ports follow its atom ports and that config's audio ports, see IPlugLV2DSP::GetFirstControlPort()
+  mParameterPortOffset = 2;
+  if (pIOConfig)
+    mParameterPortOffset += pIOConfig->GetTotalNChannels(ERoute::kInput) + pIOConfig->GetTotalNChannels(ERoute::kOutput);
+  IOConfigs.Empty(true);
 
   mEmbed = xcbt_embed_idle();
  
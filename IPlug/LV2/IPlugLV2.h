@@ -14,6 +14,7 @@
 #include "IPlugAPIBase.h"
 #include "IPlugProcessor.h"
 
+#include <lv2/atom/atom.h>
 #include <lv2/core/lv2.h>
 #include <lv2/core/lv2_util.h>
 #include <lv2/urid/urid.h>
@@ -48,10 +49,22 @@ struct CoreURIDMap
   LV2_URID atom_URID;
   LV2_URID atom_Float;
   LV2_URID atom_Bool;
+  LV2_URID atom_Int;
+  LV2_URID atom_Long;
+  LV2_URID atom_Double;
+  LV2_URID atom_Sequence;
   LV2_URID midi_MidiEvent;
   LV2_URID patch_Set;
   LV2_URID patch_property;
   LV2_URID patch_value;
+  LV2_URID time_Position;
+  LV2_URID time_frame;
+  LV2_URID time_speed;
+  LV2_URID time_bar;
+  LV2_URID time_barBeat;
+  LV2_URID time_beatsPerBar;
+  LV2_URID time_beatUnit;
+  LV2_URID time_beatsPerMinute;
 };
 
 typedef LV2_Handle (*LV2_InstantiateFn)(const LV2_Descriptor *descriptor,
@@ -78,9 +91,9 @@ public:
 
   //IPlugProcessor
   void SetLatency(int samples) override;
-  bool SendSysEx(const ISysEx& msg) override;
   */
   bool SendMidiMsg(const IMidiMsg& msg) override;
+  bool SendSysEx(const ISysEx& msg) override;
 
   //LV2 methods
   void  connect_port(uint32_t port, void *data);
@@ -90,7 +103,8 @@ public:
 
   static const LV2_Descriptor* descriptor(uint32_t index, LV2_InstantiateFn instantiate);
   
-  int GetFirstControlPort() const;
+  /** @return The index of the first control port of the plug-in for an IO config, after the atom ports and the config's audio ports */
+  static int GetFirstControlPort(const IOConfig* pIOConfig);
   int write_manifest(const char* dest_dir);
   int write_also(const char* dest_dir);
 
@@ -99,9 +113,34 @@ private:
   int write_cfg_parameters(FILE* f);
   int write_indent(FILE* f, int indent, const char* msg);
 
+  /** Apply changes to the control port values since the last call to run() */
+  void ProcessControlPorts();
+  /** Handle a patch:Set message from the control input port, at the start of the current sub-block */
+  void ProcessPatchSet(const LV2_Atom_Object* pObj);
+  /** Update mTimeInfo from a time:Position object */
+  void ProcessTimePosition(const LV2_Atom_Object* pObj);
+  /** Handle a MIDI event from the control input port
+   * @param offset The sample offset of the event, relative to the start of the current sub-block */
+  void ProcessMidiEvent(const LV2_Atom_Event* pEv, int offset);
+  /** Process the samples between startFrame and endFrame of the current run() call, and advance the transport */
+  void ProcessSubBlock(uint32_t startFrame, uint32_t endFrame);
+  /** Write the MIDI and SysEx messages queued by SendMidiMsg() and SendSysEx() to the control output port */
+  void WriteMidiOutput(uint32_t nFrames);
+
   void **mPorts; // simpler then vector for AttachBuffers
+  int mFirstControlPort = 2; // the ports of this instance's IO config, see GetFirstControlPort()
   CoreURIDMap mCoreURIs;
   std::unordered_map<LV2_URID, int> mParamIDMap;
+  WDL_TypedBuf<float*> mInputPtrs; // audio port pointers, offset to the start of the current sub-block
+  WDL_TypedBuf<float*> mOutputPtrs;
+  WDL_TypedBuf<float> mLastControlValues; // control port values at the end of the previous run(), NaN if they have not been read yet
+  ITimeInfo mHostTimeInfo; // transport state at the start of the current sub-block, as last reported by a time:Position event
+  double mHostSpeed = 0.; // the transport speed from time:Position, 1. when rolling at normal speed
+  IMidiQueue mMidiOutputQueue;
+  IPlugSysExQueue mSysExOutputQueue {SYSEX_TRANSFER_SIZE}; // copies of the messages from SendSysEx(), until the end of run()
+  WDL_TypedBuf<uint8_t> mMidiOutEventBuf; // an atom event followed by its MIDI data, since events are appended to the output whole
+  uint32_t mSubBlockStart = 0; // the frame in the current run() call at which the current sub-block starts, which MIDI sent from ProcessMidiMsg() and ProcessBlock() is relative to
+  uint32_t mMidiOutCapacity = 0; // the capacity of the control output port's atom sequence in the current run() call
 };
 
 #endif
@@ -78,7 +78,7 @@ static bool MapLV2Unit(IParam *p, WDL_String& unitStr)
     unitName = "units:hz";
     break;
   case IParam::kUnitLinearGain:
-    unitStr = "iplug2:unit_amp";
+    unitName = "iplug2:unit_amp";
     break;
   case IParam::kUnitMeters:
     unitName = "units:m";
@@ -135,13 +135,6 @@ static bool MapLV2Unit(IParam *p, WDL_String& unitStr)
   return true;
 }
 
-int IPlugLV2DSP::GetFirstControlPort() const
-{
-  int nInputs = MaxNChannels(ERoute::kInput);
-  int nOutputs = MaxNChannels(ERoute::kOutput);
-  return nInputs + nOutputs + 2;
-}
-
 int IPlugLV2DSP::write_manifest(const char* dest_dir)
 {
   WDL_String path (dest_dir);
@@ -204,9 +197,11 @@ int IPlugLV2DSP::write_also(const char* dest_dir)
               "@prefix doap:  <http://usefulinc.com/ns/doap#> .\n"
               "@prefix foaf:  <http://xmlns.com/foaf/0.1/> .\n"
               "@prefix lv2:   <http://lv2plug.in/ns/lv2core#> .\n"
+              "@prefix midi:  <http://lv2plug.in/ns/ext/midi#> .\n"
               "@prefix rdf:   <http://www.w3.org/1999/02/22-rdf-syntax-ns#> .\n"
               "@prefix rdfs:  <http://www.w3.org/2000/01/rdf-schema#> .\n"
               "@prefix patch: <http://lv2plug.in/ns/ext/patch#> .\n"
+              "@prefix time:  <http://lv2plug.in/ns/ext/time#> .\n"
               "@prefix units: <http://lv2plug.in/ns/extensions/units#> .\n"
 #ifdef PLUG_HAS_UI
               "@prefix ui:   <http://lv2plug.in/ns/extensions/ui#> .\n"
@@ -303,7 +298,7 @@ int IPlugLV2DSP::write_also_io(FILE* f, const IOConfig* io, int io_index)
   write_port(false,
     "a atom:AtomPort, lv2:InputPort; \n"
     "atom:bufferType atom:Sequence;\n"
-    "atom:supports atom:Object, patch:Message;\n"
+    "atom:supports atom:Object, patch:Message, time:Position;\n"
 #if PLUG_DOES_MIDI_IN
     "atom:supports midi:MidiEvent ;\n"
 #endif
@@ -378,7 +373,7 @@ int IPlugLV2DSP::write_also_io(FILE* f, const IOConfig* io, int io_index)
   // Control ports are the old LADSPA way for parameters.
   // They're backwards-compatible but not very nice to work with.
   // Only enable if requested.
-  portIndex = GetFirstControlPort();
+  portIndex = GetFirstControlPort(io);
 
   // int nParams = NParams(); // Already declared above
   for (int n = 0; n < nParams; ++n)
@@ -399,7 +394,7 @@ int IPlugLV2DSP::write_also_io(FILE* f, const IOConfig* io, int io_index)
       "lv2:default %.4f ;\n"
       "lv2:minimum %.4f ;\n"
       "lv2:maximum %.4f ;\n",
-      portIndex, p->GetName(), symbol.Get(),
+      portIndex, symbol.Get(), p->GetName(),
       p->GetDefault(), p->GetMin(), p->GetMax());
       // TODO: units
     write_port(true, msg.Get());
@@ -409,6 +404,7 @@ int IPlugLV2DSP::write_also_io(FILE* f, const IOConfig* io, int io_index)
 
   // End writing ports list
   fprintf(f, " .\n");
+  return 0;
 }
 
 int IPlugLV2DSP::write_cfg_parameters(FILE* f)
@@ -437,8 +433,6 @@ int IPlugLV2DSP::write_cfg_parameters(FILE* f)
       break;
     }
 
-    MapLV2Unit(p, unitLine);
-
     fprintf(f, "%s:Par%d\n", PROP_PREFIX, n);
     msg.SetFormatted(FMT_MAX,
       "a lv2:Parameter ;\n"
@@ -446,11 +440,20 @@ int IPlugLV2DSP::write_cfg_parameters(FILE* f)
       "rdfs:range %s;\n"
       "lv2:default %.4f ;\n"
       "lv2:minimum %.4f ;\n"
-      "lv2:maximum %.4f ;\n"
-      "units:unit %s .\n",
+      "lv2:maximum %.4f",
       p->GetName(), range.Get(),
-      p->GetDefault(), p->GetMin(), p->GetMax(), unitLine.Get());
+      p->GetDefault(), p->GetMin(), p->GetMax());
+
+    // parameters without an LV2 unit have no units:unit
+    if (MapLV2Unit(p, unitLine))
+      msg.AppendFormatted(FMT_MAX, " ;\nunits:unit %s", unitLine.Get());
+
+    msg.Append(" .\n");
+    write_indent(f, 2, msg.Get());
+    fprintf(f, "\n");
   }
+
+  return 0;
 }
 
 int IPlugLV2DSP::write_indent(FILE* f, int indent, const char* msg)
@@ -466,11 +469,17 @@ int IPlugLV2DSP::write_indent(FILE* f, int indent, const char* msg)
   const char *sp = msg;
   while (*sp)
   {
-    size_t line_len = strcspn(sp, "\n\0");
+    size_t line_len = strcspn(sp, "\n");
     fprintf(f, "%s%.*s", indent_str, (int)line_len, sp);
-    // Move to next line
-    sp += line_len + 1;
+    sp += line_len;
+    // Move to next line, the last one may not end with a newline
+    if (*sp == '\n')
+    {
+      fputc('\n', f);
+      sp++;
+    }
   }
+  return 0;
 }
 
 
@@ -493,7 +502,7 @@ int main(int argc, const char *argv[])
     auto plug = static_cast<iplug::IPlugLV2DSP *>(handle);
     if (plug)
     {
-      return plug->write_manifest() || plug->write_also();
+      return plug->write_manifest(".") || plug->write_also(".");
     }
   }
   return 1;
@@ -1004,6 +1004,7 @@ void VSTCALLBACK IPlugVST2::VSTProcess(AEffect* pEffect, float** inputs, float**
 {
   TRACE
   IPlugVST2* _this = (IPlugVST2*) pEffect->object;
+  IDenormalScope denormalScope(_this->GetDenormalMode(), _this->GetDenormalBlockCounter());
   _this->VSTPreProcess(inputs, outputs, nFrames);
   ENTER_PARAMS_MUTEX_STATIC
   _this->ProcessBuffersAccumulating(nFrames);
@@ -1015,6 +1016,7 @@ void VSTCALLBACK IPlugVST2::VSTProcessReplacing(AEffect* pEffect, float** inputs
 {
   TRACE
   IPlugVST2* _this = (IPlugVST2*) pEffect->object;
+  IDenormalScope denormalScope(_this->GetDenormalMode(), _this->GetDenormalBlockCounter());
   _this->VSTPreProcess(inputs, outputs, nFrames);
   ENTER_PARAMS_MUTEX_STATIC
   _this->ProcessBuffers((float) 0.0f, nFrames);
@@ -1026,6 +1028,7 @@ void VSTCALLBACK IPlugVST2::VSTProcessDoubleReplacing(AEffect* pEffect, double**
 {
   TRACE
   IPlugVST2* _this = (IPlugVST2*) pEffect->object;
+  IDenormalScope denormalScope(_this->GetDenormalMode(), _this->GetDenormalBlockCounter());
   _this->VSTPreProcess(inputs, outputs, nFrames);
   ENTER_PARAMS_MUTEX_STATIC
   _this->ProcessBuffers((double) 0.0, nFrames);
@@ -1065,12 +1068,11 @@ void VSTCALLBACK IPlugVST2::VSTSetParameter(AEffect *pEffect, VstInt32 idx, floa
 void IPlugVST2::OutputSysexFromEditor()
 {
   //Output SYSEX from the editor, which has bypassed ProcessSysEx()
-  if(mSysExDataFromEditor.ElementsAvailable())
+  ISysEx smsg;
+  
+  while (mSysExDataFromEditor.Peek(smsg))
   {
-    while (mSysExDataFromEditor.Pop(mSysexBuf))
-    {
-      ISysEx smsg {mSysexBuf.mOffset, mSysexBuf.mData, mSysexBuf.mSize};
-      SendSysEx(smsg);
-    }
+    SendSysEx(smsg);
+    mSysExDataFromEditor.Remove();
   }
 }
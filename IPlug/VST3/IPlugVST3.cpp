@@ -100,7 +100,7 @@ tresult PLUGIN_API IPlugVST3::process(ProcessData& data)
 {
   TRACE
 
-  Process(data, processSetup, audioInputs, audioOutputs, mMidiMsgsFromEditor, mMidiMsgsFromProcessor, mSysExDataFromEditor, mSysexBuf);
+  Process(data, processSetup, audioInputs, audioOutputs, mMidiMsgsFromEditor, mMidiMsgsFromProcessor, mSysExDataFromEditor);
   return kResultOk;
 }
 
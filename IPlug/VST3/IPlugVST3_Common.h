@@ -53,7 +53,8 @@ struct IPlugVST3State
     
     IByteChunk chunk;
     
-    const int bytesPerBlock = 128;
+    // large enough that a state with thousands of parameters takes a few reads, rather than one for every 16 parameters
+    const int bytesPerBlock = 4096;
     char buffer[bytesPerBlock];
     
     while(true)
@@ -61,10 +62,11 @@ struct IPlugVST3State
       Steinberg::int32 bytesRead = 0;
       auto status = pState->read(buffer, (Steinberg::int32) bytesPerBlock, &bytesRead);
       
+      if (bytesRead > 0) // keep a short last block, even if the host reports it as a failure
+        chunk.PutBytes(buffer, bytesRead);
+      
       if (bytesRead <= 0 || (status != Steinberg::kResultTrue && pPlug->GetHost() != kHostWaveLab))
         break;
-      
-      chunk.PutBytes(buffer, bytesRead);
     }
     int pos = pPlug->UnserializeState(chunk,0);
     
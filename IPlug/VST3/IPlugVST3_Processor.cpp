@@ -85,7 +85,7 @@ tresult PLUGIN_API IPlugVST3Processor::process(ProcessData& data)
 {
   TRACE
   
-  Process(data, processSetup, audioInputs, audioOutputs, mMidiMsgsFromEditor, mMidiMsgsFromProcessor, mSysExDataFromEditor, mSysexBuf);
+  Process(data, processSetup, audioInputs, audioOutputs, mMidiMsgsFromEditor, mMidiMsgsFromProcessor, mSysExDataFromEditor);
   return kResultOk;
 }
 
@@ -220,7 +220,7 @@ void IPlugVST3Processor::TransmitMidiMsgFromProcessor(const IMidiMsg& msg)
   sendMessage(message);
 }
 
-void IPlugVST3Processor::TransmitSysExDataFromProcessor(const SysExData& data)
+void IPlugVST3Processor::TransmitSysExDataFromProcessor(const ISysEx& msg)
 {
   OPtr<IMessage> message = allocateMessage();
   
@@ -228,7 +228,7 @@ void IPlugVST3Processor::TransmitSysExDataFromProcessor(const SysExData& data)
     return;
   
   message->setMessageID("SSMFD");
-  message->getAttributes()->setBinary("D", (void*) data.mData, data.mSize);
-  message->getAttributes()->setInt("O", data.mOffset);
+  message->getAttributes()->setBinary("D", (void*) msg.mData, msg.mSize);
+  message->getAttributes()->setInt("O", msg.mOffset);
   sendMessage(message);
 }
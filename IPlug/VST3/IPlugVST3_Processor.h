@@ -76,7 +76,7 @@ public:
   
 private:
   void TransmitMidiMsgFromProcessor(const IMidiMsg& msg) override;
-  void TransmitSysExDataFromProcessor(const SysExData& data) override;
+  void TransmitSysExDataFromProcessor(const ISysEx& msg) override;
 
   // IConnectionPoint
   Steinberg::tresult PLUGIN_API notify(Steinberg::Vst::IMessage* message) override;
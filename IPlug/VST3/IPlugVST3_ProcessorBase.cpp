@@ -65,6 +65,8 @@ IPlugVST3ProcessorBase::IPlugVST3ProcessorBase(Config c, IPlugAPIBase& plug)
   
   // Make sure the process context is predictably initialised in case it is used before process is called
   memset(&mProcessContext, 0, sizeof(ProcessContext));
+  
+  mSysExOutputBuf.Resize(SYSEX_TRANSFER_SIZE);
 }
 
 void IPlugVST3ProcessorBase::ProcessMidiIn(IEventList* pEventList, IPlugQueue<IMidiMsg>& editorQueue, IPlugQueue<IMidiMsg>& processorQueue)
@@ -120,7 +122,7 @@ void IPlugVST3ProcessorBase::ProcessMidiIn(IEventList* pEventList, IPlugQueue<IM
   }
 }
 
-void IPlugVST3ProcessorBase::ProcessMidiOut(IPlugQueue<SysExData>& sysExQueue, SysExData& sysExBuf, IEventList* pOutputEvents, int32 numSamples)
+void IPlugVST3ProcessorBase::ProcessMidiOut(IPlugSysExQueue& sysExQueue, IEventList* pOutputEvents, int32 numSamples)
 {
   if (!mMidiOutputQueue.Empty() && pOutputEvents)
   {
@@ -193,18 +195,38 @@ void IPlugVST3ProcessorBase::ProcessMidiOut(IPlugQueue<SysExData>& sysExQueue, S
   mMidiOutputQueue.Flush(numSamples);
   
   // Output SYSEX from the editor, which has bypassed the processors' ProcessSysEx()
-  if (sysExQueue.ElementsAvailable())
+  // The messages are copied into mSysExOutputBuf, which is preallocated to the queue's largest message, so several smaller messages can be sent in one block
+  if (!sysExQueue.WasEmpty())
   {
     Event toAdd = {0};
+    ISysEx msg;
+    int pos = 0;
     
-    while (sysExQueue.Pop(sysExBuf))
+    while (sysExQueue.Peek(msg))
     {
+      if (msg.mSize > mSysExOutputBuf.GetSize())
+      {
+        sysExQueue.Remove(); // can never be sent, so don't let it hold up the rest
+        continue;
+      }
+      
+      if (pos + msg.mSize > mSysExOutputBuf.GetSize())
+        break; // send the rest next block
+      
+      uint8* pBytes = mSysExOutputBuf.Get() + pos;
+      memcpy(pBytes, msg.mData, msg.mSize);
+      pos += msg.mSize;
+      
       toAdd.type = Event::kDataEvent;
-      toAdd.sampleOffset = sysExBuf.mOffset;
+      toAdd.sampleOffset = msg.mOffset;
       toAdd.data.type = DataEvent::kMidiSysEx;
-      toAdd.data.size = sysExBuf.mSize;
-      toAdd.data.bytes = (uint8*) sysExBuf.mData; // TODO!  this is a problem if more than one message in this block!
-      pOutputEvents->addEvent(toAdd);
+      toAdd.data.size = msg.mSize;
+      toAdd.data.bytes = pBytes;
+      
+      if (pOutputEvents)
+        pOutputEvents->addEvent(toAdd);
+      
+      sysExQueue.Remove();
     }
   }
 }
@@ -421,8 +443,9 @@ void IPlugVST3ProcessorBase::ProcessAudio(ProcessData& data, ProcessSetup& setup
   }
 }
 
-void IPlugVST3ProcessorBase::Process(ProcessData& data, ProcessSetup& setup, const BusList& ins, const BusList& outs, IPlugQueue<IMidiMsg>& fromEditor, IPlugQueue<IMidiMsg>& fromProcessor, IPlugQueue<SysExData>& sysExFromEditor, SysExData& sysExBuf)
+void IPlugVST3ProcessorBase::Process(ProcessData& data, ProcessSetup& setup, const BusList& ins, const BusList& outs, IPlugQueue<IMidiMsg>& fromEditor, IPlugQueue<IMidiMsg>& fromProcessor, IPlugSysExQueue& sysExFromEditor)
 {
+  IDenormalScope denormalScope(GetDenormalMode(), GetDenormalBlockCounter());
   PrepareProcessContext(data, setup);
   ProcessParameterChanges(data, fromProcessor);
   
@@ -435,7 +458,7 @@ void IPlugVST3ProcessorBase::Process(ProcessData& data, ProcessSetup& setup, con
   
   if (DoesMIDIOut())
   {
-    ProcessMidiOut(sysExFromEditor, sysExBuf, data.outputEvents, data.numSamples);
+    ProcessMidiOut(sysExFromEditor, data.outputEvents, data.numSamples);
   }
 }
 
@@ -54,6 +54,12 @@ const char* IPlugWAM::init(uint32_t bufsize, uint32_t sr, void* pDesc)
   OnReset();
   postMessage("StartIdleTimer", nullptr, nullptr);
 
+  // where the rings are in the heap, the controller attaches to them if it also gets the heap as a SharedArrayBuffer (see IPlugWAM-awp.js)
+  WDL_String ringsStr;
+  ringsStr.SetFormatted(64, "%llu:%llu", (unsigned long long) reinterpret_cast<uintptr_t>(mRingToUI.GetMemory()),
+                                         (unsigned long long) reinterpret_cast<uintptr_t>(mRingFromUI.GetMemory()));
+  postMessage("SharedRings", ringsStr.Get(), "");
+
   return json.Get();
 }
 
@@ -66,19 +72,67 @@ void IPlugWAM::onProcess(WAM::AudioBus* pAudio, void* pData)
   AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), pAudio->inputs, blockSize);
   AttachBuffers(ERoute::kOutput, 0, NChannelsConnected(ERoute::kOutput), pAudio->outputs, blockSize);
   
+  ProcessMsgsFromUI();
+  
   ENTER_PARAMS_MUTEX
   ProcessBuffers((float) 0.0f, blockSize);
   LEAVE_PARAMS_MUTEX
 }
 
+void IPlugWAM::ProcessMsgsFromUI()
+{
+  mRingFromUI.Drain([this](int type, const uint8_t* pData, int size) {
+    switch (type)
+    {
+      case IPlugWAMSharedRing::kSPVFUI:
+      {
+        int paramIdx;
+        double value;
+        if (size < (int) (sizeof(int) + sizeof(double)))
+          break;
+        memcpy(&paramIdx, pData, sizeof(int));
+        memcpy(&value, pData + sizeof(int), sizeof(double));
+        if (paramIdx >= 0 && paramIdx < NParams())
+          SetParameterValue(paramIdx, value);
+        break;
+      }
+      case IPlugWAMSharedRing::kSMMFUI:
+      {
+        if (size < 3)
+          break;
+        IMidiMsg msg = {0, pData[0], pData[1], pData[2]};
+        ProcessMidiMsg(msg);
+        break;
+      }
+      case IPlugWAMSharedRing::kSAMFUI:
+      {
+        int msgTag = kNoTag, ctrlTag = kNoTag, dataSize = 0;
+        IByteStream stream(pData, size);
+        int pos = stream.Get(&msgTag, 0);
+        pos = stream.Get(&ctrlTag, pos);
+        pos = stream.Get(&dataSize, pos);
+        if (pos < 0 || dataSize < 0 || dataSize > size - pos)
+          break;
+        OnMessage(msgTag, ctrlTag, dataSize, pData + pos);
+        break;
+      }
+      case IPlugWAMSharedRing::kSSMFUI:
+      {
+        ISysEx sysex = {0, pData, size};
+        ProcessSysEx(sysex);
+        break;
+      }
+      default:
+        break;
+    }
+  });
+}
+
 void IPlugWAM::OnEditorIdleTick()
 {
-  while(mParamChangeFromProcessor.ElementsAvailable())
-  {
-    ParamTuple p;
-    mParamChangeFromProcessor.Pop(p);
-    SendParameterValueFromDelegate(p.idx, p.value, false);
-  }
+  mParamChangeFromProcessor.ForEachChanged([this](int paramIdx, double value) {
+    SendParameterValueFromDelegate(paramIdx, value, false);
+  });
 
   while (mMidiMsgsFromProcessor.ElementsAvailable())
   {
@@ -99,6 +153,8 @@ void IPlugWAM::onMessage(char* verb, char* res, double data)
   }
   else if(strcmp(verb, "SMMFUI") == 0)
   {
+    ProcessMsgsFromUI(); // posted because the ring was full, so comes after what is in it
+    
     uint8_t data[3];
     char* pChar = strtok(res, ":");
     int i = 0;
@@ -112,6 +168,8 @@ void IPlugWAM::onMessage(char* verb, char* res, double data)
   }
   else if(strcmp(verb, "SAMFUI") == 0) // SAMFUI
   {
+    ProcessMsgsFromUI();
+    
     int data[2] = {-1, -1};
     char* pChar = strtok(res, ":");
     int i = 0;
@@ -134,6 +192,8 @@ void IPlugWAM::onMessage(char* verb, char* res, void* pData, uint32_t size)
 {
   if(strcmp(verb, "SAMFUI") == 0)
   {
+    ProcessMsgsFromUI(); // posted because the ring was full, so comes after what is in it
+    
     int pos = 0;
     IByteStream stream(pData, size);
     int msgTag;
@@ -162,6 +222,10 @@ void IPlugWAM::onMidi(byte status, byte data1, byte data2)
   ProcessMidiMsg(msg); // onMidi is not called on HPT. We could queue things up, but just process the message straightaway for now
   //mMidiMsgsFromProcessor.Push(msg);
   
+  const uint8_t bytes[3] = {status, data1, data2};
+  if (PushToUI(IPlugWAMSharedRing::kSMMFD, bytes, sizeof(bytes)))
+    return;
+  
   WDL_String dataStr;
   dataStr.SetFormatted(16, "%i:%i:%i", msg.mStatus, msg.mData1, msg.mData2);
   
@@ -173,6 +237,7 @@ void IPlugWAM::onMidi(byte status, byte data1, byte data2)
 void IPlugWAM::onParam(uint32_t idparam, double value)
 {
 //  DBGMSG("IPlugWAM:: onParam %i %f\n", idparam, value);
+  ProcessMsgsFromUI(); // the controller posts parameter changes when the ring is full, so they come after what is in it
   SetParameterValue(idparam, value);
 }
 
@@ -181,6 +246,9 @@ void IPlugWAM::onSysex(byte* pData, uint32_t size)
   ISysEx sysex = {0 /* no offset */, pData, (int) size };
   ProcessSysEx(sysex);
   
+  if (PushToUI(IPlugWAMSharedRing::kSSMFD, pData, (int) size))
+    return;
+  
   WDL_String dataStr;
   dataStr.SetFormatted(16, "%i", size);
   
@@ -191,6 +259,9 @@ void IPlugWAM::onSysex(byte* pData, uint32_t size)
 
 void IPlugWAM::SendControlValueFromDelegate(int ctrlTag, double normalizedValue)
 {
+  if (PushToUI(IPlugWAMSharedRing::kSCVFD, &ctrlTag, sizeof(int), &normalizedValue, sizeof(double)))
+    return;
+  
   WDL_String propStr;
   WDL_String dataStr;
 
@@ -203,6 +274,10 @@ void IPlugWAM::SendControlValueFromDelegate(int ctrlTag, double normalizedValue)
 
 void IPlugWAM::SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize, const void* pData)
 {
+  const int tags[2] = {ctrlTag, msgTag};
+  if (PushToUI(IPlugWAMSharedRing::kSCMFD, tags, sizeof(tags), pData, dataSize))
+    return;
+  
   WDL_String propStr;
   propStr.SetFormatted(16, "%i:%i", ctrlTag, msgTag);
   
@@ -212,6 +287,9 @@ void IPlugWAM::SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize,
 
 void IPlugWAM::SendParameterValueFromDelegate(int paramIdx, double value, bool normalized)
 {
+  if (PushToUI(IPlugWAMSharedRing::kSPVFD, &paramIdx, sizeof(int), &value, sizeof(double)))
+    return;
+  
   WDL_String propStr;
   WDL_String dataStr;
   propStr.SetFormatted(16, "%i", paramIdx);
@@ -223,6 +301,9 @@ void IPlugWAM::SendParameterValueFromDelegate(int paramIdx, double value, bool n
 
 void IPlugWAM::SendArbitraryMsgFromDelegate(int msgTag, int dataSize, const void* pData)
 {
+  if (PushToUI(IPlugWAMSharedRing::kSAMFD, &msgTag, sizeof(int), pData, dataSize))
+    return;
+  
   WDL_String propStr;
   propStr.SetFormatted(16, "%i", msgTag);
   
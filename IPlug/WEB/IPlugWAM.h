@@ -13,6 +13,7 @@
 
 #include "IPlugAPIBase.h"
 #include "IPlugProcessor.h"
+#include "IPlugWAM_SharedRing.h"
 #include "processor.h"
 
 using namespace WAM;
@@ -59,6 +60,22 @@ public:
 private:
   /** Called repeatedly to emulate IPlugAPIBase::OnTimer() */
   void OnEditorIdleTick();
+
+  /** Handles the messages the controller put in mRingFromUI, called at the start of each block and before any message the controller
+   * posts, so that those (posted when the ring is full) are handled in order */
+  void ProcessMsgsFromUI();
+
+  /** Sends a message to the controller through mRingToUI
+   * @return \c false if the controller isn't attached (the processor isn't built with shared memory) or the ring is full, in which case the caller posts the message instead.
+   * The controller handles what is in the ring before a posted message, so the order is kept */
+  bool PushToUI(int type, const void* pData1, int size1, const void* pData2 = nullptr, int size2 = 0)
+  {
+    return mRingToUI.IsAttached() && mRingToUI.Push(type, pData1, size1, pData2, size2);
+  }
+
+  /** Rings in the heap for messages to and from the controller, see IPlugWAMSharedRing */
+  IPlugWAMSharedRing mRingToUI;
+  IPlugWAMSharedRing mRingFromUI;
 };
 
 IPlugWAM* MakePlug(const InstanceInfo& info);
@@ -0,0 +1,191 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugWAMSharedRing
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "heapbuf.h"
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A lock-free SPSC ring of variable sized messages, used to move events between the WAM processor (in the audio worklet) and the
+ * controller (on the main thread) without a postMessage() for each one.
+ * The ring lives in the processor's wasm heap. When the processor is built with shared memory (see common-web.mk), the heap is a
+ * SharedArrayBuffer which the processor's AudioWorkletProcessor passes to the controller, and the controller reads and writes
+ * the rings through views of it, with Atomics. Otherwise the controller never attaches, and the messages are posted as before.
+ *
+ * The layout is shared with IPlugWAMSharedRing in Template/scripts/IPlugWAM-awn.js, and must match it:
+ * - a header of four uint32s: the write position, the read position, the capacity (a power of two, in bytes) and a flag which the
+ *   controller sets when it attaches
+ * - the data: each message is an int32 type, an int32 size in bytes and the payload, padded to a multiple of four bytes. The
+ *   positions count bytes and wrap at 2^32, and messages wrap around the end of the data. */
+class IPlugWAMSharedRing final
+{
+public:
+  /** Message types. Those to the controller have the same names as the postMessage() verbs they replace */
+  enum EMsg
+  {
+    kSPVFD = 1, // int32 paramIdx, float64 value
+    kSCVFD, // int32 ctrlTag, float64 normalized value
+    kSCMFD, // int32 ctrlTag, int32 msgTag, data
+    kSAMFD, // int32 msgTag, data
+    kSMMFD, // uint8 status, data1, data2
+    kSSMFD, // data
+    kSPVFUI = 16, // int32 paramIdx, float64 normalized value
+    kSMMFUI, // uint8 status, data1, data2
+    kSAMFUI, // int32 msgTag, int32 ctrlTag, int32 dataSize, data (as the SAMFUI message)
+    kSSMFUI // data
+  };
+
+  static constexpr int kHeaderSize = 4 * sizeof(uint32_t);
+  static constexpr int kMsgHeaderSize = 2 * sizeof(int32_t);
+
+  /** @param capacity The size of the data in bytes, rounded up to a power of two */
+  IPlugWAMSharedRing(int capacity = 65536)
+  {
+    uint32_t size = 64;
+    while (size < (uint32_t) capacity)
+      size <<= 1;
+
+    mMemory.Resize((kHeaderSize + size) / sizeof(uint32_t));
+    memset(mMemory.Get(), 0, kHeaderSize + size);
+    mMemory.Get()[2] = size;
+    mScratch.Resize(size);
+  }
+
+  IPlugWAMSharedRing(const IPlugWAMSharedRing&) = delete;
+  IPlugWAMSharedRing& operator=(const IPlugWAMSharedRing&) = delete;
+
+  /** @return The address of the ring (its header) in the heap, for the controller */
+  const void* GetMemory() const { return mMemory.Get(); }
+
+  /** @return The size of the data in bytes */
+  int GetCapacity() const { return (int) mMemory.Get()[2]; }
+
+  /** @return \c true once the controller has attached to the ring, before that there is no one to read it */
+  bool IsAttached() const { return Index(3).load(std::memory_order_acquire) != 0; }
+
+  /** Sets the flag that says the other side has attached, the controller does this in JavaScript */
+  void SetAttached(bool attached) { Index(3).store(attached ? 1 : 0, std::memory_order_release); }
+
+  /** Adds a message, in up to two parts (so that a header and a payload don't need to be copied together first)
+   * @return \c false if the ring doesn't have room for it */
+  bool Push(int type, const void* pData1, int size1, const void* pData2 = nullptr, int size2 = 0)
+  {
+    const uint32_t capacity = mMemory.Get()[2];
+    const uint32_t size = (uint32_t) (size1 + size2);
+    const uint32_t total = kMsgHeaderSize + ((size + 3) & ~3u);
+    const uint32_t writePos = Index(0).load(std::memory_order_relaxed);
+    const uint32_t readPos = Index(1).load(std::memory_order_acquire);
+
+    if (capacity - (writePos - readPos) < total)
+      return false;
+
+    const int32_t header[2] = { type, (int32_t) size };
+    uint32_t pos = writePos;
+    pos = Write(pos, header, kMsgHeaderSize);
+    pos = Write(pos, pData1, size1);
+    Write(pos, pData2, size2);
+
+    Index(0).store(writePos + total, std::memory_order_release);
+    return true;
+  }
+
+  /** Calls func(int type, const uint8_t* pData, int size) for each message, in order. Messages that wrap around the end of the
+   * data are copied to a preallocated buffer, so nothing is allocated
+   * @return The number of messages */
+  template <class F>
+  int Drain(F func)
+  {
+    const uint32_t capacity = mMemory.Get()[2];
+    const uint32_t writePos = Index(0).load(std::memory_order_acquire);
+    uint32_t readPos = Index(1).load(std::memory_order_relaxed);
+    int nMsgs = 0;
+
+    while (readPos != writePos)
+    {
+      int32_t header[2];
+      Read(readPos, header, kMsgHeaderSize);
+
+      const uint32_t size = (uint32_t) header[1];
+      const uint32_t total = kMsgHeaderSize + ((size + 3) & ~3u);
+
+      if (size > capacity - kMsgHeaderSize || total > writePos - readPos) // damaged, drop everything
+      {
+        readPos = writePos;
+        break;
+      }
+
+      const uint32_t dataPos = (readPos + kMsgHeaderSize) & (capacity - 1);
+      const uint8_t* pData = GetData() + dataPos;
+
+      if (dataPos + size > capacity)
+      {
+        Read(readPos + kMsgHeaderSize, mScratch.Get(), (int) size);
+        pData = mScratch.Get();
+      }
+
+      func((int) header[0], pData, (int) size);
+      readPos += total;
+      nMsgs++;
+    }
+
+    Index(1).store(readPos, std::memory_order_release);
+    return nMsgs;
+  }
+
+private:
+  std::atomic<uint32_t>& Index(int idx) const
+  {
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "the header is read and written as plain uint32s by JavaScript");
+    return *reinterpret_cast<std::atomic<uint32_t>*>(mMemory.Get() + idx);
+  }
+
+  uint8_t* GetData() const { return reinterpret_cast<uint8_t*>(mMemory.Get()) + kHeaderSize; }
+
+  uint32_t Write(uint32_t pos, const void* pSrc, int size)
+  {
+    const uint32_t capacity = mMemory.Get()[2];
+    const uint32_t start = pos & (capacity - 1);
+    const uint32_t first = (uint32_t) size < capacity - start ? (uint32_t) size : capacity - start;
+
+    if (size)
+    {
+      memcpy(GetData() + start, pSrc, first);
+      memcpy(GetData(), static_cast<const uint8_t*>(pSrc) + first, size - first);
+    }
+    return pos + size;
+  }
+
+  void Read(uint32_t pos, void* pDst, int size) const
+  {
+    const uint32_t capacity = mMemory.Get()[2];
+    const uint32_t start = pos & (capacity - 1);
+    const uint32_t first = (uint32_t) size < capacity - start ? (uint32_t) size : capacity - start;
+
+    memcpy(pDst, GetData() + start, first);
+    memcpy(static_cast<uint8_t*>(pDst) + first, GetData(), size - first);
+  }
+
+  WDL_TypedBuf<uint32_t> mMemory;
+  WDL_TypedBuf<uint8_t> mScratch;
+};
+
+END_IPLUG_NAMESPACE
@@ -1,5 +1,103 @@
 /* Declares the NAME_PLACEHOLDER Audio Worklet Node */
 
+/* A single producer, single consumer ring of messages in a SharedArrayBuffer. This is the JavaScript side of IPlugWAMSharedRing
+   (IPlug/WEB/IPlugWAM_SharedRing.h), which lives in the processor's heap, and its layout and message types must match that */
+class IPlugWAMSharedRing
+{
+  constructor (buffer, byteOffset) {
+    this.header = new Uint32Array(buffer, byteOffset, 4); // write position, read position, capacity, attached
+    this.capacity = this.header[2];
+    this.data = new Uint8Array(buffer, byteOffset + 16, this.capacity);
+    this.view = new DataView(buffer, byteOffset + 16, this.capacity);
+    this.scratch = new Uint8Array(this.capacity);
+  }
+
+  static isValid (buffer, byteOffset) {
+    if (byteOffset <= 0 || byteOffset % 4 != 0 || byteOffset + 16 > buffer.byteLength)
+      return false;
+    const capacity = new Uint32Array(buffer, byteOffset, 4)[2];
+    return capacity >= 64 && (capacity & (capacity - 1)) == 0 && byteOffset + 16 + capacity <= buffer.byteLength;
+  }
+
+  setAttached (attached) { Atomics.store(this.header, 3, attached ? 1 : 0); }
+
+  isAttached () { return Atomics.load(this.header, 3) != 0; }
+
+  /* bytes is a Uint8Array, returns false if there isn't room for it */
+  push (type, bytes) {
+    const mask = this.capacity - 1;
+    const size = bytes.length;
+    const total = 8 + ((size + 3) & ~3);
+    const writePos = Atomics.load(this.header, 0);
+    const readPos = Atomics.load(this.header, 1);
+
+    if (this.capacity - ((writePos - readPos) >>> 0) < total)
+      return false;
+
+    this.view.setInt32(writePos & mask, type, true);
+    this.view.setInt32((writePos + 4) & mask, size, true);
+
+    const start = (writePos + 8) & mask;
+    const first = Math.min(size, this.capacity - start);
+    this.data.set(bytes.subarray(0, first), start);
+    if (first < size)
+      this.data.set(bytes.subarray(first), 0);
+
+    Atomics.store(this.header, 0, (writePos + total) >>> 0);
+    return true;
+  }
+
+  /* calls func(type, bytes) for each message, bytes is only valid during the call. Returns the number of messages */
+  drain (func) {
+    const mask = this.capacity - 1;
+    const writePos = Atomics.load(this.header, 0);
+    let readPos = Atomics.load(this.header, 1);
+    let nMsgs = 0;
+
+    while (readPos != writePos) {
+      const type = this.view.getInt32(readPos & mask, true);
+      const size = this.view.getInt32((readPos + 4) & mask, true) >>> 0;
+      const total = 8 + ((size + 3) & ~3);
+
+      if (size > this.capacity - 8 || total > ((writePos - readPos) >>> 0)) { // damaged, drop everything
+        readPos = writePos;
+        break;
+      }
+
+      const start = (readPos + 8) & mask;
+      let bytes;
+      if (start + size <= this.capacity) {
+        bytes = this.data.subarray(start, start + size);
+      }
+      else {
+        const first = this.capacity - start;
+        this.scratch.set(this.data.subarray(start), 0);
+        this.scratch.set(this.data.subarray(0, size - first), first);
+        bytes = this.scratch.subarray(0, size);
+      }
+
+      func(type, bytes);
+      readPos = (readPos + total) >>> 0;
+      nMsgs++;
+    }
+
+    Atomics.store(this.header, 1, readPos);
+    return nMsgs;
+  }
+}
+
+/* IPlugWAMSharedRing::EMsg */
+IPlugWAMSharedRing.kSPVFD = 1;
+IPlugWAMSharedRing.kSCVFD = 2;
+IPlugWAMSharedRing.kSCMFD = 3;
+IPlugWAMSharedRing.kSAMFD = 4;
+IPlugWAMSharedRing.kSMMFD = 5;
+IPlugWAMSharedRing.kSSMFD = 6;
+IPlugWAMSharedRing.kSPVFUI = 16;
+IPlugWAMSharedRing.kSMMFUI = 17;
+IPlugWAMSharedRing.kSAMFUI = 18;
+IPlugWAMSharedRing.kSSMFUI = 19;
+
 class NAME_PLACEHOLDERController extends WAMController
 {
   constructor (actx, options) {
@@ -11,6 +109,96 @@ class NAME_PLACEHOLDERController extends WAMController
 
     options.buflenSPN = 1024;
     super(actx, "NAME_PLACEHOLDER", options);
+
+    // the processor's heap and the rings in it, if the processor is built with shared memory
+    this.sharedHeap = null;
+    this.ringAddresses = null;
+    this.ringToUI = null;
+    this.ringFromUI = null;
+    this.paramMsg = new DataView(new ArrayBuffer(12));
+  }
+
+  attachRings() {
+    if (this.sharedHeap === null || this.ringAddresses === null || this.ringToUI !== null)
+      return;
+
+    if (!IPlugWAMSharedRing.isValid(this.sharedHeap, this.ringAddresses[0]) || !IPlugWAMSharedRing.isValid(this.sharedHeap, this.ringAddresses[1])) {
+      console.log("warning - the processor's message rings aren't in its heap, posting messages instead");
+      return;
+    }
+
+    this.ringToUI = new IPlugWAMSharedRing(this.sharedHeap, this.ringAddresses[0]);
+    this.ringFromUI = new IPlugWAMSharedRing(this.sharedHeap, this.ringAddresses[1]);
+    this.ringFromUI.setAttached(true);
+    this.ringToUI.setAttached(true); // from now on the processor uses the ring rather than posting messages
+  }
+
+  /* handles the messages from the processor in ringToUI, as onmessage() does the posted ones */
+  processRingToUI() {
+    this.ringToUI.drain((type, bytes) => {
+      const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.length);
+
+      switch (type) {
+        case IPlugWAMSharedRing.kSPVFD:
+          Module.SPVFD(view.getInt32(0, true), view.getFloat64(4, true));
+          break;
+        case IPlugWAMSharedRing.kSCVFD:
+          Module.SCVFD(view.getInt32(0, true), view.getFloat64(4, true));
+          break;
+        case IPlugWAMSharedRing.kSCMFD: {
+          const buffer = Module._malloc(bytes.length - 8);
+          Module.HEAPU8.set(bytes.subarray(8), buffer);
+          Module.SCMFD(view.getInt32(0, true), view.getInt32(4, true), bytes.length - 8, buffer);
+          Module._free(buffer);
+          break;
+        }
+        case IPlugWAMSharedRing.kSAMFD: {
+          const buffer = Module._malloc(bytes.length - 4);
+          Module.HEAPU8.set(bytes.subarray(4), buffer);
+          Module.SAMFD(view.getInt32(0, true), bytes.length - 4, buffer);
+          Module._free(buffer);
+          break;
+        }
+        case IPlugWAMSharedRing.kSMMFD:
+          Module.SMMFD(bytes[0], bytes[1], bytes[2]);
+          break;
+        case IPlugWAMSharedRing.kSSMFD: {
+          const buffer = Module._malloc(bytes.length);
+          Module.HEAPU8.set(bytes, buffer);
+          Module.SSMFD(bytes.length, buffer);
+          Module._free(buffer);
+          break;
+        }
+      }
+    });
+  }
+
+  setParam(key, value) {
+    if (this.ringFromUI !== null) {
+      this.paramMsg.setInt32(0, key, true);
+      this.paramMsg.setFloat64(4, value, true);
+      if (this.ringFromUI.push(IPlugWAMSharedRing.kSPVFUI, new Uint8Array(this.paramMsg.buffer)))
+        return;
+    }
+    super.setParam(key, value);
+  }
+
+  sendMessage(verb, prop, data) {
+    if (this.ringFromUI !== null) {
+      // the UI's idle timer sends TICK, which is when the processor's messages are handled
+      if (verb == "TICK") {
+        this.processRingToUI();
+      }
+      else if (verb == "SMMFUI") {
+        if (this.ringFromUI.push(IPlugWAMSharedRing.kSMMFUI, new Uint8Array(prop.split(":").map(x => parseInt(x)))))
+          return;
+      }
+      else if (verb == "SAMFUI" && data instanceof ArrayBuffer) {
+        if (this.ringFromUI.push(IPlugWAMSharedRing.kSAMFUI, new Uint8Array(data)))
+          return;
+      }
+    }
+    super.sendMessage(verb, prop, data);
   }
 
   static importScripts (actx) {
@@ -30,9 +218,25 @@ class NAME_PLACEHOLDERController extends WAMController
     if(msg.type == "descriptor") {
       console.log("got WAM descriptor...");
     }
+    //The processor's heap, if it is built with shared memory
+    else if(msg.type == "sharedMemory") {
+      this.sharedHeap = msg.buffer;
+      this.attachRings();
+    }
+
+    //Once attached, the processor only posts these when ringToUI is full, so the messages in the ring come first
+    if(this.ringToUI !== null && ["SPVFD", "SCVFD", "SCMFD", "SAMFD", "SMMFD", "SSMFD"].includes(msg.verb)) {
+      this.processRingToUI();
+    }
+
+    //Where the message rings are in the processor's heap
+    if(msg.verb == "SharedRings") {
+      this.ringAddresses = msg.prop.split(":").map(x => parseInt(x));
+      this.attachRings();
+    }
 
     //Send Parameter Value From Delegate
-    if(msg.verb == "SPVFD") {
+    else if(msg.verb == "SPVFD") {
       Module.SPVFD(parseInt(msg.prop), parseFloat(msg.data));
     }
     //Set Control Value From Delegate
@@ -6,6 +6,11 @@ class NAME_PLACEHOLDER_AWP extends AudioWorkletGlobalScope.WAMProcessor
     options = options || {}
     options.mod = AudioWorkletGlobalScope.WAM.NAME_PLACEHOLDER;
     super(options);
+
+    // if the processor is built with shared memory, give the controller its heap, so that they can exchange messages through rings in it
+    const heap = options.mod.HEAPU8 ? options.mod.HEAPU8.buffer : undefined;
+    if (typeof SharedArrayBuffer !== "undefined" && heap instanceof SharedArrayBuffer)
+      this.port.postMessage({ type: "sharedMemory", buffer: heap });
   }
 }
 
@@ -64,6 +64,7 @@ elseif (CMAKE_SYSTEM_NAME MATCHES "Linux")
   set(IPLUG_APP_ALSA 1 CACHE BOOL "Use ALSA on Linux")
   set(IPLUG_APP_JACK 1 CACHE BOOL "Use JACK on Linux")
   set(IPLUG_APP_PULSE 1 CACHE BOOL "Use Pulse Audio on Linux")
+  set(IPLUG_APP_JACK_NATIVE 0 CACHE BOOL "Experimental: when the JACK driver is selected, use a native JACK client instead of RtAudio")
 
   # Build and link Swell properly on Linux. This uses GTK+ 3.0 and X11
   set(swell_src
@@ -104,6 +105,11 @@ elseif (CMAKE_SYSTEM_NAME MATCHES "Linux")
   if (IPLUG_APP_JACK)
     iplug_target_add(iPlug2_APP INTERFACE
       DEFINE "__UNIX_JACK__" LINK PkgConfig::Jack)
+    if (IPLUG_APP_JACK_NATIVE)
+      iplug_target_add(iPlug2_APP INTERFACE
+        DEFINE "APP_NATIVE_JACK"
+        SOURCE ${sdk}/IPlugAPP_jack.h ${sdk}/IPlugAPP_jack.cpp)
+    endif()
   endif()
   if (IPLUG_APP_PULSE)
     iplug_target_add(iPlug2_APP INTERFACE
@@ -252,11 +252,14 @@ set(_src
   ${sdk}/IPlugAPIBase.h
   ${sdk}/IPlugAPIBase.cpp
   ${sdk}/IPlugConstants.h
+  ${sdk}/IPlugDenormals.h
   ${sdk}/IPlugEditorDelegate.h
+  ${sdk}/IPlugFixedIO.h
   ${sdk}/IPlugLogger.h
   ${sdk}/IPlugMidi.h
   ${sdk}/IPlugParameter.h
   ${sdk}/IPlugParameter.cpp
+  ${sdk}/IPlugParamChangeSet.h
   ${sdk}/IPlugPaths.h
   ${sdk}/IPlugPaths.cpp
   ${sdk}/IPlugPlatform.h
@@ -266,6 +269,7 @@ set(_src
   ${sdk}/IPlugProcessor.cpp
   ${sdk}/IPlugQueue.h
   ${sdk}/IPlugStructs.h
+  ${sdk}/IPlugSysExQueue.h
   ${sdk}/IPlugTimer.h
   ${sdk}/IPlugTimer.cpp
   ${sdk}/IPlugUtilities.h
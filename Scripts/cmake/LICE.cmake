@@ -16,8 +16,12 @@ set(_src
   lice_import.h
   lice_line.cpp
   lice_lvg.cpp
+  lice_mt.cpp
+  lice_mt.h
   lice_palette.cpp
   lice_pcx.cpp  
+  lice_simd.h
+  lice_simd_impl.h
   lice_texgen.cpp
   lice_text.cpp
   lice_text.h
@@ -229,3 +233,14 @@ set(_src
 list(TRANSFORM _src PREPEND "${WDL_DIR}/zlib/")
 add_library(LICE_ZLIB INTERFACE)
 iplug_target_add(LICE_ZLIB INTERFACE SOURCE ${_src})
+
+
+# process-wide decoded image cache, decodes PNG/JPG from memory
+add_library(LICE_ImageCache INTERFACE)
+iplug_target_add(LICE_ImageCache INTERFACE
+  SOURCE
+    "${LICE_SRC}/lice_imgcache.cpp"
+  LINK
+    LICE_PNG
+    LICE_JPEG
+)
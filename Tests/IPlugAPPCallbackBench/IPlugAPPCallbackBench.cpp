@@ -0,0 +1,481 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugAPPCallbackBench: runs copies of the standalone app's audio callback (IPlugAPPHost::AudioCallback(), ProcessInPlace(),
+ * ProcessThroughFIFO(), ApplyGain() and ApplyFades() in IPlug/APP/IPlugAPP_host.cpp, which need RtAudio and a plug-in) and of
+ * the per frame loop it replaced, with a stand-in plug-in whose output depends on where each signal vector starts, and
+ *  - checks that buffers which are a multiple of the signal vector size give exactly the previous loop's output, with and
+ *    without APP_MULT, and that the fades match the previous ones
+ *  - checks that other buffer sizes give exactly the output of processing the stream in whole signal vectors, one signal
+ *    vector later, that each vector gets the start time of its first frame, and that nothing is written outside the buffers
+ *    (which the previous loop did)
+ *  - prints the time per frame of the previous loop and the current callback across buffer sizes and channel counts
+ *
+ * usage: IPlugAPPCallbackBench [seconds of audio to time per case (20)]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "ptrlist.h"
+#include "heapbuf.h"
+
+#define APP_SIGNAL_VECTOR_SIZE 64 // as in the examples' config.h
+
+static const double kSampleRate = 48000.;
+static const int kGuardFrames = 4 * APP_SIGNAL_VECTOR_SIZE;
+static const double kGuardValue = 12345.;
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+/** Stands in for IPlugAPP::AppProcess(): each output is an input scaled, plus a value that says which signal vector of the
+ * stream it was processed in, so that vectors that start in the wrong place don't give the same output */
+class TestPlug
+{
+public:
+  TestPlug(int nIns, int nOuts) : mNIns(nIns), mNOuts(nOuts) {}
+
+  void AppProcess(double** inputs, double** outputs, int nFrames, double startTime)
+  {
+    const double vectorValue = 0.001 * mNVectors++;
+    for (int c = 0; c < mNOuts; c++)
+    {
+      double* pOut = outputs[c];
+      if (mNIns)
+      {
+        const double* pIn = inputs[c % mNIns];
+        for (int i = 0; i < nFrames; i++)
+          pOut[i] = pIn[i] * 0.5 + vectorValue;
+      }
+      else
+      {
+        for (int i = 0; i < nFrames; i++)
+          pOut[i] = vectorValue;
+      }
+    }
+    if (mRecordTimes)
+      mStartTimes.push_back(startTime);
+  }
+
+  int mNIns, mNOuts;
+  int64_t mNVectors = 0;
+  bool mRecordTimes = false;
+  std::vector<double> mStartTimes;
+};
+
+// ApplyFades() as it was
+static void OldApplyFades(double *pBuffer, int nChans, int nFrames, bool down)
+{
+  for (int i = 0; i < nChans; i++)
+  {
+    double *pIO = pBuffer + (i * nFrames);
+
+    if (down)
+    {
+      for (int j = 0; j < nFrames; j++)
+        pIO[j] *= ((double) (nFrames - (j + 1)) / (double) nFrames);
+    }
+    else
+    {
+      for (int j = 0; j < nFrames; j++)
+        pIO[j] *= ((double) j / (double) nFrames);
+    }
+  }
+}
+
+// ApplyFades()
+static void ApplyFades(double *pBuffer, int nChans, int nFrames, bool down)
+{
+  const double step = 1. / (double) nFrames;
+
+  for (int i = 0; i < nChans; i++)
+  {
+    double *pIO = pBuffer + (i * nFrames);
+
+    if (down)
+    {
+      for (int j = 0; j < nFrames; j++)
+        pIO[j] *= (double) (nFrames - (j + 1)) * step;
+    }
+    else
+    {
+      for (int j = 0; j < nFrames; j++)
+        pIO[j] *= (double) j * step;
+    }
+  }
+}
+
+// ApplyGain()
+static void ApplyGain(double *pBuffer, int nSamples, double gain)
+{
+  for (int i = 0; i < nSamples; i++)
+    pBuffer[i] *= gain;
+}
+
+/** The parts of IPlugAPPHost that the audio callback uses, with APP_MULT 1/kAppMultDivisor */
+template <int kAppMultDivisor>
+class TestHost
+{
+public:
+  static constexpr double APP_MULT = 1. / kAppMultDivisor;
+
+  TestHost(TestPlug* pPlug) : mIPlug(pPlug)
+  {
+    // as InitAudio()
+    for (int i = 0; i < pPlug->mNIns; i++)
+      mInputBufPtrs.Add(nullptr);
+
+    for (int i = 0; i < pPlug->mNOuts; i++)
+      mOutputBufPtrs.Add(nullptr);
+
+    mInputFIFO.Resize(pPlug->mNIns * APP_SIGNAL_VECTOR_SIZE);
+    mOutputFIFO.Resize(pPlug->mNOuts * APP_SIGNAL_VECTOR_SIZE);
+    memset(mInputFIFO.Get(), 0, mInputFIFO.GetSize() * sizeof(double));
+    memset(mOutputFIFO.Get(), 0, mOutputFIFO.GetSize() * sizeof(double));
+  }
+
+  void ProcessInPlace(double* pInputBuffer, double* pOutputBuffer, uint32_t nFrames, double startTime)
+  {
+    const int nins = mInputBufPtrs.GetSize();
+    const int nouts = mOutputBufPtrs.GetSize();
+
+    for (uint32_t i = 0; i < nFrames; i += APP_SIGNAL_VECTOR_SIZE)
+    {
+      for (int c = 0; c < nins; c++)
+        mInputBufPtrs.Set(c, pInputBuffer + (c * nFrames) + i);
+
+      for (int c = 0; c < nouts; c++)
+        mOutputBufPtrs.Set(c, pOutputBuffer + (c * nFrames) + i);
+
+      mIPlug->AppProcess(mInputBufPtrs.GetList(), mOutputBufPtrs.GetList(), APP_SIGNAL_VECTOR_SIZE, startTime + (i / mSampleRate));
+
+      mSamplesElapsed += APP_SIGNAL_VECTOR_SIZE;
+    }
+  }
+
+  void ProcessThroughFIFO(double* pInputBuffer, double* pOutputBuffer, uint32_t nFrames, double startTime)
+  {
+    const uint32_t vs = APP_SIGNAL_VECTOR_SIZE;
+    const int nins = mInputBufPtrs.GetSize();
+    const int nouts = mOutputBufPtrs.GetSize();
+    double* pInputFIFO = mInputFIFO.Get();
+    double* pOutputFIFO = mOutputFIFO.Get();
+    uint32_t pos = 0;
+
+    while (pos < nFrames)
+    {
+      // copy as many frames as fit in the FIFO: input goes in, output processed during an earlier chunk comes out
+      const uint32_t n = std::min(nFrames - pos, vs - mFIFOIndex);
+
+      for (int c = 0; c < nins; c++)
+        memcpy(pInputFIFO + (c * vs) + mFIFOIndex, pInputBuffer + (c * nFrames) + pos, n * sizeof(double));
+
+      for (int c = 0; c < nouts; c++)
+        memcpy(pOutputBuffer + (c * nFrames) + pos, pOutputFIFO + (c * vs) + mFIFOIndex, n * sizeof(double));
+
+      pos += n;
+      mFIFOIndex += n;
+
+      if (mFIFOIndex == vs)
+      {
+        for (int c = 0; c < nins; c++)
+          mInputBufPtrs.Set(c, pInputFIFO + (c * vs));
+
+        for (int c = 0; c < nouts; c++)
+          mOutputBufPtrs.Set(c, pOutputFIFO + (c * vs));
+
+        // the chunk's input started vs frames before the current position, which may be in the previous buffer
+        mIPlug->AppProcess(mInputBufPtrs.GetList(), mOutputBufPtrs.GetList(), vs, startTime + (((double) pos - vs) / mSampleRate));
+
+        mSamplesElapsed += vs;
+        mFIFOIndex = 0;
+      }
+    }
+  }
+
+  /** AudioCallback() once audio is running, blockStartTime is the stream time */
+  void AudioCallback(double* pOutputBufferD, double* pInputBufferD, uint32_t nFrames, double blockStartTime, bool doFade)
+  {
+    const int nins = mIPlug->mNIns;
+    const int nouts = mIPlug->mNOuts;
+
+    if (doFade)
+      ApplyFades(pInputBufferD, nins, nFrames, false);
+
+    if (!mUseFIFO && (nFrames % APP_SIGNAL_VECTOR_SIZE) != 0)
+      mUseFIFO = true;
+
+    if (mUseFIFO)
+      ProcessThroughFIFO(pInputBufferD, pOutputBufferD, nFrames, blockStartTime);
+    else
+      ProcessInPlace(pInputBufferD, pOutputBufferD, nFrames, blockStartTime);
+
+    if (APP_MULT != 1.)
+      ApplyGain(pOutputBufferD, nouts * nFrames, APP_MULT); // non-interleaved channels are contiguous, so this is a single span
+
+    if (doFade)
+      ApplyFades(pOutputBufferD, nouts, nFrames, false);
+  }
+
+  /** The previous AudioCallback() loop */
+  void OldAudioCallback(double* pOutputBufferD, double* pInputBufferD, uint32_t nFrames, double blockStartTime, bool doFade)
+  {
+    const int nins = mIPlug->mNIns;
+    const int nouts = mIPlug->mNOuts;
+
+    if (doFade)
+      OldApplyFades(pInputBufferD, nins, nFrames, false);
+
+    for (int i = 0; i < (int) nFrames; i++)
+    {
+      mBufIndex %= APP_SIGNAL_VECTOR_SIZE;
+
+      if (mBufIndex == 0)
+      {
+        for (int c = 0; c < nins; c++)
+        {
+          mInputBufPtrs.Set(c, (pInputBufferD + (c * nFrames)) + i);
+        }
+
+        for (int c = 0; c < nouts; c++)
+        {
+          mOutputBufPtrs.Set(c, (pOutputBufferD + (c * nFrames)) + i);
+        }
+
+        mIPlug->AppProcess(mInputBufPtrs.GetList(), mOutputBufPtrs.GetList(), APP_SIGNAL_VECTOR_SIZE, blockStartTime + (i / mSampleRate));
+
+        mSamplesElapsed += APP_SIGNAL_VECTOR_SIZE;
+      }
+
+      for (int c = 0; c < nouts; c++)
+      {
+        pOutputBufferD[c * nFrames + i] *= APP_MULT;
+      }
+
+      mBufIndex++;
+    }
+
+    if (doFade)
+      OldApplyFades(pOutputBufferD, nouts, nFrames, false);
+  }
+
+  TestPlug* mIPlug;
+  double mSampleRate = kSampleRate;
+  uint32_t mSamplesElapsed = 0;
+  uint32_t mBufIndex = 0;
+  uint32_t mFIFOIndex = 0;
+  bool mUseFIFO = false;
+  WDL_PtrList<double> mInputBufPtrs;
+  WDL_PtrList<double> mOutputBufPtrs;
+  WDL_TypedBuf<double> mInputFIFO;
+  WDL_TypedBuf<double> mOutputFIFO;
+};
+
+/** RtAudio's non-interleaved buffers for one callback, with guard frames after them */
+struct CallbackBuffers
+{
+  CallbackBuffers(int nIns, int nOuts, int nFrames)
+  : mNIns(nIns), mNOuts(nOuts), mNFrames(nFrames)
+  , mInputs(nIns * nFrames + kGuardFrames), mOutputs(nOuts * nFrames + kGuardFrames)
+  {}
+
+  /** Fills the inputs with frames [pos, pos + nFrames) of the stream, and the guards */
+  void Fill(const std::vector<double>& stream, int64_t pos)
+  {
+    for (int c = 0; c < mNIns; c++)
+      for (int i = 0; i < mNFrames; i++)
+        mInputs[c * mNFrames + i] = stream[(size_t) (pos + i) * mNIns + c];
+    std::fill(mInputs.begin() + mNIns * mNFrames, mInputs.end(), kGuardValue);
+    std::fill(mOutputs.begin() + mNOuts * mNFrames, mOutputs.end(), kGuardValue);
+  }
+
+  bool GuardsIntact() const
+  {
+    return std::all_of(mInputs.begin() + mNIns * mNFrames, mInputs.end(), [](double v) { return v == kGuardValue; })
+        && std::all_of(mOutputs.begin() + mNOuts * mNFrames, mOutputs.end(), [](double v) { return v == kGuardValue; });
+  }
+
+  int mNIns, mNOuts, mNFrames;
+  std::vector<double> mInputs, mOutputs;
+};
+
+static std::vector<double> MakeStream(int nIns, int64_t nFrames)
+{
+  std::vector<double> stream((size_t) (nFrames * std::max(nIns, 1)));
+  for (auto& v : stream)
+    v = (Rand() & 0xffff) / 32768. - 1.;
+  return stream;
+}
+
+/** Aligned buffer sizes: the same output as the previous loop, including the fades of the first buffer */
+template <int kAppMultDivisor>
+static bool CheckAligned(int nIns, int nOuts, int nFrames)
+{
+  const int nBuffers = 50;
+  const std::vector<double> stream = MakeStream(nIns, (int64_t) nBuffers * nFrames);
+  TestPlug plug(nIns, nOuts), oldPlug(nIns, nOuts);
+  TestHost<kAppMultDivisor> host(&plug), oldHost(&oldPlug);
+  CallbackBuffers bufs(nIns, nOuts, nFrames), oldBufs(nIns, nOuts, nFrames);
+  bool ok = true;
+
+  for (int k = 0; k < nBuffers; k++)
+  {
+    bufs.Fill(stream, (int64_t) k * nFrames);
+    oldBufs.Fill(stream, (int64_t) k * nFrames);
+    host.AudioCallback(bufs.mOutputs.data(), bufs.mInputs.data(), nFrames, k * nFrames / kSampleRate, k == 0);
+    oldHost.OldAudioCallback(oldBufs.mOutputs.data(), oldBufs.mInputs.data(), nFrames, k * nFrames / kSampleRate, k == 0);
+
+    for (int i = 0; i < nOuts * nFrames; i++)
+    {
+      const double a = bufs.mOutputs[i], b = oldBufs.mOutputs[i];
+      // the fades multiply by a step rather than divide, which can round differently
+      if (k == 0 ? std::fabs(a - b) > 1e-15 * std::max(1., std::fabs(b)) : a != b)
+        ok = false;
+    }
+    ok &= bufs.GuardsIntact();
+  }
+  return ok;
+}
+
+/** Other buffer sizes: the stream processed in whole signal vectors, one signal vector later, and each vector's start time */
+static bool CheckFIFO(int nIns, int nOuts, int nFrames, int* pOldOverrun)
+{
+  const int vs = APP_SIGNAL_VECTOR_SIZE;
+  const int nBuffers = std::max(50, 8 * vs / nFrames);
+  const std::vector<double> stream = MakeStream(nIns, (int64_t) nBuffers * nFrames);
+  TestPlug plug(nIns, nOuts), oldPlug(nIns, nOuts);
+  TestHost<2> host(&plug), oldHost(&oldPlug);
+  CallbackBuffers bufs(nIns, nOuts, nFrames), oldBufs(nIns, nOuts, nFrames);
+  bool ok = true;
+  plug.mRecordTimes = true;
+  *pOldOverrun = 0;
+
+  for (int k = 0; k < nBuffers; k++)
+  {
+    const int64_t pos = (int64_t) k * nFrames;
+    bufs.Fill(stream, pos);
+    host.AudioCallback(bufs.mOutputs.data(), bufs.mInputs.data(), nFrames, pos / kSampleRate, false);
+    ok &= bufs.GuardsIntact();
+
+    for (int c = 0; c < nOuts; c++)
+      for (int i = 0; i < nFrames; i++)
+      {
+        // frame f of the output is frame f - vs of the stream, processed in vector (f - vs) / vs
+        const int64_t f = pos + i - vs;
+        double expected = 0.;
+        if (f >= 0)
+          expected = ((nIns ? stream[(size_t) f * nIns + (c % nIns)] * 0.5 : 0.) + 0.001 * (f / vs)) * 0.5;
+        if (bufs.mOutputs[c * nFrames + i] != expected)
+          ok = false;
+      }
+
+    oldBufs.Fill(stream, pos);
+    oldHost.OldAudioCallback(oldBufs.mOutputs.data(), oldBufs.mInputs.data(), nFrames, pos / kSampleRate, false);
+    for (int i = nOuts * nFrames; i < nOuts * nFrames + kGuardFrames; i++)
+      if (oldBufs.mOutputs[i] != kGuardValue)
+        (*pOldOverrun)++;
+  }
+
+  for (size_t j = 0; j < plug.mStartTimes.size(); j++)
+    if (std::fabs(plug.mStartTimes[j] - (double) (j * vs) / kSampleRate) > 1e-9)
+      ok = false;
+
+  return ok && plug.mStartTimes.size() == (size_t) ((int64_t) nBuffers * nFrames / vs);
+}
+
+/** ns per frame of the previous loop, or of the current callback */
+static double Time(int nChans, int nFrames, bool old, double seconds)
+{
+  TestPlug plug(nChans, nChans);
+  TestHost<1> host(&plug);
+  CallbackBuffers bufs(nChans, nChans, nFrames);
+  bufs.Fill(MakeStream(nChans, nFrames), 0);
+  const int nCallbacks = std::max(1, (int) (seconds * kSampleRate / nFrames));
+
+  double best = 1e9;
+  for (int rep = 0; rep < 3; rep++)
+  {
+    const double start = Now();
+    for (int k = 0; k < nCallbacks; k++)
+    {
+      if (old)
+        host.OldAudioCallback(bufs.mOutputs.data(), bufs.mInputs.data(), nFrames, 0., false);
+      else
+        host.AudioCallback(bufs.mOutputs.data(), bufs.mInputs.data(), nFrames, 0., false);
+    }
+    best = std::min(best, (Now() - start) * 1e9 / ((double) nCallbacks * nFrames));
+  }
+  return best;
+}
+
+int main(int argc, char** argv)
+{
+  const double seconds = argc > 1 ? atof(argv[1]) : 20.;
+  int errors = 0;
+
+  bool ok = true;
+  for (int nIns : {0, 1, 2})
+    for (int nOuts : {1, 2, 8})
+      for (int nFrames : {64, 128, 512, 1024})
+        ok &= CheckAligned<1>(nIns, nOuts, nFrames) && CheckAligned<4>(nIns, nOuts, nFrames);
+  printf("multiples of the signal vector size, the same as the previous loop: %s\n", ok ? "yes" : "NO");
+  errors += !ok;
+
+  ok = true;
+  int maxOverrun = 0;
+  for (int nIns : {0, 2})
+    for (int nOuts : {1, 2, 8})
+      for (int nFrames : {1, 33, 100, 441, 480, 1000})
+      {
+        int overrun = 0;
+        if (!CheckFIFO(nIns, nOuts, nFrames, &overrun))
+        {
+          printf("  %d in, %d out, %d frames: output or vector start times differ\n", nIns, nOuts, nFrames);
+          ok = false;
+        }
+        maxOverrun = std::max(maxOverrun, overrun);
+      }
+  printf("other sizes, the stream in whole vectors one vector later, inside the buffers: %s\n", ok ? "yes" : "NO");
+  printf("  (the previous loop wrote up to %d samples past the end of the output buffer in a run)\n", maxOverrun);
+  errors += !ok;
+
+  printf("\nns per frame, %gs of audio at %gHz per case, %d frame signal vectors, APP_MULT 1:\n", seconds, kSampleRate, APP_SIGNAL_VECTOR_SIZE);
+  printf("  %8s %8s %12s %12s\n", "channels", "buffer", "previous", "current");
+  for (int nChans : {2, 8})
+    for (int nFrames : {64, 256, 1024, 441})
+    {
+      const bool aligned = nFrames % APP_SIGNAL_VECTOR_SIZE == 0;
+      const double cur = Time(nChans, nFrames, false, seconds / 3.);
+      if (aligned)
+        printf("  %8d %8d %12.3f %12.3f\n", nChans, nFrames, Time(nChans, nFrames, true, seconds / 3.), cur);
+      else
+        printf("  %8d %8d %12s %12.3f\n", nChans, nFrames, "overruns", cur);
+    }
+
+  printf("\n%s\n", errors ? "FAILED" : "all checks passed");
+  return errors ? 1 : 0;
+}
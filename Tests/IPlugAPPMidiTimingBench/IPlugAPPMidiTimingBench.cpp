@@ -0,0 +1,384 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugAPPMidiTimingBench: runs the standalone app's MIDI input path (IPlugAPPMidiInput and IPlugAPPStreamClock in IPlug/APP/IPlugAPP_midiin.h,
+ * which IPlugAPPHost's RtMidi and RtAudio callbacks and IPlugAPP::ProcessAppBlock() use) without RtAudio, RtMidi or a plug-in.
+ *
+ * First on a simulated stream, where the audio device's clock drifts from the MIDI clock, each audio callback wakes up late by a
+ * random amount and MIDI messages arrive at random times, it
+ *  - checks that every message is delivered once, in order, at an offset inside the signal vector it is processed in
+ *  - checks that the latency from a message's arrival to the frame it is played at varies by no more than the clock drift over
+ *    the window the earliest wake-up is taken from and a small part of the jitter, once the stream clock has settled (also after
+ *    an underflow), and by much less than delivering everything at offset 0 did
+ *  - prints the mean latency and its spread (1st to 99th percentile, and the largest difference) with the previous offset 0
+ *    delivery and with the arrival time offsets, for several buffer sizes and amounts of wake-up jitter
+ *
+ * Then in real time, with a thread standing in for RtMidi's that calls the MIDI callback with chords, fast controller sweeps and
+ * SysEx dumps split into pieces, and an audio thread with 2048 frame buffers, it checks that no message is dropped, that all of them
+ * are delivered once and in order, and how many were queued at most, compared with the previous queue size (MIDI_TRANSFER_SIZE).
+ *
+ * usage: IPlugAPPMidiTimingBench [seconds to simulate per run (60, at least 12)]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "IPlugConstants.h"
+#include "IPlugMidi.h"
+#include "IPlugAPP_midiin.h"
+
+using namespace iplug;
+
+static const int kSignalVectorSize = 64; // APP_SIGNAL_VECTOR_SIZE in the examples' config.h
+static const double kSampleRate = 48000.;
+static const double kSettleTime = 3.; // seconds for the stream clock offset to settle, two windows of 32 callbacks at 2048 frames
+static const double kDeviceClockRate = 1. - 100e-6; // the audio device's clock is 100ppm slow compared to the MIDI clock
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+static double Rand01()
+{
+  return (Rand() & 0xffffff) / (double) 0x1000000;
+}
+
+/** A message as the plug-in's ProcessMidiMsg() sees it, and the stream frame of the signal vector it came in */
+struct Delivery
+{
+  int mId;
+  int mOffset;
+  int64_t mVectorFrame;
+};
+
+/** Delivers the queued input for one signal vector as IPlugAPP::ProcessAppBlock() does, or as the previous version did, which processed
+ * every message that had arrived at offset 0 */
+static void ProcessMidiInput(IPlugAPPMidiInput& input, int nFrames, double startTime, double wakeTime, double sampleRate, bool old,
+                             int64_t vectorFrame, std::vector<Delivery>& delivered)
+{
+  auto processMidiMsg = [&](const IMidiMsg& msg) {
+    delivered.push_back({msg.mData1 | (msg.mData2 << 7), msg.mOffset, vectorFrame});
+  };
+
+  // everything in the queue arrived before the callback woke up, so with that as the start time it all goes at offset 0
+  input.Deliver(nFrames, old ? wakeTime : startTime, sampleRate, processMidiMsg, [](const ISysEx&) {});
+}
+
+struct Result
+{
+  double mMeanMs = 0.;
+  double mSpread = 0.; // samples, 1st to 99th percentile
+  double mMaxSpread = 0.; // samples
+  bool mOK = true;
+};
+
+/** Runs a stream of bufferSize frame callbacks, each waking up late by up to jitter seconds, with an underflow of three buffers halfway */
+static Result Run(int bufferSize, double jitter, bool old, double seconds)
+{
+  Result result;
+  IPlugAPPMidiInput input;
+  IPlugAPPStreamClock clock;
+  std::vector<Delivery> delivered;
+  std::vector<double> arrivals;
+  std::vector<double> playTimes; // on the MIDI clock, of the frame each message is played at, by id
+
+  const double bufferDuration = bufferSize / kSampleRate;
+  const int nBuffers = (int) (seconds / bufferDuration);
+  const int stallBuffer = nBuffers / 2;
+  double streamStart = 1000. + Rand01(); // the MIDI clock time at which the stream's frame 0 is played
+  auto clockTime = [&](double streamTime) { return streamStart + streamTime / kDeviceClockRate; };
+  double nextArrival = streamStart + Rand01() * 0.004;
+
+  std::vector<double> playStarts; // streamStart for each buffer, the underflow moves it on
+
+  for (int k = 0; k < nBuffers; k++)
+  {
+    const double streamTime = k * bufferDuration;
+    bool underflow = false;
+
+    if (k == stallBuffer)
+    {
+      streamStart += 3 * bufferDuration; // the callback is three buffers late, and the device plays silence meanwhile
+      underflow = true;
+    }
+
+    // the callback for buffer k runs when buffer k-1 starts playing, late by up to the jitter
+    const double wakeTime = clockTime(streamTime - bufferDuration) + Rand01() * jitter;
+
+    // the MIDI callback pushes what arrived before then, about one message every 10ms
+    while (nextArrival < wakeTime)
+    {
+      const int id = (int) arrivals.size();
+      const uint8_t msg[3] = {0x90, (uint8_t) (id & 0x7f), (uint8_t) ((id >> 7) & 0x7f)};
+      if (input.Add(msg, 3, nextArrival))
+        arrivals.push_back(nextArrival);
+      else
+        result.mOK = false;
+      nextArrival += Rand01() * 0.02;
+    }
+
+    const double blockStartTime = clock.BlockStartTime(wakeTime, streamTime, bufferSize, kSampleRate, underflow);
+
+    for (int i = 0; i < bufferSize; i += kSignalVectorSize)
+      ProcessMidiInput(input, kSignalVectorSize, blockStartTime + (i / kSampleRate), wakeTime, kSampleRate, old, (int64_t) k * bufferSize + i, delivered);
+
+    playStarts.push_back(streamStart);
+  }
+
+  // every message once, in order, inside its signal vector
+  int expectedId = 0;
+  playTimes.assign(arrivals.size(), 0.);
+  for (const Delivery& d : delivered)
+  {
+    if (d.mId != (expectedId & 0x3fff) || d.mOffset < 0 || d.mOffset >= kSignalVectorSize)
+      result.mOK = false;
+    const int64_t frame = d.mVectorFrame + d.mOffset;
+    if (expectedId < (int) playTimes.size())
+      playTimes[expectedId] = playStarts[(int) (d.mVectorFrame / bufferSize)] + frame / kSampleRate / kDeviceClockRate;
+    expectedId++;
+  }
+  if (expectedId + (int) input.NMidiMsgsQueued() != (int) arrivals.size())
+    result.mOK = false;
+
+  // latency once the clock offset has settled, at the start and after the underflow
+  std::vector<double> latencies;
+  const double settled = playStarts.front() + kSettleTime;
+  const double stalled = playStarts[stallBuffer] + (stallBuffer - 1) * bufferDuration / kDeviceClockRate;
+  for (int i = 0; i < expectedId && i < (int) arrivals.size(); i++)
+  {
+    const double t = arrivals[i];
+    if (t < settled || (t >= stalled - 4 * bufferDuration && t < stalled + kSettleTime))
+      continue;
+    latencies.push_back((playTimes[i] - t) * kSampleRate);
+  }
+
+  if (latencies.empty())
+  {
+    result.mOK = false;
+    return result;
+  }
+
+  double sum = 0.;
+  for (double l : latencies)
+    sum += l;
+  result.mMeanMs = sum / latencies.size() / kSampleRate * 1e3;
+
+  std::sort(latencies.begin(), latencies.end());
+  result.mSpread = latencies[(latencies.size() * 99) / 100] - latencies[latencies.size() / 100];
+  result.mMaxSpread = latencies.back() - latencies.front();
+  return result;
+}
+
+struct ThreadedInput
+{
+  IPlugAPPMidiInput mInput;
+  std::atomic<int> mDropped {0};
+};
+
+/** The stand-in for RtMidi's thread calls this as RtMidi calls IPlugAPPHost::MIDICallback(), which passes the message to IPlugAPPMidiInput::Add() */
+static void MIDICallback(double deltatime, std::vector<uint8_t>* pMsg, void* pUserData)
+{
+  ThreadedInput* pInput = static_cast<ThreadedInput*>(pUserData);
+
+  if (pMsg->size() == 0)
+    return;
+
+  if (!pInput->mInput.Add(pMsg->data(), static_cast<int>(pMsg->size()), Now()))
+    pInput->mDropped++;
+}
+
+struct ThreadedResult
+{
+  int mMessages = 0;
+  int mSysExMessages = 0;
+  int mMaxQueued = 0;
+  bool mOK = true;
+};
+
+/** Real time: a MIDI thread sends a chord, a fast controller sweep and a SysEx dump in three pieces every 100ms, while the audio thread
+ * processes buffers of bufferSize frames */
+static ThreadedResult ThreadedRun(int bufferSize, double seconds)
+{
+  ThreadedResult result;
+  ThreadedInput input;
+  IPlugAPPStreamClock clock;
+  std::atomic<bool> done {false};
+  int sentMessages = 0;
+  int sentSysEx = 0;
+  const int kSysExSize = 300;
+
+  std::thread midiThread([&]() {
+    std::vector<uint8_t> msg;
+    int id = 0;
+    auto sendShort = [&](uint8_t status) {
+      msg.assign({status, (uint8_t) (id & 0x7f), (uint8_t) ((id >> 7) & 0x7f)});
+      MIDICallback(0., &msg, &input);
+      id++;
+    };
+
+    while (!done)
+    {
+      const auto next = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+
+      for (int i = 0; i < 10; i++) // a chord, all at once
+        sendShort(0x90);
+
+      for (int i = 0; i < 128; i++) // a controller sweep, as fast as a USB device sends it
+      {
+        sendShort(0xB0);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+
+      // a SysEx dump, which RtMidi may deliver in several pieces
+      std::vector<uint8_t> dump(kSysExSize, (uint8_t) (sentSysEx & 0x7f));
+      dump.front() = 0xF0;
+      dump.back() = 0xF7;
+      for (int piece = 0; piece < 3; piece++)
+      {
+        msg.assign(dump.begin() + piece * kSysExSize / 3, dump.begin() + (piece + 1) * kSysExSize / 3);
+        MIDICallback(0., &msg, &input);
+      }
+      sentSysEx++;
+
+      for (int i = 0; i < 10; i++)
+        sendShort(0x80);
+
+      sentMessages = id;
+      std::this_thread::sleep_until(next);
+    }
+  });
+
+  int expectedId = 0;
+  int expectedTag = 0;
+  const double bufferDuration = bufferSize / kSampleRate;
+  const int nBuffers = (int) (seconds / bufferDuration);
+  const double start = Now();
+
+  for (int k = 0; k < nBuffers; k++)
+  {
+    // the callback for buffer k wakes up when buffer k-1 starts playing
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(start + k * bufferDuration))));
+
+    const double blockStartTime = clock.BlockStartTime(Now(), k * bufferDuration, bufferSize, kSampleRate, false);
+    result.mMaxQueued = std::max(result.mMaxQueued, (int) input.mInput.NMidiMsgsQueued());
+
+    for (int i = 0; i < bufferSize; i += kSignalVectorSize)
+    {
+      input.mInput.Deliver(kSignalVectorSize, blockStartTime + (i / kSampleRate), kSampleRate,
+        [&](const IMidiMsg& msg) {
+          if ((msg.mData1 | (msg.mData2 << 7)) != (expectedId & 0x3fff) || msg.mOffset < 0 || msg.mOffset >= kSignalVectorSize)
+            result.mOK = false;
+          expectedId++;
+        },
+        [&](const ISysEx& msg) {
+          bool ok = msg.mSize == kSysExSize && msg.mData[0] == 0xF0 && msg.mData[msg.mSize - 1] == 0xF7;
+          for (int j = 1; ok && j < msg.mSize - 1; j++)
+            ok = msg.mData[j] == (expectedTag & 0x7f);
+          if (!ok)
+            result.mOK = false;
+          expectedTag++;
+        });
+    }
+  }
+
+  done = true;
+  midiThread.join();
+
+  // what arrived after the last buffer is still queued
+  input.mInput.Deliver(kSignalVectorSize, Now(), kSampleRate, [&](const IMidiMsg&) { expectedId++; }, [&](const ISysEx&) { expectedTag++; });
+
+  if (input.mDropped || expectedId != sentMessages || expectedTag != sentSysEx)
+    result.mOK = false;
+
+  result.mMessages = expectedId;
+  result.mSysExMessages = expectedTag;
+  return result;
+}
+
+int main(int argc, char** argv)
+{
+  const double seconds = std::max(argc > 1 ? atof(argv[1]) : 60., 4. * kSettleTime);
+  int errors = 0;
+  const double start = Now();
+
+  printf("MIDI latency from arrival to playback, %gs at %gHz per run, %d frame signal vectors, about 100 messages a second\n", seconds, kSampleRate, kSignalVectorSize);
+  printf("the device clock 100ppm slow and an underflow halfway, spread in samples (1st to 99th percentile / largest difference):\n\n");
+  printf("  %6s %8s   %-30s %-30s\n", "buffer", "jitter", "offset 0 (previous)", "arrival time offsets");
+  printf("  %6s %8s   %8s %10s %10s   %8s %10s %10s\n", "", "", "mean ms", "spread", "max", "mean ms", "spread", "max");
+
+  for (int bufferSize : {64, 256, 512, 1024, 2048})
+  {
+    for (double jitterMs : {0., 0.25, 1.})
+    {
+      // the callback has to finish within its buffer, so it can't be much later than that
+      const double jitter = std::min(jitterMs * 0.001, 0.5 * bufferSize / kSampleRate);
+      sSeed = 1;
+      const Result prev = Run(bufferSize, jitter, true, seconds);
+      sSeed = 1;
+      const Result cur = Run(bufferSize, jitter, false, seconds);
+
+      printf("  %6d %5.2fms   %8.2f %10.1f %10.1f   %8.2f %10.1f %10.1f\n", bufferSize, jitter * 1e3,
+             prev.mMeanMs, prev.mSpread, prev.mMaxSpread, cur.mMeanMs, cur.mSpread, cur.mMaxSpread);
+
+      if (!prev.mOK || !cur.mOK)
+      {
+        printf("    FAILED: messages lost, repeated, out of order or outside their signal vector\n");
+        errors++;
+      }
+
+      // the offset is the earliest wake-up in the last one or two windows of half a second or more, which is a little later than the
+      // earliest possible one, and the clocks drift apart meanwhile
+      const double window = std::max(32. * bufferSize / kSampleRate, 0.5);
+      const double allowed = 2. + (1. - kDeviceClockRate) * 2. * window * kSampleRate + jitter * kSampleRate * 0.1;
+      if (cur.mMaxSpread > allowed)
+      {
+        printf("    FAILED: the latency varies by %.1f samples, more than %.1f\n", cur.mMaxSpread, allowed);
+        errors++;
+      }
+      if (bufferSize > kSignalVectorSize && cur.mSpread * 4. > prev.mSpread)
+      {
+        printf("    FAILED: not much steadier than delivering at offset 0\n");
+        errors++;
+      }
+    }
+  }
+
+  printf("\nsimulated in %.0fms\n", (Now() - start) * 1e3);
+
+  const ThreadedResult threaded = ThreadedRun(2048, 3.);
+  printf("\nreal time, 3s with 2048 frame buffers and a MIDI thread sending a chord, a 128 message controller sweep and a 300 byte SysEx dump every 100ms:\n");
+  printf("  %d messages and %d SysEx messages delivered, at most %d messages queued (MIDI_TRANSFER_SIZE %d, APP_MIDI_INPUT_QUEUE_SIZE %d)\n",
+         threaded.mMessages, threaded.mSysExMessages, threaded.mMaxQueued, MIDI_TRANSFER_SIZE, APP_MIDI_INPUT_QUEUE_SIZE);
+  if (!threaded.mOK)
+  {
+    printf("    FAILED: messages dropped, lost, repeated, out of order, damaged or outside their signal vector\n");
+    errors++;
+  }
+
+  printf("\n%s\n", errors ? "FAILED" : "all checks passed");
+  return errors ? 1 : 0;
+}
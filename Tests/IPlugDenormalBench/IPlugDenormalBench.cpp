@@ -0,0 +1,219 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugDenormalBench: runs the decaying tail of a plug-in (LogParamSmooth gains heading to zero and a resonator ringing
+ * out after a burst) in 64 sample blocks, and prints the time per sample in each quarter second:
+ *  - with the host's floating point mode and no fixes, where the tail slows down once it reaches the denormal range
+ *  - inside an IDenormalScope with kDenormalsFlush, as the API classes now call ProcessBlock()
+ *  - with per-sample denormal_fix() calls, as LogParamSmooth used to do
+ * It also checks that the scope restores the previous mode, and that kDenormalsCount counts the blocks that hit denormals.
+ *
+ * usage: IPlugDenormalBench [seconds of audio (4)]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "IPlugDenormals.h"
+#include "Smoothers.h"
+#include "denormal.h"
+
+using namespace iplug;
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const double kSampleRate = 48000.0;
+static const int kBlockSize = 64;
+static const int kNumSmoothers = 4;
+static const int kNumChans = 4;
+
+// LogParamSmooth::ProcessBlock() as it was, with a denormal_fix() per sample
+template<typename T, int NC>
+struct FixedSmooth
+{
+  double mA, mB;
+  T mOutM1[NC];
+
+  FixedSmooth(double timeMs, T value)
+  {
+    for (int i = 0; i < NC; i++) mOutM1[i] = value;
+    mA = exp(-6.283185307179586476925286766559 / (timeMs * 0.001 * kSampleRate));
+    mB = 1.0 - mA;
+  }
+
+  void ProcessBlock(T inputs[NC], T** outputs, int nFrames)
+  {
+    const T b = mB;
+    const T a = mA;
+    for (int s = 0; s < nFrames; ++s)
+    {
+      for (int c = 0; c < NC; c++)
+      {
+        T output = (inputs[c] * b) + (mOutM1[c] * a);
+        denormal_fix(&output);
+        mOutM1[c] = output;
+        outputs[c][s] = output;
+      }
+    }
+  }
+};
+
+// two pole resonator at 440Hz with a radius giving about a 2 second ring out into the denormal range
+struct Resonator
+{
+  double mB1, mB2, mY1 = 0.0, mY2 = 0.0;
+
+  Resonator()
+  {
+    const double r = 0.9993;
+    mB1 = 2.0 * r * cos(6.283185307179586 * 440.0 / kSampleRate);
+    mB2 = -r * r;
+  }
+
+  template<bool FIX>
+  void Process(const double* in, double* out, int nFrames)
+  {
+    for (int s = 0; s < nFrames; s++)
+    {
+      double y = in[s] + mB1 * mY1 + mB2 * mY2;
+      if (FIX) denormal_fix(&y);
+      mY2 = mY1;
+      mY1 = y;
+      out[s] = y;
+    }
+  }
+};
+
+enum EVariant { kVariantHost, kVariantFlush, kVariantFix, kNumVariants };
+
+// returns the seconds spent in each window of nWindow blocks
+static std::vector<double> Run(EVariant variant, int nBlocks, int nWindow, EDenormalMode mode, std::atomic<int>* pCount)
+{
+  std::vector<LogParamSmooth<double, kNumChans>> smoothers;
+  std::vector<FixedSmooth<double, kNumChans>> fixed;
+  for (int i = 0; i < kNumSmoothers; i++)
+  {
+    smoothers.emplace_back(2.0 + 2.0 * i, 1.0);
+    smoothers.back().SetSmoothTime(2.0 + 2.0 * i, kSampleRate);
+    fixed.emplace_back(2.0 + 2.0 * i, 1.0);
+  }
+  Resonator res;
+
+  std::vector<double> bufs(kNumChans * kBlockSize), in(kBlockSize), out(kBlockSize);
+  double* ptrs[kNumChans];
+  for (int c = 0; c < kNumChans; c++) ptrs[c] = bufs.data() + c * kBlockSize;
+  double targets[kNumChans] = {};
+
+  std::vector<double> times;
+  double t0 = Now();
+  double sum = 0.0;
+  for (int b = 0; b < nBlocks; b++)
+  {
+    for (int s = 0; s < kBlockSize; s++) in[s] = b * kBlockSize + s < 480 ? ((s & 8) ? 0.5 : -0.5) : 0.0;
+
+    {
+      IDenormalScope scope(variant == kVariantFlush ? kDenormalsFlush : mode, pCount);
+      for (int i = 0; i < kNumSmoothers; i++)
+      {
+        if (variant == kVariantFix) fixed[i].ProcessBlock(targets, ptrs, kBlockSize);
+        else smoothers[i].ProcessBlock(targets, ptrs, kBlockSize);
+      }
+      if (variant == kVariantFix) res.Process<true>(in.data(), out.data(), kBlockSize);
+      else res.Process<false>(in.data(), out.data(), kBlockSize);
+    }
+    sum += bufs[kBlockSize - 1] + out[kBlockSize - 1];
+
+    if ((b + 1) % nWindow == 0)
+    {
+      const double t1 = Now();
+      times.push_back(t1 - t0);
+      t0 = t1;
+    }
+  }
+  if (sum == 12345.0) printf(" ");
+  return times;
+}
+
+static bool CheckRestore()
+{
+  bool ok = true;
+#if defined(IPLUG_DENORMALS_SSE)
+  const unsigned int before = _mm_getcsr();
+  {
+    IDenormalScope scope(kDenormalsFlush);
+    if ((_mm_getcsr() & 0x8040) != 0x8040) ok = false;
+    volatile double tiny = 1e-300;
+    tiny = tiny * 1e-20; // would be a denormal
+    if (tiny != 0.0) ok = false;
+  }
+  if (_mm_getcsr() != before) ok = false;
+#endif
+  return ok;
+}
+
+int main(int argc, char** argv)
+{
+  const double secs = argc > 1 ? atof(argv[1]) : 4.0;
+  const int nWindow = (int) (kSampleRate * 0.25) / kBlockSize;
+  const int nBlocks = (int) (kSampleRate * secs) / kBlockSize / nWindow * nWindow;
+
+  const bool restoreOK = CheckRestore();
+  printf("kDenormalsFlush sets FTZ/DAZ and restores the previous mode: %s\n", restoreOK ? "yes" : "NO");
+
+  std::atomic<int> hostCount {0}, flushCount {0};
+  Run(kVariantHost, nBlocks, nWindow, kDenormalsCount, &hostCount);
+  {
+    // counting inside a flushing scope: FTZ/DAZ means no denormals are produced or used
+    IDenormalScope outer(kDenormalsFlush);
+    Run(kVariantHost, nBlocks, nWindow, kDenormalsCount, &flushCount);
+  }
+#if defined(IPLUG_DENORMALS_SSE) || defined(IPLUG_DENORMALS_ARM)
+  const bool countOK = hostCount > 0 && hostCount < nBlocks && flushCount == 0;
+#else
+  const bool countOK = true;
+#endif
+  printf("kDenormalsCount: %d of %d blocks hit denormals with the host's mode, %d with FTZ/DAZ: %s\n\n",
+         hostCount.load(), nBlocks, flushCount.load(), countOK ? "ok" : "WRONG");
+
+  std::vector<double> times[kNumVariants];
+  for (int v = 0; v < kNumVariants; v++) times[v] = Run((EVariant) v, nBlocks, nWindow, kDenormalsHost, nullptr);
+
+  const double n = nWindow * kBlockSize;
+  printf("ns per sample, %d smoothers x %d channels + resonator, %d sample blocks at 48kHz\n\n",
+         kNumSmoothers, kNumChans, kBlockSize);
+  printf("%8s %14s %14s %14s\n", "ms", "host mode", "flush scope", "denormal_fix");
+  double total[kNumVariants] = {}, peak[kNumVariants] = {};
+  for (size_t w = 0; w < times[0].size(); w++)
+  {
+    printf("%8d", (int) (w * 250));
+    for (int v = 0; v < kNumVariants; v++)
+    {
+      const double ns = times[v][w] * 1e9 / n;
+      total[v] += ns;
+      if (ns > peak[v]) peak[v] = ns;
+      printf(" %14.2f", ns);
+    }
+    printf("\n");
+  }
+  printf("%8s", "mean");
+  for (int v = 0; v < kNumVariants; v++) printf(" %14.2f", total[v] / times[v].size());
+  printf("\n%8s", "peak");
+  for (int v = 0; v < kNumVariants; v++) printf(" %14.2f", peak[v]);
+  printf("\n");
+
+  return restoreOK && countOK ? 0 : 1;
+}
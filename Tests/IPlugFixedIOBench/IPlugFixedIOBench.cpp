@@ -0,0 +1,252 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugFixedIOBench: runs a stereo gain written against IPlugFixedIO (IPlug/IPlugFixedIO.h), and the same gain written with ProcessBlock()
+ * and the connected channel count, through IPlugProcessor's channel table the way the API classes drive it, and
+ *  - checks that both give exactly the same output on the connected channels, with a stereo host and with a mono one (PLUG_CHANNEL_IO "1-1 2-2"),
+ *    across block size changes that move the scratch memory
+ *  - checks the connected channel counts, and that unconnected channels point at the processor's scratch memory
+ *  - prints the time per frame of both, for several block sizes
+ *
+ * usage: IPlugFixedIOBench [frames per test (20000000)]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "IPlugProcessor.h"
+#include "IPlugFixedIO.h"
+
+using namespace iplug;
+
+static const int kMaxBlockSize = 4096;
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+/** Stands in for an API class: it connects the host's channels and processes its buffers as IPlugAPP::ProcessAppBlock() does */
+class TestAPI : public IPlugProcessor
+{
+public:
+  TestAPI()
+  : IPlugProcessor(Config(0, 0, "1-1 2-2", "IPlugFixedIOBench", "", "", 0x10000, 'Fxio', 'Acme', 0, false, false, false, false, 0, false, 0, 0, false, 0, 0, 0, 0, ""), kAPIAPP)
+  {
+  }
+
+  void Process(sample** inputs, sample** outputs, int nInputs, int nOutputs, int nFrames)
+  {
+    if (nFrames > GetBlockSize())
+      SetBlockSize(nFrames);
+
+    SetChannelConnections(ERoute::kInput, 0, MaxNChannels(ERoute::kInput), false);
+    SetChannelConnections(ERoute::kInput, 0, nInputs, true);
+    SetChannelConnections(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), false);
+    SetChannelConnections(ERoute::kOutput, 0, nOutputs, true);
+    AttachBuffers(ERoute::kInput, 0, nInputs, inputs, nFrames);
+    AttachBuffers(ERoute::kOutput, 0, nOutputs, outputs, nFrames);
+    ProcessBuffers((sample) 0, nFrames);
+  }
+
+  bool SendMidiMsg(const IMidiMsg& msg) override { return false; }
+
+  using IPlugProcessor::SetBlockSize;
+
+  /** @return \c true if each of the channels from idx onwards points at scratch memory rather than at a host buffer */
+  bool UsesScratch(sample** ppHostBuffers, int nHostBuffers, int idx, sample** ppChannels, int nChannels) const
+  {
+    for (int c = idx; c < nChannels; c++)
+    {
+      for (int h = 0; h < nHostBuffers; h++)
+      {
+        if (ppChannels[c] == ppHostBuffers[h])
+          return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+/** The gain as IPlugEffect writes it, with the connected channel count */
+class DynamicGain final : public TestAPI
+{
+public:
+  void ProcessBlock(sample** inputs, sample** outputs, int nFrames) override
+  {
+    const int nChans = NOutChansConnected();
+
+    for (int s = 0; s < nFrames; s++)
+    {
+      for (int c = 0; c < nChans; c++)
+        outputs[c][s] = inputs[c][s] * mGain;
+    }
+  }
+
+  sample mGain = 0.5;
+};
+
+/** The same gain against compile time channel counts */
+class FixedGain final : public IPlugFixedIO<FixedGain, 2, 2, TestAPI>
+{
+public:
+  void ProcessFixedBlock(InputChannels inputs, OutputChannels outputs, int nFrames)
+  {
+    mInputs = inputs.Get();
+    mOutputs = outputs.Get();
+
+    for (int s = 0; s < nFrames; s++)
+    {
+      for (int c = 0; c < kNOutputs; c++)
+        outputs[c][s] = inputs[c][s] * mGain;
+    }
+  }
+
+  sample mGain = 0.5;
+  sample** mInputs = nullptr;
+  sample** mOutputs = nullptr;
+};
+
+struct HostBuffers
+{
+  HostBuffers()
+  {
+    for (int c = 0; c < 2; c++)
+    {
+      mIn[c].resize(kMaxBlockSize);
+      mOut[c].resize(kMaxBlockSize);
+      mOutRef[c].resize(kMaxBlockSize);
+      mInPtrs[c] = mIn[c].data();
+      mOutPtrs[c] = mOut[c].data();
+      mOutRefPtrs[c] = mOutRef[c].data();
+    }
+  }
+
+  std::vector<sample> mIn[2], mOut[2], mOutRef[2];
+  sample* mInPtrs[2];
+  sample* mOutPtrs[2];
+  sample* mOutRefPtrs[2];
+};
+
+/** Process random blocks with both plug-ins, changing the block size and the host's channel count now and then
+ * @return The number of errors */
+static int Check()
+{
+  int errors = 0;
+  DynamicGain dynamicGain;
+  FixedGain fixedGain;
+  HostBuffers host;
+
+  for (int block = 0; block < 2000; block++)
+  {
+    const int nChans = (block / 100) % 2 ? 1 : 2;
+    const int nFrames = 1 + (int) (Rand() % kMaxBlockSize);
+
+    // the API classes set the block size when the host changes it, which moves the scratch memory
+    if (block % 37 == 0)
+    {
+      const int blockSize = 1 + (int) (Rand() % kMaxBlockSize);
+      dynamicGain.SetBlockSize(blockSize);
+      fixedGain.SetBlockSize(blockSize);
+    }
+
+    for (int c = 0; c < 2; c++)
+    {
+      for (int s = 0; s < nFrames; s++)
+        host.mIn[c][s] = (sample) ((int) (Rand() % 2001) - 1000) / 1000.;
+    }
+
+    dynamicGain.Process(host.mInPtrs, host.mOutRefPtrs, nChans, nChans, nFrames);
+    fixedGain.Process(host.mInPtrs, host.mOutPtrs, nChans, nChans, nFrames);
+
+    for (int c = 0; c < nChans; c++)
+    {
+      for (int s = 0; s < nFrames; s++)
+      {
+        if (host.mOut[c][s] != host.mOutRef[c][s])
+        {
+          if (!errors)
+            printf("FAILED: block %d (%d frames, %d channels), channel %d frame %d: %g, expected %g\n", block, nFrames, nChans, c, s, host.mOut[c][s], host.mOutRef[c][s]);
+          errors++;
+        }
+      }
+    }
+
+    if (fixedGain.NInChansConnected() != nChans || fixedGain.NOutChansConnected() != nChans || dynamicGain.NOutChansConnected() != nChans)
+    {
+      printf("FAILED: block %d, %d channels connected, %d expected\n", block, fixedGain.NOutChansConnected(), nChans);
+      errors++;
+    }
+
+    // the unconnected channel of a mono host must point at the processor's own memory, never at (or past) the host's buffers
+    if (!fixedGain.UsesScratch(host.mInPtrs, 2, nChans, fixedGain.mInputs, 2) || !fixedGain.UsesScratch(host.mOutPtrs, 2, nChans, fixedGain.mOutputs, 2))
+    {
+      printf("FAILED: block %d, an unconnected channel points at a host buffer\n", block);
+      errors++;
+    }
+  }
+
+  return errors;
+}
+
+template <class TPlug>
+static double TimePerFrame(TPlug& plug, HostBuffers& host, int nFrames, long long totalFrames)
+{
+  plug.SetBlockSize(nFrames);
+
+  const long long nBlocks = totalFrames / nFrames;
+  const double start = Now();
+
+  for (long long i = 0; i < nBlocks; i++)
+    plug.Process(host.mInPtrs, host.mOutPtrs, 2, 2, nFrames);
+
+  return (Now() - start) / (nBlocks * nFrames);
+}
+
+int main(int argc, char* argv[])
+{
+  const long long totalFrames = argc > 1 ? atoll(argv[1]) : 20000000;
+
+  int errors = Check();
+  printf("IPlugFixedIO against ProcessBlock(), stereo and mono host, random block sizes: %s\n\n", errors ? "FAILED" : "ok");
+
+  DynamicGain dynamicGain;
+  FixedGain fixedGain;
+  HostBuffers host;
+
+  for (int c = 0; c < 2; c++)
+  {
+    for (int s = 0; s < kMaxBlockSize; s++)
+      host.mIn[c][s] = (sample) ((int) (Rand() % 2001) - 1000) / 1000.;
+  }
+
+  printf("stereo gain, ns per frame:\n");
+  printf("  %6s %14s %14s\n", "block", "ProcessBlock", "IPlugFixedIO");
+
+  for (int nFrames : {16, 64, 256, 1024})
+  {
+    const double dynamicTime = TimePerFrame(dynamicGain, host, nFrames, totalFrames);
+    const double fixedTime = TimePerFrame(fixedGain, host, nFrames, totalFrames);
+    printf("  %6d %14.3f %14.3f\n", nFrames, dynamicTime * 1e9, fixedTime * 1e9);
+  }
+
+  return errors ? 1 : 0;
+}
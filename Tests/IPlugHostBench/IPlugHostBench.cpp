@@ -0,0 +1,635 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugHostBench: a headless host that loads a VST2 plug-in, runs a scripted session on it
+ * and reports processing and state call timings, so that the overhead of the plug-in wrapper can be measured
+ * and checked for regressions. It also performs some basic validation: the process exits with
+ * a non-zero status if the plug-in outputs non-finite samples, fails to reconfigure, or doesn't restore its own state.
+ */
+
+#include "IPlugHostBench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+static const char* kDefaultSession =
+  "# default session: exercise automation, MIDI, state and reconfiguration\n"
+  "rate 44100\n"
+  "block 512\n"
+  "input noise\n"
+  "process 200\n"
+  "ramp all 0 1 200\n"
+  "note 60 100 0\n"
+  "note 64 100 128\n"
+  "process 100\n"
+  "noteoff 60 0\n"
+  "noteoff 64 17\n"
+  "cc 1 64 0\n"
+  "process 100\n"
+  "state 20\n"
+  "block 64\n"
+  "process 1000\n"
+  "rate 96000\n"
+  "block 1024\n"
+  "process 200\n"
+  "state 5\n";
+
+static double Now()
+{
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+/** Collects call durations and reports percentiles */
+class BenchStats
+{
+public:
+  void Add(double seconds) { mTimes.push_back(seconds); }
+  bool Empty() const { return mTimes.empty(); }
+
+  /** Print a summary line. If blockDuration is > 0. the mean is also reported as a percentage of the real time available */
+  void Report(const char* name, double blockDuration = 0.) const
+  {
+    if (mTimes.empty())
+      return;
+
+    std::vector<double> sorted(mTimes);
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.;
+    for (double t : sorted)
+      sum += t;
+
+    const double mean = sum / sorted.size();
+
+    auto percentile = [&](double p) {
+      const size_t idx = std::min(sorted.size() - 1, (size_t) (p * (sorted.size() - 1) + 0.5));
+      return sorted[idx] * 1e6;
+    };
+
+    printf("  %-24s n=%-7zu mean=%9.2fus p50=%9.2fus p90=%9.2fus p99=%9.2fus p99.9=%9.2fus max=%9.2fus",
+           name, sorted.size(), mean * 1e6, percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), sorted.back() * 1e6);
+
+    if (blockDuration > 0.)
+      printf(" load=%.2f%%", 100. * mean / blockDuration);
+
+    printf("\n");
+  }
+
+private:
+  std::vector<double> mTimes;
+};
+
+/** A parameter that is automated linearly over a number of blocks */
+struct BenchRamp
+{
+  int mParamIdx;
+  double mFrom;
+  double mTo;
+  int mNBlocks;
+  int mBlock = 0;
+};
+
+enum class EBenchInput
+{
+  kSilence,
+  kNoise,
+  kSine
+};
+
+/** Runs a session script on a plug-in and collects the results */
+class BenchSession
+{
+public:
+  BenchSession(IBenchPlugin& plugin, bool verbose)
+  : mPlugin(plugin)
+  , mVerbose(verbose)
+  {
+  }
+
+  bool Run(std::istream& script)
+  {
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(script, line))
+    {
+      lineNumber++;
+
+      const size_t comment = line.find('#');
+      if (comment != std::string::npos)
+        line.resize(comment);
+
+      std::istringstream tokens(line);
+      std::vector<std::string> args;
+      std::string token;
+
+      while (tokens >> token)
+        args.push_back(token);
+
+      if (args.empty())
+        continue;
+
+      if (!RunCommand(args))
+      {
+        fprintf(stderr, "line %d: invalid command \"%s\"\n", lineNumber, line.c_str());
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  void Report() const
+  {
+    printf("\n%s plug-in \"%s\": %d inputs, %d outputs, %d parameters\n",
+           mPlugin.GetFormatName(), mPlugin.GetName().c_str(), mPlugin.NInputs(), mPlugin.NOutputs(), mPlugin.NParams());
+
+    printf("process:\n");
+    for (auto& config : mProcessStats)
+    {
+      char name[64];
+      snprintf(name, sizeof(name), "%.0f Hz, %d", config.first.first, config.first.second);
+      config.second.Report(name, config.first.second / config.first.first);
+    }
+
+    if (!mGetStateStats.Empty() || !mSetStateStats.Empty() || !mConfigureStats.Empty())
+    {
+      printf("state and configuration:\n");
+      mGetStateStats.Report("get state");
+      mSetStateStats.Report("set state");
+      mConfigureStats.Report("configure");
+    }
+
+    if (mMaxStateSize > 0)
+      printf("  largest state: %zu bytes\n", mMaxStateSize);
+
+    if (mMidiOutputEvents > 0)
+      printf("  MIDI messages output: %lld\n", mMidiOutputEvents);
+
+    printf("\n%d warning(s), %d failure(s)\n", mWarnings, mFailures);
+  }
+
+  int GetFailures() const { return mFailures; }
+
+private:
+  bool RunCommand(const std::vector<std::string>& args)
+  {
+    const std::string& cmd = args[0];
+    const int nArgs = (int) args.size() - 1;
+
+    auto argInt = [&](int i, int defaultValue) { return i <= nArgs ? atoi(args[i].c_str()) : defaultValue; };
+    auto argDouble = [&](int i, double defaultValue) { return i <= nArgs ? atof(args[i].c_str()) : defaultValue; };
+
+    if (cmd == "rate" && nArgs == 1)
+    {
+      mSampleRate = argDouble(1, mSampleRate);
+      return Configure();
+    }
+    else if (cmd == "block" && nArgs == 1)
+    {
+      mBlockSize = std::max(1, argInt(1, mBlockSize));
+      return Configure();
+    }
+    else if (cmd == "tempo" && nArgs == 1)
+    {
+      mTransport.mTempo = argDouble(1, mTransport.mTempo);
+      return true;
+    }
+    else if (cmd == "transport" && nArgs == 1)
+    {
+      mTransport.mPlaying = (args[1] == "play");
+      return true;
+    }
+    else if (cmd == "input" && nArgs == 1)
+    {
+      if (args[1] == "silence")
+        mInput = EBenchInput::kSilence;
+      else if (args[1] == "noise")
+        mInput = EBenchInput::kNoise;
+      else if (args[1] == "sine")
+        mInput = EBenchInput::kSine;
+      else
+        return false;
+
+      return true;
+    }
+    else if (cmd == "process" && nArgs == 1)
+    {
+      return Process(argInt(1, 1));
+    }
+    else if (cmd == "param" && (nArgs == 2 || nArgs == 3))
+    {
+      const int idx = argInt(1, -1);
+      if (!CheckParamIdx(idx))
+        return false;
+
+      mPlugin.SetParam(idx, argDouble(2, 0.), ClampOffset(argInt(3, 0)));
+      mParamChecks[idx] = argDouble(2, 0.);
+      return true;
+    }
+    else if (cmd == "ramp" && nArgs == 4)
+    {
+      const int nBlocks = std::max(1, argInt(4, 1));
+
+      if (args[1] == "all")
+      {
+        for (int i = 0; i < mPlugin.NParams(); i++)
+          mRamps.push_back({i, argDouble(2, 0.), argDouble(3, 1.), nBlocks});
+      }
+      else
+      {
+        const int idx = argInt(1, -1);
+        if (!CheckParamIdx(idx))
+          return false;
+
+        mRamps.push_back({idx, argDouble(2, 0.), argDouble(3, 1.), nBlocks});
+      }
+      return true;
+    }
+    else if ((cmd == "note" && (nArgs == 2 || nArgs == 3)) || (cmd == "noteoff" && (nArgs == 1 || nArgs == 2)))
+    {
+      const bool noteOn = (cmd == "note");
+      const uint8_t msg[3] = {
+        (uint8_t) (noteOn ? 0x90 : 0x80),
+        (uint8_t) (argInt(1, 60) & 0x7F),
+        (uint8_t) (noteOn ? argInt(2, 100) & 0x7F : 0)
+      };
+      mPlugin.AddMidi(msg, 3, ClampOffset(argInt(noteOn ? 3 : 2, 0)));
+      return true;
+    }
+    else if (cmd == "cc" && (nArgs == 2 || nArgs == 3))
+    {
+      const uint8_t msg[3] = { 0xB0, (uint8_t) (argInt(1, 1) & 0x7F), (uint8_t) (argInt(2, 0) & 0x7F) };
+      mPlugin.AddMidi(msg, 3, ClampOffset(argInt(3, 0)));
+      return true;
+    }
+    else if (cmd == "sysex" && nArgs >= 1)
+    {
+      // the payload is given as hex bytes, F0 and F7 are added here
+      std::vector<uint8_t> msg = { 0xF0 };
+      for (int i = 1; i <= nArgs; i++)
+        msg.push_back((uint8_t) (strtol(args[i].c_str(), nullptr, 16) & 0x7F));
+      msg.push_back(0xF7);
+      mPlugin.AddMidi(msg.data(), (int) msg.size(), 0);
+      return true;
+    }
+    else if (cmd == "state" && nArgs <= 1)
+    {
+      return StateRoundTrips(argInt(1, 1));
+    }
+
+    return false;
+  }
+
+  bool CheckParamIdx(int idx) const
+  {
+    return idx >= 0 && idx < mPlugin.NParams();
+  }
+
+  int ClampOffset(int offset) const
+  {
+    return std::max(0, std::min(offset, mBlockSize - 1));
+  }
+
+  bool Configure()
+  {
+    const double start = Now();
+    const bool ok = mPlugin.Configure(mSampleRate, mBlockSize);
+    mConfigureStats.Add(Now() - start);
+
+    if (!ok)
+      Fail("failed to configure %.0f Hz, block size %d", mSampleRate, mBlockSize);
+
+    mConfigured = ok;
+
+    const int nChans = std::max(mPlugin.NInputs(), mPlugin.NOutputs());
+    mBuffers.resize(nChans);
+    mInputPtrs.resize(mPlugin.NInputs());
+    mOutputPtrs.resize(mPlugin.NOutputs());
+
+    for (auto& buffer : mBuffers)
+      buffer.assign(2 * mBlockSize, 0.f);
+
+    // inputs and outputs are separate, some formats don't allow processing in place
+    for (int i = 0; i < mPlugin.NInputs(); i++)
+      mInputPtrs[i] = mBuffers[i].data();
+
+    for (int i = 0; i < mPlugin.NOutputs(); i++)
+      mOutputPtrs[i] = mBuffers[i].data() + mBlockSize;
+
+    return true;
+  }
+
+  void FillInputs()
+  {
+    for (int c = 0; c < mPlugin.NInputs(); c++)
+    {
+      float* pIn = mInputPtrs[c];
+
+      switch (mInput)
+      {
+        case EBenchInput::kSilence:
+          std::fill(pIn, pIn + mBlockSize, 0.f);
+          break;
+        case EBenchInput::kNoise:
+          for (int s = 0; s < mBlockSize; s++)
+          {
+            mNoiseState = mNoiseState * 1664525u + 1013904223u;
+            pIn[s] = ((int32_t) mNoiseState) * (0.5f / 2147483648.f);
+          }
+          break;
+        case EBenchInput::kSine:
+          for (int s = 0; s < mBlockSize; s++)
+            pIn[s] = 0.5f * (float) std::sin(2. * M_PI * 440. * (mTransport.mSamplePos + s) / mSampleRate);
+          break;
+      }
+    }
+  }
+
+  bool Process(int nBlocks)
+  {
+    if (!mConfigured)
+    {
+      Fail("process called before the plug-in was configured");
+      return true;
+    }
+
+    BenchStats& stats = mProcessStats[std::make_pair(mSampleRate, mBlockSize)];
+    long long nonFinite = 0;
+
+    for (int b = 0; b < nBlocks; b++)
+    {
+      for (auto& ramp : mRamps)
+      {
+        if (ramp.mBlock < ramp.mNBlocks)
+        {
+          const double t = ramp.mNBlocks > 1 ? (double) ramp.mBlock / (ramp.mNBlocks - 1) : 1.;
+          mPlugin.SetParam(ramp.mParamIdx, ramp.mFrom + t * (ramp.mTo - ramp.mFrom), 0);
+          ramp.mBlock++;
+        }
+      }
+
+      mRamps.erase(std::remove_if(mRamps.begin(), mRamps.end(), [](const BenchRamp& r) { return r.mBlock >= r.mNBlocks; }), mRamps.end());
+
+      FillInputs();
+
+      stats.Add(mPlugin.Process(mInputPtrs.data(), mOutputPtrs.data(), mBlockSize, mTransport));
+      mMidiOutputEvents += mPlugin.NMidiOutputEvents();
+      mTransport.Advance(mBlockSize, mSampleRate);
+
+      for (int c = 0; c < mPlugin.NOutputs(); c++)
+      {
+        for (int s = 0; s < mBlockSize; s++)
+        {
+          if (!std::isfinite(mOutputPtrs[c][s]))
+            nonFinite++;
+        }
+      }
+
+      CheckParams();
+    }
+
+    if (nonFinite)
+      Fail("%lld non-finite output samples", nonFinite);
+
+    if (mVerbose)
+      printf("processed %d blocks of %d at %.0f Hz\n", nBlocks, mBlockSize, mSampleRate);
+
+    return true;
+  }
+
+  /** Check that parameters set with the "param" command read back with the value that was set, once a block has been processed */
+  void CheckParams()
+  {
+    for (auto& check : mParamChecks)
+    {
+      const double value = mPlugin.GetParam(check.first);
+
+      // stepped parameters are quantised, so this is only a warning
+      if (std::fabs(value - check.second) > 1e-3)
+        Warn("parameter %d (%s) reads back as %f after being set to %f", check.first, mPlugin.GetParamName(check.first).c_str(), value, check.second);
+    }
+
+    mParamChecks.clear();
+  }
+
+  bool StateRoundTrips(int n)
+  {
+    std::vector<uint8_t> first, second;
+    std::vector<double> paramsBefore(mPlugin.NParams());
+
+    for (int i = 0; i < n; i++)
+    {
+      for (int p = 0; p < mPlugin.NParams(); p++)
+        paramsBefore[p] = mPlugin.GetParam(p);
+
+      double start = Now();
+      if (!mPlugin.GetState(first))
+      {
+        Warn("the plug-in doesn't support saving its state");
+        return true;
+      }
+      mGetStateStats.Add(Now() - start);
+      mMaxStateSize = std::max(mMaxStateSize, first.size());
+
+      start = Now();
+      if (!mPlugin.SetState(first))
+      {
+        Fail("the plug-in failed to restore its own state");
+        return true;
+      }
+      mSetStateStats.Add(Now() - start);
+
+      start = Now();
+      mPlugin.GetState(second);
+      mGetStateStats.Add(Now() - start);
+
+      if (first != second)
+        Fail("state differs after a round trip (%zu bytes before, %zu after)", first.size(), second.size());
+
+      for (int p = 0; p < mPlugin.NParams(); p++)
+      {
+        const double value = mPlugin.GetParam(p);
+
+        if (std::fabs(value - paramsBefore[p]) > 1e-6)
+          Fail("parameter %d (%s) changed from %f to %f after a state round trip", p, mPlugin.GetParamName(p).c_str(), paramsBefore[p], value);
+      }
+    }
+
+    if (mVerbose)
+      printf("%d state round trips, %zu bytes\n", n, first.size());
+
+    return true;
+  }
+
+  template <typename... Args>
+  void Fail(const char* fmt, Args... args)
+  {
+    fprintf(stderr, "FAIL: ");
+    fprintf(stderr, fmt, args...);
+    fprintf(stderr, "\n");
+    mFailures++;
+  }
+
+  template <typename... Args>
+  void Warn(const char* fmt, Args... args)
+  {
+    fprintf(stderr, "WARNING: ");
+    fprintf(stderr, fmt, args...);
+    fprintf(stderr, "\n");
+    mWarnings++;
+  }
+
+  IBenchPlugin& mPlugin;
+  bool mVerbose;
+  bool mConfigured = false;
+  double mSampleRate = 44100.;
+  int mBlockSize = 512;
+  EBenchInput mInput = EBenchInput::kNoise;
+  uint32_t mNoiseState = 1;
+  BenchTransport mTransport;
+  std::vector<std::vector<float>> mBuffers;
+  std::vector<float*> mInputPtrs;
+  std::vector<float*> mOutputPtrs;
+  std::vector<BenchRamp> mRamps;
+  std::map<int, double> mParamChecks;
+  std::map<std::pair<double, int>, BenchStats> mProcessStats;
+  BenchStats mGetStateStats;
+  BenchStats mSetStateStats;
+  BenchStats mConfigureStats;
+  size_t mMaxStateSize = 0;
+  long long mMidiOutputEvents = 0;
+  int mWarnings = 0;
+  int mFailures = 0;
+};
+
+static void PrintUsage()
+{
+  printf("usage: IPlugHostBench [options] <plug-in path>\n"
+         "  -f <vst2>           plug-in format, only VST2 is supported so far\n"
+         "  -s <file>           session script, otherwise a default session is run\n"
+         "  -v                  print progress\n"
+         "\n"
+         "session script commands, one per line, # starts a comment:\n"
+         "  rate <Hz>                          set the sample rate\n"
+         "  block <frames>                     set the block size\n"
+         "  tempo <bpm>                        set the transport tempo\n"
+         "  transport <play|stop>              start or stop the transport\n"
+         "  input <silence|noise|sine>         set the input signal\n"
+         "  process <blocks>                   process a number of blocks\n"
+         "  param <idx> <value> [offset]       set a normalized parameter value in the next block\n"
+         "  ramp <idx|all> <from> <to> <blocks> automate parameters over the next blocks\n"
+         "  note <pitch> <velocity> [offset]   send a note on in the next block\n"
+         "  noteoff <pitch> [offset]           send a note off in the next block\n"
+         "  cc <controller> <value> [offset]   send a control change in the next block\n"
+         "  sysex <hex bytes...>               send a SysEx message in the next block, without F0/F7\n"
+         "  state [n]                          save and restore the state n times, checking that it is stable\n");
+}
+
+int main(int argc, char* argv[])
+{
+  BenchLoadOptions options;
+  std::string format;
+  std::string scriptPath;
+  bool verbose = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg(argv[i]);
+
+    if ((arg == "-f" || arg == "-s") && i + 1 < argc)
+    {
+      const char* value = argv[++i];
+      if (arg == "-f")
+        format = value;
+      else
+        scriptPath = value;
+    }
+    else if (arg == "-v")
+      verbose = true;
+    else if (arg == "-h" || arg == "--help")
+    {
+      PrintUsage();
+      return 0;
+    }
+    else if (options.mPath.empty() && arg[0] != '-')
+      options.mPath = arg;
+    else
+    {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  if (options.mPath.empty())
+  {
+    PrintUsage();
+    return 2;
+  }
+
+  if (format.empty())
+    format = "vst2";
+
+  std::unique_ptr<IBenchPlugin> plugin;
+  std::string error = "support for this format was not compiled in";
+
+  const double loadStart = Now();
+
+#ifdef BENCH_HOST_VST2
+  if (format == "vst2")
+    plugin = CreateVST2Plugin(options, error);
+#endif
+
+  if (!plugin)
+  {
+    fprintf(stderr, "could not load %s plug-in \"%s\": %s\n", format.c_str(), options.mPath.c_str(), error.c_str());
+    return 2;
+  }
+
+  const double loadTime = Now() - loadStart;
+
+  BenchSession session(*plugin, verbose);
+  bool ok;
+
+  if (scriptPath.empty())
+  {
+    std::istringstream script(kDefaultSession);
+    ok = session.Run(script);
+  }
+  else
+  {
+    std::ifstream script(scriptPath);
+    if (!script)
+    {
+      fprintf(stderr, "could not open session script \"%s\"\n", scriptPath.c_str());
+      return 2;
+    }
+    ok = session.Run(script);
+  }
+
+  session.Report();
+  printf("load time: %.2f ms\n", loadTime * 1e3);
+
+  plugin.reset();
+
+  if (!ok)
+    return 2;
+
+  return session.GetFailures() ? 1 : 0;
+}
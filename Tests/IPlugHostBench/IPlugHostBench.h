@@ -0,0 +1,108 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Plug-in abstraction used by the IPlugHostBench command line host, with one implementation per plug-in format
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** Transport state passed to the plug-in with each block */
+struct BenchTransport
+{
+  double mTempo = 120.;
+  double mSamplePos = 0.;
+  double mPPQPos = 0.;
+  int mNumerator = 4;
+  int mDenominator = 4;
+  bool mPlaying = true;
+
+  /** Move the transport forward by nFrames, if it is playing */
+  void Advance(int nFrames, double sampleRate)
+  {
+    if (!mPlaying)
+      return;
+
+    mSamplePos += nFrames;
+    mPPQPos += (nFrames / sampleRate) * (mTempo / 60.);
+  }
+
+  /** @return The PPQ position of the start of the current bar */
+  double GetLastBar() const
+  {
+    const double quartersPerBar = mNumerator * (4. / mDenominator);
+    return (int) (mPPQPos / quartersPerBar) * quartersPerBar;
+  }
+};
+
+/** A plug-in instance loaded by the host. All methods are called from the same thread, the host doesn't run a separate audio thread */
+class IBenchPlugin
+{
+public:
+  virtual ~IBenchPlugin() {}
+
+  /** @return The name of the plug-in format, e.g. "VST2" */
+  virtual const char* GetFormatName() const = 0;
+
+  /** @return The plug-in's name, as reported by the plug-in */
+  virtual std::string GetName() const = 0;
+
+  virtual int NInputs() const = 0;
+  virtual int NOutputs() const = 0;
+  virtual int NParams() const = 0;
+  virtual std::string GetParamName(int idx) const = 0;
+
+  /** Stop processing if necessary, apply the sample rate and maximum block size, then start processing again
+   * @return \c true on success */
+  virtual bool Configure(double sampleRate, int maxBlockSize) = 0;
+
+  /** Queue a parameter change for the next call to Process()
+   * @param idx The parameter index
+   * @param normalizedValue The value in the range [0, 1]
+   * @param offset The sample offset in the next block. Formats without sample accurate automation apply the change at the start of the block */
+  virtual void SetParam(int idx, double normalizedValue, int offset) = 0;
+
+  /** @return The normalized value of a parameter, as reported by the plug-in */
+  virtual double GetParam(int idx) const = 0;
+
+  /** Queue a MIDI message (or a complete SysEx message) for the next call to Process() */
+  virtual void AddMidi(const uint8_t* pData, int size, int offset) = 0;
+
+  /** Process one block, passing the queued parameter changes and MIDI messages
+   * @return The time spent in the plug-in's process call, in seconds */
+  virtual double Process(float** ppInputs, float** ppOutputs, int nFrames, const BenchTransport& transport) = 0;
+
+  /** @return The number of MIDI messages that the plug-in sent during the last call to Process() */
+  virtual int NMidiOutputEvents() const { return 0; }
+
+  /** Get the plug-in's complete state
+   * @return \c false if the plug-in doesn't support saving state */
+  virtual bool GetState(std::vector<uint8_t>& data) = 0;
+
+  /** Restore state previously returned by GetState()
+   * @return \c false if the plug-in doesn't support restoring state */
+  virtual bool SetState(const std::vector<uint8_t>& data) = 0;
+};
+
+/** Options that select which plug-in to load */
+struct BenchLoadOptions
+{
+  std::string mPath;
+};
+
+#ifdef BENCH_HOST_VST2
+std::unique_ptr<IBenchPlugin> CreateVST2Plugin(const BenchLoadOptions& options, std::string& error);
+#endif
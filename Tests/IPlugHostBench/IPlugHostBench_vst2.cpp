@@ -0,0 +1,415 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#include "IPlugHostBench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <sys/stat.h>
+#endif
+
+#include "aeffectx.h"
+
+namespace
+{
+
+typedef AEffect* (*VSTPluginMainProc)(audioMasterCallback audioMaster);
+
+static const int kMaxEvents = 1024;
+
+/** VstEvents with room for more than two events */
+struct VstEventsBlock
+{
+  VstInt32 numEvents;
+  VstIntPtr reserved;
+  VstEvent* events[kMaxEvents];
+};
+
+/** A MIDI or SysEx message waiting to be sent with the next block */
+struct PendingEvent
+{
+  int mOffset;
+  std::vector<uint8_t> mData;
+};
+
+double Now()
+{
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+class VST2Plugin final : public IBenchPlugin
+{
+public:
+  ~VST2Plugin()
+  {
+    if (mEffect)
+    {
+      if (mActive)
+      {
+        Dispatch(effStopProcess);
+        Dispatch(effMainsChanged, 0, 0);
+      }
+
+      Dispatch(effClose);
+      mEffect = nullptr;
+    }
+
+#ifdef _WIN32
+    if (mModule)
+      FreeLibrary((HMODULE) mModule);
+#else
+    if (mModule)
+      dlclose(mModule);
+#endif
+  }
+
+  bool Load(const BenchLoadOptions& options, std::string& error)
+  {
+    std::string path = options.mPath;
+
+#ifdef __APPLE__
+    // a .vst bundle is a directory, the binary inside has the same name
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+      while (!path.empty() && path.back() == '/')
+        path.pop_back();
+
+      std::string name = path.substr(path.find_last_of('/') + 1);
+      name = name.substr(0, name.find_last_of('.'));
+      path += "/Contents/MacOS/" + name;
+    }
+#endif
+
+    VSTPluginMainProc mainProc = nullptr;
+
+#ifdef _WIN32
+    mModule = (void*) LoadLibraryA(path.c_str());
+    if (mModule)
+    {
+      mainProc = (VSTPluginMainProc) GetProcAddress((HMODULE) mModule, "VSTPluginMain");
+      if (!mainProc)
+        mainProc = (VSTPluginMainProc) GetProcAddress((HMODULE) mModule, "main");
+    }
+#else
+    mModule = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (mModule)
+    {
+      mainProc = (VSTPluginMainProc) dlsym(mModule, "VSTPluginMain");
+      if (!mainProc)
+        mainProc = (VSTPluginMainProc) dlsym(mModule, "main");
+    }
+    else
+    {
+      error = dlerror();
+      return false;
+    }
+#endif
+
+    if (!mModule)
+    {
+      error = "could not load the library";
+      return false;
+    }
+
+    if (!mainProc)
+    {
+      error = "the library has no VSTPluginMain entry point";
+      return false;
+    }
+
+    // the plug-in may call back before we get a chance to set resvd1, so the instance being loaded is also kept here
+    sLoading = this;
+    mEffect = mainProc(HostCallback);
+    sLoading = nullptr;
+
+    if (!mEffect || mEffect->magic != kEffectMagic)
+    {
+      mEffect = nullptr;
+      error = "VSTPluginMain didn't return a valid AEffect";
+      return false;
+    }
+
+    if (!(mEffect->flags & effFlagsCanReplacing))
+    {
+      error = "the plug-in doesn't support processReplacing";
+      return false;
+    }
+
+    mEffect->resvd1 = (VstIntPtr) this;
+    Dispatch(effOpen);
+
+    char name[256] = {};
+    Dispatch(effGetEffectName, 0, 0, name);
+    mName = name;
+
+    mEvents.numEvents = 0;
+    mEvents.reserved = 0;
+    return true;
+  }
+
+  const char* GetFormatName() const override { return "VST2"; }
+  std::string GetName() const override { return mName; }
+  int NInputs() const override { return mEffect->numInputs; }
+  int NOutputs() const override { return mEffect->numOutputs; }
+  int NParams() const override { return mEffect->numParams; }
+
+  std::string GetParamName(int idx) const override
+  {
+    // plug-ins often ignore kVstMaxParamStrLen, so give them plenty of room
+    char name[256] = {};
+    const_cast<VST2Plugin*>(this)->Dispatch(effGetParamName, idx, 0, name);
+    return name;
+  }
+
+  bool Configure(double sampleRate, int maxBlockSize) override
+  {
+    if (mActive)
+    {
+      Dispatch(effStopProcess);
+      Dispatch(effMainsChanged, 0, 0);
+    }
+
+    mSampleRate = sampleRate;
+    mBlockSize = maxBlockSize;
+
+    Dispatch(effSetSampleRate, 0, 0, nullptr, (float) sampleRate);
+    Dispatch(effSetBlockSize, 0, maxBlockSize);
+    Dispatch(effMainsChanged, 0, 1);
+    Dispatch(effStartProcess);
+    mActive = true;
+    return true;
+  }
+
+  void SetParam(int idx, double normalizedValue, int offset) override
+  {
+    // VST2 has no sample accurate automation
+    mEffect->setParameter(mEffect, idx, (float) normalizedValue);
+  }
+
+  double GetParam(int idx) const override
+  {
+    return mEffect->getParameter(mEffect, idx);
+  }
+
+  void AddMidi(const uint8_t* pData, int size, int offset) override
+  {
+    mPending.push_back({offset, std::vector<uint8_t>(pData, pData + size)});
+  }
+
+  double Process(float** ppInputs, float** ppOutputs, int nFrames, const BenchTransport& transport) override
+  {
+    UpdateTimeInfo(transport);
+    PrepareEvents();
+
+    mNMidiOutputEvents = 0;
+    mProcessing = true;
+
+    const double start = Now();
+
+    if (mEvents.numEvents > 0)
+      Dispatch(effProcessEvents, 0, 0, &mEvents);
+
+    mEffect->processReplacing(mEffect, ppInputs, ppOutputs, nFrames);
+    const double elapsed = Now() - start;
+
+    mProcessing = false;
+    mPending.clear();
+    mEvents.numEvents = 0;
+    return elapsed;
+  }
+
+  int NMidiOutputEvents() const override { return mNMidiOutputEvents; }
+
+  bool GetState(std::vector<uint8_t>& data) override
+  {
+    if (mEffect->flags & effFlagsProgramChunks)
+    {
+      void* pChunk = nullptr;
+      const VstIntPtr size = Dispatch(effGetChunk, 0, 0, &pChunk);
+
+      if (size <= 0 || !pChunk)
+        return false;
+
+      data.assign((const uint8_t*) pChunk, (const uint8_t*) pChunk + size);
+      return true;
+    }
+
+    // without chunks, a host saves the parameter values
+    data.resize(NParams() * sizeof(float));
+    for (int i = 0; i < NParams(); i++)
+    {
+      const float value = mEffect->getParameter(mEffect, i);
+      memcpy(data.data() + i * sizeof(float), &value, sizeof(float));
+    }
+    return true;
+  }
+
+  bool SetState(const std::vector<uint8_t>& data) override
+  {
+    if (mEffect->flags & effFlagsProgramChunks)
+    {
+      // the plug-in may keep the pointer, so give it a copy that stays alive
+      mSetChunkData = data;
+      return Dispatch(effSetChunk, 0, (VstIntPtr) mSetChunkData.size(), mSetChunkData.data()) != 0;
+    }
+
+    if (data.size() != NParams() * sizeof(float))
+      return false;
+
+    for (int i = 0; i < NParams(); i++)
+    {
+      float value;
+      memcpy(&value, data.data() + i * sizeof(float), sizeof(float));
+      mEffect->setParameter(mEffect, i, value);
+    }
+    return true;
+  }
+
+private:
+  VstIntPtr Dispatch(VstInt32 opcode, VstInt32 index = 0, VstIntPtr value = 0, void* ptr = nullptr, float opt = 0.f)
+  {
+    return mEffect->dispatcher(mEffect, opcode, index, value, ptr, opt);
+  }
+
+  void UpdateTimeInfo(const BenchTransport& transport)
+  {
+    mTimeInfo = {};
+    mTimeInfo.samplePos = transport.mSamplePos;
+    mTimeInfo.sampleRate = mSampleRate;
+    mTimeInfo.ppqPos = transport.mPPQPos;
+    mTimeInfo.tempo = transport.mTempo;
+    mTimeInfo.barStartPos = transport.GetLastBar();
+    mTimeInfo.timeSigNumerator = transport.mNumerator;
+    mTimeInfo.timeSigDenominator = transport.mDenominator;
+    mTimeInfo.flags = kVstPpqPosValid | kVstTempoValid | kVstBarsValid | kVstTimeSigValid;
+
+    if (transport.mPlaying)
+      mTimeInfo.flags |= kVstTransportPlaying;
+  }
+
+  void PrepareEvents()
+  {
+    std::stable_sort(mPending.begin(), mPending.end(), [](const PendingEvent& a, const PendingEvent& b) { return a.mOffset < b.mOffset; });
+
+    const int nEvents = std::min((int) mPending.size(), kMaxEvents);
+    mMidiEvents.resize(nEvents);
+    mSysExEvents.resize(nEvents);
+
+    for (int i = 0; i < nEvents; i++)
+    {
+      const PendingEvent& pending = mPending[i];
+
+      if (pending.mData[0] == 0xF0)
+      {
+        VstMidiSysexEvent& ev = mSysExEvents[i];
+        memset(&ev, 0, sizeof(ev));
+        ev.type = kVstSysExType;
+        ev.byteSize = sizeof(ev);
+        ev.deltaFrames = pending.mOffset;
+        ev.dumpBytes = (VstInt32) pending.mData.size();
+        ev.sysexDump = (char*) pending.mData.data();
+        mEvents.events[i] = (VstEvent*) &ev;
+      }
+      else
+      {
+        VstMidiEvent& ev = mMidiEvents[i];
+        memset(&ev, 0, sizeof(ev));
+        ev.type = kVstMidiType;
+        ev.byteSize = sizeof(ev);
+        ev.deltaFrames = pending.mOffset;
+        ev.flags = kVstMidiEventIsRealtime;
+        memcpy(ev.midiData, pending.mData.data(), std::min<size_t>(pending.mData.size(), 3));
+        mEvents.events[i] = (VstEvent*) &ev;
+      }
+    }
+
+    mEvents.numEvents = nEvents;
+  }
+
+  static VstIntPtr VSTCALLBACK HostCallback(AEffect* pEffect, VstInt32 opcode, VstInt32 index, VstIntPtr value, void* ptr, float opt)
+  {
+    VST2Plugin* _this = (pEffect && pEffect->resvd1) ? (VST2Plugin*) pEffect->resvd1 : sLoading;
+
+    switch (opcode)
+    {
+      case audioMasterVersion:
+        return 2400;
+      case audioMasterCurrentId:
+        return pEffect ? pEffect->uniqueID : 0;
+      case audioMasterGetTime:
+        return _this ? (VstIntPtr) &_this->mTimeInfo : 0;
+      case audioMasterProcessEvents:
+        if (_this && ptr)
+          _this->mNMidiOutputEvents += ((VstEvents*) ptr)->numEvents;
+        return 1;
+      case audioMasterGetSampleRate:
+        return _this ? (VstIntPtr) _this->mSampleRate : 0;
+      case audioMasterGetBlockSize:
+        return _this ? _this->mBlockSize : 0;
+      case audioMasterGetCurrentProcessLevel:
+        return (_this && _this->mProcessing) ? kVstProcessLevelRealtime : kVstProcessLevelUser;
+      case audioMasterGetVendorString:
+        strcpy((char*) ptr, "iPlug2");
+        return 1;
+      case audioMasterGetProductString:
+        strcpy((char*) ptr, "IPlugHostBench");
+        return 1;
+      case audioMasterGetVendorVersion:
+        return 1;
+      case audioMasterCanDo:
+      {
+        const char* canDo = (const char*) ptr;
+        return (!strcmp(canDo, "sendVstEvents") || !strcmp(canDo, "sendVstMidiEvent") || !strcmp(canDo, "sendVstTimeInfo")
+                || !strcmp(canDo, "receiveVstEvents") || !strcmp(canDo, "receiveVstMidiEvent")) ? 1 : 0;
+      }
+      default:
+        return 0;
+    }
+  }
+
+  static VST2Plugin* sLoading;
+
+  void* mModule = nullptr;
+  AEffect* mEffect = nullptr;
+  std::string mName;
+  double mSampleRate = 44100.;
+  int mBlockSize = 512;
+  bool mActive = false;
+  bool mProcessing = false;
+  int mNMidiOutputEvents = 0;
+  VstTimeInfo mTimeInfo = {};
+  std::vector<PendingEvent> mPending;
+  std::vector<VstMidiEvent> mMidiEvents;
+  std::vector<VstMidiSysexEvent> mSysExEvents;
+  VstEventsBlock mEvents;
+  std::vector<uint8_t> mSetChunkData;
+};
+
+VST2Plugin* VST2Plugin::sLoading = nullptr;
+
+} // namespace
+
+std::unique_ptr<IBenchPlugin> CreateVST2Plugin(const BenchLoadOptions& options, std::string& error)
+{
+  std::unique_ptr<VST2Plugin> plugin(new VST2Plugin);
+
+  if (!plugin->Load(options, error))
+    return nullptr;
+
+  return plugin;
+}
@@ -0,0 +1,379 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugLV2HostTest: drives the LV2 build of a small plug-in (IPlugLV2HostTest.cpp) the way an LV2 host does, through its descriptors,
+ * with urid:map and a maxBlockLength option, connecting ports by the indices in the ttl that IPlugLV2_cfg.cpp writes, for each of its
+ * IO configs ("1-1 2-2"), and checks
+ *  - that the ttl declares the ports at the indices that the DSP reads, and the parameters that it accepts in patch:Set
+ *  - automation from the control ports and from patch:Set, with the block split at the patch:Set
+ *  - time:Position, and the transport advancing between positions
+ *  - MIDI and SysEx in, with sample offsets relative to the sub-blocks, and the plug-in's MIDI and SysEx out, in order and timed from the
+ *    start of run()
+ *  - that MIDI out which doesn't fit in the output sequence is dropped rather than written past it
+ *
+ * usage: IPlugLV2HostTest [directory for the ttl files (.)]
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "IPlugLV2HostTest.h"
+
+#include <lv2/atom/util.h>
+#include <lv2/buf-size/buf-size.h>
+#include <lv2/midi/midi.h>
+#include <lv2/options/options.h>
+#include <lv2/patch/patch.h>
+#include <lv2/time/time.h>
+
+extern "C" const LV2_Descriptor* lv2_descriptor(uint32_t index);
+
+static const int kMaxBlockSize = 512;
+static const int kNFrames = 256;
+static const double kSampleRate = 48000.;
+
+static int sErrors = 0;
+
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAILED: " __VA_ARGS__); printf("\n"); sErrors++; } } while (0)
+
+static std::map<std::string, LV2_URID> sURIDs;
+
+static LV2_URID MapURI(LV2_URID_Map_Handle, const char* uri)
+{
+  auto it = sURIDs.find(uri);
+
+  if (it != sURIDs.end())
+    return it->second;
+
+  const LV2_URID urid = (LV2_URID) sURIDs.size() + 1;
+  sURIDs[uri] = urid;
+  return urid;
+}
+
+static LV2_URID URID(const char* uri) { return MapURI(nullptr, uri); }
+
+template <class T>
+static std::vector<uint8_t> Bytes(T value)
+{
+  std::vector<uint8_t> bytes(sizeof(T));
+  memcpy(bytes.data(), &value, sizeof(T));
+  return bytes;
+}
+
+/** An atom sequence port buffer, filled as a host fills the control input port */
+class Sequence
+{
+public:
+  struct Property
+  {
+    LV2_URID mKey;
+    LV2_URID mType;
+    std::vector<uint8_t> mBody;
+  };
+
+  LV2_Atom_Sequence* Get() { return (LV2_Atom_Sequence*) mBuf; }
+  uint8_t* Data() { return mBuf; }
+
+  /** Empty the sequence, for an input port */
+  void Clear()
+  {
+    Get()->atom.type = URID(LV2_ATOM__Sequence);
+    Get()->body.unit = 0;
+    Get()->body.pad = 0;
+    lv2_atom_sequence_clear(Get());
+  }
+
+  /** Set the sequence's size to its capacity, as a host does for an output port */
+  void SetCapacity(uint32_t capacity = sizeof(mBuf) - sizeof(LV2_Atom)) { Get()->atom.size = capacity; }
+
+  void Midi(int64_t frame, const std::vector<uint8_t>& bytes)
+  {
+    Append(frame, URID(LV2_MIDI__MidiEvent), bytes.data(), (uint32_t) bytes.size());
+  }
+
+  void Object(int64_t frame, LV2_URID otype, const std::vector<Property>& properties)
+  {
+    std::vector<uint8_t> body(sizeof(LV2_Atom_Object_Body));
+    const LV2_Atom_Object_Body objectBody {0, otype};
+    memcpy(body.data(), &objectBody, sizeof(objectBody));
+
+    for (const Property& property : properties)
+    {
+      const LV2_Atom_Property_Body propertyBody {property.mKey, 0, {(uint32_t) property.mBody.size(), property.mType}};
+      const size_t pos = body.size();
+      body.resize(pos + lv2_atom_pad_size(sizeof(propertyBody) + (uint32_t) property.mBody.size()));
+      memcpy(body.data() + pos, &propertyBody, sizeof(propertyBody));
+      memcpy(body.data() + pos + sizeof(propertyBody), property.mBody.data(), property.mBody.size());
+    }
+
+    Append(frame, URID(LV2_ATOM__Object), body.data(), (uint32_t) body.size());
+  }
+
+  struct Event
+  {
+    int64_t mFrame;
+    std::vector<uint8_t> mData;
+  };
+
+  /** @return The MIDI events in the sequence, as written by the plug-in to the control output port */
+  std::vector<Event> ReadMidi()
+  {
+    std::vector<Event> events;
+    CHECK(Get()->atom.type == URID(LV2_ATOM__Sequence), "the output sequence's type isn't atom:Sequence");
+
+    LV2_ATOM_SEQUENCE_FOREACH(Get(), ev)
+    {
+      CHECK(ev->body.type == URID(LV2_MIDI__MidiEvent), "an output event isn't a midi:MidiEvent");
+      const uint8_t* pData = (const uint8_t*) (ev + 1);
+      events.push_back({ev->time.frames, std::vector<uint8_t>(pData, pData + ev->body.size)});
+    }
+
+    return events;
+  }
+
+private:
+  void Append(int64_t frame, LV2_URID type, const void* pBody, uint32_t size)
+  {
+    alignas(8) uint8_t eventBuf[1024];
+    LV2_Atom_Event* pEvent = (LV2_Atom_Event*) eventBuf;
+    pEvent->time.frames = frame;
+    pEvent->body.type = type;
+    pEvent->body.size = size;
+    memcpy(pEvent + 1, pBody, size);
+    lv2_atom_sequence_append_event(Get(), sizeof(mBuf) - sizeof(LV2_Atom), pEvent);
+  }
+
+  alignas(8) uint8_t mBuf[8192];
+};
+
+/** @return The ttl text for the plug-in with URI, up to the next plug-in */
+static std::string PluginTtl(const std::string& ttl, const std::string& uri)
+{
+  const size_t start = ttl.find("<" + uri + ">\n  a lv2:Plugin");
+
+  if (start == std::string::npos)
+    return "";
+
+  return ttl.substr(start, ttl.find("] .", start) - start);
+}
+
+/** @return The lv2:index of the port with a symbol in the ttl text of a plug-in, or -1 */
+static int PortIndex(const std::string& pluginTtl, const char* symbol)
+{
+  const size_t symbolPos = pluginTtl.find(std::string("lv2:symbol \"") + symbol + "\"");
+
+  if (symbolPos == std::string::npos)
+    return -1;
+
+  const size_t indexPos = pluginTtl.rfind("lv2:index ", symbolPos);
+  return indexPos == std::string::npos ? -1 : atoi(pluginTtl.c_str() + indexPos + 10);
+}
+
+static void CheckTtl(const char* dir, const LV2_Descriptor* pDesc, int nChans)
+{
+  std::ifstream file(std::string(dir) + "/" PLUG_NAME ".ttl");
+  std::stringstream text;
+  text << file.rdbuf();
+  const std::string ttl = text.str();
+
+  CHECK(ttl.find("@prefix midi:") != std::string::npos && ttl.find("@prefix time:") != std::string::npos, "the ttl doesn't declare the midi: and time: prefixes");
+
+  for (int p = 0; p < kNumParams; p++)
+  {
+    char declaration[64];
+    snprintf(declaration, sizeof(declaration), "propex:Par%d\n  a lv2:Parameter", p);
+    CHECK(ttl.find(declaration) != std::string::npos, "the ttl doesn't declare parameter %d", p);
+  }
+
+  const std::string pluginTtl = PluginTtl(ttl, pDesc->URI);
+  CHECK(!pluginTtl.empty(), "no plug-in %s in the ttl", pDesc->URI);
+  CHECK(PortIndex(pluginTtl, "control_in") == 0 && PortIndex(pluginTtl, "control_out") == 1, "atom port indices");
+  CHECK(PortIndex(pluginTtl, "In1") == 2 && PortIndex(pluginTtl, "Out1") == 2 + nChans, "audio port indices");
+  CHECK(PortIndex(pluginTtl, "Gain") == 2 + 2 * nChans && PortIndex(pluginTtl, "Mode") == 3 + 2 * nChans, "control port indices %d %d",
+        PortIndex(pluginTtl, "Gain"), PortIndex(pluginTtl, "Mode"));
+}
+
+static void CheckInstance(const LV2_Descriptor* pDesc, int nChans)
+{
+  printf("%s, %d-%d\n", pDesc->URI, nChans, nChans);
+
+  LV2_URID_Map map {nullptr, MapURI};
+  const int32_t maxBlockSize = kMaxBlockSize;
+  const LV2_Options_Option options[] = {
+    {LV2_OPTIONS_INSTANCE, 0, URID(LV2_BUF_SIZE__maxBlockLength), sizeof(int32_t), URID(LV2_ATOM__Int), &maxBlockSize},
+    {LV2_OPTIONS_INSTANCE, 0, 0, 0, 0, nullptr}
+  };
+  const LV2_Feature mapFeature {LV2_URID__map, &map};
+  const LV2_Feature optionsFeature {LV2_OPTIONS__options, (void*) options};
+  const LV2_Feature* features[] = {&mapFeature, &optionsFeature, nullptr};
+
+  LV2_Handle handle = pDesc->instantiate(pDesc, kSampleRate, ".", features);
+  IPlugLV2HostTest* pPlug = static_cast<IPlugLV2HostTest*>(static_cast<IPlugLV2DSP*>(handle));
+
+  // ports in the order that the ttl declares them: atom in and out, the IO config's audio inputs and outputs, then a control port per parameter
+  Sequence in, out;
+  std::vector<float> audioIn[2], audioOut[2];
+  float controls[kNumParams] = {0.5f, 0.f};
+  uint32_t port = 0;
+
+  pDesc->connect_port(handle, port++, in.Get());
+  pDesc->connect_port(handle, port++, out.Get());
+
+  for (int c = 0; c < nChans; c++)
+  {
+    audioIn[c].assign(kMaxBlockSize, (float) (c + 1));
+    pDesc->connect_port(handle, port++, audioIn[c].data());
+  }
+
+  for (int c = 0; c < nChans; c++)
+  {
+    audioOut[c].assign(kMaxBlockSize, 0.f);
+    pDesc->connect_port(handle, port++, audioOut[c].data());
+  }
+
+  for (int p = 0; p < kNumParams; p++)
+    pDesc->connect_port(handle, port++, &controls[p]);
+
+  pDesc->activate(handle);
+
+  // the gain from its control port, a time:Position at 0, MIDI and SysEx, a patch:Set of the gain at 100 and MIDI after it
+  in.Clear();
+  in.Object(0, URID(LV2_TIME__Position), {
+    {URID(LV2_TIME__frame), URID(LV2_ATOM__Long), Bytes<int64_t>(48000)},
+    {URID(LV2_TIME__speed), URID(LV2_ATOM__Float), Bytes<float>(1.f)},
+    {URID(LV2_TIME__bar), URID(LV2_ATOM__Long), Bytes<int64_t>(2)},
+    {URID(LV2_TIME__barBeat), URID(LV2_ATOM__Float), Bytes<float>(1.f)},
+    {URID(LV2_TIME__beatsPerBar), URID(LV2_ATOM__Float), Bytes<float>(3.f)},
+    {URID(LV2_TIME__beatUnit), URID(LV2_ATOM__Int), Bytes<int32_t>(8)},
+    {URID(LV2_TIME__beatsPerMinute), URID(LV2_ATOM__Float), Bytes<float>(120.f)}
+  });
+  in.Midi(50, {0x90, 60, 100});
+  in.Midi(60, {0xF0, 0x7D, 0x01, 0x02, 0xF7});
+  in.Object(100, URID(LV2_PATCH__Set), {
+    {URID(LV2_PATCH__property), URID(LV2_ATOM__URID), Bytes<uint32_t>(URID(PLUG_URI "#Par0"))},
+    {URID(LV2_PATCH__value), URID(LV2_ATOM__Float), Bytes<float>(0.25f)}
+  });
+  in.Midi(150, {0x80, 60, 0});
+  out.SetCapacity();
+  pDesc->run(handle, kNFrames);
+
+  for (int c = 0; c < nChans; c++)
+  {
+    const float input = (float) (c + 1);
+    CHECK(audioOut[c][0] == 0.5f * input && audioOut[c][99] == 0.5f * input, "channel %d before the patch:Set: %g", c, audioOut[c][99]);
+    CHECK(audioOut[c][100] == 0.25f * input && audioOut[c][kNFrames - 1] == 0.25f * input, "channel %d after the patch:Set: %g", c, audioOut[c][100]);
+  }
+
+  CHECK(pPlug->mBlocks.size() == 2 && pPlug->mBlocks[0].mNFrames == 100 && pPlug->mBlocks[1].mNFrames == kNFrames - 100,
+        "the block isn't split at the patch:Set: %d blocks", (int) pPlug->mBlocks.size());
+
+  if (pPlug->mBlocks.size() == 2)
+  {
+    const BlockRecord& first = pPlug->mBlocks[0];
+    const BlockRecord& second = pPlug->mBlocks[1];
+    // bar 2 of 3/8 at beat 1 is 7 eighths, 3.5 quarters in. 120 eighths per minute is 1 quarter per second
+    CHECK(first.mSamplePos == 48000. && first.mTransportIsRunning && first.mTempo == 120. && first.mNumerator == 3 && first.mDenominator == 8,
+          "time info: sample %g, running %d, tempo %g, %d/%d", first.mSamplePos, first.mTransportIsRunning, first.mTempo, first.mNumerator, first.mDenominator);
+    CHECK(std::fabs(first.mPPQPos - 3.5) < 1e-9, "PPQ position %g", first.mPPQPos);
+    CHECK(second.mSamplePos == 48100. && std::fabs(second.mPPQPos - (3.5 + 100. / kSampleRate)) < 1e-9,
+          "the transport didn't advance to the second sub-block: sample %g, PPQ %g", second.mSamplePos, second.mPPQPos);
+  }
+
+  CHECK(pPlug->mMidiIn.size() == 2, "%d MIDI messages in", (int) pPlug->mMidiIn.size());
+
+  if (pPlug->mMidiIn.size() == 2)
+  {
+    CHECK(pPlug->mMidiIn[0].mOffset == 50 && pPlug->mMidiIn[0].mStatus == 0x90, "note on at offset %d", pPlug->mMidiIn[0].mOffset);
+    // relative to the sub-block after the patch:Set
+    CHECK(pPlug->mMidiIn[1].mOffset == 50 && pPlug->mMidiIn[1].mStatus == 0x80, "note off at offset %d", pPlug->mMidiIn[1].mOffset);
+  }
+
+  CHECK(pPlug->mSysExIn.size() == 1 && pPlug->mSysExIn[0].size() == 5 && pPlug->mSysExInOffsets[0] == 60, "SysEx in");
+
+  const std::vector<Sequence::Event> outEvents = out.ReadMidi();
+  CHECK(outEvents.size() == 3, "%d MIDI events out", (int) outEvents.size());
+
+  if (outEvents.size() == 3)
+  {
+    CHECK(outEvents[0].mFrame == 50 && outEvents[0].mData == std::vector<uint8_t>({0x90, 60, 100}), "note on out at %d", (int) outEvents[0].mFrame);
+    CHECK(outEvents[1].mFrame == 60 && outEvents[1].mData == std::vector<uint8_t>({0xF0, 0x7D, 0x01, 0x02, 0xF7}), "SysEx out at %d", (int) outEvents[1].mFrame);
+    CHECK(outEvents[2].mFrame == 150 && outEvents[2].mData == std::vector<uint8_t>({0x80, 60, 0}), "note off out at %d", (int) outEvents[2].mFrame);
+  }
+
+  // nothing in, and the control port unchanged, so the gain from the patch:Set stays. The transport advances on its own
+  pPlug->mBlocks.clear();
+  in.Clear();
+  out.SetCapacity();
+  pDesc->run(handle, kNFrames);
+
+  CHECK(audioOut[nChans - 1][0] == 0.25f * nChans, "the unchanged control port overrode the patch:Set: %g", audioOut[nChans - 1][0]);
+  CHECK(pPlug->mBlocks.size() == 1 && pPlug->mBlocks[0].mSamplePos == 48000. + kNFrames, "the transport didn't advance to the next run()");
+  CHECK(out.ReadMidi().empty(), "the output sequence wasn't cleared");
+
+  // automation from the control port
+  controls[kGain] = 1.f;
+  in.Clear();
+  out.SetCapacity();
+  pDesc->run(handle, kNFrames);
+
+  CHECK(audioOut[0][0] == 1.f && pPlug->GetParam(kGain)->Value() == 1., "control port automation: %g", audioOut[0][0]);
+
+  // more MIDI out than the output sequence holds
+  const uint32_t capacity = sizeof(LV2_Atom_Sequence_Body) + 10 * (sizeof(LV2_Atom_Event) + 8);
+  in.Clear();
+
+  for (int i = 0; i < 200; i++)
+    in.Midi(i, {0x90, (uint8_t) (i % 128), 1});
+
+  out.SetCapacity(capacity);
+  memset(out.Data() + sizeof(LV2_Atom) + capacity, 0xAB, 64);
+  pDesc->run(handle, kNFrames);
+
+  CHECK(out.ReadMidi().size() == 10, "%d events in an output sequence with room for 10", (int) out.ReadMidi().size());
+  CHECK(out.Data()[sizeof(LV2_Atom) + capacity] == 0xAB, "MIDI out was written past the output sequence's capacity");
+
+  pDesc->deactivate(handle);
+  pDesc->cleanup(handle);
+}
+
+int main(int argc, char* argv[])
+{
+  const char* ttlDir = argc > 1 ? argv[1] : ".";
+  const LV2_Descriptor* pMono = lv2_descriptor(0);
+  const LV2_Descriptor* pStereo = lv2_descriptor(1);
+
+  CHECK(pMono && !strcmp(pMono->URI, PLUG_URI "#io_0"), "descriptor 0");
+  CHECK(pStereo && !strcmp(pStereo->URI, PLUG_URI "#io_1"), "descriptor 1");
+  CHECK(!lv2_descriptor(2), "a descriptor for an IO config that doesn't exist");
+
+  if (pMono && pStereo)
+  {
+    // as the ttl generator does, see IPlugLV2_cfg.cpp
+    const LV2_Feature* noFeatures[] = {nullptr};
+    IPlugLV2DSP* pPlug = static_cast<IPlugLV2DSP*>(pMono->instantiate(pMono, kSampleRate, ".", noFeatures));
+    CHECK(pPlug->write_manifest(ttlDir) == 0 && pPlug->write_also(ttlDir) == 0, "writing the ttl to %s", ttlDir);
+    pMono->cleanup(pPlug);
+
+    CheckTtl(ttlDir, pMono, 1);
+    CheckTtl(ttlDir, pStereo, 2);
+    CheckInstance(pMono, 1);
+    CheckInstance(pStereo, 2);
+  }
+
+  printf("%s\n", sErrors ? "FAILED" : "ok");
+  return sErrors ? 1 : 0;
+}
@@ -0,0 +1,38 @@
+#include "IPlugLV2HostTest.h"
+#include "IPlug_include_in_plug_src.h"
+
+IPlugLV2HostTest::IPlugLV2HostTest(const InstanceInfo& info)
+: Plugin(info, MakeConfig(kNumParams, kNumPresets))
+{
+  GetParam(kGain)->InitDouble("Gain", 1., 0., 1., 0.001);
+  GetParam(kMode)->InitInt("Mode", 0, 0, 3);
+}
+
+void IPlugLV2HostTest::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
+{
+  const double gain = GetParam(kGain)->Value();
+  const int nChans = NOutChansConnected();
+
+  for (int c = 0; c < nChans; c++)
+  {
+    for (int s = 0; s < nFrames; s++)
+      outputs[c][s] = inputs[c][s] * gain;
+  }
+
+  int numerator, denominator;
+  GetTimeSig(numerator, denominator);
+  mBlocks.push_back({nFrames, GetSamplePos(), GetPPQPos(), GetTempo(), GetTransportIsRunning(), numerator, denominator});
+}
+
+void IPlugLV2HostTest::ProcessMidiMsg(const IMidiMsg& msg)
+{
+  mMidiIn.push_back(msg);
+  SendMidiMsg(msg);
+}
+
+void IPlugLV2HostTest::ProcessSysEx(ISysEx& msg)
+{
+  mSysExIn.emplace_back(msg.mData, msg.mData + msg.mSize);
+  mSysExInOffsets.push_back(msg.mOffset);
+  SendSysEx(msg);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "IPlug_include_in_plug_hdr.h"
+
+#include <vector>
+
+const int kNumPresets = 0;
+
+enum EParams
+{
+  kGain = 0,
+  kMode,
+  kNumParams
+};
+
+using namespace iplug;
+
+/** What the plug-in saw in a ProcessBlock() call */
+struct BlockRecord
+{
+  int mNFrames;
+  double mSamplePos;
+  double mPPQPos;
+  double mTempo;
+  bool mTransportIsRunning;
+  int mNumerator;
+  int mDenominator;
+};
+
+/** A gain that records its blocks and the MIDI and SysEx it receives, and sends them straight back out */
+class IPlugLV2HostTest final : public Plugin
+{
+public:
+  IPlugLV2HostTest(const InstanceInfo& info);
+
+  void ProcessBlock(sample** inputs, sample** outputs, int nFrames) override;
+  void ProcessMidiMsg(const IMidiMsg& msg) override;
+  void ProcessSysEx(ISysEx& msg) override;
+
+  std::vector<BlockRecord> mBlocks;
+  std::vector<IMidiMsg> mMidiIn;
+  std::vector<std::vector<uint8_t>> mSysExIn;
+  std::vector<int> mSysExInOffsets;
+};
@@ -0,0 +1,28 @@
+#define PLUG_NAME "IPlugLV2HostTest"
+#define PLUG_MFR "AcmeInc"
+#define PLUG_VERSION_HEX 0x00010000
+#define PLUG_VERSION_STR "1.0.0"
+#define PLUG_UNIQUE_ID 'Lv2h'
+#define PLUG_MFR_ID 'Acme'
+#define PLUG_URL_STR "https://iplug2.github.io"
+#define PLUG_EMAIL_STR "spam@me.com"
+#define PLUG_COPYRIGHT_STR "Copyright 2020 Acme Inc"
+#define PLUG_CLASS_NAME IPlugLV2HostTest
+#define BUNDLE_NAME "IPlugLV2HostTest"
+#define BUNDLE_MFR "AcmeInc"
+#define BUNDLE_DOMAIN "com"
+#define SHARED_RESOURCES_SUBPATH "IPlugLV2HostTest"
+#define PLUG_CHANNEL_IO "1-1 2-2"
+#define PLUG_LATENCY 0
+#define PLUG_TYPE 0
+#define PLUG_DOES_MIDI_IN 1
+#define PLUG_DOES_MIDI_OUT 1
+#define PLUG_DOES_MPE 0
+#define PLUG_DOES_STATE_CHUNKS 0
+#define PLUG_HAS_UI 0
+#define PLUG_WIDTH 100
+#define PLUG_HEIGHT 100
+#define PLUG_FPS 60
+#define PLUG_SHARED_RESOURCES 0
+#define PLUG_HOST_RESIZE 0
+#define LV2_CONTROL_PORTS 1
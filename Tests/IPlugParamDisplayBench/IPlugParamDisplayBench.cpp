@@ -0,0 +1,331 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugParamDisplayBench: compares IParam's display paths with copies of the previous versions (snprintf for numbers, and a
+ * linear search of the display texts, here through the public accessors):
+ *  - checks that GetDisplay() gives the same strings for random values, values halfway between two outputs, every
+ *    precision from 0 to 9 and the sign/negate flags, called repeatedly (so through the cache) and not
+ *  - checks GetDisplayText() and StringToValue() for dense (enum) and sparse display texts, and numbers
+ *  - simulates a host polling the display string of every one of 5000 parameters at 30Hz, with none, 1% or all of them
+ *    changing each frame, and prints the time per frame and the share of a CPU that takes
+ *  - times StringToValue() on display texts
+ *
+ * usage: IPlugParamDisplayBench [parameters (5000)] [frames (300)]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "IPlugParameter.h"
+
+using namespace iplug;
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+static double RandNormalized() { return (Rand() & 0xffffff) / (double) 0xffffff; }
+
+// IParam::GetDisplayText() as it was
+static const char* OldGetDisplayText(const IParam& p, double value)
+{
+  for (auto i = 0; i < p.NDisplayTexts(); i++)
+  {
+    double v;
+    const char* str = p.GetDisplayTextAtIdx(i, &v);
+    if (value == v) return str;
+  }
+  return "";
+}
+
+// IParam::MapDisplayText() as it was
+static bool OldMapDisplayText(const IParam& p, const char* str, double* pValue)
+{
+  for (auto i = 0; i < p.NDisplayTexts(); i++)
+  {
+    double v;
+    if (!strcmp(str, p.GetDisplayTextAtIdx(i, &v)))
+    {
+      *pValue = v;
+      return true;
+    }
+  }
+  return false;
+}
+
+// IParam::GetDisplay() as it was
+static void OldGetDisplay(const IParam& p, double value, bool normalized, WDL_String& str, bool withDisplayText = true)
+{
+  if (normalized) value = p.FromNormalized(value);
+
+  if (withDisplayText)
+  {
+    const char* displayText = OldGetDisplayText(p, value);
+
+    if (CStringHasContents(displayText))
+    {
+      str.Set(displayText, MAX_PARAM_DISPLAY_LEN);
+      return;
+    }
+  }
+
+  double displayValue = value;
+
+  if (p.GetFlags() & IParam::kFlagNegateDisplay)
+    displayValue = -displayValue;
+
+  if (!displayValue) displayValue = 0.0;
+
+  if (p.GetDisplayPrecision() == 0)
+  {
+    str.SetFormatted(MAX_PARAM_DISPLAY_LEN, "%d", static_cast<int>(round(displayValue)));
+  }
+  else if ((p.GetFlags() & IParam::kFlagSignDisplay) && displayValue)
+  {
+    char fmt[16];
+    snprintf(fmt, sizeof(fmt), "%%+.%df", p.GetDisplayPrecision());
+    str.SetFormatted(MAX_PARAM_DISPLAY_LEN, fmt, displayValue);
+  }
+  else
+  {
+    str.SetFormatted(MAX_PARAM_DISPLAY_LEN, "%.*f", p.GetDisplayPrecision(), displayValue);
+  }
+}
+
+// IParam::StringToValue() as it was
+static double OldStringToValue(const IParam& p, const char* str)
+{
+  double v = 0.;
+  bool mapped = (bool) p.NDisplayTexts();
+
+  if (mapped)
+    mapped = OldMapDisplayText(p, str, &v);
+
+  if (!mapped && p.Type() != IParam::kTypeEnum && p.Type() != IParam::kTypeBool)
+  {
+    v = atof(str);
+
+    if (p.GetFlags() & IParam::kFlagNegateDisplay)
+      v = -v;
+
+    v = p.Constrain(v);
+  }
+
+  return v;
+}
+
+static const int kNumKinds = 10;
+
+static void InitParam(IParam& p, int kind)
+{
+  switch (kind)
+  {
+    case 0:
+      p.InitGain("Gain", 0., -70., 12., 0.1);
+      p.SetDisplayText(-70., "-inf");
+      break;
+    case 1: p.InitFrequency("Freq", 1000., 20., 20000., 0.1); break;
+    case 2: p.InitPercentage("Mix", 50., 0., 100.); break;
+    case 3:
+      p.InitDouble("Pan", 0., -100., 100., 0.01, "", IParam::kFlagSignDisplay);
+      p.SetDisplayText(0., "C");
+      break;
+    case 4: p.InitInt("Voices", 8, 1, 64); break;
+    case 5: p.InitEnum("Mode", 0, {"Off", "Low", "Mid", "High", "Band", "Notch", "Peak", "Shelf"}); break;
+    case 6: p.InitBool("Bypass", false); break;
+    case 7: p.InitPitch("Note", 60); break;
+    case 8: p.InitDouble("Depth", 0.5, 0., 1., 0.001, "", IParam::kFlagNegateDisplay); break;
+    case 9:
+    {
+      p.InitInt("Division", 0, 0, 1016);
+      char buf[32];
+      for (auto i = 0; i < 128; i++)
+      {
+        snprintf(buf, sizeof(buf), "1/%d", i + 1);
+        p.SetDisplayText(i * 8, buf);
+      }
+      break;
+    }
+  }
+}
+
+static int CheckDisplay(const IParam& p, double value, bool normalized, bool withDisplayText)
+{
+  WDL_String oldStr, newStr, cachedStr;
+  OldGetDisplay(p, value, normalized, oldStr, withDisplayText);
+  p.GetDisplay(value, normalized, newStr, withDisplayText);
+  p.GetDisplay(value, normalized, cachedStr, withDisplayText);
+
+  if (strcmp(oldStr.Get(), newStr.Get()) || strcmp(oldStr.Get(), cachedStr.Get()))
+  {
+    printf("  mismatch: %s %.17g (precision %d, flags %d): \"%s\" \"%s\" \"%s\"\n", p.GetName(), value, p.GetDisplayPrecision(),
+           p.GetFlags(), oldStr.Get(), newStr.Get(), cachedStr.Get());
+    return 1;
+  }
+  return 0;
+}
+
+/** random values with random magnitudes, and values close to halfway between two results */
+static double RandValue(int precision)
+{
+  switch (Rand() % 4)
+  {
+    case 0: return (Rand() & 1 ? -1. : 1.) * RandNormalized() * std::pow(10., (int) (Rand() % 22) - 10);
+    case 1: return (Rand() & 1 ? -1. : 1.) * ((int) (Rand() % 100000) + 0.5) / std::pow(10., precision);
+    case 2: return (Rand() & 1 ? -1. : 1.) * (Rand() % 1000) / 1000.;
+    default: return std::nextafter(((int) (Rand() % 100000) + 0.5) / std::pow(10., precision), Rand() & 1 ? 0. : 1e20);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const int nParams = argc > 1 ? std::max(kNumKinds, atoi(argv[1])) : 5000;
+  const int nFrames = argc > 2 ? std::max(1, atoi(argv[2])) : 300;
+
+  std::vector<std::unique_ptr<IParam>> params;
+  for (auto i = 0; i < nParams; i++)
+  {
+    params.emplace_back(new IParam);
+    InitParam(*params.back(), i % kNumKinds);
+  }
+
+  int errors = 0;
+
+  // each kind of parameter, at random values and every display text
+  for (auto k = 0; k < kNumKinds; k++)
+  {
+    const IParam& p = *params[k];
+
+    for (auto i = 0; i < 20000; i++)
+    {
+      const double norm = RandNormalized();
+      errors += CheckDisplay(p, norm, true, true);
+      errors += CheckDisplay(p, norm, true, false);
+      errors += CheckDisplay(p, p.GetMin() + (Rand() % 4000) * 0.25 * p.GetStep(), false, true);
+    }
+
+    for (auto i = 0; i < p.NDisplayTexts(); i++)
+    {
+      double v;
+      const char* text = p.GetDisplayTextAtIdx(i, &v);
+      errors += CheckDisplay(p, v, false, true);
+      errors += strcmp(OldGetDisplayText(p, v), p.GetDisplayText(v)) != 0;
+      errors += OldStringToValue(p, text) != p.StringToValue(text);
+    }
+
+    for (auto i = -10; i < 1100; i++)
+    {
+      const double v = i * 0.5;
+      errors += strcmp(OldGetDisplayText(p, v), p.GetDisplayText(v)) != 0;
+
+      WDL_String str;
+      p.GetDisplay(p.Constrain(v), false, str, false);
+      errors += OldStringToValue(p, str.Get()) != p.StringToValue(str.Get());
+    }
+  }
+
+  // number formatting at every precision, with each combination of the sign and negate flags
+  for (auto flags = 0; flags < 4; flags++)
+  {
+    IParam p;
+    p.InitDouble("Number", 0., -1e12, 1e12, 1., "",
+                 (flags & 1 ? IParam::kFlagSignDisplay : 0) | (flags & 2 ? IParam::kFlagNegateDisplay : 0));
+
+    for (auto precision = 0; precision <= 9; precision++)
+    {
+      p.SetDisplayPrecision(precision);
+      for (auto i = 0; i < 50000; i++)
+        errors += CheckDisplay(p, RandValue(precision), false, false);
+
+      for (double v : {0., -0., 0.125, 2.675, 1.005, -1.5, 2.5, -0.0004, 0.0004, 999999999.5, 1e15, -1e300})
+        errors += CheckDisplay(p, v, false, false);
+    }
+  }
+
+  printf("%s GetDisplay(), GetDisplayText() and StringToValue() results match the previous versions\n\n", errors ? "NOT ALL" : "all");
+
+  // a host polling every parameter's display at UI rate
+  printf("%d parameters polled at 30Hz (GetDisplay() of normalized values), %d frames:\n", nParams, nFrames);
+  printf("  %-14s %16s %16s %16s %16s\n", "changing", "before us/frame", "after us/frame", "before CPU %", "after CPU %");
+
+  std::vector<double> hostValues(nParams);
+  WDL_String str;
+  size_t sum = 0;
+
+  for (double changing : {0.0, 0.01, 1.0})
+  {
+    double times[2];
+    for (auto v = 0; v < 2; v++)
+    {
+      sSeed = 1;
+      for (auto& h : hostValues) h = RandNormalized();
+
+      double start = Now();
+      for (auto f = -1; f < nFrames; f++)
+      {
+        if (!f) start = Now(); // after a frame to warm up
+
+        const int nChanging = (int) (changing * nParams);
+        for (auto c = 0; c < nChanging; c++)
+          hostValues[Rand() % nParams] = RandNormalized();
+
+        for (auto i = 0; i < nParams; i++)
+        {
+          if (v == 0) OldGetDisplay(*params[i], hostValues[i], true, str);
+          else params[i]->GetDisplay(hostValues[i], true, str);
+          sum += str.GetLength();
+        }
+      }
+      times[v] = (Now() - start) / nFrames;
+    }
+    printf("  %13.0f%% %16.1f %16.1f %16.2f %16.2f\n", changing * 100., times[0] * 1e6, times[1] * 1e6, times[0] * 30. * 100., times[1] * 30. * 100.);
+  }
+
+  // typing a display text into a host
+  printf("\nStringToValue() of display texts, ns per call:\n");
+  for (auto k : {5, 7, 9})
+  {
+    const IParam& p = *params[k];
+    double times[2];
+    double vsum = 0.;
+    for (auto v = 0; v < 2; v++)
+    {
+      const int nCalls = 200000;
+      const double start = Now();
+      for (auto i = 0; i < nCalls; i++)
+      {
+        const char* text = p.GetDisplayTextAtIdx(i % p.NDisplayTexts());
+        vsum += v == 0 ? OldStringToValue(p, text) : p.StringToValue(text);
+      }
+      times[v] = (Now() - start) * 1e9 / nCalls;
+    }
+    printf("  %-10s %4d texts: before %8.1f, after %8.1f\n", p.GetName(), p.NDisplayTexts(), times[0], times[1]);
+    if (vsum == 12345.) printf(" ");
+  }
+
+  if (sum == 12345) printf(" ");
+  printf("\n%s\n", errors ? "FAILED" : "all checks passed");
+  return errors ? 1 : 0;
+}
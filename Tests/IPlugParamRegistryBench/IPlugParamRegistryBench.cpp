@@ -0,0 +1,297 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugParamRegistryBench: builds plug-ins with many parameters in many groups and, against copies of the previous linear
+ * searches,
+ *  - checks the units/clumps built from the groups with GetParamGroupIdx() (against the search IPlugVST3_ControllerBase and IPlugAU use),
+ *    ForParamInGroup(), CopyParamValues() between groups and GetParamIdx()
+ *  - checks that the index follows parameters being initialised again with another name or group, added and removed
+ *  - prints the time to create the parameters, build the index, build the groups, visit every group and find every
+ *    parameter by name
+ *
+ * usage: IPlugParamRegistryBench [parameters per group (16)] [parameter counts (1000 10000 50000)]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "IPlugPluginBase.h"
+
+using namespace iplug;
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+class RegistryPlugin : public IPluginBase
+{
+public:
+  RegistryPlugin(int nParams) : IPluginBase(nParams, 0) {}
+  void BeginInformHostOfParamChangeFromUI(int paramIdx) override {}
+  void EndInformHostOfParamChangeFromUI(int paramIdx) override {}
+};
+
+static void InitParam(IParam& p, int idx, int paramsPerGroup)
+{
+  char name[MAX_PARAM_NAME_LEN], group[MAX_PARAM_GROUP_LEN];
+  snprintf(name, sizeof(name), "Param %d", idx);
+  // a few parameters without a group, the rest in order
+  if (idx % 97 == 0)
+    group[0] = '\0';
+  else
+    snprintf(group, sizeof(group), "Group %d", idx / paramsPerGroup);
+  p.InitDouble(name, 0.5, 0., 1., 0.001, "", 0, group);
+}
+
+// the unit/clump building in IPlugVST3_ControllerBase and IPlugAU, group numbers are 1 based, 0 for no group
+static void OldBuildGroups(RegistryPlugin& plug, std::vector<int>& groupOfParam)
+{
+  for (auto i = 0; i < plug.NParams(); i++)
+  {
+    const char* paramGroupName = plug.GetParam(i)->GetGroup();
+    int unitID = 0;
+
+    if (CStringHasContents(paramGroupName))
+    {
+      for (int j = 0; j < plug.NParamGroups(); j++)
+      {
+        if (strcmp(paramGroupName, plug.GetParamGroupName(j)) == 0)
+          unitID = j + 1;
+      }
+
+      if (unitID == 0)
+        unitID = plug.AddParamGroup(paramGroupName);
+    }
+    groupOfParam[i] = unitID;
+  }
+}
+
+static void BuildGroups(RegistryPlugin& plug, std::vector<int>& groupOfParam)
+{
+  for (auto i = 0; i < plug.NParams(); i++)
+  {
+    const char* paramGroupName = plug.GetParam(i)->GetGroup();
+    int unitID = 0;
+
+    if (CStringHasContents(paramGroupName))
+    {
+      unitID = plug.GetParamGroupIdx(paramGroupName) + 1;
+
+      if (unitID == 0)
+        unitID = plug.AddParamGroup(paramGroupName);
+    }
+    groupOfParam[i] = unitID;
+  }
+}
+
+// IPluginBase::ForParamInGroup() as it was
+static void OldForParamInGroup(RegistryPlugin& plug, const char* paramGroup, std::function<void(int paramIdx, IParam& param)> func)
+{
+  for (auto p = 0; p < plug.NParams(); p++)
+  {
+    IParam* pParam = plug.GetParam(p);
+    if (strcmp(pParam->GetGroup(), paramGroup) == 0)
+      func(p, *pParam);
+  }
+}
+
+static int OldGetParamIdx(RegistryPlugin& plug, const char* name)
+{
+  for (auto i = 0; i < plug.NParams(); i++)
+  {
+    if (strcmp(plug.GetParam(i)->GetName(), name) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static std::vector<int> ParamsInGroup(RegistryPlugin& plug, const char* group, bool old)
+{
+  std::vector<int> idxs;
+  auto func = [&](int paramIdx, IParam&) { idxs.push_back(paramIdx); };
+  if (old) OldForParamInGroup(plug, group, func);
+  else plug.ForParamInGroup(group, func);
+  return idxs;
+}
+
+static int CheckIndex(RegistryPlugin& plug)
+{
+  int errors = 0;
+  for (auto i = 0; i < plug.NParams(); i++)
+  {
+    const IParam* pParam = plug.GetParam(i);
+    errors += plug.GetParamIdx(pParam->GetName()) != OldGetParamIdx(plug, pParam->GetName());
+    errors += ParamsInGroup(plug, pParam->GetGroup(), true) != ParamsInGroup(plug, pParam->GetGroup(), false);
+  }
+  errors += plug.GetParamIdx("Not a parameter") != -1;
+  errors += !ParamsInGroup(plug, "Not a group", false).empty();
+  return errors;
+}
+
+static int RunChecks(int paramsPerGroup)
+{
+  int errors = 0;
+  const int nParams = 1000;
+
+  RegistryPlugin oldPlug(nParams), newPlug(nParams);
+  for (auto i = 0; i < nParams; i++)
+  {
+    InitParam(*oldPlug.GetParam(i), i, paramsPerGroup);
+    InitParam(*newPlug.GetParam(i), i, paramsPerGroup);
+  }
+
+  std::vector<int> oldGroups(nParams), newGroups(nParams);
+  OldBuildGroups(oldPlug, oldGroups);
+  BuildGroups(newPlug, newGroups);
+  errors += oldGroups != newGroups || oldPlug.NParamGroups() != newPlug.NParamGroups();
+  for (auto g = 0; g < newPlug.NParamGroups(); g++)
+  {
+    errors += strcmp(oldPlug.GetParamGroupName(g), newPlug.GetParamGroupName(g)) != 0;
+    errors += newPlug.GetParamGroupIdx(newPlug.GetParamGroupName(g)) != g;
+  }
+  errors += newPlug.GetParamGroupIdx("Not a group") != -1;
+
+  errors += CheckIndex(newPlug);
+
+  // initialising parameters again, with names and groups that move them around
+  for (auto i = 0; i < 50; i++)
+  {
+    const int idx = Rand() % nParams;
+    InitParam(*newPlug.GetParam(idx), Rand() % nParams, paramsPerGroup);
+  }
+  errors += CheckIndex(newPlug);
+
+  // the group names stay valid when the parameter that added a group is initialised again
+  newPlug.GetParam(1)->InitDouble("Renamed", 0., 0., 1., 0.1, "", 0, "Another group");
+  errors += strcmp(newPlug.GetParamGroupName(0), oldPlug.GetParamGroupName(0)) != 0;
+
+  // adding and removing parameters
+  newPlug.AddParam()->InitDouble("Added", 0., 0., 1., 0.1, "", 0, "Group 0");
+  newPlug.RemoveParam(0);
+  errors += CheckIndex(newPlug);
+
+  // copying between groups
+  for (auto i = 0; i < newPlug.NParams(); i++)
+    newPlug.GetParam(i)->Set((Rand() % 1000) / 1000.);
+  newPlug.CopyParamValues("Group 2", "Group 3");
+  std::vector<int> from = ParamsInGroup(newPlug, "Group 2", true), to = ParamsInGroup(newPlug, "Group 3", true);
+  for (size_t i = 0; i < std::min(from.size(), to.size()); i++)
+    errors += newPlug.GetParam(from[i])->Value() != newPlug.GetParam(to[i])->Value();
+
+  return errors;
+}
+
+int main(int argc, char** argv)
+{
+  const int paramsPerGroup = argc > 1 ? std::max(1, atoi(argv[1])) : 16;
+  std::vector<int> counts;
+  for (auto i = 2; i < argc; i++)
+    counts.push_back(std::max(1, atoi(argv[i])));
+  if (counts.empty())
+    counts = {1000, 10000, 50000};
+
+  int errors = RunChecks(paramsPerGroup);
+  printf("%s groups, name and group lookups match the linear searches\n\n", errors ? "NOT ALL" : "all");
+
+  printf("%d parameters per group, ms:\n", paramsPerGroup);
+  printf("  %-10s %10s %10s | %12s %12s | %12s %12s | %12s %12s\n", "parameters", "create", "index",
+         "groups old", "groups new", "visit old", "visit new", "names old", "names new");
+
+  for (int nParams : counts)
+  {
+    double start = Now();
+    std::unique_ptr<RegistryPlugin> plugs[2];
+    for (auto v = 0; v < 2; v++)
+    {
+      plugs[v] = std::make_unique<RegistryPlugin>(nParams);
+      for (auto i = 0; i < nParams; i++)
+        InitParam(*plugs[v]->GetParam(i), i, paramsPerGroup);
+    }
+    const double createTime = (Now() - start) / 2.;
+
+    std::vector<int> groupOfParam(nParams);
+    double groupTimes[2], visitTimes[2], nameTimes[2], indexTime = 0.;
+    size_t sum = 0;
+
+    for (auto v = 0; v < 2; v++)
+    {
+      RegistryPlugin& plug = *plugs[v];
+
+      // building the units/clumps is quadratic in the number of groups with the old search, so don't wait for it forever
+      start = Now();
+      if (v == 0 && (size_t) nParams * nParams / paramsPerGroup > 4000000000ull)
+        groupTimes[v] = -1.;
+      else
+      {
+        if (v == 0) OldBuildGroups(plug, groupOfParam);
+        else BuildGroups(plug, groupOfParam);
+        groupTimes[v] = Now() - start;
+      }
+
+      // the first lookup after the parameters are initialised builds the index
+      if (v == 1)
+      {
+        start = Now();
+        sum += plug.GetParamIdx("Param 0");
+        indexTime = Now() - start;
+      }
+
+      // a UI or preset manager visiting every group
+      const int nVisits = std::min(plug.NParamGroups(), 200);
+      start = Now();
+      for (auto g = 0; g < nVisits; g++)
+      {
+        char group[MAX_PARAM_GROUP_LEN];
+        snprintf(group, sizeof(group), "Group %d", (int) (Rand() % std::max(1, nParams / paramsPerGroup)));
+        auto func = [&](int paramIdx, IParam& param) { sum += paramIdx; };
+        if (v == 0) OldForParamInGroup(plug, group, func);
+        else plug.ForParamInGroup(group, func);
+      }
+      visitTimes[v] = nVisits ? (Now() - start) * plug.NParamGroups() / nVisits : 0.;
+
+      // finding parameters by name (e.g. from a script or an OSC address)
+      const int nNames = std::min(nParams, 2000);
+      start = Now();
+      for (auto i = 0; i < nNames; i++)
+      {
+        char name[MAX_PARAM_NAME_LEN];
+        snprintf(name, sizeof(name), "Param %d", (int) (Rand() % nParams));
+        sum += v == 0 ? OldGetParamIdx(plug, name) : plug.GetParamIdx(name);
+      }
+      nameTimes[v] = (Now() - start) * nParams / nNames;
+    }
+
+    char oldGroupTime[32];
+    if (groupTimes[0] < 0.) snprintf(oldGroupTime, sizeof(oldGroupTime), "(skipped)");
+    else snprintf(oldGroupTime, sizeof(oldGroupTime), "%.2f", groupTimes[0] * 1e3);
+
+    printf("  %-10d %10.2f %10.2f | %12s %12.2f | %12.2f %12.2f | %12.2f %12.2f\n", nParams, createTime * 1e3, indexTime * 1e3,
+           oldGroupTime, groupTimes[1] * 1e3, visitTimes[0] * 1e3, visitTimes[1] * 1e3, nameTimes[0] * 1e3, nameTimes[1] * 1e3);
+    if (sum == 12345) printf(" ");
+  }
+
+  printf("\n(visiting every group and finding every parameter by name are extrapolated from up to 200 groups and 2000 names)\n");
+  printf("\n%s\n", errors ? "FAILED" : "all checks passed");
+  return errors ? 1 : 0;
+}
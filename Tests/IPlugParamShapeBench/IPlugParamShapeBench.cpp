@@ -0,0 +1,260 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugParamShapeBench: converts blocks of values with parameters of each shape (linear, stepped, power curves, exponential
+ * and a custom shape), and
+ *  - checks that the block FromNormalized() and ToNormalized() give exactly the same results as the per value calls,
+ *    including inputs outside 0. to 1. and NaN
+ *  - checks that the kShapeCustom fallback is used for a shape derived from a built in one
+ *  - compares the largest error of FromNormalizedLUT() at many random points with GetLUTError(), for several table sizes
+ *  - prints the time per value of the per value calls, the block calls and the table
+ *
+ * usage: IPlugParamShapeBench [block size (512)] [blocks per test (20000)]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "IPlugParameter.h"
+
+using namespace iplug;
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+static double RandNormalized() { return (Rand() & 0xffffff) / (double) 0xffffff; }
+
+/** a shape that isn't built in */
+struct ShapeSine : public IParam::Shape
+{
+  Shape* Clone() const override { return new ShapeSine(*this); }
+  IParam::EDisplayType GetDisplayType() const override { return IParam::kDisplayLinear; }
+  double NormalizedToValue(double value, const IParam& param) const override
+  {
+    return param.GetMin() + (0.5 - 0.5 * std::cos(value * 3.14159265358979)) * param.GetRange();
+  }
+  double ValueToNormalized(double value, const IParam& param) const override
+  {
+    return std::acos(1.0 - 2.0 * (value - param.GetMin()) / param.GetRange()) / 3.14159265358979;
+  }
+};
+
+/** derived from a built in shape, so it must not take the ShapeExp path */
+struct ShapeExpOffset : public IParam::ShapeExp
+{
+  Shape* Clone() const override { return new ShapeExpOffset(*this); }
+  double NormalizedToValue(double value, const IParam& param) const override { return ShapeExp::NormalizedToValue(value, param) + 1.0; }
+  double ValueToNormalized(double value, const IParam& param) const override { return ShapeExp::ValueToNormalized(value - 1.0, param); }
+};
+
+static bool Same(double a, double b)
+{
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+static int CheckExact(const IParam& p, int nValues)
+{
+  std::vector<double> in(nValues), out(nValues), inPlace(nValues);
+  int errors = 0;
+
+  for (auto i = 0; i < nValues; i++)
+  {
+    switch (i % 50)
+    {
+      case 0: in[i] = 0.0; break;
+      case 1: in[i] = 1.0; break;
+      case 2: in[i] = -0.25; break;
+      case 3: in[i] = 1.25; break;
+      case 4: in[i] = std::nan(""); break;
+      default: in[i] = RandNormalized(); break;
+    }
+  }
+
+  p.FromNormalized(in.data(), out.data(), nValues);
+  inPlace = in;
+  p.FromNormalized(inPlace.data(), inPlace.data(), nValues);
+  for (auto i = 0; i < nValues; i++)
+  {
+    const double ref = p.FromNormalized(in[i]);
+    if (!Same(out[i], ref) || !Same(inPlace[i], ref))
+      errors++;
+  }
+
+  // real values across (and beyond) the range
+  for (auto i = 0; i < nValues; i++)
+    in[i] = p.GetMin() - 0.25 * p.GetRange() + (i % 50 == 4 ? std::nan("") : RandNormalized() * 1.5 * p.GetRange());
+
+  p.ToNormalized(in.data(), out.data(), nValues);
+  inPlace = in;
+  p.ToNormalized(inPlace.data(), inPlace.data(), nValues);
+  for (auto i = 0; i < nValues; i++)
+  {
+    const double ref = p.ToNormalized(in[i]);
+    if (!Same(out[i], ref) || !Same(inPlace[i], ref))
+      errors++;
+  }
+
+  return errors;
+}
+
+/** largest difference between the table and the exact conversion at random points, as a fraction of the range */
+static double MeasureLUTError(const IParam& p, int nValues)
+{
+  std::vector<double> in(nValues), exact(nValues), lut(nValues);
+  for (auto& v : in) v = RandNormalized();
+
+  p.FromNormalized(in.data(), exact.data(), nValues);
+  p.FromNormalizedLUT(in.data(), lut.data(), nValues);
+
+  double err = 0.0;
+  for (auto i = 0; i < nValues; i++)
+    err = std::max(err, std::fabs(lut[i] - exact[i]) / p.GetRange());
+  return err;
+}
+
+enum EMethod
+{
+  kPerValue,
+  kBlock,
+  kTable,
+  kToPerValue,
+  kToBlock,
+  kNumMethods
+};
+
+static double TimeNs(const IParam& p, EMethod method, int blockSize, int nBlocks)
+{
+  std::vector<double> in(blockSize), out(blockSize);
+  for (auto& v : in) v = RandNormalized();
+  if (method == kToPerValue || method == kToBlock)
+    p.FromNormalized(in.data(), in.data(), blockSize);
+
+  double sum = 0.0;
+  const double start = Now();
+  for (auto b = 0; b < nBlocks; b++)
+  {
+    in[b % blockSize] += 1e-9; // a different block each time
+    switch (method)
+    {
+      case kPerValue:
+        for (auto i = 0; i < blockSize; i++) out[i] = p.FromNormalized(in[i]);
+        break;
+      case kBlock:
+        p.FromNormalized(in.data(), out.data(), blockSize);
+        break;
+      case kTable:
+        p.FromNormalizedLUT(in.data(), out.data(), blockSize);
+        break;
+      case kToPerValue:
+        for (auto i = 0; i < blockSize; i++) out[i] = p.ToNormalized(in[i]);
+        break;
+      case kToBlock:
+        p.ToNormalized(in.data(), out.data(), blockSize);
+        break;
+      default:
+        break;
+    }
+    sum += out[b % blockSize];
+  }
+  const double ns = (Now() - start) * 1e9 / ((double) nBlocks * blockSize);
+  if (sum == 12345.0) printf(" ");
+  return ns;
+}
+
+int main(int argc, char** argv)
+{
+  const int blockSize = argc > 1 ? std::max(1, atoi(argv[1])) : 512;
+  const int nBlocks = argc > 2 ? std::max(1, atoi(argv[2])) : 20000;
+
+  static const int kNumParams = 7;
+  IParam params[kNumParams];
+  params[0].InitGain("Gain", 0., -70., 12., 0.1);
+  params[1].InitInt("Note", 60, 0, 127);
+  params[2].InitDouble("Drive", 10., 0., 100., 0.01, "%", 0, "", IParam::ShapePowCurve(3.0));
+  params[3].InitDouble("Mix", 0.5, 0., 1., 0.001, "", 0, "", IParam::ShapePowCurve(0.5));
+  params[4].InitFrequency("Freq", 1000., 20., 20000., 0.1);
+  params[5].InitDouble("Sine", 0.5, 0., 10., 0.01, "", 0, "", ShapeSine());
+  params[6].InitDouble("ExpOffset", 100., 20., 20000., 0.1, "", 0, "", ShapeExpOffset());
+
+  static const char* kShapeNames[] = {"linear", "pow curve", "exp", "custom"};
+  static const IParam::EShapeType kExpectedTypes[kNumParams] = {
+    IParam::kShapeLinear, IParam::kShapeLinear, IParam::kShapePowCurve, IParam::kShapePowCurve,
+    IParam::kShapeExp, IParam::kShapeCustom, IParam::kShapeCustom
+  };
+
+  int errors = 0;
+
+  printf("block conversions against the per value calls (100000 values each way):\n");
+  for (auto i = 0; i < kNumParams; i++)
+  {
+    const IParam& p = params[i];
+    const int mismatches = CheckExact(p, 100000);
+    const bool typeOK = p.GetShapeType() == kExpectedTypes[i];
+    printf("  %-10s %-10s %s\n", p.GetName(), kShapeNames[p.GetShapeType()],
+           !mismatches && typeOK ? "exact" : "FAILED");
+    if (!typeOK) errors++;
+    errors += mismatches;
+  }
+
+  printf("\ntable error as a fraction of the range, GetLUTError() / largest of 1M random points:\n");
+  printf("  %-10s %21s %21s %21s\n", "", "256 points", "1024 points", "4096 points");
+  for (auto i = 2; i < kNumParams; i++)
+  {
+    IParam& p = params[i];
+    printf("  %-10s", p.GetName());
+    for (int nPoints : {256, 1024, 4096})
+    {
+      p.InitLUT(nPoints);
+      const double measured = MeasureLUTError(p, 1000000);
+      printf("   %8.2g / %8.2g", p.GetLUTError(), measured);
+      // the quarter points are where a power or exponential curve errs most, so the random points shouldn't find much more
+      if (measured > p.GetLUTError() * 1.05 + 1e-15)
+        errors++;
+    }
+    printf("\n");
+    p.InitLUT(1024);
+  }
+
+  // a linear shape never gets a table, and FromNormalizedLUT() falls back to the exact conversion
+  params[0].InitLUT(1024);
+  errors += params[0].GetLUTError() != 0.0 || MeasureLUTError(params[0], 1000) != 0.0;
+
+  printf("\nns per value, blocks of %d values, 1024 point tables:\n", blockSize);
+  printf("  %-10s %-10s %11s %11s %11s | %11s %11s\n", "", "", "From", "From block", "From table", "To", "To block");
+  for (auto i = 0; i < kNumParams; i++)
+  {
+    const IParam& p = params[i];
+    printf("  %-10s %-10s", p.GetName(), kShapeNames[p.GetShapeType()]);
+    for (auto m = 0; m < kNumMethods; m++)
+    {
+      if (m == kToPerValue) printf(" |");
+      printf(" %11.2f", TimeNs(p, (EMethod) m, blockSize, nBlocks));
+    }
+    printf("\n");
+  }
+
+  printf("\n%s\n", errors ? "FAILED" : "all checks passed");
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,377 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugStateBench: saves and loads the parameter state of many plug-in instances through copies of the VST3 getState() and
+ * setState() (IPlug/VST3/IPlugVST3_Common.h, which needs the VST3 SDK), against an in memory stream that behaves like the
+ * SDK's MemoryStream, and
+ *  - checks that the unpacked state is byte for byte what the previous SerializeParams() wrote, and loads the same values
+ *  - checks that packed states load the same values, that damaged and truncated ones are rejected without changing any
+ *    parameters, that states with fewer or more parameters load the ones they share, and that unpacked states still load
+ *  - prints the time to save and load every instance with the previous code, and with the current unpacked and packed states
+ *
+ * usage: IPlugStateBench [instances (500)] [parameters (2000)]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "IPlugPluginBase.h"
+
+using namespace iplug;
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+static const int kResultTrue = 0;
+
+/** Steinberg::MemoryStream as far as the state code uses it: short reads succeed, reads at the end return no bytes */
+class StateStream
+{
+public:
+  int read(void* pBuffer, int numBytes, int* pNumBytesRead)
+  {
+    const int n = std::max(0, std::min(numBytes, mData.GetSize() - mPos));
+    if (n) memcpy(pBuffer, mData.Get() + mPos, n);
+    mPos += n;
+    if (pNumBytesRead) *pNumBytesRead = n;
+    return kResultTrue;
+  }
+
+  int write(const void* pBuffer, int numBytes)
+  {
+    const int size = std::max(mData.GetSize(), mPos + numBytes);
+    mData.Resize(size, false);
+    memcpy(mData.Get() + mPos, pBuffer, numBytes);
+    mPos += numBytes;
+    return kResultTrue;
+  }
+
+  void seek(int pos) { mPos = pos; }
+
+  WDL_TypedBuf<uint8_t> mData;
+  int mPos = 0;
+};
+
+class StatePlugin : public IPluginBase
+{
+public:
+  StatePlugin(int nParams) : IPluginBase(nParams, 0), mDSPValues(nParams) {}
+  void BeginInformHostOfParamChangeFromUI(int paramIdx) override {}
+  void EndInformHostOfParamChangeFromUI(int paramIdx) override {}
+  void OnParamChange(int paramIdx) override { mDSPValues[paramIdx] = GetParam(paramIdx)->Value(); }
+
+  std::vector<double> mDSPValues;
+  int mBypassed = 0;
+};
+
+static void InitParams(StatePlugin& plug)
+{
+  for (auto i = 0; i < plug.NParams(); i++)
+  {
+    char name[MAX_PARAM_NAME_LEN];
+    snprintf(name, sizeof(name), "Param %d", i);
+    switch (i % 3)
+    {
+      case 0: plug.GetParam(i)->InitDouble(name, 0.5, 0., 1., 0.001); break;
+      case 1: plug.GetParam(i)->InitGain(name, 0., -70., 12., 0.1); break;
+      default: plug.GetParam(i)->InitInt(name, 4, 0, 16); break;
+    }
+  }
+}
+
+static void Randomize(StatePlugin& plug)
+{
+  for (auto i = 0; i < plug.NParams(); i++)
+    plug.GetParam(i)->SetNormalized((Rand() & 0xffffff) / (double) 0xffffff);
+}
+
+// IPluginBase::SerializeParams() as it was
+static bool OldSerializeParams(const StatePlugin& plug, IByteChunk& chunk)
+{
+  bool savedOK = true;
+  int i, n = plug.NParams();
+  for (i = 0; i < n && savedOK; ++i)
+  {
+    const IParam* pParam = plug.GetParam(i);
+    Trace(TRACELOC, "%d %s %f", i, pParam->GetName(), pParam->Value());
+    double v = pParam->Value();
+    savedOK &= (chunk.Put(&v) > 0);
+  }
+  return savedOK;
+}
+
+// IPluginBase::UnserializeParams() as it was
+static int OldUnserializeParams(StatePlugin& plug, const IByteChunk& chunk, int startPos)
+{
+  int i, n = plug.NParams(), pos = startPos;
+  for (i = 0; i < n && pos >= 0; ++i)
+  {
+    IParam* pParam = plug.GetParam(i);
+    double v = 0.0;
+    pos = chunk.Get(&v, pos);
+    pParam->Set(v);
+    Trace(TRACELOC, "%d %s %f", i, pParam->GetName(), pParam->Value());
+  }
+
+  plug.OnParamReset(kPresetRecall);
+  return pos;
+}
+
+// IPlugVST3State::GetState()
+static bool GetState(StatePlugin& plug, StateStream& stream, bool old)
+{
+  IByteChunk chunk;
+
+  if (old ? OldSerializeParams(plug, chunk) : plug.SerializeState(chunk))
+    stream.write(chunk.GetData(), chunk.Size());
+  else
+    return false;
+
+  int toSaveBypass = plug.mBypassed;
+  stream.write(&toSaveBypass, sizeof(int));
+  return true;
+}
+
+// IPlugVST3State::SetState(), with the previous 128 byte reads when old is set
+static bool SetState(StatePlugin& plug, StateStream& stream, bool old)
+{
+  IByteChunk chunk;
+
+  if (old)
+  {
+    const int bytesPerBlock = 128;
+    char buffer[bytesPerBlock];
+
+    while (true)
+    {
+      int bytesRead = 0;
+      auto status = stream.read(buffer, bytesPerBlock, &bytesRead);
+
+      if (bytesRead <= 0 || status != kResultTrue)
+        break;
+
+      chunk.PutBytes(buffer, bytesRead);
+    }
+  }
+  else
+  {
+    const int bytesPerBlock = 4096;
+    char buffer[bytesPerBlock];
+
+    while (true)
+    {
+      int bytesRead = 0;
+      auto status = stream.read(buffer, bytesPerBlock, &bytesRead);
+
+      if (bytesRead > 0)
+        chunk.PutBytes(buffer, bytesRead);
+
+      if (bytesRead <= 0 || status != kResultTrue)
+        break;
+    }
+  }
+
+  const int pos = old ? OldUnserializeParams(plug, chunk, 0) : plug.UnserializeState(chunk, 0);
+  if (pos < 0)
+    return false;
+
+  int savedBypass = 0;
+  stream.seek(pos);
+  int bytesRead = 0;
+  stream.read(&savedBypass, sizeof(int), &bytesRead);
+  if (bytesRead != sizeof(int))
+    return false;
+  plug.mBypassed = savedBypass;
+
+  plug.OnRestoreState();
+  return true;
+}
+
+static bool SameValues(const StatePlugin& a, const StatePlugin& b, int n)
+{
+  for (auto i = 0; i < n; i++)
+  {
+    if (a.GetParam(i)->Value() != b.GetParam(i)->Value() || b.mDSPValues[i] != b.GetParam(i)->Value())
+      return false;
+  }
+  return true;
+}
+
+static int RunChecks(int nParams)
+{
+  int errors = 0;
+  StatePlugin src(nParams), dst(nParams), ref(nParams);
+  InitParams(src); InitParams(dst); InitParams(ref);
+  Randomize(src);
+
+  // unpacked, the same bytes and values as before, after some custom data
+  IByteChunk oldChunk, newChunk;
+  oldChunk.PutStr("custom data");
+  newChunk.PutStr("custom data");
+  const int startPos = oldChunk.Size();
+  OldSerializeParams(src, oldChunk);
+  src.SerializeParams(newChunk);
+  errors += !oldChunk.IsEqual(newChunk);
+  errors += OldUnserializeParams(ref, oldChunk, startPos) != dst.UnserializeParams(newChunk, startPos);
+  errors += !SameValues(ref, dst, nParams) || !SameValues(src, dst, nParams);
+
+  // a truncated unpacked state loads as much as before
+  IByteChunk truncated;
+  truncated.PutBytes(oldChunk.GetData(), oldChunk.Size() - 100);
+  Randomize(ref);
+  Randomize(dst);
+  errors += OldUnserializeParams(ref, truncated, startPos) != dst.UnserializeParams(truncated, startPos);
+  for (auto i = 0; i < nParams; i++)
+    errors += ref.GetParam(i)->Value() != dst.GetParam(i)->Value() && i < (oldChunk.Size() - 100 - startPos) / (int) sizeof(double);
+
+  // packed
+  src.SetPackedParamState(true);
+  IByteChunk packed;
+  packed.PutStr("custom data");
+  src.SerializeParams(packed);
+  Randomize(dst);
+  errors += dst.UnserializeParams(packed, startPos) != packed.Size();
+  errors += !SameValues(src, dst, nParams);
+
+  // damaged and truncated packed states change nothing
+  for (auto t = 0; t < 2; t++)
+  {
+    IByteChunk damaged;
+    damaged.PutBytes(packed.GetData(), t == 0 ? packed.Size() : packed.Size() - 8);
+    if (t == 0) damaged.GetData()[damaged.Size() - 1 - Rand() % (nParams * 8)] ^= 0x10;
+    Randomize(dst);
+    StatePlugin before(nParams);
+    InitParams(before);
+    for (auto i = 0; i < nParams; i++) before.GetParam(i)->Set(dst.GetParam(i)->Value());
+    errors += dst.UnserializeParams(damaged, startPos) != -1;
+    for (auto i = 0; i < nParams; i++)
+      errors += before.GetParam(i)->Value() != dst.GetParam(i)->Value();
+  }
+
+  // states from versions with fewer and more parameters
+  {
+    StatePlugin fewer(nParams - 10), more(nParams + 10);
+    InitParams(fewer); InitParams(more);
+    fewer.SetPackedParamState(true); more.SetPackedParamState(true);
+    Randomize(fewer); Randomize(more);
+
+    IByteChunk chunk;
+    fewer.SerializeParams(chunk);
+    Randomize(dst);
+    errors += dst.UnserializeParams(chunk, 0) != chunk.Size();
+    for (auto i = 0; i < nParams; i++)
+      errors += dst.GetParam(i)->Value() != (i < nParams - 10 ? fewer.GetParam(i)->Value() : dst.GetParam(i)->GetDefault());
+
+    chunk.Clear();
+    more.SerializeParams(chunk);
+    errors += dst.UnserializeParams(chunk, 0) != chunk.Size();
+    errors += !SameValues(more, dst, nParams);
+  }
+
+  // unpacked states still load with packed states switched on
+  dst.SetPackedParamState(true);
+  Randomize(dst);
+  errors += dst.UnserializeParams(oldChunk, startPos) != oldChunk.Size();
+  {
+    StatePlugin unpacked(nParams);
+    InitParams(unpacked);
+    OldUnserializeParams(unpacked, oldChunk, startPos);
+    errors += !SameValues(unpacked, dst, nParams);
+  }
+
+  // through the VST3 state code, old to new and new to old, unpacked and packed
+  for (auto p = 0; p < 2; p++)
+  {
+    src.SetPackedParamState(p == 1);
+    src.mBypassed = 1;
+    for (auto w = 0; w < 2; w++)
+    {
+      for (auto r = 0; r < 2; r++)
+      {
+        if (p == 1 && r == 1) continue; // the previous code can't read packed states
+        StateStream stream;
+        errors += !GetState(src, stream, w == 1 && p == 0);
+        stream.seek(0);
+        Randomize(dst);
+        dst.mBypassed = 0;
+        errors += !SetState(dst, stream, r == 1);
+        errors += !SameValues(src, dst, nParams) || dst.mBypassed != 1;
+      }
+    }
+  }
+
+  return errors;
+}
+
+int main(int argc, char** argv)
+{
+  const int nInstances = argc > 1 ? std::max(1, atoi(argv[1])) : 500;
+  const int nParams = argc > 2 ? std::max(20, atoi(argv[2])) : 2000;
+
+  int errors = RunChecks(nParams);
+  printf("%s states match the previous version and load as expected\n\n", errors ? "NOT ALL" : "all");
+
+  std::vector<std::unique_ptr<StatePlugin>> plugs;
+  for (auto i = 0; i < nInstances; i++)
+  {
+    plugs.emplace_back(new StatePlugin(nParams));
+    InitParams(*plugs.back());
+    Randomize(*plugs.back());
+  }
+
+  std::vector<StateStream> streams(nInstances);
+
+  printf("%d instances with %d parameters, through the VST3 getState()/setState() code, ms:\n", nInstances, nParams);
+  printf("  %-22s %10s %10s %12s\n", "", "save", "load", "state bytes");
+
+  static const char* kNames[] = {"previous", "unpacked", "packed"};
+  for (auto v = 0; v < 3; v++)
+  {
+    for (auto& pPlug : plugs)
+      pPlug->SetPackedParamState(v == 2);
+
+    double start = Now();
+    for (auto i = 0; i < nInstances; i++)
+    {
+      streams[i].mData.Resize(0, false);
+      streams[i].mPos = 0;
+      errors += !GetState(*plugs[i], streams[i], v == 0);
+    }
+    const double saveTime = Now() - start;
+
+    start = Now();
+    for (auto i = 0; i < nInstances; i++)
+    {
+      streams[i].seek(0);
+      errors += !SetState(*plugs[i], streams[i], v == 0);
+    }
+    const double loadTime = Now() - start;
+
+    printf("  %-22s %10.2f %10.2f %12d\n", kNames[v], saveTime * 1e3, loadTime * 1e3, streams[0].mData.GetSize());
+  }
+
+  printf("\n%s\n", errors ? "FAILED" : "all checks passed");
+  return errors ? 1 : 0;
+}
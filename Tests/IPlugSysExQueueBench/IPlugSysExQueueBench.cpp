@@ -0,0 +1,405 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugSysExQueueBench: checks IPlugSysExQueue against a std::deque of the same messages, and times it between two threads:
+ *  - random pushes, messages built with Begin()/Append()/Commit() (and some aborted) and removals, so that records wrap
+ *    around the end of the buffer many times, checking the bytes and offsets of every message and that a message up to
+ *    MaxMessageSize() always fits in an empty queue
+ *  - filling the queue until it overflows, then draining it, and that it works normally afterwards
+ *  - rejecting messages larger than MaxMessageSize(), whether pushed whole or appended in pieces
+ *  - a copy of the VST3 consumer loop (IPlugVST3ProcessorBase::ProcessMidiOut()), with an output buffer smaller than the
+ *    queue's messages, so a message that can never be sent must not hold up the ones behind it
+ *  - messages per second and MB/s from a producer to a consumer thread, for the queue and for the IPlugQueue<SysExData>
+ *    of 4 fixed 512 byte slots it replaced (which can't carry the larger messages at all)
+ *
+ * usage: IPlugSysExQueueBench [random operations (1000000)] [messages per throughput run (200000)]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "IPlugSysExQueue.h"
+#include "IPlugQueue.h"
+#include "IPlugStructs.h"
+
+using namespace iplug;
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+struct RefMsg
+{
+  int offset;
+  std::vector<uint8_t> data;
+};
+
+static RefMsg MakeMsg(int maxSize)
+{
+  RefMsg msg;
+  // mostly short messages, with some up to the largest the queue accepts
+  const int size = Rand() % 8 ? (int) (Rand() % std::min(maxSize + 1, 64)) : (int) (Rand() % (maxSize + 1));
+  msg.offset = (int) (Rand() % 512);
+  msg.data.resize(size);
+  for (auto& b : msg.data)
+    b = (uint8_t) Rand();
+  return msg;
+}
+
+static bool Matches(const ISysEx& msg, const RefMsg& ref)
+{
+  return msg.mOffset == ref.offset && msg.mSize == (int) ref.data.size() && (!msg.mSize || !memcmp(msg.mData, ref.data.data(), msg.mSize));
+}
+
+static int CheckRandom(int maxSize, int nOps, int& nWraps)
+{
+  IPlugSysExQueue queue(maxSize);
+  std::deque<RefMsg> ref;
+  const uint8_t* pLast = nullptr;
+  int errors = 0;
+
+  for (auto op = 0; op < nOps; op++)
+  {
+    const unsigned int r = Rand() % 10;
+
+    if (r < 3) // push a whole message
+    {
+      RefMsg msg = MakeMsg(maxSize);
+      if (queue.Push(ISysEx(msg.offset, msg.data.data(), (int) msg.data.size())))
+        ref.push_back(std::move(msg));
+      else if (ref.empty())
+        errors++; // must always fit in an empty queue
+    }
+    else if (r < 5) // build one in pieces, sometimes abandoning it
+    {
+      RefMsg msg = MakeMsg(maxSize);
+      const bool abort = Rand() % 8 == 0;
+      bool ok = true;
+      queue.Begin(msg.offset);
+      for (size_t pos = 0; ok && pos < msg.data.size();)
+      {
+        const size_t n = std::min<size_t>(msg.data.size() - pos, 1 + Rand() % 100);
+        ok = queue.Append(msg.data.data() + pos, (int) n);
+        pos += n;
+      }
+      if (abort)
+      {
+        if (ok) queue.Abort();
+        errors += queue.IsWriting();
+      }
+      else if (ok && queue.Commit())
+        ref.push_back(std::move(msg));
+      else if (ref.empty())
+        errors++;
+    }
+    else // remove some
+    {
+      const int n = (int) (Rand() % 4);
+      for (auto i = 0; i < n; i++)
+      {
+        ISysEx msg;
+        const bool got = queue.Peek(msg);
+        if (got != !ref.empty())
+        {
+          errors++;
+          break;
+        }
+        if (!got)
+          break;
+        if (!Matches(msg, ref.front()))
+          errors++;
+        if (pLast && msg.mData < pLast)
+          nWraps++;
+        pLast = msg.mData;
+        queue.Remove();
+        ref.pop_front();
+      }
+    }
+  }
+
+  // drain what's left
+  ISysEx msg;
+  while (queue.Peek(msg))
+  {
+    errors += ref.empty() || !Matches(msg, ref.front());
+    if (!ref.empty()) ref.pop_front();
+    queue.Remove();
+  }
+  errors += !ref.empty() || !queue.WasEmpty();
+  return errors;
+}
+
+static int CheckOverflow()
+{
+  int errors = 0;
+  IPlugSysExQueue queue(1024);
+  uint8_t data[2048];
+  for (auto i = 0; i < 2048; i++)
+    data[i] = (uint8_t) i;
+
+  for (auto round = 0; round < 3; round++)
+  {
+    // fill it, with the records starting at a different place each round
+    int nPushed = 0;
+    while (queue.Push(ISysEx(nPushed, data + nPushed % 7, 100)))
+      nPushed++;
+
+    errors += nPushed < 10; // twice the largest message, so at least 10 of 100 bytes
+
+    ISysEx msg;
+    for (auto i = 0; i < nPushed; i++)
+    {
+      if (!queue.Peek(msg) || msg.mOffset != i || msg.mSize != 100 || memcmp(msg.mData, data + i % 7, 100))
+        errors++;
+      queue.Remove();
+    }
+    errors += queue.Peek(msg);
+
+    // a message of the largest size fits again, wherever the indices are
+    errors += !queue.Push(ISysEx(0, data, queue.MaxMessageSize()));
+    errors += !queue.Peek(msg) || msg.mSize != queue.MaxMessageSize();
+    queue.Remove();
+    errors += !queue.Push(ISysEx(0, data, 20 * (round + 1)));
+    queue.Remove();
+  }
+
+  return errors;
+}
+
+static int CheckOversized()
+{
+  int errors = 0;
+  IPlugSysExQueue queue(1000);
+  std::vector<uint8_t> data(4096, 0x55);
+  ISysEx msg;
+
+  errors += queue.MaxMessageSize() != 1000;
+
+  // larger than the queue accepts, though the empty buffer would have room for it
+  errors += queue.Push(ISysEx(0, data.data(), 1001));
+  errors += queue.Push(ISysEx(0, data.data(), 1900));
+  errors += queue.Peek(msg);
+
+  // the same, in pieces: the Append() that goes over fails and discards the message
+  queue.Begin();
+  errors += !queue.Append(data.data(), 600);
+  errors += queue.Append(data.data(), 401);
+  errors += queue.IsWriting() || queue.Commit();
+  errors += queue.Peek(msg);
+
+  // exactly the largest is fine, both ways
+  errors += !queue.Push(ISysEx(1, data.data(), 1000));
+  errors += !queue.Peek(msg) || msg.mSize != 1000 || msg.mOffset != 1;
+  queue.Remove();
+  queue.Begin(2);
+  errors += !queue.Append(data.data(), 500) || !queue.Append(data.data(), 500) || !queue.Commit();
+  errors += !queue.Peek(msg) || msg.mSize != 1000 || msg.mOffset != 2;
+  queue.Remove();
+
+  return errors;
+}
+
+/** IPlugVST3ProcessorBase::ProcessMidiOut()'s SysEx loop, with the events it would send to the host */
+static void SendSysEx(IPlugSysExQueue& sysExQueue, WDL_TypedBuf<uint8_t>& outputBuf, std::vector<int>& sentSizes)
+{
+  ISysEx msg;
+  int pos = 0;
+
+  while (sysExQueue.Peek(msg))
+  {
+    if (msg.mSize > outputBuf.GetSize())
+    {
+      sysExQueue.Remove(); // can never be sent, so don't let it hold up the rest
+      continue;
+    }
+
+    if (pos + msg.mSize > outputBuf.GetSize())
+      break; // send the rest next block
+
+    memcpy(outputBuf.Get() + pos, msg.mData, msg.mSize);
+    pos += msg.mSize;
+    sentSizes.push_back(msg.mSize);
+    sysExQueue.Remove();
+  }
+}
+
+static int CheckConsumer()
+{
+  int errors = 0;
+  std::vector<uint8_t> data(8192, 0xF0);
+
+  // the queue and the output buffer the same size, as in IPlugVST3ProcessorBase: everything the queue takes gets sent
+  {
+    IPlugSysExQueue queue(4096);
+    WDL_TypedBuf<uint8_t> outputBuf;
+    outputBuf.Resize(4096);
+    std::vector<int> sent;
+
+    for (int size : {4096, 4097, 8000, 100, 3000, 2000})
+    {
+      queue.Push(ISysEx(0, data.data(), size));
+      SendSysEx(queue, outputBuf, sent);
+    }
+
+    errors += sent != std::vector<int>({4096, 100, 3000, 2000});
+  }
+
+  // a queue that accepts more than the output buffer can hold: the large message is dropped, the rest are sent
+  {
+    IPlugSysExQueue queue(4096);
+    WDL_TypedBuf<uint8_t> outputBuf;
+    outputBuf.Resize(1024);
+    std::vector<int> sent;
+
+    for (int size : {200, 3000, 300, 1024})
+      queue.Push(ISysEx(0, data.data(), size));
+
+    for (auto block = 0; block < 4; block++)
+      SendSysEx(queue, outputBuf, sent);
+
+    errors += sent != std::vector<int>({200, 300, 1024}) || !queue.WasEmpty();
+  }
+
+  return errors;
+}
+
+/** times nMsgs messages of sizes from minSize to maxSize, from a producer thread to a consumer thread */
+template <class PushFunc, class PopFunc>
+static double TimeThroughput(int nMsgs, int minSize, int maxSize, PushFunc push, PopFunc pop, int& errors)
+{
+  std::vector<uint8_t> data(maxSize);
+  for (auto i = 0; i < maxSize; i++)
+    data[i] = (uint8_t) (i * 7);
+
+  std::vector<int> sizes(nMsgs);
+  for (auto& s : sizes)
+    s = minSize + (int) (Rand() % (maxSize - minSize + 1));
+
+  std::atomic<bool> started{false};
+  const double start = Now();
+
+  std::thread consumer([&]() {
+    started = true;
+    for (auto i = 0; i < nMsgs; )
+    {
+      int size = 0, offset = 0;
+      if (pop(size, offset))
+      {
+        errors += size != sizes[i] || offset != i % 1000;
+        i++;
+      }
+      else
+        std::this_thread::yield();
+    }
+  });
+
+  while (!started)
+    std::this_thread::yield();
+
+  for (auto i = 0; i < nMsgs; )
+  {
+    if (push(data.data(), sizes[i], i % 1000))
+      i++;
+    else
+      std::this_thread::yield();
+  }
+
+  consumer.join();
+  return Now() - start;
+}
+
+int main(int argc, char** argv)
+{
+  const int nOps = argc > 1 ? std::max(1, atoi(argv[1])) : 1000000;
+  const int nMsgs = argc > 2 ? std::max(1, atoi(argv[2])) : 200000;
+
+  int errors = 0;
+
+  for (int maxSize : {64, 1000, SYSEX_TRANSFER_SIZE})
+  {
+    int nWraps = 0;
+    const int e = CheckRandom(maxSize, nOps, nWraps);
+    printf("random pushes, pieces and removals, largest message %5d: %s (%d wraps)\n", maxSize, e || nWraps < 10 ? "FAILED" : "match", nWraps);
+    errors += e + (nWraps < 10);
+  }
+
+  int e = CheckOverflow();
+  printf("filling until it overflows and draining: %s\n", e ? "FAILED" : "as expected");
+  errors += e;
+
+  e = CheckOversized();
+  printf("messages larger than MaxMessageSize(): %s\n", e ? "FAILED" : "rejected");
+  errors += e;
+
+  e = CheckConsumer();
+  printf("VST3 consumer loop with messages that don't fit its buffer: %s\n", e ? "FAILED" : "as expected");
+  errors += e;
+
+  printf("\n%d messages from one thread to another:\n", nMsgs);
+  printf("  %-32s %12s %12s\n", "", "msgs/s", "MB/s");
+
+  auto report = [&](const char* name, int minSize, int maxSize, double secs) {
+    const double bytes = nMsgs * (minSize + maxSize) * 0.5;
+    printf("  %-32s %12.0f %12.1f\n", name, nMsgs / secs, bytes / secs / 1e6);
+  };
+
+  // as it was: 4 slots of SysExData, each push and pop copying the whole struct
+  {
+    IPlugQueue<SysExData> oldQueue(4);
+    SysExData popped;
+    const double secs = TimeThroughput(nMsgs, 3, 256,
+      [&](const uint8_t* pData, int size, int offset) { return oldQueue.Push(SysExData(offset, size, pData)); },
+      [&](int& size, int& offset) {
+        if (!oldQueue.Pop(popped)) return false;
+        size = popped.mSize; offset = popped.mOffset;
+        return true;
+      }, errors);
+    report("IPlugQueue<SysExData>, 3-256", 3, 256, secs);
+  }
+
+  for (auto sizes : {std::make_pair(3, 256), std::make_pair(256, 4096), std::make_pair(4096, 32768)})
+  {
+    IPlugSysExQueue queue(SYSEX_TRANSFER_SIZE);
+    const int n = sizes.second > 4096 ? nMsgs / 20 : nMsgs;
+    const double secs = TimeThroughput(n, sizes.first, sizes.second,
+      [&](const uint8_t* pData, int size, int offset) { return queue.Push(ISysEx(offset, pData, size)); },
+      [&](int& size, int& offset) {
+        ISysEx msg;
+        if (!queue.Peek(msg)) return false;
+        size = msg.mSize; offset = msg.mOffset;
+        queue.Remove();
+        return true;
+      }, errors);
+
+    char name[64];
+    snprintf(name, sizeof(name), "IPlugSysExQueue, %d-%d", sizes.first, sizes.second);
+    const double bytes = n * (sizes.first + sizes.second) * 0.5;
+    printf("  %-32s %12.0f %12.1f\n", name, n / secs, bytes / secs / 1e6);
+  }
+
+  printf("\n%s\n", errors ? "FAILED" : "all checks passed");
+  return errors ? 1 : 0;
+}
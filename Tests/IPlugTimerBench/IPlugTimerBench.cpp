@@ -0,0 +1,170 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugTimerBench: simulates many plug-in instances, each with an idle timer, and reports how often the
+ * process is woken up with one platform timer per instance compared to the shared idle timer (Timer::CreateShared()),
+ * letting inactive instances back off to a longer interval.
+ * It then makes one instance's idle call block, and checks that other threads can still create and stop shared timers.
+ *
+ * usage: IPlugTimerBench [instances (100)] [active instances (0)] [seconds (3)] [longest interval when inactive, ms (IDLE_TIMER_MAX_RATE)]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "IPlugConstants.h"
+#include "IPlugTimer.h"
+
+#if defined OS_WIN
+#include <windows.h>
+#endif
+
+using namespace iplug;
+
+static std::atomic<uint64_t> sWakeups {0};
+static std::atomic<uint64_t> sCalls {0};
+
+/** Run the platform's event loop (if the timers need one) for a number of seconds */
+static void RunFor(double seconds)
+{
+#if defined OS_MAC
+  CFRunLoopRunInMode(kCFRunLoopDefaultMode, seconds, false);
+#elif defined OS_WIN
+  const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+  while (std::chrono::steady_clock::now() < end)
+  {
+    MSG msg;
+    while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+      DispatchMessage(&msg);
+    Sleep(1);
+  }
+#else
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+#endif
+}
+
+/** A stand-in for an IPlugAPIBase instance: active instances have an open UI or pending data */
+struct Instance
+{
+  std::atomic<bool> mActive {false};
+  std::unique_ptr<Timer> mTimer;
+};
+
+static void Report(const char* name, double seconds, int nInstances)
+{
+  const double wakeups = sWakeups.load() / seconds;
+  const double calls = sCalls.load() / seconds;
+  printf("%-10s %8.1f wakeups/s %10.1f instance calls/s %8.2f calls/s per instance\n", name, wakeups, calls, calls / nInstances);
+}
+
+int main(int argc, const char* argv[])
+{
+  int nInstances = 100;
+  int nActive = 0;
+  double seconds = 3.;
+  int maxIntervalMs = IDLE_TIMER_MAX_RATE;
+
+  if (argc > 1 && (argv[1][0] == '-' || atoi(argv[1]) <= 0))
+  {
+    printf("usage: IPlugTimerBench [instances (100)] [active instances (0)] [seconds (3)] [longest interval when inactive, ms (%d)]\n", IDLE_TIMER_MAX_RATE);
+    return 2;
+  }
+
+  if (argc > 1) nInstances = atoi(argv[1]);
+  if (argc > 2) nActive = atoi(argv[2]);
+  if (argc > 3) seconds = atof(argv[3]);
+  if (argc > 4) maxIntervalMs = std::max(IDLE_TIMER_RATE, atoi(argv[4]));
+
+  printf("%d instances, %d active, %g s each, IDLE_TIMER_RATE %d ms, longest interval when inactive %d ms\n", nInstances, nActive, seconds, IDLE_TIMER_RATE, maxIntervalMs);
+
+  std::vector<Instance> instances(nInstances);
+
+  for (int i = 0; i < nActive && i < nInstances; i++)
+    instances[i].mActive = true;
+
+  // one platform timer per instance, as before
+  sWakeups = 0;
+  sCalls = 0;
+
+  for (auto& instance : instances)
+    instance.mTimer = std::unique_ptr<Timer>(Timer::Create([](Timer& t) { sWakeups++; sCalls++; }, IDLE_TIMER_RATE));
+
+  RunFor(seconds);
+
+  for (auto& instance : instances)
+    instance.mTimer = nullptr;
+
+  Report("separate", seconds, nInstances);
+
+  // one shared timer
+  sCalls = 0;
+  const uint64_t wakeupsBefore = Timer::GetSharedTimerWakeups();
+
+  for (auto& instance : instances)
+  {
+    Instance* pInstance = &instance;
+    instance.mTimer = std::unique_ptr<Timer>(Timer::CreateShared([](Timer& t) { sCalls++; },
+                                                                 [pInstance]() { return pInstance->mActive.load(); },
+                                                                 IDLE_TIMER_RATE, maxIntervalMs));
+  }
+
+  RunFor(seconds);
+
+  sWakeups = Timer::GetSharedTimerWakeups() - wakeupsBefore;
+
+  for (auto& instance : instances)
+    instance.mTimer = nullptr;
+
+  Report("shared", seconds, nInstances);
+
+  // one instance's idle call blocks for a while, another thread keeps creating and stopping timers (as a host that
+  // creates plug-ins off the main thread would). The clients' functions are called without the shared timer's lock held,
+  // so that shouldn't have to wait for the blocked call
+  const int kBlockMs = 200;
+  std::atomic<int> nBlockingCalls {0};
+  std::unique_ptr<Timer> blockingTimer(Timer::CreateShared([&](Timer& t) {
+    nBlockingCalls++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(kBlockMs));
+  }, nullptr, IDLE_TIMER_RATE, maxIntervalMs));
+
+  std::atomic<bool> done {false};
+  double longestMs = 0.;
+  int nCreated = 0;
+
+  std::thread other([&]() {
+    while (!done)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      std::unique_ptr<Timer> timer(Timer::CreateShared([](Timer& t) {}, nullptr, IDLE_TIMER_RATE, maxIntervalMs));
+      timer = nullptr;
+      longestMs = std::max(longestMs, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+      nCreated++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  });
+
+  RunFor(1.);
+  done = true;
+  other.join();
+  blockingTimer = nullptr;
+
+  const bool blocked = nBlockingCalls == 0 || longestMs >= kBlockMs / 2;
+  printf("an idle call blocking for %d ms: %d timers created and stopped on another thread, longest %.2f ms: %s\n",
+         kBlockMs, nCreated, longestMs, blocked ? "FAILED" : "ok");
+
+  return blocked ? 1 : 0;
+}
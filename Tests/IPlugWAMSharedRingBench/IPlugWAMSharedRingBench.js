@@ -0,0 +1,458 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugWAMSharedRingBench: runs the WAM controller's message rings (IPlug/WEB/Template/scripts/IPlugWAM-awn.js) in node,
+ * with stand-ins for WAMController and the UI's Module:
+ *  - checks that the JavaScript ring and IPlugWAMSharedRing (through IPlugWAMSharedRingTool, if its path is given) read each
+ *    other's messages, where the positions wrap past 2^32 and the messages wrap around the end of the data
+ *  - checks that the controller attaches to the rings it is sent, hands the processor's messages to Module when the UI
+ *    ticks or before a message it posted when the ring was full, pushes parameter changes and messages from the UI, and posts
+ *    them when it isn't attached or a ring is full
+ *  - passes messages both ways between the controller and the real WAM processor (IPlug/WEB/IPlugWAM.cpp, built natively into
+ *    IPlugWAMSharedRingTool), moving the rings' memory between them as their shared heap would, and checks what each receives
+ *  - runs a processor thread at the audio rate (128 frame quanta at 48kHz) sending events to the main thread, which handles
+ *    them every 16ms, once with a postMessage() for each event as now and once through a ring, and prints the time each
+ *    side spends per quantum and per event
+ *
+ * usage: node IPlugWAMSharedRingBench.js [path to IPlugWAMSharedRingTool] [events per quantum (16)] [seconds per run (2)]
+ */
+
+"use strict";
+
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const vm = require("vm");
+const { execFileSync } = require("child_process");
+const { Worker, isMainThread, parentPort, workerData } = require("worker_threads");
+
+const kQuantumFrames = 128;
+const kSampleRate = 48000;
+const kUIPeriodMs = 16;
+
+/** loads the controller script, with NAME_PLACEHOLDER replaced and the given globals */
+function LoadController(globals) {
+  const src = fs.readFileSync(path.join(__dirname, "../../IPlug/WEB/Template/scripts/IPlugWAM-awn.js"), "utf8")
+    .replace(/NAME_PLACEHOLDER/g, "Test");
+  // the typed arrays are the caller's, so that instanceof works on the buffers it passes in
+  const context = vm.createContext(Object.assign({ console, ArrayBuffer, SharedArrayBuffer, Uint8Array, Uint32Array,
+                                                   DataView, Atomics }, globals));
+  return vm.runInContext(src + "\n;({ IPlugWAMSharedRing, TestController });", context);
+}
+
+function Now() { return Number(process.hrtime.bigint()) / 1e9; }
+
+let sSeed = 1;
+function Rand() {
+  sSeed = (Math.imul(sSeed, 1664525) + 1013904223) >>> 0;
+  return sSeed >>> 8;
+}
+
+/** the sequence of messages, IPlugWAMSharedRingTool has the same one */
+function NextMsg() {
+  const type = 1 + (Rand() % 19);
+  const bytes = new Uint8Array(Rand() % 61);
+  for (let i = 0; i < bytes.length; i++)
+    bytes[i] = Rand() & 255;
+  return { type, bytes };
+}
+
+const kToolCapacity = 256;
+const kStartPos = 0xFFFFFF80;
+
+function Same(a, b) {
+  return a.length == b.length && a.every((x, i) => x == b[i]);
+}
+
+function CheckInterop(Ring, toolPath) {
+  let errors = 0;
+  const file = path.join(os.tmpdir(), "IPlugWAMSharedRingBench-" + process.pid + ".bin");
+
+  for (let seed = 1; seed <= 20; seed++) {
+    // C++ to JavaScript
+    const count = parseInt(execFileSync(toolPath, ["write", file, String(seed)]).toString());
+    const memory = fs.readFileSync(file);
+    const buffer = new SharedArrayBuffer(memory.length);
+    new Uint8Array(buffer).set(memory);
+
+    sSeed = seed;
+    let nRead = 0;
+    const nMsgs = new Ring(buffer, 0).drain((type, bytes) => {
+      const msg = NextMsg();
+      errors += type != msg.type || !Same(bytes, msg.bytes);
+      nRead++;
+    });
+    errors += nMsgs != count || nRead != count || count < 2;
+
+    // JavaScript to C++
+    const outBuffer = new SharedArrayBuffer(16 + kToolCapacity);
+    const header = new Uint32Array(outBuffer, 0, 4);
+    header[0] = header[1] = kStartPos;
+    header[2] = kToolCapacity;
+    const ring = new Ring(outBuffer, 0);
+
+    sSeed = seed;
+    let nPushed = 0;
+    while (true) {
+      const seedBefore = sSeed;
+      const msg = NextMsg();
+      if (!ring.push(msg.type, msg.bytes)) {
+        sSeed = seedBefore;
+        break;
+      }
+      nPushed++;
+    }
+    fs.writeFileSync(file, new Uint8Array(outBuffer));
+    try {
+      execFileSync(toolPath, ["read", file, String(seed), String(nPushed)]);
+    }
+    catch (e) {
+      errors++;
+    }
+  }
+
+  fs.unlinkSync(file);
+  return errors;
+}
+
+/** the processor's side of a ring, as IPlugWAMSharedRing's constructor sets it up */
+function MakeRing(heap, byteOffset, capacity) {
+  new Uint32Array(heap, byteOffset, 4).set([0, 0, capacity, 0]);
+}
+
+function CheckController() {
+  let errors = 0;
+  const calls = [];
+  const Module = {
+    HEAPU8: new Uint8Array(4096),
+    _malloc(size) { return 1024; },
+    _free(ptr) {},
+    SPVFD(paramIdx, value) { calls.push(["SPVFD", paramIdx, value]); },
+    SCVFD(ctrlTag, value) { calls.push(["SCVFD", ctrlTag, value]); },
+    SCMFD(ctrlTag, msgTag, size, ptr) { calls.push(["SCMFD", ctrlTag, msgTag, Array.from(Module.HEAPU8.subarray(ptr, ptr + size))]); },
+    SAMFD(msgTag, size, ptr) { calls.push(["SAMFD", msgTag, Array.from(Module.HEAPU8.subarray(ptr, ptr + size))]); },
+    SMMFD(status, data1, data2) { calls.push(["SMMFD", status, data1, data2]); },
+    SSMFD(size, ptr) { calls.push(["SSMFD", Array.from(Module.HEAPU8.subarray(ptr, ptr + size))]); }
+  };
+  const posted = [];
+  class WAMController {
+    constructor(actx, name, options) {}
+    setParam(key, value) { posted.push(["setParam", key, value]); }
+    sendMessage(verb, prop, data) { posted.push([verb, prop, data]); }
+  }
+
+  const { IPlugWAMSharedRing: Ring, TestController } = LoadController({ Module, WAMController });
+  const expect = (what, ok) => { if (!ok) { console.log("  FAILED: " + what); errors++; } };
+
+  const heap = new SharedArrayBuffer(65536);
+  const kToUI = 1024, kFromUI = 8192;
+  MakeRing(heap, kToUI, 1024);
+  MakeRing(heap, kFromUI, 64);
+
+  // not attached: everything is posted
+  const controller = new TestController({}, { processorOptions: {} });
+  controller.setParam(3, 0.5);
+  controller.sendMessage("SMMFUI", "144:60:100", "");
+  expect("posts before it attaches", posted.length == 2 && posted[0][0] == "setParam" && posted[1][0] == "SMMFUI");
+  posted.length = 0;
+
+  // the processor says where the rings are and sends its heap, in either order
+  controller.onmessage({ verb: "SharedRings", prop: kToUI + ":" + kFromUI });
+  expect("waits for the heap", !new Ring(heap, kToUI).isAttached());
+  controller.onmessage({ type: "sharedMemory", buffer: heap });
+  expect("attaches to both rings", new Ring(heap, kToUI).isAttached() && new Ring(heap, kFromUI).isAttached());
+
+  // a controller given rings that aren't in the heap doesn't attach
+  const other = new TestController({}, { processorOptions: {} });
+  other.onmessage({ type: "sharedMemory", buffer: heap });
+  const log = console.log;
+  console.log = () => {};
+  other.onmessage({ verb: "SharedRings", prop: "65000:7" });
+  console.log = log;
+  expect("doesn't attach to rings outside the heap", other.ringToUI === null);
+
+  // from the processor: IPlugWAM::SendParameterValueFromDelegate() etc.
+  const toUI = new Ring(heap, kToUI);
+  const msg = (...parts) => {
+    const bytes = [];
+    for (const [kind, value] of parts) {
+      const view = new DataView(new ArrayBuffer(8));
+      if (kind == "i") { view.setInt32(0, value, true); bytes.push(...new Uint8Array(view.buffer, 0, 4)); }
+      else if (kind == "d") { view.setFloat64(0, value, true); bytes.push(...new Uint8Array(view.buffer, 0, 8)); }
+      else bytes.push(...value);
+    }
+    return new Uint8Array(bytes);
+  };
+  toUI.push(Ring.kSPVFD, msg(["i", 7], ["d", -12.5]));
+  toUI.push(Ring.kSCVFD, msg(["i", 2], ["d", 0.25]));
+  toUI.push(Ring.kSCMFD, msg(["i", 4], ["i", 9], ["b", [1, 2, 3]]));
+  toUI.push(Ring.kSAMFD, msg(["i", 11], ["b", [5, 6, 7, 8, 9]]));
+  toUI.push(Ring.kSMMFD, msg(["b", [144, 60, 100]]));
+  toUI.push(Ring.kSSMFD, msg(["b", [0xF0, 1, 2, 0xF7]]));
+  expect("doesn't hand messages over before the UI ticks", calls.length == 0);
+
+  controller.sendMessage("TICK", "", "");
+  expect("hands the processor's messages to the UI", JSON.stringify(calls) == JSON.stringify([
+    ["SPVFD", 7, -12.5], ["SCVFD", 2, 0.25], ["SCMFD", 4, 9, [1, 2, 3]], ["SAMFD", 11, [5, 6, 7, 8, 9]],
+    ["SMMFD", 144, 60, 100], ["SSMFD", [0xF0, 1, 2, 0xF7]]]));
+  expect("still posts TICK", posted.length == 1 && posted[0][0] == "TICK");
+  posted.length = 0;
+
+  // what the processor posts when the ring is full comes after what is in the ring, without waiting for a tick
+  calls.length = 0;
+  toUI.push(Ring.kSPVFD, msg(["i", 1], ["d", 0.5]));
+  toUI.push(Ring.kSMMFD, msg(["b", [128, 60, 0]]));
+  controller.onmessage({ type: "msg", verb: "SPVFD", prop: "1", data: "0.750000" });
+  controller.onmessage({ type: "msg", verb: "SMMFD", prop: "144:62:90" });
+  expect("handles the ring before a posted message", JSON.stringify(calls) == JSON.stringify([
+    ["SPVFD", 1, 0.5], ["SMMFD", 128, 60, 0], ["SPVFD", 1, 0.75], ["SMMFD", 144, 62, 90]]));
+  calls.length = 0;
+
+  // from the UI: pushed for IPlugWAM::ProcessMsgsFromUI()
+  const fromUI = new Ring(heap, kFromUI);
+  const received = [];
+  const drainFromUI = () => fromUI.drain((type, bytes) => received.push([type, Array.from(bytes)]));
+  controller.setParam(5, 0.75);
+  controller.sendMessage("SMMFUI", "176:1:64", "");
+  drainFromUI();
+  expect("pushes parameter changes and MIDI", JSON.stringify(received) == JSON.stringify([
+    [Ring.kSPVFUI, Array.from(msg(["i", 5], ["d", 0.75]))], [Ring.kSMMFUI, [176, 1, 64]]]) && posted.length == 0);
+  received.length = 0;
+
+  const samfui = msg(["i", 1], ["i", 2], ["i", 3], ["b", [10, 20, 30]]);
+  controller.sendMessage("SAMFUI", "", samfui.buffer);
+  drainFromUI();
+  expect("pushes arbitrary messages", received.length == 1 && received[0][0] == Ring.kSAMFUI && Same(received[0][1], samfui));
+  received.length = 0;
+
+  // a full ring: the rest are posted, in order after what is in the ring
+  for (let i = 0; i < 6; i++)
+    controller.setParam(i, i * 0.1);
+  drainFromUI();
+  expect("posts when the ring is full", received.length == 3 && posted.length == 3 && posted[0][1] == 3);
+
+  return errors;
+}
+
+function CheckProcessor(toolPath) {
+  let errors = 0;
+  const calls = [];
+  const Module = {
+    HEAPU8: new Uint8Array(1 << 16),
+    _malloc(size) { return 0; },
+    _free(ptr) {},
+    SPVFD(paramIdx, value) { calls.push(["SPVFD", paramIdx, value]); },
+    SCVFD(ctrlTag, value) { calls.push(["SCVFD", ctrlTag, value]); },
+    SCMFD(ctrlTag, msgTag, size, ptr) { calls.push(["SCMFD", ctrlTag, msgTag, Array.from(Module.HEAPU8.subarray(ptr, ptr + size))]); },
+    SAMFD(msgTag, size, ptr) { calls.push(["SAMFD", msgTag, size, Module.HEAPU8[ptr + size - 1]]); },
+    SMMFD(status, data1, data2) { calls.push(["SMMFD", status, data1, data2]); },
+    SSMFD(size, ptr) { calls.push(["SSMFD", Array.from(Module.HEAPU8.subarray(ptr, ptr + size))]); }
+  };
+  const posted = [];
+  class WAMController {
+    constructor(actx, name, options) {}
+    setParam(key, value) { posted.push(["setParam", key, value]); }
+    sendMessage(verb, prop, data) { posted.push([verb, prop, data]); }
+  }
+
+  const { TestController } = LoadController({ Module, WAMController });
+  const expect = (what, ok) => { if (!ok) { console.log("  FAILED: " + what); errors++; } };
+
+  // the processor's rings are 65536 bytes, IPlugWAMSharedRing's default
+  const kCapacity = 65536, kRingSize = 16 + kCapacity;
+  const kToUI = 1024, kFromUI = kToUI + kRingSize;
+  const heap = new SharedArrayBuffer(kFromUI + kRingSize);
+  MakeRing(heap, kToUI, kCapacity);
+  MakeRing(heap, kFromUI, kCapacity);
+
+  const controller = new TestController({}, { processorOptions: {} });
+  controller.onmessage({ verb: "SharedRings", prop: kToUI + ":" + kFromUI });
+  controller.onmessage({ type: "sharedMemory", buffer: heap });
+
+  // from the UI
+  controller.setParam(0, 0.25);
+  controller.sendMessage("SMMFUI", "144:60:100", "");
+  const samfui = new DataView(new ArrayBuffer(15));
+  samfui.setInt32(0, 5, true);
+  samfui.setInt32(4, -1, true);
+  samfui.setInt32(8, 3, true);
+  [1, 2, 3].forEach((b, i) => samfui.setUint8(12 + i, b));
+  controller.sendMessage("SAMFUI", "", samfui.buffer);
+  expect("pushes from the UI rather than posting", posted.length == 0);
+
+  const fromUIFile = path.join(os.tmpdir(), "IPlugWAMSharedRingBench-" + process.pid + "-fromUI.bin");
+  const toUIFile = path.join(os.tmpdir(), "IPlugWAMSharedRingBench-" + process.pid + "-toUI.bin");
+  fs.writeFileSync(fromUIFile, new Uint8Array(heap, kFromUI, kRingSize));
+
+  let lines = [];
+  try {
+    lines = execFileSync(toolPath, ["processor", fromUIFile, toUIFile], { maxBuffer: 1 << 24 }).toString().trim().split("\n").map(l => JSON.parse(l));
+    new Uint8Array(heap, kToUI, kRingSize).set(fs.readFileSync(toUIFile));
+  }
+  catch (e) {
+    console.log("  FAILED: running the processor: " + e.message);
+    errors++;
+  }
+  for (const file of [fromUIFile, toUIFile]) {
+    if (fs.existsSync(file))
+      fs.unlinkSync(file);
+  }
+
+  // what the plug-in received, the parameter values at construction come first
+  const received = lines.filter(l => l[0] != "posted").slice(2);
+  expect("the processor handles the UI's messages, then processes", JSON.stringify(received) == JSON.stringify([
+    ["param", 0, 25], ["midi", 144, 60, 100], ["message", 5, -1, [1, 2, 3]], ["block", 128, 0.125],
+    ["midi", 144, 64, 90], ["sysex", [0xF0, 0x7D, 0x01, 0xF7]]]));
+
+  // it posts its rings at init, and afterwards only what doesn't fit
+  const processorPosted = lines.filter(l => l[0] == "posted");
+  expect("the processor posts where its rings are", processorPosted.length == 3 && processorPosted[1][1] == "SharedRings"
+         && /^[0-9]+:[0-9]+$/.test(processorPosted[1][2]));
+  expect("the processor posts the message that doesn't fit", processorPosted.length == 3 && processorPosted[2][1] == "SAMFD"
+         && processorPosted[2][2] == "78" && processorPosted[2][3].length == kCapacity * 5 / 8);
+
+  // the posted message arrives before the UI ticks, and the controller hands over what is in the ring first
+  for (const [, verb, prop, bytes] of processorPosted.slice(2))
+    controller.onmessage({ type: "msg", verb, prop, data: new Uint8Array(bytes).buffer });
+  controller.sendMessage("TICK", "", "");
+  const large = kCapacity * 5 / 8;
+  expect("hands the processor's messages to the UI, in order", JSON.stringify(calls) == JSON.stringify([
+    ["SAMFD", 105, 3, 3], ["SMMFD", 144, 64, 90], ["SSMFD", [0xF0, 0x7D, 0x01, 0xF7]], ["SCVFD", 3, 0.125], ["SCMFD", 4, 9, [7, 8, 9]],
+    ["SPVFD", 1, 0.5], ["SAMFD", 77, large, (large - 1) & 255], ["SAMFD", 78, large, (large - 1) & 255]]));
+
+  return errors;
+}
+
+/** the processor thread for the benchmark: a quantum of audio every 128 frames, each sending some events to the main thread */
+function RunProcessor() {
+  const { mode, heap, eventsPerQuantum, seconds } = workerData;
+  const { IPlugWAMSharedRing: Ring } = LoadController({ Module: {}, WAMController: class {} });
+  const ring = mode == "ring" ? new Ring(heap, 0) : null;
+  const sleeper = new Int32Array(new SharedArrayBuffer(4));
+  const payload = new DataView(new ArrayBuffer(12));
+  const payloadBytes = new Uint8Array(payload.buffer);
+  const quantumSecs = kQuantumFrames / kSampleRate;
+  const nQuanta = Math.round(seconds / quantumSecs);
+  const times = new Float64Array(nQuanta);
+  let nFull = 0;
+
+  const start = Now();
+  for (let q = 0; q < nQuanta; q++) {
+    const wait = (start + q * quantumSecs - Now()) * 1000;
+    if (wait > 0)
+      Atomics.wait(sleeper, 0, 0, wait);
+
+    const t = Now();
+    for (let e = 0; e < eventsPerQuantum; e++) {
+      const value = (q % 1000) * 0.001;
+      if (ring) {
+        payload.setInt32(0, e, true);
+        payload.setFloat64(4, value, true);
+        if (!ring.push(Ring.kSPVFD, payloadBytes))
+          nFull++;
+      }
+      else {
+        // as IPlugWAM::SendParameterValueFromDelegate() posts it
+        parentPort.postMessage({ type: "msg", verb: "SPVFD", prop: String(e), data: value.toFixed(6) });
+      }
+    }
+    times[q] = Now() - t;
+  }
+
+  parentPort.postMessage({ type: "done", times, nFull });
+}
+
+function RunBenchmark(Ring, mode, eventsPerQuantum, seconds) {
+  return new Promise((resolve) => {
+    const capacity = 1 << 18;
+    const heap = new SharedArrayBuffer(16 + capacity);
+    MakeRing(heap, 0, capacity);
+    const ring = new Ring(heap, 0);
+    let handled = 0, handleTime = 0, sum = 0;
+
+    const handle = (paramIdx, value) => { sum += paramIdx + value; handled++; };
+    const drain = () => {
+      const t = Now();
+      ring.drain((type, bytes) => {
+        const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.length);
+        handle(view.getInt32(0, true), view.getFloat64(4, true));
+      });
+      handleTime += Now() - t;
+    };
+    const timer = mode == "ring" ? setInterval(drain, kUIPeriodMs) : null;
+
+    const worker = new Worker(__filename, { workerData: { mode, heap, eventsPerQuantum, seconds } });
+    worker.on("message", (msg) => {
+      if (msg.type == "msg") {
+        const t = Now();
+        if (msg.verb == "SPVFD")
+          handle(parseInt(msg.prop), parseFloat(msg.data));
+        handleTime += Now() - t;
+      }
+      else if (msg.type == "done") {
+        if (timer)
+          clearInterval(timer);
+        drain();
+        worker.terminate();
+        const times = Array.from(msg.times).sort((a, b) => a - b);
+        const mean = times.reduce((a, b) => a + b, 0) / times.length;
+        resolve({ mean, p99: times[Math.floor(times.length * 0.99)], max: times[times.length - 1],
+                  handled, handleTime, nFull: msg.nFull, sum });
+      }
+    });
+  });
+}
+
+async function Main() {
+  const toolPath = process.argv[2];
+  const eventsPerQuantum = process.argv[3] ? Math.max(1, parseInt(process.argv[3])) : 16;
+  const seconds = process.argv[4] ? Math.max(0.1, parseFloat(process.argv[4])) : 2;
+
+  const { IPlugWAMSharedRing: Ring } = LoadController({ Module: {}, WAMController: class {} });
+  let errors = 0;
+
+  if (toolPath) {
+    const interopErrors = CheckInterop(Ring, toolPath);
+    console.log("messages between IPlugWAMSharedRing and the JavaScript ring: " + (interopErrors ? "FAILED" : "match"));
+    errors += interopErrors;
+
+    const processorErrors = CheckProcessor(toolPath);
+    console.log("messages between the controller and IPlugWAM: " + (processorErrors ? "FAILED" : "as expected"));
+    errors += processorErrors;
+  }
+  else {
+    console.log("no path to IPlugWAMSharedRingTool, not checking the C++ ring or the processor");
+  }
+
+  const controllerErrors = CheckController();
+  console.log("controller attaching, handing over, pushing and posting: " + (controllerErrors ? "FAILED" : "as expected"));
+  errors += controllerErrors;
+
+  console.log("\n" + eventsPerQuantum + " parameter changes per " + kQuantumFrames + " frame quantum at " + kSampleRate + "Hz, to a UI handling them every "
+              + kUIPeriodMs + "ms, " + seconds + "s each:");
+  console.log("  " + "".padEnd(13) + "processor us/quantum (mean, p99, max)".padStart(38) + "UI us/event".padStart(14) + "events".padStart(10));
+  for (const mode of ["postMessage", "ring"]) {
+    const r = await RunBenchmark(Ring, mode, eventsPerQuantum, seconds);
+    const expected = Math.round(seconds * kSampleRate / kQuantumFrames) * eventsPerQuantum;
+    errors += r.handled + r.nFull != expected;
+    console.log("  " + mode.padEnd(13) + (r.mean * 1e6).toFixed(2).padStart(14) + (r.p99 * 1e6).toFixed(2).padStart(12)
+                + (r.max * 1e6).toFixed(2).padStart(12) + (r.handleTime * 1e6 / Math.max(1, r.handled)).toFixed(3).padStart(14)
+                + String(r.handled).padStart(10) + (r.nFull ? " (" + r.nFull + " didn't fit)" : ""));
+  }
+
+  console.log("\n" + (errors ? "FAILED" : "all checks passed"));
+  process.exitCode = errors ? 1 : 0;
+}
+
+if (isMainThread)
+  Main();
+else
+  RunProcessor();
@@ -0,0 +1,292 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * IPlugWAMSharedRingTool: the C++ side of IPlugWAMSharedRingBench.js, which runs it to check that the processor's ring
+ * (IPlugWAMSharedRing) and the controller's JavaScript one read each other's messages:
+ *  - write: fills a ring with a sequence of messages, starting where the positions wrap past 2^32 and the messages wrap
+ *    around the end of the data, and saves its memory
+ *  - read: loads the memory of a ring the script filled and checks its messages against the same sequence
+ *  - processor: runs a plug-in on the real IPlugWAM (IPlug/WEB/IPlugWAM.cpp, built natively against WAMStandIn/processor.h).
+ *    It attaches to the rings whose addresses the processor posts, as the controller does, loads the messages the script's
+ *    controller pushed into the ring from the UI, processes a block, sends messages the other way, and saves the ring to the
+ *    UI. It prints what the plug-in received and what the processor posted, one JSON array per line
+ *  - bench: prints the time to push and drain messages natively
+ *
+ * usage: IPlugWAMSharedRingTool write <file> <seed> | read <file> <seed> <count> | processor <ring from UI> <ring to UI> | bench
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "IPlugWAM.h"
+
+using namespace iplug;
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+static const int kCapacity = 256;
+static const uint32_t kStartPos = 0xFFFFFF80; // 128 bytes before the positions wrap, and half way through the data
+
+/** the sequence of messages, the script has the same one */
+static int NextMsg(std::vector<uint8_t>& data)
+{
+  const int type = 1 + (int) (Rand() % 19);
+  data.resize(Rand() % 61);
+  for (auto& b : data)
+    b = (uint8_t) Rand();
+  return type;
+}
+
+static uint32_t* Header(IPlugWAMSharedRing& ring)
+{
+  // the script reads and writes the memory directly, as the controller does
+  return static_cast<uint32_t*>(const_cast<void*>(ring.GetMemory()));
+}
+
+static int Write(const char* path)
+{
+  IPlugWAMSharedRing ring(kCapacity);
+  Header(ring)[0] = Header(ring)[1] = kStartPos;
+
+  std::vector<uint8_t> data;
+  int count = 0;
+  while (true)
+  {
+    const unsigned int seed = sSeed;
+    const int type = NextMsg(data);
+    // the first part is at most 5 bytes, so headers and payloads are split in different places
+    const int split = (int) std::min<size_t>(data.size(), 5);
+    if (!ring.Push(type, data.data(), split, data.data() + split, (int) data.size() - split))
+    {
+      sSeed = seed;
+      break;
+    }
+    count++;
+  }
+
+  FILE* fp = fopen(path, "wb");
+  if (!fp)
+    return 1;
+  fwrite(ring.GetMemory(), 1, IPlugWAMSharedRing::kHeaderSize + ring.GetCapacity(), fp);
+  fclose(fp);
+  printf("%d\n", count);
+  return 0;
+}
+
+static int Read(const char* path, int count)
+{
+  IPlugWAMSharedRing ring(kCapacity);
+  FILE* fp = fopen(path, "rb");
+  if (!fp)
+    return 1;
+  const size_t n = fread(Header(ring), 1, IPlugWAMSharedRing::kHeaderSize + kCapacity, fp);
+  fclose(fp);
+  if (n != IPlugWAMSharedRing::kHeaderSize + kCapacity)
+    return 1;
+
+  std::vector<uint8_t> data;
+  int errors = 0;
+  const int nMsgs = ring.Drain([&](int type, const uint8_t* pData, int size) {
+    const int expectedType = NextMsg(data);
+    if (type != expectedType || size != (int) data.size() || memcmp(pData, data.data(), size))
+      errors++;
+  });
+
+  errors += nMsgs != count;
+  printf("%d messages, %d errors\n", nMsgs, errors);
+  return errors ? 1 : 0;
+}
+
+/** A plug-in on the WAM API that prints what it receives, and answers each arbitrary message with one tagged 100 higher */
+class WAMTestPlug final : public IPlugWAM
+{
+public:
+  WAMTestPlug()
+  : IPlugWAM(InstanceInfo(), Config(2, 0, "2-2", "WAMTest", "", "", 0x10000, 'Wamt', 'Acme', 0, false, false, false, false, 0, false, 0, 0, false, 0, 0, 0, 0, ""))
+  {
+    GetParam(0)->InitDouble("Gain", 100., 0., 100., 0.01, "%");
+    GetParam(1)->InitDouble("Pan", 0., -1., 1., 0.01);
+  }
+
+  void ProcessBlock(sample** inputs, sample** outputs, int nFrames) override
+  {
+    const double gain = GetParam(0)->Value() / 100.;
+    for (int c = 0; c < NOutChansConnected(); c++)
+    {
+      for (int s = 0; s < nFrames; s++)
+        outputs[c][s] = (sample) (inputs[c][s] * gain);
+    }
+    printf("[\"block\", %d, %g]\n", nFrames, outputs[0][0]);
+    SendParameterValueFromAPI(1, 0.5, false); // as a plug-in with a processor driven parameter would
+  }
+
+  void OnParamChange(int paramIdx) override { printf("[\"param\", %d, %.17g]\n", paramIdx, GetParam(paramIdx)->Value()); }
+  void ProcessMidiMsg(const IMidiMsg& msg) override { printf("[\"midi\", %d, %d, %d]\n", msg.mStatus, msg.mData1, msg.mData2); }
+
+  void ProcessSysEx(ISysEx& msg) override
+  {
+    printf("[\"sysex\", %s]\n", Bytes(msg.mData, msg.mSize).Get());
+  }
+
+  bool OnMessage(int msgTag, int ctrlTag, int dataSize, const void* pData) override
+  {
+    printf("[\"message\", %d, %d, %s]\n", msgTag, ctrlTag, Bytes(pData, dataSize).Get());
+    SendArbitraryMsgFromDelegate(msgTag + 100, dataSize, pData);
+    return true;
+  }
+
+  /** @return The bytes as a JSON array */
+  static WDL_String Bytes(const void* pData, int size)
+  {
+    WDL_String str("[");
+    for (int i = 0; i < size; i++)
+      str.AppendFormatted(8, i ? ", %d" : "%d", static_cast<const uint8_t*>(pData)[i]);
+    str.Append("]");
+    return str;
+  }
+};
+
+static int RunProcessor(const char* fromUIPath, const char* toUIPath)
+{
+  WAMTestPlug plug;
+  uint32_t* pRings[2] = {}; // to and from the UI
+
+  plug.OnPostMessage = [&](const char* verb, const char* res, const std::string& data) {
+    if (!strcmp(verb, "SharedRings"))
+    {
+      unsigned long long addresses[2];
+      if (sscanf(res, "%llu:%llu", &addresses[0], &addresses[1]) == 2)
+      {
+        pRings[0] = reinterpret_cast<uint32_t*>((uintptr_t) addresses[0]);
+        pRings[1] = reinterpret_cast<uint32_t*>((uintptr_t) addresses[1]);
+      }
+    }
+    printf("[\"posted\", \"%s\", \"%s\", %s]\n", verb, res, WAMTestPlug::Bytes(data.data(), (int) data.size()).Get());
+  };
+
+  plug.init(128, 48000, nullptr);
+
+  if (!pRings[0] || !pRings[1])
+  {
+    printf("the processor didn't post its rings\n");
+    return 1;
+  }
+
+  // the controller's side: load what it pushed and set the attached flags (IPlugWAMSharedRing::SetAttached() in JavaScript)
+  const int size = IPlugWAMSharedRing::kHeaderSize + (int) pRings[1][2];
+  std::vector<uint8_t> fromUI(size);
+  FILE* fp = fopen(fromUIPath, "rb");
+  if (!fp || fread(fromUI.data(), 1, size, fp) != (size_t) size || reinterpret_cast<uint32_t*>(fromUI.data())[2] != pRings[1][2])
+  {
+    printf("%s isn't a ring of the processor's size\n", fromUIPath);
+    if (fp) fclose(fp);
+    return 1;
+  }
+  fclose(fp);
+  memcpy(pRings[1], fromUI.data(), size);
+  pRings[0][3] = pRings[1][3] = 1;
+
+  // a quantum, which handles the messages from the UI first
+  std::vector<float> in[2], out[2];
+  float* pIn[2];
+  float* pOut[2];
+  for (int c = 0; c < 2; c++)
+  {
+    in[c].assign(128, 0.5f);
+    out[c].assign(128, 0.f);
+    pIn[c] = in[c].data();
+    pOut[c] = out[c].data();
+  }
+  WAM::AudioBus bus = {pIn, pOut};
+  plug.onProcess(&bus, nullptr);
+
+  // messages to the UI, from the host and the plug-in
+  plug.onMidi(0x90, 64, 90);
+  uint8_t sysex[] = {0xF0, 0x7D, 0x01, 0xF7};
+  plug.onSysex(sysex, sizeof(sysex));
+  plug.SendControlValueFromDelegate(3, 0.125);
+  const uint8_t ctrlMsg[] = {7, 8, 9};
+  plug.SendControlMsgFromDelegate(4, 9, sizeof(ctrlMsg), ctrlMsg);
+  char tick[] = "TICK", empty[] = "";
+  plug.onMessage(tick, empty, 0.);
+
+  // two large messages, the second one doesn't fit in the ring and is posted
+  std::vector<uint8_t> large(pRings[0][2] * 5 / 8);
+  for (size_t i = 0; i < large.size(); i++)
+    large[i] = (uint8_t) i;
+  plug.SendArbitraryMsgFromDelegate(77, (int) large.size(), large.data());
+  plug.SendArbitraryMsgFromDelegate(78, (int) large.size(), large.data());
+
+  fp = fopen(toUIPath, "wb");
+  if (!fp)
+    return 1;
+  fwrite(pRings[0], 1, IPlugWAMSharedRing::kHeaderSize + pRings[0][2], fp);
+  fclose(fp);
+  return 0;
+}
+
+static int Bench()
+{
+  IPlugWAMSharedRing ring;
+  const int nQuanta = 200000, nMsgsPerQuantum = 16;
+  double sum = 0.0;
+
+  const double start = Now();
+  for (auto q = 0; q < nQuanta; q++)
+  {
+    for (auto m = 0; m < nMsgsPerQuantum; m++)
+    {
+      const int paramIdx = m;
+      const double value = q * 0.001;
+      ring.Push(IPlugWAMSharedRing::kSPVFD, &paramIdx, sizeof(int), &value, sizeof(double));
+    }
+    ring.Drain([&](int type, const uint8_t* pData, int size) { sum += pData[size - 1]; });
+  }
+  const double ns = (Now() - start) * 1e9 / ((double) nQuanta * nMsgsPerQuantum);
+
+  printf("%.1f\n", ns);
+  if (sum == 12345.0) printf(" ");
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 3 && !strcmp(argv[1], "write"))
+  {
+    sSeed = (unsigned int) atoi(argv[3]);
+    return Write(argv[2]);
+  }
+  if (argc > 4 && !strcmp(argv[1], "read"))
+  {
+    sSeed = (unsigned int) atoi(argv[3]);
+    return Read(argv[2], atoi(argv[4]));
+  }
+  if (argc > 3 && !strcmp(argv[1], "processor"))
+    return RunProcessor(argv[2], argv[3]);
+  if (argc > 1 && !strcmp(argv[1], "bench"))
+    return Bench();
+
+  printf("usage: IPlugWAMSharedRingTool write <file> <seed> | read <file> <seed> <count> | processor <ring from UI> <ring to UI> | bench\n");
+  return 1;
+}
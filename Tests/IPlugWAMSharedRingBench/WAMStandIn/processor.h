@@ -0,0 +1,72 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/*
+ * A native stand-in for the WAM SDK's wamsdk/processor.h, with the part of WAM::Processor that IPlugWAM uses, so that
+ * IPlugWAMSharedRingTool can build the real IPlugWAM.cpp without the SDK or emscripten. In the SDK, postMessage() goes to
+ * the AudioWorkletProcessor; here it is handed to OnPostMessage, for the tool to record.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace WAM {
+
+typedef unsigned char byte;
+
+struct AudioBus
+{
+  float** inputs;
+  float** outputs;
+};
+
+class Processor
+{
+public:
+  virtual ~Processor() {}
+
+  virtual const char* init(uint32_t bufsize, uint32_t sr, void* pDesc) = 0;
+  virtual void terminate() {}
+  virtual void resize(uint32_t bufsize) {}
+  virtual void onProcess(AudioBus* pAudio, void* pData) = 0;
+  virtual void onMidi(byte status, byte data1, byte data2) {}
+  virtual void onSysex(byte* pData, uint32_t size) {}
+  virtual void onMessage(char* verb, char* res, double data) {}
+  virtual void onMessage(char* verb, char* res, char* data) {}
+  virtual void onMessage(char* verb, char* res, void* pData, uint32_t size) {}
+  virtual void onParam(uint32_t idparam, double value) {}
+
+  /** Called with each posted message: the verb, the resource, and the data as a string or as bytes */
+  std::function<void(const char* verb, const char* res, const std::string& data)> OnPostMessage;
+
+protected:
+  void postMessage(const char* verb, const char* res, const char* data)
+  {
+    if (OnPostMessage)
+      OnPostMessage(verb, res ? res : "", data ? data : "");
+  }
+
+  void postMessage(const char* verb, const char* res, double data)
+  {
+    if (OnPostMessage)
+      OnPostMessage(verb, res ? res : "", std::to_string(data));
+  }
+
+  void postMessage(const char* verb, const char* res, const void* pData, uint32_t size)
+  {
+    if (OnPostMessage)
+      OnPostMessage(verb, res ? res : "", std::string(static_cast<const char*>(pData), size));
+  }
+};
+
+} // namespace WAM
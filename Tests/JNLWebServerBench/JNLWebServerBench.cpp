@@ -0,0 +1,365 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * JNLWebServerBench: runs a WebServerBaseClass on a loopback port and drives it with many concurrent keep-alive
+ * clients (a single epoll client thread), each sending a request as soon as its previous reply is complete. For each of
+ *  - a small page (JNL_StringPageGenerator)
+ *  - a file copied through GetData()
+ *  - a file sent with GetSendFile() (JNL_FilePageGenerator)
+ * it compares the server calling run() in a loop with run_events(), with every client busy and then with 1% of them
+ * busy and the rest idle, and prints requests per second, latency percentiles (the first request of each connection
+ * includes connecting) and the server thread's CPU time per request. Every reply is checked, and the clients count
+ * any connections the server closed.
+ *
+ * usage: JNLWebServerBench [connections (1000)] [seconds per test (2)] [file size in KB (64)]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "jnetlib/jnetlib.h"
+#include "jnetlib/webserver.h"
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double ThreadCPU()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+static const char* kFileName = "/tmp/JNLWebServerBench.dat";
+static const char* kSmallPage = "<html><body>jnetlib web server test page</body></html>";
+static std::vector<unsigned char> sFileData;
+
+enum EPage { kPageSmall, kPageFileCopy, kPageFileSendFile, kNumPages };
+static const char* kPageNames[kNumPages] = { "small page", "file, GetData()", "file, sendfile()" };
+static const char* kPageURLs[kNumPages] = { "/", "/copy", "/file" };
+
+// JNL_FilePageGenerator without GetSendFile(), so the file is copied through the connection's send buffer
+class CopyFilePageGenerator : public IPageGenerator
+{
+public:
+  CopyFilePageGenerator(WDL_FileRead* fr) : mFile(fr) {}
+  virtual ~CopyFilePageGenerator() { delete mFile; }
+  virtual int GetData(char* buf, int size) { return mFile->Read(buf, size); }
+
+private:
+  WDL_FileRead* mFile;
+};
+
+class BenchServer : public WebServerBaseClass
+{
+public:
+  virtual IPageGenerator* onConnection(JNL_HTTPServ* serv, int port)
+  {
+    const char* fn = serv->get_request_file();
+    serv->set_reply_header("Server:JNLWebServerBench");
+    if (fn && (!strcmp(fn, "/file") || !strcmp(fn, "/copy")))
+    {
+      WDL_FileRead* fr = new WDL_FileRead(kFileName);
+      if (fr->IsOpen())
+      {
+        serv->set_reply_string("HTTP/1.1 200 OK");
+        serv->set_reply_header("Content-Type:application/octet-stream");
+        serv->set_reply_size((int) fr->GetSize());
+        serv->send_reply();
+        if (!strcmp(fn, "/copy"))
+          return new CopyFilePageGenerator(fr);
+        return new JNL_FilePageGenerator(fr);
+      }
+      delete fr;
+    }
+    else if (fn && !strcmp(fn, "/"))
+    {
+      JNL_StringPageGenerator* gen = new JNL_StringPageGenerator;
+      gen->str.Set(kSmallPage);
+      serv->set_reply_string("HTTP/1.1 200 OK");
+      serv->set_reply_header("Content-Type:text/html");
+      serv->set_reply_size(gen->str.GetLength());
+      serv->send_reply();
+      return gen;
+    }
+    serv->set_reply_string("HTTP/1.1 404 NOT FOUND");
+    serv->set_reply_size(0);
+    serv->send_reply();
+    return nullptr;
+  }
+};
+
+struct Client
+{
+  int fd = -1;
+  std::vector<char> in;
+  int contentLength = -1, headerLen = 0;
+  double sent = 0.0;
+  size_t reqPos = 0;
+};
+
+struct Result
+{
+  double secs = 0.0, serverCPU = 0.0;
+  std::vector<float> latencies; // ms
+  int errors = 0, reconnects = 0;
+};
+
+static int Connect(int port)
+{
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  struct sockaddr_in sa = {};
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons((unsigned short) port);
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  connect(fd, (struct sockaddr*) &sa, sizeof(sa));
+  return fd;
+}
+
+// returns -1 on a bad reply, 0 if incomplete, 1 if complete
+static int CheckReply(Client& c, EPage page)
+{
+  if (!c.headerLen)
+  {
+    const char* end = nullptr;
+    for (size_t i = 3; i < c.in.size(); i++)
+      if (!memcmp(&c.in[i - 3], "\r\n\r\n", 4)) { end = &c.in[i + 1]; break; }
+    if (!end) return 0;
+    c.headerLen = (int) (end - c.in.data());
+    if (strncmp(c.in.data(), "HTTP/1.1 200", 12)) return -1;
+    c.contentLength = -1;
+    for (const char* p = c.in.data(); p < end; p++)
+      if (!strncasecmp(p, "\r\nContent-length:", 17)) { c.contentLength = atoi(p + 17); break; }
+    if (c.contentLength < 0) return -1;
+  }
+  if ((int) c.in.size() < c.headerLen + c.contentLength) return 0;
+  if ((int) c.in.size() > c.headerLen + c.contentLength) return -1;
+  const char* body = c.in.data() + c.headerLen;
+  if (page == kPageSmall)
+    return c.contentLength == (int) strlen(kSmallPage) && !memcmp(body, kSmallPage, c.contentLength) ? 1 : -1;
+  return c.contentLength == (int) sFileData.size() && !memcmp(body, sFileData.data(), c.contentLength) ? 1 : -1;
+}
+
+static Result RunClients(int port, int nCons, int nActive, double secs, EPage page)
+{
+  Result res;
+  char req[256];
+  snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: localhost\r\nUser-Agent: JNLWebServerBench\r\n\r\n", kPageURLs[page]);
+  const size_t reqLen = strlen(req);
+
+  const int ep = epoll_create1(0);
+  std::vector<Client> clients(nCons);
+  auto open = [&](int i) {
+    Client& c = clients[i];
+    c = Client();
+    c.fd = Connect(port);
+    struct epoll_event ev = {};
+    ev.events = i < nActive ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    ev.data.u32 = i;
+    epoll_ctl(ep, EPOLL_CTL_ADD, c.fd, &ev);
+    if (i >= nActive) c.reqPos = reqLen; // stays idle
+    c.sent = Now();
+  };
+  for (int i = 0; i < nCons; i++) open(i);
+
+  char buf[65536];
+  std::vector<struct epoll_event> evs(1024);
+  const double start = Now();
+  double now = start;
+  while (now < start + secs)
+  {
+    const int n = epoll_wait(ep, evs.data(), (int) evs.size(), 50);
+    now = Now();
+    for (int e = 0; e < n; e++)
+    {
+      const int i = evs[e].data.u32;
+      Client& c = clients[i];
+      bool drop = (evs[e].events & (EPOLLERR | EPOLLHUP)) != 0;
+
+      if (!drop && c.reqPos < reqLen && (evs[e].events & EPOLLOUT))
+      {
+        const ssize_t w = send(c.fd, req + c.reqPos, reqLen - c.reqPos, MSG_NOSIGNAL);
+        if (w > 0) c.reqPos += w;
+        if (c.reqPos == reqLen)
+        {
+          struct epoll_event ev = {};
+          ev.events = EPOLLIN;
+          ev.data.u32 = i;
+          epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+        }
+      }
+      if (!drop && (evs[e].events & EPOLLIN))
+      {
+        for (;;)
+        {
+          const ssize_t r = recv(c.fd, buf, sizeof(buf), 0);
+          if (r > 0) { c.in.insert(c.in.end(), buf, buf + r); continue; }
+          if (r == 0 || errno != EAGAIN) drop = true;
+          break;
+        }
+        const int st = CheckReply(c, page);
+        if (st < 0)
+        {
+          res.errors++;
+          drop = true;
+        }
+        else if (st > 0)
+        {
+          res.latencies.push_back((float) ((now - c.sent) * 1000.0));
+          c.in.clear();
+          c.headerLen = 0;
+          c.reqPos = 0;
+          c.sent = now;
+          struct epoll_event ev = {};
+          ev.events = EPOLLIN | EPOLLOUT;
+          ev.data.u32 = i;
+          epoll_ctl(ep, EPOLL_CTL_MOD, c.fd, &ev);
+        }
+      }
+      if (drop)
+      {
+        close(c.fd);
+        res.reconnects++;
+        open(i);
+      }
+    }
+  }
+  res.secs = now - start;
+  for (auto& c : clients)
+  {
+    if (c.fd >= 0) close(c.fd);
+  }
+  close(ep);
+  return res;
+}
+
+static Result RunTest(bool events, int port, int nCons, int nActive, double secs, EPage page)
+{
+  BenchServer* srv = new BenchServer;
+  srv->setMaxConnections(nCons + 64);
+  srv->setRequestTimeout(60);
+  if (srv->addListenPort(port, htonl(INADDR_LOOPBACK)))
+  {
+    printf("can't listen on port %d\n", port);
+    exit(1);
+  }
+
+  std::atomic<bool> running { true };
+  double serverCPU = 0.0;
+  std::thread server([&]() {
+    const double cpu0 = ThreadCPU();
+    while (running)
+    {
+      if (events) srv->run_events(100);
+      else srv->run();
+    }
+    serverCPU = ThreadCPU() - cpu0;
+  });
+
+  Result res = RunClients(port, nCons, nActive, secs, page);
+  running = false;
+  server.join();
+  res.serverCPU = serverCPU;
+  delete srv;
+  return res;
+}
+
+static float Percentile(std::vector<float>& v, double p)
+{
+  if (v.empty()) return 0.f;
+  const size_t i = std::min(v.size() - 1, (size_t) (p * v.size()));
+  std::nth_element(v.begin(), v.begin() + i, v.end());
+  return v[i];
+}
+
+int main(int argc, char** argv)
+{
+  const int nCons = argc > 1 ? atoi(argv[1]) : 1000;
+  const double secs = argc > 2 ? atof(argv[2]) : 2.0;
+  const int fileKB = argc > 3 ? atoi(argv[3]) : 64;
+
+  // jnetlib sockets don't use MSG_NOSIGNAL, and the clients hang up on the server at the end of each test
+  signal(SIGPIPE, SIG_IGN);
+
+  // a server and a client socket per connection
+  struct rlimit rl;
+  if (!getrlimit(RLIMIT_NOFILE, &rl) && rl.rlim_cur < (rlim_t) (nCons * 2 + 256))
+  {
+    rl.rlim_cur = std::min(rl.rlim_max, (rlim_t) (nCons * 2 + 256));
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+
+  sFileData.resize(fileKB * 1024);
+  for (auto& b : sFileData) b = (unsigned char) Rand();
+  FILE* fp = fopen(kFileName, "wb");
+  if (!fp || fwrite(sFileData.data(), 1, sFileData.size(), fp) != sFileData.size())
+  {
+    printf("can't write %s\n", kFileName);
+    return 1;
+  }
+  fclose(fp);
+
+  printf("%d keep-alive connections over loopback, %.1fs per test, %d KB file, %u CPUs\n\n",
+         nCons, secs, fileKB, std::thread::hardware_concurrency());
+  bool ok = true;
+  int port = 18000 + (int) (Rand() % 2000);
+  // every client busy, then most of them idle (as keep-alive browser connections mostly are)
+  const int actives[2] = { nCons, std::max(1, nCons / 100) };
+  for (int a = 0; a < 2; a++)
+  {
+    printf("%d active:\n", actives[a]);
+    printf("%-18s %-13s %10s %9s %9s %9s %13s %7s %7s\n", "page", "server", "req/s", "p50 ms", "p99 ms", "max ms", "server us/req", "errors", "closed");
+    for (int p = 0; p < kNumPages; p++)
+    {
+      for (int mode = 0; mode < 2; mode++)
+      {
+        Result r = RunTest(mode == 1, port++, nCons, actives[a], secs, (EPage) p);
+        const size_t n = r.latencies.size();
+        float p50 = Percentile(r.latencies, 0.5), p99 = Percentile(r.latencies, 0.99);
+        float mx = n ? *std::max_element(r.latencies.begin(), r.latencies.end()) : 0.f;
+        printf("%-18s %-13s %10.0f %9.2f %9.2f %9.2f %13.2f %7d %7d\n", kPageNames[p], mode ? "run_events()" : "run()",
+               n / r.secs, p50, p99, mx, n ? r.serverCPU * 1e6 / n : 0.0, r.errors, r.reconnects);
+        if (r.errors || !n || r.reconnects) ok = false;
+      }
+    }
+    printf("\n");
+  }
+
+  unlink(kFileName);
+  printf("%s\n", ok ? "all replies ok" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * WDLHashArrayBench: checks the hash table associative arrays (WDL/assocarray_hash.h) against std::map with random
+ * operations, then times insert, lookup (hits and misses) and delete against the sorted array versions (WDL/assocarray.h)
+ * for string and int keys, at 1k to 1M entries.
+ *
+ * usage: WDLHashArrayBench [max entries (1000000)]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "assocarray.h"
+#include "assocarray_hash.h"
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sRand = 1;
+static unsigned int Rand()
+{
+  sRand = sRand * 1664525 + 1013904223;
+  return sRand >> 4;
+}
+
+// sorted array inserts in random order are O(n^2) in total, so they are only timed up to this size
+static const int kMaxSortedInserts = 100000;
+
+static bool Verify()
+{
+  WDL_StringKeyedHashArray<int> hs;
+  WDL_IntKeyedHashArray<int> hi;
+  std::map<std::string, int> ms;
+  std::map<int, int> mi;
+
+  for (int i = 0; i < 200000; i++)
+  {
+    const int k = Rand() % 5000;
+    char buf[32];
+    snprintf(buf, sizeof(buf), "key%d", k);
+    switch (Rand() % 4)
+    {
+      case 0:
+      case 1:
+        hs.Insert(buf, i); ms[buf] = i;
+        hi.Insert(k, i); mi[k] = i;
+        break;
+      case 2:
+        hs.Delete(buf); ms.erase(buf);
+        hi.Delete(k); mi.erase(k);
+        break;
+      case 3:
+        if (Rand() % 2)
+        {
+          const int idx = hi.GetSize() ? (int) (Rand() % hi.GetSize()) : 0;
+          int key = 0;
+          if (hi.EnumeratePtr(idx, &key)) { mi.erase(key); hi.DeleteByIndex(idx); }
+        }
+        if (hs.Get(buf, -1) != (ms.count(buf) ? ms[buf] : -1)) return false;
+        if (hi.Get(k, -1) != (mi.count(k) ? mi[k] : -1)) return false;
+        break;
+    }
+    if (hs.GetSize() != (int) ms.size() || hi.GetSize() != (int) mi.size()) return false;
+  }
+
+  // every key can be found from enumeration, and Resort() gives key order
+  hi.Resort();
+  auto it = mi.begin();
+  for (int i = 0; i < hi.GetSize(); i++, it++)
+  {
+    int key = 0;
+    const int val = hi.Enumerate(i, &key);
+    if (key != it->first || val != it->second || hi.Get(key, -1) != val) return false;
+  }
+  hs.Resort();
+  auto its = ms.begin();
+  for (int i = 0; i < hs.GetSize(); i++, its++)
+  {
+    const char* key = nullptr;
+    hs.Enumerate(i, &key);
+    if (its->first != key || hs.Get(key, -1) != its->second) return false;
+  }
+  return true;
+}
+
+struct Result
+{
+  double insert = -1.0, bulk = -1.0, hit = 0.0, miss = 0.0, del = -1.0;
+};
+
+template <class T, class KEY>
+static Result Run(T& arr, const std::vector<KEY>& keys, const std::vector<KEY>& missing, bool sorted)
+{
+  Result r;
+  const int n = (int) keys.size();
+  double t0;
+
+  if (!sorted || n <= kMaxSortedInserts)
+  {
+    t0 = Now();
+    for (int i = 0; i < n; i++) arr.Insert(keys[i], i);
+    r.insert = Now() - t0;
+    arr.DeleteAll();
+  }
+
+  // bulk load: AddUnsorted()+Resort() is how a sorted array is normally filled with many entries
+  t0 = Now();
+  for (int i = 0; i < n; i++) arr.AddUnsorted(keys[i], i);
+  arr.Resort();
+  r.bulk = Now() - t0;
+
+  int found = 0;
+  t0 = Now();
+  for (int i = 0; i < n; i++) found += arr.GetPtr(keys[i]) != nullptr;
+  r.hit = Now() - t0;
+
+  t0 = Now();
+  for (int i = 0; i < n; i++) found += arr.GetPtr(missing[i]) != nullptr;
+  r.miss = Now() - t0;
+
+  if (found != n) printf("lookup error: found %d of %d\n", found, n);
+
+  if (!sorted || n <= kMaxSortedInserts)
+  {
+    t0 = Now();
+    for (int i = 0; i < n; i++) arr.Delete(keys[i]);
+    r.del = Now() - t0;
+    if (arr.GetSize()) printf("delete error: %d left\n", arr.GetSize());
+  }
+  arr.DeleteAll();
+  return r;
+}
+
+static void Print(const char* name, int n, const Result& r)
+{
+  auto ns = [n](double t) { return t < 0.0 ? -1.0 : t * 1e9 / n; };
+  printf("%-10s %8d", name, n);
+  for (double t : { ns(r.insert), ns(r.bulk), ns(r.hit), ns(r.miss), ns(r.del) })
+  {
+    if (t < 0.0) printf(" %10s", "-");
+    else printf(" %10.1f", t);
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+  const int maxn = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  const bool ok = Verify();
+  printf("hash arrays match std::map: %s\n\n", ok ? "yes" : "NO");
+
+  printf("ns per entry. insert = Insert() in random order, bulk = AddUnsorted()+Resort(). "
+         "sorted inserts/deletes are skipped above %d entries\n\n", kMaxSortedInserts);
+  printf("%-10s %8s %10s %10s %10s %10s %10s\n", "", "entries", "insert", "bulk", "hit", "miss", "delete");
+
+  for (int n = 1000; n <= maxn; n *= 10)
+  {
+    std::vector<std::string> strs, strmiss;
+    std::vector<const char*> skeys, smiss;
+    std::vector<int> ikeys, imiss;
+    for (int i = 0; i < n; i++)
+    {
+      char buf[64];
+      const unsigned int r = Rand();
+      snprintf(buf, sizeof(buf), "param/%u/%d", r, i);
+      strs.push_back(buf);
+      snprintf(buf, sizeof(buf), "param/%u/%dx", r, i);
+      strmiss.push_back(buf);
+      ikeys.push_back((int) (r * 2)); // even
+      imiss.push_back((int) (r * 2 + 1)); // odd
+    }
+    for (int i = 0; i < n; i++) { skeys.push_back(strs[i].c_str()); smiss.push_back(strmiss[i].c_str()); }
+
+    // random keys can repeat
+    WDL_IntKeyedHashArray<int> unique;
+    std::vector<int> ik;
+    for (int k : ikeys) if (!unique.Exists(k)) { unique.Insert(k, 0); ik.push_back(k); }
+    imiss.resize(ik.size());
+
+    {
+      WDL_StringKeyedArray<int> a;
+      Print("string", n, Run(a, skeys, smiss, true));
+      WDL_StringKeyedHashArray<int> h;
+      Print("  hash", n, Run(h, skeys, smiss, false));
+    }
+    {
+      WDL_IntKeyedArray<int> a;
+      Print("int", (int) ik.size(), Run(a, ik, imiss, true));
+      WDL_IntKeyedHashArray<int> h;
+      Print("  hash", (int) ik.size(), Run(h, ik, imiss, false));
+    }
+  }
+
+  return ok ? 0 : 1;
+}
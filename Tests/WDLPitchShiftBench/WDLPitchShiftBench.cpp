@@ -0,0 +1,284 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * WDLPitchShiftBench: checks that WDL_SimplePitchShifter (WDL/simple_pitchshift.h) gives the same output as the original
+ * per-sample grain loop through both its interleaved (GetBuffer/BufferDone/GetSamples) and non-interleaved (ProcessBlock)
+ * interfaces, that an impulse comes out GetLatency() samples later at a pitch of 1.0, then times:
+ *  - the original grain loop on interleaved buffers (no copies)
+ *  - GetBuffer/BufferDone/GetSamples, with the interleaving a plug-in needs around them
+ *  - ProcessBlock() on the plug-in's channel buffers
+ * across quality settings and channel counts.
+ *
+ * usage: WDLPitchShiftBench [seconds of audio to time (10)]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define WDL_SIMPLEPITCHSHIFT_IMPLEMENT
+#include "simple_pitchshift.h"
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sRand = 1;
+static unsigned int Rand()
+{
+  sRand = sRand * 1664525 + 1013904223;
+  return sRand >> 4;
+}
+
+static double Noise()
+{
+  return (Rand() % 20001) / 10000.0 - 1.0;
+}
+
+// the grain loop as it was before ProcessBlock() was added, interleaved
+struct RefShifter
+{
+  std::vector<double> psbuf;
+  double pspos;
+  int writepos, bsize, olsize;
+
+  RefShifter(int nch, int bs, int ol) : psbuf(bs * nch, 0.0), pspos(bs / 2), writepos(0), bsize(bs), olsize(ol) {}
+
+  void Process(const double* inputs, double* outputs, int nch, int length, double pitch)
+  {
+    double iolsize = 1.0 / olsize;
+    double* ps = psbuf.data();
+    double dpi = pitch;
+    int writeposnch = writepos * nch;
+    int bsizench = bsize * nch;
+    int olsizench = olsize * nch;
+
+    int i = length;
+    while (i--)
+    {
+      int ipos1 = (int) pspos;
+      double frac0 = pspos - ipos1;
+      ipos1 *= nch;
+      int ipos2 = ipos1 + nch;
+      if (ipos2 >= bsizench) ipos2 = 0;
+
+      int a;
+      for (a = 0; a < nch; a++) outputs[a] = (ps[ipos1 + a] * (1 - frac0) + ps[ipos2 + a] * frac0);
+
+      double tv = pspos;
+      if (dpi >= 1.0)
+      {
+        if (tv > writepos) tv -= bsize;
+        if (tv >= writepos - olsize && tv < writepos)
+        {
+          double tfrac = (writepos - tv) * iolsize;
+          int tmp = ipos1 + olsizench;
+          if (tmp >= bsizench) tmp -= bsizench;
+          int tmp2 = tmp + nch;
+          if (tmp2 >= bsizench) tmp2 = 0;
+          for (a = 0; a < nch; a++) outputs[a] = outputs[a] * tfrac + (1 - tfrac) * (ps[tmp + a] * (1 - frac0) + ps[tmp2 + a] * frac0);
+          if (tv + pitch >= writepos) pspos += olsize;
+        }
+      }
+      else
+      {
+        if (tv < writepos) tv += bsize;
+        if (tv >= writepos && tv < writepos + olsize)
+        {
+          double tfrac = (tv - writepos) * iolsize;
+          int tmp = ipos1 + olsizench;
+          if (tmp >= bsizench) tmp -= bsizench;
+          int tmp2 = tmp + nch;
+          if (tmp2 >= bsizench) tmp2 = 0;
+          for (a = 0; a < nch; a++) outputs[a] = outputs[a] * tfrac + (1 - tfrac) * (ps[tmp + a] * (1 - frac0) + ps[tmp2 + a] * frac0);
+          if (tv + pitch < writepos + 1) pspos += olsize;
+        }
+      }
+
+      if ((pspos += pitch) >= bsize) pspos -= bsize;
+
+      memcpy(ps + writeposnch, inputs, nch * sizeof(double));
+      writeposnch += nch;
+      if (++writepos >= bsize) writeposnch = writepos = 0;
+
+      inputs += nch;
+      outputs += nch;
+    }
+  }
+};
+
+static void BlockSizes(int qual, double srate, int* bsize, int* olsize)
+{
+  int ws, os;
+  WDL_SimplePitchShifter::GetSizes(qual, &ws, &os);
+  *bsize = std::min(std::max((int) (ws * 0.001 * srate), 16), 128 * 1024);
+  *olsize = std::max(std::min((int) (os * 0.001 * srate), *bsize / 2), 1);
+}
+
+static bool Verify()
+{
+  bool ok = true;
+  const double srate = 44100.0;
+  for (int qual : { 0, 5, 13, 30, 45 })
+    for (int nch : { 1, 2, 3, 6 })
+      for (double pitch : { 0.5, 0.81, 1.0, 1.26, 2.0 })
+      {
+        const int n = 40000;
+        std::vector<double> in(n * nch), ref(n * nch);
+        for (double& v : in) v = Noise();
+
+        int bsize, olsize;
+        BlockSizes(qual, srate, &bsize, &olsize);
+        RefShifter r(nch, bsize, olsize);
+        r.Process(in.data(), ref.data(), nch, n, pitch);
+
+        WDL_SimplePitchShifter planar, inter;
+        for (WDL_SimplePitchShifter* ps : { &planar, &inter })
+        {
+          ps->set_srate(srate);
+          ps->set_nch(nch);
+          ps->set_shift(pitch);
+          ps->SetQualityParameter(qual);
+        }
+
+        std::vector<std::vector<double>> chans(nch, std::vector<double>(n));
+        for (int c = 0; c < nch; c++)
+          for (int i = 0; i < n; i++) chans[c][i] = in[i * nch + c];
+        std::vector<double*> ptrs(nch);
+        std::vector<double> out(n * nch);
+
+        int pos = 0;
+        while (pos < n)
+        {
+          const int bs = std::min(1 + (int) (Rand() % 1500), n - pos);
+          for (int c = 0; c < nch; c++) ptrs[c] = chans[c].data() + pos;
+          planar.ProcessBlock(ptrs.data(), ptrs.data(), nch, bs); // in place
+
+          memcpy(inter.GetBuffer(bs), in.data() + pos * nch, bs * nch * sizeof(double));
+          inter.BufferDone(bs);
+          if (inter.GetSamples(bs, out.data() + pos * nch) != bs) ok = false;
+          pos += bs;
+        }
+
+        double maxdiff = 0.0;
+        for (int i = 0; i < n; i++)
+          for (int c = 0; c < nch; c++)
+            maxdiff = std::max(maxdiff, std::max(std::fabs(chans[c][i] - ref[i * nch + c]), std::fabs(out[i * nch + c] - ref[i * nch + c])));
+        if (maxdiff != 0.0)
+        {
+          printf("  quality %d, %d ch, pitch %.2f: max difference %g\n", qual, nch, pitch, maxdiff);
+          ok = false;
+        }
+      }
+  return ok;
+}
+
+static bool VerifyLatency()
+{
+  bool ok = true;
+  for (double srate : { 44100.0, 48000.0, 96000.0 })
+    for (int qual : { 0, 7, 22, 45 })
+    {
+      WDL_SimplePitchShifter ps;
+      ps.set_srate(srate);
+      ps.SetQualityParameter(qual);
+      const int lat = ps.GetLatency();
+      std::vector<double> buf(lat + 1000, 0.0);
+      buf[10] = 1.0;
+      double* p = buf.data();
+      ps.ProcessBlock(&p, &p, 1, (int) buf.size());
+      const int peak = (int) (std::max_element(buf.begin(), buf.end()) - buf.begin());
+      if (peak != 10 + lat || buf[peak] != 1.0)
+      {
+        printf("  %.0fHz quality %d: latency %d, impulse at %d\n", srate, qual, lat, peak - 10);
+        ok = false;
+      }
+    }
+  return ok;
+}
+
+int main(int argc, char** argv)
+{
+  const double secs = argc > 1 ? atof(argv[1]) : 10.0;
+
+  const bool ok = Verify();
+  printf("output identical to the original grain loop: %s\n", ok ? "yes" : "NO");
+  const bool latok = VerifyLatency();
+  printf("impulse delayed by GetLatency(): %s\n\n", latok ? "yes" : "NO");
+
+  const double srate = 48000.0;
+  const int bs = 128;
+  const int n = (int) (srate * secs) / bs * bs;
+
+  printf("ns per sample frame, pitch 1.26, %d sample blocks, %.0f seconds at 48kHz\n\n", bs, secs);
+  printf("%-26s %4s %12s %12s %12s\n", "quality", "ch", "original", "interleaved", "ProcessBlock");
+  for (int qual : { 0, 13, 45 })
+    for (int nch : { 1, 2, 6 })
+    {
+      std::vector<std::vector<double>> chans(nch, std::vector<double>(n));
+      for (auto& ch : chans) for (double& v : ch) v = Noise();
+      std::vector<std::vector<double>> outs(nch, std::vector<double>(bs));
+      std::vector<double> inter(bs * nch), interout(bs * nch);
+
+      int bsize, olsize;
+      BlockSizes(qual, srate, &bsize, &olsize);
+      RefShifter r(nch, bsize, olsize);
+      for (int i = 0; i < bs * nch; i++) inter[i] = Noise();
+      double t0 = Now();
+      for (int pos = 0; pos < n; pos += bs) r.Process(inter.data(), interout.data(), nch, bs, 1.26);
+      const double tref = Now() - t0;
+
+      WDL_SimplePitchShifter ps;
+      ps.set_srate(srate);
+      ps.set_nch(nch);
+      ps.set_shift(1.26);
+      ps.SetQualityParameter(qual);
+      t0 = Now();
+      for (int pos = 0; pos < n; pos += bs)
+      {
+        double* b = ps.GetBuffer(bs);
+        for (int i = 0; i < bs; i++)
+          for (int c = 0; c < nch; c++) b[i * nch + c] = chans[c][pos + i];
+        ps.BufferDone(bs);
+        ps.GetSamples(bs, interout.data());
+        for (int i = 0; i < bs; i++)
+          for (int c = 0; c < nch; c++) outs[c][i] = interout[i * nch + c];
+      }
+      const double tinter = Now() - t0;
+
+      WDL_SimplePitchShifter pb;
+      pb.set_srate(srate);
+      pb.set_shift(1.26);
+      pb.SetQualityParameter(qual);
+      std::vector<double*> ip(nch), op(nch);
+      t0 = Now();
+      for (int pos = 0; pos < n; pos += bs)
+      {
+        for (int c = 0; c < nch; c++)
+        {
+          ip[c] = chans[c].data() + pos;
+          op[c] = outs[c].data();
+        }
+        pb.ProcessBlock(ip.data(), op.data(), nch, bs);
+      }
+      const double tblock = Now() - t0;
+
+      printf("%-26s %4d %12.2f %12.2f %12.2f\n", WDL_SimplePitchShifter::enumQual(qual), nch,
+             tref * 1e9 / n, tinter * 1e9 / n, tblock * 1e9 / n);
+    }
+
+  return ok && latok ? 0 : 1;
+}
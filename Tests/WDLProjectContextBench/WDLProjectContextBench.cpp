@@ -0,0 +1,425 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * WDLProjectContextBench: generates RPP-style projects (nested blocks, quoted/commented/numeric tokens, base64 binary
+ * blocks written by cfg_encode_binary() and text blocks), and checks that WDL_ProjectStateReader (WDL/projectcontext_view.h)
+ * gives the same lines, tokens and decoded data as ProjectContext_GetNextLine()/LineParser/cfg_decode_binary() on
+ * ProjectStateContext, from memory and from a file, that wdl_base64decode_len() matches wdl_base64decode(), and that
+ * WDL_ProjectState_IndexBlocks() finds the same blocks as ProjectContext_EatCurrentBlock() with any number of threads.
+ * Then it times parsing, base64 decoding and block indexing.
+ *
+ * usage: WDLProjectContextBench [size of the timed project in MB (16)]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "projectcontext.h"
+#include "projectcontext_view.h"
+#include "lineparse.h"
+#include "wdlstring.h"
+#include "wdl_base64.h"
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sRand = 1;
+static unsigned int Rand()
+{
+  sRand = sRand * 1664525 + 1013904223;
+  return sRand >> 4;
+}
+
+static const char* RandomToken(char* buf, int bufsz)
+{
+  static const char* words[] = { "VOLPAN", "TEMPO", "abc", "x", "-17", "42", "0x1F", "3.25", "1,5", "-0.0001", "{A1B2-C3D4}",
+                                 "-", "1e5", "99999999999", "", "a'b", "c\"d", "#hash", ";semi", "tab\there" };
+  const char* w = words[Rand() % (sizeof(words) / sizeof(words[0]))];
+  switch (Rand() % 6)
+  {
+    case 0: snprintf(buf, bufsz, "\"%s with spaces\"", w); break;
+    case 1: snprintf(buf, bufsz, "'%s'", w); break;
+    case 2: snprintf(buf, bufsz, "`%s`", w); break;
+    default:
+      if (!*w || strchr(w, '\t')) w = "plain";
+      if (w[0] == '#' || w[0] == ';') w += Rand() % 2; // sometimes a comment
+      snprintf(buf, bufsz, "%s", w);
+      break;
+  }
+  return buf;
+}
+
+static void AddRandomLine(ProjectStateContext* ctx)
+{
+  std::string line;
+  const int nt = 1 + Rand() % 8;
+  for (int i = 0; i < nt; i++)
+  {
+    char tok[128];
+    if (i) line += (Rand() % 4) ? " " : "\t ";
+    line += RandomToken(tok, sizeof(tok));
+  }
+  if (Rand() % 50 == 0) line += " \"unterminated";
+  if (Rand() % 40 == 0) line = "; comment line";
+  ctx->AddLine("%s", line.c_str());
+}
+
+static void AddBlock(ProjectStateContext* ctx, int depth, int& budget)
+{
+  static const char* names[] = { "TRACK", "ITEM", "SOURCE", "FXCHAIN", "ENVELOPE", "SKIP" };
+  const char* name = names[Rand() % (sizeof(names) / sizeof(names[0]))];
+  ctx->AddLine("<%s %u \"name %d\"", name, Rand(), depth);
+  const int nlines = 2 + Rand() % 20;
+  for (int i = 0; i < nlines && budget > 0; i++)
+  {
+    budget -= 60;
+    switch (Rand() % 12)
+    {
+      case 0:
+        if (depth < 6) AddBlock(ctx, depth + 1, budget);
+        break;
+      case 1:
+      {
+        ctx->AddLine("<BIN %d", (int) (Rand() % 1000));
+        std::vector<unsigned char> data(Rand() % (Rand() % 8 ? 2000 : 60000));
+        for (auto& b : data) b = (unsigned char) Rand();
+        cfg_encode_binary(ctx, data.data(), (int) data.size());
+        ctx->AddLine(">");
+        budget -= (int) data.size() * 4 / 3;
+        break;
+      }
+      case 2:
+        ctx->AddLine("<NOTES");
+        cfg_encode_textblock(ctx, "some notes\r\nspanning lines\r\n\r\nwith a blank one");
+        ctx->AddLine(">");
+        break;
+      default:
+        AddRandomLine(ctx);
+        break;
+    }
+  }
+  ctx->AddLine(">");
+}
+
+static void MakeProject(ProjectStateContext* ctx, int size)
+{
+  ctx->AddLine("<REAPER_PROJECT 0.1 \"7.0/linux-x86_64\" %u", Rand());
+  int budget = size;
+  while (budget > 0)
+  {
+    if (Rand() % 3) AddBlock(ctx, 1, budget);
+    else { AddRandomLine(ctx); budget -= 60; }
+  }
+  ctx->AddLine(">");
+}
+
+static bool SameTokens(LineParser& lp, WDL_ProjectLine& pl)
+{
+  if (lp.getnumtokens() != pl.getnumtokens()) return false;
+  for (int i = 0; i < lp.getnumtokens(); i++)
+  {
+    int len;
+    const char* s = pl.gettoken_str(i, &len);
+    if ((int) strlen(lp.gettoken_str(i)) != len || memcmp(lp.gettoken_str(i), s, len)) return false;
+    if (lp.gettoken_quotingchar(i) != pl.gettoken_quotingchar(i)) return false;
+    int s1, s2;
+    const double f1 = lp.gettoken_float(i, &s1), f2 = pl.gettoken_float(i, &s2);
+    if (s1 != s2 || !(f1 == f2 || (std::isnan(f1) && std::isnan(f2)))) return false;
+    if (lp.gettoken_int(i, &s1) != pl.gettoken_int(i, &s2) || s1 != s2) return false;
+    if (lp.gettoken_uint(i, &s1) != pl.gettoken_uint(i, &s2) || s1 != s2) return false;
+    if (lp.gettoken_enum(i, "volpan\0tempo\0ABC\0") != pl.gettoken_enum(i, "volpan\0tempo\0ABC\0")) return false;
+  }
+  return true;
+}
+
+// walks both parsers over the whole project, decoding the blocks that are decoded in practice and skipping some
+static bool CompareParse(ProjectStateContext* ctx, WDL_ProjectStateReader& rd, int* nlines)
+{
+  LineParser lp;
+  WDL_ProjectLine pl;
+  *nlines = 0;
+  for (;;)
+  {
+    const bool a = ProjectContext_GetNextLine(ctx, &lp), b = rd.GetNextLine(&pl);
+    if (a != b) return false;
+    if (!a) return true;
+    (*nlines)++;
+    if (!SameTokens(lp, pl)) return false;
+
+    const char* t = lp.gettoken_str(0);
+    if (!strcmp(t, "<BIN"))
+    {
+      WDL_HeapBuf h1, h2;
+      if (cfg_decode_binary(ctx, &h1) != rd.DecodeBinary(&h2)) return false;
+      if (h1.GetSize() != h2.GetSize() || memcmp(h1.Get(), h2.Get(), h1.GetSize())) return false;
+    }
+    else if (!strcmp(t, "<NOTES"))
+    {
+      WDL_FastString s1, s2;
+      if (cfg_decode_textblock(ctx, &s1) != cfg_decode_textblock(&rd, &s2) || strcmp(s1.Get(), s2.Get())) return false;
+    }
+    else if (!strcmp(t, "<SKIP"))
+    {
+      if (ProjectContext_EatCurrentBlock(ctx) != rd.EatCurrentBlock()) return false;
+    }
+  }
+}
+
+// the children of the root block with ProjectContext_EatCurrentBlock(), as names and the lines in them
+struct RefBlock
+{
+  std::string name;
+  std::vector<std::string> lines;
+};
+
+static void CollectLines(ProjectStateContext* ctx, std::vector<std::string>& lines)
+{
+  char buf[4096];
+  while (!ctx->GetLine(buf, sizeof(buf))) lines.push_back(buf);
+}
+
+static std::vector<RefBlock> RefIndex(ProjectStateContext* ctx)
+{
+  std::vector<RefBlock> blocks;
+  LineParser lp;
+  ProjectContext_GetNextLine(ctx, &lp); // root
+  while (ProjectContext_GetNextLine(ctx, &lp))
+  {
+    const char* t = lp.gettoken_str(0);
+    if (t[0] == '>') break;
+    if (t[0] != '<') continue;
+    RefBlock b;
+    b.name = t + 1;
+    WDL_HeapBuf hb;
+    ProjectStateContext* out = ProjectCreateMemCtx_Write(&hb);
+    ProjectContext_EatCurrentBlock(ctx, out);
+    delete out;
+    ProjectStateContext* in = ProjectCreateMemCtx_Read(&hb);
+    CollectLines(in, b.lines);
+    delete in;
+    blocks.push_back(b);
+  }
+  return blocks;
+}
+
+static bool CompareIndex(const std::vector<RefBlock>& ref, const char* buf, int sz, int nthreads)
+{
+  WDL_TypedBuf<WDL_ProjectStateBlock> list;
+  if (WDL_ProjectState_IndexBlocks(buf, sz, 1, &list, nthreads) != (int) ref.size()) return false;
+  for (int i = 0; i < list.GetSize(); i++)
+  {
+    const WDL_ProjectStateBlock& b = list.Get()[i];
+    if (!b.closed || ref[i].name != std::string(buf + b.name, b.namelen)) return false;
+
+    // the lines after the < line, up to but not including the >
+    WDL_ProjectStateReader rd(buf + b.start, b.end - b.start);
+    std::vector<std::string> lines;
+    CollectLines(&rd, lines);
+    if (lines.size() < 2 || lines.back().find('>') == std::string::npos) return false;
+    lines.erase(lines.begin());
+    lines.pop_back();
+    if (lines != ref[i].lines) return false;
+  }
+  return true;
+}
+
+static bool CompareBase64()
+{
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (int test = 0; test < 200000; test++)
+  {
+    char src[400];
+    const int len = Rand() % 300;
+    for (int i = 0; i < len; i++) src[i] = alphabet[Rand() % 64];
+    src[len] = 0;
+    if (len && Rand() % 4 == 0) src[Rand() % len] = "=\x80 -\x01*"[Rand() % 6]; // stop somewhere
+    if (len > 2 && Rand() % 4 == 0) { src[len - 1] = '='; if (Rand() % 2) src[len - 2] = '='; }
+
+    unsigned char d1[400], d2[400];
+    memset(d1, 0xAA, sizeof(d1));
+    memset(d2, 0xAA, sizeof(d2));
+    const int destsize = Rand() % 4 ? 300 : (int) (Rand() % 240);
+    const int n1 = wdl_base64decode(src, d1, destsize);
+    const int n2 = wdl_base64decode_len(src, len, d2, destsize);
+    if (n1 != n2 || memcmp(d1, d2, n1)) return false;
+    for (int i = destsize; i < (int) sizeof(d2); i++) if (d2[i] != 0xAA) return false; // nothing past destsize
+  }
+  return true;
+}
+
+static bool Verify()
+{
+  bool ok = true;
+  for (int test = 0; test < 60; test++)
+  {
+    WDL_HeapBuf hb;
+    ProjectStateContext* w = ProjectCreateMemCtx_Write(&hb);
+    MakeProject(w, 20000 + Rand() % 200000);
+    delete w;
+
+    ProjectStateContext* ctx = ProjectCreateMemCtx_Read(&hb);
+    WDL_ProjectStateReader rd(hb.Get(), hb.GetSize());
+    int nlines;
+    if (!CompareParse(ctx, rd, &nlines))
+    {
+      printf("  project %d: parse mismatch at line %d\n", test, nlines);
+      ok = false;
+    }
+    delete ctx;
+
+    ctx = ProjectCreateMemCtx_Read(&hb);
+    const std::vector<RefBlock> ref = RefIndex(ctx);
+    delete ctx;
+    if (!CompareIndex(ref, (const char*) hb.Get(), hb.GetSize(), 1))
+    {
+      printf("  project %d: block index mismatch\n", test);
+      ok = false;
+    }
+  }
+
+  // from a file: indented, CRLF line endings, read through the memory mapped reader
+  WDL_HeapBuf hb;
+  ProjectStateContext* w = ProjectCreateMemCtx_Write(&hb);
+  MakeProject(w, 4 << 20);
+  delete w;
+  const char* fn = "WDLProjectContextBench.rpp";
+  ProjectStateContext* fw = ProjectCreateFileWrite(fn);
+  ProjectStateContext* mr = ProjectCreateMemCtx_Read(&hb);
+  char line[4096];
+  if (fw && mr) while (!mr->GetLine(line, sizeof(line))) fw->AddLine("%s", line);
+  delete mr;
+  delete fw;
+
+  ProjectStateContext* fr = ProjectCreateFileRead(fn);
+  WDL_ProjectStateReader* rd = WDL_ProjectStateReader::CreateFileMap(fn);
+  int nlines = 0;
+  if (!fr || !rd || !CompareParse(fr, *rd, &nlines))
+  {
+    printf("  file: parse mismatch at line %d\n", nlines);
+    ok = false;
+  }
+  delete fr;
+
+  // large enough to be split between threads
+  if (rd)
+  {
+    fr = ProjectCreateFileRead(fn);
+    const std::vector<RefBlock> ref = RefIndex(fr);
+    delete fr;
+    for (int nt : { 1, 2, 3, 7, 16 })
+      if (!CompareIndex(ref, rd->GetBuffer(), rd->GetBufferSize(), nt))
+      {
+        printf("  file: block index mismatch with %d threads\n", nt);
+        ok = false;
+      }
+  }
+  delete rd;
+  remove(fn);
+  return ok;
+}
+
+int main(int argc, char** argv)
+{
+  const int mb = argc > 1 ? atoi(argv[1]) : 16;
+
+  const bool b64ok = CompareBase64();
+  printf("wdl_base64decode_len() matches wdl_base64decode(): %s\n", b64ok ? "yes" : "NO");
+  const bool ok = Verify();
+  printf("WDL_ProjectStateReader matches ProjectStateContext/LineParser, blocks match: %s\n\n", ok ? "yes" : "NO");
+
+  WDL_HeapBuf hb;
+  ProjectStateContext* w = ProjectCreateMemCtx_Write(&hb);
+  MakeProject(w, mb << 20);
+  delete w;
+  const double size = hb.GetSize() / 1048576.0;
+  printf("%.1f MB project\n\n", size);
+
+  // full parse: tokens of every line, binary blocks decoded
+  double t0 = Now();
+  {
+    ProjectStateContext* ctx = ProjectCreateMemCtx_Read(&hb);
+    LineParser lp;
+    WDL_HeapBuf bin;
+    while (ProjectContext_GetNextLine(ctx, &lp))
+      if (!strcmp(lp.gettoken_str(0), "<BIN")) { bin.Resize(0, false); cfg_decode_binary(ctx, &bin); }
+    delete ctx;
+  }
+  const double tref = Now() - t0;
+
+  t0 = Now();
+  {
+    WDL_ProjectStateReader rd(hb.Get(), hb.GetSize());
+    WDL_ProjectLine pl;
+    WDL_HeapBuf bin;
+    while (rd.GetNextLine(&pl))
+      if (pl.gettoken_equals(0, "<BIN")) { bin.Resize(0, false); rd.DecodeBinary(&bin); }
+  }
+  const double tview = Now() - t0;
+
+  printf("%-44s %10s\n", "", "MB/s");
+  printf("%-44s %10.0f\n", "GetNextLine+LineParser+cfg_decode_binary", size / tref);
+  printf("%-44s %10.0f\n", "WDL_ProjectStateReader", size / tview);
+
+  // base64 alone, on lines as cfg_encode_binary() writes them
+  {
+    std::vector<unsigned char> data(8 << 20);
+    for (auto& b : data) b = (unsigned char) Rand();
+    std::vector<char> enc(data.size() * 4 / 3 + 8);
+    wdl_base64encode(data.data(), enc.data(), (int) data.size());
+    const int linelen = 280, enclen = (int) strlen(enc.data());
+    std::vector<unsigned char> out(data.size() + 64);
+
+    t0 = Now();
+    for (int pos = 0; pos < enclen; pos += linelen)
+    {
+      char line[linelen + 1];
+      memcpy(line, enc.data() + pos, std::min(linelen, enclen - pos));
+      line[std::min(linelen, enclen - pos)] = 0;
+      wdl_base64decode(line, out.data() + pos / 4 * 3, 3200);
+    }
+    const double ta = Now() - t0;
+    t0 = Now();
+    for (int pos = 0; pos < enclen; pos += linelen)
+      wdl_base64decode_len(enc.data() + pos, std::min(linelen, enclen - pos), out.data() + pos / 4 * 3, 3200);
+    const double tb = Now() - t0;
+    const bool same = !memcmp(out.data(), data.data(), data.size());
+    printf("%-44s %10.0f\n", "wdl_base64decode", enclen / 1048576.0 / ta);
+    printf("%-44s %10.0f%s\n", "wdl_base64decode_len", enclen / 1048576.0 / tb, same ? "" : "  (WRONG OUTPUT)");
+  }
+
+  // block index of the tracks etc.
+  for (int nt : { 1, 2, 4, 0 })
+  {
+    int n = 0;
+    double t = 1e10;
+    for (int rep = 0; rep < 5; rep++) // best of 5
+    {
+      WDL_TypedBuf<WDL_ProjectStateBlock> list;
+      t0 = Now();
+      n = WDL_ProjectState_IndexBlocks(hb.Get(), hb.GetSize(), 1, &list, nt);
+      t = std::min(t, Now() - t0);
+    }
+    char name[64];
+    if (nt) snprintf(name, sizeof(name), "IndexBlocks, %d thread%s (%d blocks)", nt, nt > 1 ? "s" : "", n);
+    else snprintf(name, sizeof(name), "IndexBlocks, one thread per CPU");
+    printf("%-44s %10.0f\n", name, size / t);
+  }
+
+  return b64ok && ok ? 0 : 1;
+}
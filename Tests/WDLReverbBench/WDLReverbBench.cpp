@@ -0,0 +1,215 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * WDLReverbBench: checks that WDL_ReverbEngineBlock (WDL/verbengine_block.h) in WDL_REVERB_MODE_CLASSIC gives the same
+ * output as WDL_ReverbEngine::ProcessSampleBlock() (WDL/verbengine.h) for random settings, sample rates and block sizes,
+ * compares the impulse response decay and echo density of WDL_REVERB_MODE_DENSE with the scalar engine, then times both.
+ *
+ * usage: WDLReverbBench [seconds of audio to time (20)]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "verbengine.h"
+#include "verbengine_block.h"
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sRand = 1;
+static unsigned int Rand()
+{
+  sRand = sRand * 1664525 + 1013904223;
+  return sRand >> 4;
+}
+
+static double Noise()
+{
+  return (Rand() % 20001) / 10000.0 - 1.0;
+}
+
+// noise bursts with long silences, so that the tails decay into the denormal range
+static void MakeInput(std::vector<double>& l, std::vector<double>& r, int n, double srate)
+{
+  l.assign(n, 0.0);
+  r.assign(n, 0.0);
+  const int burst = (int) (srate * 0.2);
+  for (int i = 0; i < n; i += (int) (srate * 8.0))
+    for (int j = i; j < i + burst && j < n; j++)
+    {
+      l[j] = Noise();
+      r[j] = Noise() * 0.5;
+    }
+}
+
+static bool Compare()
+{
+  bool ok = true;
+  for (int test = 0; test < 12; test++)
+  {
+    static const double rates[] = { 44100.0, 48000.0, 96000.0, 22050.0 };
+    const double srate = rates[test % 4];
+    const double room = 0.3 + (Rand() % 69) * 0.01, damp = (Rand() % 101) * 0.01, width = (Rand() % 201) * 0.01 - 1.0;
+
+    WDL_ReverbEngine ref;
+    WDL_ReverbEngineBlock blk;
+    ref.SetSampleRate(srate);
+    blk.SetSampleRate(srate);
+    ref.SetRoomSize(room);
+    blk.SetRoomSize(room);
+    ref.SetDampening(damp);
+    blk.SetDampening(damp);
+    ref.SetWidth(width);
+    blk.SetWidth(width);
+    ref.Reset();
+    blk.Reset();
+
+    std::vector<double> inl, inr;
+    const int n = (int) (srate * 24.0);
+    MakeInput(inl, inr, n, srate);
+    std::vector<double> o0(n), o1(n), b0(inl), b1(inr);
+
+    int pos = 0;
+    while (pos < n)
+    {
+      int bs = 1 + Rand() % 2048;
+      if (bs > n - pos) bs = n - pos;
+      ref.ProcessSampleBlock(&inl[pos], &inr[pos], &o0[pos], &o1[pos], bs);
+      blk.ProcessSampleBlock(&b0[pos], &b1[pos], &b0[pos], &b1[pos], bs); // in place
+      pos += bs;
+    }
+
+    double maxdiff = 0.0;
+    for (int i = 0; i < n; i++)
+      maxdiff = std::max(maxdiff, std::max(std::fabs(o0[i] - b0[i]), std::fabs(o1[i] - b1[i])));
+    if (maxdiff != 0.0)
+    {
+      printf("  %.0fHz room %.2f damp %.2f width %.2f: max difference %g\n", srate, room, damp, width, maxdiff);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// energy of 100ms windows of the impulse response, and the normalized echo density (fraction of samples more than
+// one standard deviation from the mean in 20ms windows, divided by the 0.3173 expected of gaussian noise)
+struct IRStats
+{
+  std::vector<double> db, ned;
+};
+
+template <class T>
+static IRStats Impulse(T& verb, double srate, int len)
+{
+  std::vector<double> in(len, 0.0), l(len), r(len);
+  in[0] = 1.0;
+  verb.ProcessSampleBlock(in.data(), in.data(), l.data(), r.data(), len);
+
+  IRStats st;
+  const int ew = (int) (srate * 0.1), nw = (int) (srate * 0.02);
+  for (int i = 0; i + ew <= len; i += ew)
+  {
+    double e = 0.0;
+    for (int j = i; j < i + ew; j++) e += l[j] * l[j] + r[j] * r[j];
+    st.db.push_back(10.0 * log10(e / ew + 1e-30));
+  }
+  for (int i = 0; i + nw <= len; i += nw)
+  {
+    double m = 0.0, v = 0.0;
+    for (int j = i; j < i + nw; j++) m += l[j];
+    m /= nw;
+    for (int j = i; j < i + nw; j++) v += (l[j] - m) * (l[j] - m);
+    const double sd = sqrt(v / nw);
+    int cnt = 0;
+    for (int j = i; j < i + nw; j++) cnt += std::fabs(l[j] - m) > sd;
+    st.ned.push_back(cnt / (double) nw / 0.3173);
+  }
+  return st;
+}
+
+static void CompareDense()
+{
+  const double srate = 48000.0;
+  const int len = (int) (srate * 3.0);
+  WDL_ReverbEngine ref;
+  WDL_ReverbEngineBlock dense;
+  ref.SetSampleRate(srate);
+  dense.SetSampleRate(srate);
+  dense.SetMode(WDL_REVERB_MODE_DENSE);
+  ref.SetRoomSize(0.85);
+  dense.SetRoomSize(0.85);
+  ref.SetDampening(0.3);
+  dense.SetDampening(0.3);
+  ref.Reset();
+  dense.Reset();
+
+  const IRStats a = Impulse(ref, srate, len), b = Impulse(dense, srate, len);
+
+  printf("impulse response, room 0.85 damp 0.3, 48kHz\n");
+  printf("%8s %14s %14s\n", "ms", "scalar dB", "dense dB");
+  for (size_t i = 0; i < a.db.size(); i += 3) printf("%8d %14.1f %14.1f\n", (int) (i * 100), a.db[i], b.db[i]);
+
+  printf("\n%8s %14s %14s   (normalized echo density, 1.0 = noise-like)\n", "ms", "scalar", "dense");
+  for (size_t i = 0; i < 10 && i < a.ned.size(); i++) printf("%8d %14.2f %14.2f\n", (int) (i * 20), a.ned[i], b.ned[i]);
+  double ma = 0.0, mb = 0.0;
+  for (size_t i = 10; i < a.ned.size(); i++) { ma += a.ned[i]; mb += b.ned[i]; }
+  printf("%8s %14.2f %14.2f\n\n", ">=200", ma / (a.ned.size() - 10), mb / (b.ned.size() - 10));
+}
+
+template <class T>
+static double Time(T& verb, const std::vector<double>& l, const std::vector<double>& r, int bs)
+{
+  std::vector<double> o0(bs), o1(bs);
+  const int n = (int) l.size();
+  const double t0 = Now();
+  for (int pos = 0; pos + bs <= n; pos += bs)
+    verb.ProcessSampleBlock(const_cast<double*>(&l[pos]), const_cast<double*>(&r[pos]), o0.data(), o1.data(), bs);
+  return Now() - t0;
+}
+
+int main(int argc, char** argv)
+{
+  const double secs = argc > 1 ? atof(argv[1]) : 20.0;
+
+  const bool ok = Compare();
+  printf("WDL_REVERB_MODE_CLASSIC bit-exact with WDL_ReverbEngine::ProcessSampleBlock(): %s\n\n", ok ? "yes" : "NO");
+
+  CompareDense();
+
+  const double srate = 48000.0;
+  std::vector<double> l, r;
+  MakeInput(l, r, (int) (srate * secs), srate);
+  for (size_t i = 0; i < l.size(); i++) if (l[i] == 0.0) l[i] = r[i] = Noise() * 0.001; // keep the tails busy
+
+  printf("ns per stereo sample frame, %.0f seconds at 48kHz\n\n", secs);
+  printf("%10s %14s %14s %14s\n", "block", "scalar", "block", "block dense");
+  for (int bs : { 16, 64, 256, 1024 })
+  {
+    WDL_ReverbEngine ref;
+    WDL_ReverbEngineBlock blk, dense;
+    ref.SetSampleRate(srate);
+    blk.SetSampleRate(srate);
+    dense.SetSampleRate(srate);
+    dense.SetMode(WDL_REVERB_MODE_DENSE);
+    const double n = (double) (l.size() / bs * bs);
+    const double ta = Time(ref, l, r, bs), tb = Time(blk, l, r, bs), tc = Time(dense, l, r, bs);
+    printf("%10d %14.2f %14.2f %14.2f\n", bs, ta * 1e9 / n, tb * 1e9 / n, tc * 1e9 / n);
+  }
+
+  return ok ? 0 : 1;
+}
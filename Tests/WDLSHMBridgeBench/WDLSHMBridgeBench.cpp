@@ -0,0 +1,620 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/*
+ * WDLSHMBridgeBench: starts a copy of itself as a "sandbox" process, which opens a SHM_MsgReplyConnection for control
+ * messages and a WDL_SHM_AudioBridge for audio, and runs a small processor (a stereo biquad, with a level set by MIDI
+ * note-ons, which are echoed an octave up) on its own audio thread. For block sizes of 32 to 1024 frames it then times
+ *  - the processor run in this process
+ *  - WDL_SHM_AudioBridge::Process() (the round trip to the sandbox's audio thread)
+ *  - the same block sent as a SHM_MsgReplyConnection message, with the outputs in the reply
+ * and prints the mean in-process time and the round trip percentiles and overhead per block. The outputs and MIDI of both
+ * remote paths are checked against the processor run here, and must match exactly. Gain changes and resets go over
+ * the control connection.
+ * Then it starts a sandbox that serves several plug-ins at once, with a bridge and an audio thread for each, and runs
+ * 1 to 8 plug-in threads through it at the same time, each checking its outputs, and prints the round trip percentiles.
+ *
+ * usage: WDLSHMBridgeBench [blocks per test (10000)]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define WDL_NO_DEFINE_MINMAX
+#include "shm_audiobridge.h"
+#include "shm_msgreply.h"
+
+// swell.cpp wants this when SWELL isn't provided by an app (nothing here looks functions up)
+extern "C" void* SWELLAPI_GetFunc(const char* name) { return NULL; }
+
+static double Now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned int sSeed = 1;
+static unsigned int Rand()
+{
+  sSeed = sSeed * 1664525 + 1013904223;
+  return sSeed >> 8;
+}
+
+enum EMsg
+{
+  kMsgHello = 1,
+  kMsgSetGain,
+  kMsgReset,
+  kMsgProcess,
+  kMsgQuit
+};
+
+static const int kNumChans = 2;
+static const int kMaxFrames = 1024;
+static const int kMaxMidi = 64;
+
+/** the processing that gets sandboxed */
+struct Processor
+{
+  double mGain = 1.0;
+  double mLevel = 1.0;
+  double mZ[kNumChans][2] = {};
+
+  void Reset()
+  {
+    mLevel = 1.0;
+    memset(mZ, 0, sizeof(mZ));
+  }
+
+  int Process(const double* const* inputs, double** outputs, int nFrames,
+              const WDL_SHM_MidiEvent* midiIn, int nMidiIn, WDL_SHM_MidiEvent* midiOut, int maxMidiOut)
+  {
+    // 2kHz lowpass at 48kHz
+    const double b0 = 0.01440144, b1 = 0.02880288, b2 = 0.01440144, a1 = -1.63299316, a2 = 0.69059892;
+    int nMidiOut = 0, m = 0;
+    for (int s = 0; s < nFrames; s++)
+    {
+      for (; m < nMidiIn && midiIn[m].frame_offset <= s; m++)
+      {
+        const WDL_SHM_MidiEvent& e = midiIn[m];
+        if ((e.msg[0] & 0xf0) == 0x90 && e.msg[2])
+        {
+          mLevel = e.msg[2] / 127.0;
+          if (nMidiOut < maxMidiOut)
+          {
+            midiOut[nMidiOut] = e;
+            midiOut[nMidiOut].msg[1] = (unsigned char) std::min(e.msg[1] + 12, 127);
+            nMidiOut++;
+          }
+        }
+      }
+      const double g = mGain * mLevel;
+      for (int c = 0; c < kNumChans; c++)
+      {
+        const double x = inputs[c][s];
+        const double y = b0 * x + mZ[c][0];
+        mZ[c][0] = b1 * x - a1 * y + mZ[c][1];
+        mZ[c][1] = b2 * x - a2 * y;
+        outputs[c][s] = y * g;
+      }
+    }
+    return nMidiOut;
+  }
+};
+
+// sandbox process
+
+struct Sandbox
+{
+  Processor mBridgeProc; // on the audio thread
+  Processor mMsgProc; // on the control thread
+  std::atomic<int> mResets{0};
+  std::atomic<double> mGain{1.0};
+  std::atomic<bool> mQuit{false};
+  std::vector<char> mReply;
+};
+
+static SHM_MsgReplyConnection::WaitingMessage* SandboxOnRecv(SHM_MsgReplyConnection* con, SHM_MsgReplyConnection::WaitingMessage* msg)
+{
+  Sandbox* sb = (Sandbox*) con->userData;
+  const char* data = (const char*) msg->m_msgdata.Get();
+  const int len = msg->m_msgdata.GetSize();
+  int ok = 1;
+
+  switch (msg->m_msgtype)
+  {
+    case kMsgSetGain:
+      if (len == sizeof(double))
+      {
+        double g;
+        memcpy(&g, data, sizeof(g));
+        sb->mGain.store(g);
+        sb->mMsgProc.mGain = g;
+      }
+      break;
+    case kMsgReset:
+      sb->mResets++;
+      sb->mMsgProc.Reset();
+      break;
+    case kMsgProcess:
+    {
+      // int nframes, int nmidi, the inputs, the MIDI; replies with the outputs, int nmidi, the MIDI
+      int hdr[2];
+      if (len < (int) sizeof(hdr)) break;
+      memcpy(hdr, data, sizeof(hdr));
+      const int n = hdr[0], nMidi = hdr[1];
+      if (n < 0 || n > kMaxFrames || nMidi < 0 || nMidi > kMaxMidi ||
+          len != (int) (sizeof(hdr) + n * kNumChans * sizeof(double) + nMidi * sizeof(WDL_SHM_MidiEvent))) break;
+
+      double inBuf[kNumChans][kMaxFrames];
+      WDL_SHM_MidiEvent midiIn[kMaxMidi];
+      const double* ins[kNumChans];
+      for (int c = 0; c < kNumChans; c++)
+      {
+        memcpy(inBuf[c], data + sizeof(hdr) + c * n * sizeof(double), n * sizeof(double));
+        ins[c] = inBuf[c];
+      }
+      memcpy(midiIn, data + sizeof(hdr) + kNumChans * n * sizeof(double), nMidi * sizeof(WDL_SHM_MidiEvent));
+
+      sb->mReply.resize(kNumChans * n * sizeof(double) + sizeof(int) + kMaxMidi * sizeof(WDL_SHM_MidiEvent));
+      double* outs[kNumChans];
+      for (int c = 0; c < kNumChans; c++) outs[c] = (double*) sb->mReply.data() + c * n;
+      WDL_SHM_MidiEvent midiOut[kMaxMidi];
+      const int nOut = sb->mMsgProc.Process(ins, outs, n, midiIn, nMidi, midiOut, kMaxMidi);
+      char* p = sb->mReply.data() + kNumChans * n * sizeof(double);
+      memcpy(p, &nOut, sizeof(int));
+      memcpy(p + sizeof(int), midiOut, nOut * sizeof(WDL_SHM_MidiEvent));
+      con->Reply(msg->m_msgid, sb->mReply.data(), (int) (p + sizeof(int) + nOut * sizeof(WDL_SHM_MidiEvent) - sb->mReply.data()));
+      return msg;
+    }
+    case kMsgQuit:
+      sb->mQuit = true;
+      break;
+  }
+  con->Reply(msg->m_msgid, &ok, sizeof(ok));
+  return msg;
+}
+
+static int RunSandbox(const char* uniq)
+{
+  SHM_MsgReplyConnection con(65536, 1 << 24, true, uniq);
+  WDL_SHM_AudioBridge bridge(true, uniq);
+  if (!bridge.IsOK() || bridge.GetNumInputs() != kNumChans || bridge.GetNumOutputs() != kNumChans)
+  {
+    printf("sandbox: can't open the bridge\n");
+    return 1;
+  }
+
+  Sandbox sb;
+  con.userData = &sb;
+  con.OnRecv = SandboxOnRecv;
+
+  std::thread audio([&]() {
+    int resets = 0;
+    while (!sb.mQuit)
+    {
+      WDL_SHM_AudioBridge::Block* b = bridge.WaitRequest(100);
+      if (!b)
+      {
+        if (bridge.IsClosed()) break;
+        continue;
+      }
+      if (sb.mResets.load() != resets)
+      {
+        resets = sb.mResets.load();
+        sb.mBridgeProc.Reset();
+      }
+      sb.mBridgeProc.mGain = sb.mGain.load();
+
+      const double* ins[kNumChans];
+      double* outs[kNumChans];
+      for (int c = 0; c < kNumChans; c++)
+      {
+        ins[c] = bridge.GetInput(b, c);
+        outs[c] = bridge.GetOutput(b, c);
+      }
+      b->nmidi_out = sb.mBridgeProc.Process(ins, outs, b->nframes, bridge.GetMidiIn(b), b->nmidi_in, bridge.GetMidiOut(b), bridge.GetMaxMidi());
+      bridge.CompleteBlock();
+    }
+  });
+
+  while (!sb.mQuit)
+  {
+    if (con.Run()) break;
+    con.Wait();
+  }
+  con.Run(); // sends the last reply
+
+  sb.mQuit = true;
+  audio.join();
+  return 0;
+}
+
+// a sandbox serving several plug-ins, each with its own bridge, named uniq.<index>, and its own audio thread
+
+static int RunMultiSandbox(const char* uniq, int nClients)
+{
+  std::vector<std::thread> threads;
+  std::atomic<int> failed{0};
+
+  for (int i = 0; i < nClients; i++)
+  {
+    threads.emplace_back([uniq, i, &failed]() {
+      char name[128];
+      snprintf(name, sizeof(name), "%s.%d", uniq, i);
+      WDL_SHM_AudioBridge bridge(true, name);
+      if (!bridge.IsOK())
+      {
+        failed++;
+        return;
+      }
+
+      Processor proc;
+      proc.mGain = 0.25 * (i + 1);
+      while (!bridge.IsClosed() || bridge.WaitRequest(0))
+      {
+        WDL_SHM_AudioBridge::Block* b = bridge.WaitRequest(100);
+        if (!b) continue;
+
+        const double* ins[kNumChans];
+        double* outs[kNumChans];
+        for (int c = 0; c < kNumChans; c++)
+        {
+          ins[c] = bridge.GetInput(b, c);
+          outs[c] = bridge.GetOutput(b, c);
+        }
+        b->nmidi_out = proc.Process(ins, outs, b->nframes, bridge.GetMidiIn(b), b->nmidi_in, bridge.GetMidiOut(b), bridge.GetMaxMidi());
+        bridge.CompleteBlock();
+      }
+    });
+  }
+
+  for (std::thread& t : threads)
+    t.join();
+
+  return failed ? 1 : 0;
+}
+
+// plug-in side
+
+static pid_t sChild = 0;
+
+static bool ChildGone(SHM_MsgReplyConnection*)
+{
+  int status;
+  return waitpid(sChild, &status, WNOHANG) == sChild;
+}
+
+static double Percentile(std::vector<double>& v, double p)
+{
+  if (v.empty()) return 0.0;
+  const size_t i = std::min(v.size() - 1, (size_t) (p * v.size()));
+  std::nth_element(v.begin(), v.begin() + i, v.end());
+  return v[i];
+}
+
+/** the inputs (and some MIDI) of block b */
+static int MakeBlock(int blockSize, int b, double in[kNumChans][kMaxFrames], WDL_SHM_MidiEvent* midi)
+{
+  for (int s = 0; s < blockSize; s++)
+    for (int c = 0; c < kNumChans; c++)
+      in[c][s] = (int) (Rand() & 0xffff) / 32768.0 - 1.0;
+
+  int nMidi = 0;
+  if (b % 4 == 0)
+  {
+    for (int m = 0; m < 3; m++)
+    {
+      WDL_SHM_MidiEvent& e = midi[nMidi++];
+      e.frame_offset = (int) (Rand() % blockSize);
+      e.msg[0] = 0x90;
+      e.msg[1] = (unsigned char) (36 + Rand() % 60);
+      e.msg[2] = (unsigned char) (1 + Rand() % 127);
+      e.msg[3] = 0;
+    }
+    std::sort(midi, midi + nMidi, [](const WDL_SHM_MidiEvent& a, const WDL_SHM_MidiEvent& b) { return a.frame_offset < b.frame_offset; });
+  }
+  return nMidi;
+}
+
+/** Runs nClients plug-ins at once through one sandbox process, each on its own thread with its own bridge, and returns
+ * the round trip times of all their blocks in us. Counts the blocks that fail or don't match a local processor */
+static std::vector<double> RunClients(const char* exe, int nClients, int blockSize, int nBlocks, int& errors)
+{
+  char uniq[64];
+  snprintf(uniq, sizeof(uniq), "WDLSHMBridgeBench_%d_clients", (int) getpid());
+
+  std::vector<WDL_SHM_AudioBridge*> bridges;
+  for (int i = 0; i < nClients; i++)
+  {
+    char name[128];
+    snprintf(name, sizeof(name), "%s.%d", uniq, i);
+    bridges.push_back(new WDL_SHM_AudioBridge(false, name, kNumChans, kNumChans, kMaxFrames, 2, kMaxMidi));
+    if (!bridges.back()->IsOK()) errors++;
+  }
+
+  char nClientsStr[16];
+  snprintf(nClientsStr, sizeof(nClientsStr), "%d", nClients);
+  const pid_t child = fork();
+  if (!child)
+  {
+#ifdef __linux__
+    execl("/proc/self/exe", exe, "clients", uniq, nClientsStr, (char*) NULL);
+#endif
+    execl(exe, exe, "clients", uniq, nClientsStr, (char*) NULL);
+    _exit(1);
+  }
+
+  std::vector<std::vector<double>> times(nClients);
+  std::atomic<int> clientErrors{0};
+  std::vector<std::thread> threads;
+
+  for (int i = 0; i < nClients && !errors; i++)
+  {
+    threads.emplace_back([&, i]() {
+      WDL_SHM_AudioBridge& bridge = *bridges[i];
+      const double start = Now();
+      while (bridge.IsClosed() && Now() - start < 5.0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+      Processor ref;
+      ref.mGain = 0.25 * (i + 1);
+      double in[kNumChans][kMaxFrames], out[kNumChans][kMaxFrames], refOut[kNumChans][kMaxFrames];
+      const double* ins[kNumChans];
+      double *outs[kNumChans], *refOuts[kNumChans];
+      for (int c = 0; c < kNumChans; c++)
+      {
+        ins[c] = in[c];
+        outs[c] = out[c];
+        refOuts[c] = refOut[c];
+      }
+      WDL_SHM_MidiEvent midiIn[kMaxMidi], midiOut[kMaxMidi], refMidiOut[kMaxMidi];
+      times[i].reserve(nBlocks);
+
+      for (int b = 0; b < nBlocks; b++)
+      {
+        // each client's signal is different, from a seed of its own
+        unsigned int seed = (unsigned int) (i * 7919 + b);
+        for (int s = 0; s < blockSize; s++)
+        {
+          for (int c = 0; c < kNumChans; c++)
+          {
+            seed = seed * 1664525 + 1013904223;
+            in[c][s] = (int) ((seed >> 8) & 0xffff) / 32768.0 - 1.0;
+          }
+        }
+        int nMidi = 0;
+        if (b % 4 == i % 4)
+        {
+          midiIn[0].frame_offset = b % blockSize;
+          midiIn[0].msg[0] = 0x90;
+          midiIn[0].msg[1] = (unsigned char) (36 + i);
+          midiIn[0].msg[2] = (unsigned char) (1 + (b * 13 + i) % 127);
+          midiIn[0].msg[3] = 0;
+          nMidi = 1;
+        }
+
+        int nMidiOut = 0;
+        const double t = Now();
+        const bool ok = bridge.Process(ins, outs, blockSize, midiIn, nMidi, 1000, midiOut, &nMidiOut, kMaxMidi);
+        times[i].push_back((Now() - t) * 1e6);
+
+        const int nRef = ref.Process(ins, refOuts, blockSize, midiIn, nMidi, refMidiOut, kMaxMidi);
+        bool same = ok && nRef == nMidiOut && !memcmp(midiOut, refMidiOut, nRef * sizeof(WDL_SHM_MidiEvent));
+        for (int c = 0; c < kNumChans && same; c++)
+          same = !memcmp(out[c], refOut[c], blockSize * sizeof(double));
+        if (!same) clientErrors++;
+      }
+    });
+  }
+
+  for (std::thread& t : threads)
+    t.join();
+
+  // the sandbox's threads see their bridges close and exit
+  for (WDL_SHM_AudioBridge* bridge : bridges)
+    delete bridge;
+
+  int status = 0;
+  waitpid(child, &status, 0);
+  if (!WIFEXITED(status) || WEXITSTATUS(status)) errors++;
+  errors += clientErrors;
+
+  std::vector<double> all;
+  for (std::vector<double>& t : times)
+    all.insert(all.end(), t.begin(), t.end());
+  return all;
+}
+
+enum EMode
+{
+  kInProcess,
+  kBridge,
+  kMessage
+};
+
+/** returns the time of each block in us, counts mismatches against a local processor */
+static std::vector<double> RunTest(EMode mode, int blockSize, int nBlocks, double gain,
+                                   SHM_MsgReplyConnection& con, WDL_SHM_AudioBridge& bridge, int& errors)
+{
+  std::vector<double> times;
+  times.reserve(nBlocks);
+
+  int ok;
+  con.Send(kMsgSetGain, &gain, sizeof(gain), &ok, sizeof(ok));
+  con.Send(kMsgReset, NULL, 0, &ok, sizeof(ok));
+
+  Processor proc, ref;
+  proc.mGain = ref.mGain = gain;
+
+  static double in[kNumChans][kMaxFrames], out[kNumChans][kMaxFrames], refOut[kNumChans][kMaxFrames];
+  const double* ins[kNumChans];
+  double *outs[kNumChans], *refOuts[kNumChans];
+  for (int c = 0; c < kNumChans; c++)
+  {
+    ins[c] = in[c];
+    outs[c] = out[c];
+    refOuts[c] = refOut[c];
+  }
+  WDL_SHM_MidiEvent midiIn[kMaxMidi], midiOut[kMaxMidi], refMidiOut[kMaxMidi];
+  std::vector<char> msg, reply;
+  WDL_HeapBuf replyBuf;
+
+  sSeed = (unsigned int) blockSize;
+  for (int b = 0; b < nBlocks; b++)
+  {
+    const int nMidi = MakeBlock(blockSize, b, in, midiIn);
+    int nMidiOut = 0;
+
+    const double start = Now();
+    switch (mode)
+    {
+      case kInProcess:
+        nMidiOut = proc.Process(ins, outs, blockSize, midiIn, nMidi, midiOut, kMaxMidi);
+        break;
+      case kBridge:
+        if (!bridge.Process(ins, outs, blockSize, midiIn, nMidi, 1000, midiOut, &nMidiOut, kMaxMidi)) errors++;
+        break;
+      case kMessage:
+      {
+        const int hdr[2] = {blockSize, nMidi};
+        msg.resize(sizeof(hdr) + kNumChans * blockSize * sizeof(double) + nMidi * sizeof(WDL_SHM_MidiEvent));
+        char* p = msg.data();
+        memcpy(p, hdr, sizeof(hdr));
+        p += sizeof(hdr);
+        for (int c = 0; c < kNumChans; c++, p += blockSize * sizeof(double))
+          memcpy(p, in[c], blockSize * sizeof(double));
+        memcpy(p, midiIn, nMidi * sizeof(WDL_SHM_MidiEvent));
+
+        const int rlen = con.Send(kMsgProcess, msg.data(), (int) msg.size(), NULL, 0, NULL, NULL, 0, &replyBuf);
+        const char* r = (const char*) replyBuf.Get();
+        if (rlen < (int) (kNumChans * blockSize * sizeof(double) + sizeof(int)))
+        {
+          errors++;
+          break;
+        }
+        for (int c = 0; c < kNumChans; c++)
+          memcpy(out[c], r + c * blockSize * sizeof(double), blockSize * sizeof(double));
+        memcpy(&nMidiOut, r + kNumChans * blockSize * sizeof(double), sizeof(int));
+        nMidiOut = std::max(0, std::min(nMidiOut, kMaxMidi));
+        memcpy(midiOut, r + kNumChans * blockSize * sizeof(double) + sizeof(int), nMidiOut * sizeof(WDL_SHM_MidiEvent));
+        break;
+      }
+    }
+    times.push_back((Now() - start) * 1e6);
+
+    if (mode != kInProcess)
+    {
+      const int nRef = ref.Process(ins, refOuts, blockSize, midiIn, nMidi, refMidiOut, kMaxMidi);
+      bool same = nRef == nMidiOut && !memcmp(midiOut, refMidiOut, nRef * sizeof(WDL_SHM_MidiEvent));
+      for (int c = 0; c < kNumChans && same; c++)
+        same = !memcmp(out[c], refOut[c], blockSize * sizeof(double));
+      if (!same) errors++;
+    }
+  }
+  return times;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 2 && !strcmp(argv[1], "sandbox"))
+    return RunSandbox(argv[2]);
+  if (argc > 3 && !strcmp(argv[1], "clients"))
+    return RunMultiSandbox(argv[2], atoi(argv[3]));
+
+  const int nBlocks = argc > 1 ? std::max(100, atoi(argv[1])) : 10000;
+  signal(SIGPIPE, SIG_IGN);
+
+  char uniq[64];
+  snprintf(uniq, sizeof(uniq), "WDLSHMBridgeBench_%d", (int) getpid());
+
+  SHM_MsgReplyConnection con(65536, 1 << 24, false, uniq);
+  WDL_SHM_AudioBridge bridge(false, uniq, kNumChans, kNumChans, kMaxFrames, 2, kMaxMidi);
+  if (!bridge.IsOK())
+  {
+    printf("can't create the bridge\n");
+    return 1;
+  }
+
+  sChild = fork();
+  if (sChild < 0)
+  {
+    printf("can't fork\n");
+    return 1;
+  }
+  if (!sChild)
+  {
+#ifdef __linux__
+    execl("/proc/self/exe", argv[0], "sandbox", uniq, (char*) NULL);
+#endif
+    execl(argv[0], argv[0], "sandbox", uniq, (char*) NULL);
+    _exit(1);
+  }
+  con.IdleProc = ChildGone;
+
+  int ok = 0;
+  if (con.Send(kMsgHello, NULL, 0, &ok, sizeof(ok)) < 0 || !ok || bridge.IsClosed())
+  {
+    printf("the sandbox didn't start\n");
+    return 1;
+  }
+
+  printf("%d blocks per test, stereo doubles, %u CPUs\n\n", nBlocks, std::thread::hardware_concurrency());
+  printf("%-7s %13s | %-28s %13s | %-28s\n", "", "in process", "       Process() round trip", "overhead", "  SHM_MsgReplyConnection");
+  printf("%-7s %13s | %9s %9s %9s %13s | %9s %9s %9s\n", "frames", "mean us", "p50 us", "p99 us", "max us", "p50 us", "p50 us", "p99 us", "max us");
+
+  int errors = 0;
+  const int blockSizes[] = {32, 64, 128, 256, 512, 1024};
+  for (int blockSize : blockSizes)
+  {
+    std::vector<double> local = RunTest(kInProcess, blockSize, nBlocks, 0.5, con, bridge, errors);
+    std::vector<double> shm = RunTest(kBridge, blockSize, nBlocks, 0.5, con, bridge, errors);
+    std::vector<double> msgs = RunTest(kMessage, blockSize, nBlocks, 0.5, con, bridge, errors);
+
+    double mean = 0.0;
+    for (double t : local) mean += t;
+    mean /= local.size();
+
+    const double p50 = Percentile(shm, 0.5);
+    printf("%-7d %13.2f | %9.2f %9.2f %9.2f %13.2f | %9.2f %9.2f %9.2f\n", blockSize, mean,
+           p50, Percentile(shm, 0.99), Percentile(shm, 1.0), p50 - mean,
+           Percentile(msgs, 0.5), Percentile(msgs, 0.99), Percentile(msgs, 1.0));
+  }
+
+  // a gain change over the control connection must reach the audio thread
+  std::vector<double> gainCheck = RunTest(kBridge, 64, 100, 0.25, con, bridge, errors);
+
+  con.Send(kMsgQuit, NULL, 0, &ok, sizeof(ok));
+  int status = 0;
+  waitpid(sChild, &status, 0);
+  const bool exited = WIFEXITED(status) && !WEXITSTATUS(status);
+
+  // several plug-ins served by one sandbox
+  printf("\nplug-ins sharing a sandbox, 128 frames, Process() round trip\n");
+  printf("%-7s | %9s %9s %9s\n", "clients", "p50 us", "p99 us", "max us");
+  for (int nClients : {1, 2, 4, 8})
+  {
+    std::vector<double> times = RunClients(argv[0], nClients, 128, std::max(100, nBlocks / 4), errors);
+    printf("%-7d | %9.2f %9.2f %9.2f\n", nClients, Percentile(times, 0.5), Percentile(times, 0.99), Percentile(times, 1.0));
+  }
+
+  printf("\n%s\n", !errors && exited ? "all outputs match" : "FAILED");
+  if (errors) printf("%d blocks failed or didn't match\n", errors);
+  return !errors && exited ? 0 : 1;
+}
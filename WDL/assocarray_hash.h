@@ -0,0 +1,504 @@
+#ifndef _WDL_ASSOCARRAY_HASH_H_
+#define _WDL_ASSOCARRAY_HASH_H_
+
+#include "heapbuf.h"
+#include "mergesort.h"
+
+// Hash table versions of the classes in assocarray.h, with the same interface:
+// WDL_HashAssocArrayImpl, WDL_HashAssocArray, WDL_IntKeyedHashArray, WDL_StringKeyedHashArray and WDL_PtrKeyedHashArray.
+//
+// Insert, Delete and lookups are O(1) instead of O(n) (Insert/Delete move the array) and O(log n).
+// The key/value pairs are kept contiguously in m_data like WDL_AssocArrayImpl, and are found via an
+// open-addressing (linear probing) index of hash values and positions in m_data, so enumeration
+// by index is still O(1).
+//
+// The difference: enumeration is NOT in key order. Keys are in insertion order until something is
+// deleted (Delete moves the last pair into the hole). Call Resort() to sort m_data by key, after which
+// enumeration is in key order until the next Insert or Delete. Functions that rely on sorting
+// (LowerBound) aren't available.
+//
+// On all of these, if valdispose is set, the array will dispose of values as needed.
+// if keydup/keydispose are set, copies of (any) key data will be made/destroyed as necessary
+
+
+// WDL_HashAssocArrayImpl can be used on its own, and can contain structs for keys or values.
+// keyhash and keycmp must agree: keys that compare equal must hash equally
+template <class KEY, class VAL> class WDL_HashAssocArrayImpl
+{
+  WDL_HashAssocArrayImpl(const WDL_HashAssocArrayImpl &cp) { CopyContents(cp); }
+
+  WDL_HashAssocArrayImpl &operator=(const WDL_HashAssocArrayImpl &cp) { CopyContents(cp); return *this; }
+
+public:
+
+  explicit WDL_HashAssocArrayImpl(unsigned int (*keyhash)(KEY *k), int (*keycmp)(KEY *k1, KEY *k2), KEY (*keydup)(KEY)=0, void (*keydispose)(KEY)=0, void (*valdispose)(VAL)=0)
+  {
+    m_keyhash = keyhash;
+    m_keycmp = keycmp;
+    m_keydup = keydup;
+    m_keydispose = keydispose;
+    m_valdispose = valdispose;
+  }
+
+  ~WDL_HashAssocArrayImpl()
+  {
+    DeleteAll();
+  }
+
+  VAL* GetPtr(KEY key, KEY *keyPtrOut=NULL) const
+  {
+    const int i = GetIdx(key);
+    if (i >= 0)
+    {
+      KeyVal* kv = m_data.Get()+i;
+      if (keyPtrOut) *keyPtrOut = kv->key;
+      return &(kv->val);
+    }
+    return 0;
+  }
+
+  bool Exists(KEY key) const
+  {
+    return GetIdx(key) >= 0;
+  }
+
+  // returns the index of key in m_data
+  int Insert(KEY key, VAL val)
+  {
+    const unsigned int h = HashKey(&key);
+    int slot = FindSlot(&key, h);
+    if (slot >= 0 && m_index.Get()[slot].idx >= 0)
+    {
+      KeyVal* kv = m_data.Get()+m_index.Get()[slot].idx;
+      if (m_valdispose) m_valdispose(kv->val);
+      kv->val = val;
+      return m_index.Get()[slot].idx;
+    }
+
+    if (slot < 0 || (m_data.GetSize()+1) * 4 > m_index.GetSize() * 3)
+    {
+      if (!Rehash((m_data.GetSize()+1) * 2)) return -1;
+      slot = FindSlot(&key, h);
+    }
+
+    const int i = m_data.GetSize();
+    KeyVal* kv = m_data.Resize(i+1,false);
+    if (WDL_NOT_NORMALLY(m_data.GetSize() != i+1)) return -1;
+    kv += i;
+    if (m_keydup) key = m_keydup(key);
+    kv->key = key;
+    kv->val = val;
+
+    IndexEnt *e = m_index.Get()+slot;
+    e->hash = h;
+    e->idx = i;
+    return i;
+  }
+
+  void Delete(KEY key)
+  {
+    const int slot = FindSlot(&key, HashKey(&key));
+    if (slot >= 0 && m_index.Get()[slot].idx >= 0) DeleteSlot(slot);
+  }
+
+  void DeleteByIndex(int idx)
+  {
+    if (idx >= 0 && idx < m_data.GetSize())
+    {
+      const int slot = FindSlotForIdx(idx);
+      if (WDL_NORMALLY(slot >= 0)) DeleteSlot(slot);
+    }
+  }
+
+  void DeleteAll(bool resizedown=false)
+  {
+    if (m_keydispose || m_valdispose)
+    {
+      int i;
+      for (i = 0; i < m_data.GetSize(); ++i)
+      {
+        KeyVal* kv = m_data.Get()+i;
+        if (m_keydispose) m_keydispose(kv->key);
+        if (m_valdispose) m_valdispose(kv->val);
+      }
+    }
+    m_data.Resize(0, resizedown);
+    if (resizedown) m_index.Resize(0, true);
+    else ClearIndex();
+  }
+
+  int GetSize() const
+  {
+    return m_data.GetSize();
+  }
+
+  VAL* EnumeratePtr(int i, KEY* key=0) const
+  {
+    if (i >= 0 && i < m_data.GetSize())
+    {
+      KeyVal* kv = m_data.Get()+i;
+      if (key) *key = kv->key;
+      return &(kv->val);
+    }
+    return 0;
+  }
+
+  KEY* ReverseLookupPtr(VAL val) const
+  {
+    int i;
+    for (i = 0; i < m_data.GetSize(); ++i)
+    {
+      KeyVal* kv = m_data.Get()+i;
+      if (kv->val == val) return &kv->key;
+    }
+    return 0;
+  }
+
+  void ChangeKey(KEY oldkey, KEY newkey)
+  {
+    const int i = GetIdx(oldkey);
+    if (i >= 0) ChangeKeyByIndex(i, newkey, true);
+  }
+
+  // needsort is ignored, the key is always re-hashed (the pair may move to a different index)
+  void ChangeKeyByIndex(int idx, KEY newkey, bool needsort)
+  {
+    if (idx >= 0 && idx < m_data.GetSize())
+    {
+      KeyVal* kv = m_data.Get()+idx;
+      VAL val = kv->val;
+      void (*valdispose)(VAL) = m_valdispose;
+      m_valdispose = NULL;
+      DeleteByIndex(idx);
+      m_valdispose = valdispose;
+      Insert(newkey, val);
+    }
+  }
+
+  // same as Insert(), for compatibility with WDL_AssocArrayImpl
+  void AddUnsorted(KEY key, VAL val)
+  {
+    Insert(key, val);
+  }
+
+  // sorts m_data by key, so that enumeration is in key order until the next Insert/Delete
+  void Resort(int (*new_keycmp)(KEY *k1, KEY *k2)=NULL)
+  {
+    if (new_keycmp) m_keycmp = new_keycmp;
+    if (m_data.GetSize() > 1 && m_keycmp)
+    {
+      qsort(m_data.Get(), m_data.GetSize(), sizeof(KeyVal),
+        (int(*)(const void*, const void*))m_keycmp);
+      Rehash(m_index.GetSize());
+    }
+  }
+
+  void ResortStable()
+  {
+    if (m_data.GetSize() > 1 && m_keycmp)
+    {
+      char *tmp=(char*)malloc(m_data.GetSize()*sizeof(KeyVal));
+      if (WDL_NORMALLY(tmp))
+      {
+        WDL_mergesort(m_data.Get(), m_data.GetSize(), sizeof(KeyVal),
+          (int(*)(const void*, const void*))m_keycmp, tmp);
+        free(tmp);
+      }
+      else
+      {
+        qsort(m_data.Get(), m_data.GetSize(), sizeof(KeyVal),
+          (int(*)(const void*, const void*))m_keycmp);
+      }
+      Rehash(m_index.GetSize());
+    }
+  }
+
+  int GetIdx(KEY key) const
+  {
+    const int slot = FindSlot(&key, HashKey(&key));
+    return slot >= 0 ? m_index.Get()[slot].idx : -1;
+  }
+
+  void SetGranul(int gran)
+  {
+    m_data.SetGranul(gran);
+  }
+
+  // preallocates for n pairs
+  void Reserve(int n)
+  {
+    if (n > m_data.GetSize())
+    {
+      const int sz = m_data.GetSize();
+      m_data.Resize(n, false);
+      m_data.Resize(sz, false);
+      if (n * 4 > m_index.GetSize() * 3) Rehash(n * 2);
+    }
+  }
+
+  void CopyContents(const WDL_HashAssocArrayImpl &cp)
+  {
+    m_data=cp.m_data;
+    m_index=cp.m_index;
+    m_keyhash = cp.m_keyhash;
+    m_keycmp = cp.m_keycmp;
+    m_keydup = cp.m_keydup;
+    m_keydispose = m_keydup ? cp.m_keydispose : NULL;
+    m_valdispose = NULL; // avoid disposing of values twice, since we don't have a valdup, we can't have a fully valid copy
+    if (m_keydup)
+    {
+      int x;
+      const int n=m_data.GetSize();
+      for (x=0;x<n;x++)
+      {
+        KeyVal *kv=m_data.Get()+x;
+        if (kv->key) kv->key = m_keydup(kv->key);
+      }
+    }
+  }
+
+  void CopyContentsAsReference(const WDL_HashAssocArrayImpl &cp)
+  {
+    DeleteAll(true);
+    m_keyhash = cp.m_keyhash;
+    m_keycmp = cp.m_keycmp;
+    m_keydup = NULL;  // this no longer can own any data
+    m_keydispose = NULL;
+    m_valdispose = NULL;
+
+    m_data=cp.m_data;
+    m_index=cp.m_index;
+  }
+
+
+// private data, but exposed in case the caller wants to manipulate at its own risk
+// (call Rehash() after changing keys or the order of m_data)
+  struct KeyVal
+  {
+    KEY key;
+    VAL val;
+  };
+  WDL_TypedBuf<KeyVal> m_data;
+
+  // rebuilds the index with at least minslots slots (rounded up to a power of 2)
+  bool Rehash(int minslots)
+  {
+    int n = 16;
+    while (n < minslots || n * 3 < m_data.GetSize() * 4) n *= 2;
+    if (m_index.GetSize() != n)
+    {
+      m_index.Resize(n, false);
+      if (WDL_NOT_NORMALLY(m_index.GetSize() != n)) { m_index.Resize(0, false); return false; }
+    }
+    ClearIndex();
+
+    const int mask = n - 1;
+    IndexEnt *index = m_index.Get();
+    int i;
+    for (i = 0; i < m_data.GetSize(); ++i)
+    {
+      const unsigned int h = HashKey(&m_data.Get()[i].key);
+      int slot = (int) (h & mask);
+      while (index[slot].idx >= 0) slot = (slot+1) & mask;
+      index[slot].hash = h;
+      index[slot].idx = i;
+    }
+    return true;
+  }
+
+protected:
+
+  unsigned int (*m_keyhash)(KEY *k);
+  int (*m_keycmp)(KEY *k1, KEY *k2);
+  KEY (*m_keydup)(KEY);
+  void (*m_keydispose)(KEY);
+  void (*m_valdispose)(VAL);
+
+private:
+
+  struct IndexEnt
+  {
+    unsigned int hash;
+    int idx; // into m_data, -1 if empty
+  };
+  WDL_TypedBuf<IndexEnt> m_index; // power of 2 sized, at most 3/4 full
+
+  // mixes the bits of the hash, so that hash functions with weak low bits (e.g. pointers) probe well
+  unsigned int HashKey(KEY *key) const
+  {
+    unsigned int h = m_keyhash(key);
+    h ^= h >> 16;
+    h *= 0x7feb352d;
+    h ^= h >> 15;
+    return h;
+  }
+
+  void ClearIndex()
+  {
+    IndexEnt *index = m_index.Get();
+    int i;
+    for (i = 0; i < m_index.GetSize(); ++i) index[i].idx = -1;
+  }
+
+  // returns the slot holding key, or the empty slot where it would go, or -1 if there is no index yet
+  int FindSlot(KEY *key, unsigned int h) const
+  {
+    const int n = m_index.GetSize();
+    if (!n) return -1;
+    const int mask = n - 1;
+    const IndexEnt *index = m_index.Get();
+    int slot = (int) (h & mask);
+    for (;;)
+    {
+      const IndexEnt *e = index + slot;
+      if (e->idx < 0) return slot;
+      if (e->hash == h && !m_keycmp(key, &m_data.Get()[e->idx].key)) return slot;
+      slot = (slot+1) & mask;
+    }
+  }
+
+  int FindSlotForIdx(int idx) const
+  {
+    const int slot = FindSlot(&m_data.Get()[idx].key, HashKey(&m_data.Get()[idx].key));
+    return slot >= 0 && m_index.Get()[slot].idx == idx ? slot : -1;
+  }
+
+  void DeleteSlot(int slot)
+  {
+    IndexEnt *index = m_index.Get();
+    const int mask = m_index.GetSize() - 1;
+    const int idx = index[slot].idx;
+
+    // move the last pair into the hole, and point its slot at the new position (found before disposing
+    // of the key, since probing may compare against it)
+    const int last = m_data.GetSize()-1;
+    const int lslot = idx != last ? FindSlotForIdx(last) : -1;
+
+    KeyVal* kv = m_data.Get()+idx;
+    if (m_keydispose) m_keydispose(kv->key);
+    if (m_valdispose) m_valdispose(kv->val);
+
+    if (idx != last)
+    {
+      if (WDL_NORMALLY(lslot >= 0)) index[lslot].idx = idx;
+      *kv = m_data.Get()[last];
+    }
+    m_data.Resize(last, false);
+
+    // backward shift deletion: move entries after the hole back if their probe sequence passes it
+    int hole = slot, i = slot;
+    for (;;)
+    {
+      i = (i+1) & mask;
+      if (index[i].idx < 0) break;
+      const int home = (int) (index[i].hash & mask);
+      if (((i - home) & mask) >= ((i - hole) & mask))
+      {
+        index[hole] = index[i];
+        hole = i;
+      }
+    }
+    index[hole].idx = -1;
+  }
+};
+
+
+// WDL_HashAssocArray adds useful functions but cannot contain structs for keys or values
+template <class KEY, class VAL> class WDL_HashAssocArray : public WDL_HashAssocArrayImpl<KEY, VAL>
+{
+public:
+
+  explicit WDL_HashAssocArray(unsigned int (*keyhash)(KEY *k), int (*keycmp)(KEY *k1, KEY *k2), KEY (*keydup)(KEY)=0, void (*keydispose)(KEY)=0, void (*valdispose)(VAL)=0)
+  : WDL_HashAssocArrayImpl<KEY, VAL>(keyhash, keycmp, keydup, keydispose, valdispose)
+  {
+  }
+
+  VAL Get(KEY key, VAL notfound=0) const
+  {
+    VAL* p = this->GetPtr(key);
+    if (p) return *p;
+    return notfound;
+  }
+
+  VAL Enumerate(int i, KEY* key=0, VAL notfound=0) const
+  {
+    VAL* p = this->EnumeratePtr(i, key);
+    if (p) return *p;
+    return notfound;
+  }
+
+  KEY ReverseLookup(VAL val, KEY notfound=0) const
+  {
+    KEY* p=this->ReverseLookupPtr(val);
+    if (p) return *p;
+    return notfound;
+  }
+};
+
+
+template <class VAL> class WDL_IntKeyedHashArray : public WDL_HashAssocArray<int, VAL>
+{
+public:
+
+  explicit WDL_IntKeyedHashArray(void (*valdispose)(VAL)=0) : WDL_HashAssocArray<int, VAL>(hashint, cmpint, NULL, NULL, valdispose) {}
+  ~WDL_IntKeyedHashArray() {}
+
+private:
+
+  static unsigned int hashint(int *i) { return (unsigned int)*i; }
+  static int cmpint(int *i1, int *i2) { return *i1-*i2; }
+};
+
+template <class VAL> class WDL_StringKeyedHashArray : public WDL_HashAssocArray<const char *, VAL>
+{
+public:
+
+  explicit WDL_StringKeyedHashArray(bool caseSensitive=true, void (*valdispose)(VAL)=0) : WDL_HashAssocArray<const char*, VAL>(caseSensitive?hashstr:hashistr, caseSensitive?cmpstr:cmpistr, dupstr, freestr, valdispose) {}
+
+  ~WDL_StringKeyedHashArray() { }
+
+  // FNV-1a
+  static unsigned int hashstr(const char **s)
+  {
+    const unsigned char *p = (const unsigned char *)*s;
+    unsigned int h = 2166136261u;
+    while (*p) { h ^= *p++; h *= 16777619u; }
+    return h;
+  }
+  static unsigned int hashistr(const char **s)
+  {
+    const unsigned char *p = (const unsigned char *)*s;
+    unsigned int h = 2166136261u;
+    while (*p)
+    {
+      unsigned char c = *p++;
+      if (c >= 'a' && c <= 'z') c += 'A'-'a';
+      h ^= c;
+      h *= 16777619u;
+    }
+    return h;
+  }
+  static const char *dupstr(const char *s) { return strdup(s);  } // these might not be necessary but depending on the libc maybe...
+  static int cmpstr(const char **s1, const char **s2) { return strcmp(*s1, *s2); }
+  static int cmpistr(const char **a, const char **b) { return stricmp(*a,*b); }
+  static void freestr(const char* s) { free((void*)s); }
+  static void freecharptr(char *p) { free(p); }
+};
+
+
+template <class VAL> class WDL_PtrKeyedHashArray : public WDL_HashAssocArray<INT_PTR, VAL>
+{
+public:
+
+  explicit WDL_PtrKeyedHashArray(void (*valdispose)(VAL)=0) : WDL_HashAssocArray<INT_PTR, VAL>(hashptr, cmpptr, 0, 0, valdispose) {}
+
+  ~WDL_PtrKeyedHashArray() {}
+
+private:
+
+  static unsigned int hashptr(INT_PTR *a) { const WDL_UINT64 v = (WDL_UINT64)*a; return (unsigned int)(v ^ (v >> 32)); }
+  static int cmpptr(INT_PTR* a, INT_PTR* b) { const INT_PTR d = *a - *b; return d<0?-1:(d!=0); }
+};
+
+
+#endif
@@ -97,6 +97,9 @@ class JNL_HTTPServ JNL_HTTPServ_PARENTDEF
     bool want_keepalive_reset();
 
     bool canKeepAlive() { return m_keepalive; }
+    bool isChunked() { return m_usechunk; } // valid once the reply has been sent
+
+    void reset(); // clears the request/reply state for a new request, without touching the connection (used when reusing a JNL_HTTPServ for a new connection)
 
   protected:
     void seterrstr(const char *str) { m_errstr.Set(str); } 
@@ -11,7 +11,7 @@
 #include "util.h"
 #include "listen.h"
 
-JNL_Listen::JNL_Listen(short port, unsigned int which_interface)
+JNL_Listen::JNL_Listen(short port, unsigned int which_interface, int backlog)
 {
   m_port=port;
   m_socket = ::socket(AF_INET,SOCK_STREAM,0);
@@ -37,7 +37,7 @@ JNL_Listen::JNL_Listen(short port, unsigned int which_interface)
     }
     else
     {  
-      if (::listen(m_socket,8)==-1) 
+      if (::listen(m_socket,backlog>0?backlog:8)==-1) 
       {
         shutdown(m_socket, SHUT_RDWR);
         closesocket(m_socket);
@@ -31,6 +31,7 @@
       virtual JNL_IConnection *get_connect(int sendbufsize=8192, int recvbufsize=8192)=0;
       virtual short port(void)=0;
       virtual int is_error(void)=0;
+      virtual SOCKET get_socket() const = 0;
   };
 
   #define JNL_Listen_PARENTDEF : public JNL_IListen
@@ -45,12 +46,13 @@
 class JNL_Listen JNL_Listen_PARENTDEF
 {
   public:
-    JNL_Listen(short port, unsigned int which_interface=0);
+    JNL_Listen(short port, unsigned int which_interface=0, int backlog=8);
     ~JNL_Listen();
 
     JNL_IConnection *get_connect(int sendbufsize=8192, int recvbufsize=8192);
     short port(void) { return m_port; }
     int is_error(void) { return (m_socket == INVALID_SOCKET); }
+    SOCKET get_socket() const { return m_socket; }
 
   protected:
     SOCKET m_socket;
@@ -13,11 +13,30 @@
 #include "jnetlib.h"
 #include "webserver.h"
 
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+#ifdef __linux__
+  #define JNL_WEBSERVER_SENDFILE
+  #include <sys/sendfile.h>
+  #ifndef JNL_WEBSERVER_NO_EPOLL
+    #define JNL_WEBSERVER_EPOLL
+    #include <sys/epoll.h>
+  #endif
+#endif
+
+#define JNL_WEBSERVER_BUFSIZE 8192 // connection buffer sizes, as JNL_IListen::get_connect()
+#define JNL_WEBSERVER_MAXPOOL 256 // closed connections kept by run_events() for reuse
+
 
 WebServerBaseClass::~WebServerBaseClass()
 {
   m_connections.Empty(true);
+  m_ev_pool.Empty(true);
   m_listeners.Empty(true);
+#ifdef JNL_WEBSERVER_EPOLL
+  if (m_ev_fd >= 0) close(m_ev_fd);
+#endif
 }
 
 WebServerBaseClass::WebServerBaseClass()
@@ -25,6 +44,10 @@ WebServerBaseClass::WebServerBaseClass()
   m_listener_rot=0;
   m_timeout_s=30;
   m_max_con=100;
+  m_ev_fd=-1;
+  m_ev_listening=false;
+  m_ev_listen_dirty=true;
+  m_ev_lastsweep=0;
 }
 
 
@@ -42,8 +65,9 @@ int WebServerBaseClass::addListenPort(int port, unsigned int which_interface)
 {
   removeListenPort(port);
 
-  JNL_IListen *p=new JNL_Listen(port,which_interface);
+  JNL_IListen *p=new JNL_Listen(port,which_interface,m_max_con > 8 ? m_max_con : 8);
   m_listeners.Add(p);
+  m_ev_listen_dirty=true;
   if (p->is_error()) return -1;
   return 0;
 }
@@ -57,6 +81,7 @@ void WebServerBaseClass::removeListenPort(int port)
     if (p->port()==port)
     {
       m_listeners.Delete(x,true);
+      m_ev_listen_dirty=true;
       break;
     }
   }
@@ -65,6 +90,7 @@ void WebServerBaseClass::removeListenPort(int port)
 void WebServerBaseClass::removeListenIdx(int idx)
 {
   m_listeners.Delete(idx,true);
+  m_ev_listen_dirty=true;
 }
 
 int WebServerBaseClass::getListenPort(int idx, int *err)
@@ -80,7 +106,9 @@ int WebServerBaseClass::getListenPort(int idx, int *err)
 
 void WebServerBaseClass::attachConnection(JNL_IConnection *con, int port)
 {
-  m_connections.Add(new WS_conInst(con,port));
+  WS_conInst *ci = new WS_conInst(con,port);
+  m_connections.Add(ci);
+  if (m_ev_fd >= 0) ev_update(ci);
 }
 
 void WebServerBaseClass::run(void)
@@ -89,13 +117,14 @@ void WebServerBaseClass::run(void)
   if (m_connections.GetSize() < m_max_con && (nl=m_listeners.GetSize()))
   {
     JNL_IListen *l=m_listeners.Get(m_listener_rot++ % nl);
-    JNL_IConnection *c=l->get_connect();
+    JNL_IConnection *c=l->get_connect(JNL_WEBSERVER_BUFSIZE,JNL_WEBSERVER_BUFSIZE);
     if (c)
     {
 //      char buf[512];
 //      sprintf(buf,"got new connection at %.3f",GetTickCount()/1000.0);
 //      OutputDebugString(buf);
       attachConnection(c,l->port());
+      m_connections.Get(m_connections.GetSize()-1)->m_accepted=true;
     }
   }
   int x;
@@ -112,6 +141,7 @@ void WebServerBaseClass::run(void)
         time(&ci->m_connect_time);
         delete ci->m_pagegen;
         ci->m_pagegen=0;
+        ci->m_sendfile_checked=false;
         continue;
       }
     }
@@ -149,6 +179,25 @@ int WebServerBaseClass::run_connection(WS_conInst *con)
 
       return !con->m_serv.bytes_inqueue();
     }
+#ifdef JNL_WEBSERVER_SENDFILE
+    if (con->m_accepted && !con->m_sendfile_checked)
+    {
+      con->m_sendfile_checked=true;
+      if (!con->m_serv.isChunked())
+      {
+        WDL_INT64 offs=0, len=0;
+        const int fd = con->m_pagegen->GetSendFile(&offs,&len);
+        if (fd >= 0 && offs >= 0 && len >= 0)
+        {
+          con->m_sendfile_fd=fd;
+          con->m_sendfile_pos=offs;
+          con->m_sendfile_end=offs+len;
+        }
+      }
+    }
+    if (con->m_sendfile_fd >= 0) return run_sendfile(con);
+#endif
+
     char buf[16384];
     int l=con->m_serv.bytes_cansend();
     if (l > 0)
@@ -173,6 +222,289 @@ int WebServerBaseClass::run_connection(WS_conInst *con)
   return 1; // we're done by this point
 }
 
+int WebServerBaseClass::run_sendfile(WS_conInst *con)
+{
+#ifdef JNL_WEBSERVER_SENDFILE
+  if (con->m_serv.bytes_inqueue()) return -2; // headers first
+
+  const SOCKET s = con->m_serv.get_con()->get_socket();
+  while (con->m_sendfile_pos < con->m_sendfile_end)
+  {
+    WDL_INT64 len = con->m_sendfile_end - con->m_sendfile_pos;
+    if (len > (1<<30)) len = 1<<30;
+    off_t offs = (off_t)con->m_sendfile_pos;
+    const ssize_t rv = sendfile(s,con->m_sendfile_fd,&offs,(size_t)len);
+    if (rv > 0)
+    {
+      con->m_sendfile_pos = offs;
+      continue;
+    }
+    if (rv < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return -2;
+    if (rv < 0 && errno == EINTR) continue;
+    break; // error, or the file got shorter
+  }
+  const bool done = con->m_sendfile_pos >= con->m_sendfile_end;
+  con->m_sendfile_fd=-1;
+  if (done && con->m_serv.canKeepAlive()) return -1;
+#endif
+  return 1;
+}
+
+void WebServerBaseClass::ev_close(WS_conInst *con)
+{
+#ifdef JNL_WEBSERVER_EPOLL
+  if (con->m_ev_mask >= 0 && m_ev_fd >= 0)
+  {
+    struct epoll_event ev = { 0, };
+    epoll_ctl(m_ev_fd,EPOLL_CTL_DEL,con->m_serv.get_con()->get_socket(),&ev);
+  }
+#endif
+  m_ev_polled.DeletePtr(con);
+  m_connections.DeletePtr(con);
+
+  if (con->m_accepted && m_ev_pool.GetSize() < JNL_WEBSERVER_MAXPOOL)
+  {
+    delete con->m_pagegen;
+    con->m_pagegen=NULL;
+    con->m_sendfile_fd=-1;
+    con->m_ev_mask=-1;
+    con->m_serv.close(1);
+    m_ev_pool.Add(con);
+  }
+  else
+  {
+    delete con;
+  }
+}
+
+void WebServerBaseClass::ev_accept(JNL_IListen *l)
+{
+#ifndef _WIN32
+  const SOCKET ls = l->get_socket();
+  while (m_connections.GetSize() < m_max_con)
+  {
+    struct sockaddr_in saddr;
+    socklen_t length = sizeof(struct sockaddr_in);
+    SOCKET s = accept(ls, (struct sockaddr *) &saddr, &length);
+    if (s == INVALID_SOCKET) break;
+
+    // replies are usually written in one go, don't hold back the last segment of one
+    int nd = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char*)&nd, sizeof(nd));
+
+    WS_conInst *con = m_ev_pool.Get(m_ev_pool.GetSize()-1);
+    if (con)
+    {
+      m_ev_pool.Delete(m_ev_pool.GetSize()-1);
+      con->m_serv.get_con()->connect(s,&saddr);
+      con->m_serv.reset();
+      con->m_sendfile_checked=false;
+      con->m_port = l->port();
+      time(&con->m_connect_time);
+    }
+    else
+    {
+      JNL_IConnection *c = new JNL_Connection(NULL,JNL_WEBSERVER_BUFSIZE,JNL_WEBSERVER_BUFSIZE);
+      c->connect(s,&saddr);
+      con = new WS_conInst(c,l->port());
+    }
+    con->m_accepted=true;
+    m_connections.Add(con);
+    ev_service(con); // the request has often arrived already
+  }
+#endif
+}
+
+int WebServerBaseClass::ev_service(WS_conInst *con)
+{
+  int rv=0;
+  for (int y = 0; y < 32; y ++) // until it would block
+  {
+    rv=run_connection(con);
+    if (rv == -1)
+    {
+      if (!con->m_serv.want_keepalive_reset())
+      {
+        rv = 1;
+        break;
+      }
+      time(&con->m_connect_time);
+      delete con->m_pagegen;
+      con->m_pagegen=0;
+      con->m_sendfile_checked=false;
+      if (!con->m_serv.get_con()->recv_bytes_available()) break;
+      rv=0; // next request already received
+    }
+    else if (rv) break;
+  }
+
+  if (rv > 0)
+  {
+    ev_close(con);
+    return 1;
+  }
+  ev_update(con);
+  return 0;
+}
+
+void WebServerBaseClass::ev_update(WS_conInst *con)
+{
+  JNL_IConnection *c = con->m_serv.get_con();
+  const bool sending = con->m_pagegen || con->m_sendfile_fd >= 0;
+  const int inq = c->recv_bytes_available();
+  const bool nbwait = con->m_pagegen && con->m_sendfile_fd < 0 && con->m_pagegen->IsNonBlocking() && !c->send_bytes_in_queue();
+
+  int mask = 0;
+  // read unless the buffer is full, or while replying once the next request has started arriving
+  if (inq < JNL_WEBSERVER_BUFSIZE && (!sending || !inq)) mask |= 1;
+  if (c->send_bytes_in_queue() || (sending && !nbwait)) mask |= 2;
+
+  // a nonblocking page generator with nothing to send yet, or a complete request left in the buffer,
+  // won't produce socket activity
+  const bool poll = nbwait || (!sending && c->recv_lines_available() > 0);
+  const int idx = m_ev_polled.Find(con);
+  if (poll && idx < 0) m_ev_polled.Add(con);
+  else if (!poll && idx >= 0) m_ev_polled.Delete(idx);
+
+  if (mask == con->m_ev_mask) return;
+
+#ifdef JNL_WEBSERVER_EPOLL
+  if (m_ev_fd >= 0)
+  {
+    struct epoll_event ev = { 0, };
+    ev.events = ((mask&1) ? EPOLLIN : 0) | ((mask&2) ? EPOLLOUT : 0);
+    ev.data.ptr = con;
+    epoll_ctl(m_ev_fd,con->m_ev_mask < 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,c->get_socket(),&ev);
+  }
+#endif
+  con->m_ev_mask = mask;
+}
+
+int WebServerBaseClass::run_events(int timeout_ms)
+{
+#ifdef _WIN32
+  run();
+  if (timeout_ms > 0) Sleep(timeout_ms < 10 ? timeout_ms : 10);
+  return m_connections.GetSize();
+#else
+  const bool want_listen = m_connections.GetSize() < m_max_con;
+  int x, cnt=0;
+
+  if (m_ev_polled.GetSize()) { if (timeout_ms > 1) timeout_ms = 1; }
+  else if (m_connections.GetSize() && (timeout_ms < 0 || timeout_ms > 1000)) timeout_ms = 1000; // for timeouts
+
+#ifdef JNL_WEBSERVER_EPOLL
+  if (m_ev_fd < 0)
+  {
+    m_ev_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_ev_fd < 0) m_ev_fd = epoll_create(256);
+    if (m_ev_fd < 0) { run(); return m_connections.GetSize(); }
+    m_ev_listen_dirty = true;
+    for (x = 0; x < m_connections.GetSize(); x ++)
+    {
+      m_connections.Get(x)->m_ev_mask = -1;
+      ev_update(m_connections.Get(x));
+    }
+  }
+
+  if (m_ev_listen_dirty || want_listen != m_ev_listening)
+  {
+    // removeListen*() close their sockets, which also removes them
+    for (x = 0; x < m_ev_listen_sockets.GetSize(); x ++)
+    {
+      struct epoll_event ev = { 0, };
+      epoll_ctl(m_ev_fd,EPOLL_CTL_DEL,m_ev_listen_sockets.Get()[x],&ev);
+    }
+    m_ev_listen_sockets.Resize(0,false);
+    if (want_listen) for (x = 0; x < m_listeners.GetSize(); x ++)
+    {
+      JNL_IListen *l = m_listeners.Get(x);
+      if (l->is_error()) continue;
+      const SOCKET ls = l->get_socket();
+      struct epoll_event ev = { 0, };
+      ev.events = EPOLLIN;
+      ev.data.u64 = ((WDL_UINT64)x<<1)|1; // connections use data.ptr, which has the low bit clear
+      if (!epoll_ctl(m_ev_fd,EPOLL_CTL_ADD,ls,&ev)) m_ev_listen_sockets.Add(ls);
+    }
+    m_ev_listen_dirty = false;
+    m_ev_listening = want_listen;
+  }
+
+  struct epoll_event evs[256];
+  const int n = epoll_wait(m_ev_fd,evs,256,timeout_ms);
+  for (x = 0; x < n; x ++)
+  {
+    if (evs[x].data.u64 & 1)
+    {
+      JNL_IListen *l = m_listeners.Get((int)(evs[x].data.u64>>1));
+      if (l) ev_accept(l);
+    }
+    else
+    {
+      ev_service((WS_conInst *)evs[x].data.ptr);
+      cnt++;
+    }
+  }
+#else
+  // poll() the listeners and every connection, waiting for the events ev_update() chose
+  WDL_TypedBuf<struct pollfd> &pfds = m_ev_pollfds;
+  const int nl = want_listen ? m_listeners.GetSize() : 0, nc = m_connections.GetSize();
+  struct pollfd *pl = pfds.ResizeOK(nl + nc,false);
+  if (!pl) { run(); return nc; }
+
+  for (x = 0; x < nl; x ++)
+  {
+    JNL_IListen *l = m_listeners.Get(x);
+    pl[x].fd = l->is_error() ? -1 : l->get_socket();
+    pl[x].events = POLLIN;
+    pl[x].revents = 0;
+  }
+  for (x = 0; x < nc; x ++)
+  {
+    WS_conInst *con = m_connections.Get(x);
+    if (con->m_ev_mask < 0) ev_update(con);
+    pl[nl+x].fd = con->m_serv.get_con()->get_socket();
+    pl[nl+x].events = ((con->m_ev_mask&1) ? POLLIN : 0) | ((con->m_ev_mask&2) ? POLLOUT : 0);
+    pl[nl+x].revents = 0;
+  }
+
+  if (poll(pl,nl+nc,timeout_ms) > 0)
+  {
+    // service connections first, as they may be removed (and accepting adds more)
+    for (x = nc-1; x >= 0; x --)
+    {
+      if (pl[nl+x].revents && m_connections.Get(x))
+      {
+        ev_service(m_connections.Get(x));
+        cnt++;
+      }
+    }
+    for (x = 0; x < nl; x ++) if (pl[x].revents & POLLIN) ev_accept(m_listeners.Get(x));
+  }
+#endif
+
+  for (x = m_ev_polled.GetSize()-1; x >= 0; x --)
+  {
+    WS_conInst *con = m_ev_polled.Get(x);
+    if (con) { ev_service(con); cnt++; }
+  }
+
+  // request timeouts
+  const time_t now = time(NULL);
+  if (now != m_ev_lastsweep)
+  {
+    m_ev_lastsweep = now;
+    for (x = m_connections.GetSize()-1; x >= 0; x --)
+    {
+      WS_conInst *con = m_connections.Get(x);
+      if (con) ev_service(con);
+    }
+  }
+
+  return cnt;
+#endif
+}
+
 
 
 void WebServerBaseClass::url_encode(const char *in, char *out, int max_out)
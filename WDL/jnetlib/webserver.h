@@ -41,6 +41,13 @@
       Sleep(10);
     }
 
+  or, to serve many connections, let it wait for socket activity (epoll on Linux, poll() on other
+  posix systems) rather than polling every connection:
+
+    foo.setMaxConnections(1024);
+    foo.addListenPort(8080);
+    while (1) foo.run_events(100);
+
   You will also need to derive from the IPageGenerator interface to provide a data stream, here is an
   example of MemPageGenerator:
 
@@ -82,6 +89,11 @@ public:
   virtual ~IPageGenerator() { };
   virtual int IsNonBlocking() { return 0; } // override this and return 1 if GetData should be allowed to return 0
   virtual int GetData(char *buf, int size)=0; // return < 0 when done (or 0 if IsNonBlocking() is 1)
+
+  // optionally return a file descriptor (and the range of it to send) to have the data sent directly
+  // from the file with sendfile() (Linux only), rather than copied through GetData(). Not used for
+  // chunked replies, so set a content length (or Connection:close). The descriptor is not closed.
+  virtual int GetSendFile(WDL_INT64 * /* offset */, WDL_INT64 * /* length */) { return -1; }
 };
 
 
@@ -94,7 +106,7 @@ public:
   virtual ~WebServerBaseClass();
 
   // stuff for setting limits/timeouts
-  void setMaxConnections(int max_con);
+  void setMaxConnections(int max_con); // also sets the listen backlog of ports added after this
   void setRequestTimeout(int timeout_s);
 
   // stuff for setting listener port
@@ -106,6 +118,13 @@ public:
   // call this a lot :)
   void run(void);
 
+  // or call this instead of run() (don't mix them): waits up to timeout_ms for socket activity and
+  // services only the connections that have some, which scales to many more (keep-alive) connections.
+  // Finished connections are kept for reuse along with their buffers. Connections with a nonblocking
+  // page generator that has no data yet are polled every millisecond. Returns the number of
+  // connections serviced. On Windows this calls run() and sleeps.
+  int run_events(int timeout_ms);
+
   // if you want to manually attach a connection, use this:
   // you need to specify the port it came in on so the web server can build
   // links
@@ -133,6 +152,11 @@ protected:
     WS_conInst(JNL_IConnection *c, int which_port) : m_serv(c), m_pagegen(NULL), m_port(which_port)
     {
       time(&m_connect_time);
+      m_accepted=false;
+      m_sendfile_checked=false;
+      m_sendfile_fd=-1;
+      m_sendfile_pos=m_sendfile_end=0;
+      m_ev_mask=-1;
     }
     ~WS_conInst()
     {
@@ -145,9 +169,22 @@ protected:
 
     int m_port; // port this came in on
     time_t m_connect_time;
+
+    bool m_accepted; // accepted from our listeners (a plain socket, so sendfile() can be used, and reusable)
+    bool m_sendfile_checked; // page generator asked for a file for this reply
+    int m_sendfile_fd; // >= 0 while sending m_sendfile_pos..m_sendfile_end with sendfile()
+    WDL_INT64 m_sendfile_pos, m_sendfile_end;
+
+    int m_ev_mask; // events waited for by run_events(), -1 if not registered
   };
 
   int run_connection(WS_conInst *con);
+  int run_sendfile(WS_conInst *con);
+
+  void ev_accept(JNL_IListen *l);
+  int ev_service(WS_conInst *con); // returns 1 if con was closed
+  void ev_update(WS_conInst *con);
+  void ev_close(WS_conInst *con);
 
   int m_timeout_s;
   int m_max_con;
@@ -157,6 +194,18 @@ protected:
   WDL_PtrList<JNL_IListen> m_listeners;
   WDL_PtrList<WS_conInst> m_connections;
   int m_listener_rot;
+
+  // run_events() state
+  int m_ev_fd; // epoll instance
+  bool m_ev_listening; // listeners registered (they are removed while at m_max_con)
+  bool m_ev_listen_dirty;
+  WDL_TypedBuf<SOCKET> m_ev_listen_sockets;
+  WDL_PtrList<WS_conInst> m_ev_pool; // closed connections, for reuse
+  WDL_PtrList<WS_conInst> m_ev_polled; // connections waiting on a nonblocking page generator
+  time_t m_ev_lastsweep;
+#ifndef _WIN32
+  WDL_TypedBuf<struct pollfd> m_ev_pollfds; // if not using epoll
+#endif
 };
 
 
@@ -172,6 +221,15 @@ class JNL_FilePageGenerator : public IPageGenerator
     JNL_FilePageGenerator(WDL_FileRead *fr) { m_file = fr; }
     virtual ~JNL_FilePageGenerator() { delete m_file; }
     virtual int GetData(char *buf, int size) { return m_file ? m_file->Read(buf,size) : -1; }
+#ifdef WDL_POSIX_NATIVE_READ
+    virtual int GetSendFile(WDL_INT64 *offset, WDL_INT64 *length)
+    {
+      if (!m_file || m_file->GetHandle() < 0) return -1;
+      *offset = m_file->GetPosition();
+      *length = m_file->GetSize() - *offset;
+      return m_file->GetHandle();
+    }
+#endif
 
   private:
 
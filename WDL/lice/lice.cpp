@@ -18,6 +18,8 @@
 
 #include "lice_combine.h"
 #include "lice_extended.h"
+#include "lice_simd.h"
+#include "lice_mt.h"
 
 #ifndef _WIN32
 #include "../swell/swell.h"
@@ -38,6 +40,15 @@
     __LICE_SCU(destbm_h); \
   }
 
+// clips h rows starting at destination row y to a band, returns false if nothing is left.
+// skip receives the number of rows the caller needs to advance its per-row state by
+static bool LICE_RowBandClip(const LICE_RowBand *band, int y, int *h, int *skip)
+{
+  *skip = band->top > y ? band->top - y : 0;
+  const int end = lice_min(y + *h, band->bottom);
+  *h = end - (y + *skip);
+  return *h > 0;
+}
 
 
 _LICE_ImageLoader_rec *LICE_ImageLoader_list;
@@ -917,7 +928,7 @@ void LICE_GradRect(LICE_IBitmap *dest, int dstx, int dsty, int dstw, int dsth,
 
 #ifndef LICE_NO_BLIT_SUPPORT 
 
-static void LICE_BlitInt(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, const RECT *srcrect, float alpha, int mode, bool allowSc)
+static void LICE_BlitInt(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, const RECT *srcrect, float alpha, int mode, bool allowSc, const LICE_RowBand *band=NULL)
 {
   if (!dest || !src || !alpha) return;
 
@@ -1018,6 +1029,14 @@ static void LICE_BlitInt(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int ds
   int i=sr.bottom-sr.top;
   int cpsize=sr.right-sr.left;
 
+  if (band)
+  {
+    int skip;
+    if (!LICE_RowBandClip(band,dsty,&i,&skip)) return;
+    pdest += skip*dest_span;
+    psrc += skip*src_span;
+  }
+
   if ((mode&LICE_BLIT_MODE_MASK) >= LICE_BLIT_MODE_CHANCOPY && (mode&LICE_BLIT_MODE_MASK) < LICE_BLIT_MODE_CHANCOPY+0x10)
   {
     while (i-->0)
@@ -1068,6 +1087,9 @@ static void LICE_BlitInt(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int ds
   else 
   {
     int ia=(int)(alpha*256.0);
+    #ifndef LICE_NO_SIMD
+        if (LICE_SIMD_Blit(pdest,psrc,cpsize,i,src_span,dest_span,ia,mode)) return;
+    #endif
     #ifdef LICE_FAVOR_SIZE
         LICE_COMBINEFUNC blitfunc=NULL;      
         #define __LICE__ACTION(comb) blitfunc=comb::doPix;
@@ -1098,9 +1120,23 @@ void LICE_Blit(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int sr
 
 #endif
 
+int LICE_SetSIMDLevel(int level)
+{
+#ifndef LICE_NO_SIMD
+  return LICE_SIMD_SetLevel(level);
+#else
+  return 0;
+#endif
+}
+
 #ifndef LICE_NO_BLUR_SUPPORT
 
 void LICE_Blur(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int srcx, int srcy, int srcw, int srch) // src and dest can overlap, however it may look fudgy if they do
+{
+  LICE_BlurBand(dest,src,dstx,dsty,srcx,srcy,srcw,srch,NULL);
+}
+
+void LICE_BlurBand(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int srcx, int srcy, int srcw, int srch, const LICE_RowBand *band)
 {
   if (!dest || !src) return;
 
@@ -1150,6 +1186,24 @@ void LICE_Blur(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int sr
   LICE_pixel *tmpbuf=NULL;
   int w=sr.right-sr.left;  
 
+#ifndef LICE_NO_SIMD
+  // the SIMD rows match the scalar loop when the areas don't overlap, or for an in-place blur, where tmpbuf has the unblurred rows
+  const bool use_simd = (src==dest && pdest==psrc && dest_span==src_span) ||
+                        !LICE_SIMD_Overlaps(pdest,dest_span*(int)sizeof(LICE_pixel),w,sr.bottom-sr.top,psrc,src_span*(int)sizeof(LICE_pixel),w,sr.bottom-sr.top);
+#endif
+
+  // the first and last rows of the blurred area are blurred differently, so rows are still numbered from sr.top
+  int row_start=sr.top, row_end=sr.bottom;
+  if (band)
+  {
+    int h=sr.bottom-sr.top, skip;
+    if (!LICE_RowBandClip(band,dsty,&h,&skip)) return;
+    row_start+=skip;
+    row_end=row_start+h;
+    psrc += skip*src_span;
+    pdest += skip*dest_span;
+  }
+
   // buffer to save the last unprocessed lines for the cases where blurring from a bitmap to itself
   LICE_pixel turdbuf[2048];
   if (src==dest)
@@ -1159,7 +1213,10 @@ void LICE_Blur(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int sr
   }
 
   int i;
-  for (i = sr.top; i < sr.bottom; i ++)
+  if (tmpbuf && row_start > sr.top) // bands of an in-place blur need the row above, which must not have been blurred yet
+    memcpy(tmpbuf+((row_start&1)?0:w),psrc-src_span,w*sizeof(LICE_pixel));
+
+  for (i = row_start; i < row_end; i ++)
   {
     if (tmpbuf)
       memcpy(tmpbuf+((i&1)?w:0),psrc,w*sizeof(LICE_pixel));
@@ -1173,8 +1230,16 @@ void LICE_Blur(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int sr
       pdest[0] = LICE_PIXEL_HALF(lp=psrc[0]) + 
                  LICE_PIXEL_QUARTER(psrc[1]) + 
                  LICE_PIXEL_QUARTER(psrc2[0]);
-      int x;
-      for (x = 1; x < w-1; x ++)
+      int x=1;
+#ifndef LICE_NO_SIMD
+      if (use_simd && w > 2)
+      {
+        const LICE_pixel *cur = tmpbuf ? tmpbuf+((i&1)?w:0) : psrc;
+        x += LICE_SIMD_BlurRow(pdest+1,cur+1,psrc2+1,NULL,w-2);
+        lp=cur[x-1];
+      }
+#endif
+      for (; x < w-1; x ++)
       {
         LICE_pixel tp;
         pdest[x] = LICE_PIXEL_HALF(tp=psrc[x]) + 
@@ -1199,8 +1264,16 @@ void LICE_Blur(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int sr
                  LICE_PIXEL_QUARTER(psrc[1]) +
                  LICE_PIXEL_EIGHTH(psrc2[0]) +
                  LICE_PIXEL_EIGHTH(psrc3[0]);
-      int x;
-      for (x = 1; x < w-1; x ++)
+      int x=1;
+#ifndef LICE_NO_SIMD
+      if (use_simd && w > 2)
+      {
+        const LICE_pixel *cur = tmpbuf ? tmpbuf+((i&1)?w:0) : psrc;
+        x += LICE_SIMD_BlurRow(pdest+1,cur+1,psrc2+1,psrc3+1,w-2);
+        lp=cur[x-1];
+      }
+#endif
+      for (; x < w-1; x ++)
       {
         LICE_pixel tp;
         pdest[x] = LICE_PIXEL_HALF(tp=psrc[x]) +
@@ -1229,6 +1302,14 @@ void LICE_ScaledBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
                      int dstx, int dsty, int dstw, int dsth, 
                      float srcx, float srcy, float srcw, float srch, 
                      float alpha, int mode)
+{
+  LICE_ScaledBlitBand(dest,src,dstx,dsty,dstw,dsth,srcx,srcy,srcw,srch,alpha,mode,NULL);
+}
+
+void LICE_ScaledBlitBand(LICE_IBitmap *dest, LICE_IBitmap *src, 
+                     int dstx, int dsty, int dstw, int dsth, 
+                     float srcx, float srcy, float srcw, float srch, 
+                     float alpha, int mode, const LICE_RowBand *band)
 {
   if (!dest || !src || !dstw || !dsth || !alpha) return;
 
@@ -1274,7 +1355,7 @@ void LICE_ScaledBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
       RECT sr={(int)(srcx_orig+0.5f),(int)(srcy_orig+0.5f),};
       sr.right=sr.left+(int) (srcw_orig+0.5);
       sr.bottom=sr.top+(int) (srch_orig+0.5);
-      LICE_BlitInt(dest,src,dstx_orig,dsty_orig,&sr,alpha,mode,false);
+      LICE_BlitInt(dest,src,dstx_orig,dsty_orig,&sr,alpha,mode,false,band);
       return;
     }
   }
@@ -1396,11 +1477,19 @@ void LICE_ScaledBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
   clip_b -= srcoffs_y;
 
   const int icurx = (int) (ficurx - srcoffs_x*65536.0);
-  const int icury = (int) (ficury - srcoffs_y*65536.0);
+  int icury = (int) (ficury - srcoffs_y*65536.0);
   const int idx = (int) fidx, idy = (int) fidy;
 
   if (clip_r<1||clip_b<1) return;
 
+  if (band)
+  {
+    int skip;
+    if (!LICE_RowBandClip(band,dsty,&dsth,&skip)) return;
+    pdest += skip*dest_span;
+    icury += skip*idy;
+  }
+
   int ia=(int)(alpha*256.0);
 
   if ((mode&(LICE_BLIT_FILTER_MASK|LICE_BLIT_MODE_MASK|LICE_BLIT_USE_ALPHA))==LICE_BLIT_MODE_COPY && (ia==128 || ia==256))
@@ -1467,6 +1556,10 @@ void LICE_ScaledBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
     }
     else
     {
+      #ifndef LICE_NO_SIMD
+        if ((mode&LICE_BLIT_FILTER_MASK)==LICE_BLIT_FILTER_BILINEAR &&
+            LICE_SIMD_ScaledBlitBilinear(pdest,psrc,dstw,dsth,icurx,icury,idx,idy,clip_r,clip_b,src_span,dest_span,ia,mode)) return;
+      #endif
       #ifdef LICE_FAVOR_SIZE
         LICE_COMBINEFUNC blitfunc=NULL;      
         #define __LICE__ACTION(comb) blitfunc=comb::doPix;
@@ -1488,6 +1581,16 @@ void LICE_DeltaBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
                     double dsdx, double dtdx, double dsdy, double dtdy,
                     double dsdxdy, double dtdxdy,
                     bool cliptosourcerect, float alpha, int mode)
+{
+  LICE_DeltaBlitBand(dest,src,dstx,dsty,dstw,dsth,srcx,srcy,srcw,srch,dsdx,dtdx,dsdy,dtdy,dsdxdy,dtdxdy,cliptosourcerect,alpha,mode,NULL);
+}
+
+void LICE_DeltaBlitBand(LICE_IBitmap *dest, LICE_IBitmap *src, 
+                    int dstx, int dsty, int dstw, int dsth, 
+                    float srcx, float srcy, float srcw, float srch, 
+                    double dsdx, double dtdx, double dsdy, double dtdy,
+                    double dsdxdy, double dtdxdy,
+                    bool cliptosourcerect, float alpha, int mode, const LICE_RowBand *band)
 {
   if (!dest || !src || !dstw || !dsth) return;
 
@@ -1622,6 +1725,17 @@ void LICE_DeltaBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
   int idsdxdy=(int)(dsdxdy*65536.0);
   int idtdxdy=(int)(dtdxdy*65536.0);
 
+  if (band)
+  {
+    int skip;
+    if (!LICE_RowBandClip(band,dsty,&dsth,&skip)) return;
+    pdest += skip*dest_span;
+    isrcx += skip*idsdy;
+    isrcy += skip*idtdy;
+    idsdx += skip*idsdxdy;
+    idtdx += skip*idtdxdy;
+  }
+
 #ifndef LICE_FAVOR_SPEED
   LICE_COMBINEFUNC blitfunc=NULL;
   #define __LICE__ACTION(comb) blitfunc = comb::doPix;
@@ -1815,6 +1929,15 @@ void LICE_RotatedBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
                       float srcx, float srcy, float srcw, float srch, 
                       float angle, 
                       bool cliptosourcerect, float alpha, int mode, float rotxcent, float rotycent)
+{
+  LICE_RotatedBlitBand(dest,src,dstx,dsty,dstw,dsth,srcx,srcy,srcw,srch,angle,cliptosourcerect,alpha,mode,rotxcent,rotycent,NULL);
+}
+
+void LICE_RotatedBlitBand(LICE_IBitmap *dest, LICE_IBitmap *src, 
+                      int dstx, int dsty, int dstw, int dsth, 
+                      float srcx, float srcy, float srcw, float srch, 
+                      float angle, 
+                      bool cliptosourcerect, float alpha, int mode, float rotxcent, float rotycent, const LICE_RowBand *band)
 {
   if (!dest || !src || !dstw || !dsth) return;
 
@@ -1950,6 +2073,15 @@ void LICE_RotatedBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
   int idsdy=(int)(dsdy*65536.0);
   int idtdy=(int)(dtdy*65536.0);
 
+  if (band)
+  {
+    int skip;
+    if (!LICE_RowBandClip(band,dsty,&dsth,&skip)) return;
+    pdest += skip*dest_span;
+    isrcx += skip*idsdy;
+    isrcy += skip*idtdy;
+  }
+
 #ifndef LICE_FAVOR_SPEED
   LICE_COMBINEFUNC blitfunc=NULL;
   #define __LICE__ACTION(comb) blitfunc = comb::doPix;
@@ -2042,6 +2174,10 @@ void LICE_MultiplyAddRect(LICE_IBitmap *dest, int x, int y, int w, int h,
   int ib2=(int)(badd*256.0);
   int ia2=(int)(aadd*256.0);
 
+#ifndef LICE_NO_SIMD
+  if (LICE_SIMD_MultiplyAddRect(p,w,h,sp,ir,ig,ib,ia,ir2,ig2,ib2,ia2)) return;
+#endif
+
   while (h-->0)
   {
     int n=w;
@@ -2163,6 +2299,10 @@ void LICE_FillRect(LICE_IBitmap *dest, int x, int y, int w, int h, LICE_pixel co
     }
   }
 
+#ifndef LICE_NO_SIMD
+  if (LICE_SIMD_FillRect(p,w,h,sp,color,ia,mode)) return;
+#endif
+
 #ifdef LICE_FAVOR_SIZE_EXTREME
   LICE_COMBINEFUNC blitfunc=NULL;      
   #define __LICE__ACTION(comb) blitfunc=comb::doPix;
@@ -2318,7 +2458,7 @@ template<class T> class LICE_TransformBlit_class
   static void blit(LICE_IBitmap *dest, LICE_IBitmap *src,  
                     int dstx, int dsty, int dstw, int dsth,
                     const T *srcpoints, int div_w, int div_h, // srcpoints coords should be div_w*div_h*2 long, and be in source image coordinates
-                    float alpha, int mode)
+                    float alpha, int mode, const LICE_RowBand *band=NULL)
 {
   if (!dest || !src || dstw<1 || dsth<1 || div_w<2 || div_h<2) return;
 
@@ -2365,9 +2505,9 @@ template<class T> class LICE_TransformBlit_class
           double dsdxdy = (dsdx2-dsdx)*iy;
           double dtdxdy = (dtdx2-dtdx)*iy;
 
-          LICE_DeltaBlit(dest,src,cxpos,cypos,nxpos-cxpos,nypos-cypos,
+          LICE_DeltaBlitBand(dest,src,cxpos,cypos,nxpos-cxpos,nypos-cypos,
               (float)sx,(float)sy,(float)sw,(float)sh,
-              dsdx,dtdx,dsdy,dtdy,dsdxdy,dtdxdy,false,alpha,mode);
+              dsdx,dtdx,dsdy,dtdy,dsdxdy,dtdxdy,false,alpha,mode,band);
         }
 
         cxpos=nxpos;
@@ -2469,6 +2609,14 @@ void LICE_TransformBlit2(LICE_IBitmap *dest, LICE_IBitmap *src,
   LICE_TransformBlit_class<double>::blit(dest,src,dstx,dsty,dstw,dsth,srcpoints,div_w,div_h,alpha,mode);
 }
 
+void LICE_TransformBlit2Band(LICE_IBitmap *dest, LICE_IBitmap *src,  
+                    int dstx, int dsty, int dstw, int dsth,
+                    const double *srcpoints, int div_w, int div_h,
+                    float alpha, int mode, const LICE_RowBand *band)
+{
+  LICE_TransformBlit_class<double>::blit(dest,src,dstx,dsty,dstw,dsth,srcpoints,div_w,div_h,alpha,mode,band);
+}
+
 
 void LICE_TransformBlit2Alpha(LICE_IBitmap *dest, LICE_IBitmap *src,  
                     int dstx, int dsty, int dstw, int dsth,
@@ -2752,6 +2900,9 @@ void LICE_DrawGlyphEx(LICE_IBitmap* dest, int x, int y, LICE_pixel color, const
   }
   else
   {
+#ifndef LICE_NO_SIMD
+    if (LICE_SIMD_DrawGlyph(destpx,srcalpha,src_w,src_h,span,glyph_span,color,ia,mode)) return;
+#endif
 #define __LICE__ACTION(COMBFUNC)  GlyphDrawImpl<COMBFUNC>::DrawGlyph(srcalpha,destpx, src_w, src_h, color,span,glyph_span,ia)
 	__LICE_ACTION_NOSRCALPHA(mode, ia, false);
 #undef __LICE__ACTION
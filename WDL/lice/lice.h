@@ -37,6 +37,7 @@
 // (nothing) default probably good overall
 //#define LICE_FAVOR_SIZE // reduces code size of normal/scaled blit functions
 //#define LICE_FAVOR_SIZE_EXTREME // same as LICE_FAVOR_SIZE w/ smaller gains with bigger perf penalties (solid fills etc)
+//#define LICE_NO_SIMD // disables the SSE2/AVX2/NEON paths of the blits, fills, LICE_MultiplyAddRect, LICE_Blur and LICE_DrawGlyphEx (see lice_simd.h)
 
 #ifdef LICE_FAVOR_SPEED
   #ifdef LICE_FAVOR_SIZE_EXTREME
@@ -377,6 +378,24 @@ LICE_IBitmap *LICE_LoadGIF(const char *filename, LICE_IBitmap *bmp=NULL, int *nf
 
 LICE_IBitmap *LICE_LoadPCX(const char *filename, LICE_IBitmap *bmp=NULL); // returns a bitmap (bmp if nonzero) on success
 
+// process-wide cache of decoded images (lice_imgcache.cpp, needs the PNG and JPG loaders), keyed by a hash of the file contents,
+// so that e.g. every instance of a plug-in shares one decoded copy of its skin. the bitmaps are shared and must not be modified.
+// release each image with LICE_ImageCache_Release(), the decoded bitmap is freed with the last reference.
+// if async is set, the image is decoded on a background thread: until it's done, GetState() returns 0 and GetBitmap() returns
+// a transparent placeholder of the image's size (or NULL if the size isn't known from the header)
+struct LICE_CachedImage;
+LICE_CachedImage *LICE_ImageCache_Load(const char *filename, bool async=false); // any format LICE_LoadImage() supports
+LICE_CachedImage *LICE_ImageCache_LoadFromMemory(const void *data_in, int buflen, bool async=false); // PNG or JPG
+LICE_CachedImage *LICE_ImageCache_LoadFromResource(HINSTANCE hInst, const char *resid, const char *restype="PNG", bool async=false); // win32 only, PNG or JPG
+void LICE_ImageCache_AddRef(LICE_CachedImage *img);
+void LICE_ImageCache_Release(LICE_CachedImage *img);
+int LICE_ImageCache_GetState(LICE_CachedImage *img, bool wait=false); // 1=decoded, 0=decoding, -1=failed. wait=true decodes it now if it hasn't started
+bool LICE_ImageCache_GetSize(LICE_CachedImage *img, int *w, int *h);
+LICE_IBitmap *LICE_ImageCache_GetBitmap(LICE_CachedImage *img, int level=0); // level n is downscaled by 2^n (rounded up), made on first use
+// scaled blit from the smallest level that is at least the size of the destination. returns false (and draws nothing) until decoded
+bool LICE_ImageCache_ScaledBlit(LICE_IBitmap *dest, LICE_CachedImage *img, int dstx, int dsty, int dstw, int dsth,
+                                float srcx, float srcy, float srcw, float srch, float alpha, int mode);
+
 // bitmap saving
 bool LICE_WritePNG(const char *filename, LICE_IBitmap *bmp, bool wantalpha=true);
 bool LICE_WriteJPG(const char *filename, LICE_IBitmap *bmp, int quality=95, bool force_baseline=true);
@@ -412,6 +431,11 @@ void LICE_Copy(LICE_IBitmap *dest, LICE_IBitmap *src); // resizes dest to fit
 void LICE_Blit(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, const RECT *srcrect, float alpha, int mode);
 void LICE_Blit(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int srcx, int srcy, int srcw, int srch, float alpha, int mode);
 
+// LICE_Blit, bilinear LICE_ScaledBlit and LICE_FillRect use SIMD for the copy/add/mul modes when the CPU supports it,
+// as do LICE_MultiplyAddRect, LICE_Blur and unscaled LICE_DrawGlyphEx (results are identical).
+// level: 0=scalar only, 1=SSE2/NEON, 2=AVX2, capped to what the CPU supports, or -1 to leave as is. returns the previous level
+int LICE_SetSIMDLevel(int level);
+
 void LICE_Blur(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int srcx, int srcy, int srcw, int srch);
 
 // dstw/dsty can be negative, srcw/srch can be as well (for flipping)
@@ -459,6 +483,30 @@ void LICE_DeltaBlitAlpha(LICE_IBitmap *dest, LICE_IBitmap *src,
                     double dsdxdy, double dtdxdy,
                     bool cliptosourcerect, float alpha, int mode, double dadx, double dady, double dadxdy);
 
+// multithreaded versions of the above (lice_mt.cpp), for large destinations. the destination is split into bands
+// of rows that are rendered on a pool of worker threads, with output identical to the single threaded functions.
+// if src and dest overlap, src is copied first (so the result is as if it were a separate bitmap), except for
+// LICE_MT_Blur(bm,bm,...) which gives the same result as LICE_Blur(bm,bm,...), and scaled sources, which aren't split.
+// small operations, and destinations with accelerated blits, are rendered on the calling thread.
+void LICE_MT_ScaledBlit(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int dstw, int dsth, 
+                        float srcx, float srcy, float srcw, float srch, float alpha, int mode);
+void LICE_MT_RotatedBlit(LICE_IBitmap *dest, LICE_IBitmap *src, 
+                         int dstx, int dsty, int dstw, int dsth, 
+                         float srcx, float srcy, float srcw, float srch, 
+                         float angle, 
+                         bool cliptosourcerect, float alpha, int mode,
+                         float rotxcent=0.0, float rotycent=0.0);
+void LICE_MT_TransformBlit2(LICE_IBitmap *dest, LICE_IBitmap *src,  
+                            int dstx, int dsty, int dstw, int dsth,
+                            const double *srcpoints, int div_w, int div_h,
+                            float alpha, int mode);
+void LICE_MT_Blur(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int srcx, int srcy, int srcw, int srch);
+int LICE_MT_SetThreads(int nthreads); // 0=one per CPU (default, max 16), 1=render on the calling thread only. returns the previous setting
+// stops the worker threads and waits for them. call this before the module that uses LICE_MT_* is unloaded, e.g. when the
+// last plug-in instance is destroyed (not from DllMain), since the threads can't exit while a DLL is being unloaded on Windows.
+// a later LICE_MT_* call starts them again
+void LICE_MT_Shutdown();
+
 
 // only LICE_BLIT_MODE_ADD or LICE_BLIT_MODE_COPY are used by this, for flags
 // ir-ia should be 0.0..1.0 (or outside that and they'll be clamped)
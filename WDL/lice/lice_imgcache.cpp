@@ -0,0 +1,554 @@
+/*
+  Cockos WDL - LICE - Lightweight Image Compositing Engine
+  Copyright (C) 2007 and later, Cockos Incorporated
+  File: lice_imgcache.cpp (process-wide cache of decoded images)
+  See lice.h for license and other information
+
+  Images are keyed by a hash of their encoded contents, so every caller (e.g. every instance of a
+  plug-in) that loads the same file or resource shares one decoded bitmap, and a file that changed
+  on disk is decoded again. The key of each file is remembered with its size and modification time,
+  so that loading a file that hasn't changed doesn't read it. Entries are reference counted and
+  freed with their last reference.
+
+  Images can be decoded on a background thread: until decoding finishes, LICE_ImageCache_GetBitmap()
+  returns a transparent placeholder of the image's size (read from the file header), which uses a
+  single row of memory.
+
+  Downscaled copies (level n is 1/2^n of the size, box filtered) are made on first use, and used
+  by LICE_ImageCache_ScaledBlit() so that large downscales don't skip source pixels.
+*/
+
+#include "lice.h"
+
+#include <stdio.h>
+
+#include "../wdltypes.h"
+#include "../assocarray.h"
+#include "../heapbuf.h"
+#include "../ptrlist.h"
+#include "../wdlstring.h"
+#include "../mutex.h"
+#include "../fnv64.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define LICE_IMGCACHE_MAXLEVELS 16
+
+struct LICE_CachedImage
+{
+  WDL_UINT64 key;
+  WDL_FastString filename; // if loaded from a file, for formats that LICE can't decode from memory
+  int refcnt;
+
+  int state; // 0=not yet decoded, 1=decoded, -1=failed
+  bool claimed; // a thread is decoding it
+  int w, h; // from the header, 0 if not known before decoding
+
+  WDL_HeapBuf data; // encoded image, freed once decoded
+  LICE_IBitmap *bm;
+
+  LICE_WrapperBitmap *placeholder;
+  LICE_pixel *placeholder_row;
+
+  LICE_IBitmap *levels[LICE_IMGCACHE_MAXLEVELS]; // [0] is unused, bm is level 0
+};
+
+// the key of the last contents read from a file, so that loading an unchanged file doesn't need to read it again
+struct LICE_ImageCache_FileRec
+{
+  WDL_UINT64 key;
+  WDL_INT64 size, mtime;
+};
+
+static int LICE_ImageCache_KeyCmp(WDL_UINT64 *a, WDL_UINT64 *b) { return *a < *b ? -1 : *a > *b ? 1 : 0; }
+
+static WDL_Mutex s_imgcache_mutex;
+static WDL_AssocArray<WDL_UINT64, LICE_CachedImage *> s_imgcache(LICE_ImageCache_KeyCmp);
+static WDL_StringKeyedArray<LICE_ImageCache_FileRec> s_imgcache_files;
+static WDL_PtrList<LICE_CachedImage> s_imgcache_queue;
+static bool s_imgcache_thread_running;
+
+#ifdef _WIN32
+static HANDLE s_imgcache_thread;
+#else
+static pthread_t s_imgcache_thread;
+static bool s_imgcache_thread_valid;
+#endif
+
+
+static void LICE_ImageCache_Free(LICE_CachedImage *img)
+{
+  for (int i = 1; i < LICE_IMGCACHE_MAXLEVELS; i ++) delete img->levels[i];
+  delete img->placeholder;
+  free(img->placeholder_row);
+  delete img->bm;
+  delete img;
+}
+
+static int rd_be32(const unsigned char *p) { return (p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3]; }
+static int rd_be16(const unsigned char *p) { return (p[0]<<8)|p[1]; }
+static int rd_le16(const unsigned char *p) { return p[0]|(p[1]<<8); }
+static int rd_le32(const unsigned char *p) { return p[0]|(p[1]<<8)|(p[2]<<16)|(p[3]<<24); }
+
+// reads the dimensions from a PNG, JPEG, GIF or BMP header
+static bool LICE_ImageCache_GetHeaderSize(const unsigned char *p, int len, int *w, int *h)
+{
+  if (len >= 24 && !memcmp(p,"\x89PNG\r\n\x1a\n",8) && !memcmp(p+12,"IHDR",4))
+  {
+    *w = rd_be32(p+16);
+    *h = rd_be32(p+20);
+  }
+  else if (len >= 10 && (!memcmp(p,"GIF87a",6) || !memcmp(p,"GIF89a",6)))
+  {
+    *w = rd_le16(p+6);
+    *h = rd_le16(p+8);
+  }
+  else if (len >= 26 && p[0] == 'B' && p[1] == 'M')
+  {
+    *w = rd_le32(p+18);
+    *h = rd_le32(p+22);
+    if (*h < 0) *h = -*h;
+  }
+  else if (len >= 4 && p[0] == 0xff && p[1] == 0xd8)
+  {
+    // walk the markers up to the first SOFn
+    int pos = 2;
+    for (;;)
+    {
+      if (pos + 4 > len || p[pos] != 0xff) return false;
+      const int marker = p[pos+1];
+      if (marker == 0xff) { pos++; continue; }
+      if (marker == 0xd8 || (marker >= 0xd0 && marker <= 0xd7)) { pos += 2; continue; }
+      const int seglen = rd_be16(p+pos+2);
+      if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc)
+      {
+        if (pos + 9 > len) return false;
+        *h = rd_be16(p+pos+5);
+        *w = rd_be16(p+pos+7);
+        break;
+      }
+      if (seglen < 2) return false;
+      pos += 2 + seglen;
+    }
+  }
+  else return false;
+
+  return *w > 0 && *h > 0 && *w <= 65536 && *h <= 65536;
+}
+
+static bool LICE_ImageCache_StatFile(const char *filename, WDL_INT64 *size, WDL_INT64 *mtime)
+{
+#ifdef _WIN32
+  struct _stat64 st;
+  WCHAR wf[2048];
+  if (!MultiByteToWideChar(CP_UTF8,MB_ERR_INVALID_CHARS,filename,-1,wf,2048) || _wstat64(wf,&st))
+    if (_stat64(filename,&st)) return false;
+#else
+  struct stat st;
+  if (stat(filename,&st)) return false;
+#endif
+  *size = (WDL_INT64)st.st_size;
+  *mtime = (WDL_INT64)st.st_mtime;
+  return true;
+}
+
+static bool LICE_ImageCache_ReadFile(const char *filename, WDL_HeapBuf *buf)
+{
+  FILE *fp = NULL;
+#if defined(_WIN32) && !defined(WDL_NO_SUPPORT_UTF8)
+  #ifdef WDL_SUPPORT_WIN9X
+  if (GetVersion()<0x80000000)
+  #endif
+  {
+    WCHAR wf[2048];
+    if (MultiByteToWideChar(CP_UTF8,MB_ERR_INVALID_CHARS,filename,-1,wf,2048))
+      fp = _wfopen(wf,L"rb");
+  }
+#endif
+
+  if (!fp) fp = WDL_fopenA(filename,"rb");
+  if (!fp) return false;
+
+  fseek(fp,0,SEEK_END);
+  const long len = ftell(fp);
+  fseek(fp,0,SEEK_SET);
+
+  bool ok = len > 0 && len < 0x7fffffff && buf->ResizeOK((int)len,false) && fread(buf->Get(),1,len,fp) == (size_t)len;
+  fclose(fp);
+  return ok;
+}
+
+// called without the lock held, once per image by whichever thread claimed it
+static void LICE_ImageCache_Decode(LICE_CachedImage *img)
+{
+  const unsigned char *p = (const unsigned char *)img->data.Get();
+  const int len = img->data.GetSize();
+
+  // the loaders leave a passed bitmap alone if they fail
+  LICE_MemBitmap *mb = new LICE_MemBitmap;
+  LICE_IBitmap *bm = NULL;
+  if (len >= 8 && !memcmp(p,"\x89PNG",4)) bm = LICE_LoadPNGFromMemory(p,len,mb);
+  else if (len >= 4 && p[0] == 0xff && p[1] == 0xd8) bm = LICE_LoadJPGFromMemory(p,len,mb);
+  if (!bm && img->filename.GetLength()) bm = LICE_LoadImage(img->filename.Get(),mb,true); // other formats, via whichever loaders are linked
+  if (!bm) delete mb;
+
+  WDL_MutexLock lock(&s_imgcache_mutex);
+  img->bm = bm;
+  img->state = bm ? 1 : -1;
+  if (bm)
+  {
+    img->w = bm->getWidth();
+    img->h = bm->getHeight();
+  }
+  img->data.Resize(0,true);
+}
+
+#ifdef _WIN32
+static unsigned WINAPI LICE_ImageCache_ThreadProc(void *p)
+#else
+static void *LICE_ImageCache_ThreadProc(void *p)
+#endif
+{
+  for (;;)
+  {
+    s_imgcache_mutex.Enter();
+    LICE_CachedImage *img = s_imgcache_queue.Get(0);
+    if (!img)
+    {
+      s_imgcache_thread_running = false;
+      s_imgcache_mutex.Leave();
+      break;
+    }
+    s_imgcache_queue.Delete(0);
+    const bool claim = !img->claimed;
+    img->claimed = true;
+    s_imgcache_mutex.Leave();
+
+    if (claim) LICE_ImageCache_Decode(img);
+    LICE_ImageCache_Release(img); // the queue's reference
+  }
+  return 0;
+}
+
+// on Windows the thread can't exit while a DLL that is being unloaded holds the loader lock, so don't wait forever then
+static void LICE_ImageCache_JoinThread(bool unloading=false)
+{
+#ifdef _WIN32
+  if (s_imgcache_thread)
+  {
+    WaitForSingleObject(s_imgcache_thread,unloading ? 500 : INFINITE);
+    CloseHandle(s_imgcache_thread);
+    s_imgcache_thread = NULL;
+  }
+#else
+  if (s_imgcache_thread_valid)
+  {
+    pthread_join(s_imgcache_thread,NULL);
+    s_imgcache_thread_valid = false;
+  }
+#endif
+}
+
+// called with the lock held. decodes on the calling thread if nobody has started yet, otherwise waits
+static void LICE_ImageCache_Finish(LICE_CachedImage *img)
+{
+  while (!img->state)
+  {
+    if (!img->claimed)
+    {
+      img->claimed = true;
+      s_imgcache_mutex.Leave();
+      LICE_ImageCache_Decode(img);
+      s_imgcache_mutex.Enter();
+      break;
+    }
+    s_imgcache_mutex.Leave();
+#ifdef _WIN32
+    Sleep(1);
+#else
+    usleep(1000);
+#endif
+    s_imgcache_mutex.Enter();
+  }
+}
+
+// drops images that are still queued, and waits for the thread, when the process exits or the module is unloaded
+static struct LICE_ImageCache_Shutdown
+{
+  ~LICE_ImageCache_Shutdown()
+  {
+    s_imgcache_mutex.Enter();
+    WDL_PtrList<LICE_CachedImage> queue;
+    for (int i = 0; i < s_imgcache_queue.GetSize(); i ++) queue.Add(s_imgcache_queue.Get(i));
+    s_imgcache_queue.Empty();
+    s_imgcache_mutex.Leave();
+
+    LICE_ImageCache_JoinThread(true);
+    for (int i = 0; i < queue.GetSize(); i ++) LICE_ImageCache_Release(queue.Get(i));
+  }
+} s_imgcache_shutdown;
+
+// called with the lock held. the thread exits when the queue is empty
+static void LICE_ImageCache_Enqueue(LICE_CachedImage *img)
+{
+  if (s_imgcache_queue.Find(img) >= 0) return;
+  img->refcnt++;
+  s_imgcache_queue.Add(img);
+  if (s_imgcache_thread_running) return;
+
+  LICE_ImageCache_JoinThread(); // a previous thread that has emptied the queue, and is exiting
+  s_imgcache_thread_running = true;
+#ifdef _WIN32
+  unsigned int id;
+  s_imgcache_thread = (HANDLE)_beginthreadex(NULL,0,LICE_ImageCache_ThreadProc,NULL,0,&id);
+  if (!s_imgcache_thread) s_imgcache_thread_running = false;
+#else
+  s_imgcache_thread_valid = !pthread_create(&s_imgcache_thread,NULL,LICE_ImageCache_ThreadProc,NULL);
+  if (!s_imgcache_thread_valid) s_imgcache_thread_running = false;
+#endif
+  if (!s_imgcache_thread_running) // decode on the calling thread instead
+  {
+    s_imgcache_queue.Delete(s_imgcache_queue.GetSize()-1);
+    img->refcnt--;
+    LICE_ImageCache_Finish(img);
+  }
+}
+
+// takes ownership of data
+static LICE_CachedImage *LICE_ImageCache_Add(WDL_HeapBuf *data, const char *filename, bool async)
+{
+  const int len = data->GetSize();
+  WDL_UINT64 key = WDL_FNV64(WDL_FNV64_IV,(const unsigned char *)data->Get(),len);
+  key = WDL_FNV64(key,(const unsigned char *)&len,sizeof(len));
+
+  LICE_CachedImage *img;
+  {
+    WDL_MutexLock lock(&s_imgcache_mutex);
+    img = s_imgcache.Get(key);
+    if (img)
+    {
+      img->refcnt++;
+    }
+    else
+    {
+      img = new LICE_CachedImage;
+      img->key = key;
+      if (filename) img->filename.Set(filename);
+      img->refcnt = 1;
+      img->state = 0;
+      img->claimed = false;
+      img->w = img->h = 0;
+      LICE_ImageCache_GetHeaderSize((const unsigned char *)data->Get(),len,&img->w,&img->h);
+      img->data.CopyFrom(data,false);
+      img->bm = NULL;
+      img->placeholder = NULL;
+      img->placeholder_row = NULL;
+      memset(img->levels,0,sizeof(img->levels));
+      s_imgcache.Insert(key,img);
+    }
+
+    if (!async) LICE_ImageCache_Finish(img);
+    else if (!img->state && !img->claimed) LICE_ImageCache_Enqueue(img);
+  }
+  return img;
+}
+
+LICE_CachedImage *LICE_ImageCache_Load(const char *filename, bool async)
+{
+  if (!filename || !*filename) return NULL;
+
+  WDL_INT64 size = 0, mtime = 0;
+  const bool has_stat = LICE_ImageCache_StatFile(filename,&size,&mtime);
+  if (has_stat)
+  {
+    WDL_MutexLock lock(&s_imgcache_mutex);
+    const LICE_ImageCache_FileRec *rec = s_imgcache_files.GetPtr(filename);
+    LICE_CachedImage *img = rec && rec->size == size && rec->mtime == mtime ? s_imgcache.Get(rec->key) : NULL;
+    if (img)
+    {
+      img->refcnt++;
+      if (!async) LICE_ImageCache_Finish(img);
+      else if (!img->state && !img->claimed) LICE_ImageCache_Enqueue(img);
+      return img;
+    }
+  }
+
+  WDL_HeapBuf data;
+  if (!LICE_ImageCache_ReadFile(filename,&data)) return NULL;
+  LICE_CachedImage *img = LICE_ImageCache_Add(&data,filename,async);
+  if (img && has_stat)
+  {
+    WDL_MutexLock lock(&s_imgcache_mutex);
+    const LICE_ImageCache_FileRec rec = { img->key, size, mtime };
+    s_imgcache_files.Insert(filename,rec);
+  }
+  return img;
+}
+
+LICE_CachedImage *LICE_ImageCache_LoadFromMemory(const void *data_in, int buflen, bool async)
+{
+  if (!data_in || buflen < 4) return NULL;
+  WDL_HeapBuf data;
+  if (!data.ResizeOK(buflen,false)) return NULL;
+  memcpy(data.Get(),data_in,buflen);
+  return LICE_ImageCache_Add(&data,NULL,async);
+}
+
+LICE_CachedImage *LICE_ImageCache_LoadFromResource(HINSTANCE hInst, const char *resid, const char *restype, bool async)
+{
+#ifdef _WIN32
+  HRSRC hResource = FindResource(hInst, resid, restype);
+  if(!hResource) return NULL;
+
+  DWORD imageSize = SizeofResource(hInst, hResource);
+  if(imageSize < 8) return NULL;
+
+  HGLOBAL res = LoadResource(hInst, hResource);
+  const void* pResourceData = LockResource(res);
+  if(!pResourceData) return NULL;
+
+  return LICE_ImageCache_LoadFromMemory(pResourceData,imageSize,async);
+#else
+  return NULL;
+#endif
+}
+
+void LICE_ImageCache_AddRef(LICE_CachedImage *img)
+{
+  if (!img) return;
+  WDL_MutexLock lock(&s_imgcache_mutex);
+  img->refcnt++;
+}
+
+void LICE_ImageCache_Release(LICE_CachedImage *img)
+{
+  if (!img) return;
+  {
+    WDL_MutexLock lock(&s_imgcache_mutex);
+    if (--img->refcnt > 0) return;
+    s_imgcache.Delete(img->key);
+  }
+  LICE_ImageCache_Free(img);
+}
+
+int LICE_ImageCache_GetState(LICE_CachedImage *img, bool wait)
+{
+  if (!img) return -1;
+  WDL_MutexLock lock(&s_imgcache_mutex);
+  if (wait) LICE_ImageCache_Finish(img);
+  return img->state;
+}
+
+bool LICE_ImageCache_GetSize(LICE_CachedImage *img, int *w, int *h)
+{
+  if (!img) return false;
+  WDL_MutexLock lock(&s_imgcache_mutex);
+  if (w) *w = img->w;
+  if (h) *h = img->h;
+  return img->w > 0 && img->h > 0;
+}
+
+// averages 2x2 blocks of src (the last row/column is repeated for odd sizes)
+static void LICE_ImageCache_Downsample(LICE_IBitmap *src, LICE_IBitmap *dest)
+{
+  const int sw = src->getWidth(), sh = src->getHeight(), dw = dest->getWidth(), dh = dest->getHeight();
+  int sspan = src->getRowSpan(), dspan = dest->getRowSpan();
+  const LICE_pixel *sp = src->getBits();
+  LICE_pixel *dp = dest->getBits();
+  if (src->isFlipped()) { sp += (sh-1)*sspan; sspan = -sspan; }
+  if (dest->isFlipped()) { dp += (dh-1)*dspan; dspan = -dspan; }
+
+  for (int y = 0; y < dh; y ++)
+  {
+    const LICE_pixel *r0 = sp + (y*2)*sspan;
+    const LICE_pixel *r1 = y*2+1 < sh ? r0 + sspan : r0;
+    for (int x = 0; x < dw; x ++)
+    {
+      const int x0 = x*2, x1 = x*2+1 < sw ? x*2+1 : x*2;
+      const LICE_pixel a = r0[x0], b = r0[x1], c = r1[x0], d = r1[x1];
+      dp[x] = LICE_RGBA(
+        (LICE_GETR(a)+LICE_GETR(b)+LICE_GETR(c)+LICE_GETR(d)+2)>>2,
+        (LICE_GETG(a)+LICE_GETG(b)+LICE_GETG(c)+LICE_GETG(d)+2)>>2,
+        (LICE_GETB(a)+LICE_GETB(b)+LICE_GETB(c)+LICE_GETB(d)+2)>>2,
+        (LICE_GETA(a)+LICE_GETA(b)+LICE_GETA(c)+LICE_GETA(d)+2)>>2);
+    }
+    dp += dspan;
+  }
+}
+
+LICE_IBitmap *LICE_ImageCache_GetBitmap(LICE_CachedImage *img, int level)
+{
+  if (!img || level < 0) return NULL;
+  WDL_MutexLock lock(&s_imgcache_mutex);
+
+  if (!img->state)
+  {
+    if (level || img->w < 1 || img->h < 1) return NULL;
+    if (!img->placeholder)
+    {
+      // one transparent row, repeated with a span of 0
+      img->placeholder_row = (LICE_pixel *)calloc(img->w,sizeof(LICE_pixel));
+      if (!img->placeholder_row) return NULL;
+      img->placeholder = new LICE_WrapperBitmap(img->placeholder_row,img->w,img->h,0,false);
+    }
+    return img->placeholder;
+  }
+
+  if (!img->bm || !level) return img->bm;
+  if (level >= LICE_IMGCACHE_MAXLEVELS) level = LICE_IMGCACHE_MAXLEVELS-1;
+
+  LICE_IBitmap *src = img->bm;
+  for (int i = 1; i <= level; i ++)
+  {
+    if (!img->levels[i])
+    {
+      const int w = (src->getWidth()+1)/2, h = (src->getHeight()+1)/2;
+      if (w == src->getWidth() && h == src->getHeight()) return src; // 1x1
+      LICE_MemBitmap *bm = new LICE_MemBitmap(w,h);
+      if (bm->getWidth() != w || bm->getHeight() != h) { delete bm; return src; }
+      LICE_ImageCache_Downsample(src,bm);
+      img->levels[i] = bm;
+    }
+    src = img->levels[i];
+  }
+  return src;
+}
+
+bool LICE_ImageCache_ScaledBlit(LICE_IBitmap *dest, LICE_CachedImage *img, int dstx, int dsty, int dstw, int dsth,
+                                float srcx, float srcy, float srcw, float srch, float alpha, int mode)
+{
+  if (!dest || !img || LICE_ImageCache_GetState(img,false) != 1) return false;
+
+  // the destination size in pixels
+  float dw = (float) (dstw < 0 ? -dstw : dstw), dh = (float) (dsth < 0 ? -dsth : dsth);
+  const int sc = (int)dest->Extended(LICE_EXT_GET_SCALING,NULL);
+  if (sc > 0 && !(mode&LICE_BLIT_IGNORE_SCALING)) { dw = dw*sc/256.0f; dh = dh*sc/256.0f; }
+
+  // the smallest level that is still at least the size of the destination
+  int level = 0;
+  float f = 0.5f;
+  while (level < LICE_IMGCACHE_MAXLEVELS-1 && dw > 0.0f && dh > 0.0f && srcw*f >= dw && srch*f >= dh)
+  {
+    level++;
+    f *= 0.5f;
+  }
+
+  LICE_IBitmap *bm = LICE_ImageCache_GetBitmap(img,level);
+  if (!bm) return false;
+
+  // levels are rounded up for odd sizes, and stop at 1x1
+  int w0 = 1, h0 = 1;
+  LICE_ImageCache_GetSize(img,&w0,&h0);
+  const float fx = bm->getWidth() / (float)w0, fy = bm->getHeight() / (float)h0;
+
+  LICE_ScaledBlit(dest,bm,dstx,dsty,dstw,dsth,srcx*fx,srcy*fy,srcw*fx,srch*fy,alpha,mode);
+  return true;
+}
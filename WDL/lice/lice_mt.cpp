@@ -0,0 +1,532 @@
+/*
+  Cockos WDL - LICE - Lightweight Image Compositing Engine
+  Copyright (C) 2007 and later, Cockos Incorporated
+  File: lice_mt.cpp (tile-parallel rendering on a worker pool)
+  See lice.h for license and other information
+
+  The LICE_MT_* functions split the destination of an operation into bands of rows and render
+  the bands on a pool of worker threads (the calling thread renders bands too). Each band is
+  rendered by the *Band() functions in lice.cpp, which write every row exactly as the full,
+  single-threaded call would, so the output doesn't depend on the number of threads or on
+  scheduling.
+
+  If src and dest share memory, the source is copied first so that no band reads rows that
+  another band writes.
+*/
+
+#include "lice.h"
+#include "lice_mt.h"
+#include "lice_extended.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define LICE_MT_MAXTHREADS 16
+#define LICE_MT_MINBANDROWS 16 // don't split into bands smaller than this
+#define LICE_MT_MINPIXELS 65536 // render smaller operations on the calling thread
+#define LICE_MT_BANDSPERTHREAD 4 // more bands than threads, so that uneven bands (e.g. rotated blits) balance out
+
+typedef void (*LICE_MT_BandFunc)(void *ctx, const LICE_RowBand *band);
+
+class LICE_MT_Pool
+{
+public:
+  LICE_MT_Pool()
+  {
+    m_nthreads_want = 0;
+    m_nthreads = 0;
+    m_quit = false;
+    m_busy = false;
+    m_func = NULL;
+    m_ctx = NULL;
+    m_bands = NULL;
+    m_nbands = m_nextband = m_bandsdone = 0;
+#ifdef _WIN32
+    InitializeCriticalSection(&m_cs);
+    InitializeConditionVariable(&m_workcond);
+    InitializeConditionVariable(&m_donecond);
+#else
+    pthread_mutex_init(&m_mutex,NULL);
+    pthread_cond_init(&m_workcond,NULL);
+    pthread_cond_init(&m_donecond,NULL);
+#endif
+  }
+
+  // LICE_MT_Shutdown() should have stopped the threads by now. If it wasn't called, this runs while the module
+  // is unloaded (or the process exits), when the threads may not be able to exit on Windows: any that are still
+  // running are then left alone, along with the lock they use
+  ~LICE_MT_Pool()
+  {
+    if (!StopThreads(true)) return;
+#ifdef _WIN32
+    DeleteCriticalSection(&m_cs);
+#else
+    pthread_cond_destroy(&m_donecond);
+    pthread_cond_destroy(&m_workcond);
+    pthread_mutex_destroy(&m_mutex);
+#endif
+  }
+
+  // 0=one per CPU, 1=no worker threads. The threads are started/stopped on the next Run()
+  int SetThreads(int n)
+  {
+    Lock();
+    const int prev = m_nthreads_want;
+    m_nthreads_want = n < 0 ? 0 : n;
+    Unlock();
+    return prev;
+  }
+
+  int GetThreads()
+  {
+    Lock();
+    int n = m_nthreads_want;
+    Unlock();
+    if (n < 1)
+    {
+#ifdef _WIN32
+      SYSTEM_INFO si;
+      GetSystemInfo(&si);
+      n = (int)si.dwNumberOfProcessors;
+#else
+      n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+    return n < 1 ? 1 : n > LICE_MT_MAXTHREADS ? LICE_MT_MAXTHREADS : n;
+  }
+
+  // renders all bands and returns when they're done. If another thread is using the pool, the bands are rendered on the calling thread
+  void Run(LICE_MT_BandFunc func, void *ctx, const LICE_RowBand *bands, int nbands)
+  {
+    const int nthreads = GetThreads();
+
+    Lock();
+    if (m_busy)
+    {
+      Unlock();
+      for (int i = 0; i < nbands; i ++) func(ctx,bands+i);
+      return;
+    }
+    m_busy = true;
+    Unlock();
+
+    if (m_nthreads != nthreads - 1)
+    {
+      StopThreads();
+      StartThreads(nthreads - 1);
+    }
+
+    Lock();
+    if (!m_nthreads)
+    {
+      m_busy = false;
+      Unlock();
+      for (int i = 0; i < nbands; i ++) func(ctx,bands+i);
+      return;
+    }
+    m_func = func;
+    m_ctx = ctx;
+    m_bands = bands;
+    m_nbands = nbands;
+    m_nextband = 0;
+    m_bandsdone = 0;
+    WakeAll(true);
+
+    RunBands();
+
+    while (m_bandsdone < m_nbands) Wait(false);
+
+    m_nbands = m_nextband = m_bandsdone = 0;
+    m_func = NULL;
+    m_ctx = NULL;
+    m_bands = NULL;
+    m_busy = false;
+    WakeAll(false); // for Shutdown()
+    Unlock();
+  }
+
+  // stops the worker threads and waits for them to exit, after any Run() in progress. The next Run() starts them again
+  void Shutdown()
+  {
+    Lock();
+    while (m_busy) Wait(false);
+    m_busy = true;
+    Unlock();
+
+    StopThreads();
+
+    Lock();
+    m_busy = false;
+    WakeAll(false);
+    Unlock();
+  }
+
+private:
+  // called with the lock held, renders bands until there are none left to claim
+  void RunBands()
+  {
+    while (m_nextband < m_nbands)
+    {
+      const int idx = m_nextband++;
+      LICE_MT_BandFunc func = m_func;
+      void *ctx = m_ctx;
+      const LICE_RowBand *band = m_bands + idx;
+
+      Unlock();
+      func(ctx,band);
+      Lock();
+
+      if (++m_bandsdone == m_nbands) WakeAll(false);
+    }
+  }
+
+  void ThreadProc()
+  {
+    Lock();
+    while (!m_quit)
+    {
+      if (m_nextband < m_nbands) RunBands();
+      else Wait(true);
+    }
+    Unlock();
+  }
+
+  void StartThreads(int n)
+  {
+    m_quit = false;
+    m_nthreads = 0;
+    for (int i = 0; i < n; i ++)
+    {
+#ifdef _WIN32
+      unsigned int id;
+      m_threads[m_nthreads] = (HANDLE)_beginthreadex(NULL,0,_threadfunc,this,0,&id);
+      if (m_threads[m_nthreads]) m_nthreads++;
+#else
+      if (!pthread_create(&m_threads[m_nthreads],NULL,_threadfunc,this)) m_nthreads++;
+#endif
+    }
+  }
+
+  // on Windows the threads can't exit while a DLL that is being unloaded holds the loader lock, so don't wait forever then.
+  // returns false if some threads were still running after the timeout, they are detached and will exit when they can
+  bool StopThreads(bool unloading=false)
+  {
+    if (!m_nthreads) return true;
+
+    Lock();
+    m_quit = true;
+    WakeAll(true);
+    Unlock();
+
+    bool exited = true;
+    for (int i = 0; i < m_nthreads; i ++)
+    {
+#ifdef _WIN32
+      if (WaitForSingleObject(m_threads[i],unloading ? 500 : INFINITE) != WAIT_OBJECT_0) exited = false;
+      CloseHandle(m_threads[i]);
+#else
+      pthread_join(m_threads[i],NULL);
+#endif
+    }
+    m_nthreads = 0;
+    if (exited) m_quit = false; // threads that are still running need to see m_quit when they wake up
+    return exited;
+  }
+
+#ifdef _WIN32
+  static unsigned WINAPI _threadfunc(void *p) { ((LICE_MT_Pool *)p)->ThreadProc(); return 0; }
+  void Lock() { EnterCriticalSection(&m_cs); }
+  void Unlock() { LeaveCriticalSection(&m_cs); }
+  void Wait(bool work) { SleepConditionVariableCS(work ? &m_workcond : &m_donecond,&m_cs,INFINITE); }
+  void WakeAll(bool work) { WakeAllConditionVariable(work ? &m_workcond : &m_donecond); }
+
+  CRITICAL_SECTION m_cs;
+  CONDITION_VARIABLE m_workcond, m_donecond;
+  HANDLE m_threads[LICE_MT_MAXTHREADS];
+#else
+  static void *_threadfunc(void *p) { ((LICE_MT_Pool *)p)->ThreadProc(); return NULL; }
+  void Lock() { pthread_mutex_lock(&m_mutex); }
+  void Unlock() { pthread_mutex_unlock(&m_mutex); }
+  void Wait(bool work) { pthread_cond_wait(work ? &m_workcond : &m_donecond,&m_mutex); }
+  void WakeAll(bool work) { pthread_cond_broadcast(work ? &m_workcond : &m_donecond); }
+
+  pthread_mutex_t m_mutex;
+  pthread_cond_t m_workcond, m_donecond;
+  pthread_t m_threads[LICE_MT_MAXTHREADS];
+#endif
+
+  int m_nthreads_want, m_nthreads;
+  bool m_quit, m_busy;
+
+  LICE_MT_BandFunc m_func;
+  void *m_ctx;
+  const LICE_RowBand *m_bands;
+  int m_nbands, m_nextband, m_bandsdone;
+};
+
+static LICE_MT_Pool s_lice_mt_pool;
+
+int LICE_MT_SetThreads(int nthreads)
+{
+  return s_lice_mt_pool.SetThreads(nthreads);
+}
+
+void LICE_MT_Shutdown()
+{
+  s_lice_mt_pool.Shutdown();
+}
+
+static int LICE_MT_GetBitsSize(LICE_IBitmap *bm)
+{
+  int h = bm->getHeight();
+  const int sc = (int)bm->Extended(LICE_EXT_GET_SCALING,NULL);
+  if (sc > 0) h = (h*sc)>>8;
+  return bm->getRowSpan() * h * (int)sizeof(LICE_pixel);
+}
+
+static bool LICE_MT_Overlaps(LICE_IBitmap *a, LICE_IBitmap *b)
+{
+  const char *pa = (const char *)a->getBits(), *pb = (const char *)b->getBits();
+  if (!pa || !pb) return false;
+  return pa < pb + LICE_MT_GetBitsSize(b) && pb < pa + LICE_MT_GetBitsSize(a);
+}
+
+// splits the destination rows y1..y2 (unscaled, as passed to the LICE function) into bands. The bands
+// always cover the whole (scaled) destination bitmap, so that rounding of y1/y2 can't leave rows out.
+// Returns the number of bands, or 0 if the operation should be rendered in one go
+static int LICE_MT_MakeBands(LICE_IBitmap *dest, bool scaled, int mode, int y1, int y2, int w, LICE_RowBand *bands, int maxbands)
+{
+  int destbm_h = dest->getHeight();
+  const int sc = scaled ? (int)dest->Extended(LICE_EXT_GET_SCALING,NULL) : 0;
+  if (sc > 0)
+  {
+    destbm_h = (destbm_h*sc)>>8;
+    if (!(mode&LICE_BLIT_IGNORE_SCALING))
+    {
+      y1 = (y1*sc)/256;
+      y2 = (y2*sc)/256;
+      w = (w*sc)/256;
+    }
+  }
+  if (y2 < y1) { const int t = y1; y1 = y2; y2 = t; }
+  if (w < 0) w = -w;
+  if (y1 < 0) y1 = 0;
+  if (y2 > destbm_h) y2 = destbm_h;
+
+  const int h = y2 - y1;
+  if (h < 2*LICE_MT_MINBANDROWS || h * (double)w < LICE_MT_MINPIXELS) return 0;
+
+  const int nthreads = s_lice_mt_pool.GetThreads();
+  if (nthreads < 2) return 0;
+
+  int nb = nthreads * LICE_MT_BANDSPERTHREAD;
+  if (nb > h / LICE_MT_MINBANDROWS) nb = h / LICE_MT_MINBANDROWS;
+  if (nb > maxbands) nb = maxbands;
+
+  for (int i = 0; i < nb; i ++)
+  {
+    bands[i].top = i ? y1 + (int)((h * (double)i) / nb) : 0;
+    bands[i].bottom = i < nb-1 ? y1 + (int)((h * (double)(i+1)) / nb) : destbm_h;
+  }
+  return nb;
+}
+
+#define LICE_MT_MAXBANDS (LICE_MT_MAXTHREADS*LICE_MT_BANDSPERTHREAD)
+
+// copies src if it shares memory with dest. returns the bitmap to read from, or NULL if the operation
+// should be rendered in one go (a scaled source can't be copied without losing its scaling)
+static LICE_IBitmap *LICE_MT_GetSource(LICE_IBitmap *dest, LICE_IBitmap *src, LICE_MemBitmap *tmp)
+{
+  if (!LICE_MT_Overlaps(dest,src)) return src;
+  if ((int)src->Extended(LICE_EXT_GET_SCALING,NULL) > 0) return NULL;
+  LICE_Copy(tmp,src);
+  return tmp;
+}
+
+struct LICE_MT_ScaledBlitCtx
+{
+  LICE_IBitmap *dest, *src;
+  int dstx, dsty, dstw, dsth;
+  float srcx, srcy, srcw, srch, alpha;
+  int mode;
+
+  static void band(void *p, const LICE_RowBand *band)
+  {
+    const LICE_MT_ScaledBlitCtx *c = (const LICE_MT_ScaledBlitCtx *)p;
+    LICE_ScaledBlitBand(c->dest,c->src,c->dstx,c->dsty,c->dstw,c->dsth,c->srcx,c->srcy,c->srcw,c->srch,c->alpha,c->mode,band);
+  }
+};
+
+void LICE_MT_ScaledBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
+                        int dstx, int dsty, int dstw, int dsth,
+                        float srcx, float srcy, float srcw, float srch,
+                        float alpha, int mode)
+{
+  if (!dest || !src) return;
+
+  LICE_RowBand bands[LICE_MT_MAXBANDS];
+  const int nb = LICE_MT_MakeBands(dest,true,mode,dsty,dsty+dsth,dstw,bands,LICE_MT_MAXBANDS);
+
+  LICE_MemBitmap tmp;
+  LICE_IBitmap *rdsrc = LICE_MT_GetSource(dest,src,&tmp);
+
+  if (!nb || !rdsrc || dest->Extended(LICE_EXT_SUPPORTS_ID,(void*)LICE_EXT_SCALEDBLIT_ACCEL))
+  {
+    LICE_ScaledBlit(dest,rdsrc ? rdsrc : src,dstx,dsty,dstw,dsth,srcx,srcy,srcw,srch,alpha,mode);
+    return;
+  }
+
+  LICE_MT_ScaledBlitCtx ctx = { dest, rdsrc, dstx, dsty, dstw, dsth, srcx, srcy, srcw, srch, alpha, mode };
+  s_lice_mt_pool.Run(LICE_MT_ScaledBlitCtx::band,&ctx,bands,nb);
+}
+
+struct LICE_MT_RotatedBlitCtx
+{
+  LICE_IBitmap *dest, *src;
+  int dstx, dsty, dstw, dsth;
+  float srcx, srcy, srcw, srch, angle;
+  bool cliptosourcerect;
+  float alpha;
+  int mode;
+  float rotxcent, rotycent;
+
+  static void band(void *p, const LICE_RowBand *band)
+  {
+    const LICE_MT_RotatedBlitCtx *c = (const LICE_MT_RotatedBlitCtx *)p;
+    LICE_RotatedBlitBand(c->dest,c->src,c->dstx,c->dsty,c->dstw,c->dsth,c->srcx,c->srcy,c->srcw,c->srch,c->angle,
+                         c->cliptosourcerect,c->alpha,c->mode,c->rotxcent,c->rotycent,band);
+  }
+};
+
+void LICE_MT_RotatedBlit(LICE_IBitmap *dest, LICE_IBitmap *src,
+                         int dstx, int dsty, int dstw, int dsth,
+                         float srcx, float srcy, float srcw, float srch,
+                         float angle,
+                         bool cliptosourcerect, float alpha, int mode,
+                         float rotxcent, float rotycent)
+{
+  if (!dest || !src) return;
+
+  LICE_RowBand bands[LICE_MT_MAXBANDS];
+  const int nb = LICE_MT_MakeBands(dest,true,mode,dsty,dsty+dsth,dstw,bands,LICE_MT_MAXBANDS);
+
+  LICE_MemBitmap tmp;
+  LICE_IBitmap *rdsrc = LICE_MT_GetSource(dest,src,&tmp);
+
+  if (!nb || !rdsrc)
+  {
+    LICE_RotatedBlit(dest,rdsrc ? rdsrc : src,dstx,dsty,dstw,dsth,srcx,srcy,srcw,srch,angle,cliptosourcerect,alpha,mode,rotxcent,rotycent);
+    return;
+  }
+
+  LICE_MT_RotatedBlitCtx ctx = { dest, rdsrc, dstx, dsty, dstw, dsth, srcx, srcy, srcw, srch, angle, cliptosourcerect, alpha, mode, rotxcent, rotycent };
+  s_lice_mt_pool.Run(LICE_MT_RotatedBlitCtx::band,&ctx,bands,nb);
+}
+
+struct LICE_MT_TransformBlitCtx
+{
+  LICE_IBitmap *dest, *src;
+  int dstx, dsty, dstw, dsth;
+  const double *srcpoints;
+  int div_w, div_h;
+  float alpha;
+  int mode;
+
+  static void band(void *p, const LICE_RowBand *band)
+  {
+    const LICE_MT_TransformBlitCtx *c = (const LICE_MT_TransformBlitCtx *)p;
+    LICE_TransformBlit2Band(c->dest,c->src,c->dstx,c->dsty,c->dstw,c->dsth,c->srcpoints,c->div_w,c->div_h,c->alpha,c->mode,band);
+  }
+};
+
+void LICE_MT_TransformBlit2(LICE_IBitmap *dest, LICE_IBitmap *src,
+                            int dstx, int dsty, int dstw, int dsth,
+                            const double *srcpoints, int div_w, int div_h,
+                            float alpha, int mode)
+{
+  if (!dest || !src) return;
+
+  LICE_RowBand bands[LICE_MT_MAXBANDS];
+  const int nb = LICE_MT_MakeBands(dest,true,mode,dsty,dsty+dsth,dstw,bands,LICE_MT_MAXBANDS);
+
+  LICE_MemBitmap tmp;
+  LICE_IBitmap *rdsrc = LICE_MT_GetSource(dest,src,&tmp);
+
+  if (!nb || !rdsrc)
+  {
+    LICE_TransformBlit2(dest,rdsrc ? rdsrc : src,dstx,dsty,dstw,dsth,srcpoints,div_w,div_h,alpha,mode);
+    return;
+  }
+
+  LICE_MT_TransformBlitCtx ctx = { dest, rdsrc, dstx, dsty, dstw, dsth, srcpoints, div_w, div_h, alpha, mode };
+  s_lice_mt_pool.Run(LICE_MT_TransformBlitCtx::band,&ctx,bands,nb);
+}
+
+struct LICE_MT_BlurCtx
+{
+  LICE_IBitmap *dest, *src;
+  int dstx, dsty, srcx, srcy, srcw, srch;
+
+  static void band(void *p, const LICE_RowBand *band)
+  {
+    const LICE_MT_BlurCtx *c = (const LICE_MT_BlurCtx *)p;
+    LICE_BlurBand(c->dest,c->src,c->dstx,c->dsty,c->srcx,c->srcy,c->srcw,c->srch,band);
+  }
+};
+
+void LICE_MT_Blur(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int srcx, int srcy, int srcw, int srch)
+{
+  if (!dest || !src) return;
+
+  // LICE_Blur handles src==dest itself. Blurring a bitmap to a different position in itself depends
+  // on the order rows are written in, so that is always rendered in one go
+  const bool inplace = src == dest;
+  if (inplace && (dstx != srcx || dsty != srcy))
+  {
+    LICE_Blur(dest,src,dstx,dsty,srcx,srcy,srcw,srch);
+    return;
+  }
+
+  // LICE_Blur doesn't apply scaling
+  LICE_RowBand bands[LICE_MT_MAXBANDS];
+  const int nb = LICE_MT_MakeBands(dest,false,0,dsty,dsty+srch,srcw,bands,LICE_MT_MAXBANDS);
+
+  LICE_MemBitmap tmp;
+  LICE_IBitmap *rdsrc = nb > 0 || !inplace ? LICE_MT_GetSource(dest,src,&tmp) : src;
+
+  if (!nb || !rdsrc)
+  {
+    LICE_Blur(dest,rdsrc ? rdsrc : src,dstx,dsty,srcx,srcy,srcw,srch);
+    return;
+  }
+
+  // when blurring a bitmap to itself, LICE_Blur reads the already blurred row above the last row,
+  // so leave the last row out of the bands and render it in place afterwards
+  int lastrow = -1;
+  if (inplace)
+  {
+    int top = lice_max(srcy,0), bottom = lice_min(srcy+srch,src->getHeight()), y = dsty;
+    if (y < 0) { top -= y; y = 0; }
+    bottom = lice_min(bottom,top + dest->getHeight() - y);
+    lastrow = y + bottom - top - 1;
+    for (int i = 0; i < nb; i ++)
+    {
+      if (bands[i].bottom > lastrow) bands[i].bottom = lastrow;
+      if (bands[i].top > bands[i].bottom) bands[i].top = bands[i].bottom;
+    }
+  }
+
+  LICE_MT_BlurCtx ctx = { dest, rdsrc, dstx, dsty, srcx, srcy, srcw, srch };
+  s_lice_mt_pool.Run(LICE_MT_BlurCtx::band,&ctx,bands,nb);
+
+  if (lastrow >= 0)
+  {
+    const LICE_RowBand last = { lastrow, lastrow+1 };
+    LICE_BlurBand(dest,dest,dstx,dsty,srcx,srcy,srcw,srch,&last);
+  }
+}
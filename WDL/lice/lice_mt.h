@@ -0,0 +1,45 @@
+/*
+  Cockos WDL - LICE - Lightweight Image Compositing Engine
+  File: lice_mt.h (row band entry points, used by lice_mt.cpp)
+  See lice.h for license and other information
+*/
+
+#ifndef _LICE_MT_H_
+#define _LICE_MT_H_
+
+// A range of destination rows, top up to (but not including) bottom, in the destination bitmap's
+// (scaled) pixel coordinates. The *Band() versions of the functions below only write the rows
+// in the band, and write them exactly as the full call would, so that an operation can be split
+// into bands that are rendered in any order, or in parallel if src and dest don't overlap.
+// Passing band=NULL renders everything. These are implemented in lice.cpp.
+struct LICE_RowBand
+{
+  int top, bottom;
+};
+
+void LICE_ScaledBlitBand(LICE_IBitmap *dest, LICE_IBitmap *src,
+                         int dstx, int dsty, int dstw, int dsth,
+                         float srcx, float srcy, float srcw, float srch,
+                         float alpha, int mode, const LICE_RowBand *band);
+
+void LICE_RotatedBlitBand(LICE_IBitmap *dest, LICE_IBitmap *src,
+                          int dstx, int dsty, int dstw, int dsth,
+                          float srcx, float srcy, float srcw, float srch,
+                          float angle,
+                          bool cliptosourcerect, float alpha, int mode, float rotxcent, float rotycent, const LICE_RowBand *band);
+
+void LICE_DeltaBlitBand(LICE_IBitmap *dest, LICE_IBitmap *src,
+                        int dstx, int dsty, int dstw, int dsth,
+                        float srcx, float srcy, float srcw, float srch,
+                        double dsdx, double dtdx, double dsdy, double dtdy,
+                        double dsdxdy, double dtdxdy,
+                        bool cliptosourcerect, float alpha, int mode, const LICE_RowBand *band);
+
+void LICE_TransformBlit2Band(LICE_IBitmap *dest, LICE_IBitmap *src,
+                             int dstx, int dsty, int dstw, int dsth,
+                             const double *srcpoints, int div_w, int div_h,
+                             float alpha, int mode, const LICE_RowBand *band);
+
+void LICE_BlurBand(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int dsty, int srcx, int srcy, int srcw, int srch, const LICE_RowBand *band);
+
+#endif // _LICE_MT_H_
@@ -0,0 +1,527 @@
+/*
+  Cockos WDL - LICE - Lightweight Image Compositing Engine
+  File: lice_simd.h (SIMD blit/fill paths, included by lice.cpp)
+  See lice.h for license and other information
+
+  SSE2, AVX2 and NEON (AArch64) versions of the unscaled and bilinear scaled blits and the solid fill for
+  the copy, add and multiply modes, with and without LICE_BLIT_USE_ALPHA, and of LICE_MultiplyAddRect,
+  LICE_Blur and the unscaled LICE_DrawGlyphEx. The instruction set is chosen at runtime, and the results
+  are bit-exact with the scalar code in lice.cpp and lice_combine.h.
+
+  Define LICE_NO_SIMD to disable.
+*/
+
+#ifndef _LICE_SIMD_H_
+#define _LICE_SIMD_H_
+
+#include <string.h>
+#include "../wdltypes.h"
+
+#ifndef LICE_NO_SIMD
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || (defined(__i386__) && defined(__SSE2__))
+  #define LICE_SIMD_X86
+  #include <emmintrin.h>
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  #define LICE_SIMD_NEON
+  #include <arm_neon.h>
+#endif
+
+#if defined(LICE_SIMD_X86)
+
+namespace lice_simd_sse2 {
+
+#define LICE_SIMD_N 4
+#define LICE_SIMD_FUNC
+
+typedef __m128i v8;
+typedef __m128i v16;
+typedef __m128i v32;
+
+static inline v8 load8(const LICE_pixel *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void store8(LICE_pixel *p, v8 v) { _mm_storeu_si128((__m128i *)p,v); }
+static inline v16 zero16() { return _mm_setzero_si128(); }
+static inline v16 lo16(v8 v) { return _mm_unpacklo_epi8(v,_mm_setzero_si128()); }
+static inline v16 hi16(v8 v) { return _mm_unpackhi_epi8(v,_mm_setzero_si128()); }
+static inline v8 pack16(v16 a, v16 b) { return _mm_packus_epi16(a,b); }
+static inline v16 set16(int v) { return _mm_set1_epi16((short)v); }
+static inline v16 loadlanes16(const unsigned short *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline v16 add16(v16 a, v16 b) { return _mm_add_epi16(a,b); }
+static inline v16 sub16(v16 a, v16 b) { return _mm_sub_epi16(a,b); }
+static inline v16 mullo16(v16 a, v16 b) { return _mm_mullo_epi16(a,b); }
+static inline v16 mulhi16(v16 a, v16 b) { return _mm_mulhi_epu16(a,b); }
+static inline v16 srl8_16(v16 a) { return _mm_srli_epi16(a,8); }
+static inline v16 xor16(v16 a, v16 b) { return _mm_xor_si128(a,b); }
+static inline v16 or16(v16 a, v16 b) { return _mm_or_si128(a,b); }
+static inline v16 cmpgt16(v16 a, v16 b) { return _mm_cmpgt_epi16(a,b); }
+static inline v16 cmpeq16(v16 a, v16 b) { return _mm_cmpeq_epi16(a,b); }
+static inline v16 min16(v16 a, v16 b) { return _mm_min_epi16(a,b); }
+static inline v16 sel16(v16 m, v16 a, v16 b) { return _mm_or_si128(_mm_and_si128(m,a),_mm_andnot_si128(m,b)); }
+static inline v16 alpha16(v16 a)
+{
+  return _mm_shufflehi_epi16(_mm_shufflelo_epi16(a,LICE_PIXEL_A*0x55),LICE_PIXEL_A*0x55);
+}
+static inline v8 add8(v8 a, v8 b) { return _mm_add_epi8(a,b); }
+static inline v8 half8(v8 a) { return _mm_and_si128(_mm_srli_epi16(a,1),_mm_set1_epi8(0x7f)); }
+static inline v8 quarter8(v8 a) { return _mm_and_si128(_mm_srli_epi16(a,2),_mm_set1_epi8(0x3f)); }
+static inline v8 eighth8(v8 a) { return _mm_and_si128(_mm_srli_epi16(a,3),_mm_set1_epi8(0x1f)); }
+static inline v8 spread8(const unsigned char *p)
+{
+  int v;
+  memcpy(&v,p,sizeof(v));
+  const __m128i b = _mm_cvtsi32_si128(v);
+  const __m128i b2 = _mm_unpacklo_epi8(b,b);
+  return _mm_unpacklo_epi16(b2,b2);
+}
+static inline v16 loadpx16(const LICE_pixel *p) { return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p),_mm_setzero_si128()); }
+static inline void storepx16(LICE_pixel *p, v16 v) { _mm_storel_epi64((__m128i *)p,_mm_packus_epi16(v,v)); }
+static inline v32 load32(const int *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline v16 muladd16(v16 c, v16 sc, v32 add)
+{
+  const __m128i z = _mm_setzero_si128();
+  const __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(c,z),_mm_unpacklo_epi16(sc,z)),add);
+  const __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(c,z),_mm_unpackhi_epi16(sc,z)),add);
+  return _mm_packs_epi32(_mm_srai_epi32(lo,8),_mm_srai_epi32(hi,8));
+}
+
+#include "lice_simd_impl.h"
+
+#undef LICE_SIMD_N
+#undef LICE_SIMD_FUNC
+
+} // namespace lice_simd_sse2
+
+namespace lice_simd_avx2 {
+
+#define LICE_SIMD_N 8
+#if defined(__GNUC__) || defined(__clang__)
+  #define LICE_SIMD_FUNC __attribute__((target("avx2")))
+#else
+  #define LICE_SIMD_FUNC
+#endif
+
+typedef __m256i v8;
+typedef __m256i v16;
+typedef __m256i v32;
+
+static inline LICE_SIMD_FUNC v8 load8(const LICE_pixel *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline LICE_SIMD_FUNC void store8(LICE_pixel *p, v8 v) { _mm256_storeu_si256((__m256i *)p,v); }
+static inline LICE_SIMD_FUNC v16 zero16() { return _mm256_setzero_si256(); }
+// unpack and pack both work within 128 bit halves, so the pixel order is preserved
+static inline LICE_SIMD_FUNC v16 lo16(v8 v) { return _mm256_unpacklo_epi8(v,_mm256_setzero_si256()); }
+static inline LICE_SIMD_FUNC v16 hi16(v8 v) { return _mm256_unpackhi_epi8(v,_mm256_setzero_si256()); }
+static inline LICE_SIMD_FUNC v8 pack16(v16 a, v16 b) { return _mm256_packus_epi16(a,b); }
+static inline LICE_SIMD_FUNC v16 set16(int v) { return _mm256_set1_epi16((short)v); }
+static inline LICE_SIMD_FUNC v16 loadlanes16(const unsigned short *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline LICE_SIMD_FUNC v16 add16(v16 a, v16 b) { return _mm256_add_epi16(a,b); }
+static inline LICE_SIMD_FUNC v16 sub16(v16 a, v16 b) { return _mm256_sub_epi16(a,b); }
+static inline LICE_SIMD_FUNC v16 mullo16(v16 a, v16 b) { return _mm256_mullo_epi16(a,b); }
+static inline LICE_SIMD_FUNC v16 mulhi16(v16 a, v16 b) { return _mm256_mulhi_epu16(a,b); }
+static inline LICE_SIMD_FUNC v16 srl8_16(v16 a) { return _mm256_srli_epi16(a,8); }
+static inline LICE_SIMD_FUNC v16 xor16(v16 a, v16 b) { return _mm256_xor_si256(a,b); }
+static inline LICE_SIMD_FUNC v16 or16(v16 a, v16 b) { return _mm256_or_si256(a,b); }
+static inline LICE_SIMD_FUNC v16 cmpgt16(v16 a, v16 b) { return _mm256_cmpgt_epi16(a,b); }
+static inline LICE_SIMD_FUNC v16 cmpeq16(v16 a, v16 b) { return _mm256_cmpeq_epi16(a,b); }
+static inline LICE_SIMD_FUNC v16 min16(v16 a, v16 b) { return _mm256_min_epi16(a,b); }
+static inline LICE_SIMD_FUNC v16 sel16(v16 m, v16 a, v16 b) { return _mm256_blendv_epi8(b,a,m); }
+static inline LICE_SIMD_FUNC v16 alpha16(v16 a)
+{
+  return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(a,LICE_PIXEL_A*0x55),LICE_PIXEL_A*0x55);
+}
+static inline LICE_SIMD_FUNC v8 add8(v8 a, v8 b) { return _mm256_add_epi8(a,b); }
+static inline LICE_SIMD_FUNC v8 half8(v8 a) { return _mm256_and_si256(_mm256_srli_epi16(a,1),_mm256_set1_epi8(0x7f)); }
+static inline LICE_SIMD_FUNC v8 quarter8(v8 a) { return _mm256_and_si256(_mm256_srli_epi16(a,2),_mm256_set1_epi8(0x3f)); }
+static inline LICE_SIMD_FUNC v8 eighth8(v8 a) { return _mm256_and_si256(_mm256_srli_epi16(a,3),_mm256_set1_epi8(0x1f)); }
+static inline LICE_SIMD_FUNC v8 spread8(const unsigned char *p)
+{
+  const __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p),_mm_loadl_epi64((const __m128i *)p));
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(b,b)),_mm_unpackhi_epi16(b,b),1);
+}
+// loadpx16/storepx16 keep the pixel order across both halves, unlike lo16/hi16
+static inline LICE_SIMD_FUNC v16 loadpx16(const LICE_pixel *p) { return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p)); }
+static inline LICE_SIMD_FUNC void storepx16(LICE_pixel *p, v16 v)
+{
+  _mm_storeu_si128((__m128i *)p,_mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(v,v),0x08)));
+}
+static inline LICE_SIMD_FUNC v32 load32(const int *p) { return _mm256_loadu_si256((const __m256i *)p); }
+static inline LICE_SIMD_FUNC v16 muladd16(v16 c, v16 sc, v32 add)
+{
+  const __m256i z = _mm256_setzero_si256();
+  const __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(c,z),_mm256_unpacklo_epi16(sc,z)),add);
+  const __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(c,z),_mm256_unpackhi_epi16(sc,z)),add);
+  return _mm256_packs_epi32(_mm256_srai_epi32(lo,8),_mm256_srai_epi32(hi,8));
+}
+
+#include "lice_simd_impl.h"
+
+#undef LICE_SIMD_N
+#undef LICE_SIMD_FUNC
+
+} // namespace lice_simd_avx2
+
+static int LICE_SIMD_Detect()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+  int regs[4];
+  __cpuid(regs,0);
+  if (regs[0] >= 7)
+  {
+    __cpuid(regs,1);
+    const bool osxsave = (regs[2] & (1<<27)) != 0, avx = (regs[2] & (1<<28)) != 0;
+    __cpuidex(regs,7,0);
+    if (osxsave && avx && (regs[1] & (1<<5)) && (_xgetbv(0) & 6) == 6) return 2;
+  }
+  return 1;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? 2 : 1;
+#endif
+}
+
+#elif defined(LICE_SIMD_NEON)
+
+namespace lice_simd_neon {
+
+#define LICE_SIMD_N 4
+#define LICE_SIMD_FUNC
+
+typedef uint8x16_t v8;
+typedef uint16x8_t v16;
+typedef int32x4_t v32;
+
+static inline v8 load8(const LICE_pixel *p) { return vld1q_u8((const unsigned char *)p); }
+static inline void store8(LICE_pixel *p, v8 v) { vst1q_u8((unsigned char *)p,v); }
+static inline v16 zero16() { return vdupq_n_u16(0); }
+static inline v16 lo16(v8 v) { return vmovl_u8(vget_low_u8(v)); }
+static inline v16 hi16(v8 v) { return vmovl_u8(vget_high_u8(v)); }
+static inline v8 pack16(v16 a, v16 b) { return vcombine_u8(vqmovun_s16(vreinterpretq_s16_u16(a)),vqmovun_s16(vreinterpretq_s16_u16(b))); }
+static inline v16 set16(int v) { return vdupq_n_u16((unsigned short)v); }
+static inline v16 loadlanes16(const unsigned short *p) { return vld1q_u16(p); }
+static inline v16 add16(v16 a, v16 b) { return vaddq_u16(a,b); }
+static inline v16 sub16(v16 a, v16 b) { return vsubq_u16(a,b); }
+static inline v16 mullo16(v16 a, v16 b) { return vmulq_u16(a,b); }
+static inline v16 mulhi16(v16 a, v16 b)
+{
+  return vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(a),vget_low_u16(b)),16),
+                      vshrn_n_u32(vmull_high_u16(a,b),16));
+}
+static inline v16 srl8_16(v16 a) { return vshrq_n_u16(a,8); }
+static inline v16 xor16(v16 a, v16 b) { return veorq_u16(a,b); }
+static inline v16 or16(v16 a, v16 b) { return vorrq_u16(a,b); }
+static inline v16 cmpgt16(v16 a, v16 b) { return vcgtq_s16(vreinterpretq_s16_u16(a),vreinterpretq_s16_u16(b)); }
+static inline v16 cmpeq16(v16 a, v16 b) { return vceqq_u16(a,b); }
+static inline v16 min16(v16 a, v16 b) { return vreinterpretq_u16_s16(vminq_s16(vreinterpretq_s16_u16(a),vreinterpretq_s16_u16(b))); }
+static inline v16 sel16(v16 m, v16 a, v16 b) { return vbslq_u16(m,a,b); }
+static inline v16 alpha16(v16 a)
+{
+  static const unsigned char idx[16] = {
+    LICE_PIXEL_A*2, LICE_PIXEL_A*2+1, LICE_PIXEL_A*2, LICE_PIXEL_A*2+1,
+    LICE_PIXEL_A*2, LICE_PIXEL_A*2+1, LICE_PIXEL_A*2, LICE_PIXEL_A*2+1,
+    8+LICE_PIXEL_A*2, 8+LICE_PIXEL_A*2+1, 8+LICE_PIXEL_A*2, 8+LICE_PIXEL_A*2+1,
+    8+LICE_PIXEL_A*2, 8+LICE_PIXEL_A*2+1, 8+LICE_PIXEL_A*2, 8+LICE_PIXEL_A*2+1,
+  };
+  return vreinterpretq_u16_u8(vqtbl1q_u8(vreinterpretq_u8_u16(a),vld1q_u8(idx)));
+}
+static inline v8 add8(v8 a, v8 b) { return vaddq_u8(a,b); }
+static inline v8 half8(v8 a) { return vshrq_n_u8(a,1); }
+static inline v8 quarter8(v8 a) { return vshrq_n_u8(a,2); }
+static inline v8 eighth8(v8 a) { return vshrq_n_u8(a,3); }
+static inline v8 spread8(const unsigned char *p)
+{
+  static const unsigned char idx[16] = { 0,0,0,0, 1,1,1,1, 2,2,2,2, 3,3,3,3 };
+  unsigned int v;
+  memcpy(&v,p,sizeof(v));
+  return vqtbl1q_u8(vreinterpretq_u8_u32(vdupq_n_u32(v)),vld1q_u8(idx));
+}
+static inline v16 loadpx16(const LICE_pixel *p) { return vmovl_u8(vld1_u8((const unsigned char *)p)); }
+static inline void storepx16(LICE_pixel *p, v16 v) { vst1_u8((unsigned char *)p,vqmovun_s16(vreinterpretq_s16_u16(v))); }
+static inline v32 load32(const int *p) { return vld1q_s32(p); }
+static inline v16 muladd16(v16 c, v16 sc, v32 add)
+{
+  const int16x8_t cs = vreinterpretq_s16_u16(c), scs = vreinterpretq_s16_u16(sc);
+  const int32x4_t lo = vshrq_n_s32(vaddq_s32(vmull_s16(vget_low_s16(cs),vget_low_s16(scs)),add),8);
+  const int32x4_t hi = vshrq_n_s32(vaddq_s32(vmull_high_s16(cs,scs),add),8);
+  return vreinterpretq_u16_s16(vcombine_s16(vqmovn_s32(lo),vqmovn_s32(hi)));
+}
+
+#include "lice_simd_impl.h"
+
+#undef LICE_SIMD_N
+#undef LICE_SIMD_FUNC
+
+} // namespace lice_simd_neon
+
+static int LICE_SIMD_Detect() { return 1; } // NEON is always present on AArch64
+
+#else
+
+static int LICE_SIMD_Detect() { return 0; }
+
+#endif
+
+// 0=scalar, 1=SSE2/NEON, 2=AVX2. -1 until detected
+static int s_lice_simd_level = -1, s_lice_simd_maxlevel = -1;
+
+static int LICE_SIMD_GetLevel()
+{
+  if (s_lice_simd_level < 0)
+  {
+    if (s_lice_simd_maxlevel < 0) s_lice_simd_maxlevel = LICE_SIMD_Detect();
+    s_lice_simd_level = s_lice_simd_maxlevel;
+  }
+  return s_lice_simd_level;
+}
+
+static int LICE_SIMD_SetLevel(int level)
+{
+  const int prev = LICE_SIMD_GetLevel();
+  if (level >= 0) s_lice_simd_level = level < s_lice_simd_maxlevel ? level : s_lice_simd_maxlevel;
+  return prev;
+}
+
+// each block is w pixels by h rows from p, span is in bytes and may be negative (flipped bitmaps)
+static bool LICE_SIMD_Overlaps(const void *p1, int span1, int w1, int h1, const void *p2, int span2, int w2, int h2)
+{
+  const char *a = (const char *)p1, *b = (const char *)p2;
+  const char *a2 = a + (h1-1)*span1, *b2 = b + (h2-1)*span2;
+  if (a2 < a) { const char *t=a; a=a2; a2=t; }
+  if (b2 < b) { const char *t=b; b=b2; b2=t; }
+  a2 += w1*sizeof(LICE_pixel);
+  b2 += w2*sizeof(LICE_pixel);
+  return a < b2 && b < a2;
+}
+
+static bool LICE_SIMD_BlitLevel(int level, LICE_pixel *dest, const LICE_pixel *src, int w, int h, int src_span, int dest_span, int ia, int mode)
+{
+#if defined(LICE_SIMD_X86)
+  if (level >= 2) return lice_simd_avx2::Blit(dest,src,w,h,src_span,dest_span,ia,mode);
+  return lice_simd_sse2::Blit(dest,src,w,h,src_span,dest_span,ia,mode);
+#elif defined(LICE_SIMD_NEON)
+  return lice_simd_neon::Blit(dest,src,w,h,src_span,dest_span,ia,mode);
+#else
+  return false;
+#endif
+}
+
+// spans are in bytes. returns true if the blit was done
+static bool LICE_SIMD_Blit(LICE_pixel_chan *dest, const LICE_pixel_chan *src, int w, int h, int src_span, int dest_span, int ia, int mode)
+{
+  const int level = LICE_SIMD_GetLevel();
+  if (level < 1 || ia < 1 || ia > 256 || w < 1 || h < 1) return false;
+
+  // the scalar path is sequential, which matters for overlapping in-place blits
+  if (LICE_SIMD_Overlaps(dest,dest_span,w,h,src,src_span,w,h)) return false;
+
+  return LICE_SIMD_BlitLevel(level,(LICE_pixel *)dest,(const LICE_pixel *)src,w,h,src_span,dest_span,ia,mode);
+}
+
+// solid fill as in LICE_FillRect (which uses ia as the source alpha), span is in pixels. returns true if the fill was done
+static bool LICE_SIMD_FillRect(LICE_pixel *dest, int w, int h, int span, LICE_pixel color, int ia, int mode)
+{
+  const int level = LICE_SIMD_GetLevel();
+  if (level < 1 || ia < 1 || ia > 256 || w < 1 || h < 1) return false;
+
+  int chan[4];
+  chan[LICE_PIXEL_R] = LICE_GETR(color);
+  chan[LICE_PIXEL_G] = LICE_GETG(color);
+  chan[LICE_PIXEL_B] = LICE_GETB(color);
+  chan[LICE_PIXEL_A] = ia;
+
+#if defined(LICE_SIMD_X86)
+  if (level >= 2) return lice_simd_avx2::Fill(dest,w,h,span*(int)sizeof(LICE_pixel),chan,ia,mode);
+  return lice_simd_sse2::Fill(dest,w,h,span*(int)sizeof(LICE_pixel),chan,ia,mode);
+#elif defined(LICE_SIMD_NEON)
+  return lice_simd_neon::Fill(dest,w,h,span*(int)sizeof(LICE_pixel),chan,ia,mode);
+#else
+  return false;
+#endif
+}
+
+// LICE_MultiplyAddRect with the fixed point factors and offsets it computes, span is in pixels. returns true if it was done
+static bool LICE_SIMD_MultiplyAddRect(LICE_pixel *dest, int w, int h, int span, int ir, int ig, int ib, int ia, int ir2, int ig2, int ib2, int ia2)
+{
+  const int level = LICE_SIMD_GetLevel();
+  if (level < 1 || w < 1 || h < 1) return false;
+
+  int sc[4], add[4];
+  sc[LICE_PIXEL_R] = ir; sc[LICE_PIXEL_G] = ig; sc[LICE_PIXEL_B] = ib; sc[LICE_PIXEL_A] = ia;
+  add[LICE_PIXEL_R] = ir2; add[LICE_PIXEL_G] = ig2; add[LICE_PIXEL_B] = ib2; add[LICE_PIXEL_A] = ia2;
+  // the factors are multiplied as 16 bit values, and c*sc+add must not overflow
+  for (int i = 0; i < 4; i ++)
+    if (sc[i] < -32768 || sc[i] > 32767 || add[i] < -(1<<30) || add[i] > (1<<30)) return false;
+
+#if defined(LICE_SIMD_X86)
+  if (level >= 2) lice_simd_avx2::MultiplyAdd(dest,w,h,span*(int)sizeof(LICE_pixel),sc,add);
+  else lice_simd_sse2::MultiplyAdd(dest,w,h,span*(int)sizeof(LICE_pixel),sc,add);
+  return true;
+#elif defined(LICE_SIMD_NEON)
+  lice_simd_neon::MultiplyAdd(dest,w,h,span*(int)sizeof(LICE_pixel),sc,add);
+  return true;
+#else
+  return false;
+#endif
+}
+
+// one row of LICE_Blur from dest[0] to dest[n-1], see BlurRow() in lice_simd_impl.h. returns the number of pixels done
+static int LICE_SIMD_BlurRow(LICE_pixel *dest, const LICE_pixel *cur, const LICE_pixel *r2, const LICE_pixel *r3, int n)
+{
+  const int level = LICE_SIMD_GetLevel();
+  if (level < 1) return 0;
+#if defined(LICE_SIMD_X86)
+  if (level >= 2) return lice_simd_avx2::BlurRow(dest,cur,r2,r3,n);
+  return lice_simd_sse2::BlurRow(dest,cur,r2,r3,n);
+#elif defined(LICE_SIMD_NEON)
+  return lice_simd_neon::BlurRow(dest,cur,r2,r3,n);
+#else
+  return 0;
+#endif
+}
+
+// unscaled LICE_DrawGlyphEx, span is in pixels, glyph_span in bytes. returns true if it was done
+static bool LICE_SIMD_DrawGlyph(LICE_pixel *dest, const LICE_pixel_chan *alphas, int w, int h, int span, int glyph_span, LICE_pixel color, int ia, int mode)
+{
+  const int level = LICE_SIMD_GetLevel();
+  if (level < 1 || ia < 1 || ia > 256 || w < 1 || h < 1) return false;
+
+  int chan[4];
+  chan[LICE_PIXEL_R] = LICE_GETR(color);
+  chan[LICE_PIXEL_G] = LICE_GETG(color);
+  chan[LICE_PIXEL_B] = LICE_GETB(color);
+  chan[LICE_PIXEL_A] = LICE_GETA(color);
+
+#if defined(LICE_SIMD_X86)
+  if (level >= 2) return lice_simd_avx2::DrawGlyph(dest,alphas,w,h,span*(int)sizeof(LICE_pixel),glyph_span,chan,ia,mode);
+  return lice_simd_sse2::DrawGlyph(dest,alphas,w,h,span*(int)sizeof(LICE_pixel),glyph_span,chan,ia,mode);
+#elif defined(LICE_SIMD_NEON)
+  return lice_simd_neon::DrawGlyph(dest,alphas,w,h,span*(int)sizeof(LICE_pixel),glyph_span,chan,ia,mode);
+#else
+  return false;
+#endif
+}
+
+static int LICE_SIMD_BilinearRowLevel(int level, LICE_pixel *out, const LICE_pixel *inrow, int src_span, int n, int curx, int idx, int yfrac)
+{
+#if defined(LICE_SIMD_X86)
+  if (level >= 2) return lice_simd_avx2::BilinearRow(out,inrow,src_span,n,curx,idx,yfrac);
+  return lice_simd_sse2::BilinearRow(out,inrow,src_span,n,curx,idx,yfrac);
+#elif defined(LICE_SIMD_NEON)
+  return lice_simd_neon::BilinearRow(out,inrow,src_span,n,curx,idx,yfrac);
+#else
+  return 0;
+#endif
+}
+
+// the modes that LICE_SIMD_BlitLevel() handles, except plain copies at ia==256
+static bool LICE_SIMD_BlitHandlesMode(int mode)
+{
+  switch (mode&(LICE_BLIT_MODE_MASK|LICE_BLIT_USE_ALPHA))
+  {
+    case LICE_BLIT_MODE_COPY:
+    case LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA:
+#ifndef LICE_DISABLE_BLEND_ADD
+    case LICE_BLIT_MODE_ADD:
+    case LICE_BLIT_MODE_ADD|LICE_BLIT_USE_ALPHA:
+#endif
+#ifndef LICE_DISABLE_BLEND_MUL
+    case LICE_BLIT_MODE_MUL:
+    case LICE_BLIT_MODE_MUL|LICE_BLIT_USE_ALPHA:
+#endif
+    return true;
+  }
+  return false;
+}
+
+// the bilinear path of _LICE_Template_Blit2::scaleBlit(), with the same arguments (spans are in bytes).
+// Each row is filtered into a buffer, then combined with the blit kernels, which gives the same results since the
+// combiners only see the filtered values. returns true if the blit was done
+static bool LICE_SIMD_ScaledBlitBilinear(LICE_pixel_chan *dest, const LICE_pixel_chan *src, int w, int h,
+                                         int icurx, int icury, int idx, int idy, unsigned int clipright, unsigned int clipbottom,
+                                         int src_span, int dest_span, int ia, int mode)
+{
+  const int level = LICE_SIMD_GetLevel();
+  if (level < 1 || ia < 1 || ia > 256 || w < 1 || h < 1 || clipright < 1 || clipbottom < 1 || !LICE_SIMD_BlitHandlesMode(mode)) return false;
+
+  // curx must not wrap along a row, so that the source column only moves one way and the pixels drawn are contiguous
+  const WDL_INT64 lastx = icurx + (WDL_INT64)idx * (w-1);
+  if (lastx < -0x7fffffff-1 || lastx > 0x7fffffff) return false;
+
+  if (LICE_SIMD_Overlaps(dest,dest_span,w,h,src,src_span,clipright,clipbottom)) return false;
+
+  const bool clobber = (mode&(LICE_BLIT_MODE_MASK|LICE_BLIT_USE_ALPHA)) == LICE_BLIT_MODE_COPY && ia == 256;
+  LICE_pixel tmp[512];
+
+  while (h--)
+  {
+    const unsigned int cury = icury >> 16;
+    const int yfrac = icury&65535;
+    if (cury < clipbottom)
+    {
+      const LICE_pixel *inrow = (const LICE_pixel *)(src + (int)cury * src_span);
+      const bool lastrow = cury == clipbottom-1;
+      for (int x0 = 0; x0 < w; x0 += (int)(sizeof(tmp)/sizeof(tmp[0])))
+      {
+        const int n = lice_min(w-x0,(int)(sizeof(tmp)/sizeof(tmp[0])));
+        const int curx0 = icurx + x0*idx;
+        int start = -1, end = -1, x = 0;
+        while (x < n)
+        {
+          const int curx = curx0 + x*idx;
+          const unsigned int offs = curx >> 16;
+          const LICE_pixel *pin = inrow + offs;
+          if (offs < clipright-1)
+          {
+            if (start < 0) start = x;
+            if (!lastrow)
+            {
+              int m = 1;
+              while (x+m < n && (unsigned int)((curx0 + (x+m)*idx) >> 16) < clipright-1) m ++;
+              int k = LICE_SIMD_BilinearRowLevel(level,tmp+x,inrow,src_span,m,curx,idx,yfrac);
+              for (; k < m; k ++)
+              {
+                const int cx = curx + k*idx;
+                const LICE_pixel *p = inrow + (cx >> 16);
+                __LICE_BilinearFilterIPixOut((LICE_pixel_chan *)(tmp+x+k),(const LICE_pixel_chan *)p,(const LICE_pixel_chan *)p + src_span,cx&0xffff,yfrac);
+              }
+              x += m;
+              end = x;
+              continue;
+            }
+            __LICE_LinearFilterIPixOut((LICE_pixel_chan *)(tmp+x),(const LICE_pixel_chan *)pin,(const LICE_pixel_chan *)(pin+1),curx&0xffff);
+          }
+          else if (offs == clipright-1)
+          {
+            if (start < 0) start = x;
+            if (!lastrow) __LICE_LinearFilterIPixOut((LICE_pixel_chan *)(tmp+x),(const LICE_pixel_chan *)pin,(const LICE_pixel_chan *)pin + src_span,yfrac);
+            else tmp[x] = *pin;
+          }
+          else
+          {
+            if (start >= 0) break; // the source column is monotonic, so the rest is outside too
+            x ++;
+            continue;
+          }
+          x ++;
+          end = x;
+        }
+
+        if (start >= 0)
+        {
+          LICE_pixel *wr = (LICE_pixel *)dest + x0 + start;
+          if (clobber) memcpy(wr,tmp+start,(end-start)*sizeof(LICE_pixel));
+          else LICE_SIMD_BlitLevel(level,wr,tmp+start,end-start,1,0,0,ia,mode);
+        }
+      }
+    }
+    dest += dest_span;
+    icury += idy;
+  }
+  return true;
+}
+
+#endif // !LICE_NO_SIMD
+
+#endif // _LICE_SIMD_H_
@@ -0,0 +1,389 @@
+/*
+  Cockos WDL - LICE - Lightweight Image Compositing Engine
+  File: lice_simd_impl.h (SIMD compositing kernels)
+  See lice.h for license and other information
+
+  This file is included by lice_simd.h once per instruction set, inside a namespace that defines:
+    v8/v16/v32           vector types (packed 8 bit channels, unpacked 16 bit channels, 32 bit lanes)
+    LICE_SIMD_N          pixels per v8 (a v16 holds LICE_SIMD_N/2 pixels)
+    LICE_SIMD_FUNC       function attribute needed to use the instruction set (target attribute, or empty)
+  and the primitive operations used below (load8, store8, lo16, hi16, pack16, set16, loadlanes16, zero16,
+  add16, sub16, mullo16, mulhi16, srl8_16, xor16, cmpgt16, cmpeq16, min16, or16, sel16, alpha16, add8,
+  half8, quarter8, eighth8, spread8, loadpx16, storepx16, load32, muladd16).
+
+  Every kernel reproduces the integer math of the matching combiner in lice_combine.h exactly,
+  using 16 bit lanes: /256 on a possibly negative value becomes >>8 on its magnitude, and multipliers
+  that can reach 65536 are either wrapped (and their results fixed up) or avoided.
+*/
+
+// all ones in the alpha lane of each pixel
+static inline LICE_SIMD_FUNC v16 alphamask16()
+{
+  unsigned short m[16];
+  for (int i = 0; i < 16; i ++) m[i] = (i&3) == LICE_PIXEL_A ? 0xffff : 0;
+  return loadlanes16(m);
+}
+
+// _LICE_CombinePixelsCopy*: s + ((d-s)*sc)/256, sc is 0..256
+static inline LICE_SIMD_FUNC v16 copy16(v16 d, v16 s, v16 sc)
+{
+  const v16 diff = sub16(d,s);
+  const v16 neg = cmpgt16(zero16(),diff);
+  v16 q = sub16(xor16(diff,neg),neg);
+  q = srl8_16(mullo16(q,sc));
+  return add16(s,sub16(xor16(q,neg),neg));
+}
+
+// _LICE_CombinePixelsCopySourceAlpha*, and the IgnoreAlphaParm variants when ia==256
+static inline LICE_SIMD_FUNC v16 copysa16(v16 d, v16 s, v16 ia, v16 amask, bool ignoreParm)
+{
+  const v16 a = alpha16(s);
+  v16 sc2, sc;
+  if (ignoreParm)
+  {
+    sc2 = a;
+    sc = sub16(set16(255),a);
+  }
+  else
+  {
+    sc2 = srl8_16(mullo16(ia,add16(a,set16(1))));
+    sc = sub16(set16(256),sc2);
+  }
+  const v16 rgb = copy16(d,s,sc);
+  const v16 outa = min16(add16(sc2,d),set16(255));
+  return sel16(cmpeq16(a,zero16()),d,sel16(amask,outa,rgb));
+}
+
+// _LICE_CombinePixelsAdd: d + (s*ia)/256, saturated by pack16
+static inline LICE_SIMD_FUNC v16 add_16(v16 d, v16 s, v16 ia)
+{
+  return add16(d,srl8_16(mullo16(s,ia)));
+}
+
+// _LICE_CombinePixelsAddSourceAlpha
+static inline LICE_SIMD_FUNC v16 addsa16(v16 d, v16 s, v16 ia, bool fullAlpha)
+{
+  const v16 a = alpha16(s);
+  // (256*(a+1))/256 doesn't fit in 16 bits, but is just a+1
+  const v16 ua = fullAlpha ? add16(a,set16(1)) : srl8_16(mullo16(ia,add16(a,set16(1))));
+  return sel16(cmpeq16(a,zero16()),d,add16(d,srl8_16(mullo16(s,ua))));
+}
+
+// _LICE_CombinePixelsMul: (d*((256-ia)*256 + s*ia))>>16. The factor is 65536-ia*(256-s), which is
+// below 65536 for any s<=255 and ia>=1, so it is computed modulo 65536 and used as an unsigned multiplier
+static inline LICE_SIMD_FUNC v16 mul16(v16 d, v16 s, v16 ia)
+{
+  return mulhi16(d,sub16(zero16(),mullo16(ia,sub16(set16(256),s))));
+}
+
+// _LICE_CombinePixelsMulSourceAlpha: as above with ualpha, a factor of 65536 (ualpha==0) leaves d as is
+static inline LICE_SIMD_FUNC v16 mulsa16(v16 d, v16 s, v16 ia, bool fullAlpha)
+{
+  const v16 a = alpha16(s);
+  const v16 ua = fullAlpha ? add16(a,set16(1)) : srl8_16(mullo16(ia,add16(a,set16(1))));
+  const v16 r = mulhi16(d,sub16(zero16(),mullo16(ua,sub16(set16(256),s))));
+  return sel16(or16(cmpeq16(a,zero16()),cmpeq16(ua,zero16())),d,r);
+}
+
+// _LICE_CombinePixelsMul with a per pixel alpha, which leaves d as is where the alpha is 0
+static inline LICE_SIMD_FUNC v16 GlyphMul(v16 d, v16 s, v16 ua, v16 z)
+{
+  return sel16(cmpeq16(ua,z),d,mul16(d,s,ua));
+}
+
+// runs OP (an expression of the v8 values d and s) over a w*h block, the last pixels of each row
+// are processed through a temporary buffer so that the results are identical to the scalar path
+#define LICE_SIMD_BLOCKLOOP(OP) \
+  while (h-->0) \
+  { \
+    LICE_pixel *wr = dest; \
+    const LICE_pixel *rd = src; \
+    int n = w; \
+    for (; n >= LICE_SIMD_N; n -= LICE_SIMD_N, wr += LICE_SIMD_N, rd += LICE_SIMD_N) \
+    { \
+      const v8 d = load8(wr), s = load8(rd); \
+      store8(wr,(OP)); \
+    } \
+    if (n > 0) \
+    { \
+      LICE_pixel tmpd[LICE_SIMD_N], tmps[LICE_SIMD_N]; \
+      memset(tmpd,0,sizeof(tmpd)); \
+      memset(tmps,0,sizeof(tmps)); \
+      memcpy(tmpd,wr,n*sizeof(LICE_pixel)); \
+      memcpy(tmps,rd,n*sizeof(LICE_pixel)); \
+      const v8 d = load8(tmpd), s = load8(tmps); \
+      store8(tmpd,(OP)); \
+      memcpy(wr,tmpd,n*sizeof(LICE_pixel)); \
+    } \
+    dest = (LICE_pixel *)((char *)dest + dest_span); \
+    src = (const LICE_pixel *)((const char *)src + src_span); \
+  }
+
+#define LICE_SIMD_FILLLOOP(OP) \
+  while (h-->0) \
+  { \
+    LICE_pixel *wr = dest; \
+    int n = w; \
+    for (; n >= LICE_SIMD_N; n -= LICE_SIMD_N, wr += LICE_SIMD_N) \
+    { \
+      const v8 d = load8(wr); \
+      store8(wr,(OP)); \
+    } \
+    if (n > 0) \
+    { \
+      LICE_pixel tmpd[LICE_SIMD_N]; \
+      memset(tmpd,0,sizeof(tmpd)); \
+      memcpy(tmpd,wr,n*sizeof(LICE_pixel)); \
+      const v8 d = load8(tmpd); \
+      store8(tmpd,(OP)); \
+      memcpy(wr,tmpd,n*sizeof(LICE_pixel)); \
+    } \
+    dest = (LICE_pixel *)((char *)dest + dest_span); \
+  }
+
+#define LICE_SIMD_OP(f, ...) pack16(f(lo16(d),lo16(s),__VA_ARGS__),f(hi16(d),hi16(s),__VA_ARGS__))
+
+// unscaled blit of a block (spans are in bytes), returns false if the mode isn't handled here
+static LICE_SIMD_FUNC bool Blit(LICE_pixel *dest, const LICE_pixel *src, int w, int h, int src_span, int dest_span, int ia, int mode)
+{
+  const v16 iav = set16(ia);
+  const bool full = ia == 256;
+
+  switch (mode&(LICE_BLIT_MODE_MASK|LICE_BLIT_USE_ALPHA))
+  {
+    case LICE_BLIT_MODE_COPY:
+      if (full) return false; // memmove is as fast as it gets
+      {
+        const v16 sc = set16(256-ia);
+        LICE_SIMD_BLOCKLOOP(LICE_SIMD_OP(copy16,sc))
+      }
+    return true;
+    case LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA:
+      {
+        const v16 amask = alphamask16();
+        if (full) { LICE_SIMD_BLOCKLOOP(LICE_SIMD_OP(copysa16,iav,amask,true)) }
+        else { LICE_SIMD_BLOCKLOOP(LICE_SIMD_OP(copysa16,iav,amask,false)) }
+      }
+    return true;
+#ifndef LICE_DISABLE_BLEND_ADD
+    case LICE_BLIT_MODE_ADD:
+      LICE_SIMD_BLOCKLOOP(LICE_SIMD_OP(add_16,iav))
+    return true;
+    case LICE_BLIT_MODE_ADD|LICE_BLIT_USE_ALPHA:
+      if (full) { LICE_SIMD_BLOCKLOOP(LICE_SIMD_OP(addsa16,iav,true)) }
+      else { LICE_SIMD_BLOCKLOOP(LICE_SIMD_OP(addsa16,iav,false)) }
+    return true;
+#endif
+#ifndef LICE_DISABLE_BLEND_MUL
+    case LICE_BLIT_MODE_MUL:
+      LICE_SIMD_BLOCKLOOP(LICE_SIMD_OP(mul16,iav))
+    return true;
+    case LICE_BLIT_MODE_MUL|LICE_BLIT_USE_ALPHA:
+      if (full) { LICE_SIMD_BLOCKLOOP(LICE_SIMD_OP(mulsa16,iav,true)) }
+      else { LICE_SIMD_BLOCKLOOP(LICE_SIMD_OP(mulsa16,iav,false)) }
+    return true;
+#endif
+  }
+  return false;
+}
+
+// solid fill of a block (span is in bytes), with the per-channel source values chan[] and the
+// combiner used by LICE_FillRect. returns false if the mode isn't handled here
+static LICE_SIMD_FUNC bool Fill(LICE_pixel *dest, int w, int h, int dest_span, const int *chan, int ia, int mode)
+{
+  unsigned short lanes[16], lanes2[16];
+  int i;
+
+  switch (mode&LICE_BLIT_MODE_MASK)
+  {
+    case LICE_BLIT_MODE_COPY:
+      if (ia >= 256) return false;
+      {
+        for (i = 0; i < 16; i ++) lanes[i] = (unsigned short)chan[i&3];
+        const v16 sv = loadlanes16(lanes), sc = set16(256-ia);
+        LICE_SIMD_FILLLOOP(pack16(copy16(lo16(d),sv,sc),copy16(hi16(d),sv,sc)))
+      }
+    return true;
+#ifndef LICE_DISABLE_BLEND_ADD
+    case LICE_BLIT_MODE_ADD:
+      {
+        for (i = 0; i < 16; i ++) lanes[i] = (unsigned short)((chan[i&3]*ia)/256);
+        const v16 tv = loadlanes16(lanes);
+        LICE_SIMD_FILLLOOP(pack16(add16(lo16(d),tv),add16(hi16(d),tv)))
+      }
+    return true;
+#endif
+#ifndef LICE_DISABLE_BLEND_MUL
+    case LICE_BLIT_MODE_MUL:
+      {
+        // a factor of 65536 (only possible for a source value of 256, i.e. the alpha channel at ia==256) leaves d as is
+        for (i = 0; i < 16; i ++)
+        {
+          const int f = (256-ia)*256 + chan[i&3]*ia;
+          lanes[i] = (unsigned short)(f&0xffff);
+          lanes2[i] = f >= 65536 ? 0xffff : 0;
+        }
+        const v16 fv = loadlanes16(lanes), pv = loadlanes16(lanes2);
+        LICE_SIMD_FILLLOOP(pack16(sel16(pv,lo16(d),mulhi16(lo16(d),fv)),sel16(pv,hi16(d),mulhi16(hi16(d),fv))))
+      }
+    return true;
+#endif
+  }
+  return false;
+}
+
+// LICE_MultiplyAddRect: clamp((c*sc+add)>>8) per channel, sc[] must fit in 16 bits and c*sc+add in 32
+static LICE_SIMD_FUNC void MultiplyAdd(LICE_pixel *dest, int w, int h, int dest_span, const int *sc, const int *add)
+{
+  unsigned short lanes[16];
+  int addlanes[8], i;
+  for (i = 0; i < 16; i ++) lanes[i] = (unsigned short)sc[i&3];
+  for (i = 0; i < 8; i ++) addlanes[i] = add[i&3];
+  const v16 scv = loadlanes16(lanes);
+  const v32 addv = load32(addlanes);
+  LICE_SIMD_FILLLOOP(pack16(muladd16(lo16(d),scv,addv),muladd16(hi16(d),scv,addv)))
+}
+
+// one row of LICE_Blur, for the pixels that have a neighbour on both sides. cur[-1] and cur[n] must be
+// readable. r3 is NULL for the first and last rows, which use a quarter of r2 instead of an eighth of each.
+// the channels never carry into each other, so the sums are done on packed bytes.
+// returns the number of pixels done, the caller does the rest
+static LICE_SIMD_FUNC int BlurRow(LICE_pixel *dest, const LICE_pixel *cur, const LICE_pixel *r2, const LICE_pixel *r3, int n)
+{
+  int x = 0;
+  if (r3)
+  {
+    for (; x <= n-LICE_SIMD_N; x += LICE_SIMD_N)
+    {
+      const v8 v = add8(add8(half8(load8(cur+x)),eighth8(load8(cur+x+1))),eighth8(load8(cur+x-1)));
+      store8(dest+x,add8(v,add8(eighth8(load8(r2+x)),eighth8(load8(r3+x)))));
+    }
+  }
+  else
+  {
+    for (; x <= n-LICE_SIMD_N; x += LICE_SIMD_N)
+    {
+      const v8 v = add8(add8(half8(load8(cur+x)),eighth8(load8(cur+x+1))),eighth8(load8(cur+x-1)));
+      store8(dest+x,add8(v,quarter8(load8(r2+x))));
+    }
+  }
+  return x;
+}
+
+// LICE_DrawGlyphEx (unscaled), with the combiners picked by __LICE_ACTION_NOSRCALPHA. Each pixel uses
+// alpha v*ia/256, where v is its glyph value. dest_span is in bytes. returns false if the mode isn't handled here
+static LICE_SIMD_FUNC bool DrawGlyph(LICE_pixel *dest, const LICE_pixel_chan *alphas, int w, int h, int dest_span, int glyph_span, const int *chan, int ia, int mode)
+{
+  unsigned short lanes[16];
+  for (int i = 0; i < 16; i ++) lanes[i] = (unsigned short)chan[i&3];
+  const v16 sv = loadlanes16(lanes), iav = set16(ia);
+
+  // v==0 leaves dest alone in all of these (the copy and add combiners are exact no-ops at alpha 0, mul is masked)
+  #define LICE_SIMD_GLYPHOP(f) pack16(f(lo16(d),lo16(av)),f(hi16(d),hi16(av)))
+  #define LICE_SIMD_GLYPHLOOP(f) \
+    while (h-->0) \
+    { \
+      LICE_pixel *wr = dest; \
+      const LICE_pixel_chan *rd = alphas; \
+      int n = w; \
+      for (; n >= LICE_SIMD_N; n -= LICE_SIMD_N, wr += LICE_SIMD_N, rd += LICE_SIMD_N) \
+      { \
+        const v8 d = load8(wr), av = spread8(rd); \
+        store8(wr,LICE_SIMD_GLYPHOP(f)); \
+      } \
+      if (n > 0) \
+      { \
+        LICE_pixel tmpd[LICE_SIMD_N]; \
+        LICE_pixel_chan tmpa[LICE_SIMD_N]; \
+        memset(tmpd,0,sizeof(tmpd)); \
+        memset(tmpa,0,sizeof(tmpa)); \
+        memcpy(tmpd,wr,n*sizeof(LICE_pixel)); \
+        memcpy(tmpa,rd,n); \
+        const v8 d = load8(tmpd), av = spread8(tmpa); \
+        store8(tmpd,LICE_SIMD_GLYPHOP(f)); \
+        memcpy(wr,tmpd,n*sizeof(LICE_pixel)); \
+      } \
+      dest = (LICE_pixel *)((char *)dest + dest_span); \
+      alphas += glyph_span; \
+    }
+
+  switch (mode&LICE_BLIT_MODE_MASK)
+  {
+    case LICE_BLIT_MODE_COPY:
+      {
+        #define LICE_SIMD_F(d,v) copy16(d,sv,sub16(set16(256),srl8_16(mullo16(v,iav))))
+        LICE_SIMD_GLYPHLOOP(LICE_SIMD_F)
+        #undef LICE_SIMD_F
+      }
+    return true;
+#ifndef LICE_DISABLE_BLEND_ADD
+    case LICE_BLIT_MODE_ADD:
+      {
+        #define LICE_SIMD_F(d,v) add_16(d,sv,srl8_16(mullo16(v,iav)))
+        LICE_SIMD_GLYPHLOOP(LICE_SIMD_F)
+        #undef LICE_SIMD_F
+      }
+    return true;
+#endif
+#ifndef LICE_DISABLE_BLEND_MUL
+    case LICE_BLIT_MODE_MUL:
+      {
+        const v16 z = zero16();
+        #define LICE_SIMD_F(d,v) GlyphMul(d,sv,srl8_16(mullo16(v,iav)),z)
+        LICE_SIMD_GLYPHLOOP(LICE_SIMD_F)
+        #undef LICE_SIMD_F
+      }
+    return true;
+#endif
+  }
+  #undef LICE_SIMD_GLYPHOP
+  #undef LICE_SIMD_GLYPHLOOP
+  return false;
+}
+
+// bilinear filtering of n pixels of a row as in __LICE_BilinearFilterI, from the source row inrow (and the row
+// src_span bytes further), with curx stepping by idx and a constant yfrac. All of the pixels must have both
+// neighbours in the source. Each channel is sum(p*f)>>16 with weights f of up to 65536, which is done as the sum of
+// the high halves of the 16x16 bit products plus the carries out of the sum of the low halves. The only weight that
+// can be 65536 is f1, for xfrac==yfrac==0, where all weights are 0 modulo 65536 and the top left pixel is used as is.
+// returns the number of pixels done, the caller does the rest
+static LICE_SIMD_FUNC int BilinearRow(LICE_pixel *out, const LICE_pixel *inrow, int src_span, int n, int curx, int idx, int yfrac)
+{
+  const int np = LICE_SIMD_N/2;
+  unsigned short xoffs[16];
+  for (int i = 0; i < 16; i ++) xoffs[i] = (unsigned short)(((i/4)*idx)&0xffff);
+  const v16 xoffsv = loadlanes16(xoffs), yv = set16(yfrac), z = zero16(), bias = set16(0x8000);
+
+  int x = 0;
+  for (; x <= n-np; x += np)
+  {
+    LICE_pixel t00[LICE_SIMD_N/2], t01[LICE_SIMD_N/2], t10[LICE_SIMD_N/2], t11[LICE_SIMD_N/2];
+    for (int i = 0; i < np; i ++)
+    {
+      const LICE_pixel *pin = inrow + ((curx + (x+i)*idx) >> 16);
+      const LICE_pixel *pinnext = (const LICE_pixel *)((const char *)pin + src_span);
+      t00[i] = pin[0];
+      t01[i] = pin[1];
+      t10[i] = pinnext[0];
+      t11[i] = pinnext[1];
+    }
+    const v16 xv = add16(set16((curx + x*idx)&0xffff),xoffsv);
+    const v16 f4 = mulhi16(xv,yv);
+    const v16 f3 = sub16(yv,f4), f2 = sub16(xv,f4), f1 = sub16(sub16(f4,xv),yv);
+
+    const v16 p00 = loadpx16(t00), p01 = loadpx16(t01), p10 = loadpx16(t10), p11 = loadpx16(t11);
+    const v16 hi = add16(add16(mulhi16(p00,f1),mulhi16(p01,f2)),add16(mulhi16(p10,f3),mulhi16(p11,f4)));
+    const v16 l1 = mullo16(p00,f1), l2 = add16(l1,mullo16(p01,f2)), l3 = add16(l2,mullo16(p10,f3)), l4 = add16(l3,mullo16(p11,f4));
+    // the carries are -1 where an unsigned sum wrapped
+    const v16 c2 = cmpgt16(xor16(l1,bias),xor16(l2,bias));
+    const v16 c3 = cmpgt16(xor16(l2,bias),xor16(l3,bias));
+    const v16 c4 = cmpgt16(xor16(l3,bias),xor16(l4,bias));
+    const v16 r = sub16(sub16(sub16(hi,c2),c3),c4);
+    storepx16(out+x,sel16(cmpeq16(or16(xv,yv),z),p00,r));
+  }
+  return x;
+}
+
+#undef LICE_SIMD_OP
+#undef LICE_SIMD_BLOCKLOOP
+#undef LICE_SIMD_FILLLOOP
@@ -0,0 +1,148 @@
+/*
+  imgcachebench: writes a skin of PNG files, then measures how long it takes N plug-in "instances" to open,
+  where each instance loads every image of the skin, either with LICE_LoadPNG() or from the image cache
+  (see LICE_ImageCache_Load()), and checks that the cached bitmaps are identical to the directly loaded ones.
+
+  make imgcachebench NOSWELL=1
+  ./imgcachebench [instances (8)] [images per skin (32)]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../lice.h"
+#include "../../ptrlist.h"
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec * 0.000000001;
+}
+
+static unsigned int s_rand = 1;
+static unsigned int rnd()
+{
+  s_rand = s_rand * 1664525 + 1013904223;
+  return s_rand >> 8;
+}
+
+static bool same(LICE_IBitmap *a, LICE_IBitmap *b)
+{
+  if (!a || !b || a->getWidth() != b->getWidth() || a->getHeight() != b->getHeight()) return false;
+  for (int y = 0; y < a->getHeight(); y ++)
+    if (memcmp(a->getBits() + y*a->getRowSpan(),b->getBits() + y*b->getRowSpan(),a->getWidth()*sizeof(LICE_pixel))) return false;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  const int ninst = argc > 1 ? atoi(argv[1]) : 8;
+  const int nimg = argc > 2 ? atoi(argv[2]) : 32;
+  if (ninst < 1 || nimg < 1)
+  {
+    printf("usage: imgcachebench [instances (8)] [images per skin (32)]\n");
+    return 2;
+  }
+
+  char dir[] = "/tmp/imgcachebenchXXXXXX";
+  if (!mkdtemp(dir)) return 1;
+
+  // a skin: a background, and knob/slider strips with a few dozen frames each
+  WDL_PtrList<char> files;
+  for (int i = 0; i < nimg; i ++)
+  {
+    const int w = i ? 48 + (rnd()%5)*16 : 1200, h = i ? w * (30 + rnd()%40) : 800;
+    LICE_MemBitmap bm(w,h);
+    LICE_Clear(&bm,0);
+    for (int y = 0; y < h; y += w)
+    {
+      LICE_FillCircle(&bm,w*0.5f,y+w*0.5f,w*0.4f,LICE_RGBA(40+(rnd()&127),40+(rnd()&127),80,255),1.0f,0,true);
+      LICE_Line(&bm,w/2,y+w/2,rnd()%w,y+rnd()%w,LICE_RGBA(255,255,255,255),1.0f,0,true);
+    }
+    LICE_TexGen_Noise(&bm,NULL,0.8f,0.8f,0.9f,0.1f,NOISE_MODE_NORMAL,2);
+
+    char fn[512];
+    snprintf(fn,sizeof(fn),"%s/img%d.png",dir,i);
+    if (!LICE_WritePNG(fn,&bm,true)) { printf("error writing %s\n",fn); return 1; }
+    files.Add(strdup(fn));
+  }
+
+  printf("%d instances, %d images per skin\n\n",ninst,nimg);
+  printf("%-22s %12s %12s %12s\n","ms","1st instance","other (avg)","total");
+
+  bool ok = true;
+  for (int pass = 0; pass < 3; pass ++)
+  {
+    static const char *names[3] = { "LICE_LoadPNG", "cache", "cache, async" };
+    WDL_PtrList<LICE_IBitmap> direct;
+    WDL_PtrList<LICE_CachedImage> cached;
+
+    double t_first = 0.0;
+    const double t0 = now();
+    for (int inst = 0; inst < ninst; inst ++)
+    {
+      const double t1 = now();
+      for (int i = 0; i < nimg; i ++)
+      {
+        if (!pass) direct.Add(LICE_LoadPNG(files.Get(i)));
+        else cached.Add(LICE_ImageCache_Load(files.Get(i),pass == 2));
+      }
+      if (!inst) t_first = now() - t1;
+    }
+    const double t_open = now() - t0;
+
+    double t_decoded = 0.0;
+    if (pass == 2)
+    {
+      for (int i = 0; i < cached.GetSize(); i ++) LICE_ImageCache_GetState(cached.Get(i),true);
+      t_decoded = now() - t0;
+    }
+
+    printf("%-22s %12.2f %12.3f %12.2f",names[pass],t_first*1000.0,
+           ninst > 1 ? (t_open - t_first)*1000.0/(ninst-1) : 0.0,t_open*1000.0);
+    if (pass == 2) printf("  (all decoded after %.2f)",t_decoded*1000.0);
+    printf("\n");
+
+    if (pass)
+    {
+      for (int i = 0; i < cached.GetSize(); i ++)
+      {
+        LICE_IBitmap *ref = LICE_LoadPNG(files.Get(i%nimg));
+        if (!same(ref,LICE_ImageCache_GetBitmap(cached.Get(i))) || cached.Get(i) != cached.Get(i%nimg))
+        {
+          printf("MISMATCH: %s\n",files.Get(i%nimg));
+          ok = false;
+        }
+        delete ref;
+      }
+      for (int i = 0; i < cached.GetSize(); i ++) LICE_ImageCache_Release(cached.Get(i));
+    }
+    else direct.Empty(true);
+  }
+
+  // downscaled blits use the levels: the background at 1/4 size from level 2
+  {
+    LICE_CachedImage *img = LICE_ImageCache_Load(files.Get(0));
+    LICE_IBitmap *l2 = LICE_ImageCache_GetBitmap(img,2);
+    LICE_MemBitmap a(300,200), b(300,200);
+    LICE_ImageCache_ScaledBlit(&a,img,0,0,300,200,0,0,1200,800,1.0f,LICE_BLIT_MODE_COPY);
+    LICE_ScaledBlit(&b,l2,0,0,300,200,0,0,300,200,1.0f,LICE_BLIT_MODE_COPY);
+    if (!l2 || l2->getWidth() != 300 || l2->getHeight() != 200 || !same(&a,&b))
+    {
+      printf("MISMATCH: levels\n");
+      ok = false;
+    }
+    LICE_ImageCache_Release(img);
+  }
+
+  printf("\ncached bitmaps identical to LICE_LoadPNG: %s\n",ok ? "yes" : "NO");
+
+  for (int i = 0; i < files.GetSize(); i ++) unlink(files.Get(i));
+  files.Empty(true,free);
+  rmdir(dir);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+/*
+  mtbench: renders scaled, rotated, transformed and blurred blits into a headless 4K LICE_MemBitmap
+  with the LICE_MT_* functions, checks that the output is identical to the single threaded functions,
+  and reports how the time scales with the number of threads (see LICE_MT_SetThreads()).
+
+  make mtbench NOSWELL=1
+  ./mtbench [width (3840)] [height (2160)] [seconds per test (0.5)]
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../lice.h"
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec * 0.000000001;
+}
+
+static unsigned int s_rand = 1;
+static unsigned int rnd()
+{
+  s_rand = s_rand * 1664525 + 1013904223;
+  return s_rand >> 8;
+}
+
+// a gradient with noise, so that filtering does something
+static void fill(LICE_IBitmap *bm)
+{
+  const int w = bm->getWidth(), h = bm->getHeight(), sp = bm->getRowSpan();
+  LICE_pixel *p = bm->getBits();
+  for (int y = 0; y < h; y ++)
+    for (int x = 0; x < w; x ++)
+      p[y*sp+x] = LICE_RGBA((x*255)/w, (y*255)/h, rnd()&0xff, 128 + (rnd()&0x7f));
+}
+
+static int s_w = 3840, s_h = 2160;
+static LICE_MemBitmap *s_src, *s_small;
+static double s_grid[5*5*2];
+
+enum { OP_SCALED, OP_SCALED_BILINEAR, OP_ROTATED, OP_TRANSFORM, OP_BLUR, OP_BLUR_INPLACE, OP_SCALED_INPLACE, NUM_OPS };
+static const char *s_opnames[NUM_OPS] = {
+  "ScaledBlit", "ScaledBlit bilinear", "RotatedBlit", "TransformBlit2", "Blur", "Blur in-place", "ScaledBlit in-place"
+};
+
+static void run(int op, LICE_IBitmap *dest, bool mt)
+{
+  const int w = s_w, h = s_h;
+  switch (op)
+  {
+    case OP_SCALED:
+      if (mt) LICE_MT_ScaledBlit(dest,s_small,0,0,w,h,0,0,(float)s_small->getWidth(),(float)s_small->getHeight(),0.75f,LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA);
+      else LICE_ScaledBlit(dest,s_small,0,0,w,h,0,0,(float)s_small->getWidth(),(float)s_small->getHeight(),0.75f,LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA);
+    break;
+    case OP_SCALED_BILINEAR:
+      if (mt) LICE_MT_ScaledBlit(dest,s_small,0,0,w,h,0.5f,0.5f,s_small->getWidth()-1.0f,s_small->getHeight()-1.0f,1.0f,LICE_BLIT_MODE_COPY|LICE_BLIT_FILTER_BILINEAR);
+      else LICE_ScaledBlit(dest,s_small,0,0,w,h,0.5f,0.5f,s_small->getWidth()-1.0f,s_small->getHeight()-1.0f,1.0f,LICE_BLIT_MODE_COPY|LICE_BLIT_FILTER_BILINEAR);
+    break;
+    case OP_ROTATED:
+      if (mt) LICE_MT_RotatedBlit(dest,s_src,0,0,w,h,0,0,(float)w,(float)h,0.3f,true,1.0f,LICE_BLIT_MODE_COPY|LICE_BLIT_FILTER_BILINEAR);
+      else LICE_RotatedBlit(dest,s_src,0,0,w,h,0,0,(float)w,(float)h,0.3f,true,1.0f,LICE_BLIT_MODE_COPY|LICE_BLIT_FILTER_BILINEAR);
+    break;
+    case OP_TRANSFORM:
+      if (mt) LICE_MT_TransformBlit2(dest,s_src,0,0,w,h,s_grid,5,5,1.0f,LICE_BLIT_MODE_COPY|LICE_BLIT_FILTER_BILINEAR);
+      else LICE_TransformBlit2(dest,s_src,0,0,w,h,s_grid,5,5,1.0f,LICE_BLIT_MODE_COPY|LICE_BLIT_FILTER_BILINEAR);
+    break;
+    case OP_BLUR:
+      if (mt) LICE_MT_Blur(dest,s_src,0,0,0,0,w,h);
+      else LICE_Blur(dest,s_src,0,0,0,0,w,h);
+    break;
+    case OP_BLUR_INPLACE:
+      if (mt) LICE_MT_Blur(dest,dest,0,0,0,0,w,h);
+      else LICE_Blur(dest,dest,0,0,0,0,w,h);
+    break;
+    case OP_SCALED_INPLACE:
+      // zooms into the top left quarter of dest. the single threaded reference reads from a copy, which is what LICE_MT_ScaledBlit does
+      if (mt) LICE_MT_ScaledBlit(dest,dest,0,0,w,h,0,0,w/2.0f,h/2.0f,1.0f,LICE_BLIT_MODE_COPY|LICE_BLIT_FILTER_BILINEAR);
+      else
+      {
+        LICE_MemBitmap tmp;
+        LICE_Copy(&tmp,dest);
+        LICE_ScaledBlit(dest,&tmp,0,0,w,h,0,0,w/2.0f,h/2.0f,1.0f,LICE_BLIT_MODE_COPY|LICE_BLIT_FILTER_BILINEAR);
+      }
+    break;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 1) s_w = atoi(argv[1]);
+  if (argc > 2) s_h = atoi(argv[2]);
+  const double seconds = argc > 3 ? atof(argv[3]) : 0.5;
+  if (s_w < 16 || s_h < 16 || seconds <= 0.0)
+  {
+    printf("usage: mtbench [width (3840)] [height (2160)] [seconds per test (0.5)]\n");
+    return 2;
+  }
+
+  int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (ncpu < 1) ncpu = 1;
+  if (ncpu > 16) ncpu = 16;
+  const int maxthreads = ncpu < 4 ? 4 : ncpu; // always check a few thread counts for identical output, even on a small machine
+
+  s_src = new LICE_MemBitmap(s_w,s_h);
+  s_small = new LICE_MemBitmap(s_w/4,s_h/4);
+  fill(s_src);
+  fill(s_small);
+
+  // a gentle warp
+  for (int y = 0; y < 5; y ++)
+    for (int x = 0; x < 5; x ++)
+    {
+      s_grid[(y*5+x)*2] = x*(s_w-1)/4.0 + sin(y*1.3)*s_w*0.03;
+      s_grid[(y*5+x)*2+1] = y*(s_h-1)/4.0 + cos(x*0.7)*s_h*0.03;
+    }
+
+  LICE_MemBitmap dest(s_w,s_h), ref(s_w,s_h), init(s_w,s_h);
+  fill(&init);
+
+  printf("%dx%d, %d CPUs. ms per call (speedup over 1 thread)\n\n%-20s",s_w,s_h,ncpu,"");
+  int nthreads[8], nn = 0;
+  for (int n = 1; n <= maxthreads && nn < 8; n *= 2) nthreads[nn++] = n;
+  if (nthreads[nn-1] != maxthreads && nn < 8) nthreads[nn++] = maxthreads;
+  for (int i = 0; i < nn; i ++) printf(" %10d thr%s",nthreads[i],nthreads[i]>1?"s":" ");
+  printf("\n");
+
+  bool ok = true;
+  for (int op = 0; op < NUM_OPS; op ++)
+  {
+    LICE_Copy(&ref,&init);
+    run(op,&ref,false);
+
+    printf("%-20s",s_opnames[op]);
+    double t_one = 0.0;
+    for (int i = 0; i < nn; i ++)
+    {
+      LICE_MT_SetThreads(nthreads[i]);
+
+      // output must not depend on the thread count or on scheduling
+      for (int rep = 0; rep < 3; rep ++)
+      {
+        LICE_Copy(&dest,&init);
+        run(op,&dest,true);
+        if (memcmp(dest.getBits(),ref.getBits(),dest.getRowSpan()*dest.getHeight()*sizeof(LICE_pixel)))
+        {
+          printf("\nMISMATCH: %s with %d threads\n",s_opnames[op],nthreads[i]);
+          ok = false;
+          break;
+        }
+      }
+
+      int n = 0;
+      const double t0 = now();
+      double t1;
+      do
+      {
+        run(op,&dest,true);
+        n ++;
+        t1 = now();
+      }
+      while (t1 - t0 < seconds);
+
+      const double ms = (t1 - t0) * 1000.0 / n;
+      if (!i) t_one = ms;
+      printf(" %8.2f (%4.1fx)",ms,t_one/ms);
+      fflush(stdout);
+    }
+    printf("\n");
+  }
+  LICE_MT_SetThreads(0);
+  LICE_MT_Shutdown();
+
+  printf("\nidentical to single threaded: %s\n",ok ? "yes" : "NO");
+
+  delete s_small;
+  delete s_src;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,282 @@
+/*
+  simdbench: checks that the SIMD paths of LICE (blits, bilinear scaled blits, fills, LICE_MultiplyAddRect,
+  LICE_Blur and LICE_DrawGlyphEx) give the same results as the scalar ones, and measures megapixels/sec
+  per blend mode for each available level (see LICE_SetSIMDLevel()).
+
+  make simdbench NOSWELL=1
+  ./simdbench [seconds per test (0.25)]
+*/
+
+#include "../lice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *s_level_names[] = { "scalar", "SSE2/NEON", "AVX2" };
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec * 0.000000001;
+}
+
+static unsigned int s_rand = 1;
+static unsigned int rnd()
+{
+  s_rand = s_rand * 1664525 + 1013904223;
+  return s_rand >> 8;
+}
+
+// random pixels, with fully transparent and fully opaque alpha values over-represented
+static void randomize(LICE_IBitmap *bm)
+{
+  LICE_pixel *p = bm->getBits();
+  const int n = bm->getRowSpan() * bm->getHeight();
+  for (int i = 0; i < n; i ++)
+  {
+    int a = rnd() & 0xff;
+    switch (rnd() & 7)
+    {
+      case 0: a = 0; break;
+      case 1: a = 255; break;
+    }
+    p[i] = LICE_RGBA(rnd()&0xff,rnd()&0xff,rnd()&0xff,a);
+  }
+}
+
+enum { KIND_BLIT, KIND_FILL, KIND_SCALED, KIND_MULADD, KIND_BLUR, KIND_GLYPH };
+
+struct test
+{
+  const char *name;
+  int kind;
+  int mode;
+};
+
+static const test s_tests[] =
+{
+  { "copy", KIND_BLIT, LICE_BLIT_MODE_COPY },
+  { "copy+srcalpha", KIND_BLIT, LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA },
+  { "add", KIND_BLIT, LICE_BLIT_MODE_ADD },
+  { "add+srcalpha", KIND_BLIT, LICE_BLIT_MODE_ADD|LICE_BLIT_USE_ALPHA },
+  { "mul", KIND_BLIT, LICE_BLIT_MODE_MUL },
+  { "mul+srcalpha", KIND_BLIT, LICE_BLIT_MODE_MUL|LICE_BLIT_USE_ALPHA },
+  { "fill copy", KIND_FILL, LICE_BLIT_MODE_COPY },
+  { "fill add", KIND_FILL, LICE_BLIT_MODE_ADD },
+  { "fill mul", KIND_FILL, LICE_BLIT_MODE_MUL },
+  { "bilinear copy", KIND_SCALED, LICE_BLIT_MODE_COPY|LICE_BLIT_FILTER_BILINEAR },
+  { "bilinear copy+sa", KIND_SCALED, LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA|LICE_BLIT_FILTER_BILINEAR },
+  { "bilinear add", KIND_SCALED, LICE_BLIT_MODE_ADD|LICE_BLIT_FILTER_BILINEAR },
+  { "bilinear mul+sa", KIND_SCALED, LICE_BLIT_MODE_MUL|LICE_BLIT_USE_ALPHA|LICE_BLIT_FILTER_BILINEAR },
+  { "multiplyadd", KIND_MULADD, 0 },
+  { "blur", KIND_BLUR, 0 },
+  { "glyph copy", KIND_GLYPH, LICE_BLIT_MODE_COPY },
+  { "glyph add", KIND_GLYPH, LICE_BLIT_MODE_ADD },
+  { "glyph mul", KIND_GLYPH, LICE_BLIT_MODE_MUL },
+};
+
+struct params
+{
+  int x, y, w, h; // destination rect (or the area for fills, LICE_MultiplyAddRect and the blur)
+  int sx, sy; // source position for the blur
+  float alpha;
+  LICE_pixel color;
+  float srcx, srcy, srcw, srch; // source rect for the scaled blit
+  float sc[4], add[4]; // LICE_MultiplyAddRect
+  bool inplace; // blur from dest to itself
+  const LICE_pixel_chan *glyph;
+  int glyph_span;
+};
+
+static void run(const test &t, LICE_IBitmap *dest, LICE_IBitmap *src, const params &p)
+{
+  switch (t.kind)
+  {
+    case KIND_BLIT: LICE_Blit(dest,src,p.x,p.y,0,0,p.w,p.h,p.alpha,t.mode); break;
+    case KIND_FILL: LICE_FillRect(dest,p.x,p.y,p.w,p.h,p.color,p.alpha,t.mode); break;
+    case KIND_SCALED: LICE_ScaledBlit(dest,src,p.x,p.y,p.w,p.h,p.srcx,p.srcy,p.srcw,p.srch,p.alpha,t.mode); break;
+    case KIND_MULADD:
+      LICE_MultiplyAddRect(dest,p.x,p.y,p.w,p.h,p.sc[0],p.sc[1],p.sc[2],p.sc[3],p.add[0],p.add[1],p.add[2],p.add[3]);
+    break;
+    case KIND_BLUR: LICE_Blur(dest,p.inplace ? dest : src,p.x,p.y,p.sx,p.sy,p.w,p.h); break;
+    case KIND_GLYPH: LICE_DrawGlyphEx(dest,p.x,p.y,p.color,p.glyph,p.w,p.glyph_span,p.h,p.alpha,t.mode); break;
+  }
+}
+
+static float rndf(float lo, float hi)
+{
+  return lo + (hi - lo) * (rnd() % 10001) / 10000.0f;
+}
+
+// compares each level against the scalar path over random rects, alphas and colors
+static bool verify(const test &t, int maxlevel)
+{
+  LICE_MemBitmap src(67,45), dest(71,49), ref(71,49), orig(71,49);
+  static LICE_pixel_chan glyph[80*60];
+  bool ok = true;
+
+  for (int iter = 0; iter < 2000 && ok; iter ++)
+  {
+    randomize(&src);
+    randomize(&orig);
+
+    params p;
+    p.x = rnd() % 8;
+    p.y = rnd() % 4;
+    p.w = 1 + rnd() % 67;
+    p.h = 1 + rnd() % 45;
+    p.sx = p.sy = 0;
+    p.alpha = (iter & 1) ? (1 + rnd() % 256) / 256.0f : (rnd() % 1000) / 999.0f;
+    p.color = LICE_RGBA(rnd()&0xff,rnd()&0xff,rnd()&0xff,rnd()&0xff);
+    p.inplace = false;
+    p.glyph = glyph;
+    p.glyph_span = p.w;
+
+    switch (t.kind)
+    {
+      case KIND_SCALED:
+        // from a quarter to double size, flipped at times, partly outside dest or src at times
+        p.x = (int)(rnd() % 90) - 10;
+        p.y = (int)(rnd() % 60) - 10;
+        p.w = 1 + rnd() % 100;
+        p.h = 1 + rnd() % 70;
+        if (!(rnd() & 7)) p.w = -p.w;
+        if (!(rnd() & 7)) p.h = -p.h;
+        p.srcx = rndf(-4.0f,60.0f);
+        p.srcy = rndf(-4.0f,40.0f);
+        p.srcw = (p.w < 0 ? -p.w : p.w) * rndf(0.5f,1.6f);
+        p.srch = (p.h < 0 ? -p.h : p.h) * rndf(0.5f,1.6f);
+        // exact 2x enlargements and whole source coordinates, where xfrac and yfrac are 0 for some pixels
+        if (!(rnd() & 3)) { p.srcx = (float)(int)p.srcx; p.srcw = (p.w < 0 ? -p.w : p.w) * 0.5f; }
+        if (!(rnd() & 3)) { p.srcy = (float)(int)p.srcy; p.srch = (float)(p.h < 0 ? -p.h : p.h); }
+      break;
+      case KIND_MULADD:
+        for (int i = 0; i < 4; i ++)
+        {
+          p.sc[i] = rndf(-1.5f,2.5f);
+          p.add[i] = rndf(-300.0f,300.0f);
+        }
+        if (!(rnd() & 15)) p.sc[rnd()&3] = 200.0f; // too large for the SIMD path
+        p.x = (int)(rnd() % 20) - 5;
+        p.y = (int)(rnd() % 20) - 5;
+      break;
+      case KIND_BLUR:
+        p.sx = rnd() % 8;
+        p.sy = rnd() % 4;
+        if (rnd() & 1)
+        {
+          p.inplace = true;
+          if (rnd() & 3) { p.sx = p.x; p.sy = p.y; }
+        }
+      break;
+      case KIND_GLYPH:
+        for (int i = 0; i < (int)sizeof(glyph); i ++) glyph[i] = (rnd()%5) < 2 ? 0 : (rnd()&1) ? 255 : rnd()&0xff;
+        p.x = (int)(rnd() % 80) - 8;
+        p.y = (int)(rnd() % 60) - 8;
+        p.w = 1 + rnd() % 70;
+        p.h = 1 + rnd() % 50;
+        p.glyph_span = p.w + rnd() % 8;
+        if (rnd() & 1)
+        {
+          // bottom up
+          p.glyph = glyph + p.glyph_span * (p.h-1);
+          p.glyph_span = -p.glyph_span;
+        }
+      break;
+    }
+
+    LICE_SetSIMDLevel(0);
+    LICE_Copy(&ref,&orig);
+    run(t,&ref,&src,p);
+
+    for (int level = 1; level <= maxlevel && ok; level ++)
+    {
+      LICE_SetSIMDLevel(level);
+      LICE_Copy(&dest,&orig);
+      run(t,&dest,&src,p);
+      if (memcmp(dest.getBits(),ref.getBits(),dest.getRowSpan()*dest.getHeight()*sizeof(LICE_pixel)))
+      {
+        printf("MISMATCH: %s, %s, alpha=%f, %dx%d\n",t.name,s_level_names[level],p.alpha,p.w,p.h);
+        ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  const double seconds = argc > 1 ? atof(argv[1]) : 0.25;
+  if (seconds <= 0.0)
+  {
+    printf("usage: simdbench [seconds per test (0.25)]\n");
+    return 2;
+  }
+
+  const int maxlevel = LICE_SetSIMDLevel(-1);
+  printf("SIMD level: %s\n",s_level_names[maxlevel]);
+
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(s_tests)/sizeof(s_tests[0]); i ++)
+    if (!verify(s_tests[i],maxlevel)) ok = false;
+  printf("bit-exact with scalar: %s\n\n",ok ? "yes" : "NO");
+
+  const int sz = 1024;
+  LICE_MemBitmap src(sz,sz), dest(sz,sz);
+  randomize(&src);
+  randomize(&dest);
+
+  static LICE_pixel_chan glyph[sz*sz];
+  for (int i = 0; i < sz*sz; i ++) glyph[i] = (rnd()%5) < 2 ? 0 : (rnd()&1) ? 255 : rnd()&0xff;
+
+  printf("%-17s %-6s","MPix/s","alpha");
+  for (int level = 0; level <= maxlevel; level ++) printf(" %12s",s_level_names[level]);
+  printf("\n");
+
+  static const float alphas[] = { 0.5f, 1.0f };
+  for (size_t i = 0; i < sizeof(s_tests)/sizeof(s_tests[0]); i ++)
+  {
+    const test &t = s_tests[i];
+    for (size_t a = 0; a < sizeof(alphas)/sizeof(alphas[0]); a ++)
+    {
+      if (a && (t.kind == KIND_MULADD || t.kind == KIND_BLUR)) continue; // no alpha
+
+      params p;
+      p.x = p.y = p.sx = p.sy = 0;
+      p.w = p.h = sz;
+      p.alpha = alphas[a] * ((t.mode&(LICE_BLIT_MODE_MASK|LICE_BLIT_USE_ALPHA)) == LICE_BLIT_MODE_COPY ? 0.9f : 1.0f); // avoid the copy fast paths
+      p.color = LICE_RGBA(200,100,50,255);
+      p.srcx = p.srcy = 0.3f; // a 1.25x enlargement
+      p.srcw = p.srch = sz * 0.8f;
+      for (int c = 0; c < 4; c ++) { p.sc[c] = 0.9f; p.add[c] = 0.05f; }
+      p.inplace = true;
+      p.glyph = glyph;
+      p.glyph_span = sz;
+
+      if (t.kind == KIND_MULADD || t.kind == KIND_BLUR) printf("%-17s %-6s",t.name,"-");
+      else printf("%-17s %-6.3f",t.name,p.alpha);
+      for (int level = 0; level <= maxlevel; level ++)
+      {
+        LICE_SetSIMDLevel(level);
+        int n = 0;
+        const double t0 = now();
+        double t1;
+        do
+        {
+          run(t,&dest,&src,p);
+          n ++;
+          t1 = now();
+        }
+        while (t1 - t0 < seconds);
+        printf(" %12.1f",n * (double)sz * sz / (t1 - t0) / 1000000.0);
+      }
+      printf("\n");
+    }
+  }
+  LICE_SetSIMDLevel(maxlevel);
+
+  return ok ? 0 : 1;
+}
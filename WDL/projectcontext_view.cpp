@@ -0,0 +1,521 @@
+/*
+  projectcontext_view.cpp: zero-copy reading and parallel block indexing of RPP-style state,
+  see projectcontext_view.h
+*/
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <strings.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+
+#include "projectcontext_view.h"
+#include "fileread.h"
+#include "wdl_base64.h"
+
+#define WDL_PROJECTSTATE_INDEX_MINCHUNK (256*1024) // scan at least this many bytes per thread
+#define WDL_PROJECTSTATE_INDEX_MAXTHREADS 16
+
+// skips blank lines and leading whitespace, returns false at the end of the buffer. Lines end at \n or NUL,
+// *p is left after the terminator
+static bool wdl_projview_nextline(const char **p, const char *ep, const char **line, int *len)
+{
+  const char *s = *p;
+  while (s < ep && (!*s || *s == ' ' || *s == '\t' || *s == '\r' || *s == '\n')) s++;
+  if (s >= ep)
+  {
+    *p = s;
+    return false;
+  }
+
+  const size_t avail = ep-s;
+  size_t l = strnlen(s,avail);
+  const char *nl = (const char *)memchr(s,'\n',l);
+  if (nl) l = nl-s;
+
+  *p = l < avail ? s+l+1 : ep;
+  if (l > 0 && s[l-1] == '\r') l--;
+  *line = s;
+  *len = (int)l;
+  return true;
+}
+
+
+int WDL_ProjectLine::parse(const char *line, int linelen)
+{
+  m_nt=0;
+  m_eat=0;
+  m_tokens=m_toklist_small;
+  m_line=line;
+  m_linelen=linelen;
+  if (!line) return -1;
+
+  const char *p = line, *ep = line+linelen;
+  while (p < ep && (*p == ' ' || *p == '\t')) p++;
+  if (p >= ep) return 0;
+
+  for (;;)
+  {
+    char q=0;
+    switch (*p)
+    {
+      case ';':
+      case '#':
+        return 0; // comment
+      case '"':  p++; q='"'; break;
+      case '\'': p++; q='\''; break;
+      case '`':  p++; q='`'; break;
+    }
+
+    const char *basep = p;
+    if (!q) while (p < ep && *p != ' ' && *p != '\t') p++;
+    else while (p < ep && *p != q) p++;
+
+    if (m_nt >= (int) (sizeof(m_toklist_small)/sizeof(m_toklist_small[0])))
+    {
+      m_tokens = m_toklist_big.ResizeOK(m_nt+1,false);
+      if (!m_tokens)
+      {
+        m_tokens = m_toklist_small;
+        m_nt=0;
+        return -1;
+      }
+      if (m_nt == (int) (sizeof(m_toklist_small)/sizeof(m_toklist_small[0])))
+        memcpy(m_tokens,m_toklist_small,m_nt*sizeof(tok));
+    }
+    tok *t = m_tokens + m_nt++;
+    t->str = basep;
+    t->len = (int)(p-basep);
+    t->quote = q;
+
+    if (p >= ep)
+    {
+      if (q)
+      {
+        m_nt=0;
+        return -2;
+      }
+      return 0;
+    }
+
+    p++;
+    while (p < ep && (*p == ' ' || *p == '\t')) p++;
+    if (p >= ep) return 0;
+  }
+}
+
+const char *WDL_ProjectLine::gettoken_str(int token, int *len) const
+{
+  const tok *t = gettok(token);
+  if (len) *len = t ? t->len : 0;
+  return t ? t->str : "";
+}
+
+int WDL_ProjectLine::gettoken_len(int token) const
+{
+  const tok *t = gettok(token);
+  return t ? t->len : 0;
+}
+
+bool WDL_ProjectLine::gettoken_equals(int token, const char *str) const
+{
+  const tok *t = gettok(token);
+  if (!t) return false;
+  const size_t l = strlen(str);
+  return l == (size_t)t->len && !memcmp(t->str,str,l);
+}
+
+int WDL_ProjectLine::gettoken_strcpy(int token, char *buf, int bufsz) const
+{
+  const tok *t = gettok(token);
+  const int l = t ? t->len : 0;
+  if (bufsz > 0)
+  {
+    const int cl = l < bufsz ? l : bufsz-1;
+    if (cl > 0) memcpy(buf,t->str,cl);
+    buf[cl]=0;
+  }
+  return l;
+}
+
+const char *WDL_ProjectLine::gettoken_cstr(int token, char *buf, int bufsz) const
+{
+  const tok *t = gettok(token);
+  if (!t) return "";
+  char *p = buf;
+  if (t->len >= bufsz)
+  {
+    p = (char *)m_tmp.ResizeOK(t->len+1,false);
+    if (!p) return "";
+  }
+  memcpy(p,t->str,t->len);
+  p[t->len]=0;
+  return p;
+}
+
+double WDL_ProjectLine::gettoken_float(int token, int *success) const
+{
+  const tok *t = gettok(token);
+  if (!t)
+  {
+    if (success) *success=0;
+    return 0.0;
+  }
+  if (success) *success = t->len ? 1 : 0;
+
+  char buf[512];
+  int ot = 0;
+  for (int x = 0; x < t->len && ot < (int)sizeof(buf)-1; x ++)
+  {
+    char c = t->str[x];
+    if (c == ',') c = '.';
+    else if (success && (c < '0' || c > '9') && c != '.') *success=0;
+    buf[ot++]=c;
+  }
+  buf[ot] = 0;
+  return atof(buf);
+}
+
+int WDL_ProjectLine::gettoken_int(int token, int *success) const
+{
+  if (!gettoken_len(token))
+  {
+    if (success) *success=0;
+    return 0;
+  }
+  char buf[128];
+  const char *tok = gettoken_cstr(token,buf,sizeof(buf));
+  char *tmp;
+  int l;
+  if (tok[0] == '-') l=(int)strtol(tok,&tmp,0);
+  else l=(int)strtoul(tok,&tmp,0);
+  if (success) *success=! (int)(*tmp);
+  return l;
+}
+
+unsigned int WDL_ProjectLine::gettoken_uint(int token, int *success) const
+{
+  if (!gettoken_len(token))
+  {
+    if (success) *success=0;
+    return 0;
+  }
+  char buf[128];
+  const char *p = gettoken_cstr(token,buf,sizeof(buf));
+  char *tmp;
+  if (p[0] == '-') ++p;
+  unsigned int val=(int)strtoul(p, &tmp, 0);
+  if (success) *success=! (int)(*tmp);
+  return val;
+}
+
+char WDL_ProjectLine::gettoken_quotingchar(int token) const
+{
+  const tok *t = gettok(token);
+  return t ? t->quote : 0;
+}
+
+int WDL_ProjectLine::gettoken_enum(int token, const char *strlist) const
+{
+  const tok *t = gettok(token);
+  if (!t) return -1;
+
+  int x=0;
+  if (t->len) while (*strlist)
+  {
+    const size_t l = strlen(strlist);
+#ifdef _WIN32
+    if (l == (size_t)t->len && !strnicmp(t->str,strlist,l)) return x;
+#else
+    if (l == (size_t)t->len && !strncasecmp(t->str,strlist,l)) return x;
+#endif
+    strlist += l+1;
+    x++;
+  }
+  return -1;
+}
+
+
+WDL_ProjectStateReader::WDL_ProjectStateReader(const void *buf, int sz) : m_tmpflag(0), m_file(NULL)
+{
+  m_buf = m_ptr = (const char *)buf;
+  m_endptr = m_buf && sz > 0 ? m_buf+sz : m_buf;
+}
+
+WDL_ProjectStateReader::~WDL_ProjectStateReader()
+{
+  delete m_file;
+}
+
+WDL_ProjectStateReader *WDL_ProjectStateReader::CreateFileMap(const char *fn)
+{
+  WDL_FileRead *fr = new WDL_FileRead(fn,0,65536,1,0,0x7fffffff);
+  if (!fr->IsOpen())
+  {
+    delete fr;
+    return NULL;
+  }
+
+  int len = 0x7fffffff;
+  const void *view = fr->GetMappedView(0,&len);
+  if (view)
+  {
+    WDL_ProjectStateReader *rd = new WDL_ProjectStateReader(view,len);
+    rd->m_file = fr;
+    return rd;
+  }
+
+  // not mapped (e.g. an empty file, or no mmap support), read it
+  WDL_ProjectStateReader *rd = new WDL_ProjectStateReader(NULL,0);
+  const WDL_FILEREAD_POSTYPE fsize = fr->GetSize();
+  char *p = fsize > 0 && fsize < 0x7fffffff ? (char *)rd->m_filebuf.ResizeOK((int)fsize,false) : NULL;
+  if (p)
+  {
+    const int rdlen = fr->Read(p,(int)fsize);
+    rd->m_buf = rd->m_ptr = p;
+    rd->m_endptr = p + (rdlen > 0 ? rdlen : 0);
+  }
+  delete fr;
+  return rd;
+}
+
+bool WDL_ProjectStateReader::GetLineView(const char **line, int *len)
+{
+  return wdl_projview_nextline(&m_ptr,m_endptr,line,len);
+}
+
+int WDL_ProjectStateReader::GetLine(char *buf, int buflen)
+{
+  const char *line;
+  int len;
+  if (!wdl_projview_nextline(&m_ptr,m_endptr,&line,&len))
+  {
+    if (buflen > 0 && buf) buf[0]=0;
+    return -1;
+  }
+  if (buflen > 0 && buf)
+  {
+    if (len > buflen-1) len = buflen-1;
+    memcpy(buf,line,len);
+    buf[len]=0;
+  }
+  return 0;
+}
+
+bool WDL_ProjectStateReader::GetNextLine(WDL_ProjectLine *lpOut)
+{
+  const char *line;
+  int len;
+  while (wdl_projview_nextline(&m_ptr,m_endptr,&line,&len))
+  {
+    if (lpOut->parse(line,len) || lpOut->getnumtokens() <= 0) continue;
+    return true;
+  }
+  lpOut->parse("",0);
+  return false;
+}
+
+// returns the first character of the line after whitespace and a quote (as ProjectContext_EatCurrentBlock() checks it), or 0
+static char wdl_projview_linetype(const char *line, int len)
+{
+  int x = 0;
+  while (x < len && (line[x] == ' ' || line[x] == '\t')) x++;
+  if (x < len && (line[x] == '\'' || line[x] == '"' || line[x] == '`')) x++;
+  return x < len ? line[x] : 0;
+}
+
+bool WDL_ProjectStateReader::EatCurrentBlock()
+{
+  int child_count=1;
+  const char *line;
+  int len;
+  while (wdl_projview_nextline(&m_ptr,m_endptr,&line,&len))
+  {
+    const char c = wdl_projview_linetype(line,len);
+    if (c == '>') { if (--child_count < 1) return true; }
+    else if (c == '<') child_count++;
+  }
+  return false;
+}
+
+int WDL_ProjectStateReader::DecodeBinary(WDL_HeapBuf *hb)
+{
+  int child_count=1;
+  const char *line;
+  int len;
+  while (wdl_projview_nextline(&m_ptr,m_endptr,&line,&len))
+  {
+    while (len > 0 && (*line == ' ' || *line == '\t')) { line++; len--; }
+    if (len > 0 && (*line == '\'' || *line == '"' || *line == '`')) { line++; len--; } // skip a quote if any
+    if (len < 1) continue;
+
+    if (line[0] == '<') child_count++;
+    else if (line[0] == '>') { if (child_count-- == 1) return 0; }
+    else if (child_count == 1)
+    {
+      const int os = hb->GetSize();
+      const int maxl = (len*3)/4 + 16; // the SIMD decoders want some room
+      unsigned char *dest = (unsigned char *)hb->ResizeOK(os+maxl,false);
+      if (dest) hb->Resize(os + wdl_base64decode_len(line,len,dest+os,maxl),false);
+    }
+  }
+  return -1;
+}
+
+
+struct wdl_projview_event
+{
+  int start, end; // line
+  int depth; // relative to the start of the chunk, before an open, after a close
+  bool open;
+};
+
+struct wdl_projview_chunk
+{
+  const char *buf;
+  int start, end;
+  int net; // depth change over the chunk
+  WDL_TypedBuf<wdl_projview_event> events;
+
+#ifdef _WIN32
+  HANDLE thread;
+  static unsigned WINAPI _threadfunc(void *p) { ((wdl_projview_chunk *)p)->Scan(); return 0; }
+#else
+  pthread_t thread;
+  static void *_threadfunc(void *p) { ((wdl_projview_chunk *)p)->Scan(); return NULL; }
+#endif
+
+  void Scan()
+  {
+    const char *p = buf+start, *ep = buf+end, *line;
+    int len, d = 0;
+    while (wdl_projview_nextline(&p,ep,&line,&len))
+    {
+      const char c = wdl_projview_linetype(line,len);
+      if (c != '<' && c != '>') continue;
+
+      wdl_projview_event ev;
+      ev.start = (int)(line-buf);
+      ev.end = ev.start+len;
+      ev.open = c == '<';
+      if (ev.open) ev.depth = d++;
+      else ev.depth = --d;
+      events.Add(ev);
+    }
+    net = d;
+  }
+};
+
+static int wdl_projview_numcpus()
+{
+#ifdef _WIN32
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  const int n = (int)si.dwNumberOfProcessors;
+#else
+  const int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return n < 1 ? 1 : n;
+}
+
+int WDL_ProjectState_IndexBlocks(const void *_buf, int sz, int depth, WDL_TypedBuf<WDL_ProjectStateBlock> *list, int nthreads)
+{
+  const char *buf = (const char *)_buf;
+  if (!buf || sz < 1 || !list) return 0;
+
+  if (nthreads < 1) nthreads = wdl_projview_numcpus();
+  if (nthreads > WDL_PROJECTSTATE_INDEX_MAXTHREADS) nthreads = WDL_PROJECTSTATE_INDEX_MAXTHREADS;
+  if (nthreads > sz / WDL_PROJECTSTATE_INDEX_MINCHUNK) nthreads = sz / WDL_PROJECTSTATE_INDEX_MINCHUNK;
+  if (nthreads < 1) nthreads = 1;
+
+  // chunks start after a line terminator, so every chunk sees the same lines that a scan from the start would
+  wdl_projview_chunk chunks[WDL_PROJECTSTATE_INDEX_MAXTHREADS];
+  int nchunks = 0, pos = 0;
+  for (int i = 0; i < nthreads && pos < sz; i ++)
+  {
+    int end = sz;
+    if (i < nthreads-1)
+    {
+      end = (int)(((WDL_INT64)sz * (i+1)) / nthreads);
+      if (end < pos) end = pos;
+      while (end < sz && buf[end] && buf[end] != '\n') end++;
+      if (end < sz) end++;
+    }
+    chunks[nchunks].buf = buf;
+    chunks[nchunks].start = pos;
+    chunks[nchunks].end = end;
+    chunks[nchunks].net = 0;
+    nchunks++;
+    pos = end;
+  }
+
+  int nstarted = 0;
+  for (int i = 1; i < nchunks; i ++)
+  {
+#ifdef _WIN32
+    unsigned int id;
+    chunks[i].thread = (HANDLE)_beginthreadex(NULL,0,wdl_projview_chunk::_threadfunc,chunks+i,0,&id);
+    if (!chunks[i].thread) break;
+#else
+    if (pthread_create(&chunks[i].thread,NULL,wdl_projview_chunk::_threadfunc,chunks+i)) break;
+#endif
+    nstarted++;
+  }
+  chunks[0].Scan();
+  for (int i = 1 + nstarted; i < nchunks; i ++) chunks[i].Scan(); // if threads couldn't be started
+  for (int i = 1; i <= nstarted; i ++)
+  {
+#ifdef _WIN32
+    WaitForSingleObject(chunks[i].thread,INFINITE);
+    CloseHandle(chunks[i].thread);
+#else
+    pthread_join(chunks[i].thread,NULL);
+#endif
+  }
+
+  const int oldsz = list->GetSize();
+  WDL_ProjectStateBlock blk;
+  bool inblock = false;
+  int base = 0;
+  for (int i = 0; i < nchunks; i ++)
+  {
+    const wdl_projview_event *ev = chunks[i].events.Get();
+    const int nev = chunks[i].events.GetSize();
+    for (int x = 0; x < nev; x ++)
+    {
+      if (ev[x].depth + base != depth) continue;
+      if (ev[x].open)
+      {
+        const char *p = buf + ev[x].start, *ep = buf + ev[x].end;
+        while (p < ep && *p != '<') p++;
+        if (p < ep) p++;
+        const char *n = p;
+        while (p < ep && *p != ' ' && *p != '\t') p++;
+        blk.start = ev[x].start;
+        blk.name = (int)(n-buf);
+        blk.namelen = (int)(p-n);
+        inblock = true;
+      }
+      else if (inblock)
+      {
+        blk.end = ev[x].end;
+        blk.closed = true;
+        list->Add(blk);
+        inblock = false;
+      }
+    }
+    base += chunks[i].net;
+  }
+  if (inblock)
+  {
+    blk.end = sz;
+    blk.closed = false;
+    list->Add(blk);
+  }
+  return list->GetSize() - oldsz;
+}
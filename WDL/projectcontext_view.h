@@ -0,0 +1,122 @@
+#ifndef _PROJECTCONTEXT_VIEW_H_
+#define _PROJECTCONTEXT_VIEW_H_
+
+// Zero-copy reading of RPP-style state (as written by ProjectStateContext) from a buffer in memory or a
+// memory mapped file. Lines and tokens are returned as pointers into the buffer (with lengths, they are
+// not NUL terminated), rather than being copied by GetLine() and again by LineParser.
+//
+// Lines are split the way ProjectStateContext_Mem/_File/_GenericRead split them: blank lines and leading
+// whitespace are skipped, a line ends at '\n' or NUL, and a trailing '\r' is removed. Unlike
+// ProjectStateContext::GetLine(), long lines are not truncated to the caller's buffer (ProjectContext_GetNextLine()
+// etc. truncate at 4095 characters).
+//
+// WDL_ProjectStateReader is also a (read only) ProjectStateContext, so the existing helpers such as
+// cfg_decode_textblock() can be mixed with the zero-copy calls.
+//
+// WDL_ProjectState_IndexBlocks() finds the blocks at a given nesting depth (e.g. the tracks of a project),
+// scanning the buffer on several threads, so that they can then be parsed separately (and in parallel).
+
+#include <stdarg.h>
+#include "projectcontext.h"
+#include "heapbuf.h"
+
+class WDL_FileRead;
+
+// tokens are split as LineParser::parse() splits them (comments start with ; or #, quotes are " ' or `)
+class WDL_ProjectLine
+{
+  public:
+    WDL_ProjectLine() : m_nt(0), m_eat(0), m_tokens(m_toklist_small), m_line(NULL), m_linelen(0) { }
+
+    // parses a line from the buffer, returns <0 on error (-1=mem, -2=unterminated quotes), as LineParser::parse()
+    int parse(const char *line, int linelen);
+
+    int getnumtokens() const { return m_nt-m_eat; }
+    void eattoken() { if (m_eat<m_nt) m_eat++; }
+
+    const char *getline(int *len) const { if (len) *len=m_linelen; return m_line; }
+
+    const char *gettoken_str(int token, int *len) const; // not NUL terminated, returns "" (len 0) if out of range
+    int gettoken_len(int token) const;
+    bool gettoken_equals(int token, const char *str) const; // case sensitive
+    int gettoken_strcpy(int token, char *buf, int bufsz) const; // copies a NUL terminated token, returns its length
+
+    // same results as the LineParser versions
+    double gettoken_float(int token, int *success=NULL) const;
+    int gettoken_int(int token, int *success=NULL) const;
+    unsigned int gettoken_uint(int token, int *success=NULL) const;
+    char gettoken_quotingchar(int token) const;
+    int gettoken_enum(int token, const char *strlist) const; // null seperated list
+
+  private:
+    struct tok { const char *str; int len; char quote; };
+    const tok *gettok(int token) const { token+=m_eat; return (unsigned int)token < m_nt ? m_tokens+token : NULL; }
+    const char *gettoken_cstr(int token, char *buf, int bufsz) const; // NUL terminated copy, in buf if it fits
+
+    unsigned int m_nt, m_eat;
+    tok *m_tokens; // m_toklist_small or m_toklist_big
+    const char *m_line;
+    int m_linelen;
+
+    WDL_TypedBuf<tok> m_toklist_big;
+    mutable WDL_HeapBuf m_tmp;
+    tok m_toklist_small[64];
+};
+
+
+class WDL_ProjectStateReader : public ProjectStateContext
+{
+  public:
+    // buf must remain valid while the reader (and any lines/tokens from it) are in use
+    WDL_ProjectStateReader(const void *buf, int sz);
+    virtual ~WDL_ProjectStateReader();
+
+    // maps a file (or reads it, if it can't be mapped), returns NULL if it can't be opened
+    static WDL_ProjectStateReader *CreateFileMap(const char *fn);
+
+    const char *GetBuffer() const { return m_buf; }
+    int GetBufferSize() const { return (int)(m_endptr-m_buf); }
+    int GetPosition() const { return (int)(m_ptr-m_buf); }
+    void SetPosition(int pos) { m_ptr = m_buf + (pos < 0 ? 0 : pos > GetBufferSize() ? GetBufferSize() : pos); }
+
+    // next non-blank line, returns false on eof
+    bool GetLineView(const char **line, int *len);
+
+    // next line that has tokens, like ProjectContext_GetNextLine()
+    bool GetNextLine(WDL_ProjectLine *lpOut);
+
+    // like ProjectContext_EatCurrentBlock(), skips to after the > that closes the current block
+    bool EatCurrentBlock();
+
+    // like cfg_decode_binary(), appends the base64 lines of the current block to hb, 0 on success
+    int DecodeBinary(WDL_HeapBuf *hb);
+
+    // ProjectStateContext (read only)
+    virtual void WDL_VARARG_WARN(printf,2,3) AddLine(const char * /* fmt */, ...) { }
+    virtual int GetLine(char *buf, int buflen); // returns -1 on eof
+    virtual WDL_INT64 GetOutputSize() { return 0; }
+    virtual int GetTempFlag() { return m_tmpflag; }
+    virtual void SetTempFlag(int flag) { m_tmpflag=flag; }
+
+  private:
+    const char *m_buf, *m_ptr, *m_endptr;
+    int m_tmpflag;
+    WDL_FileRead *m_file; // if created by CreateFileMap()
+    WDL_HeapBuf m_filebuf; // if the file couldn't be mapped
+};
+
+
+struct WDL_ProjectStateBlock
+{
+  int start; // offset of the line starting with <
+  int end; // offset of the end of the line with the matching > (or of the end of the buffer, if there is none)
+  int name, namelen; // offset and length of the block name (e.g. TRACK), which follows the <
+  bool closed; // false if the buffer ended before the block did
+};
+
+// Adds the blocks that start at the given depth (0 for blocks that are not inside another block, 1 for the
+// children of those, etc) to list, in order, and returns the number added. nthreads=0 uses one thread per CPU
+// (up to 16), small buffers are scanned on the calling thread.
+int WDL_ProjectState_IndexBlocks(const void *buf, int sz, int depth, WDL_TypedBuf<WDL_ProjectStateBlock> *list, int nthreads=0);
+
+#endif//_PROJECTCONTEXT_VIEW_H_
@@ -0,0 +1,434 @@
+#include "shm_audiobridge.h"
+
+#include <atomic>
+#include <new>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define SHM_AB_PAUSE() _mm_pause()
+#elif defined(_M_ARM64) || defined(_M_ARM)
+#include <intrin.h>
+#define SHM_AB_PAUSE() __yield()
+#elif defined(__aarch64__) || defined(__arm__)
+#define SHM_AB_PAUSE() __asm__ __volatile__("yield")
+#else
+#define SHM_AB_PAUSE() do { } while (0)
+#endif
+
+#define SHM_AB_MAGIC 0x42414457 // 'WDAB'
+#define SHM_AB_VERSION 1
+
+#if ATOMIC_INT_LOCK_FREE != 2
+#error WDL_SHM_AudioBridge needs lock free atomic ints
+#endif
+
+// counters are on their own cache lines, so the two processes don't contend for them
+struct WDL_SHM_AudioBridge::SharedHdr
+{
+  std::atomic<int> magic; // set last by the creator
+  int version, size;
+  int nch_in, nch_out, maxframes, nblocks, maxmidi;
+  char pad[64-8*4];
+
+  struct alignas(64) Chan
+  {
+    std::atomic<unsigned int> seq; // [0] blocks submitted by the plug-in side, [1] blocks completed by the sandbox
+    std::atomic<unsigned int> wake; // changes with seq and closed (futex word)
+    std::atomic<int> waiting; // the other side is going to sleep on wake
+    std::atomic<int> closed; // the side writing seq has gone
+  } chan[2];
+};
+
+static int shm_ab_align(int v) { return (v+63)&~63; }
+
+static double shm_ab_now_ms()
+{
+#ifdef _WIN32
+  LARGE_INTEGER c, f;
+  QueryPerformanceCounter(&c);
+  QueryPerformanceFrequency(&f);
+  return (double)c.QuadPart * 1000.0 / (double)f.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#endif
+}
+
+WDL_SHM_AudioBridge::WDL_SHM_AudioBridge(bool whichChan, const char *uniquestring,
+                                         int nch_in, int nch_out, int maxframes, int nblocks, int maxmidi)
+{
+  m_whichChan=whichChan;
+  m_hdr=NULL;
+  m_mem=NULL;
+  m_memsize=0;
+  m_seq=m_released=0;
+  m_inblock=false;
+#ifdef _WIN32
+  m_filemap=NULL;
+  m_events[0]=m_events[1]=NULL;
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  m_spins = si.dwNumberOfProcessors > 1 ? 4000 : 0;
+#else
+  m_spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 4000 : 0;
+#endif
+
+  // shm names are short on some systems (31 characters on macOS), so use a hash of uniquestring
+  unsigned int h = 2166136261u;
+  for (const char *p = uniquestring ? uniquestring : ""; *p; p ++) h = (h ^ (unsigned char)*p) * 16777619u;
+  char buf[128];
+#ifdef _WIN32
+  snprintf(buf,sizeof(buf),"Local\\WDL_SHMAB_%08x",h);
+#else
+  snprintf(buf,sizeof(buf),"/WDL_SHMAB_%08x",h);
+#endif
+  m_name.Set(buf);
+
+  if (!whichChan)
+  {
+    if (nch_in < 0) nch_in=0;
+    if (nch_out < 0) nch_out=0;
+    if (maxframes < 1) maxframes=1;
+    if (maxmidi < 0) maxmidi=0;
+    int nb = 1;
+    while (nb < nblocks && nb < 64) nb*=2; // power of two, so the indices can wrap
+    nblocks = nb;
+
+    const int blk_hdrsize = shm_ab_align(sizeof(Block));
+    const WDL_INT64 blksize = shm_ab_align((int) (blk_hdrsize + (WDL_INT64)(nch_in+nch_out)*maxframes*sizeof(double) + maxmidi*2*sizeof(WDL_SHM_MidiEvent)));
+    const WDL_INT64 memsize = shm_ab_align(sizeof(SharedHdr)) + blksize * nblocks;
+    if (memsize > 0x7fffffff) return;
+    m_memsize = (size_t) memsize;
+
+#ifdef _WIN32
+    m_filemap = CreateFileMapping(INVALID_HANDLE_VALUE,NULL,PAGE_READWRITE,0,(DWORD)m_memsize,m_name.Get());
+    if (m_filemap && GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+      // another bridge with the same uniquestring is open, don't take it over
+      CloseHandle(m_filemap);
+      m_filemap = NULL;
+    }
+    if (m_filemap) m_mem = (char *)MapViewOfFile(m_filemap,FILE_MAP_ALL_ACCESS,0,0,m_memsize);
+#else
+    shm_unlink(m_name.Get()); // left over from a crash
+    int fd = shm_open(m_name.Get(),O_RDWR|O_CREAT|O_EXCL,0600);
+    if (fd >= 0)
+    {
+      if (!ftruncate(fd,(off_t)m_memsize))
+      {
+        void *p = mmap(NULL,m_memsize,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+        if (p != MAP_FAILED) m_mem = (char *)p;
+      }
+      close(fd);
+      if (!m_mem) shm_unlink(m_name.Get());
+    }
+#endif
+    if (!m_mem) return;
+
+    memset(m_mem,0,m_memsize); // also faults the pages in
+    SharedHdr *hdr = (SharedHdr *)m_mem;
+    new (hdr) SharedHdr;
+    hdr->version = SHM_AB_VERSION;
+    hdr->size = (int)m_memsize;
+    hdr->nch_in = nch_in;
+    hdr->nch_out = nch_out;
+    hdr->maxframes = maxframes;
+    hdr->nblocks = nblocks;
+    hdr->maxmidi = maxmidi;
+    for (int x = 0; x < 2; x ++)
+    {
+      hdr->chan[x].seq.store(0);
+      hdr->chan[x].wake.store(0);
+      hdr->chan[x].waiting.store(0);
+      hdr->chan[x].closed.store(x); // until the sandbox opens it
+    }
+    hdr->magic.store(SHM_AB_MAGIC,std::memory_order_release);
+    m_hdr = hdr;
+  }
+  else
+  {
+#ifdef _WIN32
+    m_filemap = OpenFileMapping(FILE_MAP_ALL_ACCESS,FALSE,m_name.Get());
+    if (m_filemap)
+    {
+      m_mem = (char *)MapViewOfFile(m_filemap,FILE_MAP_ALL_ACCESS,0,0,0);
+      MEMORY_BASIC_INFORMATION mbi;
+      if (m_mem && VirtualQuery(m_mem,&mbi,sizeof(mbi))) m_memsize = mbi.RegionSize;
+    }
+#else
+    int fd = shm_open(m_name.Get(),O_RDWR,0600);
+    if (fd >= 0)
+    {
+      struct stat st;
+      if (!fstat(fd,&st) && st.st_size >= (off_t)sizeof(SharedHdr))
+      {
+        void *p = mmap(NULL,(size_t)st.st_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+        if (p != MAP_FAILED)
+        {
+          m_mem = (char *)p;
+          m_memsize = (size_t)st.st_size;
+        }
+      }
+      close(fd);
+    }
+#endif
+    if (!m_mem) return;
+
+    SharedHdr *hdr = (SharedHdr *)m_mem;
+    if (m_memsize < sizeof(SharedHdr) ||
+        hdr->magic.load(std::memory_order_acquire) != SHM_AB_MAGIC ||
+        hdr->version != SHM_AB_VERSION ||
+        hdr->size < 0 || (size_t)hdr->size > m_memsize) return;
+
+    nch_in = hdr->nch_in;
+    nch_out = hdr->nch_out;
+    maxframes = hdr->maxframes;
+    nblocks = hdr->nblocks;
+    maxmidi = hdr->maxmidi;
+    m_seq = hdr->chan[1].seq.load(); // a previous sandbox may have completed some
+    hdr->chan[1].closed.store(0);
+    m_hdr = hdr;
+  }
+
+  m_nch_in = nch_in;
+  m_nch_out = nch_out;
+  m_maxframes = maxframes;
+  m_nblocks = nblocks;
+  m_maxmidi = maxmidi;
+  m_hdrsize = shm_ab_align(sizeof(SharedHdr));
+  m_blk_hdrsize = shm_ab_align(sizeof(Block));
+  m_blk_midioffs = m_blk_hdrsize + (nch_in+nch_out)*maxframes*(int)sizeof(double);
+  m_blksize = shm_ab_align(m_blk_midioffs + maxmidi*2*(int)sizeof(WDL_SHM_MidiEvent));
+
+#ifdef _WIN32
+  for (int x = 0; x < 2; x ++)
+  {
+    snprintf(buf,sizeof(buf),"%s.%d",m_name.Get(),x);
+    m_events[x] = CreateEvent(NULL,FALSE,FALSE,buf);
+  }
+#else
+  mlock(m_mem,m_memsize); // if allowed
+#endif
+}
+
+WDL_SHM_AudioBridge::~WDL_SHM_AudioBridge()
+{
+  if (m_hdr)
+  {
+    const int w = m_whichChan ? 1 : 0;
+    m_hdr->chan[w].closed.store(1);
+    m_hdr->chan[w].wake.fetch_add(1);
+#ifdef _WIN32
+    if (m_events[w]) SetEvent(m_events[w]);
+#elif defined(__linux__)
+    syscall(SYS_futex,(int *)&m_hdr->chan[w].wake,FUTEX_WAKE,1,NULL,NULL,0);
+#endif
+  }
+#ifdef _WIN32
+  if (m_mem) UnmapViewOfFile(m_mem);
+  if (m_filemap) CloseHandle(m_filemap);
+  if (m_events[0]) CloseHandle(m_events[0]);
+  if (m_events[1]) CloseHandle(m_events[1]);
+#else
+  if (m_mem) munmap(m_mem,m_memsize);
+  if (m_mem && !m_whichChan) shm_unlink(m_name.Get());
+#endif
+}
+
+bool WDL_SHM_AudioBridge::IsClosed() const
+{
+  return !m_hdr || m_hdr->chan[m_whichChan ? 0 : 1].closed.load() != 0;
+}
+
+bool WDL_SHM_AudioBridge::WaitFor(int which, unsigned int old, int timeout_ms)
+{
+  SharedHdr::Chan &c = m_hdr->chan[which];
+  for (int x = 0; timeout_ms && x < m_spins; x ++)
+  {
+    if (c.seq.load(std::memory_order_acquire) != old) return true;
+    SHM_AB_PAUSE();
+  }
+
+  const double start = timeout_ms > 0 ? shm_ab_now_ms() : 0.0;
+  for (;;)
+  {
+    const unsigned int w = c.wake.load();
+    if (c.seq.load(std::memory_order_acquire) != old) return true;
+    if (c.closed.load()) return false;
+
+    int wait_ms = timeout_ms;
+    if (timeout_ms > 0)
+    {
+      wait_ms = timeout_ms - (int)(shm_ab_now_ms() - start);
+      if (wait_ms <= 0) return false;
+    }
+    else if (!timeout_ms) return false;
+
+    // Wake() changes wake after seq, then checks waiting: either it sees us waiting, or we see the new seq/wake
+    c.waiting.store(1);
+    if (c.seq.load() == old)
+    {
+#ifdef _WIN32
+      if (c.wake.load() == w) WaitForSingleObject(m_events[which],wait_ms < 0 ? INFINITE : (DWORD)wait_ms);
+#elif defined(__linux__)
+      struct timespec ts = { wait_ms/1000, (wait_ms%1000)*1000000 };
+      syscall(SYS_futex,(int *)&c.wake,FUTEX_WAIT,(int)w,wait_ms < 0 ? NULL : &ts,NULL,0);
+#else
+      if (c.wake.load() == w) usleep(50);
+#endif
+    }
+    c.waiting.store(0,std::memory_order_relaxed);
+  }
+}
+
+void WDL_SHM_AudioBridge::Wake(int which)
+{
+  SharedHdr::Chan &c = m_hdr->chan[which];
+  c.wake.fetch_add(1);
+  if (c.waiting.load())
+  {
+#ifdef _WIN32
+    SetEvent(m_events[which]);
+#elif defined(__linux__)
+    syscall(SYS_futex,(int *)&c.wake,FUTEX_WAKE,1,NULL,NULL,0);
+#endif
+  }
+}
+
+WDL_SHM_AudioBridge::Block *WDL_SHM_AudioBridge::BeginBlock()
+{
+  if (!m_hdr || m_whichChan || m_inblock) return NULL;
+  if (m_seq - m_released >= (unsigned int)m_nblocks) return NULL;
+  m_inblock = true;
+  Block *b = GetBlock(m_seq);
+  b->nframes = 0;
+  b->nmidi_in = b->nmidi_out = 0;
+  return b;
+}
+
+void WDL_SHM_AudioBridge::SubmitBlock()
+{
+  if (!m_inblock) return;
+  m_inblock = false;
+  m_hdr->chan[0].seq.store(++m_seq);
+  Wake(0);
+}
+
+WDL_SHM_AudioBridge::Block *WDL_SHM_AudioBridge::WaitBlock(int timeout_ms)
+{
+  if (!m_hdr || m_whichChan || m_released == m_seq) return NULL;
+  // completed runs ahead of m_released once blocks are done
+  for (;;)
+  {
+    const unsigned int done = m_hdr->chan[1].seq.load(std::memory_order_acquire);
+    if (done - m_released - 1 < m_seq - m_released) return GetBlock(m_released);
+    if (!WaitFor(1,done,timeout_ms)) return NULL;
+  }
+}
+
+void WDL_SHM_AudioBridge::ReleaseBlock()
+{
+  if (m_hdr && !m_whichChan && m_released != m_seq) m_released++;
+}
+
+WDL_SHM_AudioBridge::Block *WDL_SHM_AudioBridge::WaitRequest(int timeout_ms)
+{
+  if (!m_hdr || !m_whichChan) return NULL;
+  for (;;)
+  {
+    const unsigned int sub = m_hdr->chan[0].seq.load(std::memory_order_acquire);
+    if (sub != m_seq) return GetBlock(m_seq);
+    if (!WaitFor(0,sub,timeout_ms)) return NULL;
+  }
+}
+
+void WDL_SHM_AudioBridge::CompleteBlock()
+{
+  if (!m_hdr || !m_whichChan || m_hdr->chan[0].seq.load(std::memory_order_acquire) == m_seq) return;
+  m_hdr->chan[1].seq.store(++m_seq);
+  Wake(1);
+}
+
+bool WDL_SHM_AudioBridge::Process(const double * const *inputs, double **outputs, int nframes,
+                                  const WDL_SHM_MidiEvent *midiin, int nmidiin, int timeout_ms,
+                                  WDL_SHM_MidiEvent *midiout, int *nmidiout, int maxmidiout)
+{
+  int pos = 0, mpos = 0, mout = 0;
+  bool ok = m_hdr && !m_whichChan;
+
+  // replies to blocks that timed out before
+  while (ok && m_released != m_seq && WaitBlock(0)) ReleaseBlock();
+
+  while (ok && pos < nframes)
+  {
+    const int n = nframes - pos < m_maxframes ? nframes - pos : m_maxframes;
+    Block *b = BeginBlock();
+    if (!b) { ok = false; break; }
+
+    b->nframes = n;
+    b->flags = 0;
+    b->position = pos;
+    b->tempo = 0.0;
+    for (int ch = 0; ch < m_nch_in; ch ++)
+    {
+      if (inputs && inputs[ch]) memcpy(GetInput(b,ch),inputs[ch]+pos,n*sizeof(double));
+      else memset(GetInput(b,ch),0,n*sizeof(double));
+    }
+    WDL_SHM_MidiEvent *mev = GetMidiIn(b);
+    while (mpos < nmidiin && midiin[mpos].frame_offset < pos + n)
+    {
+      if (b->nmidi_in < m_maxmidi)
+      {
+        mev[b->nmidi_in] = midiin[mpos];
+        mev[b->nmidi_in].frame_offset -= pos;
+        if (mev[b->nmidi_in].frame_offset < 0) mev[b->nmidi_in].frame_offset = 0;
+        b->nmidi_in++;
+      }
+      mpos++;
+    }
+    SubmitBlock();
+
+    const unsigned int seq = m_seq - 1;
+    Block *r;
+    while ((r = WaitBlock(timeout_ms)) && m_released != seq) ReleaseBlock(); // late replies
+    if (!r) { ok = false; break; }
+
+    for (int ch = 0; ch < m_nch_out; ch ++)
+      if (outputs && outputs[ch]) memcpy(outputs[ch]+pos,GetOutput(r,ch),n*sizeof(double));
+    if (midiout && r->nmidi_out > 0)
+    {
+      const WDL_SHM_MidiEvent *oev = GetMidiOut(r);
+      for (int x = 0; x < r->nmidi_out && x < m_maxmidi && mout < maxmidiout; x ++)
+      {
+        midiout[mout] = oev[x];
+        midiout[mout++].frame_offset += pos;
+      }
+    }
+    ReleaseBlock();
+    pos += n;
+  }
+
+  if (!ok && outputs)
+  {
+    for (int ch = 0; ch < m_nch_out; ch ++)
+      if (outputs[ch]) memset(outputs[ch]+pos,0,(nframes-pos)*sizeof(double));
+  }
+  if (nmidiout) *nmidiout = mout;
+  return ok;
+}
@@ -0,0 +1,128 @@
+#ifndef _WDL_SHM_AUDIOBRIDGE_H_
+#define _WDL_SHM_AUDIOBRIDGE_H_
+
+// Per-block audio and MIDI exchange between two processes, e.g. a plug-in and a sandbox process hosting
+// the real processing, through a ring of blocks in shared memory.
+//
+// WDL_SHM_Connection/SHM_MsgReplyConnection are fine for control messages (state, parameter changes,
+// editor traffic), but every message is copied through queues and the waiting side polls (a socket, or
+// an event with a 1ms timeout), which is too slow to do once per audio block. Here the blocks are
+// processed in place: the host side writes inputs and MIDI into a block, submits it, and waits for the
+// other side to fill in the outputs. The indices are lock free (one producer and one consumer each way),
+// and a waiting side spins briefly (if there is more than one CPU), then sleeps on a futex (Linux) or a
+// named event (Windows); the other side only makes a system call to wake it if it is asleep. Other
+// systems sleep in short steps.
+//
+// Typical use: the plug-in creates a SHM_MsgReplyConnection and a WDL_SHM_AudioBridge (whichChan=false)
+// with the same unique string, launches the sandbox, which opens both (whichChan=true), and then:
+//
+//   plug-in audio thread:                      sandbox audio thread:
+//     if (!bridge.Process(ins,outs,n,...))       while (!quit)
+//       (sandbox is late or gone, outputs          if ((blk=bridge.WaitRequest(100)))
+//        were cleared)                             {
+//                                                    process GetInput()/GetMidiIn() to GetOutput()/GetMidiOut()
+//                                                    bridge.CompleteBlock();
+//                                                  }
+//
+// or, to overlap the processes, BeginBlock()/SubmitBlock() the next block before WaitBlock()/ReleaseBlock()
+// on the previous one (with nblocks >= 2, at the cost of a block of latency).
+//
+// A bridge connects exactly one plug-in with one sandbox, and one thread on each side. A sandbox serving
+// several plug-ins opens a bridge for each, with a unique string of its own (e.g. "<base>.<index>"), and
+// waits on each from its own thread, so that one slow plug-in doesn't hold up the others. On Windows,
+// creating a bridge fails if one with the same unique string is open.
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "wdltypes.h"
+#include "wdlstring.h"
+
+struct WDL_SHM_MidiEvent
+{
+  int frame_offset;
+  unsigned char msg[4]; // status, data1, data2, (unused)
+};
+
+class WDL_SHM_AudioBridge
+{
+public:
+  // whichChan=false creates the shared memory (the plug-in side, create it first), whichChan=true opens it (the
+  // sandbox side, which gets the sizes from the creator). Use IsOK() to see if it worked.
+  WDL_SHM_AudioBridge(bool whichChan, const char *uniquestring,
+                      int nch_in=2, int nch_out=2, int maxframes=4096, int nblocks=2, int maxmidi=256);
+  ~WDL_SHM_AudioBridge(); // also wakes the other side, whose waits then fail
+
+  bool IsOK() const { return m_hdr != NULL; }
+  bool IsClosed() const; // the other side has gone (or was never there)
+
+  int GetNumInputs() const { return m_nch_in; }
+  int GetNumOutputs() const { return m_nch_out; }
+  int GetMaxFrames() const { return m_maxframes; }
+  int GetNumBlocks() const { return m_nblocks; }
+  int GetMaxMidi() const { return m_maxmidi; }
+
+  void SetSpinCount(int spins) { m_spins = spins; } // before sleeping, default is 4000 with more than one CPU, 0 otherwise
+
+  // a block in shared memory, the data follows it
+  struct Block
+  {
+    int nframes;
+    int nmidi_in, nmidi_out;
+    int flags; // user defined (transport state, etc)
+    WDL_INT64 position; // user defined (sample position, etc)
+    double tempo; // user defined
+  };
+
+  double *GetInput(Block *b, int ch) const { return (double *)((char *)b + m_blk_hdrsize) + ch * m_maxframes; }
+  double *GetOutput(Block *b, int ch) const { return (double *)((char *)b + m_blk_hdrsize) + (m_nch_in + ch) * m_maxframes; }
+  WDL_SHM_MidiEvent *GetMidiIn(Block *b) const { return (WDL_SHM_MidiEvent *)((char *)b + m_blk_midioffs); }
+  WDL_SHM_MidiEvent *GetMidiOut(Block *b) const { return GetMidiIn(b) + m_maxmidi; }
+
+  // plug-in side (whichChan=false)
+  Block *BeginBlock(); // next block to fill in, NULL if all of them are in flight
+  void SubmitBlock(); // passes the block from BeginBlock() to the sandbox
+  Block *WaitBlock(int timeout_ms); // oldest submitted block once it has been processed, NULL on timeout/close (timeout_ms<0 waits forever)
+  void ReleaseBlock(); // done with the block from WaitBlock()
+
+  // runs nframes (split into blocks of up to GetMaxFrames()) through the sandbox and waits for the outputs. MIDI
+  // events must be sorted by frame_offset, each block's position is set to its offset in nframes. Returns false
+  // and clears the outputs if the sandbox doesn't reply in time (any late replies are discarded by the next
+  // call). midiout/nmidiout are optional.
+  bool Process(const double * const *inputs, double **outputs, int nframes,
+               const WDL_SHM_MidiEvent *midiin, int nmidiin, int timeout_ms,
+               WDL_SHM_MidiEvent *midiout=NULL, int *nmidiout=NULL, int maxmidiout=0);
+
+  // sandbox side (whichChan=true)
+  Block *WaitRequest(int timeout_ms); // next submitted block, NULL on timeout/close
+  void CompleteBlock(); // returns the block from WaitRequest(), with its outputs filled in
+
+private:
+  struct SharedHdr;
+  Block *GetBlock(unsigned int seq) const { return (Block *)(m_mem + m_hdrsize + (seq % (unsigned int)m_nblocks) * m_blksize); }
+  bool WaitFor(int which, unsigned int old, int timeout_ms); // waits for counter which (0=submitted, 1=completed) to change from old
+  void Wake(int which);
+
+  bool m_whichChan;
+  int m_nch_in, m_nch_out, m_maxframes, m_nblocks, m_maxmidi;
+  int m_hdrsize, m_blksize, m_blk_hdrsize, m_blk_midioffs;
+  int m_spins;
+
+  // local copies of our own counters
+  unsigned int m_seq; // plug-in: next block to submit, sandbox: next block to process
+  unsigned int m_released; // plug-in: next block to wait for
+  bool m_inblock;
+
+  SharedHdr *m_hdr;
+  char *m_mem;
+  size_t m_memsize;
+  WDL_FastString m_name;
+
+#ifdef _WIN32
+  HANDLE m_filemap;
+  HANDLE m_events[2]; // [0] set when blocks are submitted, [1] when they are completed
+#endif
+};
+
+#endif
@@ -2,12 +2,23 @@
 #define _WDL_SIMPLEPITCHSHIFT_H_
 
 
+#include <math.h>
 #include "queue.h"
 
 #ifndef WDL_SIMPLEPITCHSHIFT_SAMPLETYPE
 #define WDL_SIMPLEPITCHSHIFT_SAMPLETYPE double
 #endif
 
+#if !defined(WDL_SIMPLEPITCHSHIFT_NO_SSE) && !defined(WDL_SIMPLEPITCHSHIFT_USE_SSE)
+  #if defined(__SSE2__) || _M_IX86_FP >= 2 || defined(_M_X64) || defined(__x86_64__)
+    #define WDL_SIMPLEPITCHSHIFT_USE_SSE
+  #endif
+#endif
+
+#ifdef WDL_SIMPLEPITCHSHIFT_USE_SSE
+  #include <emmintrin.h>
+#endif
+
 
 #ifdef WDL_SIMPLEPITCHSHIFT_PARENTCLASS
 class WDL_SimplePitchShifter : public WDL_SIMPLEPITCHSHIFT_PARENTCLASS
@@ -62,6 +73,20 @@ public:
   void BufferDone(int input_filled);
   void FlushSamples() {}
 
+  // pitch shifts nch channels of non-interleaved samples without going through GetBuffer()/GetSamples(), for tempo=1.0:
+  // every call returns length samples, delayed by GetLatency(). outputs may be the same buffers as inputs
+  void ProcessBlock(WDL_SIMPLEPITCHSHIFT_SAMPLETYPE **inputs, WDL_SIMPLEPITCHSHIFT_SAMPLETYPE **outputs, int nch, int length);
+
+  // delay in samples of the output for the current quality and samplerate (at tempo=1.0, at other tempos the
+  // start of the output is trimmed instead and this returns 0)
+  int GetLatency() const
+  {
+    if (fabs(m_last_tempo-1.0)>=0.0000000001) return 0;
+    int bsize,olsize;
+    GetBlockSizes(&bsize,&olsize);
+    return bsize-bsize/2; // the read position starts bsize/2 ahead of the write position (modulo bsize)
+  }
+
   static const char *enumQual(int q);
   static bool GetSizes(int qv, int *ws, int *os); // if ws or os is NULL, enumerate available ws/os
 
@@ -78,7 +103,12 @@ public:
 #endif
 
 private:
+  void GetBlockSizes(int *bsize, int *olsize) const;
+  void PrepareBlock(int nch, int *bsize, int *olsize);
   void PitchShiftBlock(WDL_SIMPLEPITCHSHIFT_SAMPLETYPE *inputs, WDL_SIMPLEPITCHSHIFT_SAMPLETYPE *outputs, int nch, int length, double pitch, int bsize, int olsize, double srate);
+  // channel a of frame i is at inputs[a][i*instride]
+  template<int NCH> void RenderGrains(WDL_SIMPLEPITCHSHIFT_SAMPLETYPE * const *inputs, int instride, WDL_SIMPLEPITCHSHIFT_SAMPLETYPE * const *outputs, int outstride,
+                                      int nch, int length, double pitch, int bsize, int olsize);
 
 
 private:
@@ -90,6 +120,7 @@ private:
   WDL_Queue m_queue;
   WDL_TypedBuf<WDL_SIMPLEPITCHSHIFT_SAMPLETYPE> m_inbuf;
   WDL_TypedBuf<WDL_SIMPLEPITCHSHIFT_SAMPLETYPE> m_rsbuf;
+  WDL_TypedBuf<WDL_SIMPLEPITCHSHIFT_SAMPLETYPE *> m_chptrs;
 
   int m_pswritepos;
   int m_last_nch;
@@ -108,22 +139,8 @@ void WDL_SimplePitchShifter::BufferDone(int input_filled)
   if (input_filled>0)
   {
     m_hadinput=1;
-    int ws,os;
-    GetSizes(m_qual,&ws,&os);
-
-    int bsize=(int) (ws * 0.001 * m_srate);
-    if (bsize<16) bsize=16;
-    else if (bsize>128*1024)bsize=128*1024;
-
-    int olsize=(int) (os * 0.001 * m_srate);
-    if (olsize > bsize/2) olsize=bsize/2;
-    if (olsize<1)olsize=1;
-    if (m_psbuf.GetSize() != bsize*m_last_nch)
-    {
-      memset(m_psbuf.Resize(bsize*m_last_nch,false),0,sizeof(WDL_SIMPLEPITCHSHIFT_SAMPLETYPE)*bsize*m_last_nch);
-      m_pspos=(double) (bsize/2);
-      m_pswritepos=0;
-    }
+    int bsize,olsize;
+    PrepareBlock(m_last_nch,&bsize,&olsize);
 
     if (fabs(m_last_tempo-1.0)<0.0000000001)
     {
@@ -188,6 +205,48 @@ void WDL_SimplePitchShifter::BufferDone(int input_filled)
   }    
 }
 
+void WDL_SimplePitchShifter::GetBlockSizes(int *bsize, int *olsize) const
+{
+  int ws,os;
+  GetSizes(m_qual,&ws,&os);
+
+  int bs=(int) (ws * 0.001 * m_srate);
+  if (bs<16) bs=16;
+  else if (bs>128*1024)bs=128*1024;
+
+  int ol=(int) (os * 0.001 * m_srate);
+  if (ol > bs/2) ol=bs/2;
+  if (ol<1)ol=1;
+
+  *bsize=bs;
+  *olsize=ol;
+}
+
+void WDL_SimplePitchShifter::PrepareBlock(int nch, int *bsize, int *olsize)
+{
+  GetBlockSizes(bsize,olsize);
+  if (m_psbuf.GetSize() != *bsize*nch)
+  {
+    memset(m_psbuf.Resize(*bsize*nch,false),0,sizeof(WDL_SIMPLEPITCHSHIFT_SAMPLETYPE)*(*bsize)*nch);
+    m_pspos=(double) (*bsize/2);
+    m_pswritepos=0;
+  }
+}
+
+void WDL_SimplePitchShifter::ProcessBlock(WDL_SIMPLEPITCHSHIFT_SAMPLETYPE **inputs, WDL_SIMPLEPITCHSHIFT_SAMPLETYPE **outputs, int nch, int length)
+{
+  if (nch<1 || length<1) return;
+  set_nch(nch);
+  m_hadinput=1;
+
+  int bsize,olsize;
+  PrepareBlock(nch,&bsize,&olsize);
+
+  if (nch==1) RenderGrains<1>(inputs,1,outputs,1,nch,length,m_last_shift,bsize,olsize);
+  else if (nch==2) RenderGrains<2>(inputs,1,outputs,1,nch,length,m_last_shift,bsize,olsize);
+  else RenderGrains<0>(inputs,1,outputs,1,nch,length,m_last_shift,bsize,olsize);
+}
+
 const char *WDL_SimplePitchShifter::enumQual(int q)
 {
   int ws,os;
@@ -241,8 +300,72 @@ int WDL_SimplePitchShifter::GetSamples(int requested_output, WDL_SIMPLEPITCHSHIF
   return requested_output;
 }
 
+// one or two channels of a frame: the interpolated read at ipos1/ipos2, crossfaded with the read at tmp/tmp2 if xf,
+// then the input is written at writepos. the channel's input is read before anything is written, so in-place is fine
+template<class T> static inline void wdl_simplepitchshift_chan(T *psbuf, int ipos1, int ipos2, int tmp, int tmp2, int writepos,
+                                                             double frac0, double tfrac, bool xf, const T *in, T *out)
+{
+  const T inv=*in;
+  T o=(psbuf[ipos1]*(1-frac0)+psbuf[ipos2]*frac0);
+  if (xf) o=o*tfrac + (1-tfrac)*(psbuf[tmp]*(1-frac0)+psbuf[tmp2]*frac0);
+  psbuf[writepos]=inv;
+  *out=o;
+}
+
+template<class T> static inline void wdl_simplepitchshift_chan2(T *psbuf, int ipos1, int ipos2, int tmp, int tmp2, int writepos,
+                                                              double frac0, double tfrac, bool xf, const T *in0, const T *in1, T *out0, T *out1)
+{
+  const T inv0=*in0, inv1=*in1;
+  T o0=(psbuf[ipos1]*(1-frac0)+psbuf[ipos2]*frac0);
+  T o1=(psbuf[ipos1+1]*(1-frac0)+psbuf[ipos2+1]*frac0);
+  if (xf)
+  {
+    o0=o0*tfrac + (1-tfrac)*(psbuf[tmp]*(1-frac0)+psbuf[tmp2]*frac0);
+    o1=o1*tfrac + (1-tfrac)*(psbuf[tmp+1]*(1-frac0)+psbuf[tmp2+1]*frac0);
+  }
+  psbuf[writepos]=inv0;
+  psbuf[writepos+1]=inv1;
+  *out0=o0;
+  *out1=o1;
+}
+
+#ifdef WDL_SIMPLEPITCHSHIFT_USE_SSE
+// two interleaved channels at a time, same arithmetic as the scalar version
+static inline void wdl_simplepitchshift_chan2(double *psbuf, int ipos1, int ipos2, int tmp, int tmp2, int writepos,
+                                             double frac0, double tfrac, bool xf, const double *in0, const double *in1, double *out0, double *out1)
+{
+  const __m128d inv=_mm_set_pd(*in1,*in0);
+  const __m128d f1=_mm_set1_pd(1-frac0), f0=_mm_set1_pd(frac0);
+  __m128d o=_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(psbuf+ipos1),f1),_mm_mul_pd(_mm_loadu_pd(psbuf+ipos2),f0));
+  if (xf)
+  {
+    const __m128d x=_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(psbuf+tmp),f1),_mm_mul_pd(_mm_loadu_pd(psbuf+tmp2),f0));
+    o=_mm_add_pd(_mm_mul_pd(o,_mm_set1_pd(tfrac)),_mm_mul_pd(_mm_set1_pd(1-tfrac),x));
+  }
+  _mm_storeu_pd(psbuf+writepos,inv);
+  _mm_storel_pd(out0,o);
+  _mm_storeh_pd(out1,o);
+}
+#endif
+
 void WDL_SimplePitchShifter::PitchShiftBlock(WDL_SIMPLEPITCHSHIFT_SAMPLETYPE *inputs, WDL_SIMPLEPITCHSHIFT_SAMPLETYPE *outputs, int nch, int length, double pitch, int bsize, int olsize, double srate)
 {
+  if (nch<=2)
+  {
+    // interleaved: channel a is at inputs+a with a stride of nch
+    WDL_SIMPLEPITCHSHIFT_SAMPLETYPE **ptrs=m_chptrs.ResizeOK(nch*2,false);
+    if (!ptrs) return;
+    for (int a = 0; a < nch; a ++)
+    {
+      ptrs[a]=inputs+a;
+      ptrs[nch+a]=outputs+a;
+    }
+    if (nch==1) RenderGrains<1>(ptrs,nch,ptrs+nch,nch,nch,length,pitch,bsize,olsize);
+    else RenderGrains<2>(ptrs,nch,ptrs+nch,nch,nch,length,pitch,bsize,olsize);
+    return;
+  }
+
+  // more channels: the per channel loops over contiguous frames are faster here than RenderGrains<0> through pointers
   double iolsize=1.0/olsize;
 
   WDL_SIMPLEPITCHSHIFT_SAMPLETYPE *psbuf=m_psbuf.Get();
@@ -324,6 +447,92 @@ void WDL_SimplePitchShifter::PitchShiftBlock(WDL_SIMPLEPITCHSHIFT_SAMPLETYPE *in
   m_pswritepos=writepos;
 }
 
+template<int NCH> void WDL_SimplePitchShifter::RenderGrains(WDL_SIMPLEPITCHSHIFT_SAMPLETYPE * const *inputs, int instride,
+                                                           WDL_SIMPLEPITCHSHIFT_SAMPLETYPE * const *outputs, int outstride,
+                                                           int nch, int length, double pitch, int bsize, int olsize)
+{
+  if (NCH) nch=NCH;
+  double iolsize=1.0/olsize;
+
+  WDL_SIMPLEPITCHSHIFT_SAMPLETYPE *psbuf=m_psbuf.Get();
+
+  double dpi=pitch;
+
+  double pspos=m_pspos;
+  int writepos=m_pswritepos;
+  int writeposnch = writepos*nch;
+  int bsizench = bsize*nch;
+  int olsizench = olsize*nch;
+
+  for (int i = 0; i < length; i ++)
+  {
+    int ipos1=(int)pspos;
+    double frac0=pspos-ipos1;
+
+    ipos1*=nch;
+
+    int ipos2=ipos1+nch;
+    
+    if (ipos2 >= bsizench) ipos2=0;
+
+    // the crossfade to the read one overlap ahead, when the read position is about to cross the write position
+    bool xf=false;
+    double tfrac=0.0;
+    int tmp=0,tmp2=0;
+
+    double tv=pspos;
+    if (dpi >= 1.0)
+    {
+      if (tv > writepos) tv-=bsize;
+
+      if (tv >= writepos-olsize && tv < writepos)
+      {
+        xf=true;
+        tfrac=(writepos-tv)*iolsize;
+
+        if (tv+pitch >= writepos) pspos+=olsize;
+      }
+
+    }
+    else
+    {
+      if (tv<writepos) tv+=bsize;
+
+      if (tv >= writepos && tv < writepos+olsize)
+      {
+        xf=true;
+        tfrac=(tv-writepos)*iolsize;
+
+        // this is wrong, but blehhh?
+        if (tv+pitch < writepos+1) pspos += olsize;
+//        if (tv+pitch >= writepos+olsize) pspos += olsize;
+      }
+    }
+    if (xf)
+    {
+      tmp=ipos1+olsizench;
+      if (tmp>=bsizench) tmp-=bsizench;
+      tmp2=tmp+nch;
+      if (tmp2 >= bsizench) tmp2=0;
+    }
+
+    const int ii=i*instride, oi=i*outstride;
+    int a=0;
+    for (; a+1 < nch; a += 2)
+      wdl_simplepitchshift_chan2(psbuf+a,ipos1,ipos2,tmp,tmp2,writeposnch,frac0,tfrac,xf,
+                                 inputs[a]+ii,inputs[a+1]+ii,outputs[a]+oi,outputs[a+1]+oi);
+    if (a < nch)
+      wdl_simplepitchshift_chan(psbuf+a,ipos1,ipos2,tmp,tmp2,writeposnch,frac0,tfrac,xf,inputs[a]+ii,outputs[a]+oi);
+
+    if ((pspos+=pitch) >= bsize) pspos -= bsize;
+
+    writeposnch += nch;
+    if (++writepos >= bsize) writeposnch = writepos=0;
+  } // sample loop
+  m_pspos=pspos;
+  m_pswritepos=writepos;
+}
+
 #endif
 
 #endif
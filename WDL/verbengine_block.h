@@ -0,0 +1,490 @@
+#ifndef _VERBENGINE_BLOCK_H_
+#define _VERBENGINE_BLOCK_H_
+
+/*
+    WDL - verbengine_block.h
+    Copyright (C) 2007 and later Cockos Incorporated
+
+    Block processing version of WDL_ReverbEngine (see verbengine.h).
+
+    Each comb and allpass stage runs over a whole block at a time, with the left and right
+    delay lines of a stage in the two lanes of an SSE2 (or NEON) vector, and the denormal
+    filtering done on the vector instead of per sample with a branch. Delay buffers are
+    walked in runs between wrap points, so the inner loops have no index checks.
+
+    In WDL_REVERB_MODE_CLASSIC (the default) the output is bit-exact with
+    WDL_ReverbEngine::ProcessSampleBlock() for the same settings.
+
+    WDL_REVERB_MODE_DENSE gives a denser, less metallic tail for about the same cost:
+      - each comb is coupled to its neighbour (combs 0/1, 2/3, ...) through an energy
+        preserving rotation in the feedback path, so echoes recirculate through both lengths
+        and the echo density builds up faster without changing the decay time.
+      - the comb read positions are slowly modulated (a few samples, with a different rate
+        per comb), which breaks up the ringing of the fixed comb lengths.
+
+    Define WDL_REVERB_NO_SSE to use the portable lane code.
+
+    This software is provided 'as-is', without any express or implied
+    warranty.  In no event will the authors be held liable for any damages
+    arising from the use of this software.
+
+    Permission is granted to anyone to use this software for any purpose,
+    including commercial applications, and to alter it and redistribute it
+    freely, subject to the following restrictions:
+
+    1. The origin of this software must not be misrepresented; you must not
+       claim that you wrote the original software. If you use this software
+       in a product, an acknowledgment in the product documentation would be
+       appreciated but is not required.
+    2. Altered source versions must be plainly marked as such, and must not be
+       misrepresented as being the original software.
+    3. This notice may not be removed or altered from any source distribution.
+
+*/
+
+
+#include <math.h>
+#include <float.h>
+
+#include "verbengine.h"
+
+#if !defined(WDL_REVERB_NO_SSE) && !defined(WDL_REVERB_USE_SSE) && !defined(WDL_REVERB_USE_NEON)
+  #if defined(__SSE2__) || _M_IX86_FP >= 2 || defined(_M_X64) || defined(__x86_64__)
+    #define WDL_REVERB_USE_SSE
+  #elif defined(__aarch64__) || defined(_M_ARM64)
+    #define WDL_REVERB_USE_NEON
+  #endif
+#endif
+
+#if defined(WDL_REVERB_USE_SSE)
+  #include <emmintrin.h>
+#elif defined(WDL_REVERB_USE_NEON)
+  #include <arm_neon.h>
+#endif
+
+
+// two lanes of doubles: lane 0 is the left delay line of a stage, lane 1 the right
+#if defined(WDL_REVERB_USE_SSE)
+
+typedef __m128d wdl_verb_v2;
+static inline wdl_verb_v2 wdl_verb_v2_set(double a, double b) { return _mm_set_pd(b,a); }
+static inline wdl_verb_v2 wdl_verb_v2_set1(double a) { return _mm_set1_pd(a); }
+static inline wdl_verb_v2 wdl_verb_v2_load(const double *p) { return _mm_loadu_pd(p); }
+static inline void wdl_verb_v2_store(double *p, wdl_verb_v2 v) { _mm_storeu_pd(p,v); }
+static inline void wdl_verb_v2_store2(double *a, double *b, wdl_verb_v2 v) { _mm_storel_pd(a,v); _mm_storeh_pd(b,v); }
+static inline double wdl_verb_v2_lo(wdl_verb_v2 v) { return _mm_cvtsd_f64(v); }
+static inline double wdl_verb_v2_hi(wdl_verb_v2 v) { return _mm_cvtsd_f64(_mm_unpackhi_pd(v,v)); }
+static inline wdl_verb_v2 wdl_verb_v2_add(wdl_verb_v2 a, wdl_verb_v2 b) { return _mm_add_pd(a,b); }
+static inline wdl_verb_v2 wdl_verb_v2_sub(wdl_verb_v2 a, wdl_verb_v2 b) { return _mm_sub_pd(a,b); }
+static inline wdl_verb_v2 wdl_verb_v2_mul(wdl_verb_v2 a, wdl_verb_v2 b) { return _mm_mul_pd(a,b); }
+// same as denormal_filter_double() on each lane: denormals (and -0.0) become 0.0, everything else passes
+static inline wdl_verb_v2 wdl_verb_v2_denormal_filter(wdl_verb_v2 a)
+{
+#if defined(WDL_DENORMAL_FTZMODE) || defined(WDL_DENORMAL_DO_NOT_FILTER)
+  return a; // denormal_filter_double() is a no-op too
+#else
+  const wdl_verb_v2 absv = _mm_andnot_pd(_mm_set1_pd(-0.0),a);
+  return _mm_and_pd(a,_mm_cmpnlt_pd(absv,_mm_set1_pd(DBL_MIN)));
+#endif
+}
+
+#elif defined(WDL_REVERB_USE_NEON)
+
+typedef float64x2_t wdl_verb_v2;
+static inline wdl_verb_v2 wdl_verb_v2_set(double a, double b) { return vsetq_lane_f64(b,vdupq_n_f64(a),1); }
+static inline wdl_verb_v2 wdl_verb_v2_set1(double a) { return vdupq_n_f64(a); }
+static inline wdl_verb_v2 wdl_verb_v2_load(const double *p) { return vld1q_f64(p); }
+static inline void wdl_verb_v2_store(double *p, wdl_verb_v2 v) { vst1q_f64(p,v); }
+static inline void wdl_verb_v2_store2(double *a, double *b, wdl_verb_v2 v) { vst1q_lane_f64(a,v,0); vst1q_lane_f64(b,v,1); }
+static inline double wdl_verb_v2_lo(wdl_verb_v2 v) { return vgetq_lane_f64(v,0); }
+static inline double wdl_verb_v2_hi(wdl_verb_v2 v) { return vgetq_lane_f64(v,1); }
+static inline wdl_verb_v2 wdl_verb_v2_add(wdl_verb_v2 a, wdl_verb_v2 b) { return vaddq_f64(a,b); }
+static inline wdl_verb_v2 wdl_verb_v2_sub(wdl_verb_v2 a, wdl_verb_v2 b) { return vsubq_f64(a,b); }
+static inline wdl_verb_v2 wdl_verb_v2_mul(wdl_verb_v2 a, wdl_verb_v2 b) { return vmulq_f64(a,b); }
+static inline wdl_verb_v2 wdl_verb_v2_denormal_filter(wdl_verb_v2 a)
+{
+#if defined(WDL_DENORMAL_FTZMODE) || defined(WDL_DENORMAL_DO_NOT_FILTER)
+  return a;
+#else
+  const uint64x2_t tiny = vcltq_f64(vabsq_f64(a),vdupq_n_f64(DBL_MIN));
+  return vreinterpretq_f64_u64(vbicq_u64(vreinterpretq_u64_f64(a),tiny));
+#endif
+}
+
+#else
+
+struct wdl_verb_v2 { double l, r; };
+static inline wdl_verb_v2 wdl_verb_v2_set(double a, double b) { wdl_verb_v2 v; v.l=a; v.r=b; return v; }
+static inline wdl_verb_v2 wdl_verb_v2_set1(double a) { return wdl_verb_v2_set(a,a); }
+static inline wdl_verb_v2 wdl_verb_v2_load(const double *p) { return wdl_verb_v2_set(p[0],p[1]); }
+static inline void wdl_verb_v2_store(double *p, wdl_verb_v2 v) { p[0]=v.l; p[1]=v.r; }
+static inline void wdl_verb_v2_store2(double *a, double *b, wdl_verb_v2 v) { *a=v.l; *b=v.r; }
+static inline double wdl_verb_v2_lo(wdl_verb_v2 v) { return v.l; }
+static inline double wdl_verb_v2_hi(wdl_verb_v2 v) { return v.r; }
+static inline wdl_verb_v2 wdl_verb_v2_add(wdl_verb_v2 a, wdl_verb_v2 b) { return wdl_verb_v2_set(a.l+b.l,a.r+b.r); }
+static inline wdl_verb_v2 wdl_verb_v2_sub(wdl_verb_v2 a, wdl_verb_v2 b) { return wdl_verb_v2_set(a.l-b.l,a.r-b.r); }
+static inline wdl_verb_v2 wdl_verb_v2_mul(wdl_verb_v2 a, wdl_verb_v2 b) { return wdl_verb_v2_set(a.l*b.l,a.r*b.r); }
+static inline wdl_verb_v2 wdl_verb_v2_denormal_filter(wdl_verb_v2 a)
+{
+  return wdl_verb_v2_set(denormal_filter_double(a.l),denormal_filter_double(a.r));
+}
+
+#endif
+
+
+#define WDL_REVERB_MODE_CLASSIC 0
+#define WDL_REVERB_MODE_DENSE 1
+
+class WDL_ReverbEngineBlock
+{
+public:
+  WDL_ReverbEngineBlock()
+  {
+    m_srate=44100.0;
+    m_roomsize=0.5;
+    m_damp=0.5;
+    m_mode=WDL_REVERB_MODE_CLASSIC;
+    SetWidth(1.0);
+    Reset(true);
+  }
+  ~WDL_ReverbEngineBlock()
+  {
+  }
+  void SetSampleRate(double srate)
+  {
+    if (m_srate!=srate)
+    {
+      m_srate=srate;
+      Reset(true);
+    }
+  }
+  void SetMode(int mode) // WDL_REVERB_MODE_*, clears the reverb if changed
+  {
+    if (m_mode!=mode)
+    {
+      m_mode=mode;
+      Reset(true);
+    }
+  }
+  int GetMode() const { return m_mode; }
+
+  // same as WDL_ReverbEngine::ProcessSampleBlock(), outp0/outp1 may be the same buffers as spl0/spl1
+  void ProcessSampleBlock(const double *spl0, const double *spl1, double *outp0, double *outp1, int ns)
+  {
+    double in[2*BLOCKSIZE], acc[2*BLOCKSIZE];
+    while (ns > 0)
+    {
+      const int n = ns < BLOCKSIZE ? ns : BLOCKSIZE;
+      int i,x;
+      for (i = 0; i < n; i ++)
+      {
+        in[2*i]=spl0[i];
+        in[2*i+1]=spl1[i];
+        acc[2*i]=acc[2*i+1]=0.0;
+      }
+
+      for (x = 0; x < NCOMBS; x += 2)
+      {
+        if (m_mode == WDL_REVERB_MODE_DENSE) ProcessCombPairDense(x,in,acc,n);
+        else ProcessCombPair(x,in,acc,n);
+      }
+      for (x = 0; x < NALLPASSES; x ++) ProcessAllpass(x,acc,n);
+
+      const double m = m_wid<0 ? -m_wid : m_wid;
+      for (i = 0; i < n; i ++)
+      {
+        double a=acc[2*i]*0.015, b=acc[2*i+1]*0.015;
+        if (m_wid<0) { const double t=a; a=b; b=t; }
+        outp0[i] = a*m + b*(1.0-m);
+        outp1[i] = b*m + a*(1.0-m);
+      }
+
+      spl0+=n;
+      spl1+=n;
+      outp0+=n;
+      outp1+=n;
+      ns-=n;
+    }
+  }
+
+  void Reset(bool doclear=false) // roomsize and dampening changes apply without a Reset(), unlike WDL_ReverbEngine
+  {
+    int x,ch;
+    const double sc=m_srate / 44100.0;
+    for (x = 0; x < NALLPASSES; x ++)
+    {
+      m_allpasses[x][0].setsize((int) (wdl_verb__allpasstunings[x] * sc));
+      m_allpasses[x][1].setsize((int) ((wdl_verb__allpasstunings[x]+wdl_verb__stereospread) * sc));
+      if (doclear)
+      {
+        m_allpasses[x][0].Reset();
+        m_allpasses[x][1].Reset();
+      }
+    }
+    m_moddepth=0.12 * 0.001 * m_srate;
+    if (m_moddepth > 30.0) m_moddepth=30.0;
+    const int guard = m_mode == WDL_REVERB_MODE_DENSE ? (int) (2.0*m_moddepth) + 2 : 0;
+    for (x = 0; x < NCOMBS; x ++)
+    {
+      m_combs[x][0].setsize((int) (wdl_verb__combtunings[x] * sc),guard);
+      m_combs[x][1].setsize((int) ((wdl_verb__combtunings[x]+wdl_verb__stereospread) * sc),guard);
+      if (doclear)
+      {
+        m_combs[x][0].Reset();
+        m_combs[x][1].Reset();
+        m_filterstore[x][0]=m_filterstore[x][1]=0.0;
+      }
+    }
+
+    // modulation: up to 2*depth samples of delay removed, at 0.3 to 1.1Hz
+    for (x = 0; x < NCOMBS; x ++) for (ch = 0; ch < 2; ch ++)
+    {
+      const double hz = 0.3 + 0.8 * ((x*2+ch)*7 % (NCOMBS*2)) / (NCOMBS*2);
+      const double w = 2.0*3.14159265358979323846*hz*MODINTERVAL/m_srate;
+      m_modrot[x][ch][0]=cos(w);
+      m_modrot[x][ch][1]=sin(w);
+      if (doclear)
+      {
+        const double ph = (x*2+ch)*2.39996322972865332; // golden angle
+        m_modosc[x][ch][0]=cos(ph);
+        m_modosc[x][ch][1]=sin(ph);
+        m_modpos[x][ch]=m_moddepth*(1.0+m_modosc[x][ch][1]);
+      }
+    }
+    if (doclear) m_modcnt=0;
+  }
+
+  void SetRoomSize(double sz) { m_roomsize=sz; } // 0.3..0.99 or so
+  void SetDampening(double dmp) { m_damp=dmp; } // 0..1
+  void SetWidth(double wid)
+  {
+    if (wid<-1) wid=-1;
+    else if (wid>1) wid=1;
+    wid*=0.5;
+    if (wid>=0.0) wid+=0.5;
+    else wid-=0.5;
+    m_wid=wid;
+  } // -1..1
+
+private:
+  enum
+  {
+    NCOMBS = sizeof(wdl_verb__combtunings)/sizeof(wdl_verb__combtunings[0]),
+    NALLPASSES = sizeof(wdl_verb__allpasstunings)/sizeof(wdl_verb__allpasstunings[0]),
+    BLOCKSIZE = 256, // samples per pass of each stage
+    MODINTERVAL = 32, // samples between modulation oscillator updates
+  };
+
+  struct DelayLine
+  {
+    DelayLine() { idx=0; size=0; guard=0; setsize(1); }
+    // guard: samples after the end that mirror the start, for reads past the write position without wrapping
+    void setsize(int sz, int g=0)
+    {
+      if (sz<1) sz=1;
+      if (size!=sz || guard!=g)
+      {
+        idx=0;
+        size=sz;
+        guard=g;
+        buf.Resize(size+guard);
+        Reset();
+      }
+    }
+    void Reset() { memset(buf.Get(),0,buf.GetSize()*sizeof(double)); }
+    int run(int n) const { const int r=size-idx; return n<r ? n : r; } // samples until wrap
+    void advance(int n) { idx+=n; if (idx>=size) idx-=size; }
+    void update_guard(int n) // after writing n samples at idx
+    {
+      if (idx<guard)
+      {
+        if (n>guard-idx) n=guard-idx;
+        memcpy(buf.Get()+size+idx,buf.Get()+idx,n*sizeof(double));
+      }
+    }
+
+    WDL_TypedBuf<double> buf;
+    int idx, size, guard;
+  };
+
+  // combs x and x+1, both channels. matches WDL_ReverbComb::process()
+  void ProcessCombPair(int x, const double *in, double *acc, int n)
+  {
+    DelayLine *a=m_combs[x], *b=m_combs[x+1];
+    const wdl_verb_v2 fb=wdl_verb_v2_set1(m_roomsize), damp=wdl_verb_v2_set1(m_damp*0.4),
+                      damp1=wdl_verb_v2_set1(1-m_damp*0.4);
+    wdl_verb_v2 fsa=wdl_verb_v2_load(m_filterstore[x]), fsb=wdl_verb_v2_load(m_filterstore[x+1]);
+
+    while (n > 0)
+    {
+      int r=a[0].run(n);
+      r=a[1].run(r);
+      r=b[0].run(r);
+      r=b[1].run(r);
+
+      double *a0=a[0].buf.Get()+a[0].idx, *a1=a[1].buf.Get()+a[1].idx;
+      double *b0=b[0].buf.Get()+b[0].idx, *b1=b[1].buf.Get()+b[1].idx;
+      for (int i = 0; i < r; i ++)
+      {
+        const wdl_verb_v2 inp=wdl_verb_v2_load(in+2*i);
+        const wdl_verb_v2 oa=wdl_verb_v2_set(a0[i],a1[i]), ob=wdl_verb_v2_set(b0[i],b1[i]);
+
+        fsa=wdl_verb_v2_denormal_filter(wdl_verb_v2_add(wdl_verb_v2_mul(oa,damp1),wdl_verb_v2_mul(fsa,damp)));
+        fsb=wdl_verb_v2_denormal_filter(wdl_verb_v2_add(wdl_verb_v2_mul(ob,damp1),wdl_verb_v2_mul(fsb,damp)));
+        wdl_verb_v2_store2(a0+i,a1+i,wdl_verb_v2_add(inp,wdl_verb_v2_mul(fsa,fb)));
+        wdl_verb_v2_store2(b0+i,b1+i,wdl_verb_v2_add(inp,wdl_verb_v2_mul(fsb,fb)));
+
+        wdl_verb_v2_store(acc+2*i,wdl_verb_v2_add(wdl_verb_v2_add(wdl_verb_v2_load(acc+2*i),oa),ob));
+      }
+
+      a[0].advance(r); a[1].advance(r);
+      b[0].advance(r); b[1].advance(r);
+      in+=2*r;
+      acc+=2*r;
+      n-=r;
+    }
+    wdl_verb_v2_store(m_filterstore[x],fsa);
+    wdl_verb_v2_store(m_filterstore[x+1],fsb);
+  }
+
+  // WDL_REVERB_MODE_DENSE: modulated reads, and the feedback of combs x and x+1 rotated into each other
+  void ProcessCombPairDense(int x, const double *in, double *acc, int n)
+  {
+    DelayLine *a=m_combs[x], *b=m_combs[x+1];
+    const wdl_verb_v2 fb=wdl_verb_v2_set1(m_roomsize), damp=wdl_verb_v2_set1(m_damp*0.4),
+                      damp1=wdl_verb_v2_set1(1-m_damp*0.4);
+    // rotation by pi/6, c*c+s*s=1 so the loop gain is the same as the classic combs
+    const wdl_verb_v2 rc=wdl_verb_v2_set1(0.86602540378443864676), rs=wdl_verb_v2_set1(0.5);
+    wdl_verb_v2 fsa=wdl_verb_v2_load(m_filterstore[x]), fsb=wdl_verb_v2_load(m_filterstore[x+1]);
+    DelayLine *lines[4] = { a, a+1, b, b+1 };
+    double *pos[4] = { m_modpos[x], m_modpos[x]+1, m_modpos[x+1], m_modpos[x+1]+1 };
+    double dpos[4];
+    int k, cnt=m_modcnt;
+
+    while (n > 0)
+    {
+      if (!cnt)
+      {
+        // the read offsets ramp linearly to the next oscillator value over MODINTERVAL samples
+        for (k = 0; k < 4; k ++)
+        {
+          double *osc=m_modosc[x+(k>>1)][k&1];
+          const double *rot=m_modrot[x+(k>>1)][k&1];
+          const double c=osc[0]*rot[0]-osc[1]*rot[1], s=osc[1]*rot[0]+osc[0]*rot[1];
+          const double g=1.5-0.5*(c*c+s*s); // keeps the oscillator on the unit circle
+          osc[0]=c*g;
+          osc[1]=s*g;
+          dpos[k]=(m_moddepth*(1.0+osc[1]) - *pos[k]) / MODINTERVAL;
+        }
+        cnt=MODINTERVAL;
+      }
+      else
+      {
+        for (k = 0; k < 4; k ++)
+        {
+          const double *osc=m_modosc[x+(k>>1)][k&1];
+          dpos[k]=(m_moddepth*(1.0+osc[1]) - *pos[k]) / cnt;
+        }
+      }
+
+      int r=n<cnt ? n : cnt;
+      for (k = 0; k < 4; k ++) r=lines[k]->run(r);
+
+      // read up to 2*depth samples ahead of the write position (a slightly shorter delay), going past the
+      // end into the guard area. the run is also cut where the integer part of any read offset changes
+      double *w[4], fr[4];
+      const double *rp[4];
+      for (k = 0; k < 4; k ++)
+      {
+        const double p=*pos[k], d=dpos[k], p1=p+d;
+        const int ip=(int)p1;
+        double lim=r;
+        if (d>0.0) lim=ceil((ip+1-p)/d)-1.0;
+        else if (d<0.0) lim=floor((p-ip)/-d);
+        if (lim<r) r=lim<1.0 ? 1 : (int)lim;
+
+        w[k]=lines[k]->buf.Get()+lines[k]->idx;
+        rp[k]=w[k]+ip;
+        fr[k]=p1-ip;
+      }
+      wdl_verb_v2 fra=wdl_verb_v2_set(fr[0],fr[1]), frb=wdl_verb_v2_set(fr[2],fr[3]);
+      const wdl_verb_v2 dfa=wdl_verb_v2_set(dpos[0],dpos[1]), dfb=wdl_verb_v2_set(dpos[2],dpos[3]);
+
+      for (int i = 0; i < r; i ++)
+      {
+        const wdl_verb_v2 a0=wdl_verb_v2_set(rp[0][i],rp[1][i]), a1=wdl_verb_v2_set(rp[0][i+1],rp[1][i+1]);
+        const wdl_verb_v2 b0=wdl_verb_v2_set(rp[2][i],rp[3][i]), b1=wdl_verb_v2_set(rp[2][i+1],rp[3][i+1]);
+        const wdl_verb_v2 oa=wdl_verb_v2_add(a0,wdl_verb_v2_mul(wdl_verb_v2_sub(a1,a0),fra));
+        const wdl_verb_v2 ob=wdl_verb_v2_add(b0,wdl_verb_v2_mul(wdl_verb_v2_sub(b1,b0),frb));
+        fra=wdl_verb_v2_add(fra,dfa);
+        frb=wdl_verb_v2_add(frb,dfb);
+
+        const wdl_verb_v2 inp=wdl_verb_v2_load(in+2*i);
+        fsa=wdl_verb_v2_denormal_filter(wdl_verb_v2_add(wdl_verb_v2_mul(oa,damp1),wdl_verb_v2_mul(fsa,damp)));
+        fsb=wdl_verb_v2_denormal_filter(wdl_verb_v2_add(wdl_verb_v2_mul(ob,damp1),wdl_verb_v2_mul(fsb,damp)));
+        const wdl_verb_v2 ra=wdl_verb_v2_sub(wdl_verb_v2_mul(fsa,rc),wdl_verb_v2_mul(fsb,rs));
+        const wdl_verb_v2 rb=wdl_verb_v2_add(wdl_verb_v2_mul(fsa,rs),wdl_verb_v2_mul(fsb,rc));
+        wdl_verb_v2_store2(w[0]+i,w[1]+i,wdl_verb_v2_add(inp,wdl_verb_v2_mul(ra,fb)));
+        wdl_verb_v2_store2(w[2]+i,w[3]+i,wdl_verb_v2_add(inp,wdl_verb_v2_mul(rb,fb)));
+
+        wdl_verb_v2_store(acc+2*i,wdl_verb_v2_add(wdl_verb_v2_add(wdl_verb_v2_load(acc+2*i),oa),ob));
+      }
+
+      for (k = 0; k < 4; k ++)
+      {
+        *pos[k]+=dpos[k]*r;
+        lines[k]->update_guard(r);
+        lines[k]->advance(r);
+      }
+      in+=2*r;
+      acc+=2*r;
+      n-=r;
+      cnt-=r;
+    }
+    wdl_verb_v2_store(m_filterstore[x],fsa);
+    wdl_verb_v2_store(m_filterstore[x+1],fsb);
+    if (x+2 >= NCOMBS) m_modcnt=cnt; // all comb pairs see the same block, so advance once
+  }
+
+  // matches WDL_ReverbAllpass::process() with a feedback of 0.5, in place on buf
+  void ProcessAllpass(int x, double *buf, int n)
+  {
+    DelayLine *ap=m_allpasses[x];
+    const wdl_verb_v2 fb=wdl_verb_v2_set1(0.5);
+    while (n > 0)
+    {
+      const int r=ap[1].run(ap[0].run(n));
+      double *l0=ap[0].buf.Get()+ap[0].idx, *l1=ap[1].buf.Get()+ap[1].idx;
+      for (int i = 0; i < r; i ++)
+      {
+        const wdl_verb_v2 inp=wdl_verb_v2_load(buf+2*i), bufout=wdl_verb_v2_set(l0[i],l1[i]);
+        wdl_verb_v2_store2(l0+i,l1+i,wdl_verb_v2_denormal_filter(wdl_verb_v2_add(inp,wdl_verb_v2_mul(bufout,fb))));
+        wdl_verb_v2_store(buf+2*i,wdl_verb_v2_sub(bufout,inp));
+      }
+      ap[0].advance(r);
+      ap[1].advance(r);
+      buf+=2*r;
+      n-=r;
+    }
+  }
+
+  double m_wid;
+  double m_roomsize;
+  double m_damp;
+  double m_srate;
+  int m_mode;
+
+  DelayLine m_allpasses[NALLPASSES][2];
+  DelayLine m_combs[NCOMBS][2];
+  double m_filterstore[NCOMBS][2];
+
+  // WDL_REVERB_MODE_DENSE
+  double m_moddepth; // samples
+  double m_modosc[NCOMBS][2][2]; // cos, sin
+  double m_modrot[NCOMBS][2][2];
+  double m_modpos[NCOMBS][2]; // current read offset
+  int m_modcnt; // samples until the next oscillator update
+};
+
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef _WDL_BASE64_H_
 #define _WDL_BASE64_H_
 
+#include <string.h>
+
 #ifndef WDL_BASE64_FUNCDECL
 #define WDL_BASE64_FUNCDECL static
 #endif
@@ -60,9 +62,7 @@ WDL_BASE64_FUNCDECL void wdl_base64encode(const unsigned char *in, char *out, in
   out[0]=0;
 }
 
-WDL_BASE64_FUNCDECL int wdl_base64decode(const char *src, unsigned char *dest, int destsize)
-{
-  static const char *tab = // poolable string
+static const char wdl_base64_decode_tab[] = // 0xff for characters not in the alphabet
     "\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
     "\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
     "\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x3e\xff\xff\xff\x3f"
@@ -80,6 +80,9 @@ WDL_BASE64_FUNCDECL int wdl_base64decode(const char *src, unsigned char *dest, i
     "\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff"
     "\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff";
 
+WDL_BASE64_FUNCDECL int wdl_base64decode(const char *src, unsigned char *dest, int destsize)
+{
+  const char *tab = wdl_base64_decode_tab;
 
   int accum=0, nbits=0, wpos=0;
 
@@ -103,5 +106,122 @@ WDL_BASE64_FUNCDECL int wdl_base64decode(const char *src, unsigned char *dest, i
   }
 }
 
+// Same result as wdl_base64decode(), but reads at most srclen characters of src (which need not be NUL terminated),
+// decoding 4 characters (or 16/64 with SSE2/NEON) at a time while they are all in the alphabet.
+// Define WDL_BASE64_NO_SIMD to use only the 4 character path.
+#if !defined(WDL_BASE64_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+  #include <emmintrin.h>
+  #define WDL_BASE64_SSE2
+#elif !defined(WDL_BASE64_NO_SIMD) && defined(__aarch64__)
+  #include <arm_neon.h>
+  #define WDL_BASE64_NEON
+#endif
+
+#ifdef WDL_BASE64_NEON
+static inline uint8x16_t wdl_base64_neon_lookup(uint8x16_t c) // 0xff for characters not in the alphabet
+{
+  uint8x16_t r = vdupq_n_u8(0xff), t;
+  t = vsubq_u8(c,vdupq_n_u8('A')); r = vbslq_u8(vcltq_u8(t,vdupq_n_u8(26)),t,r);
+  t = vsubq_u8(c,vdupq_n_u8('a')); r = vbslq_u8(vcltq_u8(t,vdupq_n_u8(26)),vaddq_u8(t,vdupq_n_u8(26)),r);
+  t = vsubq_u8(c,vdupq_n_u8('0')); r = vbslq_u8(vcltq_u8(t,vdupq_n_u8(10)),vaddq_u8(t,vdupq_n_u8(52)),r);
+  r = vbslq_u8(vceqq_u8(c,vdupq_n_u8('+')),vdupq_n_u8(62),r);
+  r = vbslq_u8(vceqq_u8(c,vdupq_n_u8('/')),vdupq_n_u8(63),r);
+  return r;
+}
+#endif
+
+WDL_BASE64_FUNCDECL int wdl_base64decode_len(const char *src, int srclen, unsigned char *dest, int destsize)
+{
+  const unsigned char *tab = (const unsigned char *)wdl_base64_decode_tab;
+  const unsigned char *s = (const unsigned char *)src;
+  int spos=0, wpos=0;
+
+  if (destsize <= 0) return 0;
+
+#ifdef WDL_BASE64_SSE2
+  while (srclen-spos >= 16 && destsize-wpos >= 16)
+  {
+    const __m128i c = _mm_loadu_si128((const __m128i *)(s+spos));
+    #define WDL_BASE64_RANGE(lo,hi) _mm_and_si128(_mm_cmpgt_epi8(c,_mm_set1_epi8((lo)-1)),_mm_cmplt_epi8(c,_mm_set1_epi8((hi)+1)))
+    const __m128i m_AZ = WDL_BASE64_RANGE('A','Z'), m_az = WDL_BASE64_RANGE('a','z'), m_09 = WDL_BASE64_RANGE('0','9');
+    #undef WDL_BASE64_RANGE
+    const __m128i m_plus = _mm_cmpeq_epi8(c,_mm_set1_epi8('+')), m_slash = _mm_cmpeq_epi8(c,_mm_set1_epi8('/'));
+    if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(m_AZ,m_az),_mm_or_si128(m_09,_mm_or_si128(m_plus,m_slash)))) != 0xffff) break;
+
+    __m128i off = _mm_and_si128(m_AZ,_mm_set1_epi8(-'A'));
+    off = _mm_or_si128(off,_mm_and_si128(m_az,_mm_set1_epi8(26-'a')));
+    off = _mm_or_si128(off,_mm_and_si128(m_09,_mm_set1_epi8(52-'0')));
+    off = _mm_or_si128(off,_mm_and_si128(m_plus,_mm_set1_epi8(62-'+')));
+    off = _mm_or_si128(off,_mm_and_si128(m_slash,_mm_set1_epi8(63-'/')));
+    const __m128i v = _mm_add_epi8(c,off);
+
+    // pairs of 6 bit values to 12 bits, then pairs of those to 24 bits per 32 bit lane
+    const __m128i v12 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v,_mm_set1_epi16(0xff)),6),_mm_srli_epi16(v,8));
+    const __m128i v24 = _mm_madd_epi16(v12,_mm_set1_epi32(0x00011000));
+    // big endian order in the low 3 bytes of each lane
+    const __m128i o = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(v24,16),_mm_set1_epi32(0xff)),
+                                                _mm_and_si128(v24,_mm_set1_epi32(0xff00))),
+                                   _mm_slli_epi32(_mm_and_si128(v24,_mm_set1_epi32(0xff)),16));
+    // overlapping 4 byte stores, the 4th byte of each is overwritten by the next (and the last is within destsize)
+    unsigned char *d = dest+wpos;
+    const int o0 = _mm_cvtsi128_si32(o), o1 = _mm_cvtsi128_si32(_mm_srli_si128(o,4));
+    const int o2 = _mm_cvtsi128_si32(_mm_srli_si128(o,8)), o3 = _mm_cvtsi128_si32(_mm_srli_si128(o,12));
+    memcpy(d,&o0,4);
+    memcpy(d+3,&o1,4);
+    memcpy(d+6,&o2,4);
+    memcpy(d+9,&o3,4);
+    spos+=16;
+    wpos+=12;
+  }
+#elif defined(WDL_BASE64_NEON)
+  while (srclen-spos >= 64 && destsize-wpos >= 48)
+  {
+    const uint8x16x4_t c = vld4q_u8(s+spos);
+    const uint8x16_t a = wdl_base64_neon_lookup(c.val[0]), b = wdl_base64_neon_lookup(c.val[1]);
+    const uint8x16_t e = wdl_base64_neon_lookup(c.val[2]), f = wdl_base64_neon_lookup(c.val[3]);
+    if (vmaxvq_u8(vorrq_u8(vorrq_u8(a,b),vorrq_u8(e,f))) > 63) break;
+
+    uint8x16x3_t o;
+    o.val[0] = vorrq_u8(vshlq_n_u8(a,2),vshrq_n_u8(b,4));
+    o.val[1] = vorrq_u8(vshlq_n_u8(b,4),vshrq_n_u8(e,2));
+    o.val[2] = vorrq_u8(vshlq_n_u8(e,6),f);
+    vst3q_u8(dest+wpos,o);
+    spos+=64;
+    wpos+=48;
+  }
+#endif
+
+  while (srclen-spos >= 4 && destsize-wpos >= 3)
+  {
+    const int a=tab[s[spos]], b=tab[s[spos+1]], c=tab[s[spos+2]], d=tab[s[spos+3]];
+    if ((a|b|c|d)&0x80) break;
+    const int accum = (a<<18)|(b<<12)|(c<<6)|d;
+    dest[wpos] = (accum>>16)&0xff;
+    dest[wpos+1] = (accum>>8)&0xff;
+    dest[wpos+2] = accum&0xff;
+    spos+=4;
+    wpos+=3;
+  }
+
+  // the rest (up to an invalid character or '=', or the end of dest) a character at a time, as wdl_base64decode() does
+  int accum=0, nbits=0;
+  while (spos < srclen && wpos < destsize)
+  {
+    const int v=tab[s[spos++]];
+    if (v&0x80) break;
+
+    accum += v;
+    nbits += 6;
+
+    if (nbits >= 8)
+    {
+      nbits-=8;
+      dest[wpos] = (accum>>nbits)&0xff;
+      if (++wpos >= destsize) break;
+    }
+    accum <<= 6;
+  }
+  return wpos;
+}
 
 #endif
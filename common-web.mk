@@ -97,6 +97,12 @@ WAM_LDFLAGS = -s EXPORTED_RUNTIME_METHODS="['ccall', 'cwrap', 'setValue', 'UTF8T
 -s SINGLE_FILE=1
 #-s ENVIRONMENT=worker
 
+# To pass parameter changes, MIDI and messages between the WAM processor and the controller through rings in the processor's heap
+# (see IPlug/WEB/IPlugWAM_SharedRing.h) rather than a postMessage() for each one, build the processor with shared memory. The page
+# must then be cross-origin isolated (served with Cross-Origin-Opener-Policy: same-origin and Cross-Origin-Embedder-Policy: require-corp)
+# WAM_CFLAGS += -matomics -mbulk-memory
+# WAM_LDFLAGS += -s SHARED_MEMORY=1
+
 WEB_LDFLAGS = -s EXPORTED_FUNCTIONS=$(WEB_EXPORTS) \
 -s EXPORTED_RUNTIME_METHODS="['UTF8ToString']" \
 -s BINARYEN_ASYNC_COMPILATION=1 \